@@ -35,6 +35,7 @@
 #include "hw.h"
 #include "low_power.h"
 #include "asr_timer.h"
+#include "memstats.h"
 #include "binary.h"
 
 #define PI 3.1415926535897932384626433832795
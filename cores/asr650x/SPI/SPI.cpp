@@ -23,8 +23,6 @@
 #include "project.h"
 #include "HardwareSerial.h"
 
-#define spi_TIMEOUT	500
-
 
 SPIClass::SPIClass(uint8_t spi_bus)
     :_spi_num(spi_bus)
@@ -77,13 +75,13 @@ bool SPIClass::begin(int8_t sck, int8_t miso, int8_t mosi, int8_t ss)
 	
 	if(_spi_num == 0)
 	{
-		uint32_t div = (float)CYDEV_BCLK__HFCLK__HZ / SPI_1_SPI_OVS_FACTOR / _freq - 1;
+		uint32_t div = (CYDEV_BCLK__HFCLK__HZ / SPI_1_SPI_OVS_FACTOR + _freq - 1) / _freq - 1;
 		SPI_1_SCBCLK_DIV_REG = div << 8 ;
 		SPI_1_Start();
 	}
 	else
 	{
-		uint32_t div = (float)CYDEV_BCLK__HFCLK__HZ / SPI_2_SPI_OVS_FACTOR / _freq - 1;
+		uint32_t div = (CYDEV_BCLK__HFCLK__HZ / SPI_2_SPI_OVS_FACTOR + _freq - 1) / _freq - 1;
 		SPI_2_SCBCLK_DIV_REG = div << 8 ;
 		SPI_2_Start();
 	}
@@ -111,14 +109,15 @@ void SPIClass::setFrequency(uint32_t freq)
 		_freq = 6000000;
 	}
 	
+	// The divider rounds up, the clock never exceeds what was asked for
 	if(_spi_num == 0)
 	{
-		uint32_t div = (float)CYDEV_BCLK__HFCLK__HZ / SPI_1_SPI_OVS_FACTOR / _freq - 1;
+		uint32_t div = (CYDEV_BCLK__HFCLK__HZ / SPI_1_SPI_OVS_FACTOR + _freq - 1) / _freq - 1;
 		SPI_1_SCBCLK_DIV_REG = div << 8 ;
 	}
 	else
 	{
-		uint32_t div = (float)CYDEV_BCLK__HFCLK__HZ / SPI_2_SPI_OVS_FACTOR / _freq - 1;
+		uint32_t div = (CYDEV_BCLK__HFCLK__HZ / SPI_2_SPI_OVS_FACTOR + _freq - 1) / _freq - 1;
 		SPI_2_SCBCLK_DIV_REG = div << 8 ;
 	}
 }
@@ -180,62 +179,107 @@ void SPIClass::endTransaction()
 
 
 
-uint8_t SPIClass::transfer(uint8_t data)
+/*
+ * The SCB FIFOs are accessed directly, the components are built without
+ * software buffers. A bulk transfer keeps the TX FIFO fed while it collects
+ * RX, so the clock runs without a gap between bytes instead of stopping for
+ * every round trip. No more than SPI_1_FIFO_SIZE bytes are ever in flight,
+ * which is also what the RX FIFO holds: an interrupt in the middle of the
+ * loop stalls the bus but cannot make RX overflow.
+ */
+struct SPIFifo
 {
-	uint32 rxdata;
-	uint32 timeout = 0;
+	reg32 *txWrite;
+	reg32 *rxRead;
+	reg32 *rxStatus;
+};
 
-	if(_spi_num == 0)
+static const SPIFifo spiFifo[2] = {
+	{ &SPI_1_TX_FIFO_WR_REG, &SPI_1_RX_FIFO_RD_REG, &SPI_1_RX_FIFO_STATUS_REG },
+	{ &SPI_2_TX_FIFO_WR_REG, &SPI_2_RX_FIFO_RD_REG, &SPI_2_RX_FIFO_STATUS_REG },
+};
+
+/*
+ * Shifts size bytes. tx repeats every period bytes, NULL sends 0xFF; rx may
+ * be NULL and may be tx itself, a byte is only stored after it was sent.
+ * Gives up once nothing has come back for stall turns, returns the bytes
+ * received.
+ */
+static uint32_t spiPipeline(const SPIFifo *fifo, const uint8_t *tx, uint32_t period,
+                            uint8_t *rx, uint32_t size, uint32_t stall)
+{
+	uint32_t sent = 0;
+	uint32_t received = 0;
+	uint32_t index = 0;
+	uint32_t idle = 0;
+
+	// leftovers of an earlier transfer that timed out
+	while((*fifo->rxStatus & SPI_1_RX_FIFO_STATUS_USED_MASK) != 0)
 	{
-		while(SPI_1_SpiUartGetTxBufferSize() != 0);
-		SPI_1_SpiUartWriteTxData(data);
-		
-		while(SPI_1_SpiUartGetRxBufferSize() == 0)
-		{
-			timeout++;
-			if(timeout > spi_TIMEOUT )break;
-		}
-		if(timeout > spi_TIMEOUT ){}
-		else
-		{
-			rxdata = SPI_1_SpiUartReadRxData();
-			return (uint8_t)rxdata;
-		}
+		(void)(uint8_t)*fifo->rxRead;
 	}
-	else
+
+	while(received < size)
 	{
-		while(SPI_2_SpiUartGetTxBufferSize() != 0);
-		SPI_2_SpiUartWriteTxData(data);
-		
-		while(SPI_2_SpiUartGetRxBufferSize() == 0)
+		if(sent < size && sent - received < SPI_1_FIFO_SIZE)
 		{
-			timeout++;
-			if(timeout > spi_TIMEOUT )break;
+			*fifo->txWrite = (tx != NULL) ? tx[index] : 0xFF;
+			if(++index == period)
+			{
+				index = 0;
+			}
+			sent++;
+		}
+
+		if((*fifo->rxStatus & SPI_1_RX_FIFO_STATUS_USED_MASK) != 0)
+		{
+			uint8_t data = (uint8_t)*fifo->rxRead;
+
+			if(rx != NULL)
+			{
+				rx[received] = data;
+			}
+			received++;
+			idle = 0;
 		}
-		if(timeout > spi_TIMEOUT ){}
-		else
+		else if(++idle > stall)
 		{
-			rxdata = SPI_2_SpiUartReadRxData();
-			return (uint8_t)rxdata;
+			break;
 		}
 	}
+	return received;
 }
 
-void SPIClass::transfer(uint8_t * data, uint32_t size) 
+// Loop turns worth several bytes on the wire, each turn takes a few cycles.
+static uint32_t spiStall(uint32_t freq)
+{
+	return CYDEV_BCLK__HFCLK__HZ / freq * 8;
+}
+
+uint32_t SPIClass::getFrequency(void)
 {
-	for(uint32_t i;i<size;i++)
+	uint32_t div;
+
+	if(_spi_num == 0)
 	{
-		if(_spi_num == 0)
-		{
-			while(SPI_1_SpiUartGetTxBufferSize() != 0);
-			SPI_1_SpiUartWriteTxData(*data++);
-		}
-		else
-		{
-			while(SPI_2_SpiUartGetTxBufferSize() != 0);
-			SPI_2_SpiUartWriteTxData(*data++);
-		}
+		div = (SPI_1_SCBCLK_DIV_REG >> 8) & 0xFFFF;
+		return CYDEV_BCLK__HFCLK__HZ / SPI_1_SPI_OVS_FACTOR / (div + 1);
 	}
+	div = (SPI_2_SCBCLK_DIV_REG >> 8) & 0xFFFF;
+	return CYDEV_BCLK__HFCLK__HZ / SPI_2_SPI_OVS_FACTOR / (div + 1);
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+	uint8_t rxdata = 0xFF;
+
+	spiPipeline(&spiFifo[_spi_num], &data, 1, &rxdata, 1, spiStall(_freq));
+	return rxdata;
+}
+
+void SPIClass::transfer(uint8_t * data, uint32_t size) 
+{
+	spiPipeline(&spiFifo[_spi_num], data, size, data, size, spiStall(_freq));
 }
 
 
@@ -245,44 +289,16 @@ void SPIClass::transfer(uint8_t * data, uint32_t size)
  */
 void SPIClass::transferBytes(uint8_t * data, uint8_t * out, uint32_t size)
 {
-	uint32 timeout = 0;
-	for(uint32_t i;i<size;i++)
-	{
-		if(_spi_num == 0)
-		{
-			while(SPI_1_SpiUartGetTxBufferSize() != 0);
-			SPI_1_SpiUartWriteTxData(*data++);
-			
-			while(SPI_1_SpiUartGetRxBufferSize() == 0)
-			{
-				timeout++;
-				if(timeout > spi_TIMEOUT )break;
-			}
-			
-			if(timeout > spi_TIMEOUT ){}
-			else
-			{
-				* out++ = (uint8_t)SPI_1_SpiUartReadRxData();
-			}
-		}
-		else
-		{
-			while(SPI_2_SpiUartGetTxBufferSize() != 0);
-			SPI_2_SpiUartWriteTxData(*data++);
+	spiPipeline(&spiFifo[_spi_num], data, size, out, size, spiStall(_freq));
+}
 
-			while(SPI_2_SpiUartGetRxBufferSize() == 0)
-			{
-				timeout++;
-				if(timeout > spi_TIMEOUT )break;
-			}
-			
-			if(timeout > spi_TIMEOUT ){}
-			else
-			{
-				* out++ = (uint8_t)SPI_2_SpiUartReadRxData();
-			}
-		}
+void SPIClass::writePattern(const uint8_t * pattern, uint8_t size, uint32_t repeat)
+{
+	if(pattern == NULL || size == 0)
+	{
+		return;
 	}
+	spiPipeline(&spiFifo[_spi_num], pattern, size, NULL, (uint32_t)size * repeat, spiStall(_freq));
 }
 
 SPIClass SPI(SPI_NUM_0);
@@ -70,10 +70,16 @@ public:
     void setFrequency(uint32_t freq);
     void beginTransaction(SPISettings settings);
     void endTransaction(void);
+    // clock the SCB divider actually produces, at most what was asked for
+    uint32_t getFrequency(void);
+
+    // full duplex in place, data is overwritten with what was received
     void transfer(uint8_t * data, uint32_t size);
     uint8_t transfer(uint8_t data);
-  
+
     void transferBytes(uint8_t * data, uint8_t * out, uint32_t size);
+    // sends pattern (size bytes) repeat times, what comes back is dropped
+    void writePattern(const uint8_t * pattern, uint8_t size, uint32_t repeat);
 };
 typedef SPIClass SPIC;
 
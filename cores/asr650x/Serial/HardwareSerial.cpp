@@ -11,7 +11,7 @@
 HardwareSerial Serial(UART_NUM_0);
 HardwareSerial Serial1(UART_NUM_1);
 
-uart_rxbuff_t _rxbuff[2];
+uart_rxbuff_t * _rxbuff[2];
 
 HardwareSerial::HardwareSerial(int8_t uart_num) 
 	:_uart_num(uart_num) 
@@ -19,38 +19,54 @@ HardwareSerial::HardwareSerial(int8_t uart_num)
 	,_tx(-1)
 	{}
 
+// moves the hardware FIFO into the free span of the ring, one commit per
+// contiguous span. Bytes that find the ring full are dropped.
 void writeRxToBuff0()
 {
-	uint8_t uart_num = 0;
+	uart_rxbuff_t * rx = _rxbuff[0];
+	uint8_t * region;
+	size_t len;
+	size_t n;
+
 	while(UART_1_SpiUartGetRxBufferSize())
 	{
-		if( ((_rxbuff[uart_num].rx_w + 1) % UART_RX_SIZE) != _rxbuff[uart_num].rx_r )
+		len = rx->writeSpan(region);
+		if(len == 0)
 		{
-			_rxbuff[uart_num].rx_buf[_rxbuff[uart_num].rx_w ++] = UART_1_UartGetByte();;
-			_rxbuff[uart_num].rx_w = _rxbuff[uart_num].rx_w % UART_RX_SIZE;
+			UART_1_UartGetByte();
+			continue;
 		}
-		else
+		n = 0;
+		while(n < len && UART_1_SpiUartGetRxBufferSize())
 		{
-			UART_1_UartGetByte();
+			region[n++] = UART_1_UartGetByte();
 		}
+		rx->commit(n);
 	}
 	UART_1_ClearRxInterruptSource(UART_1_INTR_RX_NOT_EMPTY);
 }
 
 void writeRxToBuff1()
 {
-	uint8_t uart_num = 1;
+	uart_rxbuff_t * rx = _rxbuff[1];
+	uint8_t * region;
+	size_t len;
+	size_t n;
+
 	while(UART_2_SpiUartGetRxBufferSize())
 	{
-		if( ((_rxbuff[uart_num].rx_w + 1) % UART_RX_SIZE) != _rxbuff[uart_num].rx_r )
+		len = rx->writeSpan(region);
+		if(len == 0)
 		{
-			_rxbuff[uart_num].rx_buf[_rxbuff[uart_num].rx_w ++] = UART_2_UartGetByte();;
-			_rxbuff[uart_num].rx_w = _rxbuff[uart_num].rx_w % UART_RX_SIZE;
+			UART_2_UartGetByte();
+			continue;
 		}
-		else
+		n = 0;
+		while(n < len && UART_2_SpiUartGetRxBufferSize())
 		{
-			UART_2_UartGetByte();
+			region[n++] = UART_2_UartGetByte();
 		}
+		rx->commit(n);
 	}
 	UART_2_ClearRxInterruptSource(UART_2_INTR_RX_NOT_EMPTY);
 }
@@ -135,9 +151,11 @@ bool HardwareSerial::begin(uint32_t baud, uint32_t config, int rxPin, int txPin,
 		UART_2_UART_TX_CTRL_REG =tx_ctrl0;
 		UART_2_TX_CTRL_REG = tx_ctrl1;
 	}
-	_rxbuff[_uart_num].rx_r=0;
-	_rxbuff[_uart_num].rx_w=0;
-	_rxbuff[_uart_num].rx_buf=(uint8_t*) malloc(UART_RX_SIZE);
+	if(_rxbuff[_uart_num] == NULL)
+	{
+		_rxbuff[_uart_num] = new uart_rxbuff_t();
+	}
+	_rxbuff[_uart_num]->reset();
 
 	if( _uart_num == UART_NUM_0) 
 	{
@@ -226,12 +244,9 @@ int HardwareSerial::available(void)
 	//}
 	return 0;*/
 
-	if(_rxbuff[_uart_num].rx_r == _rxbuff[_uart_num].rx_w)
+	if(_rxbuff[_uart_num] == NULL)
 		return 0;
-	if(_rxbuff[_uart_num].rx_r < _rxbuff[_uart_num].rx_w)
-		return _rxbuff[_uart_num].rx_w - _rxbuff[_uart_num].rx_r;
-	else
-		return UART_RX_SIZE - _rxbuff[_uart_num].rx_r + _rxbuff[_uart_num].rx_w;
+	return _rxbuff[_uart_num]->size();
 }
 
 void HardwareSerial::delayByte(void)
@@ -253,9 +268,9 @@ int HardwareSerial::availableForWrite(void)
 
 int HardwareSerial::peek(void)
 {
-  if(_rxbuff[_uart_num].rx_r == _rxbuff[_uart_num].rx_w)
+  if(_rxbuff[_uart_num] == NULL || _rxbuff[_uart_num]->empty())
 	  return -1;
-  return _rxbuff[_uart_num].rx_buf[_rxbuff[_uart_num].rx_r];
+  return _rxbuff[_uart_num]->peek();
 }
 
 int HardwareSerial::read(void)
@@ -272,12 +287,37 @@ int HardwareSerial::read(void)
 		}
 	}
 	return (uint32)(-1);*/
-	if(_rxbuff[_uart_num].rx_r == _rxbuff[_uart_num].rx_w)
+	if(_rxbuff[_uart_num] == NULL || _rxbuff[_uart_num]->empty())
 		return -1;
 
-	uint8_t data = _rxbuff[_uart_num].rx_buf[_rxbuff[_uart_num].rx_r++];
-	_rxbuff[_uart_num].rx_r = _rxbuff[_uart_num].rx_r % UART_RX_SIZE;
-	return data;
+	return _rxbuff[_uart_num]->read();
+}
+
+// copies whole spans out of the ring, waits up to the stream timeout for each
+// further byte like Stream::readBytes
+size_t HardwareSerial::readBytes(char *buffer, size_t length)
+{
+	size_t count = 0;
+	size_t n;
+
+	if(_rxbuff[_uart_num] == NULL)
+		return 0;
+
+	_startMillis = millis();
+	while(count < length)
+	{
+		n = _rxbuff[_uart_num]->read((uint8_t *) buffer + count, length - count);
+		if(n > 0)
+		{
+			count += n;
+			_startMillis = millis();
+		}
+		else if(millis() - _startMillis >= _timeout)
+		{
+			break;
+		}
+	}
+	return count;
 }
 
 int HardwareSerial::read(uint8_t* buff, uint32_t timeout)
@@ -311,8 +351,8 @@ int HardwareSerial::read(uint8_t* buff, uint32_t timeout)
 
 void HardwareSerial::flush()
 {
-	_rxbuff[_uart_num].rx_r = 0;
-	_rxbuff[_uart_num].rx_w = 0;
+	if(_rxbuff[_uart_num] != NULL)
+		_rxbuff[_uart_num]->reset();
 	if( _uart_num == UART_NUM_0)
 	{
 		UART_1_SpiUartClearRxBuffer();
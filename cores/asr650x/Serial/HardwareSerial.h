@@ -48,6 +48,7 @@
 #include <inttypes.h>
 #include <project.h>
 #include "Stream.h"
+#include "RingBuffer.h"
 #include "cytypes.h"
 #include <UART_1_SCB_IRQ.h>
 #include <UART_2_SCB_IRQ.h>
@@ -59,11 +60,8 @@
 #define UART_BUFF_SIZE 255
 #define UART_RX_SIZE (UART_BUFF_SIZE+1)
 
-typedef struct {
-    uint8_t * rx_buf;
-    uint16_t rx_w;
-    uint16_t rx_r;
-} uart_rxbuff_t;
+// filled by the UART interrupt, emptied by read(), UART_RX_SIZE must be a power of two
+typedef RingBuffer<uint8_t, UART_RX_SIZE> uart_rxbuff_t;
 
 class HardwareSerial: public Stream
 {
@@ -80,6 +78,8 @@ public:
     int read(void);
     void flush(void);
     int read(uint8_t* buff, uint32_t timeout);
+    using Stream::readBytes;
+    size_t readBytes(char *buffer, size_t length);
 //    uint16_t readBytesUntil(char terminator, char *buffer, uint16_t length);
     size_t write(uint8_t);
     size_t write(const uint8_t *buffer, size_t size);
@@ -34,13 +34,18 @@ extern "C" {
 #include "Arduino.h"
 #include <ASR_Arduino.h>
 
+#define WIRE_PHASE_WRITE 0
+#define WIRE_PHASE_READ  1
+
+static TwoWire *wireBus[2];
+
 
 
 TwoWire::TwoWire(int8_t bus_num)
     :_i2c_num(bus_num)
-    ,_freq(100000)
     ,_sda(-1)
     ,_scl(-1)
+    ,_freq(100000)
     ,rxIndex(0)
     ,rxLength(0)
     ,rxQueued(0)
@@ -51,6 +56,11 @@ TwoWire::TwoWire(int8_t bus_num)
     ,last_error(I2C_ERROR_OK)
     ,transmitting(0)
     ,_timeOutMillis(50)
+    ,_head(NULL)
+    ,_tail(NULL)
+    ,_phase(0)
+    ,_running(false)
+    ,_halted(false)
 {}
 
 TwoWire::~TwoWire()
@@ -94,13 +104,18 @@ bool TwoWire::begin(int sda, int scl, uint32_t frequency)
 		uint32_t div = (float)CYDEV_BCLK__HFCLK__HZ / 8 / _freq / 3;
 		I2C_SCBCLK_DIV_REG = div << 8 ;
 		I2C_Start();
+		CyIntSetVector(I2C_ISR_NUMBER, &TwoWire::isr0);
 	}
 	else
 	{
 		uint32_t div = (float)CYDEV_BCLK__HFCLK__HZ / 8 / _freq / 3;
 		I2C_1_SCBCLK_DIV_REG = div << 8 ;
 		I2C_1_Start();
+		CyIntSetVector(I2C_1_ISR_NUMBER, &TwoWire::isr1);
 	}
+	wireBus[_i2c_num] = this;
+	_running = false;
+	_halted = false;
     return true;
 }
 
@@ -128,6 +143,7 @@ void TwoWire::setFrequency(uint32_t freq)
 
 void TwoWire::end()
 {
+	abortTransactions(I2C_ERROR_BUS);
 	if(_i2c_num == I2C_NUM_0)
 	{
 		I2C_Stop();
@@ -159,113 +175,258 @@ size_t TwoWire::getClock()
     return _freq;
 }
 
-/* stickBreaker Nov 2017 ISR, and bigblock 64k-1
+/*
+ * The queue runs on the interrupt driven transfers of the SCB component:
+ * I2C_I2CMasterWriteBuf()/ReadBuf() start a transfer, the component ISR
+ * moves the bytes and sets a completion flag in the master status. The
+ * vector points at isr0/isr1, which run the component ISR and then look
+ * at that flag to start the next phase or the next transaction.
  */
-i2c_err_t TwoWire::writeTransmission(uint16_t address, uint8_t *buff, uint16_t size, bool sendStop)
+static uint32 masterWriteBuf(int8_t bus, uint32 address, const uint8_t *data, uint32 cnt, uint32 mode)
 {
-	uint8_t Status=0;
-	uint16_t i;
-	flush();
-	if(_i2c_num == I2C_NUM_0)
-	{
-		I2C_I2CMasterClearStatus();                                            //I2C״̬
-		Status =I2C_I2CMasterSendRestart(address, I2C_I2C_WRITE_XFER_MODE,I2CTIMEOUT);      //Ͷ
-	
-		if(Status == I2C_I2C_MSTR_NOT_READY)
-			Status =I2C_I2CMasterSendStart(address, I2C_I2C_WRITE_XFER_MODE,I2CTIMEOUT);
+	if(bus == I2C_NUM_0)
+		return I2C_I2CMasterWriteBuf(address, (uint8 *)data, cnt, mode);
+	return I2C_1_I2CMasterWriteBuf(address, (uint8 *)data, cnt, mode);
+}
 
-		if(Status == I2C_I2C_MSTR_NO_ERROR)
-		{
-			for(i=0;i<size;i++)
-			{
-				I2C_I2CMasterWriteByte(buff[i],I2CTIMEOUT);
-			}
-			if(sendStop)
-				I2C_I2CMasterSendStop(I2CTIMEOUT); 
-		}
-	}
-	else
-	{
-		I2C_1_I2CMasterClearStatus();                                            //I2C״̬
-		Status =I2C_1_I2CMasterSendRestart(address, I2C_1_I2C_WRITE_XFER_MODE,I2CTIMEOUT);      //Ͷ
+static uint32 masterReadBuf(int8_t bus, uint32 address, uint8_t *data, uint32 cnt, uint32 mode)
+{
+	if(bus == I2C_NUM_0)
+		return I2C_I2CMasterReadBuf(address, data, cnt, mode);
+	return I2C_1_I2CMasterReadBuf(address, data, cnt, mode);
+}
 
-		if(Status == I2C_I2C_MSTR_NOT_READY)
-			Status =I2C_1_I2CMasterSendStart(address, I2C_1_I2C_WRITE_XFER_MODE,I2CTIMEOUT);
+static i2c_err_t statusToError(uint32 status)
+{
+	if(status & (I2C_I2C_MSTAT_ERR_ADDR_NAK | I2C_I2C_MSTAT_ERR_SHORT_XFER))
+		return I2C_ERROR_ACK;
+	if(status & I2C_I2C_MSTAT_ERR_MASK)
+		return I2C_ERROR_BUS;
+	return I2C_ERROR_OK;
+}
 
-		if(Status == I2C_1_I2C_MSTR_NO_ERROR)
-		{
-			for(i=0;i<size;i++)
-			{
-				I2C_1_I2CMasterWriteByte(buff[i],I2CTIMEOUT);
-			}
-			if(sendStop)
-				I2C_1_I2CMasterSendStop(I2CTIMEOUT);
-	    }
-	}
-    if(Status==I2C_I2C_MSTR_NO_ERROR)
-    {
-    	last_error=I2C_ERROR_OK;
-    }
-    else
-    {
-    	last_error=I2C_ERROR_TIMEOUT;
-    }
-    return last_error;	  
+void TwoWire::isr0(void)
+{
+	I2C_I2C_ISR();
+	if(wireBus[I2C_NUM_0] != NULL)
+		wireBus[I2C_NUM_0]->serviceTransaction();
 }
 
-i2c_err_t TwoWire::readTransmission(uint16_t address, uint8_t *buff, uint16_t size, bool sendStop, uint32_t *readCount)
+void TwoWire::isr1(void)
 {
-	uint8_t Status=0;
-	uint16_t i;
-	flush();
-	if(_i2c_num == I2C_NUM_0)
-	{
-		I2C_I2CMasterClearStatus();                                            //I2C״̬
-		Status =I2C_I2CMasterSendRestart(address, I2C_I2C_READ_XFER_MODE,I2CTIMEOUT);      //Ͷ
+	I2C_1_I2C_ISR();
+	if(wireBus[I2C_NUM_1] != NULL)
+		wireBus[I2C_NUM_1]->serviceTransaction();
+}
+
+// Takes the head off the queue.
+I2CTransaction *TwoWire::popTransaction(void)
+{
+	I2CTransaction *t = _head;
+
+	_head = t->next;
+	if(_head == NULL)
+		_tail = NULL;
+	t->next = NULL;
+	_running = false;
+	return t;
+}
+
+// Hands t back to its owner, the callback may queue again.
+static void finishTransaction(I2CTransaction *t, i2c_err_t err)
+{
+	t->error = err;
+	t->done = true;
+	if(t->callback != NULL)
+		t->callback(t);
+}
 
-		if(Status == I2C_I2C_MSTR_NOT_READY)
-			Status =I2C_I2CMasterSendStart(address, I2C_I2C_READ_XFER_MODE,I2CTIMEOUT);
+// Starts the transaction at the head unless one is running, failing those
+// the bus refuses. The I2C interrupt must not be able to preempt it.
+void TwoWire::startTransactions(void)
+{
+	I2CTransaction *t;
+	uint32 mode;
+	uint32 status;
 
-		if(Status == I2C_I2C_MSTR_NO_ERROR)
+	while((t = _head) != NULL && !_running)
+	{
+		mode = _halted ? I2C_I2C_MODE_REPEAT_START : I2C_I2C_MODE_COMPLETE_XFER;
+		if(t->txLength > 0 || t->rxLength == 0)
 		{
-			for(i=0;i<size;i++)
-			{
-				I2C_I2CMasterReadByte(I2C_I2C_ACK_DATA,&buff[i],I2CTIMEOUT);
-				(* readCount)++;
-			}
-			if(sendStop)
-				I2C_I2CMasterSendStop(I2CTIMEOUT); 
+			_phase = WIRE_PHASE_WRITE;
+			if(t->rxLength > 0 || !t->sendStop)
+				mode |= I2C_I2C_MODE_NO_STOP;
+			status = masterWriteBuf(_i2c_num, t->address, t->tx, t->txLength, mode);
 		}
+		else
+		{
+			_phase = WIRE_PHASE_READ;
+			if(!t->sendStop)
+				mode |= I2C_I2C_MODE_NO_STOP;
+			status = masterReadBuf(_i2c_num, t->address, t->rx, t->rxLength, mode);
+		}
+		if(status == I2C_I2C_MSTR_NO_ERROR)
+		{
+			_running = true;
+			return;
+		}
+		finishTransaction(popTransaction(), I2C_ERROR_BUSY);
 	}
+}
+
+void TwoWire::serviceTransaction(void)
+{
+	I2CTransaction *t = _head;
+	uint32 status;
+	uint32 cmplt;
+	i2c_err_t err;
+
+	if(!_running)
+		return;
+
+	status = (_i2c_num == I2C_NUM_0) ? I2C_I2CMasterStatus() : I2C_1_I2CMasterStatus();
+	cmplt = (_phase == WIRE_PHASE_READ) ? I2C_I2C_MSTAT_RD_CMPLT : I2C_I2C_MSTAT_WR_CMPLT;
+	if(!(status & cmplt))
+		return;
+
+	if(_i2c_num == I2C_NUM_0)
+		I2C_I2CMasterClearStatus();
 	else
+		I2C_1_I2CMasterClearStatus();
+	_halted = (status & I2C_I2C_MSTAT_XFER_HALT) != 0;
+	err = statusToError(status);
+
+	if(err == I2C_ERROR_OK && _phase == WIRE_PHASE_WRITE && t->rxLength > 0)
 	{
-		I2C_1_I2CMasterClearStatus();                                            //I2C״̬
-		Status =I2C_1_I2CMasterSendRestart(address, I2C_1_I2C_READ_XFER_MODE,I2CTIMEOUT);      //Ͷ
+		// the write ended without a stop, read after a repeated start
+		_phase = WIRE_PHASE_READ;
+		if(masterReadBuf(_i2c_num, t->address, t->rx, t->rxLength,
+		                 I2C_I2C_MODE_REPEAT_START | (t->sendStop ? 0 : I2C_I2C_MODE_NO_STOP)) == I2C_I2C_MSTR_NO_ERROR)
+			return;
+		err = I2C_ERROR_BUS;
+	}
+	popTransaction();
+	startTransactions();
+	finishTransaction(t, err);
+}
 
-		if(Status == I2C_I2C_MSTR_NOT_READY)
-			Status =I2C_1_I2CMasterSendStart(address, I2C_1_I2C_READ_XFER_MODE,I2CTIMEOUT);
+// Fails everything queued and restarts the block, for a bus that hangs.
+// The queue is taken off first: a callback that queues again starts on the
+// restarted block instead of being failed again.
+void TwoWire::abortTransactions(i2c_err_t err)
+{
+	uint8 interruptState = CyEnterCriticalSection();
+	I2CTransaction *t = _head;
+	I2CTransaction *next;
 
-		if(Status == I2C_1_I2C_MSTR_NO_ERROR)
+	if(t != NULL)
+	{
+		if(_i2c_num == I2C_NUM_0)
 		{
-			for(i=0;i<size;i++)
-			{
-				I2C_1_I2CMasterReadByte(I2C_1_I2C_ACK_DATA,&buff[i],I2CTIMEOUT);
-				(* readCount)++;
-			}
-			if(sendStop)
-				I2C_1_I2CMasterSendStop(I2CTIMEOUT); 
+			I2C_Stop();
+			I2C_Start();
+			I2C_I2CMasterClearStatus();
+		}
+		else
+		{
+			I2C_1_Stop();
+			I2C_1_Start();
+			I2C_1_I2CMasterClearStatus();
+		}
+		_halted = false;
+		_running = false;
+		_head = NULL;
+		_tail = NULL;
+		for(; t != NULL; t = next)
+		{
+			next = t->next;
+			t->next = NULL;
+			finishTransaction(t, err);
 		}
 	}
-	
-	if(Status==I2C_I2C_MSTR_NO_ERROR)
-	{
-		last_error=I2C_ERROR_OK;
-	}
+	CyExitCriticalSection(interruptState);
+}
+
+i2c_err_t TwoWire::queueTransaction(I2CTransaction *t)
+{
+	uint8 interruptState;
+
+	if(!t->done || wireBus[_i2c_num] != this)
+		return I2C_ERROR_BUSY;
+
+	t->done = false;
+	t->error = I2C_ERROR_CONTINUE;
+	t->next = NULL;
+
+	interruptState = CyEnterCriticalSection();
+	if(_head == NULL)
+		_head = t;
 	else
+		_tail->next = t;
+	_tail = t;
+	startTransactions();
+	CyExitCriticalSection(interruptState);
+	return I2C_ERROR_OK;
+}
+
+i2c_err_t TwoWire::waitTransaction(I2CTransaction *t)
+{
+	uint8 number = (_i2c_num == I2C_NUM_0) ? I2C_ISR_NUMBER : I2C_1_ISR_NUMBER;
+	// the I2C interrupt cannot preempt a handler, there the flag is polled
+	bool sleep = (__get_IPSR() == 0);
+	uint32_t start = millis();
+	uint8 interruptState;
+
+	while(!t->done)
 	{
-		last_error=I2C_ERROR_TIMEOUT;
+		if(millis() - start > _timeOutMillis)
+		{
+			abortTransactions(I2C_ERROR_TIMEOUT);
+			break;
+		}
+		if(sleep)
+		{
+			// completing between the check and the WFI leaves the interrupt pending, it wakes
+			interruptState = CyEnterCriticalSection();
+			if(!t->done)
+				CySysPmSleep();
+			CyExitCriticalSection(interruptState);
+		}
+		else if(CY_INT_SET_PEND_REG & (1u << number))
+		{
+			CyIntClearPending(number);
+			if(_i2c_num == I2C_NUM_0)
+				isr0();
+			else
+				isr1();
+		}
 	}
-    return last_error;	  
+	return t->error;
+}
+
+i2c_err_t TwoWire::writeTransmission(uint16_t address, uint8_t *buff, uint16_t size, bool sendStop)
+{
+	I2CTransaction t(address, buff, size, NULL, 0, sendStop);
+
+	flush();
+	last_error = queueTransaction(&t);
+	if(last_error == I2C_ERROR_OK)
+		last_error = waitTransaction(&t);
+	return last_error;
+}
+
+i2c_err_t TwoWire::readTransmission(uint16_t address, uint8_t *buff, uint16_t size, bool sendStop, uint32_t *readCount)
+{
+	I2CTransaction t(address, NULL, 0, buff, size, sendStop);
+
+	flush();
+	last_error = queueTransaction(&t);
+	if(last_error == I2C_ERROR_OK)
+		last_error = waitTransaction(&t);
+	if(last_error == I2C_ERROR_OK && readCount != NULL)
+		*readCount += size;
+	return last_error;
 }
 
 
@@ -398,6 +559,11 @@ void TwoWire::flush(void)
     txLength = 0;
     rxQueued = 0;
     txQueued = 0;
+	// the component buffers belong to a queued transaction while one runs
+	if(_head != NULL)
+	{
+		return;
+	}
 	if(_i2c_num == I2C_NUM_0)
     {
 	    I2C_I2CMasterClearReadBuf();
@@ -511,7 +677,7 @@ uint32_t TwoWire::setDebugFlags( uint32_t setBits, uint32_t resetBits){
 }
 
 bool TwoWire::busy(void){
-//  return ((i2cGetStatus(i2c) & 16 )==16);
+    return _head != NULL;
 }
 
 TwoWire Wire = TwoWire(I2C_NUM_0);
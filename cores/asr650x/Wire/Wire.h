@@ -51,6 +51,33 @@ typedef enum {
     I2C_ERROR_NO_BEGIN
 } i2c_err_t;
 
+/*
+ * One queued transfer: writes txLength bytes, then reads rxLength bytes
+ * after a repeated start. Either part may be empty, both empty only
+ * addresses the device. The caller keeps it, and the buffers, alive until
+ * done is set. The callback runs from the I2C interrupt.
+ */
+struct I2CTransaction
+{
+    uint16_t address;
+    const uint8_t *tx;
+    uint16_t txLength;
+    uint8_t *rx;
+    uint16_t rxLength;
+    bool sendStop;                          // false keeps the bus for a repeated start
+    void (*callback)(I2CTransaction *t);
+    void *arg;
+    volatile bool done;
+    volatile i2c_err_t error;
+    I2CTransaction *next;
+
+    I2CTransaction(uint16_t address_ = 0, const uint8_t *tx_ = NULL, uint16_t txLength_ = 0,
+                   uint8_t *rx_ = NULL, uint16_t rxLength_ = 0, bool sendStop_ = true,
+                   void (*callback_)(I2CTransaction *t) = NULL, void *arg_ = NULL)
+        : address(address_), tx(tx_), txLength(txLength_), rx(rx_), rxLength(rxLength_),
+          sendStop(sendStop_), callback(callback_), arg(arg_), done(true), error(I2C_ERROR_OK), next(NULL)
+    {}
+};
 
 
 class TwoWire: public Stream
@@ -81,6 +108,20 @@ protected:
 
     uint16_t _timeOutMillis;
 
+    // transaction queue, run from the SCB interrupt
+    I2CTransaction * volatile _head;
+    I2CTransaction *_tail;
+    uint8_t _phase;
+    volatile bool _running;
+    bool _halted;
+
+    I2CTransaction *popTransaction(void);
+    void startTransactions(void);
+    void serviceTransaction(void);
+    void abortTransactions(i2c_err_t err);
+    static void isr0(void);
+    static void isr1(void);
+
 public:
     TwoWire(int8_t bus_num);
     ~TwoWire();
@@ -101,6 +142,12 @@ public:
     i2c_err_t writeTransmission(uint16_t address, uint8_t* buff, uint16_t size, bool sendStop=true);
     i2c_err_t readTransmission(uint16_t address, uint8_t* buff, uint16_t size, bool sendStop=true, uint32_t *readCount=NULL);
 
+    // Non-blocking: queueTransaction() returns at once, the transfers run
+    // one after the other from the interrupt. waitTransaction() sleeps
+    // until t is done, or gives up after the timeout and resets the bus.
+    i2c_err_t queueTransaction(I2CTransaction *t);
+    i2c_err_t waitTransaction(I2CTransaction *t);
+
     void beginTransmission(uint16_t address);
     void beginTransmission(uint8_t address);
     void beginTransmission(int address);
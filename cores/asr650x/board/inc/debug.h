@@ -96,7 +96,17 @@ extern "C"
     {                           \
     } while (0)
 
-#if LoRaWAN_DEBUG_LEVEL >= 2
+#if LoRaWAN_DEBUG_LEVEL == 3
+#include "trace.h"
+#define FREQ_PRINTF(format, ...) \
+    do                           \
+    {                            \
+    } while (0)
+#define DIO_PRINTF(format, ...) \
+    do                          \
+    {                           \
+    } while (0)
+#elif LoRaWAN_DEBUG_LEVEL == 2
 #define FREQ_PRINTF(format, ...) printf(format, ##__VA_ARGS__)
 #define DIO_PRINTF(format, ...) printf(format, ##__VA_ARGS__)
 #elif LoRaWAN_DEBUG_LEVEL == 1
@@ -113,6 +123,13 @@ extern "C"
     } while (0)
 #endif
 
+#if LoRaWAN_DEBUG_LEVEL != 3
+#define TRACE_EVENT(id, ...) \
+    do                       \
+    {                        \
+    } while (0)
+#endif
+
 #endif /* __DEBUG_H__*/
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,105 @@
+/*!
+ * \file      memstats.h
+ *
+ * \brief     Stack and heap high-water instrumentation
+ *
+ * \details   Start_c() paints the RAM between the end of .bss and the stack
+ *            pointer with STACK_PAINT before anything else runs. The stack
+ *            grows down into that pattern, stackHighWater() finds the
+ *            lowest word it has overwritten. The scan starts at the heap
+ *            break, so a stack that ran past its CYDEV_STACK_SIZE region is
+ *            still measured as long as it did not reach the heap.
+ *
+ *            malloc, calloc, realloc and free are linked with --wrap (see
+ *            platform.txt). The wrappers count failed allocations and add up
+ *            the chunk sizes of the live blocks for the peak, without
+ *            walking the free list; aos_malloc and operator new go through
+ *            malloc and are covered as well.
+ */
+#ifndef __MEMSTATS_H__
+#define __MEMSTATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * Value of every unused stack word after boot
+ */
+#define STACK_PAINT 0xC5C5C5C5u
+
+typedef struct sHeapStats
+{
+    /*!
+     * Bytes held by live allocations, chunk headers included
+     */
+    uint32_t Used;
+    /*!
+     * Highest Used seen after an allocation
+     */
+    uint32_t Peak;
+    /*!
+     * Free list plus the part of the heap never handed out
+     */
+    uint32_t Free;
+    /*!
+     * Largest block an allocation could get right now
+     */
+    uint32_t LargestFree;
+    /*!
+     * Allocations that returned NULL
+     */
+    uint32_t Failures;
+} HeapStats_t;
+
+/*!
+ * \brief   Fills the free RAM below the stack pointer with STACK_PAINT.
+ *          Called from Start_c(), before .data and .bss are set up.
+ */
+void stackPaint(void);
+
+/*!
+ * \brief   Deepest stack use since boot
+ *
+ * \retval  Bytes from the top of RAM down to the lowest word written
+ */
+uint32_t stackHighWater(void);
+
+/*!
+ * \brief   Stack region reserved by the linker script
+ */
+uint32_t stackSize(void);
+
+/*!
+ * \brief   Bytes between the heap break and the lowest stack word written.
+ *          Zero means the stack has run into the heap.
+ */
+uint32_t stackHeadroom(void);
+
+/*!
+ * \brief   Heap statistics, see HeapStats_t. Finding LargestFree walks the
+ *          free list with trial allocations, interrupts are off meanwhile.
+ */
+void heapStats(HeapStats_t *stats);
+
+/*!
+ * \brief   Prints stack and heap statistics through printf
+ */
+void memStatsDump(void);
+
+/*!
+ * \brief   AT+MEM? handler, call it from checkUserAt()
+ *
+ * \retval  true when cmd was MEM and has been answered
+ */
+bool memStatsAt(char *cmd, char *content);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MEMSTATS_H__
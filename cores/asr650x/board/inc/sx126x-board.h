@@ -27,6 +27,17 @@
 #include <stdbool.h>
 #include "sx126x.h"
 
+/*!
+ * Time spent waiting on the BUSY line, waits that found it low are not counted
+ */
+typedef struct
+{
+    uint32_t Waits;   //! Waits that found BUSY high
+    uint32_t TotalUs; //! Cumulative wait time [us]
+    uint32_t MaxUs;   //! Longest wait [us]
+    uint32_t SleepUs; //! Part of TotalUs spent in CPU sleep [us]
+}SX126xBusyStats_t;
+
 /*!
  * \brief Initializes the radio I/Os pins interface
  */
@@ -53,9 +64,40 @@ void SX126xReset( void );
 
 /*!
  * \brief Blocking loop to wait while the Busy pin in high
+ *
+ * \remark With SX126xSetBusyIrq enabled the CPU sleeps until the falling
+ *         edge, except in interrupt handlers where it keeps polling
  */
 void SX126xWaitOnBusy( void );
 
+/*!
+ * \brief Waits on BUSY in CPU sleep, woken by its falling edge, instead of
+ *        polling the pin
+ *
+ * \param [IN] enable Sleep while BUSY is high
+ */
+void SX126xSetBusyIrq( bool enable );
+
+/*!
+ * \brief Tells whether the radio is still processing the last command
+ *
+ * \retval busy State of the BUSY line
+ */
+bool SX126xIsBusy( void );
+
+/*!
+ * \brief Returns the time spent waiting on BUSY since start up or the last
+ *        SX126xResetBusyStats
+ *
+ * \param [OUT] stats Busy wait counters
+ */
+void SX126xGetBusyStats( SX126xBusyStats_t *stats );
+
+/*!
+ * \brief Clears the busy wait counters
+ */
+void SX126xResetBusyStats( void );
+
 /*!
  * \brief Wakes up the radio
  */
@@ -70,6 +112,17 @@ void SX126xWakeup( void );
  */
 void SX126xWriteCommand( RadioCommands_t opcode, uint8_t *buffer, uint16_t size );
 
+/*!
+ * \brief Send a command without waiting for the radio to process it. The
+ *        caller can prepare the next command meanwhile, every access waits
+ *        on BUSY before it starts.
+ *
+ * \param [in]  opcode        Opcode of the command
+ * \param [in]  buffer        Buffer to be send to the radio
+ * \param [in]  size          Size of the buffer to send
+ */
+void SX126xWriteCommandNoWait( RadioCommands_t opcode, uint8_t *buffer, uint16_t size );
+
 /*!
  * \brief Send a command that read data from the radio
  *
@@ -149,4 +202,9 @@ void SX126xSetPaOpt( uint8_t opt );
  */
 extern SX126x_t SX126x;
 
+/*!
+ * Bytes clocked over the radio SPI since start up
+ */
+extern uint32_t SX126xSpiBytes;
+
 #endif // __SX126x_BOARD_H__
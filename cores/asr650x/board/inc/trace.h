@@ -0,0 +1,113 @@
+/*!
+ * \file      trace.h
+ *
+ * \brief     Deferred binary event trace
+ *
+ * \details   Log sites store a fixed size record (event id, timestamp and up
+ *            to TRACE_MAX_ARGS integer arguments) into a RAM ring buffer.
+ *            Formatting is done later, from TraceFlush(), either on the
+ *            device using the format table below or on the host by
+ *            tools/trace_decode.py which parses TRACE_EVENT_LIST from this
+ *            file. Selected with "LoRaWan Debug Level" = 3.
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * Number of records kept in the ring buffer. Must be a power of two.
+ */
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 32
+#endif
+
+/*!
+ * Maximum number of integer arguments per record
+ */
+#define TRACE_MAX_ARGS 4
+
+/*!
+ * First byte of every record when flushed in binary mode
+ */
+#define TRACE_SYNC_BYTE 0xA5
+
+/*!
+ * Trace events and the printf format used to render them.
+ *
+ * \remark tools/trace_decode.py reads this list, keep one X() per line.
+ */
+#define TRACE_EVENT_LIST(X)                                                         \
+    X(TRACE_MAC_TX_DONE, "Event : Tx Done\r\n")                                     \
+    X(TRACE_MAC_RX_DONE, "Event : Rx Done size=%d, rssi=%d, snr=%d\r\n")            \
+    X(TRACE_MAC_TX_TIMEOUT, "Event : Tx Timeout\r\n")                               \
+    X(TRACE_MAC_RX_ERROR, "Event : Rx Error\r\n")                                   \
+    X(TRACE_MAC_RX_TIMEOUT, "Event : Rx Timeout\r\n")                               \
+    X(TRACE_MAC_RADIO_SEND, "RadioSend: size=%d, channel=%d, datarate=%d, txpower=%d\r\n") \
+    X(TRACE_MAC_DR_ADJUST, "Payload length(%d) and fOptLen(%d) exceed max size(%d), set datarate to Dr %d\r\n") \
+    X(TRACE_REGION_RX, "RX on freq %u Hz at DR %d\r\n")                             \
+    X(TRACE_REGION_TX, "TX on freq %u Hz at DR %d\r\n")                             \
+    X(TRACE_REGION_TX_POWER, "TX on freq %u Hz at DR %d power %d\r\n")
+
+#define TRACE_ENUM_ENTRY(id, fmt) id,
+
+typedef enum eTraceEventId
+{
+    TRACE_EVENT_LIST(TRACE_ENUM_ENTRY)
+    TRACE_EVENT_MAX
+} TraceEventId_t;
+
+/*!
+ * Trace record, 24 bytes
+ */
+typedef struct sTraceRecord
+{
+    uint16_t Id;
+    uint8_t NbArgs;
+    uint8_t Lost; //! Records dropped before this one because the buffer was full
+    uint32_t Timestamp;
+    uint32_t Args[TRACE_MAX_ARGS];
+} TraceRecord_t;
+
+/*!
+ * \brief Stores one record. Safe to call from interrupt context.
+ *
+ * \remark Use the TRACE_EVENT macro rather than calling this directly.
+ */
+void TraceWrite(uint16_t id, uint8_t nbArgs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/*!
+ * \brief Drains the ring buffer to the console UART. Call from thread
+ *        context only, typically right before entering low power.
+ *
+ * \remark Records are rendered with their format string unless
+ *         TRACE_OUTPUT_BINARY is defined, in which case they are sent raw,
+ *         each prefixed with TRACE_SYNC_BYTE.
+ */
+void TraceFlush(void);
+
+/*!
+ * \brief Returns the format string of an event, NULL if unknown
+ */
+const char *TraceFormat(uint16_t id);
+
+#define TRACE_NARGS(...) TRACE_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define TRACE_NARGS_(_0, _1, _2, _3, _4, N, ...) N
+#define TRACE_ARGS(...) TRACE_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0)
+#define TRACE_ARGS_(_0, a0, a1, a2, a3, ...) (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3)
+
+/*!
+ * TRACE_EVENT( id, [arg0, ... arg3] )
+ */
+#define TRACE_EVENT(id, ...) TraceWrite((id), TRACE_NARGS(__VA_ARGS__), TRACE_ARGS(__VA_ARGS__))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TRACE_H__
@@ -23,6 +23,7 @@
 #include <project.h>
 //#include "asr_project.h"
 #include <stdlib.h>
+#include <string.h>
 #include "utilities.h"
 #include "board-config.h"
 #include "board.h"
@@ -30,8 +31,16 @@
 #include "timer.h"
 #include "sx126x-board.h"
 #include "debug.h"
+#include "ASR_Arduino.h"
 
 SX126x_t SX126x;
+uint32_t SX126xSpiBytes = 0;
+
+/*!
+ * Wait for BUSY in CPU sleep, woken by its falling edge
+ */
+static bool BusyIrq = false;
+static SX126xBusyStats_t BusyStats;
 
 #define ID1 (0x1FF80050)
 #define ID2 (0x1FF80054)
@@ -75,11 +84,20 @@ char gChipId[17];
  */
 static bool UsbIsConnected = false;
 
+static void SX126xOnBusyIrq(void)
+{
+    // Only there to wake the CPU, the wait loop reads the pin
+}
+
 void SX126xIoInit(void)
 {
     GpioInit(&SX126x.Spi.Nss, RADIO_NSS, OUTPUT, PIN_PUSH_PULL, PIN_PULL_UP, 1);
     GpioInit(&SX126x.BUSY, RADIO_BUSY, INPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0);
     GpioInit(&SX126x.DIO1, RADIO_DIO_1, INPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0);
+    if (BusyIrq == true)
+    {
+        GpioSetInterrupt(&SX126x.BUSY, FALLING, IRQ_HIGH_PRIORITY, SX126xOnBusyIrq);
+    }
 }
 
 void SX126xIoIrqInit(DioIrqHandler dioIrq)
@@ -110,10 +128,77 @@ void SX126xReset(void)
     pinMode(SX126x.Reset.pin, ANALOG);
 }
 
+void SX126xSetBusyIrq(bool enable)
+{
+    if (enable == BusyIrq)
+    {
+        return;
+    }
+    BusyIrq = enable;
+    if (enable == true)
+    {
+        GpioSetInterrupt(&SX126x.BUSY, FALLING, IRQ_HIGH_PRIORITY, SX126xOnBusyIrq);
+    }
+    else
+    {
+        GpioRemoveInterrupt(&SX126x.BUSY);
+    }
+}
+
+bool SX126xIsBusy(void)
+{
+    return GpioRead(&SX126x.BUSY) == 1;
+}
+
 void SX126xWaitOnBusy(void)
 {
+    uint32_t start;
+    uint32_t elapsed;
+    uint8_t interruptState;
+    bool sleep;
+
+    if (GpioRead(&SX126x.BUSY) == 0)
+    {
+        return;
+    }
+    start = micros();
+    // The BUSY interrupt cannot preempt a handler, there it spins
+    sleep = (BusyIrq == true) && (__get_IPSR() == 0);
     while (GpioRead(&SX126x.BUSY) == 1)
-        ;
+    {
+        if (sleep == true)
+        {
+            // An edge between the read and the WFI stays pending and wakes it
+            interruptState = CyEnterCriticalSection();
+            if (GpioRead(&SX126x.BUSY) == 1)
+            {
+                CySysPmSleep();
+            }
+            CyExitCriticalSection(interruptState);
+        }
+    }
+    elapsed = micros() - start;
+
+    BusyStats.Waits++;
+    BusyStats.TotalUs += elapsed;
+    if (elapsed > BusyStats.MaxUs)
+    {
+        BusyStats.MaxUs = elapsed;
+    }
+    if (sleep == true)
+    {
+        BusyStats.SleepUs += elapsed;
+    }
+}
+
+void SX126xGetBusyStats(SX126xBusyStats_t *stats)
+{
+    *stats = BusyStats;
+}
+
+void SX126xResetBusyStats(void)
+{
+    memset(&BusyStats, 0, sizeof(BusyStats));
 }
 
 void SX126xWakeup(void)
@@ -125,16 +210,20 @@ void SX126xWakeup(void)
     SpiInOut(&SX126x.Spi, 0x00);
 
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 2;
 
-    // Wait for chip to be ready.
-    SX126xWaitOnBusy();
+    // The chip wakes up in STDBY_RC, next commands need no further wakeup
+    SX126xSetOperatingMode(MODE_STDBY_RC);
 
     BoardEnableIrq();
+
+    // Wait for chip to be ready, with a TCXO this takes its start up time.
+    // Interrupts are back on, a command issued from one waits on BUSY too.
+    SX126xWaitOnBusy();
 }
 
-void SX126xWriteCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
+static void SX126xSendCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
 {
-
     SX126xCheckDeviceReady();
     GpioWrite(&SX126x.Spi.Nss, 0);
 
@@ -146,6 +235,12 @@ void SX126xWriteCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
     }
 
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 1 + size;
+}
+
+void SX126xWriteCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
+{
+    SX126xSendCommand(command, buffer, size);
 
     if (command != RADIO_SET_SLEEP)
     {
@@ -153,6 +248,11 @@ void SX126xWriteCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
     }
 }
 
+void SX126xWriteCommandNoWait(RadioCommands_t command, uint8_t *buffer, uint16_t size)
+{
+    SX126xSendCommand(command, buffer, size);
+}
+
 void SX126xReadCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
 {
 
@@ -167,6 +267,7 @@ void SX126xReadCommand(RadioCommands_t command, uint8_t *buffer, uint16_t size)
     }
 
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 2 + size;
 
     SX126xWaitOnBusy();
 }
@@ -187,6 +288,7 @@ void SX126xWriteRegisters(uint16_t address, uint8_t *buffer, uint16_t size)
     }
 
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 3 + size;
 
     SX126xWaitOnBusy();
 }
@@ -211,6 +313,7 @@ void SX126xReadRegisters(uint16_t address, uint8_t *buffer, uint16_t size)
         buffer[i] = SpiInOut(&SX126x.Spi, 0);
     }
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 4 + size;
 
     SX126xWaitOnBusy();
 }
@@ -236,6 +339,7 @@ void SX126xWriteBuffer(uint8_t offset, uint8_t *buffer, uint8_t size)
         SpiInOut(&SX126x.Spi, buffer[i]);
     }
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 2 + size;
 
     SX126xWaitOnBusy();
 }
@@ -254,6 +358,7 @@ void SX126xReadBuffer(uint8_t offset, uint8_t *buffer, uint8_t size)
         buffer[i] = SpiInOut(&SX126x.Spi, 0);
     }
     GpioWrite(&SX126x.Spi.Nss, 1);
+    SX126xSpiBytes += 3 + size;
 
     SX126xWaitOnBusy();
 }
@@ -358,6 +463,7 @@ void boardInitMcu(void)
     SpiInit();
     Asr_Timer_Init();
     RtcInit();
+    DelayInit();
     systime = millis();
 #if defined(CubeCell_Board) || defined(CubeCell_Capsule) || defined(CubeCell_BoardPlus) || defined(CubeCell_GPS) || defined(CubeCell_HalfAA)
     pinMode(Vext, OUTPUT);
@@ -0,0 +1,273 @@
+/*!
+ * \file      memstats.c
+ *
+ * \brief     Stack and heap high-water instrumentation implementation
+ */
+#include <project.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include "memstats.h"
+
+/*!
+ * Linker symbols: end of .bss, where the heap starts, and top of RAM, where
+ * the stack starts
+ */
+extern char end[];
+extern char __cy_stack[];
+
+/*!
+ * Current end of the heap, moved by _sbrk()
+ */
+static char *HeapBreak = end;
+
+/*!
+ * Set while heapStats() probes the free list, _sbrk() refuses to grow then
+ */
+static volatile bool HeapFrozen = false;
+
+/*!
+ * newlib-nano keeps the chunk size in a word in front of every block
+ */
+#define HEAP_CHUNK_HEADER sizeof(long)
+
+/*!
+ * Chunk sizes of the live blocks, the same bytes mallinfo().uordblks counts
+ */
+static uint32_t HeapUsed = 0;
+static uint32_t HeapPeak = 0;
+static uint32_t HeapFailures = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static inline char *StackPointer(void)
+{
+    char *sp;
+
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+    return sp;
+}
+
+static inline uint32_t *WordAbove(char *addr)
+{
+    return (uint32_t *)(((uint32_t)addr + 3) & ~3u);
+}
+
+/*!
+ * Replaces the weak _sbrk() in Cm0plusStart.c, with the same
+ * CYDEV_HEAP_SIZE limit.
+ */
+void *_sbrk(int nbytes)
+{
+    char *prev = HeapBreak;
+
+    if (HeapFrozen || ((HeapBreak + nbytes) - end) > CYDEV_HEAP_SIZE)
+    {
+        errno = ENOMEM;
+        return (void *) -1;
+    }
+    HeapBreak += nbytes;
+    return prev;
+}
+
+void stackPaint(void)
+{
+    // volatile keeps this a word loop, a memset() call would put its own
+    // frame into the range being painted
+    volatile uint32_t *p = WordAbove(end);
+    uint32_t *sp = (uint32_t *)StackPointer();
+
+    while (p < sp)
+    {
+        *p++ = STACK_PAINT;
+    }
+}
+
+/*!
+ * Lowest word the stack has written. Everything from the heap break up is
+ * searched, the stack may have grown past its own region.
+ */
+static uint32_t *StackLowest(void)
+{
+    uint32_t *p = WordAbove(HeapBreak);
+    uint32_t *sp = (uint32_t *)StackPointer();
+
+    while (p < sp && *p == STACK_PAINT)
+    {
+        p++;
+    }
+    return p;
+}
+
+uint32_t stackHighWater(void)
+{
+    return __cy_stack - (char *)StackLowest();
+}
+
+uint32_t stackSize(void)
+{
+    return CYDEV_STACK_SIZE;
+}
+
+uint32_t stackHeadroom(void)
+{
+    return (char *)StackLowest() - (char *)WordAbove(HeapBreak);
+}
+
+static inline uint32_t HeapChunk(void *ptr)
+{
+    return malloc_usable_size(ptr) + HEAP_CHUNK_HEADER;
+}
+
+static void HeapNote(void *ptr, size_t size)
+{
+    uint8 state;
+
+    if (ptr == NULL)
+    {
+        // a zero sized request may legitimately return NULL
+        if (size != 0)
+        {
+            HeapFailures++;
+        }
+        return;
+    }
+
+    state = CyEnterCriticalSection();
+    HeapUsed += HeapChunk(ptr);
+    if (HeapUsed > HeapPeak)
+    {
+        HeapPeak = HeapUsed;
+    }
+    CyExitCriticalSection(state);
+}
+
+static void HeapForget(uint32_t chunk)
+{
+    uint8 state = CyEnterCriticalSection();
+
+    HeapUsed = (HeapUsed > chunk) ? HeapUsed - chunk : 0;
+    CyExitCriticalSection(state);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+
+    HeapNote(ptr, size);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    void *ptr = __real_calloc(count, size);
+
+    HeapNote(ptr, count * size);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    uint32_t chunk = (ptr != NULL) ? HeapChunk(ptr) : 0;
+    void *moved = __real_realloc(ptr, size);
+
+    // the old block is released unless the call failed
+    if ((moved != NULL) || (size == 0))
+    {
+        HeapForget(chunk);
+    }
+    HeapNote(moved, size);
+    return moved;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        HeapForget(HeapChunk(ptr));
+    }
+    __real_free(ptr);
+}
+
+void heapStats(HeapStats_t *stats)
+{
+    struct mallinfo info;
+    uint32_t top;
+    uint32_t lo = 0;
+    uint32_t hi;
+    int err = errno;
+    uint8 state = CyEnterCriticalSection();
+
+    info = mallinfo();
+    top = (end + CYDEV_HEAP_SIZE) - HeapBreak;
+    // Blocks libc allocates and frees internally bypass the wrappers
+    HeapUsed = info.uordblks;
+
+    // The free list is private to malloc. Its largest chunk is the largest
+    // request that succeeds while the heap may not grow; freeing it again
+    // merges it back, so the list is left as it was.
+    HeapFrozen = true;
+    hi = info.fordblks;
+    while (lo < hi)
+    {
+        uint32_t mid = hi - (hi - lo) / 2;
+        void *ptr = __real_malloc(mid);
+
+        if (ptr != NULL)
+        {
+            __real_free(ptr);
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    HeapFrozen = false;
+
+    CyExitCriticalSection(state);
+    errno = err;
+
+    stats->Used = info.uordblks;
+    stats->Peak = (HeapPeak > (uint32_t)info.uordblks) ? HeapPeak : (uint32_t)info.uordblks;
+    stats->Free = info.fordblks + top;
+    // a free chunk that ends at the break could also be extended into the
+    // top, this is not added
+    stats->LargestFree = (lo > top) ? lo : top;
+    stats->Failures = HeapFailures;
+}
+
+void memStatsDump(void)
+{
+    HeapStats_t heap;
+    uint32_t used = stackHighWater();
+
+    heapStats(&heap);
+    printf("stack: %lu of %lu bytes used, %lu left above the heap%s\r\n",
+            (unsigned long)used, (unsigned long)stackSize(), (unsigned long)stackHeadroom(),
+            (used > stackSize()) ? ", OVERFLOWED its region" : "");
+    printf("heap: %lu used, %lu peak, %lu free, %lu largest block, %lu failed allocations\r\n",
+            (unsigned long)heap.Used, (unsigned long)heap.Peak, (unsigned long)heap.Free,
+            (unsigned long)heap.LargestFree, (unsigned long)heap.Failures);
+}
+
+bool memStatsAt(char *cmd, char *content)
+{
+    HeapStats_t heap;
+
+    if (strcmp(cmd, "MEM") != 0 || content[0] != '?')
+    {
+        return false;
+    }
+
+    heapStats(&heap);
+    printf("+MEM=%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+            (unsigned long)stackHighWater(), (unsigned long)stackSize(), (unsigned long)stackHeadroom(),
+            (unsigned long)heap.Used, (unsigned long)heap.Peak, (unsigned long)heap.Free,
+            (unsigned long)heap.LargestFree, (unsigned long)heap.Failures);
+    return true;
+}
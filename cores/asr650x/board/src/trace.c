@@ -0,0 +1,112 @@
+/*!
+ * \file      trace.c
+ *
+ * \brief     Deferred binary event trace implementation
+ */
+#include <project.h>
+#include <stdio.h>
+#include "trace.h"
+#include "timer.h"
+
+#if ((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) != 0)
+#error "TRACE_BUFFER_SIZE must be a power of two"
+#endif
+
+#define TRACE_FORMAT_ENTRY(id, fmt) fmt,
+
+static const char *const TraceFormats[TRACE_EVENT_MAX] = {
+    TRACE_EVENT_LIST(TRACE_FORMAT_ENTRY)
+};
+
+static TraceRecord_t TraceBuffer[TRACE_BUFFER_SIZE];
+
+/*!
+ * Free running indexes, masked on access
+ */
+static volatile uint16_t TraceHead = 0;
+static volatile uint16_t TraceTail = 0;
+
+/*!
+ * Records dropped since the last successful write
+ */
+static uint8_t TraceLost = 0;
+
+const char *TraceFormat(uint16_t id)
+{
+    if (id >= TRACE_EVENT_MAX)
+    {
+        return NULL;
+    }
+    return TraceFormats[id];
+}
+
+void TraceWrite(uint16_t id, uint8_t nbArgs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    TraceRecord_t *rec;
+    uint32_t now = TimerGetCurrentTime();
+    uint8 state = CyEnterCriticalSection();
+
+    if ((uint16_t)(TraceHead - TraceTail) >= TRACE_BUFFER_SIZE)
+    {
+        if (TraceLost < 0xFF)
+        {
+            TraceLost++;
+        }
+        CyExitCriticalSection(state);
+        return;
+    }
+    rec = &TraceBuffer[TraceHead & (TRACE_BUFFER_SIZE - 1)];
+    rec->Id = id;
+    rec->NbArgs = nbArgs;
+    rec->Lost = TraceLost;
+    rec->Timestamp = now;
+    rec->Args[0] = a0;
+    rec->Args[1] = a1;
+    rec->Args[2] = a2;
+    rec->Args[3] = a3;
+    TraceLost = 0;
+    TraceHead++;
+    CyExitCriticalSection(state);
+}
+
+static void TraceOutput(const TraceRecord_t *rec)
+{
+#ifdef TRACE_OUTPUT_BINARY
+    const uint8_t *p = (const uint8_t *)rec;
+    uint8_t i;
+
+    UART_1_UartPutChar(TRACE_SYNC_BYTE);
+    for (i = 0; i < sizeof(TraceRecord_t); i++)
+    {
+        UART_1_UartPutChar(p[i]);
+    }
+#else
+    const char *fmt = TraceFormat(rec->Id);
+
+    if (rec->Lost != 0)
+    {
+        printf("[trace] %u records lost\r\n", (unsigned int)rec->Lost);
+    }
+    printf("[%u] ", (unsigned int)rec->Timestamp);
+    if (fmt == NULL)
+    {
+        printf("unknown event %u\r\n", (unsigned int)rec->Id);
+        return;
+    }
+    printf(fmt, rec->Args[0], rec->Args[1], rec->Args[2], rec->Args[3]);
+#endif
+}
+
+void TraceFlush(void)
+{
+    TraceRecord_t rec;
+
+    while (TraceTail != TraceHead)
+    {
+        // Copy out so that the slot can be reused as soon as the tail moves,
+        // the tail is only ever written here
+        rec = TraceBuffer[TraceTail & (TRACE_BUFFER_SIZE - 1)];
+        TraceTail++;
+        TraceOutput(&rec);
+    }
+}
@@ -13,6 +13,12 @@
 
 #define FLASH_EEPROM_BASE             (CY_FLASH_NUMBER_ROWS-4)*CY_FLASH_SIZEOF_ROW
 #define FLASH_EEPROM_END              (CY_FLASH_NUMBER_ROWS-2)*CY_FLASH_SIZEOF_ROW-1
+#define FLASH_LORAWAN_SESSION_BASE    (CY_FLASH_NUMBER_ROWS-6)*CY_FLASH_SIZEOF_ROW
+// more log rows also need CY_RESERVED_ROWS (cm0plusgcc.ld) and upload.maximum_size raised
+#ifndef FLASH_LORAWAN_LOG_ROWS
+#define FLASH_LORAWAN_LOG_ROWS        16
+#endif
+#define FLASH_LORAWAN_LOG_BASE        (CY_FLASH_NUMBER_ROWS-6-FLASH_LORAWAN_LOG_ROWS)*CY_FLASH_SIZEOF_ROW
 
 #define COLOR_SEND 0x500000   //color red, light 0x10
 #define COLOR_JOINED 0x500050 //color Violet, light 0x10
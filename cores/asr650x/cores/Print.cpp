@@ -28,6 +28,7 @@
 #include "Arduino.h"
 
 #include "Print.h"
+#include <printf_port.h>
 extern "C" {
     #include "time.h"
 }
@@ -44,29 +45,47 @@ size_t Print::write(const uint8_t *buffer, size_t size)
     return n;
 }
 
+// printf() output is handed to write() in chunks of this size
+#define PRINTF_CHUNK_SIZE 32
+
+struct PrintfChunk {
+    Print *print;
+    size_t written;
+    uint8_t len;
+    char buf[PRINTF_CHUNK_SIZE];
+};
+
+static void printfFlush(PrintfChunk *chunk)
+{
+    if(chunk->len) {
+        chunk->written += chunk->print->write(chunk->buf, chunk->len);
+        chunk->len = 0;
+    }
+}
+
+static void printfOut(char c, void *arg)
+{
+    PrintfChunk *chunk = (PrintfChunk *) arg;
+
+    chunk->buf[chunk->len++] = c;
+    if(chunk->len == sizeof(chunk->buf)) {
+        printfFlush(chunk);
+    }
+}
+
 size_t Print::printf(const char *format, ...)
 {
-    char loc_buf[64];
-    char * temp = loc_buf;
+    PrintfChunk chunk;
     va_list arg;
-    va_list copy;
+
+    chunk.print = this;
+    chunk.written = 0;
+    chunk.len = 0;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if(len >= sizeof(loc_buf)){
-        temp = new char[len+1];
-        if(temp == NULL) {
-            return 0;
-        }
-    }
-    len = vsnprintf(temp, len+1, format, arg);
-    write((uint8_t*)temp, len);
+    tiny_format(printfOut, &chunk, format, arg);
     va_end(arg);
-    if(len >= sizeof(loc_buf)){
-        delete[] temp;
-    }
-    return len;
+    printfFlush(&chunk);
+    return chunk.written;
 }
 
 size_t Print::print(const __FlashStringHelper *ifsh)
@@ -244,29 +263,22 @@ size_t Print::println(struct tm * timeinfo, const char * format)
 
 size_t Print::printNumber(unsigned long n, uint8_t base)
 {
-    char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-    char *str = &buf[sizeof(buf) - 1];
-
-    *str = '\0';
+    char buf[8 * sizeof(long)]; // Assumes 8-bit chars.
+    char *end = &buf[sizeof(buf)];
 
     // prevent crash if called with base == 1
-    if(base < 2) {
+    if(base < 2 || base > 36) {
         base = 10;
     }
 
-    do {
-        unsigned long m = n;
-        n /= base;
-        char c = m - base * n;
-        *--str = c < 10 ? c + '0' : c + 'A' - 10;
-    } while(n);
-
-    return write(str);
+    char *str = ulltoa_r(n, end, base, true);
+    return write(str, end - str);
 }
 
 size_t Print::printFloat(double number, uint8_t digits)
 {
-    size_t n = 0;
+    char buf[DTOA_FIXED_BUF_SIZE];
+    size_t n;
 
     if(isnan(number)) {
         return print("nan");
@@ -281,36 +293,11 @@ size_t Print::printFloat(double number, uint8_t digits)
         return print("ovf");    // constant determined empirically
     }
 
-    // Handle negative numbers
-    if(number < 0.0) {
-        n += print('-');
-        number = -number;
-    }
-
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    double rounding = 0.5;
-    for(uint8_t i = 0; i < digits; ++i) {
-        rounding /= 10.0;
-    }
-
-    number += rounding;
-
-    // Extract the integer part of the number and print it
-    unsigned long int_part = (unsigned long) number;
-    double remainder = number - (double) int_part;
-    n += print(int_part);
-
-    // Print the decimal point, but only if there are digits beyond
-    if(digits > 0) {
-        n += print(".");
-    }
+    n = write(buf, dtoa_fixed(number, digits, buf));
 
-    // Extract digits from the remainder one at a time
-    while(digits-- > 0) {
-        remainder *= 10.0;
-        int toPrint = int(remainder);
-        n += print(toPrint);
-        remainder -= toPrint;
+    // Digits beyond the fixed point range are zeros
+    while(digits-- > DTOA_FIXED_MAX_PREC) {
+        n += print('0');
     }
 
     return n;
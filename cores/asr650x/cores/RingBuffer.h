@@ -1,111 +1,207 @@
+#ifndef RingBuffer_h
+#define RingBuffer_h
+
+#include <stddef.h>
+#include <string.h>
+
+// Orders the element accesses before the index store that hands them over,
+// the other side may be an interrupt handler.
+#define RINGBUFFER_BARRIER() __sync_synchronize()
+
+// Single producer / single consumer ring. One context writes, one reads,
+// e.g. a UART interrupt and the main loop, without locking: the producer
+// only moves _head, the consumer only moves _tail. The indices run freely
+// and are masked on access, so S must be a power of two and all S elements
+// are usable.
+//
+// A full ring drops new elements, the producer cannot take the oldest away
+// from a reader that may be using it.
 template <class T, size_t S>
 class RingBuffer {
+	static_assert(S != 0 && (S & (S - 1)) == 0, "RingBuffer size must be a power of two");
+
 public:
 	explicit RingBuffer()
 	: _buffer()
-    , _head(0)
-    , _tail(0)
-    , _full(false)
+	, _head(0)
+	, _tail(0)
 	{}
 
-	// write value to buffer.
-	inline void write(T item)
+	// producer: write value to buffer, false if it is full.
+	inline bool write(T item)
 	{
-		_buffer[_head] = item;
+		size_t head = _head;
 
-		if(_full)
+		if(head - _tail == S)
 		{
-			_tail = (_tail + 1) % S;
+			return false;
 		}
+		RINGBUFFER_BARRIER();
+		_buffer[head & (S - 1)] = item;
+		RINGBUFFER_BARRIER();
+		_head = head + 1;
+		return true;
+	}
 
-		_head = (_head + 1) % S;
+	// producer: contiguous free region at the head, fill it then commit().
+	// The region ends at the end of the storage, a second call after
+	// commit() returns the part that wrapped around.
+	inline size_t writeSpan(T *&region)
+	{
+		size_t head = _head;
+		size_t free = S - (head - _tail);
+		size_t edge = S - (head & (S - 1));
 
-		_full = _head == _tail;
+		RINGBUFFER_BARRIER();
+		region = &_buffer[head & (S - 1)];
+		return free < edge ? free : edge;
 	}
 
-	// read value from buffer with pushing it forward.
+	// producer: publish n elements filled through writeSpan().
+	inline void commit(size_t n)
+	{
+		RINGBUFFER_BARRIER();
+		_head = _head + n;
+	}
+
+	// producer: copy up to n elements in, returns how many fit.
+	size_t write(const T *items, size_t n)
+	{
+		size_t done = 0;
+		T *region;
+
+		while(done < n)
+		{
+			size_t len = writeSpan(region);
+
+			if(len == 0)
+			{
+				break;
+			}
+			if(len > n - done)
+			{
+				len = n - done;
+			}
+			memcpy(region, items + done, len * sizeof(T));
+			commit(len);
+			done += len;
+		}
+		return done;
+	}
+
+	// consumer: read value from buffer with pushing it forward.
 	inline T read()
 	{
-		if(empty())
+		size_t tail = _tail;
+
+		if(_head == tail)
 		{
 			return T();
 		}
+		RINGBUFFER_BARRIER();
+		T val = _buffer[tail & (S - 1)];
+		RINGBUFFER_BARRIER();
+		_tail = tail + 1;
+		return val;
+	}
 
-		//Read data and advance the tail (we now have a free space)
-		T val = _buffer[_tail];
-		_full = false;
-		_tail = (_tail + 1) %  S;
+	// consumer: contiguous filled region at the tail, use it then consume().
+	inline size_t readSpan(const T *&region)
+	{
+		size_t tail = _tail;
+		size_t used = _head - tail;
+		size_t edge = S - (tail & (S - 1));
 
-		return val;
+		RINGBUFFER_BARRIER();
+		region = &_buffer[tail & (S - 1)];
+		return used < edge ? used : edge;
+	}
+
+	// consumer: release n elements seen through readSpan().
+	inline void consume(size_t n)
+	{
+		RINGBUFFER_BARRIER();
+		_tail = _tail + n;
 	}
 
-	// value from buffer without pushing it forward.
-  	inline T peek() const
+	// consumer: copy up to n elements out, returns how many were there.
+	size_t read(T *items, size_t n)
 	{
-		if(empty())
+		size_t done = 0;
+		const T *region;
+
+		while(done < n)
 		{
-			return T();
+			size_t len = readSpan(region);
+
+			if(len == 0)
+			{
+				break;
+			}
+			if(len > n - done)
+			{
+				len = n - done;
+			}
+			memcpy(items + done, region, len * sizeof(T));
+			consume(len);
+			done += len;
 		}
+		return done;
+	}
+
+	// consumer: value from buffer without pushing it forward.
+	inline T peek() const
+	{
+		size_t tail = _tail;
 
-		return _buffer[_tail];
+		if(_head == tail)
+		{
+			return T();
+		}
+		RINGBUFFER_BARRIER();
+		return _buffer[tail & (S - 1)];
 	}
 
-	// reset buffer pointers so the buffer is "empty".
+	// consumer: drop everything written so far so the buffer is "empty".
 	inline void reset()
 	{
-		_head = _tail;
-		_full = false;
+		_tail = _head;
 	}
 
 	// buffer is empty.
 	inline bool empty() const
 	{
-		//if head and tail are equal, we are empty
-		return (!_full && (_head == _tail));
+		return _head == _tail;
 	}
 
-	// buffer full, next write will overwrite data and push the tail. 
+	// buffer full, next write will be dropped.
 	inline bool full() const
 	{
-		//If tail is ahead the head by 1, we are full
-		return _full;
+		return _head - _tail == S;
 	}
 
 	// max number of elements that the buffer can hold.
 	inline size_t capacity() const
 	{
-		return S; 
+		return S;
 	}
 
 	// the number of elements currently in the buffer.
 	inline size_t size() const
 	{
-		size_t size(S);
-
-		if(!_full)
-		{
-			if(_head >= _tail)
-			{
-				size = _head - _tail;
-			}
-			else
-			{
-				size = S + _head - _tail;
-			}
-		}
-
-		return size;
+		return _head - _tail;
 	}
 
 	// basically this is a indexed peek with the tail as index 0.
 	inline const T& operator[](size_t index) const
-	{ 
-		return _buffer[(_tail + index) % S];
-	} 
+	{
+		return _buffer[(_tail + index) & (S - 1)];
+	}
 
 private:
 	T _buffer[S];
-	size_t _head;
-	size_t _tail;
-	bool _full;
-};
\ No newline at end of file
+	volatile size_t _head;
+	volatile size_t _tail;
+};
+
+#endif
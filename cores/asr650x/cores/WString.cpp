@@ -70,7 +70,7 @@ String::String(unsigned char value, unsigned char base)
 {
     init();
     char buf[1 + 8 * sizeof(unsigned char)];
-    utoa(value, buf, base);
+    ultoa(value, buf, base);
     *this = buf;
 }
 
@@ -78,7 +78,7 @@ String::String(int value, unsigned char base)
 {
     init();
     char buf[2 + 8 * sizeof(int)];
-    itoa(value, buf, base);
+    ltoa(value, buf, base);
     *this = buf;
 }
 
@@ -86,7 +86,7 @@ String::String(unsigned int value, unsigned char base)
 {
     init();
     char buf[1 + 8 * sizeof(unsigned int)];
-    utoa(value, buf, base);
+    ultoa(value, buf, base);
     *this = buf;
 }
 
@@ -109,22 +109,26 @@ String::String(unsigned long value, unsigned char base)
 String::String(float value, unsigned char decimalPlaces)
 {
     init();
-    char buf[33];
-    *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+    char buf[DTOA_FIXED_BUF_SIZE];
+    if(decimalPlaces > DTOA_FIXED_MAX_PREC) {
+        decimalPlaces = DTOA_FIXED_MAX_PREC;
+    }
+    *this = dtostrnf(value, (decimalPlaces + 2), decimalPlaces, buf, sizeof(buf));
 }
 
 String::String(double value, unsigned char decimalPlaces)
 {
     init();
-    char buf[33];
-    *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+    char buf[DTOA_FIXED_BUF_SIZE];
+    if(decimalPlaces > DTOA_FIXED_MAX_PREC) {
+        decimalPlaces = DTOA_FIXED_MAX_PREC;
+    }
+    *this = dtostrnf(value, (decimalPlaces + 2), decimalPlaces, buf, sizeof(buf));
 }
 
 String::~String()
 {
-    if(buffer) {
-        free(buffer);
-    }
+    freeBuffer();
     init();
 }
 
@@ -141,10 +145,21 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-    if(buffer) {
+    freeBuffer();
+    init();
+}
+
+void String::freeBuffer(void)
+{
+    if(!buffer || isSSO()) {
+        return;
+    }
+    StringArena *arena = StringArena::owner(buffer);
+    if(arena) {
+        arena->release(buffer);
+    } else {
         free(buffer);
     }
-    init();
 }
 
 unsigned char String::reserve(unsigned int size)
@@ -163,18 +178,45 @@ unsigned char String::reserve(unsigned int size)
 
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
+    if(!buffer && maxStrLen < SSO_SIZE) {
+        memset(sso, 0, SSO_SIZE);
+        buffer = sso;
+        capacity = SSO_SIZE - 1;
+        return 1;
+    }
+
+    // Grow by half at least, a String built up by appending is moved
+    // a logarithmic rather than a linear number of times
+    unsigned int minStrLen = buffer ? capacity + (capacity >> 1) : 0;
+    if(maxStrLen < minStrLen) {
+        maxStrLen = minStrLen;
+    }
     size_t newSize = ((maxStrLen + 16) & (~0xf)) - 1;
-    char *newbuffer = (char *) realloc(buffer, newSize+1);
-    if(newbuffer) {
-        if(newSize > len){
-            if(newSize > capacity){
-                memset(newbuffer+capacity, 0, newSize-capacity);
+    size_t oldSize = buffer ? capacity + 1 : 0;
+    bool heap = buffer && !isSSO();
+    StringArena *arena = heap ? StringArena::owner(buffer) : StringArena::current;
+    char *newbuffer = NULL;
+
+    if(heap && !arena) {
+        newbuffer = (char *) realloc(buffer, newSize + 1);
+    } else {
+        if(arena) {
+            if(heap && arena->resize(buffer, newSize + 1)) {
+                newbuffer = buffer;
+            } else {
+                newbuffer = arena->allocate(newSize + 1);
             }
-        } else {
-            //new buffer can not fit the old len
-            newbuffer[newSize] = 0;
-            len = newSize;
         }
+        if(!newbuffer) {
+            newbuffer = (char *) malloc(newSize + 1);
+        }
+        if(newbuffer && newbuffer != buffer && buffer) {
+            memcpy(newbuffer, buffer, oldSize);
+            freeBuffer();
+        }
+    }
+    if(newbuffer) {
+        memset(newbuffer + oldSize, 0, newSize + 1 - oldSize);
         capacity = newSize;
         buffer = newbuffer;
         return 1;
@@ -206,22 +248,20 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length)
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void String::move(String &rhs)
 {
-    if(buffer) {
-        if(capacity >= rhs.len) {
-            strcpy(buffer, rhs.buffer);
+    if(rhs.buffer && rhs.isSSO()) {
+        if(buffer || reserve(rhs.len)) {
+            memcpy(buffer, rhs.buffer, rhs.len + 1);
             len = rhs.len;
             rhs.len = 0;
+            rhs.buffer[0] = 0;
             return;
-        } else {
-            free(buffer);
         }
     }
+    freeBuffer();
     buffer = rhs.buffer;
     capacity = rhs.capacity;
     len = rhs.len;
-    rhs.buffer = NULL;
-    rhs.capacity = 0;
-    rhs.len = 0;
+    rhs.init();
 }
 #endif
 
@@ -295,11 +335,19 @@ unsigned char String::concat(const char *cstr, unsigned int length)
     if(length == 0) {
         return 1;
     }
-    if(!reserve(newlen)) {
+    if(buffer && cstr >= buffer && cstr < buffer + len) {
+        // appending a part of itself, the buffer may move
+        unsigned int offset = cstr - buffer;
+        if(!reserve(newlen)) {
+            return 0;
+        }
+        cstr = buffer + offset;
+    } else if(!reserve(newlen)) {
         return 0;
     }
-    strcpy(buffer + len, cstr);
+    memmove(buffer + len, cstr, length);
     len = newlen;
+    buffer[len] = 0;
     return 1;
 }
 
@@ -322,21 +370,21 @@ unsigned char String::concat(char c)
 unsigned char String::concat(unsigned char num)
 {
     char buf[1 + 3 * sizeof(unsigned char)];
-    itoa(num, buf, 10);
+    ltoa(num, buf, 10);
     return concat(buf, strlen(buf));
 }
 
 unsigned char String::concat(int num)
 {
     char buf[2 + 3 * sizeof(int)];
-    itoa(num, buf, 10);
+    ltoa(num, buf, 10);
     return concat(buf, strlen(buf));
 }
 
 unsigned char String::concat(unsigned int num)
 {
     char buf[1 + 3 * sizeof(unsigned int)];
-    utoa(num, buf, 10);
+    ultoa(num, buf, 10);
     return concat(buf, strlen(buf));
 }
 
@@ -356,15 +404,15 @@ unsigned char String::concat(unsigned long num)
 
 unsigned char String::concat(float num)
 {
-    char buf[20];
-    char* string = dtostrf(num, 4, 2, buf);
+    char buf[DTOA_FIXED_BUF_SIZE];
+    char* string = dtostrnf(num, 4, 2, buf, sizeof(buf));
     return concat(string, strlen(string));
 }
 
 unsigned char String::concat(double num)
 {
-    char buf[20];
-    char* string = dtostrf(num, 4, 2, buf);
+    char buf[DTOA_FIXED_BUF_SIZE];
+    char* string = dtostrnf(num, 4, 2, buf, sizeof(buf));
     return concat(string, strlen(string));
 }
 
@@ -815,7 +863,7 @@ void String::remove(unsigned int index, unsigned int count)
     }
     char *writeTo = buffer + index;
     len = len - count;
-    strncpy(writeTo, buffer + index + count, len - index);
+    memmove(writeTo, buffer + index + count, len - index);
     buffer[len] = 0;
 }
 
@@ -912,3 +960,90 @@ unsigned char String::equalsConstantTime(const String &s2) const {
     unsigned char diffcond = (diffchars == 0);
     return (equalcond & diffcond); //bitwise AND
 }
+
+// /*********************************************/
+// /*  Arena                                    */
+// /*********************************************/
+
+// Every buffer is preceded by its size, the top buffer can then be grown
+// in place or given back.
+typedef size_t StringArenaHeader;
+
+StringArena *StringArena::arenas = NULL;
+StringArena *StringArena::current = NULL;
+
+StringArena::StringArena(void *block, size_t size)
+{
+    // buffers are aligned to the header
+    size_t skip = (sizeof(StringArenaHeader) - ((uintptr_t) block % sizeof(StringArenaHeader))) % sizeof(StringArenaHeader);
+
+    this->block = (char *) block + skip;
+    limit = (size > skip) ? size - skip : 0;
+    top = 0;
+    live = 0;
+    next = arenas;
+    arenas = this;
+}
+
+StringArena::~StringArena(void)
+{
+    for(StringArena **p = &arenas; *p; p = &(*p)->next) {
+        if(*p == this) {
+            *p = next;
+            break;
+        }
+    }
+    if(current == this) {
+        current = NULL;
+    }
+}
+
+char *StringArena::allocate(size_t size)
+{
+    size = (size + sizeof(StringArenaHeader) - 1) & ~(sizeof(StringArenaHeader) - 1);
+    if(limit - top < size + sizeof(StringArenaHeader)) {
+        return NULL;
+    }
+    StringArenaHeader *header = (StringArenaHeader *) (block + top);
+    *header = size;
+    top += size + sizeof(StringArenaHeader);
+    live++;
+    return (char *) (header + 1);
+}
+
+bool StringArena::resize(char *p, size_t size)
+{
+    StringArenaHeader *header = (StringArenaHeader *) p - 1;
+
+    size = (size + sizeof(StringArenaHeader) - 1) & ~(sizeof(StringArenaHeader) - 1);
+    if(size <= *header) {
+        return true;
+    }
+    if(p + *header != block + top || (size_t) (p - block) + size > limit) {
+        return false;
+    }
+    top = (p - block) + size;
+    *header = size;
+    return true;
+}
+
+void StringArena::release(char *p)
+{
+    StringArenaHeader *header = (StringArenaHeader *) p - 1;
+
+    if(--live == 0) {
+        top = 0;
+    } else if(p + *header == block + top) {
+        top = (char *) header - block;
+    }
+}
+
+StringArena *StringArena::owner(const char *p)
+{
+    for(StringArena *arena = arenas; arena; arena = arena->next) {
+        if(p >= arena->block && p < arena->block + arena->limit) {
+            return arena;
+        }
+    }
+    return NULL;
+}
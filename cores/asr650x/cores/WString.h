@@ -23,6 +23,7 @@
 #define String_class_h
 #ifdef __cplusplus
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -263,12 +264,21 @@ public:
     double toDouble(void) const;
 
 protected:
-    char *buffer;	        // the actual char array
+    // strings up to SSO_SIZE - 1 chars are kept in the object itself
+    enum { SSO_SIZE = 16 };
+
+    char *buffer;	        // the actual char array, sso or a heap/arena block
     unsigned int capacity;  // the array length minus one (for the '\0')
     unsigned int len;       // the String length (not counting the '\0')
+    char sso[SSO_SIZE];     // inline storage of short strings
 protected:
     void init(void);
     void invalidate(void);
+    inline bool isSSO(void) const
+    {
+        return buffer == sso;
+    }
+    void freeBuffer(void);
     unsigned char changeBuffer(unsigned int maxStrLen);
     unsigned char concat(const char *cstr, unsigned int length);
 
@@ -325,5 +335,69 @@ public:
     }
 };
 
+// A block of memory String buffers can be taken from instead of the heap.
+// Strings that are created and dropped over and over, e.g. while parsing
+// NMEA sentences, then no longer fragment the heap: the arena is a stack,
+// a buffer released at the top gives its space back right away and the
+// whole arena is empty again once its last String is gone.
+//
+// The arena is used by the Strings that grow while a StringArenaScope on
+// it is alive. A String that outlives the scope keeps its buffer in the
+// arena, so the block and the StringArena must outlive every such String
+// (make them static). When the arena is full, Strings use the heap.
+class StringArena
+{
+public:
+    StringArena(void *block, size_t size);
+    ~StringArena(void);
+
+    // bytes in use, the arena is empty when this is 0
+    size_t used(void) const
+    {
+        return top;
+    }
+    size_t size(void) const
+    {
+        return limit;
+    }
+
+private:
+    friend class String;
+    friend class StringArenaScope;
+
+    char *allocate(size_t size);
+    bool resize(char *p, size_t size);
+    void release(char *p);
+    static StringArena *owner(const char *p);
+
+    char *block;
+    size_t limit;
+    size_t top;
+    unsigned int live;
+    StringArena *next;
+
+    static StringArena *arenas;  // all arenas, to find the owner of a buffer
+    static StringArena *current; // arena of the innermost scope
+};
+
+// Makes Strings grow into arena while the scope object is alive, scopes
+// nest.
+class StringArenaScope
+{
+public:
+    explicit StringArenaScope(StringArena &arena) :
+        previous(StringArena::current)
+    {
+        StringArena::current = &arena;
+    }
+    ~StringArenaScope(void)
+    {
+        StringArena::current = previous;
+    }
+
+private:
+    StringArena *previous;
+};
+
 #endif  // __cplusplus
 #endif  // String_class_h
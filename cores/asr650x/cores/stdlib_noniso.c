@@ -26,6 +26,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <limits.h>
 #include <math.h>
 #include "stdlib_noniso.h"
 
@@ -41,121 +42,344 @@ void reverse(char* begin, char* end) {
     }
 }
 
-char* ltoa(long value, char* result, int base) {
-    if(base < 2 || base > 16) {
-        *result = 0;
-        return result;
-    }
+static const char digitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
 
-    char* out = result;
-    long quotient = abs(value);
+/* Integer digits of DBL_MAX */
+#define DTOA_BIG_DIGITS 309
 
-    do {
-        const long tmp = quotient / base;
-        *out = "0123456789abcdef"[quotient - (tmp * base)];
-        ++out;
-        quotient = tmp;
-    } while(quotient);
+static const uint64_t pow10_64[DTOA_FIXED_MAX_PREC + 1] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+    100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
 
-    // Apply negative sign
-    if(value < 0)
-        *out++ = '-';
+// n / 10 by multiplying with the reciprocal 0.1 in shifts and adds, the
+// estimate is at most one too small. The Cortex-M0+ has no divide
+// instruction, a division is a library call of up to a few hundred cycles.
+static inline uint32_t divu10(uint32_t n) {
+    uint32_t q = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+    return q + ((n - (q << 3) - (q << 1)) > 9);
+}
 
-    reverse(result, out);
-    *out = 0;
-    return result;
+static inline uint64_t divu10_64(uint64_t n) {
+    uint64_t q = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q += q >> 32;
+    q >>= 3;
+    return q + ((n - (q << 3) - (q << 1)) > 9);
 }
 
-char* ultoa(unsigned long value, char* result, int base) {
-    if(base < 2 || base > 16) {
-        *result = 0;
-        return result;
+// two digits per step, below 43699 n / 100 is (n * 5243) >> 19
+static char* u32toa_dec(uint32_t value, char* end) {
+    const char *pair;
+
+    while(value >= 100) {
+        uint32_t q = (value < 43699) ? (value * 5243) >> 19 : divu10(divu10(value));
+        pair = &digitPairs[(value - q * 100) * 2];
+        *--end = pair[1];
+        *--end = pair[0];
+        value = q;
+    }
+    if(value >= 10) {
+        pair = &digitPairs[value * 2];
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = (char)('0' + value);
     }
+    return end;
+}
 
-    char* out = result;
-    unsigned long quotient = value;
+char* ulltoa_r(unsigned long long value, char* end, int base, bool upper) {
+    const char *digits = upper ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" : "0123456789abcdefghijklmnopqrstuvwxyz";
 
+    if(base == 10) {
+        while(value >> 32) {
+            unsigned long long q = divu10_64(value);
+            *--end = (char)('0' + (value - (q << 3) - (q << 1)));
+            value = q;
+        }
+        return u32toa_dec((uint32_t)value, end);
+    }
+    if((base & (base - 1)) == 0) {
+        int shift = 0;
+        while((1 << shift) < base) {
+            shift++;
+        }
+        while(value >> 32) {
+            *--end = digits[value & (base - 1)];
+            value >>= shift;
+        }
+        uint32_t v = (uint32_t)value;
+        do {
+            *--end = digits[v & (base - 1)];
+            v >>= shift;
+        } while(v);
+        return end;
+    }
     do {
-        const unsigned long tmp = quotient / base;
-        *out = "0123456789abcdef"[quotient - (tmp * base)];
-        ++out;
-        quotient = tmp;
-    } while(quotient);
+        unsigned long long q = value / base;
+        *--end = digits[value - q * base];
+        value = q;
+    } while(value);
+    return end;
+}
+
+/*
+ * Exact digits of an integer from 2^64 up to DBL_MAX written backwards,
+ * ending just before end. The mantissa is shifted into 32 bit limbs that
+ * are divided down by 10^9. Kept out of dtoa_r, whose stack frame would
+ * otherwise carry the limbs on every call.
+ */
+static char* __attribute__((noinline)) dtoa_big(double number, char* end) {
+    uint32_t limbs[33];
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    uint64_t mantissa = (bits & 0xFFFFFFFFFFFFFull) | (1ull << 52);
+    int shift = (int)((bits >> 52) & 0x7FF) - 1075;
+    int n = shift / 32 + 3;
+
+    memset(limbs, 0, sizeof(limbs));
+    limbs[shift / 32] = (uint32_t)(mantissa << (shift % 32));
+    limbs[shift / 32 + 1] = (uint32_t)((mantissa << (shift % 32)) >> 32);
+    if(shift % 32 != 0) {
+        limbs[shift / 32 + 2] = (uint32_t)(mantissa >> (64 - shift % 32));
+    }
+    while(n > 0) {
+        uint32_t rem = 0;
+        for(int i = n - 1; i >= 0; i--) {
+            uint64_t cur = ((uint64_t)rem << 32) | limbs[i];
+            limbs[i] = (uint32_t)(cur / 1000000000u);
+            rem = (uint32_t)(cur - (uint64_t)limbs[i] * 1000000000u);
+        }
+        while(n > 0 && limbs[n - 1] == 0) {
+            n--;
+        }
+        char* chunk = u32toa_dec(rem, end);
+        if(n > 0) {
+            while(chunk > end - 9) {
+                *--chunk = '0';
+            }
+        }
+        end = chunk;
+    }
+    return end;
+}
+
+/*
+ * fraction / 2^k times scale, rounded half up, for fraction < 2^k. The
+ * product takes up to 117 bits, it is built from 32 bit halves and shifted
+ * down, so every digit is exact.
+ */
+static uint64_t dtoa_frac(uint64_t fraction, int k, uint64_t scale) {
+    if(k > 117) {
+        return 0;
+    }
+    uint64_t fl = (uint32_t)fraction, fh = fraction >> 32;
+    uint64_t sl = (uint32_t)scale, sh = scale >> 32;
+    uint64_t lo = fl * sl;
+    uint64_t mid1 = fl * sh;
+    uint64_t mid2 = fh * sl;
+    uint64_t mid = (lo >> 32) + (uint32_t)mid1 + (uint32_t)mid2;
+    uint64_t hi = fh * sh + (mid1 >> 32) + (mid2 >> 32) + (mid >> 32);
+    lo = (mid << 32) | (uint32_t)lo;
+
+    if(k < 64) {
+        return ((hi << (64 - k)) | (lo >> k)) + ((lo >> (k - 1)) & 1);
+    }
+    if(k == 64) {
+        return hi + (lo >> 63);
+    }
+    return (hi >> (k - 64)) + ((hi >> (k - 65)) & 1);
+}
 
-    reverse(result, out);
+/*
+ * dtoa_r from 2^64 on, where a double has no fraction left. The digit
+ * buffer lives here and not in dtoa_r, so only these rare calls pay for it.
+ */
+static int __attribute__((noinline)) dtoa_r_big(double number, unsigned char prec, char* s, char* out, int size) {
+    char buf[DTOA_BIG_DIGITS];
+    char* end = buf + sizeof(buf);
+    char* digits = dtoa_big(number, end);
+    if((out - s) + (end - digits) + (prec ? 1 + prec : 0) > size) {
+        strcpy(out, "ovf");
+        return out - s + 3;
+    }
+    memcpy(out, digits, end - digits);
+    out += end - digits;
+    if(prec > 0) {
+        *out++ = '.';
+        memset(out, '0', prec);
+        out += prec;
+    }
     *out = 0;
-    return result;
+    return out - s;
 }
 
-char * dtostrf(double number, signed char width, unsigned char prec, char *s) {
-    bool negative = false;
+/*
+ * dtoa_fixed writing at most size characters before the terminator, "ovf"
+ * when the digits do not fit.
+ */
+static int dtoa_r(double number, unsigned char prec, char* s, int size) {
+    char* out = s;
 
-    if (isnan(number)) {
+    if(isnan(number)) {
         strcpy(s, "nan");
-        return s;
+        return 3;
+    }
+    if(number < 0.0) {
+        *out++ = '-';
+        number = -number;
+    }
+    if(isinf(number)) {
+        strcpy(out, "inf");
+        return out - s + 3;
+    }
+    if(prec > DTOA_FIXED_MAX_PREC) {
+        prec = DTOA_FIXED_MAX_PREC;
     }
-    if (isinf(number)) {
-        strcpy(s, "inf");
-        return s;
+    if(number >= 18446744073709551616.0) {
+        return dtoa_r_big(number, prec, s, out, size);
     }
 
-    char* out = s;
+    // Integer and fraction part straight from the bits, number is
+    // mantissa * 2^-k. The fraction is rounded half up at the last digit
+    // so that 1.999 with 2 digits prints as "2.00".
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    int exponent = (int)((bits >> 52) & 0x7FF);
+    uint64_t mantissa = bits & 0xFFFFFFFFFFFFFull;
+    int k = 1074;
+    if(exponent != 0) {
+        mantissa |= 1ull << 52;
+        k = 1075 - exponent;
+    }
+    uint64_t int_part;
+    uint64_t scale = pow10_64[prec];
+    uint64_t frac = 0;
+    if(k <= 0) {
+        int_part = mantissa << -k;
+    } else {
+        int_part = (k < 64) ? mantissa >> k : 0;
+        frac = dtoa_frac((k < 64) ? mantissa & ((1ull << k) - 1) : mantissa, k, scale);
+        if(frac >= scale) {
+            frac -= scale;
+            int_part++;
+        }
+    }
 
-    int fillme = width; // how many cells to fill for the integer part
-    if (prec > 0) {
-        fillme -= (prec+1);
+    char buf[20];
+    char* end = buf + sizeof(buf);
+    char* digits = ulltoa_r(int_part, end, 10, false);
+    memcpy(out, digits, end - digits);
+    out += end - digits;
+    if(prec > 0) {
+        *out++ = '.';
+        digits = ulltoa_r(frac, end, 10, false);
+        memset(out, '0', prec - (end - digits));
+        out += prec - (end - digits);
+        memcpy(out, digits, end - digits);
+        out += end - digits;
     }
+    *out = 0;
+    return out - s;
+}
 
-    // Handle negative numbers
-    if (number < 0.0) {
-        negative = true;
-        fillme--;
-        number = -number;
+int dtoa_fixed(double number, unsigned char prec, char* s) {
+    return dtoa_r(number, prec, s, DTOA_FIXED_BUF_SIZE - 1);
+}
+
+char* ltoa(long value, char* result, int base) {
+    if(base < 2 || base > 36) {
+        *result = 0;
+        return result;
     }
 
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    // I optimized out most of the divisions
-    double rounding = 2.0;
-    for (uint8_t i = 0; i < prec; ++i)
-        rounding *= 10.0;
-    rounding = 1.0 / rounding;
+    char buf[8 * sizeof(long)];
+    char* end = buf + sizeof(buf);
+    unsigned long quotient = (value < 0) ? 0ul - (unsigned long)value : (unsigned long)value;
+    char* digits = ulltoa_r(quotient, end, base, false);
+    char* out = result;
 
-    number += rounding;
+    // Apply negative sign
+    if(value < 0)
+        *out++ = '-';
+
+    memcpy(out, digits, end - digits);
+    out[end - digits] = 0;
+    return result;
+}
 
-    // Figure out how big our number really is
-    double tenpow = 1.0;
-    int digitcount = 1;
-    while (number >= 10.0 * tenpow) {
-        tenpow *= 10.0;
-        digitcount++;
+char* ultoa(unsigned long value, char* result, int base) {
+    if(base < 2 || base > 36) {
+        *result = 0;
+        return result;
     }
 
-    number /= tenpow;
-    fillme -= digitcount;
+    char buf[8 * sizeof(long)];
+    char* end = buf + sizeof(buf);
+    char* digits = ulltoa_r(value, end, base, false);
+
+    memcpy(result, digits, end - digits);
+    result[end - digits] = 0;
+    return result;
+}
 
+/*
+ * dtostrf writing at most size characters before the terminator
+ */
+static char* dtostrf_r(double number, signed char width, unsigned char prec, char *s, int size) {
+    unsigned char extra = (prec > DTOA_FIXED_MAX_PREC) ? prec - DTOA_FIXED_MAX_PREC : 0;
+    int len = dtoa_r(number, prec - extra, s, size - extra);
+    int fillme = width - len - extra;
+    char* out = s + len;
+
+    if(fillme > size - len - extra) {
+        fillme = size - len - extra;
+    }
     // Pad unused cells with spaces
-    while (fillme-- > 0) {
-        *out++ = ' ';
-    }
-
-    // Handle negative sign
-    if (negative) *out++ = '-';
-
-    // Print the digits, and if necessary, the decimal point
-    digitcount += prec;
-    int8_t digit = 0;
-    while (digitcount-- > 0) {
-        digit = (int8_t)number;
-        if (digit > 9) digit = 9; // insurance
-        *out++ = (char)('0' | digit);
-        if ((digitcount == prec) && (prec > 0)) {
-            *out++ = '.';
-        }
-        number -= digit;
-        number *= 10.0;
+    if(fillme > 0) {
+        memmove(s + fillme, s, len);
+        memset(s, ' ', fillme);
+        out += fillme;
+    }
+
+    // Digits beyond the fixed point range are zeros
+    while(extra--) {
+        *out++ = '0';
     }
 
     // make sure the string is terminated
     *out = 0;
     return s;
 }
+
+char * dtostrf(double number, signed char width, unsigned char prec, char *s) {
+    // The caller sizes s, every double prints in digits
+    return dtostrf_r(number, width, prec, s, INT_MAX);
+}
+
+char * dtostrnf(double number, signed char width, unsigned char prec, char *s, size_t size) {
+    if(prec > DTOA_FIXED_MAX_PREC) {
+        prec = DTOA_FIXED_MAX_PREC;
+    }
+    return dtostrf_r(number, width, prec, s, (int)size - 1);
+}
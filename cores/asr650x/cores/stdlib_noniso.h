@@ -21,6 +21,9 @@
 #ifndef STDLIB_NONISO_H
 #define STDLIB_NONISO_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -41,6 +44,35 @@ char* ultoa (unsigned long val, char *s, int radix);
 
 char* dtostrf (double val, signed char width, unsigned char prec, char *s);
 
+/*
+ * dtostrf into a buffer of size bytes, at least DTOA_FIXED_BUF_SIZE. prec
+ * is clamped to DTOA_FIXED_MAX_PREC and values whose digits do not fit
+ * print "ovf", see dtoa_fixed.
+ */
+char* dtostrnf (double val, signed char width, unsigned char prec, char *s, size_t size);
+
+/*
+ * Digits of val in base 2..36 written backwards, ending just before end.
+ * Returns the first digit, the string is not terminated. Base 10 and the
+ * powers of two are converted without division.
+ */
+char* ulltoa_r (unsigned long long val, char *end, int base, bool upper);
+
+/* Fraction digits dtoa_fixed can produce, further digits are zeros. */
+#define DTOA_FIXED_MAX_PREC 19
+
+/* Sign, the 39 integer digits of FLT_MAX, point, fraction and terminator. */
+#define DTOA_FIXED_BUF_SIZE (DTOA_FIXED_MAX_PREC + 42)
+
+/*
+ * val rounded half up to prec fraction digits in fixed point, "nan" or
+ * "inf". The integer and fraction part are taken from the bits as 64 bit
+ * integers without floating point arithmetic, every digit is exact.
+ * Values whose digits do not fit DTOA_FIXED_BUF_SIZE print "ovf", every
+ * float fits; dtostrf prints any double in digits. Returns the length.
+ */
+int dtoa_fixed (double val, unsigned char prec, char *s);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -271,7 +271,8 @@ void SX126xSetTx(uint32_t timeout)
     buf[0] = (uint8_t)((timeout >> 16) & 0xFF);
     buf[1] = (uint8_t)((timeout >> 8) & 0xFF);
     buf[2] = (uint8_t)(timeout & 0xFF);
-    SX126xWriteCommand(RADIO_SET_TX, buf, 3);
+    // The MCU goes on while the radio ramps up, the next access waits on BUSY
+    SX126xWriteCommandNoWait(RADIO_SET_TX, buf, 3);
 }
 
 void SX126xSetRx(uint32_t timeout)
@@ -283,7 +284,7 @@ void SX126xSetRx(uint32_t timeout)
     buf[0] = (uint8_t)((timeout >> 16) & 0xFF);
     buf[1] = (uint8_t)((timeout >> 8) & 0xFF);
     buf[2] = (uint8_t)(timeout & 0xFF);
-    SX126xWriteCommand(RADIO_SET_RX, buf, 3);
+    SX126xWriteCommandNoWait(RADIO_SET_RX, buf, 3);
 }
 
 void SX126xSetRxBoosted(uint32_t timeout)
@@ -297,7 +298,7 @@ void SX126xSetRxBoosted(uint32_t timeout)
     buf[0] = (uint8_t)((timeout >> 16) & 0xFF);
     buf[1] = (uint8_t)((timeout >> 8) & 0xFF);
     buf[2] = (uint8_t)(timeout & 0xFF);
-    SX126xWriteCommand(RADIO_SET_RX, buf, 3);
+    SX126xWriteCommandNoWait(RADIO_SET_RX, buf, 3);
 }
 
 void SX126xSetRxDutyCycle(uint32_t rxTime, uint32_t sleepTime)
@@ -316,7 +317,7 @@ void SX126xSetRxDutyCycle(uint32_t rxTime, uint32_t sleepTime)
 
 void SX126xSetCad(void)
 {
-    SX126xWriteCommand(RADIO_SET_CAD, 0, 0);
+    SX126xWriteCommandNoWait(RADIO_SET_CAD, 0, 0);
     OperatingMode = MODE_CAD;
 }
 
@@ -59,17 +59,237 @@ Maintainer: Miguel Luis and Gregory Cristian
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
 #include "hw.h"
 #include "timeServer.h"
+#include "delay.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Shorter waits spin, the timer server works in whole RTC ticks */
+#ifndef DELAY_SLEEP_MIN_MS
+#define DELAY_SLEEP_MIN_MS 2
+#endif
+
+/* Once allowed, longer waits may use deep sleep, shorter ones do not
+ * amortize the clock restart and stay in CPU sleep */
+#ifndef DELAY_DEEP_SLEEP_MIN_MS
+#define DELAY_DEEP_SLEEP_MIN_MS 20
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+extern bool wakeByUart;
+extern uint32_t systime;
+
+static bool DelayTimerReady = false;
+static bool DelayDeepSleepAllowed = false;
+static TimerEvent_t DelayTimer;
+static volatile bool DelayTimerFired;
+
+#if DELAY_STATS_SITES > 0
+static DelaySiteStats_t DelayStats[DELAY_STATS_SITES];
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+static void OnDelayTimer( void )
+{
+    DelayTimerFired = true;
+}
+
+/* delays run in the main loop and in interrupt handlers alike */
+static void DelayAccount( uint32_t site, uint32_t busyMs, uint32_t sleepMs )
+{
+#if DELAY_STATS_SITES > 0
+    uint8_t state;
+    uint8_t i;
+
+    state = CyEnterCriticalSection( );
+    /* the last slot collects every site that did not get one */
+    for( i = 0; i < DELAY_STATS_SITES - 1; i++ )
+    {
+        if( DelayStats[i].Site == site || DelayStats[i].Site == 0 )
+        {
+            break;
+        }
+    }
+    if( i == DELAY_STATS_SITES - 1 )
+    {
+        site = 0;
+    }
+    DelayStats[i].Site = site;
+    DelayStats[i].Calls++;
+    DelayStats[i].BusyMs += busyMs;
+    DelayStats[i].SleepMs += sleepMs;
+    CyExitCriticalSection( state );
+#endif
+}
+
+/* Sleeping needs the timer interrupt to get through */
+static bool DelayCanSleep( void )
+{
+    return DelayTimerReady && ( __get_IPSR( ) == 0 ) && ( __get_PRIMASK( ) == 0 );
+}
+
+/* Deep sleep stops the high frequency clock and with it UART reception,
+ * PWM, SysTick and the SCB blocks. Only the application knows whether those
+ * are in use, so it has to opt in; the UART checks below only keep a
+ * transmission or expected console input from being cut off. */
+static bool DelayCanDeepSleep( uint32_t ms )
+{
+    if( ( DelayDeepSleepAllowed == false ) || ( wakeByUart == true ) || ( ms < DELAY_DEEP_SLEEP_MIN_MS ) )
+    {
+        return false;
+    }
+    if( UART_1_initVar && ( ( UART_1_SpiUartGetTxBufferSize( ) != 0 ) || ( UART_1_GET_TX_FIFO_SR_VALID != 0 ) ) )
+    {
+        return false;
+    }
+    if( UART_2_initVar && ( ( UART_2_SpiUartGetTxBufferSize( ) != 0 ) || ( UART_2_GET_TX_FIFO_SR_VALID != 0 ) ) )
+    {
+        return false;
+    }
+    return true;
+}
+
+static void DelaySleep( uint32_t ms, uint32_t site )
+{
+    TimerTime_t start;
+    TimerTime_t elapsed;
+    bool deepSleep;
+
+    if( ms == 0 )
+    {
+        return;
+    }
+    if( ( ms < DELAY_SLEEP_MIN_MS ) || ( DelayCanSleep( ) == false ) )
+    {
+        CyDelay( ms );
+        DelayAccount( site, ms, 0 );
+        return;
+    }
+
+    deepSleep = DelayCanDeepSleep( ms );
+    start = TimerGetCurrentTime( );
+    DelayTimerFired = false;
+    TimerSetValue( &DelayTimer, ms );
+    TimerStart( &DelayTimer );
+
+    /* any other interrupt wakes the CPU too, go back to sleep until ours fired */
+    while( DelayTimerFired == false )
+    {
+        if( deepSleep == true )
+        {
+            CySysPmDeepSleep( );
+            systime = ( uint32_t )RtcGetTimerValue( );
+        }
+        else
+        {
+            CySysPmSleep( );
+        }
+    }
+
+    /* the one-shot may expire on the tick boundary before the full time */
+    elapsed = TimerGetElapsedTime( start );
+    if( elapsed < ms )
+    {
+        CyDelay( ms - elapsed );
+        DelayAccount( site, ms - elapsed, elapsed );
+    }
+    else
+    {
+        DelayAccount( site, 0, elapsed );
+    }
+}
+
+/* Exported functions --------------------------------------------------------*/
+void DelayInit( void )
+{
+    TimerInit( &DelayTimer, OnDelayTimer );
+    DelayTimerReady = true;
+}
+
+void DelaySetDeepSleep( bool allowed )
+{
+    DelayDeepSleepAllowed = allowed;
+}
 
 void DelayMs( uint32_t ms )
 {
-    CyDelay(ms);
+    DelaySleep( ms, ( uint32_t )__builtin_return_address( 0 ) );
 }
 
 void Delay( float s )
 {
-    DelayMs( (uint32_t) (s * 1000.0f) );
+    if( s < 0.001f )
+    {
+        CyDelayUs( ( uint16_t )( s * 1000000.0f ) );
+        return;
+    }
+    DelaySleep( ( uint32_t )( s * 1000.0f ), ( uint32_t )__builtin_return_address( 0 ) );
+}
+
+/* Arduino delay() lives in the core library and spins on CyDelay, the link
+ * step redirects it here with --wrap=delay */
+void __wrap_delay( uint32_t ms )
+{
+    DelaySleep( ms, ( uint32_t )__builtin_return_address( 0 ) );
+}
+
+uint8_t DelayStatsGet( DelaySiteStats_t *stats, uint8_t max )
+{
+    uint8_t n = 0;
+#if DELAY_STATS_SITES > 0
+    uint8_t state;
+    uint8_t i;
+
+    state = CyEnterCriticalSection( );
+    for( i = 0; ( i < DELAY_STATS_SITES ) && ( n < max ); i++ )
+    {
+        if( DelayStats[i].Calls != 0 )
+        {
+            stats[n++] = DelayStats[i];
+        }
+    }
+    CyExitCriticalSection( state );
+#endif
+    return n;
+}
+
+void DelayStatsReset( void )
+{
+#if DELAY_STATS_SITES > 0
+    uint8_t state;
+
+    state = CyEnterCriticalSection( );
+    memset( DelayStats, 0, sizeof( DelayStats ) );
+    CyExitCriticalSection( state );
+#endif
+}
+
+void DelayStatsPrint( void )
+{
+#if DELAY_STATS_SITES > 0
+    DelaySiteStats_t stats[DELAY_STATS_SITES];
+    uint8_t n;
+    uint8_t i;
+
+    /* print a copy, the counters may move while printf runs */
+    n = DelayStatsGet( stats, DELAY_STATS_SITES );
+    printf( "delay site  calls  busy ms  sleep ms\r\n" );
+    for( i = 0; i < n; i++ )
+    {
+        if( stats[i].Site == 0 )
+        {
+            printf( "other       " );
+        }
+        else
+        {
+            printf( "0x%08x  ", ( unsigned int )stats[i].Site );
+        }
+        printf( "%5u  %7u  %8u\r\n", ( unsigned int )stats[i].Calls, ( unsigned int )stats[i].BusyMs,
+                ( unsigned int )stats[i].SleepMs );
+    }
+#endif
 }
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
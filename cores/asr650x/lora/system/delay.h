@@ -19,6 +19,49 @@ Maintainer: Miguel Luis and Gregory Cristian
 #ifndef __DELAY_H__
 #define __DELAY_H__
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * Number of call sites tracked by the delay statistics, 0 disables them.
+ * The last slot collects the sites that did not get one of their own.
+ */
+#ifndef DELAY_STATS_SITES
+#define DELAY_STATS_SITES 8
+#endif
+
+/*!
+ * Time spent waiting by one caller
+ */
+typedef struct sDelaySiteStats
+{
+    uint32_t Site;    //! Return address of the call, 0 for the overflow slot
+    uint32_t Calls;
+    uint32_t BusyMs;  //! Time spent spinning
+    uint32_t SleepMs; //! Time spent in CPU sleep or deep sleep
+}DelaySiteStats_t;
+
+/*!
+ * Arms the timer server one-shot used by the sleeping delays. Until this is
+ * called, from boardInitMcu once the RTC runs, every delay spins.
+ */
+void DelayInit( void );
+
+/*!
+ * Allows or forbids deep sleep for long delays, forbidden by default.
+ *
+ * Deep sleep stops the high frequency clock: UART reception, PWM outputs,
+ * I2C/SPI transfers and micros() stop with it. Only allow it when none of
+ * those need to run during a delay. It is skipped anyway while a UART is
+ * transmitting or wakeByUart is set.
+ */
+void DelaySetDeepSleep( bool allowed );
+
 /*! 
  * Blocking delay of "s" seconds
  */
@@ -26,8 +69,32 @@ void Delay( float s );
 
 /*! 
  * Blocking delay of "ms" milliseconds
+ *
+ * Sleeps until a timer server alarm fires: CPU sleep, or deep sleep from
+ * DELAY_DEEP_SLEEP_MIN_MS on if DelaySetDeepSleep allowed it. Spins when
+ * called with interrupts masked, from an interrupt handler or for less than
+ * DELAY_SLEEP_MIN_MS.
  */
 void DelayMs( uint32_t ms );
 
+/*!
+ * Copies the statistics of the call sites seen so far
+ *
+ * \retval Number of entries written
+ */
+uint8_t DelayStatsGet( DelaySiteStats_t *stats, uint8_t max );
+
+void DelayStatsReset( void );
+
+/*!
+ * Prints the statistics on the console, resolve the sites with
+ * arm-none-eabi-addr2line -e <sketch>.elf <site>
+ */
+void DelayStatsPrint( void );
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // __DELAY_H__
 
@@ -71,6 +71,10 @@ void TimerLowPowerHandler(bool *wokeUp)
 void lowPowerHandler(void)
 {
     bool wdtState; // keep track of whether the watchdog was enabled.
+#if LoRaWAN_DEBUG_LEVEL == 3
+    // format deferred trace records while the console is still up
+    TraceFlush();
+#endif
     if (wakeByUart == false)
     {
         pinMode(P4_1, ANALOG); // SPI0  MISO;
@@ -28,7 +28,7 @@ int FLASH_update(uint32_t dst_addr, const void *data, uint32_t size)
     uint8_t * src_addr = (uint8_t *) data;
     uint32 status;
    // printf("dst_addr:%d,size:%d\r\n",dst_addr,size);
-	if(dst_addr+size>=CY_SFLASH_USERBASE+256*3)
+	if(dst_addr+size>CY_SFLASH_USERBASE+256*3)
 	{
 		printf("flash addr error.\r\n");
 		return -1;
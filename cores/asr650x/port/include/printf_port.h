@@ -0,0 +1,28 @@
+#ifndef __PRINTF_PORT_H
+#define __PRINTF_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+
+/* Receives the formatted output one character at a time. */
+typedef void (*printf_out_t)(char c, void *arg);
+
+/*
+ * Formats in a single pass straight into out, without a buffer of its own
+ * and without heap. This is the formatter behind printf, sprintf and
+ * snprintf; it returns the number of characters produced.
+ *
+ * Flags "-0+ #", width and precision (also "*"), the length modifiers
+ * hh h l ll j z t and the conversions d i u o x X f F c s p n % are
+ * supported. %f is fixed point through dtoa_fixed, rounded half up.
+ */
+int tiny_format(printf_out_t out, void *arg, const char *format, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,204 +1,328 @@
-
-
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <project.h>
 #include <uart_port.h>
+#include <printf_port.h>
+#include <stdlib_noniso.h>
 #include <stdio.h>
 
-static int tiny_print( char **out, const char *format, va_list args, unsigned int buflen );
+#define FMT_LEFT	0x01
+#define FMT_ZERO	0x02
+#define FMT_PLUS	0x04
+#define FMT_SPACE	0x08
+#define FMT_ALT		0x10
+#define FMT_UPPER	0x20
+#define FMT_PREC	0x40
+
+/* the following should be enough for a 64 bit int in octal */
+#define PRINT_BUF_LEN_ll 22
 
-static void printchar(char **str, int c, char *buflimit)
+typedef struct
 {
+	printf_out_t out;
+	void *arg;
+	int count;
+} printf_sink_t;
 
-	if (str) {
-		if( buflimit == ( char * ) 0 ) {
-			/* Limit of buffer not known, write charater to buffer. */
-			**str = (char)c;
-			++(*str);
-		}
-		else if( ( ( unsigned long ) *str ) < ( ( unsigned long ) buflimit ) ) {
-			/* Withing known limit of buffer, write character. */
-			**str = (char)c;
-			++(*str);
-		}
-	}
-	else
-	{
-		//(void)uart_put_char(c);
-        UART_1_UartPutChar(c);
-	}
+static void emit(printf_sink_t *sink, char c)
+{
+	sink->out(c, sink->arg);
+	++sink->count;
 }
 
-#define PAD_RIGHT 1
-#define PAD_ZERO 2
-
-static int prints(char **out, const char *string, int width, int pad, char *buflimit)
+static void emit_pad(printf_sink_t *sink, char c, int n)
 {
-	register int pc = 0, padchar = ' ';
-
-	if (width > 0) {
-		register int len = 0;
-		register const char *ptr;
-		for (ptr = string; *ptr; ++ptr) ++len;
-		if (len >= width) width = 0;
-		else width -= len;
-		if (pad & PAD_ZERO) padchar = '0';
-	}
-	if (!(pad & PAD_RIGHT)) {
-		for ( ; width > 0; --width) {
-			printchar (out, padchar, buflimit);
-			++pc;
-		}
-	}
-	for ( ; *string ; ++string) {
-		printchar (out, *string, buflimit);
-		++pc;
-	}
-	for ( ; width > 0; --width) {
-		printchar (out, padchar, buflimit);
-		++pc;
-	}
-
-	return pc;
+	for ( ; n > 0; --n)
+		emit(sink, c);
 }
 
-/* the following should be enough for 64 bit int */
-#define PRINT_BUF_LEN_ll 20
+static void prints(printf_sink_t *sink, const char *string, int width, int prec, unsigned int flags)
+{
+	int len = 0;
+
+	while (string[len] && (!(flags & FMT_PREC) || len < prec))
+		++len;
+	if (!(flags & FMT_LEFT))
+		emit_pad(sink, (flags & FMT_ZERO) ? '0' : ' ', width - len);
+	for (prec = 0; prec < len; ++prec)
+		emit(sink, string[prec]);
+	if (flags & FMT_LEFT)
+		emit_pad(sink, ' ', width - len);
+}
 
-static int printi(char **out, long long i, int b, int sg, int width, int pad, int letbase,int isll, char *buflimit)
+static void printi(printf_sink_t *sink, unsigned long long u, int neg, unsigned int b, int width, int prec, unsigned int flags)
 {
 	char print_buf[PRINT_BUF_LEN_ll];
-	register char *s;
-	register int t, neg = 0, pc = 0;
-	register unsigned long long u = (unsigned int)i;
-	if(isll)
-		u = (unsigned long long)i;
-	if (i == 0) {
-		print_buf[0] = '0';
-		print_buf[1] = '\0';
-		return prints (out, print_buf, width, pad, buflimit);
+	char *end = print_buf + PRINT_BUF_LEN_ll;
+	char *s = end;
+	char prefix[2];
+	int len, plen = 0, zeros;
+
+	if (neg)
+		prefix[plen++] = '-';
+	else if (flags & FMT_PLUS)
+		prefix[plen++] = '+';
+	else if (flags & FMT_SPACE)
+		prefix[plen++] = ' ';
+	if (b == 16 && (flags & FMT_ALT) && u) {
+		prefix[0] = '0';
+		prefix[1] = (flags & FMT_UPPER) ? 'X' : 'x';
+		plen = 2;
 	}
 
-	if (sg && b == 10 && i < 0) {
-		neg = 1;
-		if(isll)
-			u = (unsigned long long)-i;
-		else
-			u = (unsigned int)-i;
-	}
-
-	s = print_buf + PRINT_BUF_LEN_ll-1;
-	*s = '\0';
-
-	while (u) {
-		if(isll)
-			t = (unsigned long long)u % b;
-		else
-			t = (unsigned int)u % b;
-		if( t >= 10 )
-			t += letbase - '0' - 10;
-		*--s = (char)(t + '0');
-		u /= b;
-	}
-
-	if (neg) {
-		if( width && (pad & PAD_ZERO) ) {
-			printchar (out, '-', buflimit);
-			++pc;
-			--width;
-		}
-		else {
-			*--s = '-';
-		}
-	}
+	if (u)
+		s = ulltoa_r(u, end, b, flags & FMT_UPPER);
+	len = end - s;
 
-	return pc + prints (out, s, width, pad, buflimit);
+	if (flags & FMT_PREC)
+		flags &= ~FMT_ZERO;
+	else
+		prec = 1;
+	if (b == 8 && (flags & FMT_ALT) && prec <= len)
+		prec = len + 1;
+	zeros = prec > len ? prec - len : 0;
+	if ((flags & (FMT_ZERO | FMT_LEFT)) == FMT_ZERO && width > plen + zeros + len)
+		zeros = width - plen - len;
+
+	width -= plen + zeros + len;
+	if (!(flags & FMT_LEFT))
+		emit_pad(sink, ' ', width);
+	for (int i = 0; i < plen; ++i)
+		emit(sink, prefix[i]);
+	emit_pad(sink, '0', zeros);
+	while (s < end)
+		emit(sink, *s++);
+	if (flags & FMT_LEFT)
+		emit_pad(sink, ' ', width);
 }
 
-static int tiny_print( char **out, const char *format, va_list args, unsigned int buflen )
+static void printd(printf_sink_t *sink, double d, int width, int prec, unsigned int flags)
 {
-	register int width, pad;
-	register int pc = 0;
-	char scr[2], *buflimit;
-
-	if( buflen == 0 ){
-		buflimit = ( char * ) 0;
+	char print_buf[DTOA_FIXED_BUF_SIZE];
+	char *s = print_buf;
+	char sign = 0;
+	int len, extra, zeros = 0;
+
+	if (!(flags & FMT_PREC))
+		prec = 6;
+	extra = prec > DTOA_FIXED_MAX_PREC ? prec - DTOA_FIXED_MAX_PREC : 0;
+	len = dtoa_fixed(d, prec - extra, print_buf);
+
+	if (*s == '-') {
+		sign = *s++;
+		--len;
 	}
-	else {
-		/* Calculate the last valid buffer space, leaving space for the NULL
-		terminator. */
-		buflimit = ( *out ) + ( buflen - 1 );
+	else if (flags & FMT_PLUS)
+		sign = '+';
+	else if (flags & FMT_SPACE)
+		sign = ' ';
+	/* no zero padding for nan, inf and ovf */
+	if (*s > '9')
+		flags &= ~FMT_ZERO;
+
+	width -= (sign != 0) + len + extra;
+	if ((flags & (FMT_ZERO | FMT_LEFT)) == FMT_ZERO) {
+		zeros = width;
+		width = 0;
 	}
+	if (!(flags & FMT_LEFT))
+		emit_pad(sink, ' ', width);
+	if (sign)
+		emit(sink, sign);
+	emit_pad(sink, '0', zeros);
+	while (len--)
+		emit(sink, *s++);
+	emit_pad(sink, '0', extra);
+	if (flags & FMT_LEFT)
+		emit_pad(sink, ' ', width);
+}
+
+int tiny_format(printf_out_t out, void *arg, const char *format, va_list args)
+{
+	printf_sink_t sink = { out, arg, 0 };
+	unsigned int flags, b;
+	int width, prec, neg;
+	unsigned long long u;
+	char length;
 
 	for (; *format != 0; ++format) {
-		if (*format == '%') {
+		if (*format != '%') {
+			emit(&sink, *format);
+			continue;
+		}
+		++format;
+		flags = 0;
+		for (;; ++format) {
+			if (*format == '-') flags |= FMT_LEFT;
+			else if (*format == '0') flags |= FMT_ZERO;
+			else if (*format == '+') flags |= FMT_PLUS;
+			else if (*format == ' ') flags |= FMT_SPACE;
+			else if (*format == '#') flags |= FMT_ALT;
+			else break;
+		}
+		width = 0;
+		if (*format == '*') {
+			width = va_arg(args, int);
+			if (width < 0) {
+				flags |= FMT_LEFT;
+				width = -width;
+			}
 			++format;
-			width = pad = 0;
-			if (*format == '\0') break;
-			if (*format == '%') goto out;
-			if (*format == '-') {
+		}
+		for ( ; *format >= '0' && *format <= '9'; ++format)
+			width = width * 10 + *format - '0';
+		prec = 0;
+		if (*format == '.') {
+			flags |= FMT_PREC;
+			++format;
+			if (*format == '*') {
+				prec = va_arg(args, int);
+				if (prec < 0)
+					flags &= ~FMT_PREC;
 				++format;
-				pad = PAD_RIGHT;
 			}
-			while (*format == '0') {
+			for ( ; *format >= '0' && *format <= '9'; ++format)
+				prec = prec * 10 + *format - '0';
+		}
+
+		/* 'H' hh, 'h', 'l', 'L' ll, 'j', 'z', 't' or 0 for int */
+		length = 0;
+		if (*format == 'h' || *format == 'l') {
+			length = *format++;
+			if (*format == length) {
+				length = (length == 'h') ? 'H' : 'L';
 				++format;
-				pad |= PAD_ZERO;
-			}
-			for ( ; *format >= '0' && *format <= '9'; ++format) {
-				width *= 10;
-				width += *format - '0';
-			}
-			if( *format == 's' ) {
-				register char *s = (char *)va_arg( args, int );
-				pc += prints (out, s?s:"(null)", width, pad, buflimit);
-				continue;
-			}
-			if( *format == 'l' && *(format+1) == 'l'){
-				if(*(format+2) == 'd'){
-					format +=2;
-					pc += printi (out, va_arg( args, long long ), 10, 1, width, pad, 'a',1,buflimit);
-					continue;
-				}
-				if(*(format+2) == 'u'){
-					format +=2;
-					pc += printi (out, va_arg( args, unsigned long long ), 10, 0, width, pad, 'a',1,buflimit);
-					continue;
-				}
-			}
-			if( *format == 'd' || *format == 'i' ) {
-				pc += printi (out, va_arg( args, int ), 10, 1, width, pad, 'a',0, buflimit);
-				continue;
-			}
-			if( *format == 'x' ) {
-				pc += printi (out, va_arg( args, int ), 16, 0, width, pad, 'a',0, buflimit);
-				continue;
 			}
-			if( *format == 'X' ) {
-				pc += printi (out, va_arg( args, int ), 16, 0, width, pad, 'A',0, buflimit);
-				continue;
-			}
-			if( *format == 'u' ) {
-				pc += printi (out, va_arg( args, int ), 10, 0, width, pad, 'a',0, buflimit);
-				continue;
+		}
+		else if (*format == 'j' || *format == 'z' || *format == 't') {
+			length = *format++;
+		}
+
+		b = 10;
+		neg = 0;
+		switch (*format) {
+		case 'd':
+		case 'i': {
+			long long i;
+
+			switch (length) {
+			case 'L': i = va_arg(args, long long); break;
+			case 'j': i = va_arg(args, intmax_t); break;
+			case 'l': i = va_arg(args, long); break;
+			case 'z':
+			case 't': i = va_arg(args, ptrdiff_t); break;
+			case 'h': i = (short)va_arg(args, int); break;
+			case 'H': i = (signed char)va_arg(args, int); break;
+			default: i = va_arg(args, int); break;
 			}
-			if( *format == 'c' ) {
-				/* char are converted to int then pushed on the stack */
-				scr[0] = (char)va_arg( args, int );
-				scr[1] = '\0';
-				pc += prints (out, scr, width, pad, buflimit);
-				continue;
+			neg = i < 0;
+			printi(&sink, neg ? 0ull - (unsigned long long)i : (unsigned long long)i, neg, b, width, prec, flags);
+			break;
+		}
+		case 'X':
+			flags |= FMT_UPPER;
+			/* fall through */
+		case 'x':
+			b = 16;
+			goto unsigned_conv;
+		case 'o':
+			b = 8;
+			/* fall through */
+		case 'u':
+		unsigned_conv:
+			switch (length) {
+			case 'L': u = va_arg(args, unsigned long long); break;
+			case 'j': u = va_arg(args, uintmax_t); break;
+			case 'l': u = va_arg(args, unsigned long); break;
+			case 'z':
+			case 't': u = va_arg(args, size_t); break;
+			case 'h': u = (unsigned short)va_arg(args, unsigned int); break;
+			case 'H': u = (unsigned char)va_arg(args, unsigned int); break;
+			default: u = va_arg(args, unsigned int); break;
 			}
+			printi(&sink, u, 0, b, width, prec, flags & ~(FMT_PLUS | FMT_SPACE));
+			break;
+		case 'p':
+			printi(&sink, (uintptr_t)va_arg(args, void *), 0, 16, width, prec, (flags & FMT_LEFT) | FMT_ALT);
+			break;
+		case 's': {
+			const char *s = va_arg(args, const char *);
+
+			prints(&sink, s ? s : "(null)", width, prec, flags & (FMT_LEFT | FMT_ZERO | FMT_PREC));
+			break;
 		}
-		else {
-		out:
-			printchar (out, *format, buflimit);
-			++pc;
+		case 'c':
+			/* char are converted to int then pushed on the stack */
+			if (!(flags & FMT_LEFT))
+				emit_pad(&sink, (flags & FMT_ZERO) ? '0' : ' ', width - 1);
+			emit(&sink, (char)va_arg(args, int));
+			if (flags & FMT_LEFT)
+				emit_pad(&sink, ' ', width - 1);
+			break;
+		case 'n':
+			*va_arg(args, int *) = sink.count;
+			break;
+		case 'f':
+		case 'F':
+			printd(&sink, va_arg(args, double), width, prec, flags);
+			break;
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			/* fixed point only, as newlib-nano without _printf_float */
+			(void)va_arg(args, double);
+			break;
+		case '%':
+			emit(&sink, '%');
+			break;
+		case '\0':
+			return sink.count;
+		default:
+			emit(&sink, *format);
+			break;
 		}
 	}
-	if (out) **out = '\0';
-	va_end( args );
+	return sink.count;
+}
+
+static void uart_out(char c, void *arg)
+{
+	(void)arg;
+	UART_1_UartPutChar(c);
+}
+
+typedef struct
+{
+	char *buf;
+	size_t size;
+	size_t len;
+} printf_buf_t;
+
+/* Keeps the last byte of the buffer for the NULL terminator. */
+static void buf_out(char c, void *arg)
+{
+	printf_buf_t *b = (printf_buf_t *)arg;
+
+	if (b->len + 1 < b->size)
+		b->buf[b->len] = c;
+	++b->len;
+}
+
+static int buf_format(char *buf, size_t size, const char *format, va_list args)
+{
+	printf_buf_t b = { buf, size, 0 };
+	int pc;
+
+	pc = tiny_format(buf_out, &b, format, args);
+	if (size)
+		buf[b.len < size ? b.len : size - 1] = '\0';
 	return pc;
 }
+
 #ifdef CONSOLE_LOG_BUFFER
 char log_buf[UART_CONSOLE_SIZE];
 struct circ_buf log_cb = {
@@ -206,53 +330,63 @@ struct circ_buf log_cb = {
     .head = 0,
     .tail = 0,
 };
-char logs[256];
+
+/* Drops what does not fit in the log buffer any more. */
+static void log_out(char c, void *arg)
+{
+	(void)arg;
+	if (CIRC_SPACE(log_cb.head, log_cb.tail, UART_CONSOLE_SIZE)) {
+		log_cb.buf[log_cb.head] = c;
+		log_cb.head = (log_cb.head + 1) & (UART_CONSOLE_SIZE - 1);
+	}
+}
 #endif
 int __wrap_printf(const char *format, ...)
 {
         va_list args;
+        int pc;
 
         va_start( args, format );
         #ifndef CONSOLE_LOG_BUFFER
-        return tiny_print( 0, format, args, 0 );
+        pc = tiny_format( uart_out, 0, format, args );
         #else
-        uint16_t log_len, circ_space_len;
-        char *p = logs;
-        log_len = tiny_print(&p, format, args, 0);
-        circ_space_len = CIRC_SPACE_TO_END(log_cb.head, log_cb.tail, UART_CONSOLE_SIZE);
-        if (log_len < circ_space_len) {
-            circ_space_len = log_len;
-        }
-        memcpy(log_cb.buf + log_cb.head, logs, circ_space_len);
-        log_cb.head = (log_cb.head + circ_space_len) & (UART_CONSOLE_SIZE - 1);
-        return log_len;
+        pc = tiny_format( log_out, 0, format, args );
         #endif
+        va_end( args );
+        return pc;
 }
 
 int __wrap_sprintf(char *out, const char *format, ...)
 {
         va_list args;
+        int pc;
 
         va_start( args, format );
-        return tiny_print( &out, format, args, 0 );
+        pc = buf_format( out, (size_t)-1, format, args );
+        va_end( args );
+        return pc;
 }
 
 
 int __wrap_snprintf( char *buf, unsigned int count, const char *format, ... )
 {
         va_list args;
-
-        ( void ) count;
+        int pc;
 
         va_start( args, format );
-        return tiny_print( &buf, format, args, count );
+        pc = buf_format( buf, count, format, args );
+        va_end( args );
+        return pc;
 }
 int csp_printf(const char *format, ...)
 {
     va_list args;
+    int pc;
 
     va_start( args, format );
-    return tiny_print( 0, format, args, 0 );
+    pc = tiny_format( uart_out, 0, format, args );
+    va_end( args );
+    return pc;
 }
 int __wrap_fflush(FILE* fp)
 {
@@ -218,6 +218,9 @@ extern int main(void);
 /* The static objects constructors initializer */
 extern void __libc_init_array(void);
 
+/* Fills the unused stack with a pattern, see memstats.h */
+extern void stackPaint(void);
+
 typedef unsigned char __cy_byte_align8 __attribute ((aligned (8)));
 
 struct __cy_region
@@ -317,6 +320,9 @@ void Start_c(void)
         unsigned regions = __cy_region_num;
         const struct __cy_region *rptr = __cy_regions;
 
+        /* Before anything else has used the stack */
+        stackPaint();
+
         /* Initialize memory */
         for (regions = __cy_region_num; regions != 0u; regions--)
         {
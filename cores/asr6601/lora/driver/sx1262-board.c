@@ -53,10 +53,13 @@ void BoardEnableIrq( bool disabledhere)
     }
 }
 
+uint32_t SX126xSpiBytes = 0;
+
 uint16_t SpiInOut( uint16_t outData )
 {
     uint8_t read_data = 0;
     
+    SX126xSpiBytes++;
     LORAC->SSP_DR = outData;
 	
 	while(1) {
@@ -146,6 +149,9 @@ void SX126xWakeup( void )
     // Wait for chip to be ready.
     SX126xWaitOnBusy( );
 
+    // The chip wakes up in STDBY_RC, next commands need no further wakeup
+    SX126xSetOperatingMode( MODE_STDBY_RC );
+
     BoardEnableIrq(tempIrq);
 }
 
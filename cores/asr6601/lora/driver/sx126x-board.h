@@ -160,6 +160,11 @@ void BoardEnableIrq( bool disabledhere);
  */
 extern SX126x_t SX126x;
 
+/*!
+ * Bytes clocked over the radio SPI since start up
+ */
+extern uint32_t SX126xSpiBytes;
+
 
 #ifdef __cplusplus 
 }
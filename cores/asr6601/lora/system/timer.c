@@ -85,6 +85,12 @@ do                              \
 uint8_t HasLoopedThroughMain = 0;
 static TimerTime_t g_systime_ref = 0;
 
+/*!
+ * RTC frequency error in ppb and the RTC time it is counted from
+ */
+static int32_t g_drift_ppb = 0;
+static TimerTime_t g_drift_ref = 0;
+
 /*!
  * Timers list head pointer
  */
@@ -127,13 +133,74 @@ static void TimerSetTimeout( TimerEvent_t *obj );
  */
 static bool TimerExists( TimerEvent_t *obj );
 
+/*!
+ * \brief Drift accumulated by the RTC over a span of RTC time
+ *
+ * \param [IN] span RTC time in ms
+ * \retval Time to add to the span in ms
+ */
+static int64_t TimerDrift( int64_t span )
+{
+    return span * g_drift_ppb / 1000000000;
+}
+
+/*!
+ * \brief RTC time needed for a span of corrected time, rounded up so that
+ *        the corrected RTC time never falls short of the span
+ *
+ * \param [IN] span Corrected time in ms
+ * \retval RTC time in ms
+ */
+static int64_t TimerRtcSpan( int64_t span )
+{
+    int64_t num = span * g_drift_ppb;
+    int64_t den = 1000000000 + g_drift_ppb;
+    int64_t q = num / den;
+
+    if( ( num % den != 0 ) && ( num < 0 ) )
+    {
+        q--;
+    }
+    return span - q;
+}
+
+/*!
+ * \brief Elapsed RTC time since the timer context, corrected for drift
+ */
+static TimerTime_t TimerGetElapsedContext( void )
+{
+    TimerTime_t elapsed = RtcGetElapsedTime( );
+
+    return elapsed + TimerDrift( elapsed );
+}
+
 
 void TimerSetSysTime( TimerSysTime_t sysTime )
 {
     TimerTime_t cur_time = RtcGetTimerValue( );
     TimerTime_t set_time = (TimerTime_t)sysTime.Seconds*1000 + sysTime.SubSeconds;
-    
+    bool tempIrq = BoardDisableIrq();
+
     g_systime_ref = set_time - cur_time;
+    g_drift_ref = cur_time;
+    BoardEnableIrq(tempIrq);
+}
+
+void TimerSetDriftCorrection( int32_t ppb )
+{
+    bool tempIrq = BoardDisableIrq();
+    TimerTime_t cur_time = RtcGetTimerValue( );
+
+    // Keep the drift accumulated so far, count the new rate from now
+    g_systime_ref += TimerDrift( cur_time - g_drift_ref );
+    g_drift_ref = cur_time;
+    g_drift_ppb = ppb;
+    BoardEnableIrq(tempIrq);
+}
+
+int32_t TimerGetDriftCorrection( void )
+{
+    return g_drift_ppb;
 }
 
 TimerSysTime_t TimerGetSysTime( void )
@@ -160,13 +227,15 @@ TimerSysTime_t SysTimeGetMcuTime( void )
 uint32_t SysTimeToMs( TimerSysTime_t sysTime )
 {
     TimerTime_t sysTimer = (TimerTime_t)sysTime.Seconds*1000 + sysTime.SubSeconds;
-    return sysTimer - g_systime_ref;
+    int64_t span = (int64_t)( sysTimer - g_systime_ref - g_drift_ref );
+
+    return g_drift_ref + TimerRtcSpan( span );
 }
 
 TimerSysTime_t SysTimeFromMs( uint32_t timeMs )
 {
     TimerSysTime_t sysTime = { 0 };
-    TimerTime_t curTime = (TimerTime_t)timeMs - g_systime_ref;
+    TimerTime_t curTime = (TimerTime_t)timeMs + g_systime_ref + TimerDrift( (int64_t)timeMs - (int64_t)g_drift_ref );
 
     sysTime.Seconds = (uint32_t)(curTime/1000);
     sysTime.SubSeconds = (uint16_t)(curTime%1000);
@@ -181,6 +250,8 @@ static void TimeStampsUpdate()
     TimerTime_t old =  RtcGetTimerContext(); 
     TimerTime_t now =  RtcSetTimerContext(); 
     uint32_t DeltaContext = (uint32_t)(now - old);
+
+    DeltaContext += TimerDrift( DeltaContext );
     
     TimerEvent_t* cur = TimerListHead;
     while(cur) {
@@ -222,7 +293,7 @@ void TimerStart( TimerEvent_t *obj )
     }
     else 
     {
-        elapsedTime = RtcGetElapsedTime();
+        elapsedTime = TimerGetElapsedContext();
         obj->Timestamp += elapsedTime;
         if( obj->Timestamp < TimerListHead->Timestamp )
         {
@@ -284,7 +355,7 @@ void TimerIrqHandler( void )
     TimeStampsUpdate();
 
     // remove all the expired object from the list
-    while( ( TimerListHead != NULL ) && ( (TimerListHead->Timestamp < RtcGetElapsedTime(  )) || TimerListHead->Timestamp==0  ))
+    while( ( TimerListHead != NULL ) && ( (TimerListHead->Timestamp < TimerGetElapsedContext(  )) || TimerListHead->Timestamp==0  ))
     {
         cur = TimerListHead;
         TimerListHead = TimerListHead->Next;
@@ -409,7 +480,9 @@ void TimerSetValue( TimerEvent_t *obj, uint32_t value )
 
 TimerTime_t TimerGetCurrentTime( void )
 {
-    return RtcGetTimerValue( ) + g_systime_ref;
+    TimerTime_t cur_time = RtcGetTimerValue( );
+
+    return cur_time + g_systime_ref + TimerDrift( (int64_t)( cur_time - g_drift_ref ) );
 }
 
 TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime )
@@ -421,7 +494,7 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime )
 static void TimerSetTimeout( TimerEvent_t *obj )
 {
     obj->IsRunning = true;
-    RtcSetTimeout(obj->Timestamp);
+    RtcSetTimeout(TimerRtcSpan(obj->Timestamp));
 }
 
 TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature )
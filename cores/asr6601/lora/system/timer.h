@@ -241,6 +241,22 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t savedTime );
  */
 TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature );
 
+/*!
+ * \brief Sets the frequency error of the RTC. From now on the current time
+ *        and the timer alarms are corrected by it.
+ *
+ * \param [IN] ppb RTC frequency error in parts per billion, positive when the
+ *                 RTC runs slow
+ */
+void TimerSetDriftCorrection( int32_t ppb );
+
+/*!
+ * \brief Returns the frequency error set with TimerSetDriftCorrection
+ *
+ * \retval RTC frequency error in parts per billion
+ */
+int32_t TimerGetDriftCorrection( void );
+
 /*!
  * \brief Manages the entry into ARM cortex deep-sleep mode
  */
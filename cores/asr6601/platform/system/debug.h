@@ -25,6 +25,8 @@
 	#define DIO_PRINTF(format, ...)		do {}while(0)
 #endif
 
+#define TRACE_EVENT(id, ...)		do {}while(0)
+
 #endif /* __DEBUG_H__*/
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
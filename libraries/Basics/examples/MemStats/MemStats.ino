@@ -0,0 +1,54 @@
+#ifndef __asr650x__
+#error "only asr650x series has the memory statistics (memstats.h)."
+#endif
+
+#include "Arduino.h"
+
+//Prints how deep the stack has been and how the heap is used.
+//The stack is painted at boot, stackHighWater() is the deepest use since
+//then, interrupts included. A stack that went past stackSize() has run
+//over what the linker reserved for it; stackHeadroom() says how close it
+//came to the heap.
+//
+//In a LoRaWAN sketch with AT support the same figures answer AT+MEM?,
+//forward the command from checkUserAt():
+//
+//  bool checkUserAt(char *cmd, char *content)
+//  {
+//    return memStatsAt(cmd, content);
+//  }
+
+void deepCall(uint8_t level)
+{
+  volatile uint8_t buffer[64];
+
+  buffer[0] = level;
+  if(level > 0)
+  {
+    deepCall(level - 1);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  memStatsDump();
+
+  //use some stack and some heap, then look again
+  deepCall(10);
+  char *block = (char *)malloc(512);
+  String text = "heap backed";
+  text += " string";
+
+  Serial.printf("stack high water %lu bytes\r\n", (unsigned long)stackHighWater());
+
+  HeapStats_t heap;
+  heapStats(&heap);
+  Serial.printf("heap used %lu, peak %lu, largest free block %lu\r\n",
+                (unsigned long)heap.Used, (unsigned long)heap.Peak, (unsigned long)heap.LargestFree);
+
+  free(block);
+  memStatsDump();
+}
+
+void loop() {
+}
@@ -0,0 +1,90 @@
+#include "SPI.h"
+
+//Measures how close the SPI transfers get to the configured clock.
+//Bridge MOSI and MISO with a wire and the loopback check is done as well,
+//without the wire only the timing is meaningful.
+
+#define BUFFER_SIZE  1024
+
+uint8_t txBuffer[BUFFER_SIZE];
+uint8_t rxBuffer[BUFFER_SIZE];
+
+const uint32_t clocks[] = {500000, 1000000, 2000000, 4000000, 6000000};
+
+void report(const char *name, uint32_t bytes, uint32_t us, uint32_t clock)
+{
+  //bits per microsecond times 1000 is kbit/s
+  uint32_t kbps = (uint64_t)bytes * 8000 / us;
+  uint32_t percent = (uint64_t)kbps * 100000 / clock;
+
+  Serial.printf("  %-14s %6lu us  %5lu kbit/s  %3lu%% of clock\r\n",
+                name, (unsigned long)us, (unsigned long)kbps, (unsigned long)percent);
+}
+
+void runClock(uint32_t clock)
+{
+  uint32_t start, us;
+#ifdef __asr650x__
+  uint8_t pattern[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+#endif
+
+  SPI.beginTransaction(SPISettings(clock, SPI_MSBFIRST, SPI_MODE0));
+  clock = SPI.getFrequency();
+  Serial.printf("SCK %lu Hz\r\n", (unsigned long)clock);
+
+  //one byte per call, the bus stops between bytes
+  start = micros();
+  for(uint32_t i = 0; i < BUFFER_SIZE; i++)
+  {
+    rxBuffer[i] = SPI.transfer(txBuffer[i]);
+  }
+  us = micros() - start;
+  report("transfer(byte)", BUFFER_SIZE, us, clock);
+
+  //full duplex with the FIFO kept full
+  start = micros();
+  SPI.transferBytes(txBuffer, rxBuffer, BUFFER_SIZE);
+  us = micros() - start;
+  report("transferBytes", BUFFER_SIZE, us, clock);
+  if(memcmp(txBuffer, rxBuffer, BUFFER_SIZE) != 0)
+  {
+    Serial.println("  loopback mismatch (MOSI not bridged to MISO?)");
+  }
+
+  //write only
+  start = micros();
+  SPI.transferBytes(txBuffer, NULL, BUFFER_SIZE);
+  us = micros() - start;
+  report("write only", BUFFER_SIZE, us, clock);
+
+#ifdef __asr650x__
+  //writePattern() is only in the asr650x SPI
+  start = micros();
+  SPI.writePattern(pattern, sizeof(pattern), BUFFER_SIZE / sizeof(pattern));
+  us = micros() - start;
+  report("writePattern", BUFFER_SIZE, us, clock);
+#endif
+
+  SPI.endTransaction();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  for(uint32_t i = 0; i < BUFFER_SIZE; i++)
+  {
+    txBuffer[i] = i * 7 + 3;
+  }
+
+  //SPI.begin() use default pin SCK,MISO,MOSI, nss is not setted.
+  SPI.begin();
+}
+
+void loop() {
+  for(uint8_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++)
+  {
+    runClock(clocks[i]);
+  }
+  Serial.println();
+  delay(5000);
+}
@@ -2,25 +2,6 @@
 #include "OneWire.h"
 #include "util/OneWire_direct_gpio.h"
 
-#define SOFTSERIAL_BUFF_SIZE  255
-#define SOFTSERIAL_RX_TIMEOUT  3000
-static float timedelay = 0;
-static uint8_t Recev[8]  ={0};
-static uint8_t temp_bin  = 0;
-
-static uint8_t TX_GPIO;
-static uint8_t RX_GPIO;
-static uint8_t _rxbitmask;
-static uint8_t _txbitmask;
-static uint32_t *_rxbaseReg;
-static uint32_t *_txbaseReg;
-
-static uint8_t print_Sign = 0;
-static uint8_t IRREC_RX_BUF[SOFTSERIAL_BUFF_SIZE] = {0};
-static uint16_t IRREC_RX_CNT = 0;
-static uint8_t rebit = 0;
-static uint8_t tikerInUs;
-
 #if defined(__asr650x__)
 #define GET_MCU_TIKER   CY_SYS_SYST_CVR_REG
 #define GET_MCU_RELOAD  CY_SYS_SYST_RVR_REG
@@ -28,178 +9,302 @@ static uint8_t tikerInUs;
 #define GET_MCU_TIKER   SysTick->VAL
 #define GET_MCU_RELOAD  SysTick->LOAD
 #endif
-static void delayTiker(uint32_t  ticks)
+
+#define SOFTSERIAL_FRAME_BITS  10
+
+static_assert((SOFTSERIAL_BUFF_SIZE & (SOFTSERIAL_BUFF_SIZE - 1)) == 0 && SOFTSERIAL_BUFF_SIZE <= 32768,
+              "SOFTSERIAL_BUFF_SIZE must be a power of two");
+static_assert(SOFTSERIAL_MAX_INSTANCES <= 8, "SOFTSERIAL_MAX_INSTANCES is at most 8");
+
+// SysTick value latched by the core on entry to the GPIO interrupt.
+extern uint32_t intTime;
+
+softSerial *softSerial::_instances[SOFTSERIAL_MAX_INSTANCES];
+
+template <int N> void softSerial::rxHandler(void)
 {
-    uint32_t tpre = GET_MCU_TIKER;
-    uint32_t tnow, tcnt = 0;
-    uint32_t reload = GET_MCU_RELOAD;
-    while (1) {
-        tnow = GET_MCU_TIKER;
-        if (tnow < tpre)
-            tcnt += tpre - tnow;
-        else
-            tcnt += reload - tnow + tpre;
-
-        tpre = tnow;
-
-        if (tcnt >= ticks)
-            break;
-    };
+	// only the first SOFTSERIAL_MAX_INSTANCES handlers are ever attached
+	softSerial *port = (N < SOFTSERIAL_MAX_INSTANCES) ? _instances[N] : NULL;
+
+	if(port != NULL)
+	{
+		port->rxEdge();
+	}
 }
 
-static void delayus(float nus)
+// attachInterrupt() takes no argument, so every slot has its own handler.
+const GpioIrqHandler softSerial::_handlers[8] = {
+	rxHandler<0>, rxHandler<1>, rxHandler<2>, rxHandler<3>,
+	rxHandler<4>, rxHandler<5>, rxHandler<6>, rxHandler<7>,
+};
+
+// SysTick counts down and wraps every millisecond.
+static inline uint32_t tikerElapsed(uint32_t from, uint32_t to, uint32_t period)
 {
-    uint32_t tpre = GET_MCU_TIKER;
-    uint32_t tnow, tcnt = 0;
-    uint32_t reload = GET_MCU_RELOAD;
-    uint32_t ticks = (uint32_t)(nus * tikerInUs);
-    while (1) {
-        tnow = GET_MCU_TIKER;
-        if (tnow < tpre)
-            tcnt += tpre - tnow;
-        else
-            tcnt += reload - tnow + tpre;
-
-        tpre = tnow;
-
-        if (tcnt >= ticks)
-            break;
-    };
+	return (from >= to) ? from - to : from + period - to;
 }
 
 softSerial::softSerial(uint8_t tx_GPIO, uint8_t rx_GPIO):
-pbuffer(0)
+_txPin(tx_GPIO),
+_rxPin(rx_GPIO),
+_slot(-1),
+_bitTicks(0),
+_rxBit(-1),
+_rxLevel(1),
+_rxHead(0),
+_rxTail(0),
+_rxOverflow(0)
 {
-	TX_GPIO = tx_GPIO;
-	RX_GPIO = rx_GPIO;
-	_rxbitmask = PIN_TO_BITMASK(RX_GPIO);
-	_rxbaseReg = PIN_TO_BASEREG(RX_GPIO);
-	_txbitmask = PIN_TO_BITMASK(TX_GPIO);
-	_txbaseReg = PIN_TO_BASEREG(TX_GPIO);
-
+	_rxbitmask = PIN_TO_BITMASK(_rxPin);
+	_rxbaseReg = PIN_TO_BASEREG(_rxPin);
+	_txbitmask = PIN_TO_BITMASK(_txPin);
+	_txbaseReg = PIN_TO_BASEREG(_txPin);
 }
 
-//IO模拟串口初始�?
 void softSerial::begin(uint16_t Baudrate)
 {
-	timedelay = 1000000/Baudrate;
-	if(Baudrate<=19200)
-		tikerInUs=48;
-	else
-		tikerInUs=45;
-	pinMode(RX_GPIO,INPUT);
-	digitalWrite(RX_GPIO,HIGH);
-	attachInterrupt(RX_GPIO, receiverBegin, FALLING);
-
-	pinMode(TX_GPIO, OUTPUT);
-	digitalWrite(TX_GPIO,HIGH);
+	end();
+
+	_ticksPerUs = (GET_MCU_RELOAD + 1) / 1000;
+	_bitTicks = (_ticksPerUs * 1000000UL + Baudrate / 2) / Baudrate;
+	_frameUs = (SOFTSERIAL_FRAME_BITS + 1) * 1000000UL / Baudrate;
+
+	pinMode(_txPin, OUTPUT);
+	digitalWrite(_txPin,HIGH);
+
+	pinMode(_rxPin,INPUT);
+	digitalWrite(_rxPin,HIGH);
+
+	_rxBit = -1;
+	_rxLevel = DIRECT_READ(_rxbaseReg, _rxbitmask);
+	_rxHead = 0;
+	_rxTail = 0;
+	_rxOverflow = 0;
+
+	for(int8_t slot = 0; slot < SOFTSERIAL_MAX_INSTANCES; slot++)
+	{
+		if(_instances[slot] == NULL)
+		{
+			_slot = slot;
+			_instances[slot] = this;
+			attachInterrupt(_rxPin, _handlers[slot], BOTH);
+			break;
+		}
+	}
 }
 
-int softSerial::available(void)
+void softSerial::end(void)
 {
-	if(IRREC_RX_CNT){
-		return IRREC_RX_CNT;
-	}
-	else
+	if(_slot < 0)
 	{
-		return 0;
+		return;
 	}
-	
+	detachInterrupt(_rxPin);
+	_instances[_slot] = NULL;
+	_slot = -1;
 }
-extern uint32_t intTime;
-void softSerial::receiverBegin(void)
+
+/*
+ * Edge on RX. The line held _rxLevel since the previous edge; every bit
+ * boundary that run covers, counted from the start bit, takes that level.
+ * The SysTick difference resolves the edge to a tick but only within one
+ * SysTick period, micros() adds the whole periods it cannot see.
+ */
+void softSerial::rxEdge(void)
 {
-	
-	uint32_t timetemp=GET_MCU_TIKER;
-	uint32_t tcnt=0;
-	if (timetemp < intTime)
-		tcnt += intTime - timetemp;
-	else
-		tcnt += GET_MCU_RELOAD - timetemp + intTime;
-
-	delayTiker((uint32_t)(timedelay * tikerInUs)-tcnt);
-
-	uint8_t data = 0;
-	auto start = millis();
-    do {
-		for( uint8_t count = 0; count < 8; count++){
-			data |= DIRECT_READ(_rxbaseReg, _rxbitmask)<<count;
-			delayus(timedelay);
+	uint32_t tick = intTime;
+	uint32_t us = micros();
+	uint8_t level = DIRECT_READ(_rxbaseReg, _rxbitmask);
+	uint32_t period = GET_MCU_RELOAD + 1;
+	uint32_t ticks;
+
+	if(level == _rxLevel)
+	{
+		// a pulse shorter than the interrupt latency, nothing to time
+		return;
+	}
+
+	if(_rxBit >= 0)
+	{
+		uint32_t coarse = us - _edgeUs;
+
+		if(coarse >= _frameUs)
+		{
+			ticks = (SOFTSERIAL_FRAME_BITS + 1) * _bitTicks;
 		}
+		else
+		{
+			uint32_t approx = coarse * _ticksPerUs;
 
-		if(IRREC_RX_CNT < SOFTSERIAL_BUFF_SIZE)
+			ticks = tikerElapsed(_edgeTick, tick, period);
+			if(approx > ticks + period / 2)
+			{
+				ticks += (approx - ticks + period / 2) / period * period;
+			}
+		}
+		rxRun(ticks, _rxLevel);
+
+		if(_rxBit == SOFTSERIAL_FRAME_BITS - 1 && level == 0)
 		{
-			IRREC_RX_BUF[IRREC_RX_CNT++] = data;
+			// the next start bit came a little early, the stop bit was there
+			rxPush(_rxByte);
+			_rxBit = -1;
 		}
-		uint32_t tpre = GET_MCU_TIKER;
-		uint32_t tnow, tcnt = 0;
-		uint32_t reload = GET_MCU_RELOAD;
-		uint32_t ticks = 2*(uint32_t)((float)timedelay * tikerInUs);
-
-		while (1) {
-			if(DIRECT_READ(_rxbaseReg, _rxbitmask)==0)
-				break;
-			tnow = GET_MCU_TIKER;
-			if (tnow < tpre)
-				tcnt += tpre - tnow;
-			else
-				tcnt += reload - tnow + tpre;
-	
-			tpre = tnow;
-	
-			if (tcnt >= ticks)
+	}
+
+	_edgeTick = tick;
+	_edgeUs = us;
+	_rxLevel = level;
+
+	if(_rxBit < 0 && level == 0)
+	{
+		_rxBit = 0;
+		_rxTicks = 0;
+	}
+}
+
+void softSerial::rxRun(uint32_t ticks, uint8_t level)
+{
+	uint32_t reached;
+
+	// every edge is a bit boundary: round the run on its own and drop the
+	// rest, so baud error and latency do not add up over the frame
+	reached = (_rxTicks + ticks + _bitTicks / 2) / _bitTicks;
+	_rxTicks = reached * _bitTicks;
+
+	while((uint32_t)_rxBit < reached)
+	{
+		if(_rxBit == 0)
+		{
+			if(level)
+			{
+				// start bit ended early, it was a glitch
+				_rxBit = -1;
 				return;
-		};
-		delayus(timedelay);
-		data=0;
-	} while (millis() - start < SOFTSERIAL_RX_TIMEOUT);
+			}
+		}
+		else if(_rxBit < SOFTSERIAL_FRAME_BITS - 1)
+		{
+			_rxByte >>= 1;
+			if(level)
+			{
+				_rxByte |= 0x80;
+			}
+		}
+		else
+		{
+			// a low stop bit is a framing error, the byte is dropped
+			if(level)
+			{
+				rxPush(_rxByte);
+			}
+			_rxBit = -1;
+			return;
+		}
+		_rxBit++;
+	}
 }
 
-int softSerial::read(void)
+void softSerial::rxPush(uint8_t data)
 {
-	if(available())
+	uint16_t head = _rxHead;
+
+	if((uint16_t)(head - _rxTail) == SOFTSERIAL_BUFF_SIZE)
+	{
+		_rxOverflow++;
+		return;
+	}
+	_rxBuf[head & (SOFTSERIAL_BUFF_SIZE - 1)] = data;
+	_rxHead = head + 1;
+}
+
+// A frame ending in ones has no edge after its last data bit, finish it
+// once the stop bit has passed.
+void softSerial::rxIdle(void)
+{
+	if(_rxBit < 0 || _slot < 0)
+	{
+		return;
+	}
+
+	noInterrupts();
+	if(_rxBit >= 0 && _rxLevel)
 	{
-		IRREC_RX_CNT--;
-		uint8_t temp = IRREC_RX_BUF[pbuffer++];
-		if(IRREC_RX_CNT==0)
+		uint32_t us = micros() - _edgeUs;
+		uint32_t ticks = (us >= _frameUs) ? (SOFTSERIAL_FRAME_BITS + 1) * _bitTicks : us * _ticksPerUs;
+
+		if(_rxTicks + ticks >= SOFTSERIAL_FRAME_BITS * _bitTicks)
 		{
-			pbuffer = 0;
+			rxRun(ticks, 1);
 		}
-		return temp;
 	}
-	return (-1);
+	interrupts();
+}
+
+int softSerial::available(void)
+{
+	rxIdle();
+	return (uint16_t)(_rxHead - _rxTail);
+}
+
+int softSerial::read(void)
+{
+	uint16_t tail = _rxTail;
+
+	if(available() == 0)
+	{
+		return (-1);
+	}
+	uint8_t temp = _rxBuf[tail & (SOFTSERIAL_BUFF_SIZE - 1)];
+	_rxTail = tail + 1;
+	return temp;
+}
+
+int softSerial::peek(void)
+{
+	if(available() == 0)
+	{
+		return (-1);
+	}
+	return _rxBuf[_rxTail & (SOFTSERIAL_BUFF_SIZE - 1)];
 }
 
 void softSerial::flush()
 {
-	memset(IRREC_RX_BUF, 0, SOFTSERIAL_BUFF_SIZE);
-	IRREC_RX_CNT = 0;
-	pbuffer = 0;
+	_rxTail = _rxHead;
 }
 
+// Bit edges are placed on a tick schedule from the start bit, so the loop
+// overhead does not add up over the frame.
 void softSerial::sendByte(uint8_t val)
 {
-    noInterrupts();
-    DIRECT_WRITE_LOW(_txbaseReg, _txbitmask);
-    delayus(timedelay);
-    
-    for(int i=0;i<8;i++)
-    {
-        if(val&0x01)
-        {
-            DIRECT_WRITE_HIGH(_txbaseReg, _txbitmask);
-        }
-        else
-        {
-            DIRECT_WRITE_LOW(_txbaseReg, _txbitmask);
-        }
-		val>>=1;
-        delayus(timedelay);
-    }
-    
-    DIRECT_WRITE_HIGH(_txbaseReg, _txbitmask);
-    delayus(timedelay);
-    interrupts();
+	uint16_t frame = ((uint16_t)val << 1) | (1 << (SOFTSERIAL_FRAME_BITS - 1));
+	uint32_t period = GET_MCU_RELOAD + 1;
+	uint32_t tpre, tnow;
+	uint32_t elapsed = 0, due = 0;
+
+	noInterrupts();
+	tpre = GET_MCU_TIKER;
+	for(uint8_t i = 0; i < SOFTSERIAL_FRAME_BITS; i++)
+	{
+		if(frame & 0x01)
+		{
+			DIRECT_WRITE_HIGH(_txbaseReg, _txbitmask);
+		}
+		else
+		{
+			DIRECT_WRITE_LOW(_txbaseReg, _txbitmask);
+		}
+		frame >>= 1;
+		due += _bitTicks;
+		while(elapsed < due)
+		{
+			tnow = GET_MCU_TIKER;
+			elapsed += tikerElapsed(tpre, tnow, period);
+			tpre = tnow;
+		}
+	}
+	interrupts();
 }
 
 size_t softSerial::write(uint8_t c)
@@ -208,16 +313,11 @@ size_t softSerial::write(uint8_t c)
 	return 1;
 }
 
-int softSerial::peek(void)
-{
-  return 0;
-}
-
 size_t softSerial::write(const uint8_t *buffer, size_t size)
 {
 	uint32_t bufIndex;
 	bufIndex = 0u;
-	   
+
 	while(bufIndex < size)
 	{
 		write(buffer[bufIndex]);
@@ -231,7 +331,7 @@ void softSerial::sendStr(uint8_t *st,uint16_t len)
 {
     int i=0;
     while ((len--)!=0)
-    {  
+    {
         sendByte(st[i]);
         i++;
     }
@@ -4,29 +4,87 @@
 #include "Arduino.h"
 #include <stdlib.h>
 
+// Received bytes kept per instance, a power of two.
+#ifndef SOFTSERIAL_BUFF_SIZE
+#define SOFTSERIAL_BUFF_SIZE  128
+#endif
+
+// Instances that can receive at the same time, each takes one edge handler.
+#ifndef SOFTSERIAL_MAX_INSTANCES
+#define SOFTSERIAL_MAX_INSTANCES  4
+#endif
+
+/*
+ * Bit-banged UART.
+ *
+ * The receiver does not sample inside the pin interrupt. Every edge on RX
+ * only stores the SysTick value the core captured on interrupt entry; the
+ * time since the previous edge says how many bits the line held its old
+ * level, and the byte is assembled from those runs. Trailing ones up to the
+ * stop bit have no edge, they are completed by the next start bit or by
+ * available()/read() once the stop bit is due. Received bytes go into a
+ * ring buffer per instance.
+ *
+ * Transmission still busy-waits with interrupts off, one byte at a time.
+ */
 class softSerial:public Stream
 {
 protected:
-uint8_t pbuffer;
+    uint8_t _txPin;
+    uint8_t _rxPin;
+    uint32_t _txbitmask;
+    uint32_t _rxbitmask;
+    volatile uint32_t *_txbaseReg;
+    volatile uint32_t *_rxbaseReg;
+    int8_t _slot;
+
+    uint32_t _bitTicks;     // SysTick ticks per bit
+    uint32_t _ticksPerUs;
+    uint32_t _frameUs;      // one frame and a bit
+
+    // edge decoder, touched by the edge handler and under noInterrupts()
+    uint32_t _edgeTick;     // SysTick value at the last edge
+    uint32_t _edgeUs;       // micros() at the last edge
+    uint32_t _rxTicks;      // bit boundaries up to the last edge, in ticks
+    int8_t _rxBit;          // bits of the frame done, -1 while idle
+    uint8_t _rxLevel;       // line level since the last edge
+    uint8_t _rxByte;
+
+    volatile uint8_t _rxBuf[SOFTSERIAL_BUFF_SIZE];
+    volatile uint16_t _rxHead;
+    volatile uint16_t _rxTail;
+    volatile uint16_t _rxOverflow;
+
+    void rxEdge(void);
+    void rxRun(uint32_t ticks, uint8_t level);
+    void rxIdle(void);
+    void rxPush(uint8_t data);
+
+    template <int N> static void rxHandler(void);
+    static softSerial *_instances[SOFTSERIAL_MAX_INSTANCES];
+    static const GpioIrqHandler _handlers[8];
 
 public:
     softSerial(uint8_t tx_GPIO, uint8_t rx_GPIO);
-    ~softSerial() {}
+    ~softSerial() { end(); }
 
     void begin(uint16_t Baudrate);
-    
+    void end(void);
+
     void sendByte(uint8_t value);
     void sendStr(uint8_t *st, uint16_t len);
     void softwarePrintf(char *p_fmt, ...);
 
     int available(void);
-    static void receiverBegin(void);
     int read(void);
     void flush();
     int peek(void);
     size_t write(uint8_t);
     size_t write(const uint8_t *buffer, size_t size);
 
+    // Bytes dropped because the ring buffer was full.
+    uint16_t overflow(void) { return _rxOverflow; }
+
     inline size_t write(const char * s)
     {
         return write((uint8_t*) s, strlen(s));
@@ -49,12 +107,4 @@ public:
     }
 };
 
-// io_usart::io_usart(/* args */)
-// {
-// }
-
-// io_usart::~io_usart()
-// {
-// }
-
-#endif
\ No newline at end of file
+#endif
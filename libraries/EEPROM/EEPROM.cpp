@@ -47,21 +47,33 @@
 #ifdef __asr650x__
 #define _EEPROM_SIZE (CY_FLASH_SIZEOF_ROW * 3)
 #define _EEPROM_BASE CY_SFLASH_USERBASE
+#define _EEPROM_PAGE_SIZE CY_FLASH_SIZEOF_ROW
 #else
 #define _EEPROM_SIZE 0xC00
 #define _EEPROM_BASE FLASH_BASE + 0x7400
+// FLASH_update() erases the larger flash page itself, this is only how
+// much EEPROM_DIRECT mode caches
+#define _EEPROM_PAGE_SIZE 256
 #endif
+
+#define _EEPROM_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+// Page of an address already checked against _size, and where it starts
+#define _EEPROM_PAGE(address) ((int)((size_t)(address) / _EEPROM_PAGE_SIZE))
+#define _EEPROM_PAGE_START(page) ((size_t)(page) * _EEPROM_PAGE_SIZE)
+
+
 EEPROMClass::EEPROMClass(uint32_t baddr)
-    : _baddr(baddr), _data(0), _size(0), _dirty(false)
+    : _baddr(baddr), _data(0), _size(0), _dirty(false), _mode(EEPROM_MIRROR), _page(-1)
 {
 }
 
 EEPROMClass::EEPROMClass(void)
-    : _baddr(CY_SFLASH_USERBASE), _data(0), _size(0), _dirty(false)
+    : _baddr(CY_SFLASH_USERBASE), _data(0), _size(0), _dirty(false), _mode(EEPROM_MIRROR), _page(-1)
 {
 }
 
-void EEPROMClass::begin(size_t size)
+void EEPROMClass::begin(size_t size, eeprom_mode_t mode)
 {
   if (size <= 0)
   {
@@ -76,6 +88,23 @@ void EEPROMClass::begin(size_t size)
 
   size = (size + 3) & (~3);
 
+  // The buffer is a mirror in one mode and a page in the other
+  if (_data && mode != _mode)
+  {
+    delete[] _data;
+    _data = 0;
+  }
+  _mode = mode;
+  _page = -1;
+
+  if (_mode == EEPROM_DIRECT)
+  {
+    // Nothing to load, the page buffer is allocated by the first write
+    _size = size;
+    _dirty = false;
+    return;
+  }
+
   // In case begin() is called a 2nd+ time, don't reallocate if size is the same
   if (_data && size != _size)
   {
@@ -110,15 +139,51 @@ void EEPROMClass::end()
   _data = 0;
   _size = 0;
   _dirty = false;
+  _page = -1;
+}
+
+// EEPROM_DIRECT: bring the page holding address into the cache, committing
+// the page there before if it is dirty. Returns the cached byte.
+uint8_t *EEPROMClass::cachePage(int const address)
+{
+  int page = _EEPROM_PAGE(address);
+  size_t offset = _EEPROM_PAGE_START(page);
+
+  if (page != _page)
+  {
+    if (_dirty && !commit())
+    {
+      return 0;
+    }
+    if (!_data)
+    {
+      _data = new uint8_t[_EEPROM_PAGE_SIZE];
+      if (!_data)
+      {
+        return 0;
+      }
+    }
+    FLASH_read_at(_baddr + offset, _data, _EEPROM_MIN(_EEPROM_PAGE_SIZE, _size - offset));
+    _page = page;
+  }
+  return &_data[(size_t)address - offset];
 }
 
-uint8_t EEPROMClass::read(int const address)
+uint8_t EEPROMClass::read(int const address) const
 {
   if (address < 0 || (size_t)address >= _size)
   {
     DEBUGV("EEPROMClass::read error, address %d > %d or %d < 0\n", address, _size, address);
     return 0;
   }
+  if (_mode == EEPROM_DIRECT)
+  {
+    if (_page >= 0 && _EEPROM_PAGE(address) == _page)
+    {
+      return _data[(size_t)address - _EEPROM_PAGE_START(_page)];
+    }
+    return *reinterpret_cast<const uint8_t *>(_baddr + address);
+  }
   if (!_data)
   {
     DEBUGV("EEPROMClass::read without ::begin\n");
@@ -135,6 +200,20 @@ void EEPROMClass::write(int const address, uint8_t const value)
     DEBUGV("EEPROMClass::write error, address %d > %d or %d < 0\n", address, _size, address);
     return;
   }
+  if (_mode == EEPROM_DIRECT)
+  {
+    // Only pull a page in when something really changes
+    if (read(address) != value)
+    {
+      uint8_t *pData = cachePage(address);
+      if (pData)
+      {
+        *pData = value;
+        _dirty = true;
+      }
+    }
+    return;
+  }
   if (!_data)
   {
     DEBUGV("EEPROMClass::read without ::begin\n");
@@ -150,6 +229,61 @@ void EEPROMClass::write(int const address, uint8_t const value)
   }
 }
 
+size_t EEPROMClass::readBytes(int const address, void *value, size_t len)
+{
+  if (address < 0 || address + len > _size)
+    return 0;
+
+  if (_mode != EEPROM_DIRECT)
+  {
+    if (!_data)
+      return 0;
+    memcpy(value, _data + address, len);
+    return len;
+  }
+
+  memcpy(value, reinterpret_cast<const void *>(_baddr + address), len);
+  if (_page >= 0)
+  {
+    // the cached page may hold newer data for part of the range
+    size_t start = _EEPROM_PAGE_START(_page);
+    size_t from = (size_t)address > start ? (size_t)address : start;
+    size_t to = _EEPROM_MIN(address + len, start + _EEPROM_PAGE_SIZE);
+
+    if (from < to)
+    {
+      memcpy((uint8_t *)value + (from - address), _data + (from - start), to - from);
+    }
+  }
+  return len;
+}
+
+size_t EEPROMClass::writeBytes(int const address, const void *value, size_t len)
+{
+  const uint8_t *src = (const uint8_t *)value;
+
+  if (address < 0 || address + len > _size)
+    return 0;
+
+  if (_mode != EEPROM_DIRECT)
+  {
+    if (!_data)
+      return 0;
+    if (memcmp(_data + address, src, len) != 0)
+    {
+      _dirty = true;
+      memcpy(_data + address, src, len);
+    }
+    return len;
+  }
+
+  for (size_t i = 0; i < len; i++)
+  {
+    write(address + i, src[i]);
+  }
+  return len;
+}
+
 bool EEPROMClass::commit()
 {
   if (!_size)
@@ -159,7 +293,19 @@ bool EEPROMClass::commit()
   if (!_data)
     return false;
 
-  if (FLASH_update(_baddr, reinterpret_cast<const void *>(_data), _size) == 0)
+  uint32_t addr = _baddr;
+  size_t len = _size;
+
+  if (_mode == EEPROM_DIRECT)
+  {
+    // only the cached page can be dirty
+    size_t offset = _EEPROM_PAGE_START(_page);
+
+    addr += offset;
+    len = _EEPROM_MIN(_EEPROM_PAGE_SIZE, _size - offset);
+  }
+
+  if (FLASH_update(addr, reinterpret_cast<const void *>(_data), len) == 0)
   {
     _dirty = false;
     return true;
@@ -171,15 +317,45 @@ bool EEPROMClass::commit()
 
 uint8_t *EEPROMClass::getDataPtr()
 {
+  if (_mode == EEPROM_DIRECT)
+  {
+    DEBUGV("EEPROMClass::getDataPtr not available in EEPROM_DIRECT mode\n");
+    return 0;
+  }
   _dirty = true;
   return &_data[0];
 }
 
 uint8_t const *EEPROMClass::getConstDataPtr() const
 {
+  if (_mode == EEPROM_DIRECT)
+  {
+    return reinterpret_cast<const uint8_t *>(_baddr);
+  }
   return &_data[0];
 }
 
+EEPROMRef EEPROMClass::operator[](int const address)
+{
+  return EEPROMRef(*this, address);
+}
+
+uint8_t EEPROMClass::operator[](int const address) const
+{
+  return read(address);
+}
+
+EEPROMRef::operator uint8_t() const
+{
+  return _eeprom.read(_address);
+}
+
+EEPROMRef &EEPROMRef::operator=(uint8_t const value)
+{
+  _eeprom.write(_address, value);
+  return *this;
+}
+
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_EEPROM)
 EEPROMClass EEPROM;
 #endif
@@ -26,14 +26,65 @@
 #include <stdint.h>
 #include <string.h>
 
+typedef enum {
+  EEPROM_MIRROR = 0, // begin() copies the region to RAM, commit() writes it back
+  EEPROM_DIRECT      // reads come from flash, writes go through a one page cache
+} eeprom_mode_t;
+
+class EEPROMClass;
+
+/*
+ * What operator[] returns. Reading and assigning go through read() and
+ * write(), so a read does not mark anything dirty and an address out of
+ * range reads 0 and ignores writes.
+ */
+class EEPROMRef {
+public:
+  EEPROMRef(EEPROMClass &eeprom, int const address) : _eeprom(eeprom), _address(address) {}
+
+  operator uint8_t() const;
+  EEPROMRef &operator=(uint8_t const value);
+  EEPROMRef &operator=(const EEPROMRef &ref) { return *this = (uint8_t)ref; }
+
+  EEPROMRef &operator+=(uint8_t const value) { return *this = *this + value; }
+  EEPROMRef &operator-=(uint8_t const value) { return *this = *this - value; }
+  EEPROMRef &operator*=(uint8_t const value) { return *this = *this * value; }
+  EEPROMRef &operator/=(uint8_t const value) { return *this = *this / value; }
+  EEPROMRef &operator%=(uint8_t const value) { return *this = *this % value; }
+  EEPROMRef &operator&=(uint8_t const value) { return *this = *this & value; }
+  EEPROMRef &operator|=(uint8_t const value) { return *this = *this | value; }
+  EEPROMRef &operator^=(uint8_t const value) { return *this = *this ^ value; }
+  EEPROMRef &operator<<=(uint8_t const value) { return *this = *this << value; }
+  EEPROMRef &operator>>=(uint8_t const value) { return *this = *this >> value; }
+
+  EEPROMRef &operator++() { return *this += 1; }
+  EEPROMRef &operator--() { return *this -= 1; }
+  uint8_t operator++(int) { uint8_t value = *this; ++(*this); return value; }
+  uint8_t operator--(int) { uint8_t value = *this; --(*this); return value; }
+
+private:
+  EEPROMClass &_eeprom;
+  int _address;
+};
+
+/*
+ * In EEPROM_DIRECT mode begin() allocates nothing and reads nothing. A write
+ * loads the page it falls into and marks it dirty, commit() programs that
+ * page only. The cache holds a single page, so a write to another page
+ * commits the dirty one first: data can reach flash before commit() is
+ * called. getDataPtr() is not available in this mode, getConstDataPtr()
+ * points at flash and does not see uncommitted writes.
+ */
 class EEPROMClass {
 public:
   EEPROMClass(uint32_t baddr);
   EEPROMClass(void);
 
-  void begin(size_t size);
-  uint8_t read(int const address);
+  void begin(size_t size, eeprom_mode_t mode = EEPROM_MIRROR);
+  uint8_t read(int const address) const;
   void write(int const address, uint8_t const val);
+  size_t readBytes(int const address, void * value, size_t len);
+  size_t writeBytes(int const address, const void * value, size_t len);
   bool commit();
   void end();
 
@@ -45,7 +96,7 @@ public:
     if (address < 0 || address + sizeof(T) > _size)
       return t;
 
-    memcpy((uint8_t*) &t, _data + address, sizeof(T));
+    readBytes(address, (uint8_t*) &t, sizeof(T));
     return t;
   }
 
@@ -53,24 +104,25 @@ public:
   const T &put(int const address, const T &t) {
     if (address < 0 || address + sizeof(T) > _size)
       return t;
-    if (memcmp(_data + address, (const uint8_t*)&t, sizeof(T)) != 0) {
-      _dirty = true;
-      memcpy(_data + address, (const uint8_t*)&t, sizeof(T));
-    }
 
+    writeBytes(address, (const uint8_t*) &t, sizeof(T));
     return t;
   }
 
   size_t length() {return _size;}
 
-  uint8_t& operator[](int const address) {return getDataPtr()[address];}
-  uint8_t const & operator[](int const address) const {return getConstDataPtr()[address];}
+  EEPROMRef operator[](int const address);
+  uint8_t operator[](int const address) const;
 
 protected:
+  uint8_t * cachePage(int const address);
+
   uint32_t _baddr;
   uint8_t* _data;
   size_t _size;
   bool _dirty;
+  eeprom_mode_t _mode;
+  int _page;        // page held in _data in EEPROM_DIRECT mode, -1 if none
 };
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_EEPROM)
@@ -0,0 +1,238 @@
+#include "LoRaWan_APP.h"
+#include "Arduino.h"
+#include "LoRaWan_Telemetry.h"
+
+/*
+ * set LoraWan_RGB to Active,the RGB active in loraWan
+ * RGB red means sending;
+ * RGB purple means joined done;
+ * RGB blue means RxWindow1;
+ * RGB yellow means RxWindow2;
+ * RGB green means received done;
+ */
+
+/* OTAA para*/
+uint8_t devEui[] = { 0x22, 0x32, 0x33, 0x00, 0x00, 0x88, 0x88, 0x02 };
+uint8_t appEui[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+uint8_t appKey[] = { 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x66, 0x01 };
+
+/* ABP para*/
+uint8_t nwkSKey[] = { 0x15, 0xb1, 0xd0, 0xef, 0xa4, 0x63, 0xdf, 0xbe, 0x3d, 0x11, 0x18, 0x1e, 0x1e, 0xc7, 0xda,0x85 };
+uint8_t appSKey[] = { 0xd7, 0x2c, 0x78, 0x75, 0x8c, 0xdc, 0xca, 0xbf, 0x55, 0xee, 0x4a, 0x77, 0x8d, 0x16, 0xef,0x67 };
+uint32_t devAddr =  ( uint32_t )0x007e6ae1;
+
+/*LoraWan channelsmask, default channels 0-7*/ 
+uint16_t userChannelsMask[6]={ 0x00FF,0x0000,0x0000,0x0000,0x0000,0x0000 };
+
+/*LoraWan region, select in arduino IDE tools*/
+LoRaMacRegion_t loraWanRegion = ACTIVE_REGION;
+
+/*LoraWan Class, Class A and Class C are supported*/
+DeviceClass_t  loraWanClass = LORAWAN_CLASS;
+
+/*the application data transmission duty cycle.  value in [ms].*/
+uint32_t appTxDutyCycle = 480000;
+
+/*OTAA or ABP*/
+bool overTheAirActivation = LORAWAN_NETMODE;
+
+/*ADR enable*/
+bool loraWanAdr = LORAWAN_ADR;
+
+/* set LORAWAN_Net_Reserve ON, the node could save the network info to flash, when node reset not need to join again */
+bool keepNet = LORAWAN_NET_RESERVE;
+
+/* Indicates if the node is sending confirmed or unconfirmed messages */
+bool isTxConfirmed = LORAWAN_UPLINKMODE;
+
+/* Application port */
+uint8_t appPort = 2;
+/*!
+* Number of trials to transmit the frame, if the LoRaMAC layer did not
+* receive an acknowledgment. The MAC performs a datarate adaptation,
+* according to the LoRaWAN Specification V1.0.2, chapter 18.4, according
+* to the following table:
+*
+* Transmission nb | Data Rate
+* ----------------|-----------
+* 1 (first)       | DR
+* 2               | DR
+* 3               | max(DR-1,0)
+* 4               | max(DR-1,0)
+* 5               | max(DR-2,0)
+* 6               | max(DR-2,0)
+* 7               | max(DR-3,0)
+* 8               | max(DR-3,0)
+*
+* Note, that if NbTrials is set to 1 or 2, the MAC will not decrease
+* the datarate, in case the LoRaMAC layer did not receive an acknowledgment
+*/
+uint8_t confirmedNbTrials = 4;
+
+/*
+ * Temperature, humidity and battery voltage: min, max, resolution, delta bits.
+ * Decode with tools/telemetry_codec.py decode -40:85:0.1:5,0:100:0.5:4,2.5:4.2:0.01:3 <hex>
+ */
+static const TelemetryField_t fields[] = {
+	{ -40.0f, 85.0f, 0.1f, 5 },
+	{ 0.0f, 100.0f, 0.5f, 4 },
+	{ 2.5f, 4.2f, 0.01f, 3 },
+};
+
+TelemetryEncoder encoder( fields, 3 );
+
+/* Samples taken every SAMPLE_PERIOD ms, sent together in the next frame */
+#define SAMPLE_PERIOD 60000
+#define SAMPLES_PER_FRAME 8
+
+static float samples[SAMPLES_PER_FRAME][3];
+static uint8_t nbSamples = 0;
+static uint32_t lastSample = 0;
+
+static void takeSample( void )
+{
+	if( nbSamples == SAMPLES_PER_FRAME )
+	{
+		return;
+	}
+	samples[nbSamples][0] = 20.0f + ( float )randr( -20, 20 ) / 10.0f;
+	samples[nbSamples][1] = 50.0f + ( float )randr( -10, 10 ) / 2.0f;
+	samples[nbSamples][2] = ( float )getBatteryVoltage() / 1000.0f;
+	nbSamples++;
+}
+
+/* Prepares the payload of the frame */
+static void prepareTxFrame( uint8_t port )
+{
+	/*appData size is LORAWAN_APP_DATA_MAX_SIZE which is defined in "commissioning.h".
+	*appDataSize max value is LORAWAN_APP_DATA_MAX_SIZE.
+	*the encoder stops adding samples when the frame is full.
+	*/
+	takeSample();
+	encoder.begin( appData, LORAWAN_APP_DATA_MAX_SIZE );
+	for( uint8_t i = 0; i < nbSamples; i++ )
+	{
+		encoder.add( samples[i] );
+	}
+	appDataSize = encoder.end();
+	Serial.printf( "%d samples in %d bytes\r\n", encoder.samples(), appDataSize );
+	nbSamples = 0;
+}
+
+/*
+ * Encode time of one frame of SAMPLES_PER_FRAME samples, packed and with a
+ * Cayenne LPP layout (temperature 0x67, humidity 0x68, analog input 0x02)
+ */
+static void benchmark( void )
+{
+	const uint16_t loops = 1000;
+	uint32_t start;
+	uint8_t size = 0;
+
+	for( uint8_t i = 0; i < SAMPLES_PER_FRAME; i++ )
+	{
+		nbSamples = i;
+		takeSample();
+	}
+
+	start = micros();
+	for( uint16_t n = 0; n < loops; n++ )
+	{
+		encoder.begin( appData, LORAWAN_APP_DATA_MAX_SIZE );
+		for( uint8_t i = 0; i < SAMPLES_PER_FRAME; i++ )
+		{
+			encoder.add( samples[i] );
+		}
+		size = encoder.end();
+	}
+	Serial.printf( "packed: %d bytes, %d us per frame\r\n", size, ( int )( ( micros() - start ) / loops ) );
+
+	start = micros();
+	for( uint16_t n = 0; n < loops; n++ )
+	{
+		size = 0;
+		for( uint8_t i = 0; i < SAMPLES_PER_FRAME; i++ )
+		{
+			int16_t t = ( int16_t )( samples[i][0] * 10.0f );
+			uint16_t v = ( uint16_t )( samples[i][2] * 100.0f );
+			appData[size++] = i * 3;
+			appData[size++] = 0x67;
+			appData[size++] = t >> 8;
+			appData[size++] = t;
+			appData[size++] = i * 3 + 1;
+			appData[size++] = 0x68;
+			appData[size++] = ( uint8_t )( samples[i][1] * 2.0f );
+			appData[size++] = i * 3 + 2;
+			appData[size++] = 0x02;
+			appData[size++] = v >> 8;
+			appData[size++] = v;
+		}
+	}
+	Serial.printf( "lpp: %d bytes, %d us per frame\r\n", size, ( int )( ( micros() - start ) / loops ) );
+	nbSamples = 0;
+}
+
+void setup() {
+	Serial.begin(115200);
+	benchmark();
+#if(AT_SUPPORT)
+	enableAt();
+#endif
+	deviceState = DEVICE_STATE_INIT;
+	LoRaWAN.ifskipjoin();
+}
+
+void loop()
+{
+	switch( deviceState )
+	{
+		case DEVICE_STATE_INIT:
+		{
+#if(LORAWAN_DEVEUI_AUTO)
+			LoRaWAN.generateDeveuiByChipID();
+#endif
+#if(AT_SUPPORT)
+			getDevParam();
+#endif
+			printDevParam();
+			LoRaWAN.init(loraWanClass,loraWanRegion);
+			deviceState = DEVICE_STATE_JOIN;
+			break;
+		}
+		case DEVICE_STATE_JOIN:
+		{
+			LoRaWAN.join();
+			break;
+		}
+		case DEVICE_STATE_SEND:
+		{
+			prepareTxFrame( appPort );
+			LoRaWAN.send();
+			deviceState = DEVICE_STATE_CYCLE;
+			break;
+		}
+		case DEVICE_STATE_CYCLE:
+		{
+			// Schedule next packet transmission
+			txDutyCycleTime = appTxDutyCycle + randr( 0, APP_TX_DUTYCYCLE_RND );
+			LoRaWAN.cycle(txDutyCycleTime);
+			deviceState = DEVICE_STATE_SLEEP;
+			break;
+		}
+		case DEVICE_STATE_SLEEP:
+		{
+			if( millis() - lastSample >= SAMPLE_PERIOD )
+			{
+				lastSample = millis();
+				takeSample();
+			}
+			LoRaWAN.sleep();
+			break;
+		}
+		default:
+		{
+			deviceState = DEVICE_STATE_INIT;
+			break;
+		}
+	}
+}
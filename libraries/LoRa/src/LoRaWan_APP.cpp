@@ -40,6 +40,13 @@ uint8_t isDispayOn = 0;
 // TODO: remove this
 //#define DIO_PRINTF(format, ...) printf(format, ##__VA_ARGS__)
 
+/*
+ * Levels at which DIO_PRINTF prints, see debug.h of the core
+ */
+#if (LoRaWAN_DEBUG_LEVEL == 2) || (defined(__asr6601__) && (LoRaWAN_DEBUG_LEVEL > 2))
+#define LORAWAN_DIO_PRINTF
+#endif
+
 /*loraWan default Dr when adr disabled*/
 #ifdef REGION_US915
 int8_t defaultDrForNoAdr = 3;
@@ -93,21 +100,161 @@ static bool nextTx = true;
 enum eDeviceState_LoraWan deviceState;
 
 /*!
- * \brief   Prepares the payload of the frame
+ * Window after a restart during which the user key requests a rejoin [ms]
+ */
+#define USER_KEY_REJOIN_WINDOW 3000
+
+/*!
+ * Timer closing the user key window
+ */
+static TimerEvent_t UserKeyWindowTimer;
+
+/*!
+ * Set by the user key interrupt, handled by init()
+ */
+static volatile bool userKeyRejoin = false;
+
+/*!
+ * millis() when the first uplink of this boot was handed to the MAC, 0 before
+ */
+static uint32_t firstUplinkTime = 0;
+
+#if defined(__asr650x__)
+/*!
+ * Uplinks between two session writes to flash. A session restored from flash
+ * skips that many frame counter values.
+ */
+#ifndef LORAWAN_SESSION_SAVE_INTERVAL
+#define LORAWAN_SESSION_SAVE_INTERVAL 32
+#endif
+
+/*!
+ * Session snapshot updated after every uplink, survives software resets
+ */
+CY_NOINIT static LoRaMacSnapshot_t sessionRam;
+
+/*!
+ * Uplink counter of the session last written to flash
+ */
+static uint32_t sessionFlashUpLinkCounter;
+#endif
+
+/*!
+ * Room for queued uplink records, each one takes its size plus 3 bytes
+ */
+#ifndef LORAWAN_QUEUE_SIZE
+#define LORAWAN_QUEUE_SIZE 256
+#endif
+
+/*!
+ * Time a record waits for others to share its frame when the MAC is idle [ms].
+ * Urgent records do not wait.
+ */
+#ifndef LORAWAN_QUEUE_LINGER
+#define LORAWAN_QUEUE_LINGER 2000
+#endif
+
+/*!
+ * MHDR, FHDR without options, FPort and MIC: what every extra frame costs
+ */
+#define LORAWAN_FRAME_OVERHEAD 13
+
+/*!
+ * Record header: class and in flight flag, port, size
+ */
+#define QUEUE_RECORD_HEADER 3
+#define QUEUE_CLASS_MASK 0x03
+#define QUEUE_IN_FLIGHT 0x80
+
+/*!
+ * Queued records, packed in arrival order
+ */
+static uint8_t queueBuffer[LORAWAN_QUEUE_SIZE];
+static uint16_t queueLength = 0;
+
+/*!
+ * Frame built from the queue, the MAC keeps a pointer to it until TxDone
+ */
+static uint8_t queueFrame[LORAWAN_APP_DATA_MAX_SIZE];
+
+/*!
+ * Timer starting the next queued uplink. It only sets queueDrainPending, the
+ * frame is built and handed to the MAC from send() or sleep().
+ */
+static TimerEvent_t QueueDrainTimer;
+static volatile bool queueDrainPending = false;
+
+static LoRaWanQueueStats_t queueStats;
+
+/*!
+ * Whether the network was heard from lately: cleared by a confirmed uplink
+ * without ACK or a failed link check, set again by any downlink
+ */
+static bool linkUp = true;
+
+/*!
+ * Called from LoRaWAN.sleep() before the MCU sleeps
+ */
+static void (*idleHandler)(void) = NULL;
+
+/*!
+ * \brief   Saves the joined session to RAM, and to flash when forced or every
+ *          LORAWAN_SESSION_SAVE_INTERVAL uplinks
+ */
+static void saveSession(bool toFlash)
+{
+#if defined(__asr650x__)
+	if (LoRaMacSnapshotSave(&sessionRam) != LORAMAC_STATUS_OK)
+	{
+		return;
+	}
+	if (toFlash || (sessionRam.UpLinkCounter - sessionFlashUpLinkCounter >= LORAWAN_SESSION_SAVE_INTERVAL))
+	{
+		FLASH_update(FLASH_LORAWAN_SESSION_BASE, &sessionRam, sizeof(sessionRam));
+		sessionFlashUpLinkCounter = sessionRam.UpLinkCounter;
+	}
+#endif
+}
+
+/*!
+ * \brief   Drops the saved session so that the next restart joins again
+ */
+static void invalidateSession(void)
+{
+#if defined(__asr650x__)
+	memset(&sessionRam, 0, sizeof(sessionRam));
+	FLASH_update(FLASH_LORAWAN_SESSION_BASE, &sessionRam, sizeof(sessionRam));
+#endif
+}
+
+/*!
+ * \brief   Hands a payload to the MAC
+ *
+ * \param   [OUT] flushed - Set when the payload did not fit and an empty frame
+ *                          was sent instead to flush the MAC commands, may be
+ *                          NULL
  *
  * \retval  [0: frame could be send, 1: error]
  */
-bool SendFrame(void)
+static bool sendBuffer(uint8_t port, uint8_t *buffer, uint8_t size, bool *flushed)
 {
 	lwan_dev_params_update();
 
 	McpsReq_t mcpsReq;
 	LoRaMacTxInfo_t txInfo;
 
-	if (LoRaMacQueryTxPossible(appDataSize, &txInfo) != LORAMAC_STATUS_OK)
+	if (flushed != NULL)
+	{
+		*flushed = false;
+	}
+	if (LoRaMacQueryTxPossible(size, &txInfo) != LORAMAC_STATUS_OK)
 	{
 		// Send empty frame in order to flush MAC commands
 		DIO_PRINTF("payload length error ...\r\n");
+		if (flushed != NULL)
+		{
+			*flushed = true;
+		}
 		mcpsReq.Type = MCPS_UNCONFIRMED;
 		mcpsReq.Req.Unconfirmed.fBuffer = NULL;
 		mcpsReq.Req.Unconfirmed.fBufferSize = 0;
@@ -119,9 +266,9 @@ bool SendFrame(void)
 		{
 			DIO_PRINTF("unconfirmed uplink sending ...\r\n");
 			mcpsReq.Type = MCPS_UNCONFIRMED;
-			mcpsReq.Req.Unconfirmed.fPort = appPort;
-			mcpsReq.Req.Unconfirmed.fBuffer = appData;
-			mcpsReq.Req.Unconfirmed.fBufferSize = appDataSize;
+			mcpsReq.Req.Unconfirmed.fPort = port;
+			mcpsReq.Req.Unconfirmed.fBuffer = buffer;
+			mcpsReq.Req.Unconfirmed.fBufferSize = size;
 			mcpsReq.Req.Unconfirmed.Datarate = currentDrForNoAdr;
 		}
 		else
@@ -131,9 +278,9 @@ bool SendFrame(void)
 			// printf("...");
 			DIO_PRINTF("confirmed uplink sending ...\r\n");
 			mcpsReq.Type = MCPS_CONFIRMED;
-			mcpsReq.Req.Confirmed.fPort = appPort;
-			mcpsReq.Req.Confirmed.fBuffer = appData;
-			mcpsReq.Req.Confirmed.fBufferSize = appDataSize;
+			mcpsReq.Req.Confirmed.fPort = port;
+			mcpsReq.Req.Confirmed.fBuffer = buffer;
+			mcpsReq.Req.Confirmed.fBufferSize = size;
 			mcpsReq.Req.Confirmed.NbTrials = confirmedNbTrials;
 			mcpsReq.Req.Confirmed.Datarate = currentDrForNoAdr;
 		}
@@ -143,11 +290,286 @@ bool SendFrame(void)
 	//#endif
 	if (LoRaMacMcpsRequest(&mcpsReq) == LORAMAC_STATUS_OK)
 	{
+		if (firstUplinkTime == 0)
+		{
+			firstUplinkTime = millis();
+			DIO_PRINTF("first uplink %u ms after start\r\n", (unsigned int)firstUplinkTime);
+		}
 		return false;
 	}
 	return true;
 }
 
+/*!
+ * \brief   Prepares the payload of the frame
+ *
+ * \retval  [0: frame could be send, 1: error]
+ */
+bool SendFrame(void)
+{
+	return sendBuffer(appPort, appData, appDataSize, NULL);
+}
+
+/*!
+ * \brief   Masks interrupts, the queue is shared with the MAC callbacks
+ */
+static uint32_t queueLock(void)
+{
+#if defined(__asr650x__)
+	return CyEnterCriticalSection();
+#else
+	uint32_t mask = __get_PRIMASK();
+	__disable_irq();
+	return mask;
+#endif
+}
+
+static void queueUnlock(uint32_t mask)
+{
+#if defined(__asr650x__)
+	CyExitCriticalSection(mask);
+#else
+	__set_PRIMASK(mask);
+#endif
+}
+
+static void queueRemove(uint16_t offset)
+{
+	uint16_t recordSize = QUEUE_RECORD_HEADER + queueBuffer[offset + 2];
+
+	memmove(queueBuffer + offset, queueBuffer + offset + recordSize, queueLength - offset - recordSize);
+	queueLength -= recordSize;
+	queueStats.Depth--;
+	queueStats.Bytes -= recordSize - QUEUE_RECORD_HEADER;
+}
+
+/*!
+ * \brief   Offset of the oldest record of the given class that is not in
+ *          flight, lowest class first when recordClass is -1
+ *
+ * \retval  Offset, queueLength if there is none
+ */
+static uint16_t queueFind(int8_t recordClass)
+{
+	uint8_t cls = (recordClass < 0) ? 0 : recordClass;
+	uint8_t last = (recordClass < 0) ? (uint8_t)LORAWAN_RECORD_BULK : (uint8_t)recordClass;
+	uint16_t offset;
+
+	for (; cls <= last; cls++)
+	{
+		for (offset = 0; offset < queueLength; offset += QUEUE_RECORD_HEADER + queueBuffer[offset + 2])
+		{
+			if (queueBuffer[offset] == cls)
+			{
+				return offset;
+			}
+		}
+	}
+	return queueLength;
+}
+
+/*!
+ * \brief   Drops the oldest record of a class below recordClass to make room
+ *
+ * \retval  false if there is no such record
+ */
+static bool queueEvict(uint8_t recordClass)
+{
+	uint16_t offset;
+	int8_t cls;
+
+	for (cls = LORAWAN_RECORD_BULK; cls > recordClass; cls--)
+	{
+		offset = queueFind(cls);
+		if (offset < queueLength)
+		{
+			queueRemove(offset);
+			queueStats.Dropped++;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*!
+ * \brief   Copies the records for port that fit in maxSize into queueFrame,
+ *          highest class first, and marks them in flight
+ *
+ * \retval  Frame size
+ */
+static uint8_t queueBuild(uint8_t port, uint8_t maxSize)
+{
+	uint8_t size = 0;
+	uint8_t recordSize;
+	uint16_t offset;
+	uint8_t cls;
+
+	for (cls = LORAWAN_RECORD_URGENT; cls <= LORAWAN_RECORD_BULK; cls++)
+	{
+		for (offset = 0; offset < queueLength; offset += QUEUE_RECORD_HEADER + recordSize)
+		{
+			recordSize = queueBuffer[offset + 2];
+			if ((queueBuffer[offset] == cls) && (queueBuffer[offset + 1] == port) && (size + recordSize <= maxSize))
+			{
+				memcpy(queueFrame + size, queueBuffer + offset + QUEUE_RECORD_HEADER, recordSize);
+				size += recordSize;
+				queueBuffer[offset] |= QUEUE_IN_FLIGHT;
+			}
+		}
+	}
+	return size;
+}
+
+/*!
+ * \brief   Starts the drain timer
+ */
+static void queueSchedule(uint32_t delay)
+{
+	TimerStop(&QueueDrainTimer);
+	TimerSetValue(&QueueDrainTimer, (delay > 0) ? delay : 1);
+	TimerStart(&QueueDrainTimer);
+}
+
+static void OnQueueDrainTimerEvent(void)
+{
+	TimerStop(&QueueDrainTimer);
+	queueDrainPending = true;
+}
+
+/*!
+ * \brief   Sends as many queued records as fit at the current datarate.
+ *          Runs in the main loop once the drain timer fired, the MAC
+ *          request must not race the application's own send().
+ */
+static void queueDrain(void)
+{
+	LoRaMacTxInfo_t txInfo;
+	LoRaMacStatus_t status;
+	uint16_t offset;
+	uint8_t recordSize;
+	uint8_t port;
+	uint8_t size = 0;
+	bool urgent = false;
+	bool flushed;
+	uint32_t mask;
+
+	if (queueDrainPending == false)
+	{
+		return;
+	}
+	queueDrainPending = false;
+	if ((nextTx == false) || (IsLoRaMacNetworkJoined == false))
+	{
+		// McpsConfirm or the join reschedules
+		return;
+	}
+
+	// The MAC calls below may print, keep them out of the locked sections
+	while (size == 0)
+	{
+		mask = queueLock();
+		offset = queueFind(-1);
+		recordSize = (offset < queueLength) ? queueBuffer[offset + 2] : 0;
+		port = (offset < queueLength) ? queueBuffer[offset + 1] : 0;
+		urgent = (offset < queueLength) && (queueBuffer[offset] == LORAWAN_RECORD_URGENT);
+		queueUnlock(mask);
+		if (recordSize == 0)
+		{
+			return;
+		}
+		if (LoRaMacQueryTxPossible(0, &txInfo) == LORAMAC_STATUS_OK)
+		{
+			mask = queueLock();
+			size = queueBuild(port, txInfo.MaxPossiblePayload);
+			queueUnlock(mask);
+		}
+		if (size == 0)
+		{
+			// Pending MAC commands leave no room, send the first record alone
+			// and let the MAC raise the datarate, unless it can never fit
+			status = LoRaMacQueryTxPossible(recordSize, &txInfo);
+			mask = queueLock();
+			if (status != LORAMAC_STATUS_OK)
+			{
+				queueRemove(offset);
+				queueStats.Dropped++;
+			}
+			else
+			{
+				memcpy(queueFrame, queueBuffer + offset + QUEUE_RECORD_HEADER, recordSize);
+				queueBuffer[offset] |= QUEUE_IN_FLIGHT;
+				size = recordSize;
+			}
+			queueUnlock(mask);
+		}
+	}
+
+	// Keeps the scheduling policy from postponing the frame
+	if (urgent == true)
+	{
+		LoRaMacSchedulerMarkUrgent();
+	}
+	nextTx = sendBuffer(port, queueFrame, size, &flushed);
+	if ((nextTx == true) || (flushed == true))
+	{
+		// Not sent, or an empty frame went out instead: the records stay
+		// queued for the next frame
+		if (nextTx == true)
+		{
+			LoRaMacSchedulerTakeUrgent();
+		}
+		mask = queueLock();
+		for (offset = 0; offset < queueLength; offset += QUEUE_RECORD_HEADER + queueBuffer[offset + 2])
+		{
+			queueBuffer[offset] &= ~QUEUE_IN_FLIGHT;
+		}
+		queueUnlock(mask);
+		return;
+	}
+	queueStats.Frames++;
+}
+
+/*!
+ * \brief   Releases the records of the frame just confirmed, or puts them
+ *          back in the queue when it failed
+ */
+static void queueConfirm(McpsConfirm_t *mcpsConfirm)
+{
+	uint32_t airtime = 0;
+	uint16_t total = 0;
+	uint8_t count = 0;
+	uint16_t offset = 0;
+	uint32_t mask = queueLock();
+
+	while (offset < queueLength)
+	{
+		if ((queueBuffer[offset] & QUEUE_IN_FLIGHT) == 0)
+		{
+			offset += QUEUE_RECORD_HEADER + queueBuffer[offset + 2];
+		}
+		else if (mcpsConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK)
+		{
+			// By then the radio is set up for the receive windows, so the
+			// time-on-air comes from the region at the uplink datarate
+			airtime += RegionTimeOnAir(loraWanRegion, mcpsConfirm->Datarate, LORAWAN_FRAME_OVERHEAD + queueBuffer[offset + 2]);
+			total += queueBuffer[offset + 2];
+			count++;
+			queueRemove(offset);
+		}
+		else
+		{
+			queueBuffer[offset] &= ~QUEUE_IN_FLIGHT;
+			offset += QUEUE_RECORD_HEADER + queueBuffer[offset + 2];
+		}
+	}
+	if (count > 1)
+	{
+		queueStats.BytesSaved += (count - 1) * LORAWAN_FRAME_OVERHEAD;
+		queueStats.AirtimeSaved += airtime - RegionTimeOnAir(loraWanRegion, mcpsConfirm->Datarate, LORAWAN_FRAME_OVERHEAD + total);
+	}
+	queueUnlock(mask);
+}
+
 /*!
  * \brief Function executed on TxNextPacket Timeout event
  */
@@ -231,7 +653,18 @@ static void McpsConfirm(McpsConfirm_t *mcpsConfirm)
 			break;
 		}
 	}
+	// the uplink counter moves on failed uplinks too
+	saveSession(false);
+	if (mcpsConfirm->McpsRequest == MCPS_CONFIRMED)
+	{
+		linkUp = mcpsConfirm->AckReceived;
+	}
+	queueConfirm(mcpsConfirm);
 	nextTx = true;
+	if (queueStats.Depth > 0)
+	{
+		queueSchedule(0);
+	}
 }
 
 #if (LoraWan_RGB == 1)
@@ -303,6 +736,7 @@ static void McpsIndication(McpsIndication_t *mcpsIndication)
 	{
 		return;
 	}
+	linkUp = true;
 #if defined(CubeCell_BoardPlus) || defined(CubeCell_GPS)
 	ifDisplayAck = 1;
 	revrssi = mcpsIndication->Rssi;
@@ -406,6 +840,11 @@ static void MlmeConfirm(MlmeConfirm_t *mlmeConfirm)
 			}
 #endif
 			DIO_PRINTF("\njoined passthroughMode:%d \r\n", passthroughMode);
+			saveSession(true);
+			if (queueStats.Depth > 0)
+			{
+				queueSchedule(LORAWAN_QUEUE_LINGER);
+			}
 
 			// in PassthroughMode,do nothing while joined
 			if (passthroughMode == false)
@@ -429,6 +868,7 @@ static void MlmeConfirm(MlmeConfirm_t *mlmeConfirm)
 		// printf("\n419 MLME_LINK_CHECK DemodMargin:%d\n mlmeConfirm->Status:%d ......\n", mlmeConfirm->DemodMargin, mlmeConfirm->Status);
 		// printf(".\n");
 		// printf(".");
+		linkUp = (mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK);
 		if (mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK)
 		{
 			// Check DemodMargin
@@ -516,6 +956,103 @@ void lwan_dev_params_update(void)
 LoRaMacPrimitives_t LoRaMacPrimitive;
 LoRaMacCallback_t LoRaMacCallback;
 
+/*!
+ * Temperature source of the clock drift estimation
+ */
+static float (*clockSyncTemperature)(void) = NULL;
+
+/*!
+ * \brief   Initializes the MAC and the uplink timer
+ */
+static void initMac(LoRaMacRegion_t region)
+{
+	if (region == LORAMAC_REGION_AS923_AS1 || region == LORAMAC_REGION_AS923_AS2)
+		region = LORAMAC_REGION_AS923;
+
+	LoRaMacPrimitive.MacMcpsConfirm = McpsConfirm;
+	LoRaMacPrimitive.MacMcpsIndication = McpsIndication;
+	LoRaMacPrimitive.MacMlmeConfirm = MlmeConfirm;
+	LoRaMacPrimitive.MacMlmeIndication = MlmeIndication;
+	LoRaMacCallback.GetBatteryLevel = BoardGetBatteryLevel;
+	LoRaMacCallback.GetTemperatureLevel = clockSyncTemperature;
+	LoRaMacInitialization(&LoRaMacPrimitive, &LoRaMacCallback, region);
+	TimerStop(&TxNextPacketTimer);
+	TimerInit(&TxNextPacketTimer, OnTxNextPacketTimerEvent);
+	TimerStop(&QueueDrainTimer);
+	TimerInit(&QueueDrainTimer, OnQueueDrainTimerEvent);
+}
+
+/*!
+ * \brief   Restores the session saved by saveSession, from RAM after a
+ *          software reset, from flash otherwise
+ *
+ * \retval  true if the device is joined with the restored session
+ */
+static bool restoreSession(LoRaMacRegion_t region)
+{
+#if defined(__asr650x__)
+	LoRaMacSnapshot_t snapshot;
+	MibRequestConfirm_t mibReq;
+
+	initMac(region);
+	FLASH_read_at(FLASH_LORAWAN_SESSION_BASE, (uint8_t *)&snapshot, sizeof(snapshot));
+	if (LoRaMacSnapshotRestore(&sessionRam) == LORAMAC_STATUS_OK)
+	{
+		// The RAM copy is only newer than flash if it holds the same session,
+		// a stale one must not take the frame counter back
+		if ((snapshot.DevAddr == sessionRam.DevAddr) && (snapshot.UpLinkCounter > sessionRam.UpLinkCounter))
+		{
+			mibReq.Type = MIB_UPLINK_COUNTER;
+			mibReq.Param.UpLinkCounter = snapshot.UpLinkCounter;
+			LoRaMacMibSetRequestConfirm(&mibReq);
+		}
+	}
+	else
+	{
+		if (LoRaMacSnapshotRestore(&snapshot) != LORAMAC_STATUS_OK)
+		{
+			return false;
+		}
+		// Uplinks sent after the last flash write are unknown, skip over them
+		mibReq.Type = MIB_UPLINK_COUNTER;
+		LoRaMacMibGetRequestConfirm(&mibReq);
+		mibReq.Param.UpLinkCounter += LORAWAN_SESSION_SAVE_INTERVAL;
+		LoRaMacMibSetRequestConfirm(&mibReq);
+	}
+
+	mibReq.Type = MIB_ADR;
+	mibReq.Param.AdrEnable = loraWanAdr;
+	LoRaMacMibSetRequestConfirm(&mibReq);
+
+	// Keep flash ahead of the counter in use
+	saveSession(true);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*!
+ * \brief   Closes the user key window opened by ifskipjoin
+ */
+static void OnUserKeyWindowEnd(void)
+{
+	TimerStop(&UserKeyWindowTimer);
+	detachInterrupt(USER_KEY);
+	pinMode(USER_KEY, OUTPUT);
+	digitalWrite(USER_KEY, HIGH);
+}
+
+/*!
+ * \brief   User key pressed during the window, rejoin from the main loop
+ */
+static void OnUserKeyRejoin(void)
+{
+	OnUserKeyWindowEnd();
+	userKeyRejoin = true;
+	deviceState = DEVICE_STATE_INIT;
+}
+
 void LoRaWanClass::generateDeveuiByChipID()
 {
 	uint32_t uniqueId[2];
@@ -577,19 +1114,15 @@ void LoRaWanClass::init(DeviceClass_t lorawanClass, LoRaMacRegion_t region)
 
 	DIO_PRINTF(" Class %X start!\r\n\r\n", loraWanClass + 10);
 
-	if (region == LORAMAC_REGION_AS923_AS1 || region == LORAMAC_REGION_AS923_AS2)
-		region = LORAMAC_REGION_AS923;
+	if (userKeyRejoin)
+	{
+		userKeyRejoin = false;
+		netInfoDisable();
+		invalidateSession();
+	}
 	MibRequestConfirm_t mibReq;
 
-	LoRaMacPrimitive.MacMcpsConfirm = McpsConfirm;
-	LoRaMacPrimitive.MacMcpsIndication = McpsIndication;
-	LoRaMacPrimitive.MacMlmeConfirm = MlmeConfirm;
-	LoRaMacPrimitive.MacMlmeIndication = MlmeIndication;
-	LoRaMacCallback.GetBatteryLevel = BoardGetBatteryLevel;
-	LoRaMacCallback.GetTemperatureLevel = NULL;
-	LoRaMacInitialization(&LoRaMacPrimitive, &LoRaMacCallback, region);
-	TimerStop(&TxNextPacketTimer);
-	TimerInit(&TxNextPacketTimer, OnTxNextPacketTimerEvent);
+	initMac(region);
 
 	mibReq.Type = MIB_ADR;
 	mibReq.Param.AdrEnable = loraWanAdr;
@@ -670,6 +1203,7 @@ void LoRaWanClass::join()
 
 void LoRaWanClass::send()
 {
+	queueDrain();
 	if (nextTx == true)
 	{
 		MibRequestConfirm_t mibReq;
@@ -696,6 +1230,11 @@ void LoRaWanClass::cycle(uint32_t dutyCycle)
 
 void LoRaWanClass::sleep(bool *wokeUp)
 {
+	queueDrain();
+	if (idleHandler != NULL)
+	{
+		idleHandler();
+	}
 	TimerLowPowerHandler(wokeUp);
 }
 void LoRaWanClass::setDataRateForNoADR(int8_t dataRate)
@@ -703,47 +1242,146 @@ void LoRaWanClass::setDataRateForNoADR(int8_t dataRate)
 	defaultDrForNoAdr = dataRate;
 }
 
+bool LoRaWanClass::enqueue(uint8_t recordClass, const uint8_t *data, uint8_t size)
+{
+	return enqueue(appPort, recordClass, data, size);
+}
+
+bool LoRaWanClass::enqueue(uint8_t port, uint8_t recordClass, const uint8_t *data, uint8_t size)
+{
+	uint32_t mask;
+
+	if ((recordClass > LORAWAN_RECORD_BULK) || (size == 0) || (size > LORAWAN_APP_DATA_MAX_SIZE) ||
+		(QUEUE_RECORD_HEADER + size > LORAWAN_QUEUE_SIZE))
+	{
+		return false;
+	}
+
+	mask = queueLock();
+	while (LORAWAN_QUEUE_SIZE - queueLength < QUEUE_RECORD_HEADER + size)
+	{
+		if (queueEvict(recordClass) == false)
+		{
+			queueStats.Dropped++;
+			queueUnlock(mask);
+			return false;
+		}
+	}
+	queueBuffer[queueLength] = recordClass;
+	queueBuffer[queueLength + 1] = port;
+	queueBuffer[queueLength + 2] = size;
+	memcpy(queueBuffer + queueLength + QUEUE_RECORD_HEADER, data, size);
+	queueLength += QUEUE_RECORD_HEADER + size;
+	queueStats.Depth++;
+	queueStats.Bytes += size;
+
+	// While an uplink is pending McpsConfirm drains the queue
+	if (nextTx == true)
+	{
+		if (recordClass == LORAWAN_RECORD_URGENT)
+		{
+			queueSchedule(0);
+		}
+		else if ((QueueDrainTimer.IsRunning == false) && (queueDrainPending == false))
+		{
+			queueSchedule(LORAWAN_QUEUE_LINGER);
+		}
+	}
+	queueUnlock(mask);
+	return true;
+}
+
+void LoRaWanClass::getQueueStats(LoRaWanQueueStats_t *stats)
+{
+	uint32_t mask = queueLock();
+	*stats = queueStats;
+	queueUnlock(mask);
+}
+
+bool LoRaWanClass::isLinkUp()
+{
+	return linkUp;
+}
+
+void LoRaWanClass::setIdleHandler(void (*handler)(void))
+{
+	idleHandler = handler;
+}
+
+void LoRaWanClass::setClockSync(uint32_t maxError, float (*temperature)(void))
+{
+	LoRaMacClockSyncParams_t params;
+
+	params.MaxError = maxError;
+	params.MinInterval = LORAMAC_CLOCK_SYNC_DEFAULT_MIN_INTERVAL;
+	params.MaxInterval = LORAMAC_CLOCK_SYNC_DEFAULT_MAX_INTERVAL;
+	LoRaMacClockSyncSetParams(&params);
+	clockSyncTemperature = temperature;
+	LoRaMacCallback.GetTemperatureLevel = temperature;
+}
+
+void LoRaWanClass::clearQueue()
+{
+	uint32_t mask = queueLock();
+	uint16_t offset = 0;
+
+	// records in flight stay until their McpsConfirm
+	while (offset < queueLength)
+	{
+		if (queueBuffer[offset] & QUEUE_IN_FLIGHT)
+		{
+			offset += QUEUE_RECORD_HEADER + queueBuffer[offset + 2];
+		}
+		else
+		{
+			queueRemove(offset);
+		}
+	}
+	queueUnlock(mask);
+}
+
 void LoRaWanClass::ifskipjoin()
 {
+#ifdef LORAWAN_DIO_PRINTF
+	uint32_t start = millis();
+#endif
+
 	DIO_PRINTF("\n\t......checkNetInfo():%d modeLoraWan:%d\n", checkNetInfo(), modeLoraWan);
 	// if saved net info is OK in lorawan mode, skip join.
 	if (checkNetInfo() && modeLoraWan)
-	// if (modeLoraWan)
 	{
-		// Serial.println();
 		if (passthroughMode == false)
 		{
-			DIO_PRINTF("Wait 3s for user key to rejoin network");
-			uint16_t i = 0;
 			pinMode(USER_KEY, INPUT);
-			while (i <= 3000)
+			if (digitalRead(USER_KEY) == LOW) // key held through the restart, rejoin network;
 			{
-				if (digitalRead(USER_KEY) == LOW) // if user key down, rejoin network;
-				{
-					netInfoDisable();
-					pinMode(USER_KEY, OUTPUT);
-					digitalWrite(USER_KEY, HIGH);
-					return;
-				}
-				delay(1);
-				i++;
+				netInfoDisable();
+				invalidateSession();
+				pinMode(USER_KEY, OUTPUT);
+				digitalWrite(USER_KEY, HIGH);
+				return;
 			}
-			pinMode(USER_KEY, OUTPUT);
-			digitalWrite(USER_KEY, HIGH);
+			// The key is watched from its interrupt while the device sleeps
+			DIO_PRINTF("Press user key within %ds to rejoin network\r\n", USER_KEY_REJOIN_WINDOW / 1000);
+			userKeyRejoin = false;
+			attachInterrupt(USER_KEY, OnUserKeyRejoin, FALLING);
+			TimerInit(&UserKeyWindowTimer, OnUserKeyWindowEnd);
+			TimerSetValue(&UserKeyWindowTimer, USER_KEY_REJOIN_WINDOW);
+			TimerStart(&UserKeyWindowTimer);
 		}
 #if (AT_SUPPORT)
 		getDevParam();
 #endif
 
-		init(loraWanClass, loraWanRegion);
-		getNetInfo();
-		if (passthroughMode == false)
+		if (restoreSession(loraWanRegion))
 		{
-			DIO_PRINTF("User key not detected,Use reserved Net");
+			DIO_PRINTF("Session restored in %u ms\r\n", (unsigned int)(millis() - start));
 		}
 		else
 		{
-			DIO_PRINTF("Use reserved Net");
+			init(loraWanClass, loraWanRegion);
+			getNetInfo();
+			DIO_PRINTF("Use reserved Net, %u ms\r\n", (unsigned int)(millis() - start));
 		}
 		if (passthroughMode == false)
 		{
@@ -751,7 +1389,8 @@ void LoRaWanClass::ifskipjoin()
 			// Serial.println();
 			DIO_PRINTF("Next packet send %d ms later(random time from 0 to APP_TX_DUTYCYCLE)\r\n", temp);
 			// Serial.println();
-			cycle(temp); // send packet in a random time to avoid network congestion.
+			// send packet in a random time to avoid network congestion, after the user key window.
+			cycle(USER_KEY_REJOIN_WINDOW + temp);
 		}
 		deviceState = DEVICE_STATE_SLEEP;
 	}
@@ -51,6 +51,30 @@ extern uint16_t userChannelsMask[6];
 
 extern enum eDeviceState_LoraWan deviceState;
 
+/*!
+ * Uplink queue record classes, a frame takes the lower values first and a
+ * full queue drops the higher values first
+ */
+enum eLoRaWanRecordClass
+{
+  LORAWAN_RECORD_URGENT = 0,
+  LORAWAN_RECORD_NORMAL,
+  LORAWAN_RECORD_BULK,
+};
+
+/*!
+ * Uplink queue counters
+ */
+typedef struct sLoRaWanQueueStats
+{
+  uint8_t Depth;         //! Records waiting or in flight
+  uint16_t Bytes;        //! Payload bytes of those records
+  uint32_t Frames;       //! Uplinks built from the queue
+  uint32_t Dropped;      //! Records evicted or refused
+  uint32_t BytesSaved;   //! Frame overhead avoided by sharing frames
+  uint32_t AirtimeSaved; //! Estimated time on air avoided [ms]
+} LoRaWanQueueStats_t;
+
 class LoRaWanClass
 {
 public:
@@ -60,6 +84,33 @@ public:
   void cycle(uint32_t dutyCycle);
   void sleep(bool *wokeUp);
   void setDataRateForNoADR(int8_t dataRate);
+  /*
+   * Queues a record for uplink on appPort, or the given port. Records of the
+   * same port are concatenated as they are, so they must carry their own
+   * length or type (Cayenne LPP does). Returns false if the record was dropped.
+   * The queue is sent from send() and sleep(), so the loop must call one of
+   * them.
+   */
+  bool enqueue(uint8_t recordClass, const uint8_t *data, uint8_t size);
+  bool enqueue(uint8_t port, uint8_t recordClass, const uint8_t *data, uint8_t size);
+  void getQueueStats(LoRaWanQueueStats_t *stats);
+  void clearQueue();
+  /*
+   * false after a confirmed uplink got no ACK or a link check failed, until
+   * the next downlink
+   */
+  bool isLinkUp();
+  /*
+   * Registers a function run from sleep(), in the main loop, before the MCU
+   * goes to low power
+   */
+  void setIdleHandler(void (*handler)(void));
+  /*
+   * Adds a DeviceTimeReq to an uplink whenever the estimated clock error
+   * reaches maxError ms, 0 to stop. The optional temperature function
+   * [degC] lets the drift be estimated per temperature range.
+   */
+  void setClockSync(uint32_t maxError, float (*temperature)(void) = NULL);
   void ifskipjoin();
   void generateDeveuiByChipID();
 
@@ -0,0 +1,383 @@
+#include "LoRaWan_Log.h"
+
+/*!
+ * Flash row header, followed by Count records of timestamp (4) and data
+ */
+#define LOG_ROW_MAGIC 0x31474F4C // "LOG1"
+
+typedef struct sLogRowHeader
+{
+	uint32_t Magic;
+	uint32_t Seq;      //! Increases with every row written
+	uint32_t TailSeq;  //! First row not backfilled yet
+	uint8_t TailIndex; //! First record of that row not backfilled yet
+	uint8_t Count;
+	uint8_t RecordSize;
+	uint8_t Reserved;
+} LogRowHeader_t;
+
+typedef struct sLogRecord
+{
+	uint32_t Timestamp;
+	uint8_t Data[LORAWAN_LOG_RECORD_MAX];
+} LogRecord_t;
+
+/*!
+ * Backfill credit of one byte, in bytes per hour times milliseconds
+ */
+#define LOG_CREDIT_PER_BYTE 3600000ULL
+
+static bool logStarted = false;
+static uint8_t logPort;
+static uint8_t logRecordSize;
+static uint32_t logRetention;
+static uint32_t logRate;
+static uint64_t logCredit;
+static uint32_t logCreditTime;
+static LoRaWanLogStats_t logStats;
+
+/*!
+ * Newest records, oldest at ramHead
+ */
+static LogRecord_t ramRing[LORAWAN_LOG_RAM_RECORDS];
+static uint16_t ramHead;
+static uint16_t ramCount;
+
+#if defined(__asr650x__)
+/*!
+ * Flash ring, rows TailSeq to HeadSeq - 1 hold records
+ */
+static uint32_t headSeq;
+static uint32_t tailSeq;
+static uint8_t tailIndex;
+static uint8_t tailCount;
+static uint32_t flashPending;
+static uint8_t rowImage[CY_FLASH_SIZEOF_ROW];
+
+static uint32_t rowAddress(uint32_t seq)
+{
+	return FLASH_LORAWAN_LOG_BASE + (seq % FLASH_LORAWAN_LOG_ROWS) * CY_FLASH_SIZEOF_ROW;
+}
+
+static uint8_t recordsPerRow(void)
+{
+	return (CY_FLASH_SIZEOF_ROW - sizeof(LogRowHeader_t)) / (sizeof(uint32_t) + logRecordSize);
+}
+
+static bool readHeader(uint32_t seq, LogRowHeader_t *header)
+{
+	FLASH_read_at(rowAddress(seq), (uint8_t *)header, sizeof(LogRowHeader_t));
+	return (header->Magic == LOG_ROW_MAGIC) && (header->Seq == seq) && (header->RecordSize == logRecordSize);
+}
+
+/*!
+ * \brief   Records the backfill position in the newest row, so that a reset
+ *          does not send the rows done since it was written
+ */
+static void saveTail(void)
+{
+	LogRowHeader_t header;
+
+	if ((headSeq == 0) || (readHeader(headSeq - 1, &header) == false))
+	{
+		return;
+	}
+	header.TailSeq = tailSeq;
+	header.TailIndex = tailIndex;
+	FLASH_update(rowAddress(headSeq - 1), &header, sizeof(header));
+}
+
+/*!
+ * \brief   Moves the n oldest RAM records to a new flash row
+ */
+static void spill(uint8_t n)
+{
+	LogRowHeader_t header;
+	uint8_t *p = rowImage + sizeof(LogRowHeader_t);
+
+	if (headSeq - tailSeq >= FLASH_LORAWAN_LOG_ROWS)
+	{
+		// the ring is full, the oldest row goes
+		if (readHeader(tailSeq, &header) && (header.Count > tailIndex))
+		{
+			logStats.Overwritten += header.Count - tailIndex;
+			flashPending -= header.Count - tailIndex;
+		}
+		tailSeq++;
+		tailIndex = 0;
+		tailCount = 0;
+	}
+
+	header.Magic = LOG_ROW_MAGIC;
+	header.Seq = headSeq;
+	header.TailSeq = tailSeq;
+	header.TailIndex = tailIndex;
+	header.Count = n;
+	header.RecordSize = logRecordSize;
+	header.Reserved = 0;
+	memcpy(rowImage, &header, sizeof(header));
+	for (uint8_t i = 0; i < n; i++)
+	{
+		memcpy(p, &ramRing[ramHead].Timestamp, sizeof(uint32_t));
+		memcpy(p + sizeof(uint32_t), ramRing[ramHead].Data, logRecordSize);
+		p += sizeof(uint32_t) + logRecordSize;
+		ramHead = (ramHead + 1) % LORAWAN_LOG_RAM_RECORDS;
+		ramCount--;
+	}
+	FLASH_update(rowAddress(headSeq), rowImage, p - rowImage);
+	headSeq++;
+	flashPending += n;
+	logStats.Spilled += n;
+}
+#endif
+
+/*!
+ * \brief   Oldest record not backfilled yet, flash first
+ */
+static bool peekRecord(LogRecord_t *record)
+{
+#if defined(__asr650x__)
+	LogRowHeader_t header;
+
+	while (tailSeq != headSeq)
+	{
+		if (tailCount == 0)
+		{
+			if (readHeader(tailSeq, &header) == false)
+			{
+				// row lost, skip it
+				tailSeq++;
+				tailIndex = 0;
+				continue;
+			}
+			tailCount = header.Count;
+		}
+		if (tailIndex >= tailCount)
+		{
+			tailSeq++;
+			tailIndex = 0;
+			tailCount = 0;
+			continue;
+		}
+		FLASH_read_at(rowAddress(tailSeq) + sizeof(LogRowHeader_t) + tailIndex * (sizeof(uint32_t) + logRecordSize),
+					  (uint8_t *)record, sizeof(uint32_t) + logRecordSize);
+		return true;
+	}
+#endif
+	if (ramCount == 0)
+	{
+		return false;
+	}
+	*record = ramRing[ramHead];
+	return true;
+}
+
+static void popRecord(void)
+{
+#if defined(__asr650x__)
+	if (tailSeq != headSeq)
+	{
+		tailIndex++;
+		flashPending--;
+		if (tailIndex >= tailCount)
+		{
+			tailSeq++;
+			tailIndex = 0;
+			tailCount = 0;
+			saveTail();
+		}
+		return;
+	}
+#endif
+	ramHead = (ramHead + 1) % LORAWAN_LOG_RAM_RECORDS;
+	ramCount--;
+}
+
+static void logIdle(void)
+{
+	LoRaWanLog.poll();
+}
+
+bool LoRaWanLogClass::begin(uint8_t port, uint8_t recordSize, uint32_t retention, uint32_t bytesPerHour)
+{
+	if ((recordSize == 0) || (recordSize > LORAWAN_LOG_RECORD_MAX) || (port == 0) || (port >= 224))
+	{
+		return false;
+	}
+	logPort = port;
+	logRecordSize = recordSize;
+	logRetention = retention;
+	logRate = bytesPerHour;
+	logCredit = 0;
+	logCreditTime = millis();
+	ramHead = 0;
+	ramCount = 0;
+	memset(&logStats, 0, sizeof(logStats));
+
+#if defined(__asr650x__)
+	LogRowHeader_t header;
+	LogRowHeader_t newest;
+	bool found = false;
+
+	// the newest row knows where the backfill stood
+	for (uint32_t row = 0; row < FLASH_LORAWAN_LOG_ROWS; row++)
+	{
+		FLASH_read_at(FLASH_LORAWAN_LOG_BASE + row * CY_FLASH_SIZEOF_ROW, (uint8_t *)&header, sizeof(header));
+		if ((header.Magic == LOG_ROW_MAGIC) && (header.RecordSize == recordSize) &&
+			(header.Seq % FLASH_LORAWAN_LOG_ROWS == row) && ((found == false) || (header.Seq > newest.Seq)))
+		{
+			newest = header;
+			found = true;
+		}
+	}
+	headSeq = found ? newest.Seq + 1 : 0;
+	tailSeq = found ? newest.TailSeq : 0;
+	tailIndex = found ? newest.TailIndex : 0;
+	tailCount = 0;
+	if ((tailSeq > headSeq) || (headSeq - tailSeq > FLASH_LORAWAN_LOG_ROWS))
+	{
+		tailSeq = (headSeq > FLASH_LORAWAN_LOG_ROWS) ? headSeq - FLASH_LORAWAN_LOG_ROWS : 0;
+		tailIndex = 0;
+	}
+	flashPending = 0;
+	for (uint32_t seq = tailSeq; seq != headSeq; seq++)
+	{
+		if (readHeader(seq, &header))
+		{
+			flashPending += header.Count - ((seq == tailSeq) ? MIN(tailIndex, header.Count) : 0);
+		}
+	}
+#endif
+
+	LoRaWAN.setIdleHandler(logIdle);
+	logStarted = true;
+	return true;
+}
+
+bool LoRaWanLogClass::store(const uint8_t *data)
+{
+	uint16_t slot;
+
+	if (logStarted == false)
+	{
+		return false;
+	}
+	if (ramCount == LORAWAN_LOG_RAM_RECORDS)
+	{
+#if defined(__asr650x__)
+		spill(MIN(recordsPerRow(), ramCount));
+#else
+		ramHead = (ramHead + 1) % LORAWAN_LOG_RAM_RECORDS;
+		ramCount--;
+		logStats.Overwritten++;
+#endif
+	}
+	slot = (ramHead + ramCount) % LORAWAN_LOG_RAM_RECORDS;
+	ramRing[slot].Timestamp = TimerGetSysTime().Seconds;
+	memcpy(ramRing[slot].Data, data, logRecordSize);
+	ramCount++;
+	logStats.Stored++;
+	return true;
+}
+
+void LoRaWanLogClass::flush()
+{
+#if defined(__asr650x__)
+	while (logStarted && (ramCount > 0))
+	{
+		spill(MIN(recordsPerRow(), ramCount));
+	}
+#endif
+}
+
+void LoRaWanLogClass::clear()
+{
+	ramHead = 0;
+	ramCount = 0;
+#if defined(__asr650x__)
+	tailSeq = headSeq;
+	tailIndex = 0;
+	tailCount = 0;
+	flashPending = 0;
+	saveTail();
+#endif
+}
+
+void LoRaWanLogClass::getStats(LoRaWanLogStats_t *stats)
+{
+	*stats = logStats;
+	stats->Pending = ramCount;
+#if defined(__asr650x__)
+	stats->Pending += flashPending;
+#endif
+}
+
+void LoRaWanLogClass::poll()
+{
+	LoRaWanQueueStats_t queue;
+	LogRecord_t record;
+	uint8_t frame[5 + LORAWAN_LOG_RECORD_MAX];
+	uint32_t now;
+	uint32_t age;
+	uint8_t n;
+
+	if ((logStarted == false) || (IsLoRaMacNetworkJoined == false) || (LoRaWAN.isLinkUp() == false))
+	{
+		return;
+	}
+
+	now = millis();
+	if (logRate > 0)
+	{
+		logCredit += (uint64_t)(now - logCreditTime) * logRate;
+		if (logCredit > LORAWAN_APP_DATA_MAX_SIZE * LOG_CREDIT_PER_BYTE)
+		{
+			logCredit = LORAWAN_APP_DATA_MAX_SIZE * LOG_CREDIT_PER_BYTE;
+		}
+	}
+	logCreditTime = now;
+
+	now = TimerGetSysTime().Seconds;
+	while (peekRecord(&record))
+	{
+		age = (now > record.Timestamp) ? now - record.Timestamp : 0;
+		if ((logRetention > 0) && (age > logRetention))
+		{
+			popRecord();
+			logStats.Expired++;
+			continue;
+		}
+
+		LoRaWAN.getQueueStats(&queue);
+		if (queue.Bytes >= LORAWAN_LOG_QUEUE_BUDGET)
+		{
+			break;
+		}
+
+		n = 0;
+		do
+		{
+			frame[n++] = (age & 0x7F) | ((age > 0x7F) ? 0x80 : 0);
+			age >>= 7;
+		} while (age > 0);
+		memcpy(frame + n, record.Data, logRecordSize);
+		n += logRecordSize;
+
+		if ((logRate > 0) && (logCredit < n * LOG_CREDIT_PER_BYTE))
+		{
+			break;
+		}
+		if (LoRaWAN.enqueue(logPort, LORAWAN_RECORD_BULK, frame, n) == false)
+		{
+			break;
+		}
+		if (logRate > 0)
+		{
+			logCredit -= n * LOG_CREDIT_PER_BYTE;
+		}
+		popRecord();
+		logStats.Sent++;
+	}
+}
+
+LoRaWanLogClass LoRaWanLog;
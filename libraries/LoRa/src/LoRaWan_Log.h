@@ -0,0 +1,91 @@
+#ifndef LoRaWan_Log_H
+#define LoRaWan_Log_H
+
+#include "LoRaWan_APP.h"
+
+/*
+ * Store-and-forward log for sensor records taken while the network is out of
+ * reach (see LoRaWAN.isLinkUp()).
+ *
+ * Records have a fixed size and are timestamped with TimerGetSysTime(). They
+ * are kept in a RAM ring. When the ring is full, the oldest records are
+ * written to the flash rows at FLASH_LORAWAN_LOG_BASE, which hold the oldest
+ * records again once full. ASR6601 keeps the RAM ring only.
+ *
+ * Once the link is back, the records are backfilled through the uplink queue
+ * as LORAWAN_RECORD_BULK. They go out on their own port, packed as many per
+ * frame as the datarate allows, after any live record. Each record is sent
+ * as
+ *   age (seconds before the frame was built, LEB128) | data (recordSize)
+ * The ages are exact within one boot, or across boots once the device time
+ * is synchronized (MLME_DEVICE_TIME).
+ *
+ * The backfill position is saved in flash each time a row is done, so a
+ * reset may send the records of the current row again.
+ *
+ *   LoRaWanLog.begin(3, sizeof(reading), 7 * 24 * 3600, 2000);
+ *   ...
+ *   if (LoRaWAN.isLinkUp()) send live, else LoRaWanLog.store(reading);
+ */
+
+/*!
+ * Largest record
+ */
+#ifndef LORAWAN_LOG_RECORD_MAX
+#define LORAWAN_LOG_RECORD_MAX 12
+#endif
+
+/*!
+ * Records held in RAM before spilling to flash
+ */
+#ifndef LORAWAN_LOG_RAM_RECORDS
+#define LORAWAN_LOG_RAM_RECORDS 32
+#endif
+
+/*!
+ * Backfill stops feeding the uplink queue while it holds that many bytes,
+ * leaving room for live records
+ */
+#ifndef LORAWAN_LOG_QUEUE_BUDGET
+#define LORAWAN_LOG_QUEUE_BUDGET 48
+#endif
+
+typedef struct sLoRaWanLogStats
+{
+  uint32_t Pending;     //! Records waiting for backfill
+  uint32_t Stored;      //! Records accepted by store()
+  uint32_t Spilled;     //! Records written to flash
+  uint32_t Sent;        //! Records handed to the uplink queue
+  uint32_t Expired;     //! Records older than the retention, not sent
+  uint32_t Overwritten; //! Records lost because the flash ring was full
+} LoRaWanLogStats_t;
+
+class LoRaWanLogClass
+{
+public:
+  /*
+   * port         - uplink port of the backfill frames
+   * recordSize   - size of every record, up to LORAWAN_LOG_RECORD_MAX
+   * retention    - records older than this are dropped [s], 0 keeps all
+   * bytesPerHour - backfill throughput target, 0 sends as fast as the
+   *                duty cycle allows
+   *
+   * Picks up the records left in flash by a previous boot.
+   */
+  bool begin(uint8_t port, uint8_t recordSize, uint32_t retention, uint32_t bytesPerHour);
+  bool store(const uint8_t *data);
+  /*
+   * Writes the records held in RAM to flash, before a power cut
+   */
+  void flush();
+  void clear();
+  void getStats(LoRaWanLogStats_t *stats);
+  /*
+   * Feeds the uplink queue, run from LoRaWAN.sleep()
+   */
+  void poll();
+};
+
+extern LoRaWanLogClass LoRaWanLog;
+
+#endif
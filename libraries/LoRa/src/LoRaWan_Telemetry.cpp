@@ -0,0 +1,266 @@
+#include "LoRaWan_Telemetry.h"
+#include <string.h>
+
+#define COUNT_BITS 4
+
+TelemetryCodec::TelemetryCodec(const TelemetryField_t *fields, uint8_t nbFields)
+{
+	uint32_t levels;
+	float range;
+
+	_fields = fields;
+	_nbFields = (nbFields > TELEMETRY_MAX_FIELDS) ? TELEMETRY_MAX_FIELDS : nbFields;
+	for (uint8_t i = 0; i < _nbFields; i++)
+	{
+		_scale[i] = 1.0f / fields[i].Resolution;
+		range = (fields[i].Max - fields[i].Min) * _scale[i] + 0.5f;
+		if (range < 1.0f)
+		{
+			levels = 0;
+		}
+		else if (range < (float)(1UL << TELEMETRY_MAX_BITS))
+		{
+			levels = (uint32_t)range;
+		}
+		else
+		{
+			levels = (1UL << TELEMETRY_MAX_BITS) - 1;
+		}
+		_bits[i] = 0;
+		while ((_bits[i] < TELEMETRY_MAX_BITS) && ((levels >> _bits[i]) != 0))
+		{
+			_bits[i]++;
+		}
+		_deltaBits[i] = (fields[i].DeltaBits < TELEMETRY_MAX_BITS) ? fields[i].DeltaBits : TELEMETRY_MAX_BITS;
+	}
+	_buffer = NULL;
+	_bitSize = 0;
+	_bitPos = 0;
+	_count = 0;
+}
+
+uint8_t TelemetryCodec::fieldBits(uint8_t field)
+{
+	return (field < _nbFields) ? _bits[field] : 0;
+}
+
+TelemetryEncoder::TelemetryEncoder(const TelemetryField_t *fields, uint8_t nbFields)
+	: TelemetryCodec(fields, nbFields)
+{
+}
+
+void TelemetryEncoder::write(uint32_t value, uint8_t bits)
+{
+	uint8_t *p;
+	uint8_t room;
+	uint8_t n;
+
+	while (bits > 0)
+	{
+		p = _buffer + (_bitPos >> 3);
+		room = 8 - (_bitPos & 7);
+		n = (bits < room) ? bits : room;
+		if (room == 8)
+		{
+			*p = 0;
+		}
+		*p |= ((value >> (bits - n)) & ((1u << n) - 1)) << (room - n);
+		bits -= n;
+		_bitPos += n;
+	}
+}
+
+void TelemetryEncoder::begin(uint8_t *buffer, uint8_t size)
+{
+	_buffer = buffer;
+	_bitSize = (uint16_t)size * 8;
+	_bitPos = 0;
+	_count = 0;
+	if (size > 0)
+	{
+		write(0, COUNT_BITS);
+	}
+}
+
+bool TelemetryEncoder::addRaw(const int32_t *levels)
+{
+	int32_t clamped[TELEMETRY_MAX_FIELDS];
+	bool useDelta[TELEMETRY_MAX_FIELDS];
+	uint16_t bits = 0;
+	int32_t delta;
+	int32_t limit;
+	uint8_t i;
+
+	if ((_buffer == NULL) || (_count >= TELEMETRY_MAX_SAMPLES))
+	{
+		return false;
+	}
+
+	// size the sample first so that a sample that does not fit leaves no trace
+	for (i = 0; i < _nbFields; i++)
+	{
+		clamped[i] = levels[i];
+		if (clamped[i] < 0)
+		{
+			clamped[i] = 0;
+		}
+		else if ((uint32_t)clamped[i] >> _bits[i])
+		{
+			clamped[i] = (int32_t)((1UL << _bits[i]) - 1);
+		}
+		useDelta[i] = false;
+		if ((_count == 0) || (_deltaBits[i] == 0))
+		{
+			bits += _bits[i];
+			continue;
+		}
+		delta = clamped[i] - _previous[i];
+		limit = (int32_t)(1UL << (_deltaBits[i] - 1));
+		useDelta[i] = (delta >= -limit) && (delta < limit);
+		bits += 1 + (useDelta[i] ? _deltaBits[i] : _bits[i]);
+	}
+	if (_bitPos + bits > _bitSize)
+	{
+		return false;
+	}
+
+	for (i = 0; i < _nbFields; i++)
+	{
+		if ((_count > 0) && (_deltaBits[i] > 0))
+		{
+			write(useDelta[i] ? 0 : 1, 1);
+		}
+		if (useDelta[i])
+		{
+			write((uint32_t)(clamped[i] - _previous[i]), _deltaBits[i]);
+		}
+		else
+		{
+			write(clamped[i], _bits[i]);
+		}
+		_previous[i] = clamped[i];
+	}
+	_count++;
+	return true;
+}
+
+bool TelemetryEncoder::add(const float *values)
+{
+	int32_t levels[TELEMETRY_MAX_FIELDS];
+	float level;
+
+	for (uint8_t i = 0; i < _nbFields; i++)
+	{
+		level = (values[i] - _fields[i].Min) * _scale[i];
+		// addRaw clamps to the field, only the conversion must not overflow
+		if (level <= 0.0f)
+		{
+			levels[i] = 0;
+		}
+		else if (level >= (float)(1UL << TELEMETRY_MAX_BITS))
+		{
+			levels[i] = INT32_MAX;
+		}
+		else
+		{
+			levels[i] = (int32_t)(level + 0.5f);
+		}
+	}
+	return addRaw(levels);
+}
+
+uint8_t TelemetryEncoder::samples()
+{
+	return _count;
+}
+
+uint8_t TelemetryEncoder::end()
+{
+	if ((_buffer == NULL) || (_bitSize == 0))
+	{
+		return 0;
+	}
+	_buffer[0] = (_buffer[0] & 0x0F) | (_count << 4);
+	return (_bitPos + 7) >> 3;
+}
+
+TelemetryDecoder::TelemetryDecoder(const TelemetryField_t *fields, uint8_t nbFields)
+	: TelemetryCodec(fields, nbFields)
+{
+}
+
+bool TelemetryDecoder::read(uint32_t *value, uint8_t bits)
+{
+	uint8_t room;
+	uint8_t n;
+
+	if (_bitPos + bits > _bitSize)
+	{
+		return false;
+	}
+	*value = 0;
+	while (bits > 0)
+	{
+		room = 8 - (_bitPos & 7);
+		n = (bits < room) ? bits : room;
+		*value = (*value << n) | ((_buffer[_bitPos >> 3] >> (room - n)) & ((1u << n) - 1));
+		bits -= n;
+		_bitPos += n;
+	}
+	return true;
+}
+
+uint8_t TelemetryDecoder::decode(const uint8_t *buffer, uint8_t size, float *values, uint8_t maxSamples)
+{
+	uint32_t raw;
+	uint32_t flag;
+	int32_t level;
+	uint8_t count;
+	uint8_t deltaBits;
+
+	_buffer = (uint8_t *)buffer;
+	_bitSize = (uint16_t)size * 8;
+	_bitPos = 0;
+	if (read(&raw, COUNT_BITS) == false)
+	{
+		return 0;
+	}
+	count = raw;
+	if (count > maxSamples)
+	{
+		return 0;
+	}
+
+	for (_count = 0; _count < count; _count++)
+	{
+		for (uint8_t i = 0; i < _nbFields; i++)
+		{
+			deltaBits = _deltaBits[i];
+			flag = 1;
+			if ((_count > 0) && (deltaBits > 0) && (read(&flag, 1) == false))
+			{
+				return 0;
+			}
+			if ((_count > 0) && (deltaBits > 0) && (flag == 0))
+			{
+				if (read(&raw, deltaBits) == false)
+				{
+					return 0;
+				}
+				// sign extend
+				level = _previous[i] + ((int32_t)(raw << (32 - deltaBits)) >> (32 - deltaBits));
+			}
+			else
+			{
+				if (read(&raw, _bits[i]) == false)
+				{
+					return 0;
+				}
+				level = raw;
+			}
+			_previous[i] = level;
+			*values++ = _fields[i].Min + level * _fields[i].Resolution;
+		}
+	}
+	return count;
+}
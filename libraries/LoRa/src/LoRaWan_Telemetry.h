@@ -0,0 +1,126 @@
+#ifndef LoRaWan_Telemetry_H
+#define LoRaWan_Telemetry_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Schema-driven telemetry codec.
+ *
+ * Every field is quantized to its declared range and resolution and written
+ * with just the bits that range needs. The first sample of a frame carries
+ * absolute values. Each later sample writes a field as a signed delta of
+ * DeltaBits bits when it fits, else as an absolute value:
+ *
+ *   frame  = count(4) sample0 sample1 ...       MSB first, zero padded
+ *   sample0 field = value(Bits)
+ *   sampleN field = 0 delta(DeltaBits) | 1 value(Bits)   DeltaBits > 0
+ *                 = value(Bits)                           DeltaBits = 0
+ *
+ * The encoder writes straight into the caller's buffer, typically appData:
+ *
+ *   static const TelemetryField_t fields[] = {
+ *     { -40.0f, 85.0f, 0.1f, 5 },   // temperature
+ *     { 0.0f, 100.0f, 0.5f, 4 },    // humidity
+ *     { 2.5f, 4.2f, 0.01f, 3 },     // battery
+ *   };
+ *   TelemetryEncoder encoder(fields, 3);
+ *   encoder.begin(appData, LORAWAN_APP_DATA_MAX_SIZE);
+ *   encoder.add(values);              // once per sample
+ *   appDataSize = encoder.end();
+ *
+ * tools/telemetry_codec.py decodes frames on the host from the same schema
+ * and compares their size and airtime with Cayenne LPP.
+ */
+
+/*!
+ * Largest number of fields in a schema
+ */
+#ifndef TELEMETRY_MAX_FIELDS
+#define TELEMETRY_MAX_FIELDS 16
+#endif
+
+/*!
+ * Largest number of samples in a frame, the count takes 4 bits
+ */
+#define TELEMETRY_MAX_SAMPLES 15
+
+/*!
+ * Widest value or delta, levels are int32_t. Wider ranges are clamped to
+ * it and a larger DeltaBits is cut to it.
+ */
+#define TELEMETRY_MAX_BITS 31
+
+typedef struct sTelemetryField
+{
+  float Min;
+  float Max;
+  float Resolution;
+  uint8_t DeltaBits; //! 0 sends every sample absolute
+} TelemetryField_t;
+
+class TelemetryCodec
+{
+public:
+  TelemetryCodec(const TelemetryField_t *fields, uint8_t nbFields);
+  /*
+   * Bits a field takes as an absolute value
+   */
+  uint8_t fieldBits(uint8_t field);
+
+protected:
+  const TelemetryField_t *_fields;
+  uint8_t _nbFields;
+  uint8_t _bits[TELEMETRY_MAX_FIELDS];
+  uint8_t _deltaBits[TELEMETRY_MAX_FIELDS];
+  float _scale[TELEMETRY_MAX_FIELDS]; //! 1 / Resolution
+  int32_t _previous[TELEMETRY_MAX_FIELDS];
+  uint8_t *_buffer;
+  uint16_t _bitSize;
+  uint16_t _bitPos;
+  uint8_t _count;
+};
+
+class TelemetryEncoder : public TelemetryCodec
+{
+public:
+  TelemetryEncoder(const TelemetryField_t *fields, uint8_t nbFields);
+  /*
+   * Starts a frame in buffer
+   */
+  void begin(uint8_t *buffer, uint8_t size);
+  /*
+   * Appends one sample of nbFields values. Returns false, leaving the frame
+   * untouched, when it does not fit or the frame holds TELEMETRY_MAX_SAMPLES.
+   */
+  bool add(const float *values);
+  /*
+   * Same with values already quantized: (value - Min) / Resolution
+   */
+  bool addRaw(const int32_t *levels);
+  uint8_t samples();
+  /*
+   * Ends the frame, returns its size in bytes
+   */
+  uint8_t end();
+
+private:
+  void write(uint32_t value, uint8_t bits);
+};
+
+class TelemetryDecoder : public TelemetryCodec
+{
+public:
+  TelemetryDecoder(const TelemetryField_t *fields, uint8_t nbFields);
+  /*
+   * Decodes a frame into values, nbFields per sample
+   *
+   * Returns the number of samples, 0 if the frame is malformed
+   */
+  uint8_t decode(const uint8_t *buffer, uint8_t size, float *values, uint8_t maxSamples);
+
+private:
+  bool read(uint32_t *value, uint8_t bits);
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "loramac/LoRaMac.h"
 #include "loramac/Commissioning.h"
+#include "loramac/LoRaMacRecorder.h"
 #include "loramac/region/Region.h"
 #include "radio/radio.h"
 
@@ -22,16 +22,20 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jaeckle ( STACKFORCE )
 */
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdint.h>
 #include "../radio/radio.h"
 #include "LoRaMac.h"
 #include "region/Region.h"
+#include "region/RegionCommon.h"
 #include "LoRaMacClassB.h"
 #include "LoRaMacCrypto.h"
 #include "debug.h"
 #include "LoRaMacTest.h"
 #include "LoRaMacConfirmQueue.h"
+#include "LoRaMacRecorder.h"
+#include "LoRaMacRxTiming.h"
 #include "ASR_Arduino.h"
 #include "timer.h"
 
@@ -46,6 +50,11 @@ TimerTime_t mcps_start_time;
  */
 #define LORAMAC_PHY_MAXPAYLOAD 255
 
+/*!
+ * Maximum join accept size, MHDR + 16 bytes + optional CFList + MIC
+ */
+#define LORAMAC_JOIN_ACCEPT_MAX_SIZE 33
+
 /*!
  * Maximum MAC commands buffer size
  */
@@ -91,86 +100,17 @@ int8_t wota_dr = DR_0;
 uint32_t wota_freq = 505300000;
 #endif
 
-/*!
- * Device IEEE EUI
- */
-static uint8_t *LoRaMacDevEui;
-
-/*!
- * Application IEEE EUI
- */
-static uint8_t *LoRaMacAppEui;
-
 /*!
  * AES encryption/decryption cipher application key
  */
 uint8_t *LoRaMacAppKey;
 
-/*!
- * AES encryption/decryption cipher network session key
- */
-static uint8_t LoRaMacNwkSKey[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-/*!
- * AES encryption/decryption cipher application session key
- */
-static uint8_t LoRaMacAppSKey[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
 /*!
  * Device nonce is a random value extracted by issuing a sequence of RSSI
  * measurements
  */
 uint16_t LoRaMacDevNonce;
 
-/*!
- * Network ID ( 3 bytes )
- */
-static uint32_t LoRaMacNetID;
-
-/*!
- * Mote Address
- */
-static uint32_t LoRaMacDevAddr;
-
-/*!
- * Multicast channels linked list
- */
-static MulticastParams_t *MulticastChannels = NULL;
-
-/*!
- * Actual device class
- */
-static DeviceClass_t LoRaMacDeviceClass;
-
-/*!
- * Indicates if the node is connected to a private or public network
- */
-static bool PublicNetwork;
-
-/*!
- * Buffer containing the data to be sent or received.
- */
-static uint8_t LoRaMacBuffer[LORAMAC_PHY_MAXPAYLOAD];
-
-/*!
- * Length of packet in LoRaMacBuffer
- */
-static uint16_t LoRaMacBufferPktLen = 0;
-
-/*!
- * Length of the payload in LoRaMacBuffer
- */
-static uint8_t LoRaMacTxPayloadLen = 0;
-
-/*!
- * Buffer containing the upper layer data.
- */
-static uint8_t LoRaMacRxPayload[LORAMAC_PHY_MAXPAYLOAD];
-
 /*!
  * LoRaMAC frame counter. Each time a packet is sent the counter is incremented.
  * Only the 16 LSB bits are sent
@@ -183,69 +123,11 @@ uint32_t UpLinkCounter = 0;
  */
 uint32_t DownLinkCounter = 0;
 
-/*!
- * IsPacketCounterFixed enables the MIC field tests by fixing the
- * UpLinkCounter value
- */
-static bool IsUpLinkCounterFixed = false;
-
-/*!
- * Used for test purposes. Disables the opening of the reception windows.
- */
-static bool IsRxWindowsEnabled = true;
-
 /*!
  * Indicates if the MAC layer has already joined a network.
  */
 bool IsLoRaMacNetworkJoined = false;
 
-/*!
- * LoRaMac ADR control status
- */
-static bool AdrCtrlOn = false;
-
-/*!
- * Counts the number of missed ADR acknowledgements
- */
-static uint32_t AdrAckCounter = 0;
-
-/*!
- * If the node has sent a FRAME_TYPE_DATA_CONFIRMED_UP this variable indicates
- * if the nodes needs to manage the server acknowledgement.
- */
-static bool NodeAckRequested = false;
-
-/*!
- * If the server has sent a FRAME_TYPE_DATA_CONFIRMED_DOWN this variable indicates
- * if the ACK bit must be set for the next transmission
- */
-static bool SrvAckRequested = false;
-
-/*!
- * Indicates if the MAC layer wants to send MAC commands
- */
-static bool MacCommandsInNextTx = false;
-
-/*!
- * Contains the current MacCommandsBuffer index
- */
-static uint8_t MacCommandsBufferIndex = 0;
-
-/*!
- * Contains the current MacCommandsBuffer index for MAC commands to repeat
- */
-static uint8_t MacCommandsBufferToRepeatIndex = 0;
-
-/*!
- * Buffer containing the MAC layer commands
- */
-static uint8_t MacCommandsBuffer[LORA_MAC_COMMAND_MAX_LENGTH];
-
-/*!
- * Buffer containing the MAC layer commands which must be repeated
- */
-static uint8_t MacCommandsBufferToRepeat[LORA_MAC_COMMAND_MAX_LENGTH];
-
 /*!
  * LoRaMac parameters
  */
@@ -256,181 +138,377 @@ LoRaMacParams_t LoRaMacParams;
  */
 LoRaMacParams_t LoRaMacParamsDefaults;
 
-/*!
- * Uplink messages repetitions counter
- */
-static uint8_t ChannelsNbRepCounter = 0;
-
-/*!
- * Maximum duty cycle
- * \remark Possibility to shutdown the device.
- */
-static uint8_t MaxDCycle = 0;
-
-/*!
- * Aggregated duty cycle management
- */
-static uint16_t AggregatedDCycle;
-static TimerTime_t AggregatedLastTxDoneTime;
-static TimerTime_t AggregatedTimeOff;
-
-/*!
- * Enables/Disables duty cycle management (Test only)
- */
-static bool DutyCycleOn;
-
-/*!
- * Current channel index
- */
-static uint8_t Channel;
-
-/*!
- * Current channel index
- */
-static uint8_t LastTxChannel;
-
-/*!
- * Set to true, if the last uplink was a join request
- */
-static bool LastTxIsJoinRequest;
-
-/*!
- * Stores the time at LoRaMac initialization.
- *
- * \remark Used for the BACKOFF_DC computation.
- */
-static TimerTime_t LoRaMacInitializationTime = 0;
-
-static TimerSysTime_t LastTxSysTime = {0};
-
 /*!
  * LoRaMac internal state
  */
 uint32_t LoRaMacState = LORAMAC_IDLE;
 
 /*!
- * LoRaMac timer used to check the LoRaMacState (runs every second)
- */
-static TimerEvent_t MacStateCheckTimer;
-
-/*!
- * LoRaMac upper layer event functions
+ * Last transmission time on air
  */
-static LoRaMacPrimitives_t *LoRaMacPrimitives;
+TimerTime_t TxTimeOnAir = 0;
 
 /*!
- * LoRaMac upper layer callback functions
+ * LoRaMac tx/rx operation state
  */
-static LoRaMacCallback_t *LoRaMacCallbacks;
+LoRaMacFlags_t LoRaMacFlags;
 
 /*!
  * Radio events function pointer
  */
 static RadioEvents_t RadioEvents;
 
-/*!
- * LoRaMac duty cycle delayed Tx timer
- */
-static TimerEvent_t TxDelayedTimer;
-
-#ifdef CONFIG_LORA_CAD
-static TimerEvent_t TxImmediateTimer;
-static uint8_t g_lora_cad_cnt = 1;
-#endif
-
 #ifdef CLASS_A_WOTA
 TimerEvent_t wota_CadTimer;
 #endif
-/*!
- * LoRaMac reception windows timers
- */
-static TimerEvent_t RxWindowTimer1;
-static TimerEvent_t RxWindowTimer2;
 
 /*!
- * LoRaMac reception windows delay
- * \remark normal frame: RxWindowXDelay = ReceiveDelayX - RADIO_WAKEUP_TIME
- *         join frame  : RxWindowXDelay = JoinAcceptDelayX - RADIO_WAKEUP_TIME
+ * LoRaMac instance state.
+ *
+ * \remark The globals above are linked by name from the precompiled core
+ *         library and therefore stay global. They always hold the state of
+ *         the selected context and are saved to / loaded from Shared by
+ *         LoRaMacSetContext.
  */
-static uint32_t RxWindow1Delay;
-static uint32_t RxWindow2Delay;
+struct sLoRaMacCtx
+{
+    /*!
+     * Copy of the exported globals while the context is not selected
+     */
+    struct
+    {
+        LoRaMacRegion_t Region;
+        uint8_t *AppKey;
+        uint16_t DevNonce;
+        uint32_t UpLinkCounter;
+        uint32_t DownLinkCounter;
+        bool IsNetworkJoined;
+        LoRaMacParams_t Params;
+        LoRaMacParams_t ParamsDefaults;
+        uint32_t State;
+        TimerTime_t TxTimeOnAir;
+        LoRaMacFlags_t Flags;
+    } Shared;
+
+    /*!
+     * Region state, NULL selects the storage built into the region file
+     */
+    void *RegionCtx;
+
+    /*!
+     * Receive window timing, MacCtxDefault uses the storage built into
+     * LoRaMacRxTiming.c
+     */
+    LoRaMacRxTimingCtx_t RxTiming;
+
+    /*!
+     * Clock synchronisation, MacCtxDefault uses the storage built into
+     * LoRaMacClockSync.c
+     */
+    LoRaMacClockSyncCtx_t ClockSync;
+
+    /*!
+     * Device IEEE EUI
+     */
+    uint8_t *LoRaMacDevEui;
+
+    /*!
+     * Application IEEE EUI
+     */
+    uint8_t *LoRaMacAppEui;
+
+    /*!
+     * AES encryption/decryption cipher network session key
+     */
+    uint8_t LoRaMacNwkSKey[16];
+
+    /*!
+     * AES encryption/decryption cipher application session key
+     */
+    uint8_t LoRaMacAppSKey[16];
+
+    /*!
+     * Network ID ( 3 bytes )
+     */
+    uint32_t LoRaMacNetID;
+
+    /*!
+     * Mote Address
+     */
+    uint32_t LoRaMacDevAddr;
+
+    /*!
+     * Multicast channels linked list
+     */
+    MulticastParams_t *MulticastChannels;
+
+    /*!
+     * Actual device class
+     */
+    DeviceClass_t LoRaMacDeviceClass;
+
+    /*!
+     * Indicates if the node is connected to a private or public network
+     */
+    bool PublicNetwork;
+
+    /*!
+     * Buffer containing the data to be sent or received.
+     */
+    uint8_t LoRaMacBuffer[LORAMAC_PHY_MAXPAYLOAD];
+
+    /*!
+     * Length of packet in LoRaMacBuffer
+     */
+    uint16_t LoRaMacBufferPktLen;
+
+    /*!
+     * Length of the payload in LoRaMacBuffer
+     */
+    uint8_t LoRaMacTxPayloadLen;
+
+    /*!
+     * IsPacketCounterFixed enables the MIC field tests by fixing the
+     * UpLinkCounter value
+     */
+    bool IsUpLinkCounterFixed;
+
+    /*!
+     * Used for test purposes. Disables the opening of the reception windows.
+     */
+    bool IsRxWindowsEnabled;
+
+    /*!
+     * LoRaMac ADR control status
+     */
+    bool AdrCtrlOn;
+
+    /*!
+     * Counts the number of missed ADR acknowledgements
+     */
+    uint32_t AdrAckCounter;
+
+    /*!
+     * If the node has sent a FRAME_TYPE_DATA_CONFIRMED_UP this variable indicates
+     * if the nodes needs to manage the server acknowledgement.
+     */
+    bool NodeAckRequested;
+
+    /*!
+     * If the server has sent a FRAME_TYPE_DATA_CONFIRMED_DOWN this variable indicates
+     * if the ACK bit must be set for the next transmission
+     */
+    bool SrvAckRequested;
+
+    /*!
+     * Indicates if the MAC layer wants to send MAC commands
+     */
+    bool MacCommandsInNextTx;
+
+    /*!
+     * Contains the current MacCommandsBuffer index
+     */
+    uint8_t MacCommandsBufferIndex;
+
+    /*!
+     * Contains the current MacCommandsBuffer index for MAC commands to repeat
+     */
+    uint8_t MacCommandsBufferToRepeatIndex;
+
+    /*!
+     * Buffer containing the MAC layer commands
+     */
+    uint8_t MacCommandsBuffer[LORA_MAC_COMMAND_MAX_LENGTH];
+
+    /*!
+     * Buffer containing the MAC layer commands which must be repeated
+     */
+    uint8_t MacCommandsBufferToRepeat[LORA_MAC_COMMAND_MAX_LENGTH];
+
+    /*!
+     * Uplink messages repetitions counter
+     */
+    uint8_t ChannelsNbRepCounter;
+
+    /*!
+     * Maximum duty cycle
+     * \remark Possibility to shutdown the device.
+     */
+    uint8_t MaxDCycle;
+
+    /*!
+     * Aggregated duty cycle management
+     */
+    uint16_t AggregatedDCycle;
+    TimerTime_t AggregatedLastTxDoneTime;
+    TimerTime_t AggregatedTimeOff;
+
+    /*!
+     * Scheduler state of the current uplink: urgent mark and the time the
+     * policy already postponed it
+     */
+    bool TxUrgent;
+    TimerTime_t TxDeferred;
+
+    /*!
+     * Set while the current uplink goes out at a datarate chosen by the
+     * policy, TxRequestedDatarate is restored once it is done
+     */
+    bool TxPolicyDatarate;
+    int8_t TxRequestedDatarate;
+
+    /*!
+     * Enables/Disables duty cycle management (Test only)
+     */
+    bool DutyCycleOn;
+
+    /*!
+     * Current channel index
+     */
+    uint8_t Channel;
+
+    /*!
+     * Current channel index
+     */
+    uint8_t LastTxChannel;
+
+    /*!
+     * Set to true, if the last uplink was a join request
+     */
+    bool LastTxIsJoinRequest;
+
+    /*!
+     * Stores the time at LoRaMac initialization.
+     *
+     * \remark Used for the BACKOFF_DC computation.
+     */
+    TimerTime_t LoRaMacInitializationTime;
+
+    TimerSysTime_t LastTxSysTime;
+
+    /*!
+     * MCU time of the last TxDone, paired with DeviceTimeAns for the drift
+     * estimation
+     */
+    TimerSysTime_t LastTxMcuTime;
+
+    /*!
+     * LoRaMac timer used to check the LoRaMacState (runs every second)
+     */
+    TimerEvent_t MacStateCheckTimer;
+
+    /*!
+     * LoRaMac upper layer event functions
+     */
+    LoRaMacPrimitives_t *LoRaMacPrimitives;
+
+    /*!
+     * LoRaMac upper layer callback functions
+     */
+    LoRaMacCallback_t *LoRaMacCallbacks;
+
+    /*!
+     * LoRaMac duty cycle delayed Tx timer
+     */
+    TimerEvent_t TxDelayedTimer;
 
-/*!
- * LoRaMac Rx windows configuration
- */
-static RxConfigParams_t RxWindow1Config;
-static RxConfigParams_t RxWindow2Config;
-#ifdef CLASS_A_WOTA
-static RxConfigParams_t RxWindow3Config;
+#ifdef CONFIG_LORA_CAD
+    TimerEvent_t TxImmediateTimer;
+    uint8_t g_lora_cad_cnt;
 #endif
-/*!
- * Acknowledge timeout timer. Used for packet retransmissions.
- */
-static TimerEvent_t AckTimeoutTimer;
-
-/*!
- * Number of trials to get a frame acknowledged
- */
-static uint8_t AckTimeoutRetries = 1;
-
-/*!
- * Number of trials to get a frame acknowledged
- */
-static uint8_t AckTimeoutRetriesCounter = 1;
-
-/*!
- * Indicates if the AckTimeout timer has expired or not
- */
-static bool AckTimeoutRetry = false;
-
-/*!
- * Last transmission time on air
- */
-TimerTime_t TxTimeOnAir = 0;
-
-/*!
- * Number of trials for the Join Request
- */
-static uint8_t JoinRequestTrials;
-
-/*!
- * Maximum number of trials for the Join Request
- */
-static uint8_t MaxJoinRequestTrials;
 
-/*!
- * Structure to hold an MCPS indication data.
- */
-static McpsIndication_t McpsIndication;
+    /*!
+     * LoRaMac reception windows timers
+     */
+    TimerEvent_t RxWindowTimer1;
+    TimerEvent_t RxWindowTimer2;
+
+    /*!
+     * LoRaMac reception windows delay
+     * \remark normal frame: RxWindowXDelay = ReceiveDelayX - RADIO_WAKEUP_TIME
+     *         join frame  : RxWindowXDelay = JoinAcceptDelayX - RADIO_WAKEUP_TIME
+     */
+    uint32_t RxWindow1Delay;
+    uint32_t RxWindow2Delay;
+
+    /*!
+     * LoRaMac Rx windows configuration
+     */
+    RxConfigParams_t RxWindow1Config;
+    RxConfigParams_t RxWindow2Config;
+#ifdef CLASS_A_WOTA
+    RxConfigParams_t RxWindow3Config;
+#endif
 
-/*!
- * Structure to hold MCPS confirm data.
- */
-static McpsConfirm_t McpsConfirm;
+    /*!
+     * Acknowledge timeout timer. Used for packet retransmissions.
+     */
+    TimerEvent_t AckTimeoutTimer;
+
+    /*!
+     * Number of trials to get a frame acknowledged
+     */
+    uint8_t AckTimeoutRetries;
+
+    /*!
+     * Number of trials to get a frame acknowledged
+     */
+    uint8_t AckTimeoutRetriesCounter;
+
+    /*!
+     * Indicates if the AckTimeout timer has expired or not
+     */
+    bool AckTimeoutRetry;
+
+    /*!
+     * Number of trials for the Join Request
+     */
+    uint8_t JoinRequestTrials;
+
+    /*!
+     * Maximum number of trials for the Join Request
+     */
+    uint8_t MaxJoinRequestTrials;
+
+    /*!
+     * Structure to hold an MCPS indication data.
+     */
+    McpsIndication_t McpsIndication;
+
+    /*!
+     * Structure to hold MCPS confirm data.
+     */
+    McpsConfirm_t McpsConfirm;
+
+    /*!
+     * Structure to hold MLME indication data.
+     */
+    MlmeIndication_t MlmeIndication;
+
+    /*!
+     * Structure to hold MLME confirm data.
+     */
+    MlmeConfirm_t MlmeConfirm;
+
+    /*!
+     * Holds the current rx window slot
+     */
+    LoRaMacRxSlot_t RxSlot;
 
-/*!
- * Structure to hold MLME indication data.
- */
-static MlmeIndication_t MlmeIndication;
-
-/*!
- * Structure to hold MLME confirm data.
- */
-static MlmeConfirm_t MlmeConfirm;
+#ifdef CONFIG_LWAN
+    bool DownLinkFramePending;
+#endif
+};
 
 /*!
- * Holds the current rx window slot
+ * Context used by the global API until LoRaMacSetContext is called
  */
-static LoRaMacRxSlot_t RxSlot;
+static LoRaMacCtx_t MacCtxDefault;
 
 /*!
- * LoRaMac tx/rx operation state
+ * Selected context
  */
-LoRaMacFlags_t LoRaMacFlags;
-
-#ifdef CONFIG_LWAN
-static bool DownLinkFramePending = false;
-#endif
+static LoRaMacCtx_t *MacCtx = &MacCtxDefault;
 
 /*!
  * \brief Function to be executed on Radio Tx Done event
@@ -589,6 +667,22 @@ static uint8_t ParseMacCommandsToRepeat(uint8_t *cmdBufIn, uint8_t length, uint8
  */
 static bool ValidatePayloadLength(uint8_t lenN, int8_t datarate, uint8_t fOptsLen);
 
+/*!
+ * \brief Fills the scheduler view of an uplink at the current datarate
+ *
+ * \param [IN] payloadSize FRMPayload size
+ * \param [OUT] request Band forecast, datarate range and link margin
+ */
+static void FillTxRequest(uint8_t payloadSize, LoRaMacTxRequest_t *request);
+
+/*!
+ * \brief Temperature for the drift estimation, from the GetTemperatureLevel
+ *        callback
+ *
+ * \retval Temperature [degC], LORAMAC_CLOCK_SYNC_NO_TEMPERATURE without callback
+ */
+static int8_t ClockSyncTemperature(void);
+
 /*!
  * \brief Decodes MAC commands in the fOpts field and in the payload
  *
@@ -702,33 +796,35 @@ static void OpenContinuousRx2Window(void);
 static void OnRadioTxDone(void)
 {
     DIO_PRINTF("Event : Tx Done\r\n");
+    TRACE_EVENT(TRACE_MAC_TX_DONE);
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
     SetBandTxDoneParams_t txDone;
     TimerTime_t curTime = TimerGetCurrentTime();
-    LastTxSysTime = TimerGetSysTime();
+    MacCtx->LastTxSysTime = TimerGetSysTime();
+    MacCtx->LastTxMcuTime = SysTimeGetMcuTime();
 
     // Setup timers
-    if (IsRxWindowsEnabled == true)
+    if (MacCtx->IsRxWindowsEnabled == true)
     {
-        TimerSetValue(&RxWindowTimer1, RxWindow1Delay);
-        TimerStart(&RxWindowTimer1);
-        if (LoRaMacDeviceClass != CLASS_C)
+        TimerSetValue(&MacCtx->RxWindowTimer1, MacCtx->RxWindow1Delay);
+        TimerStart(&MacCtx->RxWindowTimer1);
+        if (MacCtx->LoRaMacDeviceClass != CLASS_C)
         {
-            TimerSetValue(&RxWindowTimer2, RxWindow2Delay);
-            TimerStart(&RxWindowTimer2);
+            TimerSetValue(&MacCtx->RxWindowTimer2, MacCtx->RxWindow2Delay);
+            TimerStart(&MacCtx->RxWindowTimer2);
         }
-        if ((LoRaMacDeviceClass == CLASS_C) || (NodeAckRequested == true))
+        if ((MacCtx->LoRaMacDeviceClass == CLASS_C) || (MacCtx->NodeAckRequested == true))
         {
             getPhy.Attribute = PHY_ACK_TIMEOUT;
             phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
-            TimerSetValue(&AckTimeoutTimer, RxWindow2Delay + phyParam.Value);
-            TimerStart(&AckTimeoutTimer);
+            TimerSetValue(&MacCtx->AckTimeoutTimer, MacCtx->RxWindow2Delay + phyParam.Value);
+            TimerStart(&MacCtx->AckTimeoutTimer);
         }
     }
     else
     {
-        McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+        MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
         LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT);
 
         if (LoRaMacFlags.Value == 0)
@@ -738,7 +834,7 @@ static void OnRadioTxDone(void)
         LoRaMacFlags.Bits.MacDone = 1;
     }
 
-    if (LoRaMacDeviceClass != CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass != CLASS_C)
     {
         Radio.Sleep();
     }
@@ -748,32 +844,32 @@ static void OnRadioTxDone(void)
     }
 
     // Verify if the last uplink was a join request
-    if ((LoRaMacFlags.Bits.MlmeReq == 1) && (MlmeConfirm.MlmeRequest == MLME_JOIN))
+    if ((LoRaMacFlags.Bits.MlmeReq == 1) && (MacCtx->MlmeConfirm.MlmeRequest == MLME_JOIN))
     {
-        LastTxIsJoinRequest = true;
+        MacCtx->LastTxIsJoinRequest = true;
     }
     else
     {
-        LastTxIsJoinRequest = false;
+        MacCtx->LastTxIsJoinRequest = false;
     }
 
     // Store last Tx channel
-    LastTxChannel = Channel;
+    MacCtx->LastTxChannel = MacCtx->Channel;
     // Update last tx done time for the current channel
-    txDone.Channel = Channel;
+    txDone.Channel = MacCtx->Channel;
     txDone.Joined = IsLoRaMacNetworkJoined;
     txDone.LastTxDoneTime = curTime;
     RegionSetBandTxDone(LoRaMacRegion, &txDone);
     // Update Aggregated last tx done time
-    AggregatedLastTxDoneTime = curTime;
+    MacCtx->AggregatedLastTxDoneTime = curTime;
 
-    if (NodeAckRequested == false)
+    if (MacCtx->NodeAckRequested == false)
     {
-        McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+        MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
 #ifdef CONFIG_LWAN
-        McpsConfirm.NbRetries++;
+        MacCtx->McpsConfirm.NbRetries++;
 #endif
-        ChannelsNbRepCounter++;
+        MacCtx->ChannelsNbRepCounter++;
     }
 #ifdef CONFIG_LORA_VERIFY
     if (g_lora_debug)
@@ -794,7 +890,7 @@ static void PrepareRxDoneAbort(void)
 {
     LoRaMacState |= LORAMAC_RX_ABORT;
 
-    if (NodeAckRequested)
+    if (MacCtx->NodeAckRequested)
     {
         OnAckTimeoutTimerEvent();
     }
@@ -803,18 +899,20 @@ static void PrepareRxDoneAbort(void)
     LoRaMacFlags.Bits.MacDone = 1;
 
     // Trig OnMacCheckTimerEvent call as soon as possible
-    TimerSetValue(&MacStateCheckTimer, 1);
-    TimerStart(&MacStateCheckTimer);
+    TimerSetValue(&MacCtx->MacStateCheckTimer, 1);
+    TimerStart(&MacCtx->MacStateCheckTimer);
 }
 
 void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 {
     DIO_PRINTF("Event : Rx Done\r\n");
+    TRACE_EVENT(TRACE_MAC_RX_DONE, size, rssi, snr);
 #ifdef CLASS_A_WOTA
     if (wota_CadStarted)
         wota_CadStarted = false;
 #endif
     uint8_t *temp = payload;
+    uint8_t joinAccept[LORAMAC_JOIN_ACCEPT_MAX_SIZE];
     LoRaMacHeader_t macHdr;
     LoRaMacFrameCtrl_t fCtrl;
     ApplyCFListParams_t applyCFList;
@@ -835,61 +933,83 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
     uint32_t downLinkCounter = 0;
 
     MulticastParams_t *curMulticastParams = NULL;
-    uint8_t *nwkSKey = LoRaMacNwkSKey;
-    uint8_t *appSKey = LoRaMacAppSKey;
+    uint8_t *nwkSKey = MacCtx->LoRaMacNwkSKey;
+    uint8_t *appSKey = MacCtx->LoRaMacAppSKey;
 
     uint8_t multicast = 0;
 
     bool isMicOk = false;
 
-    McpsConfirm.AckReceived = false;
+    bool rxTimingValid = false;
+    int32_t rxTimingError = 0;
+
+    // Start of frame against the nominal class A window start, taken now
+    // because a join accept changes the receive delays
+    if ((MacCtx->RxSlot == RX_SLOT_WIN_1) || (MacCtx->RxSlot == RX_SLOT_WIN_2))
+    {
+        uint32_t rxDelay;
+
+        if (IsLoRaMacNetworkJoined == false)
+        {
+            rxDelay = (MacCtx->RxSlot == RX_SLOT_WIN_1) ? LoRaMacParams.JoinAcceptDelay1 : LoRaMacParams.JoinAcceptDelay2;
+        }
+        else
+        {
+            rxDelay = (MacCtx->RxSlot == RX_SLOT_WIN_1) ? LoRaMacParams.ReceiveDelay1 : LoRaMacParams.ReceiveDelay2;
+        }
+        rxTimingError = (int32_t)(TimerGetElapsedTime(MacCtx->AggregatedLastTxDoneTime) - Radio.TimeOnAir(MODEM_LORA, size)) -
+                        (int32_t)rxDelay;
+        rxTimingValid = true;
+    }
+
+    MacCtx->McpsConfirm.AckReceived = false;
 #ifdef CONFIG_LWAN
-    MlmeConfirm.Rssi = rssi;
-    MlmeConfirm.Snr = snr;
-    McpsIndication.DevTimeAnsReceived = false;
-    McpsIndication.LinkCheckAnsReceived = false;
-    McpsIndication.UplinkNeeded = false;
+    MacCtx->MlmeConfirm.Rssi = rssi;
+    MacCtx->MlmeConfirm.Snr = snr;
+    MacCtx->McpsIndication.DevTimeAnsReceived = false;
+    MacCtx->McpsIndication.LinkCheckAnsReceived = false;
+    MacCtx->McpsIndication.UplinkNeeded = false;
 #endif
-    McpsIndication.Rssi = rssi;
-    McpsIndication.Snr = snr;
-    McpsIndication.RxSlot = RxSlot;
-    McpsIndication.Port = 0;
-    McpsIndication.Multicast = 0;
-    McpsIndication.FramePending = 0;
-    McpsIndication.Buffer = NULL;
-    McpsIndication.BufferSize = 0;
-    McpsIndication.RxData = false;
-    McpsIndication.AckReceived = false;
-    McpsIndication.DownLinkCounter = 0;
-    McpsIndication.McpsIndication = MCPS_UNCONFIRMED;
+    MacCtx->McpsIndication.Rssi = rssi;
+    MacCtx->McpsIndication.Snr = snr;
+    MacCtx->McpsIndication.RxSlot = MacCtx->RxSlot;
+    MacCtx->McpsIndication.Port = 0;
+    MacCtx->McpsIndication.Multicast = 0;
+    MacCtx->McpsIndication.FramePending = 0;
+    MacCtx->McpsIndication.Buffer = NULL;
+    MacCtx->McpsIndication.BufferSize = 0;
+    MacCtx->McpsIndication.RxData = false;
+    MacCtx->McpsIndication.AckReceived = false;
+    MacCtx->McpsIndication.DownLinkCounter = 0;
+    MacCtx->McpsIndication.McpsIndication = MCPS_UNCONFIRMED;
 
     Radio.Sleep();
-    TimerStop(&RxWindowTimer2);
+    TimerStop(&MacCtx->RxWindowTimer2);
 
     // This function must be called even if we are not in class b mode yet.
     if (LoRaMacClassBRxBeacon(payload, size) == true)
     {
-        MlmeIndication.BeaconInfo.Rssi = rssi;
-        MlmeIndication.BeaconInfo.Snr = snr;
+        MacCtx->MlmeIndication.BeaconInfo.Rssi = rssi;
+        MacCtx->MlmeIndication.BeaconInfo.Snr = snr;
 #ifdef LORAMAC_CLASSB_TESTCASE
         DBG_PRINTF("receive beacon\r\n");
 #endif
         return;
     }
     // Check if we expect a ping or a multicast slot.
-    if (LoRaMacDeviceClass == CLASS_B)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_B)
     {
         if (LoRaMacClassBIsPingExpected() == true)
         {
             LoRaMacClassBSetPingSlotState(PINGSLOT_STATE_SET_TIMER);
             LoRaMacClassBPingSlotTimerEvent();
-            McpsIndication.RxSlot = RX_SLOT_WIN_PING_SLOT;
+            MacCtx->McpsIndication.RxSlot = RX_SLOT_WIN_PING_SLOT;
         }
         else if (LoRaMacClassBIsMulticastExpected() == true)
         {
             LoRaMacClassBSetMulticastSlotState(PINGSLOT_STATE_SET_TIMER);
             LoRaMacClassBMulticastSlotTimerEvent();
-            McpsIndication.RxSlot = RX_SLOT_WIN_MULTICAST_SLOT;
+            MacCtx->McpsIndication.RxSlot = RX_SLOT_WIN_MULTICAST_SLOT;
         }
     }
 
@@ -899,41 +1019,52 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
     case FRAME_TYPE_JOIN_ACCEPT:
         if (IsLoRaMacNetworkJoined == true)
         {
-            McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+            MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+            PrepareRxDoneAbort();
+            return;
+        }
+        if (size > LORAMAC_JOIN_ACCEPT_MAX_SIZE)
+        {
+            MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
             PrepareRxDoneAbort();
             return;
         }
-        LoRaMacJoinDecrypt(payload + 1, size - 1, LoRaMacAppKey, LoRaMacRxPayload + 1);
+        // Decrypted aside, the stored network info is the frame as received
+        LoRaMacJoinDecrypt(payload + 1, size - 1, LoRaMacAppKey, joinAccept + 1);
 
-        LoRaMacRxPayload[0] = macHdr.Value;
+        joinAccept[0] = macHdr.Value;
 
-        LoRaMacJoinComputeMic(LoRaMacRxPayload, size - LORAMAC_MFR_LEN, LoRaMacAppKey, &mic);
+        LoRaMacJoinComputeMic(joinAccept, size - LORAMAC_MFR_LEN, LoRaMacAppKey, &mic);
 
-        micRx |= (uint32_t)LoRaMacRxPayload[size - LORAMAC_MFR_LEN];
-        micRx |= ((uint32_t)LoRaMacRxPayload[size - LORAMAC_MFR_LEN + 1] << 8);
-        micRx |= ((uint32_t)LoRaMacRxPayload[size - LORAMAC_MFR_LEN + 2] << 16);
-        micRx |= ((uint32_t)LoRaMacRxPayload[size - LORAMAC_MFR_LEN + 3] << 24);
+        micRx |= (uint32_t)joinAccept[size - LORAMAC_MFR_LEN];
+        micRx |= ((uint32_t)joinAccept[size - LORAMAC_MFR_LEN + 1] << 8);
+        micRx |= ((uint32_t)joinAccept[size - LORAMAC_MFR_LEN + 2] << 16);
+        micRx |= ((uint32_t)joinAccept[size - LORAMAC_MFR_LEN + 3] << 24);
         if (LoRaMacConfirmQueueIsCmdActive(MLME_JOIN) == true)
         {
             if (micRx == mic)
             {
-                LoRaMacJoinComputeSKeys(LoRaMacAppKey, LoRaMacRxPayload + 1, LoRaMacDevNonce, LoRaMacNwkSKey, LoRaMacAppSKey);
+                if (rxTimingValid == true)
+                {
+                    LoRaMacRxTimingAddSample(rxTimingError);
+                }
+                LoRaMacJoinComputeSKeys(LoRaMacAppKey, joinAccept + 1, LoRaMacDevNonce, MacCtx->LoRaMacNwkSKey, MacCtx->LoRaMacAppSKey);
 
-                LoRaMacNetID = (uint32_t)LoRaMacRxPayload[4];
-                LoRaMacNetID |= ((uint32_t)LoRaMacRxPayload[5] << 8);
-                LoRaMacNetID |= ((uint32_t)LoRaMacRxPayload[6] << 16);
+                MacCtx->LoRaMacNetID = (uint32_t)joinAccept[4];
+                MacCtx->LoRaMacNetID |= ((uint32_t)joinAccept[5] << 8);
+                MacCtx->LoRaMacNetID |= ((uint32_t)joinAccept[6] << 16);
 
-                LoRaMacDevAddr = (uint32_t)LoRaMacRxPayload[7];
-                LoRaMacDevAddr |= ((uint32_t)LoRaMacRxPayload[8] << 8);
-                LoRaMacDevAddr |= ((uint32_t)LoRaMacRxPayload[9] << 16);
-                LoRaMacDevAddr |= ((uint32_t)LoRaMacRxPayload[10] << 24);
+                MacCtx->LoRaMacDevAddr = (uint32_t)joinAccept[7];
+                MacCtx->LoRaMacDevAddr |= ((uint32_t)joinAccept[8] << 8);
+                MacCtx->LoRaMacDevAddr |= ((uint32_t)joinAccept[9] << 16);
+                MacCtx->LoRaMacDevAddr |= ((uint32_t)joinAccept[10] << 24);
 
                 // DLSettings
-                LoRaMacParams.Rx1DrOffset = (LoRaMacRxPayload[11] >> 4) & 0x07;
-                LoRaMacParams.Rx2Channel.Datarate = LoRaMacRxPayload[11] & 0x0F;
+                LoRaMacParams.Rx1DrOffset = (joinAccept[11] >> 4) & 0x07;
+                LoRaMacParams.Rx2Channel.Datarate = joinAccept[11] & 0x0F;
 
                 // RxDelay
-                LoRaMacParams.ReceiveDelay1 = (LoRaMacRxPayload[12] & 0x0F);
+                LoRaMacParams.ReceiveDelay1 = (joinAccept[12] & 0x0F);
                 if (LoRaMacParams.ReceiveDelay1 == 0)
                 {
                     LoRaMacParams.ReceiveDelay1 = 1;
@@ -948,7 +1079,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                 }
 #endif
                 // Apply CF list
-                applyCFList.Payload = &LoRaMacRxPayload[13];
+                applyCFList.Payload = &joinAccept[13];
                 // Size of the regular payload is 12. Plus 1 byte MHDR and 4 bytes MIC
                 applyCFList.Size = size - 17;
 
@@ -972,8 +1103,8 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
     {
         // Check if the received payload size is valid
         getPhy.UplinkDwellTime = LoRaMacParams.DownlinkDwellTime;
-        getPhy.Datarate = McpsIndication.RxDatarate;
-        McpsIndication.RxDoneDatarate = McpsIndication.RxDatarate;
+        getPhy.Datarate = MacCtx->McpsIndication.RxDatarate;
+        MacCtx->McpsIndication.RxDoneDatarate = MacCtx->McpsIndication.RxDatarate;
         getPhy.Attribute = PHY_MAX_PAYLOAD;
 
         // Get the maximum payload length
@@ -984,7 +1115,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
         phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
         if (MAX(0, (int16_t)((int16_t)size - (int16_t)LORA_MAC_FRMPAYLOAD_OVERHEAD)) > phyParam.Value)
         {
-            McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+            MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
             PrepareRxDoneAbort();
             return;
         }
@@ -996,9 +1127,9 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 
         fCtrl.Value = payload[pktHeaderLen++];
 
-        if (address != LoRaMacDevAddr)
+        if (address != MacCtx->LoRaMacDevAddr)
         {
-            curMulticastParams = MulticastChannels;
+            curMulticastParams = MacCtx->MulticastChannels;
             while (curMulticastParams != NULL)
             {
                 if (address == curMulticastParams->Address)
@@ -1014,7 +1145,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
             if (multicast == 0)
             {
                 // We are not the destination of this frame.
-                McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL;
+                MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL;
                 PrepareRxDoneAbort();
                 return;
             }
@@ -1023,7 +1154,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                 (fCtrl.Bits.AdrAckReq == 1))
             {
                 // Wrong multicast message format. Refer to chapter 11.2.2 of the specification
-                McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_MULTICAST_FAIL;
+                MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_MULTICAST_FAIL;
                 PrepareRxDoneAbort();
                 return;
             }
@@ -1031,8 +1162,8 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
         else
         {
             multicast = 0;
-            nwkSKey = LoRaMacNwkSKey;
-            appSKey = LoRaMacAppSKey;
+            nwkSKey = MacCtx->LoRaMacNwkSKey;
+            appSKey = MacCtx->LoRaMacAppSKey;
             downLinkCounter = DownLinkCounter;
         }
 
@@ -1074,35 +1205,39 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
         phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
         if (sequenceCounterDiff >= phyParam.Value)
         {
-            McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_TOO_MANY_FRAMES_LOSS;
-            McpsIndication.DownLinkCounter = downLinkCounter;
+            MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_TOO_MANY_FRAMES_LOSS;
+            MacCtx->McpsIndication.DownLinkCounter = downLinkCounter;
             PrepareRxDoneAbort();
             return;
         }
 
         if (isMicOk == true)
         {
-            McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-            McpsIndication.Multicast = multicast;
-            McpsIndication.FramePending = fCtrl.Bits.FPending;
-            McpsIndication.Buffer = NULL;
-            McpsIndication.BufferSize = 0;
-            McpsIndication.DownLinkCounter = downLinkCounter;
-            McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+            if ((rxTimingValid == true) && (multicast == 0))
+            {
+                LoRaMacRxTimingAddSample(rxTimingError);
+            }
+            MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+            MacCtx->McpsIndication.Multicast = multicast;
+            MacCtx->McpsIndication.FramePending = fCtrl.Bits.FPending;
+            MacCtx->McpsIndication.Buffer = NULL;
+            MacCtx->McpsIndication.BufferSize = 0;
+            MacCtx->McpsIndication.DownLinkCounter = downLinkCounter;
+            MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
 
-            AdrAckCounter = 0;
-            MacCommandsBufferToRepeatIndex = 0;
+            MacCtx->AdrAckCounter = 0;
+            MacCtx->MacCommandsBufferToRepeatIndex = 0;
 
             // Update 32 bits downlink counter
             if (multicast == 1)
             {
-                McpsIndication.McpsIndication = MCPS_MULTICAST;
+                MacCtx->McpsIndication.McpsIndication = MCPS_MULTICAST;
 
                 if ((curMulticastParams->DownLinkCounter == downLinkCounter) &&
                     (curMulticastParams->DownLinkCounter != 0))
                 {
-                    McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_REPEATED;
-                    McpsIndication.DownLinkCounter = downLinkCounter;
+                    MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_REPEATED;
+                    MacCtx->McpsIndication.DownLinkCounter = downLinkCounter;
                     PrepareRxDoneAbort();
                     return;
                 }
@@ -1112,8 +1247,8 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
             {
                 if (macHdr.Bits.MType == FRAME_TYPE_DATA_CONFIRMED_DOWN)
                 {
-                    SrvAckRequested = true;
-                    McpsIndication.McpsIndication = MCPS_CONFIRMED;
+                    MacCtx->SrvAckRequested = true;
+                    MacCtx->McpsIndication.McpsIndication = MCPS_CONFIRMED;
 
                     if ((DownLinkCounter == downLinkCounter) &&
                         (DownLinkCounter != 0))
@@ -1128,14 +1263,14 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                 }
                 else
                 {
-                    SrvAckRequested = false;
-                    McpsIndication.McpsIndication = MCPS_UNCONFIRMED;
+                    MacCtx->SrvAckRequested = false;
+                    MacCtx->McpsIndication.McpsIndication = MCPS_UNCONFIRMED;
 
                     if ((DownLinkCounter == downLinkCounter) &&
                         (DownLinkCounter != 0))
                     {
-                        McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_REPEATED;
-                        McpsIndication.DownLinkCounter = downLinkCounter;
+                        MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_DOWNLINK_REPEATED;
+                        MacCtx->McpsIndication.DownLinkCounter = downLinkCounter;
                         PrepareRxDoneAbort();
                         return;
                     }
@@ -1151,21 +1286,21 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
             // We need to reset the MacCommandsBufferIndex here, since we need
             // to take retransmissions and repetitions into account. Error cases
             // will be handled in function OnMacStateCheckTimerEvent.
-            if (McpsConfirm.McpsRequest == MCPS_CONFIRMED)
+            if (MacCtx->McpsConfirm.McpsRequest == MCPS_CONFIRMED)
             {
                 if (fCtrl.Bits.Ack == 1)
                 {
                     // Reset MacCommandsBufferIndex when we have received an ACK.
-                    MacCommandsBufferIndex = 0;
+                    MacCtx->MacCommandsBufferIndex = 0;
                     // Update acknowledgement information
-                    McpsConfirm.AckReceived = fCtrl.Bits.Ack;
-                    McpsIndication.AckReceived = fCtrl.Bits.Ack;
+                    MacCtx->McpsConfirm.AckReceived = fCtrl.Bits.Ack;
+                    MacCtx->McpsIndication.AckReceived = fCtrl.Bits.Ack;
                 }
             }
             else
             {
                 // Reset the variable if we have received any valid frame.
-                MacCommandsBufferIndex = 0;
+                MacCtx->MacCommandsBufferIndex = 0;
             }
             port = payload[appPayloadStartIndex];
             // Process payload and MAC commands
@@ -1174,28 +1309,29 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                 port = payload[appPayloadStartIndex++];
                 frameLen = (size - 4) - appPayloadStartIndex;
 
-                McpsIndication.Port = port;
+                MacCtx->McpsIndication.Port = port;
                 if (port == 0)
                 {
                     // Only allow frames which do not have fOpts
                     if ((fCtrl.Bits.FOptsLen == 0) && (multicast == 0))
                     {
+                        // The MIC is checked, the frame is decrypted in place
                         LoRaMacPayloadDecrypt(payload + appPayloadStartIndex,
                                               frameLen,
                                               nwkSKey,
                                               address,
                                               DOWN_LINK,
                                               downLinkCounter,
-                                              LoRaMacRxPayload);
+                                              payload + appPayloadStartIndex);
                         // Decode frame payload MAC commands
-                        ProcessMacCommands(LoRaMacRxPayload, 0, frameLen, snr, McpsIndication.RxSlot);
+                        ProcessMacCommands(payload + appPayloadStartIndex, 0, frameLen, snr, MacCtx->McpsIndication.RxSlot);
                     }
                     else
                     {
                         LoRaMacFlags.Bits.McpsIndSkip = 1;
                         // This is not a valid frame. Drop it and reset the ACK bits
-                        McpsConfirm.AckReceived = false;
-                        McpsIndication.AckReceived = false;
+                        MacCtx->McpsConfirm.AckReceived = false;
+                        MacCtx->McpsIndication.AckReceived = false;
 #ifdef CONFIG_LORA_VERIFY
                         if (g_lora_debug)
                             PRINTF_RAW("CMD exist at FRMpayload and Fopts, ignore it\r\n");
@@ -1207,7 +1343,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                     if ((fCtrl.Bits.FOptsLen > 0) && (multicast == 0))
                     {
                         // Decode Options field MAC commands. Omit the fPort.
-                        ProcessMacCommands(payload, 8, appPayloadStartIndex - 1, snr, McpsIndication.RxSlot);
+                        ProcessMacCommands(payload, 8, appPayloadStartIndex - 1, snr, MacCtx->McpsIndication.RxSlot);
                     }
 
                     LoRaMacPayloadDecrypt(payload + appPayloadStartIndex,
@@ -1216,11 +1352,11 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                                           address,
                                           DOWN_LINK,
                                           downLinkCounter,
-                                          LoRaMacRxPayload);
+                                          payload + appPayloadStartIndex);
 
-                    McpsIndication.Buffer = LoRaMacRxPayload;
-                    McpsIndication.BufferSize = frameLen;
-                    McpsIndication.RxData = true;
+                    MacCtx->McpsIndication.Buffer = payload + appPayloadStartIndex;
+                    MacCtx->McpsIndication.BufferSize = frameLen;
+                    MacCtx->McpsIndication.RxData = true;
                 }
             }
             else
@@ -1228,7 +1364,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                 if (fCtrl.Bits.FOptsLen > 0)
                 {
                     // Decode Options field MAC commands
-                    ProcessMacCommands(payload, 8, appPayloadStartIndex, snr, McpsIndication.RxSlot);
+                    ProcessMacCommands(payload, 8, appPayloadStartIndex, snr, MacCtx->McpsIndication.RxSlot);
                 }
             }
 
@@ -1244,7 +1380,7 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
                 PRINTF_RAW("MIC verify failed ignore the frame\r\n");
             }
 #endif
-            McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_MIC_FAIL;
+            MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_MIC_FAIL;
 
             PrepareRxDoneAbort();
             return;
@@ -1253,12 +1389,10 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
     break;
     case FRAME_TYPE_PROPRIETARY:
     {
-        memcpy1(LoRaMacRxPayload, &payload[pktHeaderLen], size);
-
-        McpsIndication.McpsIndication = MCPS_PROPRIETARY;
-        McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-        McpsIndication.Buffer = LoRaMacRxPayload;
-        McpsIndication.BufferSize = size - pktHeaderLen;
+        MacCtx->McpsIndication.McpsIndication = MCPS_PROPRIETARY;
+        MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+        MacCtx->McpsIndication.Buffer = &payload[pktHeaderLen];
+        MacCtx->McpsIndication.BufferSize = size - pktHeaderLen;
 
         LoRaMacFlags.Bits.McpsInd = 1;
         break;
@@ -1268,35 +1402,36 @@ void OnRadioRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
         if (g_lora_debug)
             PRINTF_RAW("Download frame %d being received but not process it\r\n", macHdr.Bits.MType);
 #endif
-        McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+        MacCtx->McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
         PrepareRxDoneAbort();
         break;
     }
     // Verify if we need to disable the AckTimeoutTimer
-    CheckToDisableAckTimeout(NodeAckRequested, LoRaMacDeviceClass, McpsConfirm.AckReceived,
-                             AckTimeoutRetriesCounter, AckTimeoutRetries);
-    if (AckTimeoutTimer.IsRunning == false)
+    CheckToDisableAckTimeout(MacCtx->NodeAckRequested, MacCtx->LoRaMacDeviceClass, MacCtx->McpsConfirm.AckReceived,
+                             MacCtx->AckTimeoutRetriesCounter, MacCtx->AckTimeoutRetries);
+    if (MacCtx->AckTimeoutTimer.IsRunning == false)
     { // Procedure is completed when the AckTimeoutTimer is not running anymore
         LoRaMacFlags.Bits.MacDone = 1;
         // Trig OnMacCheckTimerEvent call as soon as possible
-        TimerSetValue(&MacStateCheckTimer, 1);
-        TimerStart(&MacStateCheckTimer);
+        TimerSetValue(&MacCtx->MacStateCheckTimer, 1);
+        TimerStart(&MacCtx->MacStateCheckTimer);
     }
 }
 
 static void OnRadioTxTimeout(void)
 {
     DIO_PRINTF("Event : Tx Timeout\r\n");
+    TRACE_EVENT(TRACE_MAC_TX_TIMEOUT);
 
     Radio.Init(&RadioEvents);
     // Random seed initialization
     srand1(Radio.Random());
 
-    PublicNetwork = true;
+    MacCtx->PublicNetwork = true;
     Radio.SetPublicNetwork(true);
     Radio.Sleep();
 
-    if (LoRaMacDeviceClass != CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass != CLASS_C)
     {
         Radio.Sleep();
     }
@@ -1305,7 +1440,7 @@ static void OnRadioTxTimeout(void)
         OpenContinuousRx2Window();
     }
 
-    McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT;
+    MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT;
     LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT);
     LoRaMacFlags.Bits.MacDone = 1;
 #ifdef CONFIG_LWAN
@@ -1319,13 +1454,14 @@ static void OnRadioTxTimeout(void)
 static void OnRadioRxError(void)
 {
     DIO_PRINTF("Event : Rx Error\r\n");
+    TRACE_EVENT(TRACE_MAC_RX_ERROR);
 #ifdef CLASS_A_WOTA
     if (wota_CadStarted)
         wota_CadStarted = false;
 #endif
     bool classBRx = false;
 
-    if (LoRaMacDeviceClass != CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass != CLASS_C)
     {
         Radio.Sleep();
     }
@@ -1336,7 +1472,7 @@ static void OnRadioRxError(void)
         LoRaMacClassBBeaconTimerEvent();
         classBRx = true;
     }
-    if (LoRaMacDeviceClass == CLASS_B)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_B)
     {
         if (LoRaMacClassBIsPingExpected() == true)
         {
@@ -1354,39 +1490,39 @@ static void OnRadioRxError(void)
 
     if (classBRx == false)
     {
-        if (RxSlot == RX_SLOT_WIN_1)
+        if (MacCtx->RxSlot == RX_SLOT_WIN_1)
         {
-            if (NodeAckRequested == true)
+            if (MacCtx->NodeAckRequested == true)
             {
-                McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX1_ERROR;
+                MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX1_ERROR;
             }
             LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_RX1_ERROR);
 
-            if (LoRaMacDeviceClass != CLASS_C)
+            if (MacCtx->LoRaMacDeviceClass != CLASS_C)
             {
-                if (TimerGetElapsedTime(AggregatedLastTxDoneTime) >= RxWindow2Delay)
+                if (TimerGetElapsedTime(MacCtx->AggregatedLastTxDoneTime) >= MacCtx->RxWindow2Delay)
                 {
-                    TimerStop(&RxWindowTimer2);
+                    TimerStop(&MacCtx->RxWindowTimer2);
                     LoRaMacFlags.Bits.MacDone = 1;
                 }
             }
         }
         else
         {
-            if (NodeAckRequested == true)
+            if (MacCtx->NodeAckRequested == true)
             {
-                McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX2_ERROR;
+                MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX2_ERROR;
             }
             LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_RX2_ERROR);
 
-            if (LoRaMacDeviceClass != CLASS_C)
+            if (MacCtx->LoRaMacDeviceClass != CLASS_C)
             {
                 LoRaMacFlags.Bits.MacDone = 1;
             }
         }
     }
 
-    if (LoRaMacDeviceClass == CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_C)
     {
         OpenContinuousRx2Window();
     }
@@ -1398,6 +1534,7 @@ static void OnRadioRxError(void)
 static void OnRadioRxTimeout(void)
 {
     DIO_PRINTF("Event : Rx Timeout\r\n");
+    TRACE_EVENT(TRACE_MAC_RX_TIMEOUT);
 
 #ifdef CLASS_A_WOTA
     if (wota_CadStarted)
@@ -1406,7 +1543,7 @@ static void OnRadioRxTimeout(void)
 
     bool classBRx = false;
 
-    if (LoRaMacDeviceClass != CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass != CLASS_C)
     {
         Radio.Sleep();
     }
@@ -1417,7 +1554,7 @@ static void OnRadioRxTimeout(void)
         LoRaMacClassBBeaconTimerEvent();
         classBRx = true;
     }
-    if (LoRaMacDeviceClass == CLASS_B)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_B)
     {
         if (LoRaMacClassBIsPingExpected() == true)
         {
@@ -1435,39 +1572,44 @@ static void OnRadioRxTimeout(void)
 
     if (classBRx == false)
     {
-        if (RxSlot == RX_SLOT_WIN_1)
+        if (MacCtx->RxSlot == RX_SLOT_WIN_1)
         {
-            if (NodeAckRequested == true)
+            if (MacCtx->NodeAckRequested == true)
             {
-                McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT;
+                MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT;
             }
             LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT);
 
-            if (LoRaMacDeviceClass != CLASS_C)
+            if (MacCtx->LoRaMacDeviceClass != CLASS_C)
             {
-                if (TimerGetElapsedTime(AggregatedLastTxDoneTime) >= RxWindow2Delay)
+                if (TimerGetElapsedTime(MacCtx->AggregatedLastTxDoneTime) >= MacCtx->RxWindow2Delay)
                 {
-                    TimerStop(&RxWindowTimer2);
+                    TimerStop(&MacCtx->RxWindowTimer2);
                     LoRaMacFlags.Bits.MacDone = 1;
                 }
             }
         }
         else
         {
-            if (NodeAckRequested == true)
+            if (MacCtx->NodeAckRequested == true)
+            {
+                MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT;
+            }
+            if ((MacCtx->NodeAckRequested == true) || (LoRaMacConfirmQueueIsCmdActive(MLME_JOIN) == true))
             {
-                McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT;
+                // An answer was due, do not trust the narrow windows
+                LoRaMacRxTimingMiss();
             }
             LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT);
 
-            if (LoRaMacDeviceClass != CLASS_C)
+            if (MacCtx->LoRaMacDeviceClass != CLASS_C)
             {
                 LoRaMacFlags.Bits.MacDone = 1;
             }
         }
     }
 
-    if (LoRaMacDeviceClass == CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_C)
     {
         OpenContinuousRx2Window();
     }
@@ -1497,7 +1639,7 @@ static void OnMacStateCheckTimerEvent(void)
     PhyParam_t phyParam;
     bool noTx = false;
 
-    TimerStop(&MacStateCheckTimer);
+    TimerStop(&MacCtx->MacStateCheckTimer);
 
     if (LoRaMacFlags.Bits.MacDone == 1)
     {
@@ -1513,16 +1655,16 @@ static void OnMacStateCheckTimerEvent(void)
         if ((LoRaMacFlags.Bits.MlmeReq == 1) || ((LoRaMacFlags.Bits.McpsReq == 1)))
         {
             // Get a status of any request and check if we have a TX timeout
-            MlmeConfirm.Status = LoRaMacConfirmQueueGetStatusCmn();
-            if ((McpsConfirm.Status == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT) ||
-                (MlmeConfirm.Status == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT))
+            MacCtx->MlmeConfirm.Status = LoRaMacConfirmQueueGetStatusCmn();
+            if ((MacCtx->McpsConfirm.Status == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT) ||
+                (MacCtx->MlmeConfirm.Status == LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT))
             {
                 // Stop transmit cycle due to tx timeout.
                 LoRaMacState &= ~LORAMAC_TX_RUNNING;
-                MacCommandsBufferIndex = 0;
-                McpsConfirm.NbRetries = AckTimeoutRetriesCounter;
-                McpsConfirm.AckReceived = false;
-                McpsConfirm.TxTimeOnAir = 0;
+                MacCtx->MacCommandsBufferIndex = 0;
+                MacCtx->McpsConfirm.NbRetries = MacCtx->AckTimeoutRetriesCounter;
+                MacCtx->McpsConfirm.AckReceived = false;
+                MacCtx->McpsConfirm.TxTimeOnAir = 0;
                 noTx = true;
             }
 
@@ -1537,14 +1679,14 @@ static void OnMacStateCheckTimerEvent(void)
             }
         }
 
-        if ((NodeAckRequested == false) && (noTx == false))
+        if ((MacCtx->NodeAckRequested == false) && (noTx == false))
         {
             if ((LoRaMacFlags.Bits.MlmeReq == 1) || ((LoRaMacFlags.Bits.McpsReq == 1)))
             {
-                if ((LoRaMacFlags.Bits.MlmeReq == 1) && (MlmeConfirm.MlmeRequest == MLME_JOIN))
+                if ((LoRaMacFlags.Bits.MlmeReq == 1) && (MacCtx->MlmeConfirm.MlmeRequest == MLME_JOIN))
                 {
                     // Procedure for the join request
-                    MlmeConfirm.NbRetries = JoinRequestTrials;
+                    MacCtx->MlmeConfirm.NbRetries = MacCtx->JoinRequestTrials;
 
                     if (LoRaMacConfirmQueueGetStatus(MLME_JOIN) == LORAMAC_EVENT_INFO_STATUS_OK)
                     {
@@ -1554,12 +1696,12 @@ static void OnMacStateCheckTimerEvent(void)
                         if (g_lora_debug)
                             PRINTF_RAW("Join done, UpLinkCounter:%u\r\n", (unsigned int)UpLinkCounter);
 #endif
-                        ChannelsNbRepCounter = 0;
+                        MacCtx->ChannelsNbRepCounter = 0;
                         LoRaMacState &= ~LORAMAC_TX_RUNNING;
                     }
                     else
                     {
-                        if (JoinRequestTrials >= MaxJoinRequestTrials)
+                        if (MacCtx->JoinRequestTrials >= MacCtx->MaxJoinRequestTrials)
                         {
                             LoRaMacState &= ~LORAMAC_TX_RUNNING;
                         }
@@ -1579,19 +1721,19 @@ static void OnMacStateCheckTimerEvent(void)
                 else
                 {
                     // Procedure for all other frames
-                    if ((ChannelsNbRepCounter >= LoRaMacParams.ChannelsNbRep) || (LoRaMacFlags.Bits.McpsInd == 1))
+                    if ((MacCtx->ChannelsNbRepCounter >= LoRaMacParams.ChannelsNbRep) || (LoRaMacFlags.Bits.McpsInd == 1))
                     {
                         if (LoRaMacFlags.Bits.McpsInd == 0)
                         {
                             // Maximum repetitions without downlink. Reset MacCommandsBufferIndex. Increase ADR Ack counter.
                             // Only process the case when the MAC did not receive a downlink.
-                            MacCommandsBufferIndex = 0;
-                            AdrAckCounter++;
+                            MacCtx->MacCommandsBufferIndex = 0;
+                            MacCtx->AdrAckCounter++;
                         }
 
-                        ChannelsNbRepCounter = 0;
+                        MacCtx->ChannelsNbRepCounter = 0;
 
-                        if (IsUpLinkCounterFixed == false)
+                        if (MacCtx->IsUpLinkCounterFixed == false)
                         {
                             UpLinkCounter++;
                             // TODO:uncomment all of them when LORAWAN_Net_Reserve is on
@@ -1618,11 +1760,11 @@ static void OnMacStateCheckTimerEvent(void)
         if (LoRaMacFlags.Bits.McpsInd == 1)
         {
             // Procedure if we received a frame
-            if ((McpsConfirm.AckReceived == true) || (AckTimeoutRetriesCounter > AckTimeoutRetries))
+            if ((MacCtx->McpsConfirm.AckReceived == true) || (MacCtx->AckTimeoutRetriesCounter > MacCtx->AckTimeoutRetries))
             {
-                AckTimeoutRetry = false;
-                NodeAckRequested = false;
-                if (IsUpLinkCounterFixed == false)
+                MacCtx->AckTimeoutRetry = false;
+                MacCtx->NodeAckRequested = false;
+                if (MacCtx->IsUpLinkCounterFixed == false)
                 {
                     UpLinkCounter++;
                     // saveUpCnt();
@@ -1632,7 +1774,7 @@ static void OnMacStateCheckTimerEvent(void)
                         PRINTF_RAW("Confirmed data received ACK, UpLinkCounter:%u\r\n", (unsigned int)UpLinkCounter);
 #endif
                 }
-                McpsConfirm.NbRetries = AckTimeoutRetriesCounter;
+                MacCtx->McpsConfirm.NbRetries = MacCtx->AckTimeoutRetriesCounter;
 
                 LoRaMacState &= ~LORAMAC_TX_RUNNING;
             }
@@ -1640,21 +1782,21 @@ static void OnMacStateCheckTimerEvent(void)
         }
         else
         {
-            if (!((LoRaMacFlags.Bits.MlmeReq == 1) && (MlmeConfirm.MlmeRequest == MLME_JOIN)))
+            if (!((LoRaMacFlags.Bits.MlmeReq == 1) && (MacCtx->MlmeConfirm.MlmeRequest == MLME_JOIN)))
                 lwan_dev_status_set(DEVICE_STATUS_SEND_PASS_WITHOUT_DL);
         }
 #else
         }
 #endif
-        if ((AckTimeoutRetry == true) && ((LoRaMacState & LORAMAC_TX_DELAYED) == 0))
+        if ((MacCtx->AckTimeoutRetry == true) && ((LoRaMacState & LORAMAC_TX_DELAYED) == 0))
         {
             // Retransmissions procedure for confirmed uplinks
-            AckTimeoutRetry = false;
-            if ((AckTimeoutRetriesCounter < AckTimeoutRetries) && (AckTimeoutRetriesCounter <= MAX_ACK_RETRIES))
+            MacCtx->AckTimeoutRetry = false;
+            if ((MacCtx->AckTimeoutRetriesCounter < MacCtx->AckTimeoutRetries) && (MacCtx->AckTimeoutRetriesCounter <= MAX_ACK_RETRIES))
             {
-                AckTimeoutRetriesCounter++;
+                MacCtx->AckTimeoutRetriesCounter++;
 
-                if ((AckTimeoutRetriesCounter % 2) == 1)
+                if ((MacCtx->AckTimeoutRetriesCounter % 2) == 1)
                 {
                     getPhy.Attribute = PHY_NEXT_LOWER_TX_DR;
                     getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
@@ -1670,15 +1812,15 @@ static void OnMacStateCheckTimerEvent(void)
                 else
                 {
                     // The DR is not applicable for the payload size
-                    McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_DR_PAYLOAD_SIZE_ERROR;
+                    MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_DR_PAYLOAD_SIZE_ERROR;
 
-                    MacCommandsBufferIndex = 0;
+                    MacCtx->MacCommandsBufferIndex = 0;
                     LoRaMacState &= ~LORAMAC_TX_RUNNING;
-                    NodeAckRequested = false;
-                    McpsConfirm.AckReceived = false;
-                    McpsConfirm.NbRetries = AckTimeoutRetriesCounter;
-                    McpsConfirm.Datarate = LoRaMacParams.ChannelsDatarate;
-                    if (IsUpLinkCounterFixed == false)
+                    MacCtx->NodeAckRequested = false;
+                    MacCtx->McpsConfirm.AckReceived = false;
+                    MacCtx->McpsConfirm.NbRetries = MacCtx->AckTimeoutRetriesCounter;
+                    MacCtx->McpsConfirm.Datarate = LoRaMacParams.ChannelsDatarate;
+                    if (MacCtx->IsUpLinkCounterFixed == false)
                     {
                         UpLinkCounter++;
                         // saveUpCnt();
@@ -1696,11 +1838,11 @@ static void OnMacStateCheckTimerEvent(void)
 
                 LoRaMacState &= ~LORAMAC_TX_RUNNING;
 
-                MacCommandsBufferIndex = 0;
-                NodeAckRequested = false;
-                McpsConfirm.AckReceived = false;
-                McpsConfirm.NbRetries = AckTimeoutRetriesCounter;
-                if (IsUpLinkCounterFixed == false)
+                MacCtx->MacCommandsBufferIndex = 0;
+                MacCtx->NodeAckRequested = false;
+                MacCtx->McpsConfirm.AckReceived = false;
+                MacCtx->McpsConfirm.NbRetries = MacCtx->AckTimeoutRetriesCounter;
+                if (MacCtx->IsUpLinkCounterFixed == false)
                 {
                     UpLinkCounter++;
 #ifdef CONFIG_LORA_VERIFY
@@ -1715,16 +1857,23 @@ static void OnMacStateCheckTimerEvent(void)
     // Handle events
     if (LoRaMacState == LORAMAC_IDLE)
     {
+        // The policy datarate only applies to the uplink just done
+        if (MacCtx->TxPolicyDatarate == true)
+        {
+            MacCtx->TxPolicyDatarate = false;
+            LoRaMacParams.ChannelsDatarate = MacCtx->TxRequestedDatarate;
+        }
+
         if (LoRaMacFlags.Bits.McpsReq == 1)
         {
             LoRaMacFlags.Bits.McpsReq = 0;
-            LoRaMacPrimitives->MacMcpsConfirm(&McpsConfirm);
+            MacCtx->LoRaMacPrimitives->MacMcpsConfirm(&MacCtx->McpsConfirm);
         }
 
         if (LoRaMacFlags.Bits.MlmeReq == 1)
         {
             LoRaMacFlags.Bits.MlmeReq = 0;
-            LoRaMacConfirmQueueHandleCb(&MlmeConfirm);
+            LoRaMacConfirmQueueHandleCb(&MacCtx->MlmeConfirm);
             if (LoRaMacConfirmQueueGetCnt() > 0)
             {
                 LoRaMacFlags.Bits.MlmeReq = 1;
@@ -1734,13 +1883,13 @@ static void OnMacStateCheckTimerEvent(void)
         // Handle MLME indication
         if (LoRaMacFlags.Bits.MlmeInd == 1)
         {
-            LoRaMacPrimitives->MacMlmeIndication(&MlmeIndication);
+            MacCtx->LoRaMacPrimitives->MacMlmeIndication(&MacCtx->MlmeIndication);
             LoRaMacFlags.Bits.MlmeInd = 0;
 
 #ifdef CONFIG_LWAN
-            if (MlmeIndication.MlmeIndication == MLME_SCHEDULE_UPLINK)
+            if (MacCtx->MlmeIndication.MlmeIndication == MLME_SCHEDULE_UPLINK)
             {
-                McpsIndication.UplinkNeeded = false;
+                MacCtx->McpsIndication.UplinkNeeded = false;
             }
 #endif
         }
@@ -1748,12 +1897,12 @@ static void OnMacStateCheckTimerEvent(void)
         if (IsStickyMacCommandPending() == true)
         { // Setup MLME indication
             SetMlmeScheduleUplinkIndication();
-            LoRaMacPrimitives->MacMlmeIndication(&MlmeIndication);
+            MacCtx->LoRaMacPrimitives->MacMlmeIndication(&MacCtx->MlmeIndication);
             LoRaMacFlags.Bits.MlmeInd = 0;
 #ifdef CONFIG_LWAN
-            if (MlmeIndication.MlmeIndication == MLME_SCHEDULE_UPLINK)
+            if (MacCtx->MlmeIndication.MlmeIndication == MLME_SCHEDULE_UPLINK)
             {
-                McpsIndication.UplinkNeeded = false;
+                MacCtx->McpsIndication.UplinkNeeded = false;
             }
 #endif
         }
@@ -1766,21 +1915,21 @@ static void OnMacStateCheckTimerEvent(void)
     else
     {
         // Operation not finished restart timer
-        TimerSetValue(&MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
-        TimerStart(&MacStateCheckTimer);
+        TimerSetValue(&MacCtx->MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
+        TimerStart(&MacCtx->MacStateCheckTimer);
     }
 
     // Handle MCPS indication
     if (LoRaMacFlags.Bits.McpsInd == 1)
     {
         LoRaMacFlags.Bits.McpsInd = 0;
-        if (LoRaMacDeviceClass == CLASS_C)
+        if (MacCtx->LoRaMacDeviceClass == CLASS_C)
         { // Activate RX2 window for Class C
             OpenContinuousRx2Window();
         }
         if (LoRaMacFlags.Bits.McpsIndSkip == 0)
         {
-            LoRaMacPrimitives->MacMcpsIndication(&McpsIndication);
+            MacCtx->LoRaMacPrimitives->MacMcpsIndication(&MacCtx->McpsIndication);
         }
         LoRaMacFlags.Bits.McpsIndSkip = 0;
     }
@@ -1792,15 +1941,15 @@ static void OnTxDelayedTimerEvent(void)
     LoRaMacFrameCtrl_t fCtrl;
     AlternateDrParams_t altDr;
 
-    TimerStop(&TxDelayedTimer);
+    TimerStop(&MacCtx->TxDelayedTimer);
     LoRaMacState &= ~LORAMAC_TX_DELAYED;
 
-    DIO_PRINTF("\t\n----------------LoRaMacFlags.Bits.MlmeReq :%d \t\n------------MlmeConfirm.MlmeRequest:%d\n", LoRaMacFlags.Bits.MlmeReq, MlmeConfirm.MlmeRequest);
-    if ((LoRaMacFlags.Bits.MlmeReq == 1) && (MlmeConfirm.MlmeRequest == MLME_JOIN))
+    DIO_PRINTF("\t\n----------------LoRaMacFlags.Bits.MlmeReq :%d \t\n------------MlmeConfirm.MlmeRequest:%d\n", LoRaMacFlags.Bits.MlmeReq, MacCtx->MlmeConfirm.MlmeRequest);
+    if ((LoRaMacFlags.Bits.MlmeReq == 1) && (MacCtx->MlmeConfirm.MlmeRequest == MLME_JOIN))
     {
         ResetMacParameters();
 
-        altDr.NbTrials = JoinRequestTrials + 1;
+        altDr.NbTrials = MacCtx->JoinRequestTrials + 1;
 #ifdef CONFIG_LINKWAN
         altDr.joinmethod = LoRaMacParams.method;
         altDr.datarate = LoRaMacParams.ChannelsDatarate;
@@ -1811,7 +1960,7 @@ static void OnTxDelayedTimerEvent(void)
         macHdr.Bits.MType = FRAME_TYPE_JOIN_REQ;
 
         fCtrl.Value = 0;
-        fCtrl.Bits.Adr = AdrCtrlOn;
+        fCtrl.Bits.Adr = MacCtx->AdrCtrlOn;
 
         /* In case of join request retransmissions, the stack must prepare
          * the frame again, because the network server keeps track of the random
@@ -1825,31 +1974,31 @@ static void OnTxDelayedTimerEvent(void)
 #ifdef CONFIG_LORA_CAD
 static void OnTxImmediateTimerEvent(void)
 {
-    TimerStop(&TxImmediateTimer);
-    SendFrameOnChannel(Channel);
+    TimerStop(&MacCtx->TxImmediateTimer);
+    SendFrameOnChannel(MacCtx->Channel);
 }
 #endif
 
 static void OnRxWindow1TimerEvent(void)
 {
-    TimerStop(&RxWindowTimer1);
-    RxSlot = RX_SLOT_WIN_1;
+    TimerStop(&MacCtx->RxWindowTimer1);
+    MacCtx->RxSlot = RX_SLOT_WIN_1;
 
-    RxWindow1Config.Channel = Channel;
-    RxWindow1Config.DrOffset = LoRaMacParams.Rx1DrOffset;
-    RxWindow1Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
-    RxWindow1Config.RepeaterSupport = LoRaMacParams.RepeaterSupport;
-    RxWindow1Config.RxContinuous = false;
-    RxWindow1Config.RxSlot = RxSlot;
+    MacCtx->RxWindow1Config.Channel = MacCtx->Channel;
+    MacCtx->RxWindow1Config.DrOffset = LoRaMacParams.Rx1DrOffset;
+    MacCtx->RxWindow1Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
+    MacCtx->RxWindow1Config.RepeaterSupport = LoRaMacParams.RepeaterSupport;
+    MacCtx->RxWindow1Config.RxContinuous = false;
+    MacCtx->RxWindow1Config.RxSlot = MacCtx->RxSlot;
 
-    if (LoRaMacDeviceClass == CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_C)
     {
         Radio.Standby();
     }
 
-    RegionRxConfig(LoRaMacRegion, &RxWindow1Config, (int8_t *)&McpsIndication.RxDatarate);
+    RegionRxConfig(LoRaMacRegion, &MacCtx->RxWindow1Config, (int8_t *)&MacCtx->McpsIndication.RxDatarate);
     // printf("w1 dr:%d\r\n",McpsIndication.RxDatarate);
-    RxWindowSetup(RxWindow1Config.RxContinuous, LoRaMacParams.MaxRxWindow);
+    RxWindowSetup(MacCtx->RxWindow1Config.RxContinuous, LoRaMacParams.MaxRxWindow);
 #if (LoraWan_RGB == 1)
     turnOnRGB(COLOR_RXWINDOW1, 0);
 #endif
@@ -1857,28 +2006,28 @@ static void OnRxWindow1TimerEvent(void)
 
 static void OnRxWindow2TimerEvent(void)
 {
-    TimerStop(&RxWindowTimer2);
+    TimerStop(&MacCtx->RxWindowTimer2);
 
-    RxWindow2Config.Channel = Channel;
-    RxWindow2Config.Frequency = LoRaMacParams.Rx2Channel.Frequency;
-    RxWindow2Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
-    RxWindow2Config.RepeaterSupport = LoRaMacParams.RepeaterSupport;
-    RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+    MacCtx->RxWindow2Config.Channel = MacCtx->Channel;
+    MacCtx->RxWindow2Config.Frequency = LoRaMacParams.Rx2Channel.Frequency;
+    MacCtx->RxWindow2Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
+    MacCtx->RxWindow2Config.RepeaterSupport = LoRaMacParams.RepeaterSupport;
+    MacCtx->RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
 
-    if (LoRaMacDeviceClass != CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass != CLASS_C)
     {
-        RxWindow2Config.RxContinuous = false;
+        MacCtx->RxWindow2Config.RxContinuous = false;
     }
     else
     {
-        RxWindow2Config.RxContinuous = true;
+        MacCtx->RxWindow2Config.RxContinuous = true;
     }
 
-    if (RegionRxConfig(LoRaMacRegion, &RxWindow2Config, (int8_t *)&McpsIndication.RxDatarate) == true)
+    if (RegionRxConfig(LoRaMacRegion, &MacCtx->RxWindow2Config, (int8_t *)&MacCtx->McpsIndication.RxDatarate) == true)
     {
         // printf("w2 dr:%d\r\n",McpsIndication.RxDatarate);
-        RxWindowSetup(RxWindow2Config.RxContinuous, LoRaMacParams.MaxRxWindow);
-        RxSlot = RX_SLOT_WIN_2;
+        RxWindowSetup(MacCtx->RxWindow2Config.RxContinuous, LoRaMacParams.MaxRxWindow);
+        MacCtx->RxSlot = RX_SLOT_WIN_2;
     }
 #if (LoraWan_RGB == 1)
     turnOnRGB(COLOR_RXWINDOW2, 0);
@@ -1895,7 +2044,7 @@ static void CheckToDisableAckTimeout(bool nodeAckRequested, DeviceClass_t devCla
         { // FIRST CASE
             // We have performed an unconfirmed uplink in class c mode
             // and have received a downlink in RX1 or RX2.
-            TimerStop(&AckTimeoutTimer);
+            TimerStop(&MacCtx->AckTimeoutTimer);
         }
     }
     else
@@ -1904,7 +2053,7 @@ static void CheckToDisableAckTimeout(bool nodeAckRequested, DeviceClass_t devCla
         { // SECOND CASE
             // We have performed a confirmed uplink and have received a
             // downlink with a valid ACK.
-            TimerStop(&AckTimeoutTimer);
+            TimerStop(&MacCtx->AckTimeoutTimer);
         }
         else
         { // THIRD CASE
@@ -1914,7 +2063,7 @@ static void CheckToDisableAckTimeout(bool nodeAckRequested, DeviceClass_t devCla
                 // received a downlink with a valid ACK. In this case
                 // we need to verify if the maximum retries have been
                 // elapsed. If so, stop the timer.
-                TimerStop(&AckTimeoutTimer);
+                TimerStop(&MacCtx->AckTimeoutTimer);
             }
         }
     }
@@ -1922,14 +2071,14 @@ static void CheckToDisableAckTimeout(bool nodeAckRequested, DeviceClass_t devCla
 
 static void OnAckTimeoutTimerEvent(void)
 {
-    TimerStop(&AckTimeoutTimer);
+    TimerStop(&MacCtx->AckTimeoutTimer);
 
-    if (NodeAckRequested == true)
+    if (MacCtx->NodeAckRequested == true)
     {
-        AckTimeoutRetry = true;
+        MacCtx->AckTimeoutRetry = true;
         LoRaMacState &= ~LORAMAC_ACK_REQ;
     }
-    if (LoRaMacDeviceClass == CLASS_C)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_C)
     {
         LoRaMacFlags.Bits.MacDone = 1;
     }
@@ -1954,7 +2103,7 @@ static LoRaMacStatus_t SwitchClass(DeviceClass_t deviceClass)
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_PARAMETER_INVALID;
 
-    switch (LoRaMacDeviceClass)
+    switch (MacCtx->LoRaMacDeviceClass)
     {
     case CLASS_A:
     {
@@ -1963,16 +2112,16 @@ static LoRaMacStatus_t SwitchClass(DeviceClass_t deviceClass)
             status = LoRaMacClassBSwitchClass(deviceClass);
             if (status == LORAMAC_STATUS_OK)
             {
-                LoRaMacDeviceClass = deviceClass;
+                MacCtx->LoRaMacDeviceClass = deviceClass;
             }
         }
 
         if (deviceClass == CLASS_C)
         {
-            LoRaMacDeviceClass = deviceClass;
+            MacCtx->LoRaMacDeviceClass = deviceClass;
 
             // Set the NodeAckRequested indicator to default
-            NodeAckRequested = false;
+            MacCtx->NodeAckRequested = false;
             // Set the radio into sleep mode in case we are still in RX mode
             Radio.Sleep();
             // Compute Rx2 windows parameters in case the RX2 datarate has changed
@@ -1980,7 +2129,7 @@ static LoRaMacStatus_t SwitchClass(DeviceClass_t deviceClass)
                                             LoRaMacParams.Rx2Channel.Datarate,
                                             LoRaMacParams.MinRxSymbols,
                                             LoRaMacParams.SystemMaxRxError,
-                                            &RxWindow2Config);
+                                            &MacCtx->RxWindow2Config);
             OpenContinuousRx2Window();
 
             status = LORAMAC_STATUS_OK;
@@ -1992,7 +2141,7 @@ static LoRaMacStatus_t SwitchClass(DeviceClass_t deviceClass)
         status = LoRaMacClassBSwitchClass(deviceClass);
         if (status == LORAMAC_STATUS_OK)
         {
-            LoRaMacDeviceClass = deviceClass;
+            MacCtx->LoRaMacDeviceClass = deviceClass;
         }
         break;
     }
@@ -2000,7 +2149,7 @@ static LoRaMacStatus_t SwitchClass(DeviceClass_t deviceClass)
     {
         if (deviceClass == CLASS_A)
         {
-            LoRaMacDeviceClass = deviceClass;
+            MacCtx->LoRaMacDeviceClass = deviceClass;
 
             // Set the radio into sleep to setup a defined state
             Radio.Sleep();
@@ -2048,7 +2197,7 @@ static bool ValidatePayloadLength(uint8_t lenN, int8_t datarate, uint8_t fOptsLe
 
 static bool IsStickyMacCommandPending(void)
 {
-    if (MacCommandsBufferToRepeatIndex > 0)
+    if (MacCtx->MacCommandsBufferToRepeatIndex > 0)
     {
         // Sticky MAC commands pending
         return true;
@@ -2058,7 +2207,7 @@ static bool IsStickyMacCommandPending(void)
 
 static void SetMlmeScheduleUplinkIndication(void)
 {
-    MlmeIndication.MlmeIndication = MLME_SCHEDULE_UPLINK;
+    MacCtx->MlmeIndication.MlmeIndication = MLME_SCHEDULE_UPLINK;
     LoRaMacFlags.Bits.MlmeInd = 1;
 }
 
@@ -2066,54 +2215,54 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_BUSY;
     // The maximum buffer length must take MAC commands to re-send into account.
-    uint8_t bufLen = LORA_MAC_COMMAND_MAX_LENGTH - MacCommandsBufferToRepeatIndex;
+    uint8_t bufLen = LORA_MAC_COMMAND_MAX_LENGTH - MacCtx->MacCommandsBufferToRepeatIndex;
 
     switch (cmd)
     {
     case MOTE_MAC_LINK_CHECK_REQ:
-        if (MacCommandsBufferIndex < bufLen)
+        if (MacCtx->MacCommandsBufferIndex < bufLen)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // No payload for this command
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_LINK_ADR_ANS:
-        if (MacCommandsBufferIndex < (bufLen - 1))
+        if (MacCtx->MacCommandsBufferIndex < (bufLen - 1))
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Margin
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_DUTY_CYCLE_ANS:
-        if (MacCommandsBufferIndex < bufLen)
+        if (MacCtx->MacCommandsBufferIndex < bufLen)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // No payload for this answer
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_RX_PARAM_SETUP_ANS:
-        if (MacCommandsBufferIndex < (bufLen - 1))
+        if (MacCtx->MacCommandsBufferIndex < (bufLen - 1))
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Status: Datarate ACK, Channel ACK
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             // This is a sticky MAC command answer. Setup indication
             SetMlmeScheduleUplinkIndication();
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_DEV_STATUS_ANS:
-        if (MacCommandsBufferIndex < (bufLen - 2))
+        if (MacCtx->MacCommandsBufferIndex < (bufLen - 2))
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // 1st byte Battery
             // 2nd byte Margin
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p2;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p2;
             SetMlmeScheduleUplinkIndication();
             status = LORAMAC_STATUS_OK;
 #ifdef LORAMAC_CLASSB_TESTCASE
@@ -2122,18 +2271,18 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
         }
         break;
     case MOTE_MAC_NEW_CHANNEL_ANS:
-        if (MacCommandsBufferIndex < (bufLen - 1))
+        if (MacCtx->MacCommandsBufferIndex < (bufLen - 1))
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Status: Datarate range OK, Channel frequency OK
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_RX_TIMING_SETUP_ANS:
-        if (MacCommandsBufferIndex < bufLen)
+        if (MacCtx->MacCommandsBufferIndex < bufLen)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // No payload for this answer
             // This is a sticky MAC command answer. Setup indication
             SetMlmeScheduleUplinkIndication();
@@ -2141,19 +2290,19 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
         }
         break;
     case MOTE_MAC_TX_PARAM_SETUP_ANS:
-        if (MacCommandsBufferIndex < bufLen)
+        if (MacCtx->MacCommandsBufferIndex < bufLen)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // No payload for this answer
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_DL_CHANNEL_ANS:
-        if (MacCommandsBufferIndex < bufLen)
+        if (MacCtx->MacCommandsBufferIndex < bufLen)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Status: Uplink frequency exists, Channel frequency OK
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             // This is a sticky MAC command answer. Setup indication
             SetMlmeScheduleUplinkIndication();
 
@@ -2161,9 +2310,9 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
         }
         break;
     case MOTE_MAC_DEVICE_TIME_REQ:
-        if (MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
+        if (MacCtx->MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // No payload for this answer
             status = LORAMAC_STATUS_OK;
 #ifdef LORAMAC_CLASSB_TESTCASE
@@ -2172,11 +2321,11 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
         }
         break;
     case MOTE_MAC_PING_SLOT_INFO_REQ:
-        if (MacCommandsBufferIndex < (LORA_MAC_COMMAND_MAX_LENGTH - 1))
+        if (MacCtx->MacCommandsBufferIndex < (LORA_MAC_COMMAND_MAX_LENGTH - 1))
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Status: Periodicity and Datarate
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             status = LORAMAC_STATUS_OK;
 #ifdef LORAMAC_CLASSB_TESTCASE
             DBG_PRINTF("ready to send MOTE_MAC_PING_SLOT_INFO_REQ value=%d\r\n", p1);
@@ -2184,29 +2333,29 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
         }
         break;
     case MOTE_MAC_PING_SLOT_FREQ_ANS:
-        if (MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
+        if (MacCtx->MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Status: Datarate range OK, Channel frequency OK
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             SetMlmeScheduleUplinkIndication();
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_BEACON_TIMING_REQ:
-        if (MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
+        if (MacCtx->MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // No payload for this answer
             status = LORAMAC_STATUS_OK;
         }
         break;
     case MOTE_MAC_BEACON_FREQ_ANS:
-        if (MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
+        if (MacCtx->MacCommandsBufferIndex < LORA_MAC_COMMAND_MAX_LENGTH)
         {
-            MacCommandsBuffer[MacCommandsBufferIndex++] = cmd;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = cmd;
             // Status: Channel frequency OK
-            MacCommandsBuffer[MacCommandsBufferIndex++] = p1;
+            MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex++] = p1;
             SetMlmeScheduleUplinkIndication();
             status = LORAMAC_STATUS_OK;
         }
@@ -2216,8 +2365,8 @@ static LoRaMacStatus_t AddMacCommand(uint8_t cmd, uint8_t p1, uint8_t p2)
     }
     if (status == LORAMAC_STATUS_OK)
     {
-        MacCommandsInNextTx = true;
-        if (SrvAckRequested)
+        MacCtx->MacCommandsInNextTx = true;
+        if (MacCtx->SrvAckRequested)
         {
             SetMlmeScheduleUplinkIndication();
         }
@@ -2283,6 +2432,26 @@ static uint8_t ParseMacCommandsToRepeat(uint8_t *cmdBufIn, uint8_t length, uint8
     return cmdCount;
 }
 
+static int8_t ClockSyncTemperature(void)
+{
+    float temperature;
+
+    if ((MacCtx->LoRaMacCallbacks == NULL) || (MacCtx->LoRaMacCallbacks->GetTemperatureLevel == NULL))
+    {
+        return LORAMAC_CLOCK_SYNC_NO_TEMPERATURE;
+    }
+    temperature = MacCtx->LoRaMacCallbacks->GetTemperatureLevel();
+    if (temperature < -127)
+    {
+        temperature = -127;
+    }
+    if (temperature > 127)
+    {
+        temperature = 127;
+    }
+    return (int8_t)temperature;
+}
+
 static void ProcessMacCommands(uint8_t *payload, uint8_t macIndex, uint8_t commandsSize, uint8_t snr, LoRaMacRxSlot_t rxSlot)
 {
     uint8_t status = 0;
@@ -2301,12 +2470,13 @@ static void ProcessMacCommands(uint8_t *payload, uint8_t macIndex, uint8_t comma
             if (LoRaMacConfirmQueueIsCmdActive(MLME_LINK_CHECK) == true)
             {
                 LoRaMacConfirmQueueSetStatus(LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK);
-                MlmeConfirm.DemodMargin = payload[macIndex++];
-                MlmeConfirm.NbGateways = payload[macIndex++];
+                MacCtx->MlmeConfirm.DemodMargin = payload[macIndex++];
+                MacCtx->MlmeConfirm.NbGateways = payload[macIndex++];
 #ifdef CONFIG_LWAN
-                McpsIndication.LinkCheckAnsReceived = true;
+                MacCtx->McpsIndication.LinkCheckAnsReceived = true;
 #endif
-                DBG_PRINTF("margin %d, gateways %d\r\n", MlmeConfirm.DemodMargin, MlmeConfirm.NbGateways);
+                LoRaMacSchedulerSetLinkMargin(MacCtx->MlmeConfirm.DemodMargin, LoRaMacParams.ChannelsDatarate);
+                DBG_PRINTF("margin %d, gateways %d\r\n", MacCtx->MlmeConfirm.DemodMargin, MacCtx->MlmeConfirm.NbGateways);
             }
             break;
         case SRV_MAC_LINK_ADR_REQ:
@@ -2320,7 +2490,7 @@ static void ProcessMacCommands(uint8_t *payload, uint8_t macIndex, uint8_t comma
             // Fill parameter structure
             linkAdrReq.Payload = &payload[macIndex - 1];
             linkAdrReq.PayloadSize = commandsSize - (macIndex - 1);
-            linkAdrReq.AdrEnabled = AdrCtrlOn;
+            linkAdrReq.AdrEnabled = MacCtx->AdrCtrlOn;
             linkAdrReq.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
             linkAdrReq.CurrentDatarate = LoRaMacParams.ChannelsDatarate;
             linkAdrReq.CurrentTxPower = LoRaMacParams.ChannelsTxPower;
@@ -2348,8 +2518,8 @@ static void ProcessMacCommands(uint8_t *payload, uint8_t macIndex, uint8_t comma
         }
         break;
         case SRV_MAC_DUTY_CYCLE_REQ:
-            MaxDCycle = payload[macIndex++];
-            AggregatedDCycle = 1 << MaxDCycle;
+            MacCtx->MaxDCycle = payload[macIndex++];
+            MacCtx->AggregatedDCycle = 1 << MacCtx->MaxDCycle;
             AddMacCommand(MOTE_MAC_DUTY_CYCLE_ANS, 0, 0);
             break;
         case SRV_MAC_RX_PARAM_SETUP_REQ:
@@ -2381,9 +2551,9 @@ static void ProcessMacCommands(uint8_t *payload, uint8_t macIndex, uint8_t comma
         case SRV_MAC_DEV_STATUS_REQ:
         {
             uint8_t batteryLevel = BAT_LEVEL_NO_MEASURE;
-            if ((LoRaMacCallbacks != NULL) && (LoRaMacCallbacks->GetBatteryLevel != NULL))
+            if ((MacCtx->LoRaMacCallbacks != NULL) && (MacCtx->LoRaMacCallbacks->GetBatteryLevel != NULL))
             {
-                batteryLevel = LoRaMacCallbacks->GetBatteryLevel();
+                batteryLevel = MacCtx->LoRaMacCallbacks->GetBatteryLevel();
             }
 #ifdef LORAMAC_CLASSB_TESTCASE
             DBG_PRINTF("receive SRV_MAC_DEV_STATUS_REQ\r\n");
@@ -2494,17 +2664,18 @@ static void ProcessMacCommands(uint8_t *payload, uint8_t macIndex, uint8_t comma
             // Compensate time difference between Tx Done time and now
             sysTimeCurrent = TimerGetSysTime();
 
-            sysTime = TimerAddSysTime(sysTimeCurrent, TimerSubSysTime(sysTimeAns, LastTxSysTime));
+            sysTime = TimerAddSysTime(sysTimeCurrent, TimerSubSysTime(sysTimeAns, MacCtx->LastTxSysTime));
 #ifdef LORAMAC_CLASSB_TESTCASE
             DBG_PRINTF("receive SRV_MAC_DEVICE_TIME_ANS, set time=%u.%d\r\n", (unsigned int)sysTime.Seconds, sysTime.SubSeconds);
 #endif
             // Apply the new system time.
             TimerSetSysTime(sysTime);
+            LoRaMacClockSyncAddSample(sysTimeAns, MacCtx->LastTxMcuTime, ClockSyncTemperature());
             currentTime = TimerGetCurrentTime();
 
             LoRaMacClassBDeviceTimeAns(currentTime);
 #ifdef CONFIG_LWAN
-            McpsIndication.DevTimeAnsReceived = true;
+            MacCtx->McpsIndication.DevTimeAnsReceived = true;
 #endif
         }
         break;
@@ -2592,7 +2763,7 @@ static bool StartCAD(uint8_t channel)
     txConfig.TxPower = LoRaMacParams.ChannelsTxPower;
     txConfig.MaxEirp = LoRaMacParams.MaxEirp;
     txConfig.AntennaGain = LoRaMacParams.AntennaGain;
-    txConfig.PktLen = LoRaMacBufferPktLen;
+    txConfig.PktLen = MacCtx->LoRaMacBufferPktLen;
 
     bool ret = RegionTxConfig(LoRaMacRegion, &txConfig, &txPower, &txTime);
 
@@ -2608,21 +2779,21 @@ static void beforeTxCadDone(bool channelActivityDetected)
 {
     Radio.Sleep();
     // printf("beforeTxCadDone\r\n");
-    if (channelActivityDetected && g_lora_cad_cnt < LORA_CAD_CNT_MAX)
+    if (channelActivityDetected && MacCtx->g_lora_cad_cnt < LORA_CAD_CNT_MAX)
     {
         // Send later - prepare timer
-        g_lora_cad_cnt++;
+        MacCtx->g_lora_cad_cnt++;
         LoRaMacState |= LORAMAC_TX_DELAYED;
-        TimerSetValue(&TxDelayedTimer, LORA_CAD_DELAY);
-        TimerStart(&TxDelayedTimer);
+        TimerSetValue(&MacCtx->TxDelayedTimer, LORA_CAD_DELAY);
+        TimerStart(&MacCtx->TxDelayedTimer);
     }
     else
     {
         // Try to send now
-        g_lora_cad_cnt = 1;
+        MacCtx->g_lora_cad_cnt = 1;
         LoRaMacState |= LORAMAC_TX_RUNNING;
-        TimerSetValue(&TxImmediateTimer, 1);
-        TimerStart(&TxImmediateTimer);
+        TimerSetValue(&MacCtx->TxImmediateTimer, 1);
+        TimerStart(&MacCtx->TxImmediateTimer);
     }
 }
 
@@ -2666,12 +2837,12 @@ bool Onwota_CadTimer()
     if (LoRaMacState == LORAMAC_IDLE)
     {
         wota_CadStarted = true;
-        RxWindow3Config.RxContinuous = true;
-        RxWindow3Config.Datarate = wota_dr;
-        RxWindow3Config.Frequency = wota_freq;
-        RxWindow3Config.RxSlot = RX_SLOT_WOTA;
+        MacCtx->RxWindow3Config.RxContinuous = true;
+        MacCtx->RxWindow3Config.Datarate = wota_dr;
+        MacCtx->RxWindow3Config.Frequency = wota_freq;
+        MacCtx->RxWindow3Config.RxSlot = RX_SLOT_WOTA;
 
-        RegionRxConfig(LoRaMacRegion, &RxWindow3Config, (int8_t *)&McpsIndication.RxDatarate);
+        RegionRxConfig(LoRaMacRegion, &MacCtx->RxWindow3Config, (int8_t *)&MacCtx->McpsIndication.RxDatarate);
         Radio.StartCad(CLASS_A_WOTA_CAD_SYMBOLS);
         TimerSetValue(&wota_CadTimer, wota_cycle_time - 20);
         TimerStart(&wota_CadTimer);
@@ -2684,10 +2855,10 @@ static void wota_CadDone(bool channelActivityDetected)
     if (channelActivityDetected)
     {
         // Radio.Sleep();
-        if (RegionRxConfig(LoRaMacRegion, &RxWindow3Config, (int8_t *)&McpsIndication.RxDatarate) == true)
+        if (RegionRxConfig(LoRaMacRegion, &MacCtx->RxWindow3Config, (int8_t *)&MacCtx->McpsIndication.RxDatarate) == true)
         {
             RxWindowSetup(false, wota_max_rxtime);
-            RxSlot = RX_SLOT_WOTA;
+            MacCtx->RxSlot = RX_SLOT_WOTA;
             ;
         }
         wota_CadTimerStarted = false;
@@ -2715,7 +2886,7 @@ LoRaMacStatus_t Send(LoRaMacHeader_t *macHdr, uint8_t fPort, void *fBuffer, uint
 #endif
     fCtrl.Value = 0;
     fCtrl.Bits.FOptsLen = 0;
-    if (LoRaMacDeviceClass == CLASS_B)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_B)
     {
 #ifdef LORAMAC_CLASSB_TESTCASE
         DBG_PRINTF("Send class b frame\r\n");
@@ -2728,7 +2899,17 @@ LoRaMacStatus_t Send(LoRaMacHeader_t *macHdr, uint8_t fPort, void *fBuffer, uint
     }
     fCtrl.Bits.Ack = false;
     fCtrl.Bits.AdrAckReq = false;
-    fCtrl.Bits.Adr = AdrCtrlOn;
+    fCtrl.Bits.Adr = MacCtx->AdrCtrlOn;
+
+    if (IsLoRaMacNetworkJoined == true)
+    {
+        LoRaMacClockSyncUpdate(ClockSyncTemperature());
+        if (LoRaMacClockSyncRequestDue() == true)
+        {
+            // Piggy-backed, the answer is handled like a requested one
+            AddMacCommand(MOTE_MAC_DEVICE_TIME_REQ, 0, 0);
+        }
+    }
 
     // Prepare the frame
     status = PrepareFrame(macHdr, &fCtrl, fPort, fBuffer, fBufferSize);
@@ -2740,9 +2921,13 @@ LoRaMacStatus_t Send(LoRaMacHeader_t *macHdr, uint8_t fPort, void *fBuffer, uint
     }
 
     // Reset confirm parameters
-    McpsConfirm.NbRetries = 0;
-    McpsConfirm.AckReceived = false;
-    McpsConfirm.UpLinkCounter = UpLinkCounter;
+    MacCtx->McpsConfirm.NbRetries = 0;
+    MacCtx->McpsConfirm.AckReceived = false;
+    MacCtx->McpsConfirm.UpLinkCounter = UpLinkCounter;
+
+    MacCtx->TxUrgent = LoRaMacSchedulerTakeUrgent();
+    MacCtx->TxDeferred = 0;
+    MacCtx->TxPolicyDatarate = false;
 
     status = ScheduleTx();
 #ifdef CONFIG_LORA_VERIFY
@@ -2759,25 +2944,59 @@ static LoRaMacStatus_t ScheduleTx(void)
 {
     TimerTime_t dutyCycleTimeOff = 0;
     NextChanParams_t nextChan;
+    LoRaMacTxRequest_t txRequest;
+    LoRaMacTxPlan_t txPlan;
+    uint32_t rxDelay1;
+    uint32_t rxDelay2;
 
     // Check if the device is off
-    if (MaxDCycle == 255)
+    if (MacCtx->MaxDCycle == 255)
     {
         return LORAMAC_STATUS_DEVICE_OFF;
     }
-    if (MaxDCycle == 0)
+    if (MacCtx->MaxDCycle == 0)
     {
-        AggregatedTimeOff = 0;
+        MacCtx->AggregatedTimeOff = 0;
     }
 
     // Update Backoff
-    CalculateBackOff(LastTxChannel);
+    CalculateBackOff(MacCtx->LastTxChannel);
+
+    // Let the scheduling policy pick the datarate and the send time
+    if (IsLoRaMacNetworkJoined == true)
+    {
+        FillTxRequest(MacCtx->LoRaMacTxPayloadLen, &txRequest);
+        txPlan.Datarate = txRequest.Datarate;
+        txPlan.Delay = 0;
+        if (LoRaMacSchedulerPlan(&txRequest, &txPlan) == true)
+        {
+            if ((txPlan.Datarate != LoRaMacParams.ChannelsDatarate) && (MacCtx->AdrCtrlOn == false) &&
+                (txPlan.Datarate >= txRequest.MinDatarate) && (txPlan.Datarate <= txRequest.MaxDatarate) &&
+                (ValidatePayloadLength(MacCtx->LoRaMacTxPayloadLen, txPlan.Datarate, MacCtx->MacCommandsBufferIndex) == true))
+            {
+                if (MacCtx->TxPolicyDatarate == false)
+                {
+                    MacCtx->TxPolicyDatarate = true;
+                    MacCtx->TxRequestedDatarate = LoRaMacParams.ChannelsDatarate;
+                }
+                LoRaMacParams.ChannelsDatarate = txPlan.Datarate;
+            }
+            if ((txPlan.Delay > 0) && (txRequest.Urgent == false))
+            {
+                MacCtx->TxDeferred += txPlan.Delay;
+                LoRaMacState |= LORAMAC_TX_DELAYED;
+                TimerSetValue(&MacCtx->TxDelayedTimer, txPlan.Delay);
+                TimerStart(&MacCtx->TxDelayedTimer);
+                return LORAMAC_STATUS_OK;
+            }
+        }
+    }
 
-    nextChan.AggrTimeOff = AggregatedTimeOff;
+    nextChan.AggrTimeOff = MacCtx->AggregatedTimeOff;
     nextChan.Datarate = LoRaMacParams.ChannelsDatarate;
-    nextChan.DutyCycleEnabled = DutyCycleOn;
+    nextChan.DutyCycleEnabled = MacCtx->DutyCycleOn;
     nextChan.Joined = IsLoRaMacNetworkJoined;
-    nextChan.LastAggrTx = AggregatedLastTxDoneTime;
+    nextChan.LastAggrTx = MacCtx->AggregatedLastTxDoneTime;
 
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
@@ -2790,7 +3009,7 @@ static LoRaMacStatus_t ScheduleTx(void)
     int8_t maxDatarate = phyParam.Value;
 
     // Select channel
-    while (RegionNextChannel(LoRaMacRegion, &nextChan, &Channel, &dutyCycleTimeOff, &AggregatedTimeOff) == false)
+    while (RegionNextChannel(LoRaMacRegion, &nextChan, &MacCtx->Channel, &dutyCycleTimeOff, &MacCtx->AggregatedTimeOff) == false)
     {
         // Set the default datarate
         // LoRaMacParams.ChannelsDatarate = LoRaMacParamsDefaults.ChannelsDatarate;
@@ -2806,73 +3025,152 @@ static LoRaMacStatus_t ScheduleTx(void)
         nextChan.Datarate = LoRaMacParams.ChannelsDatarate;
     }
 
-    // Compute Rx1 windows parameters
-    RegionComputeRxWindowParameters(LoRaMacRegion,
-                                    RegionApplyDrOffset(LoRaMacRegion, LoRaMacParams.DownlinkDwellTime, LoRaMacParams.ChannelsDatarate,
-                                                        LoRaMacParams.Rx1DrOffset),
-                                    LoRaMacParams.MinRxSymbols,
-                                    LoRaMacParams.SystemMaxRxError,
-                                    &RxWindow1Config);
-    // Compute Rx2 windows parameters
-    RegionComputeRxWindowParameters(LoRaMacRegion,
-                                    LoRaMacParams.Rx2Channel.Datarate,
-                                    LoRaMacParams.MinRxSymbols,
-                                    LoRaMacParams.SystemMaxRxError,
-                                    &RxWindow2Config);
-
     if (IsLoRaMacNetworkJoined == false)
     {
-        RxWindow1Delay = LoRaMacParams.JoinAcceptDelay1 + RxWindow1Config.WindowOffset;
-        RxWindow2Delay = LoRaMacParams.JoinAcceptDelay2 + RxWindow2Config.WindowOffset;
+        rxDelay1 = LoRaMacParams.JoinAcceptDelay1;
+        rxDelay2 = LoRaMacParams.JoinAcceptDelay2;
     }
     else
     {
-        if (ValidatePayloadLength(LoRaMacTxPayloadLen, LoRaMacParams.ChannelsDatarate, MacCommandsBufferIndex) == false)
+        if (ValidatePayloadLength(MacCtx->LoRaMacTxPayloadLen, LoRaMacParams.ChannelsDatarate, MacCtx->MacCommandsBufferIndex) == false)
         {
             return LORAMAC_STATUS_LENGTH_ERROR;
         }
-        RxWindow1Delay = LoRaMacParams.ReceiveDelay1 + RxWindow1Config.WindowOffset;
-        RxWindow2Delay = LoRaMacParams.ReceiveDelay2 + RxWindow2Config.WindowOffset;
+        rxDelay1 = LoRaMacParams.ReceiveDelay1;
+        rxDelay2 = LoRaMacParams.ReceiveDelay2;
     }
 
+    // Compute Rx1 windows parameters, sized from the measured timing error
+    RegionComputeRxWindowParameters(LoRaMacRegion,
+                                    RegionApplyDrOffset(LoRaMacRegion, LoRaMacParams.DownlinkDwellTime, LoRaMacParams.ChannelsDatarate,
+                                                        LoRaMacParams.Rx1DrOffset),
+                                    LoRaMacParams.MinRxSymbols,
+                                    LoRaMacRxTimingRxError(LoRaMacParams.SystemMaxRxError, rxDelay1),
+                                    &MacCtx->RxWindow1Config);
+    // Compute Rx2 windows parameters
+    RegionComputeRxWindowParameters(LoRaMacRegion,
+                                    LoRaMacParams.Rx2Channel.Datarate,
+                                    LoRaMacParams.MinRxSymbols,
+                                    LoRaMacRxTimingRxError(LoRaMacParams.SystemMaxRxError, rxDelay2),
+                                    &MacCtx->RxWindow2Config);
+
+    MacCtx->RxWindow1Delay = rxDelay1 + MacCtx->RxWindow1Config.WindowOffset + LoRaMacRxTimingOffset();
+    MacCtx->RxWindow2Delay = rxDelay2 + MacCtx->RxWindow2Config.WindowOffset + LoRaMacRxTimingOffset();
+
     // Schedule transmission of frame
     if (dutyCycleTimeOff == 0)
     {
 #ifdef CONFIG_LORA_CAD
-        StartCAD(Channel);
+        StartCAD(MacCtx->Channel);
         return LORAMAC_STATUS_OK;
 #else
         // Try to send now
-        return SendFrameOnChannel(Channel);
+        return SendFrameOnChannel(MacCtx->Channel);
 #endif
     }
     else
     {
         // Send later - prepare timer
         LoRaMacState |= LORAMAC_TX_DELAYED;
-        TimerSetValue(&TxDelayedTimer, dutyCycleTimeOff);
-        TimerStart(&TxDelayedTimer);
+        TimerSetValue(&MacCtx->TxDelayedTimer, dutyCycleTimeOff);
+        TimerStart(&MacCtx->TxDelayedTimer);
 
         return LORAMAC_STATUS_OK;
     }
 }
 
+static void FillTxRequest(uint8_t payloadSize, LoRaMacTxRequest_t *request)
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    ChannelParams_t *channels;
+    uint16_t *channelsMask;
+    Band_t *bands;
+    uint8_t nbChannels;
+    uint8_t nbBands;
+    int8_t minDatarate = DR_15;
+    int8_t maxDatarate = DR_0;
+    TimerTime_t elapsed;
+
+    memset1((uint8_t *)request, 0, sizeof(LoRaMacTxRequest_t));
+    request->PayloadSize = payloadSize + MacCtx->MacCommandsBufferIndex;
+    request->Urgent = (MacCtx->TxUrgent == true) || (MacCtx->NodeAckRequested == true) ||
+                      (MacCtx->MacCommandsBufferIndex > 0);
+    request->AdrOn = MacCtx->AdrCtrlOn;
+    request->Datarate = LoRaMacParams.ChannelsDatarate;
+    request->Deferred = MacCtx->TxDeferred;
+    LoRaMacSchedulerGetLinkMargin(&request->LinkMargin, &request->MarginDatarate);
+
+    elapsed = TimerGetElapsedTime(MacCtx->AggregatedLastTxDoneTime);
+    if (MacCtx->AggregatedTimeOff > elapsed)
+    {
+        request->AggregatedTimeOff = MacCtx->AggregatedTimeOff - elapsed;
+    }
+
+    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
+    getPhy.Attribute = PHY_MAX_NB_CHANNELS;
+    nbChannels = RegionGetPhyParam(LoRaMacRegion, &getPhy).Value;
+    getPhy.Attribute = PHY_CHANNELS;
+    channels = RegionGetPhyParam(LoRaMacRegion, &getPhy).Channels;
+    getPhy.Attribute = PHY_CHANNELS_MASK;
+    channelsMask = RegionGetPhyParam(LoRaMacRegion, &getPhy).ChannelsMask;
+
+    nbBands = RegionGetBands(LoRaMacRegion, &bands);
+    if (nbBands > LORAMAC_SCHEDULER_MAX_BANDS)
+    {
+        nbBands = LORAMAC_SCHEDULER_MAX_BANDS;
+    }
+    request->NbBands = nbBands;
+    for (uint8_t i = 0; i < nbBands; i++)
+    {
+        request->Bands[i].DCycle = bands[i].DCycle;
+        request->Bands[i].TimeOff = RegionCommonGetBandTimeOff(IsLoRaMacNetworkJoined, MacCtx->DutyCycleOn, &bands[i]);
+    }
+
+    for (uint8_t i = 0; i < nbChannels; i++)
+    {
+        if ((channels[i].Frequency == 0) || ((channelsMask[i / 16] & (1 << (i % 16))) == 0))
+        {
+            continue;
+        }
+        minDatarate = MIN(minDatarate, channels[i].DrRange.Fields.Min);
+        maxDatarate = MAX(maxDatarate, channels[i].DrRange.Fields.Max);
+        if ((channels[i].Band < nbBands) && (request->Datarate >= channels[i].DrRange.Fields.Min) &&
+            (request->Datarate <= channels[i].DrRange.Fields.Max))
+        {
+            request->Bands[channels[i].Band].NbChannels++;
+        }
+    }
+
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
+    request->MinDatarate = MAX(minDatarate, (int8_t)phyParam.Value);
+    getPhy.Attribute = PHY_MAX_TX_DR;
+    phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
+    request->MaxDatarate = MIN(maxDatarate, (int8_t)phyParam.Value);
+    if (request->MinDatarate > request->MaxDatarate)
+    {
+        request->MinDatarate = request->Datarate;
+        request->MaxDatarate = request->Datarate;
+    }
+}
+
 static void CalculateBackOff(uint8_t channel)
 {
     CalcBackOffParams_t calcBackOff;
 
     calcBackOff.Joined = IsLoRaMacNetworkJoined;
-    calcBackOff.DutyCycleEnabled = DutyCycleOn;
+    calcBackOff.DutyCycleEnabled = MacCtx->DutyCycleOn;
     calcBackOff.Channel = channel;
-    calcBackOff.ElapsedTime = TimerGetElapsedTime(LoRaMacInitializationTime);
+    calcBackOff.ElapsedTime = TimerGetElapsedTime(MacCtx->LoRaMacInitializationTime);
     calcBackOff.TxTimeOnAir = TxTimeOnAir;
-    calcBackOff.LastTxIsJoinRequest = LastTxIsJoinRequest;
+    calcBackOff.LastTxIsJoinRequest = MacCtx->LastTxIsJoinRequest;
 
     // Update regional back-off
     RegionCalcBackOff(LoRaMacRegion, &calcBackOff);
 
     // Update aggregated time-off
-    AggregatedTimeOff = TxTimeOnAir * AggregatedDCycle - TxTimeOnAir;
+    MacCtx->AggregatedTimeOff = TxTimeOnAir * MacCtx->AggregatedDCycle - TxTimeOnAir;
 }
 
 static void ResetMacParameters(void)
@@ -2882,21 +3180,21 @@ static void ResetMacParameters(void)
     // Counters
     UpLinkCounter = 0;
     DownLinkCounter = -1;
-    AdrAckCounter = 0;
+    MacCtx->AdrAckCounter = 0;
 
-    ChannelsNbRepCounter = 0;
+    MacCtx->ChannelsNbRepCounter = 0;
 
-    AckTimeoutRetries = 1;
-    AckTimeoutRetriesCounter = 1;
-    AckTimeoutRetry = false;
+    MacCtx->AckTimeoutRetries = 1;
+    MacCtx->AckTimeoutRetriesCounter = 1;
+    MacCtx->AckTimeoutRetry = false;
 
-    MaxDCycle = 0;
-    AggregatedDCycle = 1;
+    MacCtx->MaxDCycle = 0;
+    MacCtx->AggregatedDCycle = 1;
 
-    MacCommandsBufferIndex = 0;
-    MacCommandsBufferToRepeatIndex = 0;
+    MacCtx->MacCommandsBufferIndex = 0;
+    MacCtx->MacCommandsBufferToRepeatIndex = 0;
 
-    IsRxWindowsEnabled = true;
+    MacCtx->IsRxWindowsEnabled = true;
 
     LoRaMacParams.ChannelsTxPower = LoRaMacParamsDefaults.ChannelsTxPower;
     LoRaMacParams.ChannelsDatarate = LoRaMacParamsDefaults.ChannelsDatarate;
@@ -2907,12 +3205,12 @@ static void ResetMacParameters(void)
     LoRaMacParams.MaxEirp = LoRaMacParamsDefaults.MaxEirp;
     LoRaMacParams.AntennaGain = LoRaMacParamsDefaults.AntennaGain;
 
-    NodeAckRequested = false;
-    SrvAckRequested = false;
-    MacCommandsInNextTx = false;
+    MacCtx->NodeAckRequested = false;
+    MacCtx->SrvAckRequested = false;
+    MacCtx->MacCommandsInNextTx = false;
 
     // Reset Multicast downlink counters
-    MulticastParams_t *cur = MulticastChannels;
+    MulticastParams_t *cur = MacCtx->MulticastChannels;
     while (cur != NULL)
     {
         cur->DownLinkCounter = 0;
@@ -2920,8 +3218,8 @@ static void ResetMacParameters(void)
     }
 
     // Initialize channel index.
-    Channel = 0;
-    LastTxChannel = Channel;
+    MacCtx->Channel = 0;
+    MacCtx->LastTxChannel = MacCtx->Channel;
 }
 
 static bool IsFPortAllowed(uint8_t fPort)
@@ -2936,7 +3234,7 @@ static bool IsFPortAllowed(uint8_t fPort)
 static void OpenContinuousRx2Window(void)
 {
     OnRxWindow2TimerEvent();
-    RxSlot = RX_SLOT_WIN_CLASS_C;
+    MacCtx->RxSlot = RX_SLOT_WIN_CLASS_C;
 }
 
 LoRaMacStatus_t PrepareFrame(LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl, uint8_t fPort, void *fBuffer,
@@ -2949,18 +3247,18 @@ LoRaMacStatus_t PrepareFrame(LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl,
     const void *payload = fBuffer;
     uint8_t framePort = fPort;
 
-    LoRaMacBufferPktLen = 0;
+    MacCtx->LoRaMacBufferPktLen = 0;
 
-    NodeAckRequested = false;
+    MacCtx->NodeAckRequested = false;
 
     if (fBuffer == NULL)
     {
         fBufferSize = 0;
     }
 
-    LoRaMacTxPayloadLen = fBufferSize;
+    MacCtx->LoRaMacTxPayloadLen = fBufferSize;
 
-    LoRaMacBuffer[pktHeaderLen++] = macHdr->Value;
+    MacCtx->LoRaMacBuffer[pktHeaderLen++] = macHdr->Value;
 
     switch (macHdr->Bits.MType)
     {
@@ -2969,12 +3267,12 @@ LoRaMacStatus_t PrepareFrame(LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl,
             PRINTF_RAW("UpLoad frame %d being processed\r\n", macHdr->Bits.MType);
 #endif
     case FRAME_TYPE_JOIN_REQ:
-        LoRaMacBufferPktLen = pktHeaderLen;
+        MacCtx->LoRaMacBufferPktLen = pktHeaderLen;
 
-        memcpyr(LoRaMacBuffer + LoRaMacBufferPktLen, LoRaMacAppEui, 8);
-        LoRaMacBufferPktLen += 8;
-        memcpyr(LoRaMacBuffer + LoRaMacBufferPktLen, LoRaMacDevEui, 8);
-        LoRaMacBufferPktLen += 8;
+        memcpyr(MacCtx->LoRaMacBuffer + MacCtx->LoRaMacBufferPktLen, MacCtx->LoRaMacAppEui, 8);
+        MacCtx->LoRaMacBufferPktLen += 8;
+        memcpyr(MacCtx->LoRaMacBuffer + MacCtx->LoRaMacBufferPktLen, MacCtx->LoRaMacDevEui, 8);
+        MacCtx->LoRaMacBufferPktLen += 8;
 
         LoRaMacDevNonce = rand1();
 #ifdef CONFIG_LORA_VERIFY
@@ -2983,19 +3281,19 @@ LoRaMacStatus_t PrepareFrame(LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl,
             PRINTF_RAW("DevNonce:%d\rn\n", LoRaMacDevNonce);
         }
 #endif
-        LoRaMacBuffer[LoRaMacBufferPktLen++] = LoRaMacDevNonce & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen++] = (LoRaMacDevNonce >> 8) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen++] = LoRaMacDevNonce & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen++] = (LoRaMacDevNonce >> 8) & 0xFF;
 
-        LoRaMacJoinComputeMic(LoRaMacBuffer, LoRaMacBufferPktLen & 0xFF, LoRaMacAppKey, &mic);
+        LoRaMacJoinComputeMic(MacCtx->LoRaMacBuffer, MacCtx->LoRaMacBufferPktLen & 0xFF, LoRaMacAppKey, &mic);
 
-        LoRaMacBuffer[LoRaMacBufferPktLen++] = mic & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen++] = (mic >> 8) & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen++] = (mic >> 16) & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen++] = (mic >> 24) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen++] = mic & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen++] = (mic >> 8) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen++] = (mic >> 16) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen++] = (mic >> 24) & 0xFF;
 
         break;
     case FRAME_TYPE_DATA_CONFIRMED_UP:
-        NodeAckRequested = true;
+        MacCtx->NodeAckRequested = true;
     // Intentional fallthrough
     case FRAME_TYPE_DATA_UNCONFIRMED_UP:
         if (IsLoRaMacNetworkJoined == false)
@@ -3006,113 +3304,113 @@ LoRaMacStatus_t PrepareFrame(LoRaMacHeader_t *macHdr, LoRaMacFrameCtrl_t *fCtrl,
         // Adr next request
         adrNext.UpdateChanMask = true;
         adrNext.AdrEnabled = fCtrl->Bits.Adr;
-        adrNext.AdrAckCounter = AdrAckCounter;
+        adrNext.AdrAckCounter = MacCtx->AdrAckCounter;
         adrNext.Datarate = LoRaMacParams.ChannelsDatarate;
         adrNext.TxPower = LoRaMacParams.ChannelsTxPower;
         adrNext.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
 
         fCtrl->Bits.AdrAckReq = RegionAdrNext(LoRaMacRegion, &adrNext,
-                                              &LoRaMacParams.ChannelsDatarate, &LoRaMacParams.ChannelsTxPower, &AdrAckCounter);
+                                              &LoRaMacParams.ChannelsDatarate, &LoRaMacParams.ChannelsTxPower, &MacCtx->AdrAckCounter);
 
-        if (SrvAckRequested == true)
+        if (MacCtx->SrvAckRequested == true)
         {
-            SrvAckRequested = false;
+            MacCtx->SrvAckRequested = false;
             fCtrl->Bits.Ack = 1;
         }
 
-        LoRaMacBuffer[pktHeaderLen++] = (LoRaMacDevAddr)&0xFF;
-        LoRaMacBuffer[pktHeaderLen++] = (LoRaMacDevAddr >> 8) & 0xFF;
-        LoRaMacBuffer[pktHeaderLen++] = (LoRaMacDevAddr >> 16) & 0xFF;
-        LoRaMacBuffer[pktHeaderLen++] = (LoRaMacDevAddr >> 24) & 0xFF;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = (MacCtx->LoRaMacDevAddr)&0xFF;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = (MacCtx->LoRaMacDevAddr >> 8) & 0xFF;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = (MacCtx->LoRaMacDevAddr >> 16) & 0xFF;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = (MacCtx->LoRaMacDevAddr >> 24) & 0xFF;
 
-        LoRaMacBuffer[pktHeaderLen++] = fCtrl->Value;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = fCtrl->Value;
 
-        LoRaMacBuffer[pktHeaderLen++] = UpLinkCounter & 0xFF;
-        LoRaMacBuffer[pktHeaderLen++] = (UpLinkCounter >> 8) & 0xFF;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = UpLinkCounter & 0xFF;
+        MacCtx->LoRaMacBuffer[pktHeaderLen++] = (UpLinkCounter >> 8) & 0xFF;
 
         // Copy the MAC commands which must be re-send into the MAC command buffer
-        memcpy1(&MacCommandsBuffer[MacCommandsBufferIndex], MacCommandsBufferToRepeat, MacCommandsBufferToRepeatIndex);
-        MacCommandsBufferIndex += MacCommandsBufferToRepeatIndex;
+        memcpy1(&MacCtx->MacCommandsBuffer[MacCtx->MacCommandsBufferIndex], MacCtx->MacCommandsBufferToRepeat, MacCtx->MacCommandsBufferToRepeatIndex);
+        MacCtx->MacCommandsBufferIndex += MacCtx->MacCommandsBufferToRepeatIndex;
 
-        if ((payload != NULL) && (LoRaMacTxPayloadLen > 0))
+        if ((payload != NULL) && (MacCtx->LoRaMacTxPayloadLen > 0))
         {
-            if (MacCommandsInNextTx == true)
+            if (MacCtx->MacCommandsInNextTx == true)
             {
-                if (MacCommandsBufferIndex <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH)
+                if (MacCtx->MacCommandsBufferIndex <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH)
                 {
-                    fCtrl->Bits.FOptsLen += MacCommandsBufferIndex;
+                    fCtrl->Bits.FOptsLen += MacCtx->MacCommandsBufferIndex;
 
                     // Update FCtrl field with new value of OptionsLength
-                    LoRaMacBuffer[0x05] = fCtrl->Value;
-                    for (i = 0; i < MacCommandsBufferIndex; i++)
+                    MacCtx->LoRaMacBuffer[0x05] = fCtrl->Value;
+                    for (i = 0; i < MacCtx->MacCommandsBufferIndex; i++)
                     {
-                        LoRaMacBuffer[pktHeaderLen++] = MacCommandsBuffer[i];
+                        MacCtx->LoRaMacBuffer[pktHeaderLen++] = MacCtx->MacCommandsBuffer[i];
                     }
                 }
                 else
                 {
-                    LoRaMacTxPayloadLen = MacCommandsBufferIndex;
-                    payload = MacCommandsBuffer;
+                    MacCtx->LoRaMacTxPayloadLen = MacCtx->MacCommandsBufferIndex;
+                    payload = MacCtx->MacCommandsBuffer;
                     framePort = 0;
                 }
             }
         }
         else
         {
-            if ((MacCommandsBufferIndex > 0) && (MacCommandsInNextTx == true))
+            if ((MacCtx->MacCommandsBufferIndex > 0) && (MacCtx->MacCommandsInNextTx == true))
             {
-                LoRaMacTxPayloadLen = MacCommandsBufferIndex;
-                payload = MacCommandsBuffer;
+                MacCtx->LoRaMacTxPayloadLen = MacCtx->MacCommandsBufferIndex;
+                payload = MacCtx->MacCommandsBuffer;
                 framePort = 0;
             }
         }
-        MacCommandsInNextTx = false;
+        MacCtx->MacCommandsInNextTx = false;
         // Store MAC commands which must be re-send in case the device does not receive a downlink anymore
-        MacCommandsBufferToRepeatIndex = ParseMacCommandsToRepeat(MacCommandsBuffer, MacCommandsBufferIndex,
-                                                                  MacCommandsBufferToRepeat);
-        if (MacCommandsBufferToRepeatIndex > 0)
+        MacCtx->MacCommandsBufferToRepeatIndex = ParseMacCommandsToRepeat(MacCtx->MacCommandsBuffer, MacCtx->MacCommandsBufferIndex,
+                                                                  MacCtx->MacCommandsBufferToRepeat);
+        if (MacCtx->MacCommandsBufferToRepeatIndex > 0)
         {
-            MacCommandsInNextTx = true;
+            MacCtx->MacCommandsInNextTx = true;
         }
 
-        if ((payload != NULL) && (LoRaMacTxPayloadLen > 0))
+        if ((payload != NULL) && (MacCtx->LoRaMacTxPayloadLen > 0))
         {
-            LoRaMacBuffer[pktHeaderLen++] = framePort;
-            if ((pktHeaderLen + LoRaMacTxPayloadLen) > (LORAMAC_PHY_MAXPAYLOAD - 4))
+            MacCtx->LoRaMacBuffer[pktHeaderLen++] = framePort;
+            if ((pktHeaderLen + MacCtx->LoRaMacTxPayloadLen) > (LORAMAC_PHY_MAXPAYLOAD - 4))
             {
-                LoRaMacTxPayloadLen = LORAMAC_PHY_MAXPAYLOAD - 4 - pktHeaderLen;
+                MacCtx->LoRaMacTxPayloadLen = LORAMAC_PHY_MAXPAYLOAD - 4 - pktHeaderLen;
             }
 
             if (framePort == 0)
             {
                 // Reset buffer index as the mac commands are being sent on port 0
-                MacCommandsBufferIndex = 0;
-                LoRaMacPayloadEncrypt((uint8_t *)payload, LoRaMacTxPayloadLen, LoRaMacNwkSKey, LoRaMacDevAddr, UP_LINK,
-                                      UpLinkCounter, &LoRaMacBuffer[pktHeaderLen]);
+                MacCtx->MacCommandsBufferIndex = 0;
+                LoRaMacPayloadEncrypt((uint8_t *)payload, MacCtx->LoRaMacTxPayloadLen, MacCtx->LoRaMacNwkSKey, MacCtx->LoRaMacDevAddr, UP_LINK,
+                                      UpLinkCounter, &MacCtx->LoRaMacBuffer[pktHeaderLen]);
             }
             else
             {
-                LoRaMacPayloadEncrypt((uint8_t *)payload, LoRaMacTxPayloadLen, LoRaMacAppSKey, LoRaMacDevAddr, UP_LINK,
-                                      UpLinkCounter, &LoRaMacBuffer[pktHeaderLen]);
+                LoRaMacPayloadEncrypt((uint8_t *)payload, MacCtx->LoRaMacTxPayloadLen, MacCtx->LoRaMacAppSKey, MacCtx->LoRaMacDevAddr, UP_LINK,
+                                      UpLinkCounter, &MacCtx->LoRaMacBuffer[pktHeaderLen]);
             }
         }
-        LoRaMacBufferPktLen = pktHeaderLen + LoRaMacTxPayloadLen;
+        MacCtx->LoRaMacBufferPktLen = pktHeaderLen + MacCtx->LoRaMacTxPayloadLen;
 
-        LoRaMacComputeMic(LoRaMacBuffer, LoRaMacBufferPktLen, LoRaMacNwkSKey, LoRaMacDevAddr, UP_LINK, UpLinkCounter, &mic);
+        LoRaMacComputeMic(MacCtx->LoRaMacBuffer, MacCtx->LoRaMacBufferPktLen, MacCtx->LoRaMacNwkSKey, MacCtx->LoRaMacDevAddr, UP_LINK, UpLinkCounter, &mic);
 
-        LoRaMacBuffer[LoRaMacBufferPktLen + 0] = mic & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen + 1] = (mic >> 8) & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen + 2] = (mic >> 16) & 0xFF;
-        LoRaMacBuffer[LoRaMacBufferPktLen + 3] = (mic >> 24) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen + 0] = mic & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen + 1] = (mic >> 8) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen + 2] = (mic >> 16) & 0xFF;
+        MacCtx->LoRaMacBuffer[MacCtx->LoRaMacBufferPktLen + 3] = (mic >> 24) & 0xFF;
 
-        LoRaMacBufferPktLen += LORAMAC_MFR_LEN;
+        MacCtx->LoRaMacBufferPktLen += LORAMAC_MFR_LEN;
 
         break;
     case FRAME_TYPE_PROPRIETARY:
-        if ((fBuffer != NULL) && (LoRaMacTxPayloadLen > 0))
+        if ((fBuffer != NULL) && (MacCtx->LoRaMacTxPayloadLen > 0))
         {
-            memcpy1(LoRaMacBuffer + pktHeaderLen, (uint8_t *)fBuffer, LoRaMacTxPayloadLen);
-            LoRaMacBufferPktLen = pktHeaderLen + LoRaMacTxPayloadLen;
+            memcpy1(MacCtx->LoRaMacBuffer + pktHeaderLen, (uint8_t *)fBuffer, MacCtx->LoRaMacTxPayloadLen);
+            MacCtx->LoRaMacBufferPktLen = pktHeaderLen + MacCtx->LoRaMacTxPayloadLen;
         }
         break;
     default:
@@ -3133,14 +3431,14 @@ LoRaMacStatus_t SendFrameOnChannel(uint8_t channel)
     txConfig.TxPower = LoRaMacParams.ChannelsTxPower;
     txConfig.MaxEirp = LoRaMacParams.MaxEirp;
     txConfig.AntennaGain = LoRaMacParams.AntennaGain;
-    txConfig.PktLen = LoRaMacBufferPktLen;
+    txConfig.PktLen = MacCtx->LoRaMacBufferPktLen;
 
     if (LoRaMacClassBIsBeaconExpected() == true)
     {
         return LORAMAC_STATUS_BUSY_BEACON_RESERVED_TIME;
     }
 
-    if (LoRaMacDeviceClass == CLASS_B)
+    if (MacCtx->LoRaMacDeviceClass == CLASS_B)
     {
         if (LoRaMacClassBIsPingExpected() == true)
         {
@@ -3160,16 +3458,16 @@ LoRaMacStatus_t SendFrameOnChannel(uint8_t channel)
     LoRaMacConfirmQueueSetStatusCmn(LORAMAC_EVENT_INFO_STATUS_ERROR);
 
     // TODO:
-    MlmeConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+    MacCtx->MlmeConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
 
-    McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
-    McpsConfirm.Datarate = LoRaMacParams.ChannelsDatarate;
-    McpsConfirm.TxPower = txPower;
-    McpsConfirm.Channel = channel;
+    MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+    MacCtx->McpsConfirm.Datarate = LoRaMacParams.ChannelsDatarate;
+    MacCtx->McpsConfirm.TxPower = txPower;
+    MacCtx->McpsConfirm.Channel = channel;
 
     // Store the time on air
-    McpsConfirm.TxTimeOnAir = TxTimeOnAir;
-    MlmeConfirm.TxTimeOnAir = TxTimeOnAir;
+    MacCtx->McpsConfirm.TxTimeOnAir = TxTimeOnAir;
+    MacCtx->MlmeConfirm.TxTimeOnAir = TxTimeOnAir;
 
     if (LoRaMacClassBIsBeaconModeActive() == true)
     {
@@ -3186,12 +3484,12 @@ LoRaMacStatus_t SendFrameOnChannel(uint8_t channel)
     LoRaMacClassBHaltBeaconing();
 
     // Starts the MAC layer status check timer
-    TimerSetValue(&MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
-    TimerStart(&MacStateCheckTimer);
+    TimerSetValue(&MacCtx->MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
+    TimerStart(&MacCtx->MacStateCheckTimer);
 
     if (IsLoRaMacNetworkJoined == false)
     {
-        JoinRequestTrials++;
+        MacCtx->JoinRequestTrials++;
     }
 
     //////////////// INSERT THIS CODE TODO:
@@ -3203,10 +3501,11 @@ LoRaMacStatus_t SendFrameOnChannel(uint8_t channel)
     // }
 
     // To dump transmitted packets...
-    DIO_PRINTF("\n\tRadioSend: size=%d, channel=%d, datarate=%d, txpower=%d, maxeirp=%d, antennagain=%d\r\n", (int)LoRaMacBufferPktLen, (int)txConfig.Channel, (int)txConfig.Datarate, (int)txConfig.TxPower, (int)txConfig.MaxEirp, (int)txConfig.AntennaGain);
-    for (int i = 0; i < LoRaMacBufferPktLen; i++)
+    DIO_PRINTF("\n\tRadioSend: size=%d, channel=%d, datarate=%d, txpower=%d, maxeirp=%d, antennagain=%d\r\n", (int)MacCtx->LoRaMacBufferPktLen, (int)txConfig.Channel, (int)txConfig.Datarate, (int)txConfig.TxPower, (int)txConfig.MaxEirp, (int)txConfig.AntennaGain);
+    TRACE_EVENT(TRACE_MAC_RADIO_SEND, MacCtx->LoRaMacBufferPktLen, txConfig.Channel, txConfig.Datarate, txConfig.TxPower);
+    for (int i = 0; i < MacCtx->LoRaMacBufferPktLen; i++)
     {
-        DIO_PRINTF("%02x ", LoRaMacBuffer[i]);
+        DIO_PRINTF("%02x ", MacCtx->LoRaMacBuffer[i]);
     }
     DIO_PRINTF("\r\n");
 
@@ -3216,7 +3515,7 @@ LoRaMacStatus_t SendFrameOnChannel(uint8_t channel)
 #if (LoraWan_RGB == 1)
     turnOnRGB(COLOR_SEND, 0);
 #endif
-    Radio.Send(LoRaMacBuffer, LoRaMacBufferPktLen);
+    Radio.Send(MacCtx->LoRaMacBuffer, MacCtx->LoRaMacBufferPktLen);
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
 #ifdef __asr6601__
@@ -3229,7 +3528,7 @@ LoRaMacStatus_t SetTxContinuousWave(uint16_t timeout)
 {
     ContinuousWaveParams_t continuousWave;
 
-    continuousWave.Channel = Channel;
+    continuousWave.Channel = MacCtx->Channel;
     continuousWave.Datarate = LoRaMacParams.ChannelsDatarate;
     continuousWave.TxPower = LoRaMacParams.ChannelsTxPower;
     continuousWave.MaxEirp = LoRaMacParams.MaxEirp;
@@ -3239,8 +3538,8 @@ LoRaMacStatus_t SetTxContinuousWave(uint16_t timeout)
     RegionSetContinuousWave(LoRaMacRegion, &continuousWave);
 
     // Starts the MAC layer status check timer
-    TimerSetValue(&MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
-    TimerStart(&MacStateCheckTimer);
+    TimerSetValue(&MacCtx->MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
+    TimerStart(&MacCtx->MacStateCheckTimer);
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
 
@@ -3252,14 +3551,94 @@ LoRaMacStatus_t SetTxContinuousWave1(uint16_t timeout, uint32_t frequency, uint8
     Radio.SetTxContinuousWave(frequency, power, timeout);
 
     // Starts the MAC layer status check timer
-    TimerSetValue(&MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
-    TimerStart(&MacStateCheckTimer);
+    TimerSetValue(&MacCtx->MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
+    TimerStart(&MacCtx->MacStateCheckTimer);
 
     LoRaMacState |= LORAMAC_TX_RUNNING;
 
     return LORAMAC_STATUS_OK;
 }
 
+/*!
+ * Offset of the region state inside a context block
+ */
+#define LORAMAC_CTX_REGION_OFFSET ((sizeof(LoRaMacCtx_t) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+size_t LoRaMacGetContextSize(LoRaMacRegion_t region)
+{
+    size_t regionSize = RegionGetContextSize(region);
+
+    if (regionSize == 0)
+    {
+        return 0;
+    }
+    return LORAMAC_CTX_REGION_OFFSET + regionSize;
+}
+
+LoRaMacCtx_t *LoRaMacContextInit(void *buffer, LoRaMacRegion_t region)
+{
+    LoRaMacCtx_t *ctx = (LoRaMacCtx_t *)buffer;
+
+    if ((ctx == NULL) || (LoRaMacGetContextSize(region) == 0))
+    {
+        return NULL;
+    }
+    memset(ctx, 0, LoRaMacGetContextSize(region));
+    ctx->Shared.Region = region;
+    ctx->RegionCtx = (uint8_t *)buffer + LORAMAC_CTX_REGION_OFFSET;
+    LoRaMacClockSyncInitContext(&ctx->ClockSync);
+    return ctx;
+}
+
+LoRaMacCtx_t *LoRaMacSetContext(LoRaMacCtx_t *ctx)
+{
+    LoRaMacCtx_t *prev = MacCtx;
+
+    if (ctx == NULL)
+    {
+        ctx = &MacCtxDefault;
+    }
+    if (ctx == MacCtx)
+    {
+        return prev;
+    }
+
+    prev->Shared.Region = LoRaMacRegion;
+    prev->Shared.AppKey = LoRaMacAppKey;
+    prev->Shared.DevNonce = LoRaMacDevNonce;
+    prev->Shared.UpLinkCounter = UpLinkCounter;
+    prev->Shared.DownLinkCounter = DownLinkCounter;
+    prev->Shared.IsNetworkJoined = IsLoRaMacNetworkJoined;
+    prev->Shared.Params = LoRaMacParams;
+    prev->Shared.ParamsDefaults = LoRaMacParamsDefaults;
+    prev->Shared.State = LoRaMacState;
+    prev->Shared.TxTimeOnAir = TxTimeOnAir;
+    prev->Shared.Flags = LoRaMacFlags;
+
+    LoRaMacRegion = ctx->Shared.Region;
+    LoRaMacAppKey = ctx->Shared.AppKey;
+    LoRaMacDevNonce = ctx->Shared.DevNonce;
+    UpLinkCounter = ctx->Shared.UpLinkCounter;
+    DownLinkCounter = ctx->Shared.DownLinkCounter;
+    IsLoRaMacNetworkJoined = ctx->Shared.IsNetworkJoined;
+    LoRaMacParams = ctx->Shared.Params;
+    LoRaMacParamsDefaults = ctx->Shared.ParamsDefaults;
+    LoRaMacState = ctx->Shared.State;
+    TxTimeOnAir = ctx->Shared.TxTimeOnAir;
+    LoRaMacFlags = ctx->Shared.Flags;
+
+    MacCtx = ctx;
+    RegionSetContext(LoRaMacRegion, MacCtx->RegionCtx);
+    LoRaMacRxTimingSetContext((MacCtx == &MacCtxDefault) ? NULL : &MacCtx->RxTiming);
+    LoRaMacClockSyncSetContext((MacCtx == &MacCtxDefault) ? NULL : &MacCtx->ClockSync);
+    return prev;
+}
+
+LoRaMacCtx_t *LoRaMacGetContext(void)
+{
+    return MacCtx;
+}
+
 LoRaMacStatus_t LoRaMacInitialization(LoRaMacPrimitives_t *primitives, LoRaMacCallback_t *callbacks,
                                       LoRaMacRegion_t region)
 {
@@ -3289,26 +3668,27 @@ LoRaMacStatus_t LoRaMacInitialization(LoRaMacPrimitives_t *primitives, LoRaMacCa
     // Confirm queue reset
     LoRaMacConfirmQueueInit(primitives);
 
-    LoRaMacPrimitives = primitives;
-    LoRaMacCallbacks = callbacks;
+    MacCtx->LoRaMacPrimitives = primitives;
+    MacCtx->LoRaMacCallbacks = callbacks;
     LoRaMacRegion = region;
+    RegionSetContext(LoRaMacRegion, MacCtx->RegionCtx);
 
     LoRaMacFlags.Value = 0;
 
-    LoRaMacDeviceClass = CLASS_A;
+    MacCtx->LoRaMacDeviceClass = CLASS_A;
     LoRaMacState = LORAMAC_IDLE;
 
-    JoinRequestTrials = 0;
-    MaxJoinRequestTrials = 1;
+    MacCtx->JoinRequestTrials = 0;
+    MacCtx->MaxJoinRequestTrials = 1;
 
     // Reset duty cycle times
-    AggregatedLastTxDoneTime = 0;
-    AggregatedTimeOff = 0;
+    MacCtx->AggregatedLastTxDoneTime = 0;
+    MacCtx->AggregatedTimeOff = 0;
 
     // Reset to defaults
     getPhy.Attribute = PHY_DUTY_CYCLE;
     phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
-    DutyCycleOn = (bool)phyParam.Value;
+    MacCtx->DutyCycleOn = (bool)phyParam.Value;
 
     getPhy.Attribute = PHY_DEF_TX_POWER;
     phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
@@ -3386,15 +3766,16 @@ LoRaMacStatus_t LoRaMacInitialization(LoRaMacPrimitives_t *primitives, LoRaMacCa
     ResetMacParameters();
 
     // Initialize timers
-    TimerInit(&MacStateCheckTimer, OnMacStateCheckTimerEvent);
-    TimerSetValue(&MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
+    TimerInit(&MacCtx->MacStateCheckTimer, OnMacStateCheckTimerEvent);
+    TimerSetValue(&MacCtx->MacStateCheckTimer, MAC_STATE_CHECK_TIMEOUT);
 
-    TimerInit(&TxDelayedTimer, OnTxDelayedTimerEvent);
-    TimerInit(&RxWindowTimer1, OnRxWindow1TimerEvent);
-    TimerInit(&RxWindowTimer2, OnRxWindow2TimerEvent);
-    TimerInit(&AckTimeoutTimer, OnAckTimeoutTimerEvent);
+    TimerInit(&MacCtx->TxDelayedTimer, OnTxDelayedTimerEvent);
+    TimerInit(&MacCtx->RxWindowTimer1, OnRxWindow1TimerEvent);
+    TimerInit(&MacCtx->RxWindowTimer2, OnRxWindow2TimerEvent);
+    TimerInit(&MacCtx->AckTimeoutTimer, OnAckTimeoutTimerEvent);
 #ifdef CONFIG_LORA_CAD
-    TimerInit(&TxImmediateTimer, OnTxImmediateTimerEvent);
+    TimerInit(&MacCtx->TxImmediateTimer, OnTxImmediateTimerEvent);
+    MacCtx->g_lora_cad_cnt = 1;
 #endif
 
 #ifdef CLASS_A_WOTA
@@ -3402,7 +3783,7 @@ LoRaMacStatus_t LoRaMacInitialization(LoRaMacPrimitives_t *primitives, LoRaMacCa
 #endif
 
     // Store the current initialization time
-    LoRaMacInitializationTime = TimerGetCurrentTime();
+    MacCtx->LoRaMacInitializationTime = TimerGetCurrentTime();
 
     // Initialize Radio driver
     RadioEvents.TxDone = OnRadioTxDone;
@@ -3413,12 +3794,13 @@ LoRaMacStatus_t LoRaMacInitialization(LoRaMacPrimitives_t *primitives, LoRaMacCa
 #if defined(CONFIG_LORA_CAD) || defined(CLASS_A_WOTA)
     RadioEvents.CadDone = OnRadioCadDone;
 #endif
+    LoRaMacRecorderHook(&RadioEvents);
     Radio.Init(&RadioEvents);
 
     // Random seed initialization
     srand1(Radio.Random());
 
-    PublicNetwork = true;
+    MacCtx->PublicNetwork = true;
     Radio.SetPublicNetwork(true);
     Radio.Sleep();
 
@@ -3431,15 +3813,15 @@ LoRaMacStatus_t LoRaMacInitialization(LoRaMacPrimitives_t *primitives, LoRaMacCa
     }
 
     // Must all be static. Don't use local references.
-    classBParams.MlmeIndication = &MlmeIndication;
-    classBParams.McpsIndication = &McpsIndication;
-    classBParams.MlmeConfirm = &MlmeConfirm;
+    classBParams.MlmeIndication = &MacCtx->MlmeIndication;
+    classBParams.McpsIndication = &MacCtx->McpsIndication;
+    classBParams.MlmeConfirm = &MacCtx->MlmeConfirm;
     classBParams.LoRaMacFlags = &LoRaMacFlags;
-    classBParams.LoRaMacDevAddr = &LoRaMacDevAddr;
+    classBParams.LoRaMacDevAddr = &MacCtx->LoRaMacDevAddr;
     classBParams.LoRaMacRegion = &LoRaMacRegion;
-    classBParams.MacStateCheckTimer = &MacStateCheckTimer;
+    classBParams.MacStateCheckTimer = &MacCtx->MacStateCheckTimer;
     classBParams.LoRaMacParams = &LoRaMacParams;
-    classBParams.MulticastChannels = &MulticastChannels;
+    classBParams.MulticastChannels = &MacCtx->MulticastChannels;
 
     LoRaMacClassBInit(&classBParams, &classBCallbacks);
 
@@ -3469,7 +3851,7 @@ LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo)
     defaultDrForNoAdr = MIN(defaultDrForNoAdr, phyParam.Value);
 
     currentDrForNoAdr = defaultDrForNoAdr;
-    if (AdrCtrlOn)
+    if (MacCtx->AdrCtrlOn)
     {
         datarate = LoRaMacParams.ChannelsDatarate;
     }
@@ -3477,7 +3859,7 @@ LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo)
     {
         datarate = currentDrForNoAdr;
     }
-    uint8_t fOptLen = MacCommandsBufferIndex + MacCommandsBufferToRepeatIndex;
+    uint8_t fOptLen = MacCtx->MacCommandsBufferIndex + MacCtx->MacCommandsBufferToRepeatIndex;
 
     if (txInfo == NULL)
     {
@@ -3486,8 +3868,8 @@ LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo)
 
     // Setup ADR request
     adrNext.UpdateChanMask = false;
-    adrNext.AdrEnabled = AdrCtrlOn;
-    adrNext.AdrAckCounter = AdrAckCounter;
+    adrNext.AdrEnabled = MacCtx->AdrCtrlOn;
+    adrNext.AdrAckCounter = MacCtx->AdrAckCounter;
     // adrNext.Datarate = LoRaMacParams.ChannelsDatarate;
     adrNext.Datarate = datarate;
     adrNext.TxPower = LoRaMacParams.ChannelsTxPower;
@@ -3495,7 +3877,7 @@ LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo)
 
     // We call the function for information purposes only. We don't want to
     // apply the datarate, the tx power and the ADR ack counter.
-    RegionAdrNext(LoRaMacRegion, &adrNext, &datarate, &txPower, &AdrAckCounter);
+    RegionAdrNext(LoRaMacRegion, &adrNext, &datarate, &txPower, &MacCtx->AdrAckCounter);
 
     /*
         // Setup PHY request
@@ -3536,7 +3918,7 @@ LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo)
         }
         phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
         uint8_t maxN = phyParam.Value;
-        if (AdrCtrlOn)
+        if (MacCtx->AdrCtrlOn)
         {
             if (LoRaMacParams.ChannelsDatarate >= maxDatarate)
                 return LORAMAC_STATUS_LENGTH_ERROR;
@@ -3551,7 +3933,30 @@ LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo)
             datarate = currentDrForNoAdr;
         }
         DIO_PRINTF("Payload length(%d) and fOptLen(%d) exceed max size(%d for current datarate DR %d), set datarate to Dr %d\r\n", size, fOptLen, maxN, datarate - 1, datarate);
+        TRACE_EVENT(TRACE_MAC_DR_ADJUST, size, fOptLen, maxN, datarate);
+    }
+
+    // Report the room left at the datarate the frame will use
+    getPhy.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
+    getPhy.Datarate = datarate;
+    getPhy.Attribute = (LoRaMacParams.RepeaterSupport == true) ? PHY_MAX_PAYLOAD_REPEATER : PHY_MAX_PAYLOAD;
+    phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
+    txInfo->CurrentPayloadSize = phyParam.Value;
+    txInfo->MaxPossiblePayload = (phyParam.Value >= fOptLen) ? phyParam.Value - fOptLen : 0;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacQueryTxForecast(uint8_t size, LoRaMacTxRequest_t *forecast)
+{
+    if (forecast == NULL)
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
     }
+    if (MacCtx->MaxDCycle == 255)
+    {
+        return LORAMAC_STATUS_DEVICE_OFF;
+    }
+    FillTxRequest(size, forecast);
     return LORAMAC_STATUS_OK;
 }
 
@@ -3570,7 +3975,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mibGet)
     {
     case MIB_DEVICE_CLASS:
     {
-        mibGet->Param.Class = LoRaMacDeviceClass;
+        mibGet->Param.Class = MacCtx->LoRaMacDeviceClass;
         break;
     }
     case MIB_NETWORK_JOINED:
@@ -3580,32 +3985,32 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mibGet)
     }
     case MIB_ADR:
     {
-        mibGet->Param.AdrEnable = AdrCtrlOn;
+        mibGet->Param.AdrEnable = MacCtx->AdrCtrlOn;
         break;
     }
     case MIB_NET_ID:
     {
-        mibGet->Param.NetID = LoRaMacNetID;
+        mibGet->Param.NetID = MacCtx->LoRaMacNetID;
         break;
     }
     case MIB_DEV_ADDR:
     {
-        mibGet->Param.DevAddr = LoRaMacDevAddr;
+        mibGet->Param.DevAddr = MacCtx->LoRaMacDevAddr;
         break;
     }
     case MIB_NWK_SKEY:
     {
-        mibGet->Param.NwkSKey = LoRaMacNwkSKey;
+        mibGet->Param.NwkSKey = MacCtx->LoRaMacNwkSKey;
         break;
     }
     case MIB_APP_SKEY:
     {
-        mibGet->Param.AppSKey = LoRaMacAppSKey;
+        mibGet->Param.AppSKey = MacCtx->LoRaMacAppSKey;
         break;
     }
     case MIB_PUBLIC_NETWORK:
     {
-        mibGet->Param.EnablePublicNetwork = PublicNetwork;
+        mibGet->Param.EnablePublicNetwork = MacCtx->PublicNetwork;
         break;
     }
     case MIB_REPEATER_SUPPORT:
@@ -3709,7 +4114,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mibGet)
     }
     case MIB_MULTICAST_CHANNEL:
     {
-        mibGet->Param.MulticastList = MulticastChannels;
+        mibGet->Param.MulticastList = MacCtx->MulticastChannels;
         break;
     }
     case MIB_SYSTEM_MAX_RX_ERROR:
@@ -3747,7 +4152,7 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t *mibGet)
     }
 #endif
     default:
-        if (LoRaMacDeviceClass == CLASS_B)
+        if (MacCtx->LoRaMacDeviceClass == CLASS_B)
         {
             status = LoRaMacClassBMibGetRequestConfirm(mibGet);
         }
@@ -3790,25 +4195,25 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t *mibSet)
     }
     case MIB_ADR:
     {
-        AdrCtrlOn = mibSet->Param.AdrEnable;
+        MacCtx->AdrCtrlOn = mibSet->Param.AdrEnable;
         break;
     }
     case MIB_NET_ID:
     {
-        LoRaMacNetID = mibSet->Param.NetID;
+        MacCtx->LoRaMacNetID = mibSet->Param.NetID;
         break;
     }
     case MIB_DEV_ADDR:
     {
-        LoRaMacDevAddr = mibSet->Param.DevAddr;
+        MacCtx->LoRaMacDevAddr = mibSet->Param.DevAddr;
         break;
     }
     case MIB_NWK_SKEY:
     {
         if (mibSet->Param.NwkSKey != NULL)
         {
-            memcpy1(LoRaMacNwkSKey, mibSet->Param.NwkSKey,
-                    sizeof(LoRaMacNwkSKey));
+            memcpy1(MacCtx->LoRaMacNwkSKey, mibSet->Param.NwkSKey,
+                    sizeof(MacCtx->LoRaMacNwkSKey));
         }
         else
         {
@@ -3820,8 +4225,8 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t *mibSet)
     {
         if (mibSet->Param.AppSKey != NULL)
         {
-            memcpy1(LoRaMacAppSKey, mibSet->Param.AppSKey,
-                    sizeof(LoRaMacAppSKey));
+            memcpy1(MacCtx->LoRaMacAppSKey, mibSet->Param.AppSKey,
+                    sizeof(MacCtx->LoRaMacAppSKey));
         }
         else
         {
@@ -3831,7 +4236,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t *mibSet)
     }
     case MIB_PUBLIC_NETWORK:
     {
-        PublicNetwork = mibSet->Param.EnablePublicNetwork;
+        MacCtx->PublicNetwork = mibSet->Param.EnablePublicNetwork;
         Radio.SetPublicNetwork(mibSet->Param.EnablePublicNetwork);
         break;
     }
@@ -3848,27 +4253,27 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t *mibSet)
         if (RegionVerify(LoRaMacRegion, &verify, PHY_RX_DR) == true)
         {
             memcpy(&LoRaMacParams.Rx2Channel, &mibSet->Param.Rx2Channel, sizeof(LoRaMacParams.Rx2Channel));
-            if ((LoRaMacDeviceClass == CLASS_C) && (IsLoRaMacNetworkJoined == true))
+            if ((MacCtx->LoRaMacDeviceClass == CLASS_C) && (IsLoRaMacNetworkJoined == true))
             {
                 // Compute Rx2 windows parameters
                 RegionComputeRxWindowParameters(LoRaMacRegion,
                                                 LoRaMacParams.Rx2Channel.Datarate,
                                                 LoRaMacParams.MinRxSymbols,
                                                 LoRaMacParams.SystemMaxRxError,
-                                                &RxWindow2Config);
+                                                &MacCtx->RxWindow2Config);
 
-                RxWindow2Config.Channel = Channel;
-                RxWindow2Config.Frequency = LoRaMacParams.Rx2Channel.Frequency;
-                RxWindow2Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
-                RxWindow2Config.RepeaterSupport = LoRaMacParams.RepeaterSupport;
-                RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
-                RxWindow2Config.RxContinuous = true;
+                MacCtx->RxWindow2Config.Channel = MacCtx->Channel;
+                MacCtx->RxWindow2Config.Frequency = LoRaMacParams.Rx2Channel.Frequency;
+                MacCtx->RxWindow2Config.DownlinkDwellTime = LoRaMacParams.DownlinkDwellTime;
+                MacCtx->RxWindow2Config.RepeaterSupport = LoRaMacParams.RepeaterSupport;
+                MacCtx->RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+                MacCtx->RxWindow2Config.RxContinuous = true;
 
                 Radio.Sleep();
-                if (RegionRxConfig(LoRaMacRegion, &RxWindow2Config, (int8_t *)&McpsIndication.RxDatarate) == true)
+                if (RegionRxConfig(LoRaMacRegion, &MacCtx->RxWindow2Config, (int8_t *)&MacCtx->McpsIndication.RxDatarate) == true)
                 {
-                    RxWindowSetup(RxWindow2Config.RxContinuous, LoRaMacParams.MaxRxWindow);
-                    RxSlot = RxWindow2Config.RxSlot;
+                    RxWindowSetup(MacCtx->RxWindow2Config.RxContinuous, LoRaMacParams.MaxRxWindow);
+                    MacCtx->RxSlot = MacCtx->RxWindow2Config.RxSlot;
                 }
                 else
                 {
@@ -4065,7 +4470,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t *mibSet)
 #endif
     default:
     {
-        if (LoRaMacDeviceClass == CLASS_B)
+        if (MacCtx->LoRaMacDeviceClass == CLASS_B)
         {
             status = LoRaMacMibClassBSetRequestConfirm(mibSet);
         }
@@ -4138,14 +4543,14 @@ LoRaMacStatus_t LoRaMacMulticastChannelLink(MulticastParams_t *channelParam)
     channelParam->DownLinkCounter = 0;
     channelParam->Next = NULL;
 
-    if (MulticastChannels == NULL)
+    if (MacCtx->MulticastChannels == NULL)
     {
         // New node is the fist element
-        MulticastChannels = channelParam;
+        MacCtx->MulticastChannels = channelParam;
     }
     else
     {
-        MulticastParams_t *cur = MulticastChannels;
+        MulticastParams_t *cur = MacCtx->MulticastChannels;
 
         // Search the last node in the list
         while (cur->Next != NULL)
@@ -4170,16 +4575,16 @@ LoRaMacStatus_t LoRaMacMulticastChannelUnlink(MulticastParams_t *channelParam)
         return LORAMAC_STATUS_BUSY;
     }
 
-    if (MulticastChannels != NULL)
+    if (MacCtx->MulticastChannels != NULL)
     {
-        if (MulticastChannels == channelParam)
+        if (MacCtx->MulticastChannels == channelParam)
         {
             // First element
-            MulticastChannels = channelParam->Next;
+            MacCtx->MulticastChannels = channelParam->Next;
         }
         else
         {
-            MulticastParams_t *cur = MulticastChannels;
+            MulticastParams_t *cur = MacCtx->MulticastChannels;
 
             // Search the node in the list
             while (cur->Next && cur->Next != channelParam)
@@ -4198,7 +4603,7 @@ LoRaMacStatus_t LoRaMacMulticastChannelUnlink(MulticastParams_t *channelParam)
     return LORAMAC_STATUS_OK;
 }
 
-LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t *mlmeRequest)
+static LoRaMacStatus_t MlmeRequest(MlmeReq_t *mlmeRequest)
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_SERVICE_UNKNOWN;
     LoRaMacHeader_t macHdr;
@@ -4246,16 +4651,16 @@ LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t *mlmeRequest)
         LoRaMacFlags.Bits.MlmeReq = 1;
         queueElement.Request = mlmeRequest->Type;
 
-        LoRaMacDevEui = mlmeRequest->Req.Join.DevEui;
-        LoRaMacAppEui = mlmeRequest->Req.Join.AppEui;
+        MacCtx->LoRaMacDevEui = mlmeRequest->Req.Join.DevEui;
+        MacCtx->LoRaMacAppEui = mlmeRequest->Req.Join.AppEui;
         LoRaMacAppKey = mlmeRequest->Req.Join.AppKey;
         queueElement.Status = LORAMAC_EVENT_INFO_STATUS_JOIN_FAIL;
         queueElement.RestrictCommonReadyToHandle = false;
         LoRaMacConfirmQueueAdd(&queueElement);
-        MaxJoinRequestTrials = mlmeRequest->Req.Join.NbTrials;
+        MacCtx->MaxJoinRequestTrials = mlmeRequest->Req.Join.NbTrials;
 
         // Reset variable JoinRequestTrials
-        JoinRequestTrials = 0;
+        MacCtx->JoinRequestTrials = 0;
 
         // Setup header information
         macHdr.Value = 0;
@@ -4263,7 +4668,7 @@ LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t *mlmeRequest)
 
         ResetMacParameters();
 
-        altDr.NbTrials = JoinRequestTrials + 1;
+        altDr.NbTrials = MacCtx->JoinRequestTrials + 1;
 #ifdef CONFIG_LINKWAN
         altDr.joinmethod = mlmeRequest->Req.Join.method;
         altDr.datarate = mlmeRequest->Req.Join.datarate;
@@ -4389,7 +4794,7 @@ LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t *mlmeRequest)
 
     if (status != LORAMAC_STATUS_OK)
     {
-        NodeAckRequested = false;
+        MacCtx->NodeAckRequested = false;
         LoRaMacConfirmQueueRemoveLast();
         if (LoRaMacConfirmQueueGetCnt() == 0)
         {
@@ -4400,7 +4805,16 @@ LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t *mlmeRequest)
     return status;
 }
 
-LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
+LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t *mlmeRequest)
+{
+    void *record = LoRaMacRecorderMlmeBegin(mlmeRequest);
+    LoRaMacStatus_t status = MlmeRequest(mlmeRequest);
+
+    LoRaMacRecorderEnd(record);
+    return status;
+}
+
+static LoRaMacStatus_t McpsRequest(McpsReq_t *mcpsRequest)
 {
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
@@ -4430,18 +4844,18 @@ LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
     }
 
     macHdr.Value = 0;
-    memset1((uint8_t *)&McpsConfirm, 0, sizeof(McpsConfirm));
-    McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+    memset1((uint8_t *)&MacCtx->McpsConfirm, 0, sizeof(MacCtx->McpsConfirm));
+    MacCtx->McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
 
     // AckTimeoutRetriesCounter must be reset every time a new request (unconfirmed or confirmed) is performed.
-    AckTimeoutRetriesCounter = 1;
+    MacCtx->AckTimeoutRetriesCounter = 1;
 
     switch (mcpsRequest->Type)
     {
     case MCPS_UNCONFIRMED:
     {
         readyToSend = true;
-        AckTimeoutRetries = 1;
+        MacCtx->AckTimeoutRetries = 1;
 
         macHdr.Bits.MType = FRAME_TYPE_DATA_UNCONFIRMED_UP;
         fPort = mcpsRequest->Req.Unconfirmed.fPort;
@@ -4453,7 +4867,7 @@ LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
     case MCPS_CONFIRMED:
     {
         readyToSend = true;
-        AckTimeoutRetries = mcpsRequest->Req.Confirmed.NbTrials;
+        MacCtx->AckTimeoutRetries = mcpsRequest->Req.Confirmed.NbTrials;
 
         macHdr.Bits.MType = FRAME_TYPE_DATA_CONFIRMED_UP;
         fPort = mcpsRequest->Req.Confirmed.fPort;
@@ -4465,7 +4879,7 @@ LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
     case MCPS_PROPRIETARY:
     {
         readyToSend = true;
-        AckTimeoutRetries = 1;
+        MacCtx->AckTimeoutRetries = 1;
 
         macHdr.Bits.MType = FRAME_TYPE_PROPRIETARY;
         fBuffer = mcpsRequest->Req.Proprietary.fBuffer;
@@ -4501,7 +4915,7 @@ LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
 
     if (readyToSend == true)
     {
-        if (AdrCtrlOn == false)
+        if (MacCtx->AdrCtrlOn == false)
         {
             verify.DatarateParams.Datarate = datarate;
             verify.DatarateParams.UplinkDwellTime = LoRaMacParams.UplinkDwellTime;
@@ -4519,27 +4933,248 @@ LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
         status = Send(&macHdr, fPort, fBuffer, fBufferSize);
         if (status == LORAMAC_STATUS_OK)
         {
-            McpsConfirm.McpsRequest = mcpsRequest->Type;
+            MacCtx->McpsConfirm.McpsRequest = mcpsRequest->Type;
             LoRaMacFlags.Bits.McpsReq = 1;
         }
         else
         {
-            NodeAckRequested = false;
+            MacCtx->NodeAckRequested = false;
         }
     }
 
     return status;
 }
 
+LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest)
+{
+    void *record = LoRaMacRecorderMcpsBegin(mcpsRequest);
+    LoRaMacStatus_t status = McpsRequest(mcpsRequest);
+
+    LoRaMacRecorderEnd(record);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxInitialization(LoRaMacCtx_t *ctx, LoRaMacPrimitives_t *primitives,
+                                         LoRaMacCallback_t *callbacks, LoRaMacRegion_t region)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacInitialization(primitives, callbacks, region);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxQueryTxPossible(LoRaMacCtx_t *ctx, uint8_t size, LoRaMacTxInfo_t *txInfo)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacQueryTxPossible(size, txInfo);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxChannelAdd(LoRaMacCtx_t *ctx, uint8_t id, ChannelParams_t params)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacChannelAdd(id, params);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxChannelRemove(LoRaMacCtx_t *ctx, uint8_t id)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacChannelRemove(id);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxMibGetRequestConfirm(LoRaMacCtx_t *ctx, MibRequestConfirm_t *mibGet)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacMibGetRequestConfirm(mibGet);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxMibSetRequestConfirm(LoRaMacCtx_t *ctx, MibRequestConfirm_t *mibSet)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacMibSetRequestConfirm(mibSet);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxMlmeRequest(LoRaMacCtx_t *ctx, MlmeReq_t *mlmeRequest)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacMlmeRequest(mlmeRequest);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacCtxMcpsRequest(LoRaMacCtx_t *ctx, McpsReq_t *mcpsRequest)
+{
+    LoRaMacCtx_t *prev = LoRaMacSetContext(ctx);
+    LoRaMacStatus_t status = LoRaMacMcpsRequest(mcpsRequest);
+
+    LoRaMacSetContext(prev);
+    return status;
+}
+
+/*!
+ * \brief CRC-16/CCITT over a snapshot, Crc field excluded
+ */
+static uint16_t SnapshotCrc(const LoRaMacSnapshot_t *snapshot)
+{
+    const uint8_t *data = (const uint8_t *)snapshot;
+    uint16_t size = offsetof(LoRaMacSnapshot_t, Crc);
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    while (size-- > 0)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+LoRaMacStatus_t LoRaMacSnapshotSave(LoRaMacSnapshot_t *snapshot)
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    uint8_t maxNbChannels;
+
+    if (snapshot == NULL)
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if (IsLoRaMacNetworkJoined == false)
+    {
+        return LORAMAC_STATUS_NO_NETWORK_JOINED;
+    }
+
+    // Zero the padding too, it is covered by the CRC
+    memset(snapshot, 0, sizeof(LoRaMacSnapshot_t));
+    snapshot->Version = LORAMAC_SNAPSHOT_VERSION;
+    snapshot->Size = sizeof(LoRaMacSnapshot_t);
+    snapshot->Region = LoRaMacRegion;
+    snapshot->DeviceClass = MacCtx->LoRaMacDeviceClass;
+    snapshot->AdrCtrlOn = MacCtx->AdrCtrlOn;
+    snapshot->PublicNetwork = MacCtx->PublicNetwork;
+    snapshot->MaxDCycle = MacCtx->MaxDCycle;
+    snapshot->AggregatedDCycle = MacCtx->AggregatedDCycle;
+    snapshot->DevNonce = LoRaMacDevNonce;
+    snapshot->NetID = MacCtx->LoRaMacNetID;
+    snapshot->DevAddr = MacCtx->LoRaMacDevAddr;
+    memcpy(snapshot->NwkSKey, MacCtx->LoRaMacNwkSKey, sizeof(snapshot->NwkSKey));
+    memcpy(snapshot->AppSKey, MacCtx->LoRaMacAppSKey, sizeof(snapshot->AppSKey));
+    snapshot->UpLinkCounter = UpLinkCounter;
+    snapshot->DownLinkCounter = DownLinkCounter;
+    snapshot->AdrAckCounter = MacCtx->AdrAckCounter;
+    snapshot->Params = LoRaMacParams;
+
+    getPhy.Attribute = PHY_MAX_NB_CHANNELS;
+    phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
+    maxNbChannels = phyParam.Value;
+
+    getPhy.Attribute = PHY_CHANNELS_MASK;
+    phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
+    memcpy(snapshot->ChannelsMask, phyParam.ChannelsMask, ((maxNbChannels + 15) / 16) * sizeof(uint16_t));
+
+    if (maxNbChannels <= LORAMAC_SNAPSHOT_MAX_CHANNELS)
+    {
+        getPhy.Attribute = PHY_CHANNELS;
+        phyParam = RegionGetPhyParam(LoRaMacRegion, &getPhy);
+        memcpy(snapshot->Channels, phyParam.Channels, maxNbChannels * sizeof(ChannelParams_t));
+        snapshot->NbChannels = maxNbChannels;
+    }
+
+    snapshot->Crc = SnapshotCrc(snapshot);
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacSnapshotRestore(const LoRaMacSnapshot_t *snapshot)
+{
+    ChanMaskSetParams_t chanMaskSet;
+    MibRequestConfirm_t mibSet;
+    uint16_t channelsMask[6];
+    uint8_t i;
+
+    if ((snapshot == NULL) ||
+        (snapshot->Version != LORAMAC_SNAPSHOT_VERSION) ||
+        (snapshot->Size != sizeof(LoRaMacSnapshot_t)) ||
+        (snapshot->NbChannels > LORAMAC_SNAPSHOT_MAX_CHANNELS) ||
+        (snapshot->Crc != SnapshotCrc(snapshot)))
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if (snapshot->Region != LoRaMacRegion)
+    {
+        return LORAMAC_STATUS_REGION_NOT_SUPPORTED;
+    }
+    if (LoRaMacState != LORAMAC_IDLE)
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    LoRaMacDevNonce = snapshot->DevNonce;
+    MacCtx->LoRaMacNetID = snapshot->NetID;
+    MacCtx->LoRaMacDevAddr = snapshot->DevAddr;
+    memcpy(MacCtx->LoRaMacNwkSKey, snapshot->NwkSKey, sizeof(MacCtx->LoRaMacNwkSKey));
+    memcpy(MacCtx->LoRaMacAppSKey, snapshot->AppSKey, sizeof(MacCtx->LoRaMacAppSKey));
+    UpLinkCounter = snapshot->UpLinkCounter;
+    DownLinkCounter = snapshot->DownLinkCounter;
+    MacCtx->AdrCtrlOn = snapshot->AdrCtrlOn;
+    MacCtx->AdrAckCounter = snapshot->AdrAckCounter;
+    MacCtx->MaxDCycle = snapshot->MaxDCycle;
+    MacCtx->AggregatedDCycle = snapshot->AggregatedDCycle;
+    LoRaMacParams = snapshot->Params;
+
+    // Channels first, adding a channel enables it in the mask
+    for (i = 0; i < snapshot->NbChannels; i++)
+    {
+        if (snapshot->Channels[i].Frequency != 0)
+        {
+            LoRaMacChannelAdd(i, snapshot->Channels[i]);
+        }
+    }
+    memcpy(channelsMask, snapshot->ChannelsMask, sizeof(channelsMask));
+    chanMaskSet.ChannelsMaskIn = channelsMask;
+    chanMaskSet.ChannelsMaskType = CHANNELS_MASK;
+    RegionChanMaskSet(LoRaMacRegion, &chanMaskSet);
+
+    mibSet.Type = MIB_PUBLIC_NETWORK;
+    mibSet.Param.EnablePublicNetwork = snapshot->PublicNetwork;
+    LoRaMacMibSetRequestConfirm(&mibSet);
+
+    IsLoRaMacNetworkJoined = true;
+
+    if (snapshot->DeviceClass != MacCtx->LoRaMacDeviceClass)
+    {
+        SwitchClass((DeviceClass_t)snapshot->DeviceClass);
+    }
+    return LORAMAC_STATUS_OK;
+}
+
 void LoRaMacTestRxWindowsOn(bool enable)
 {
-    IsRxWindowsEnabled = enable;
+    MacCtx->IsRxWindowsEnabled = enable;
 }
 
 void LoRaMacTestSetMic(uint16_t txPacketCounter)
 {
     UpLinkCounter = txPacketCounter;
-    IsUpLinkCounterFixed = true;
+    MacCtx->IsUpLinkCounterFixed = true;
 }
 
 void LoRaMacTestSetDutyCycleOn(bool enable)
@@ -4550,21 +5185,21 @@ void LoRaMacTestSetDutyCycleOn(bool enable)
 
     if (RegionVerify(LoRaMacRegion, &verify, PHY_DUTY_CYCLE) == true)
     {
-        DutyCycleOn = enable;
+        MacCtx->DutyCycleOn = enable;
     }
 }
 
 void LoRaMacTestSetChannel(uint8_t channel)
 {
-    Channel = channel;
+    MacCtx->Channel = channel;
 }
 
 #if 0
 static void SetPublicNetwork( bool enable )
 {
-    PublicNetwork = enable;
+    MacCtx->PublicNetwork = enable;
     Radio.SetModem( MODEM_LORA );
-    if ( PublicNetwork == true ) {
+    if ( MacCtx->PublicNetwork == true ) {
         // Change LoRa modem SyncWord
         Radio.SetSyncWord( LORA_MAC_PUBLIC_SYNCWORD );
     } else {
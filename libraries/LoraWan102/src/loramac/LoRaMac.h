@@ -52,10 +52,14 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "timer.h"
 #include "../radio/radio.h"
 #include "timer.h"
 #include "LoRaMacCrypto.h"
+#include "LoRaMacScheduler.h"
+#include "LoRaMacRxTiming.h"
+#include "LoRaMacClockSync.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -2322,6 +2326,24 @@ extern "C"
      */
     LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t *txInfo);
 
+    /*!
+     * \brief   Predicts when the next uplink can go out. Reports for every
+     *          band of the region the remaining duty cycle time-off and the
+     *          number of enabled channels supporting the current datarate,
+     *          together with the usable datarate range and the last link
+     *          margin. This is the view the scheduling policy gets.
+     *
+     * \param   [IN] size - Size of applicative payload to be send next
+     *
+     * \param   [OUT] forecast - Band availability and scheduling inputs
+     *
+     * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+     *          \ref LORAMAC_STATUS_OK,
+     *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+     *          \ref LORAMAC_STATUS_DEVICE_OFF.
+     */
+    LoRaMacStatus_t LoRaMacQueryTxForecast(uint8_t size, LoRaMacTxRequest_t *forecast);
+
     /*!
      * \brief   LoRaMAC channel add service
      *
@@ -2539,6 +2561,146 @@ extern "C"
      */
     LoRaMacStatus_t LoRaMacMcpsRequest(McpsReq_t *mcpsRequest);
 
+    /*!
+     * Layout version of \ref LoRaMacSnapshot_t
+     */
+#define LORAMAC_SNAPSHOT_VERSION 1
+
+    /*!
+     * Channels kept in a snapshot. Regions with a larger, fixed channel plan
+     * only keep the channels mask.
+     */
+#define LORAMAC_SNAPSHOT_MAX_CHANNELS 16
+
+    /*!
+     * Joined session state saved by \ref LoRaMacSnapshotSave. The layout is
+     * tied to the firmware build, Version, Size and Crc reject snapshots
+     * written by another build or corrupted in storage.
+     */
+    typedef struct sLoRaMacSnapshot
+    {
+        uint8_t Version;
+        uint8_t Region;
+        uint8_t DeviceClass;
+        uint8_t NbChannels;
+        bool AdrCtrlOn;
+        bool PublicNetwork;
+        uint8_t MaxDCycle;
+        uint16_t AggregatedDCycle;
+        uint16_t DevNonce;
+        uint32_t NetID;
+        uint32_t DevAddr;
+        uint8_t NwkSKey[16];
+        uint8_t AppSKey[16];
+        /*!
+         * Next uplink frame counter. Callers restoring from storage that is
+         * not written after every uplink should add the save interval.
+         */
+        uint32_t UpLinkCounter;
+        uint32_t DownLinkCounter;
+        uint32_t AdrAckCounter;
+        LoRaMacParams_t Params;
+        uint16_t ChannelsMask[6];
+        ChannelParams_t Channels[LORAMAC_SNAPSHOT_MAX_CHANNELS];
+        uint16_t Size;
+        uint16_t Crc;
+    } LoRaMacSnapshot_t;
+
+    /*!
+     * \brief   Captures the joined session of the selected context: session
+     *          keys, addresses, frame counters, ADR state, MAC parameters
+     *          and the channel plan.
+     *
+     * \param   [OUT] snapshot - Snapshot to fill.
+     *
+     * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+     *          \ref LORAMAC_STATUS_OK,
+     *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+     *          \ref LORAMAC_STATUS_NO_NETWORK_JOINED.
+     */
+    LoRaMacStatus_t LoRaMacSnapshotSave(LoRaMacSnapshot_t *snapshot);
+
+    /*!
+     * \brief   Restores a session captured by \ref LoRaMacSnapshotSave. The MAC
+     *          must be initialized for the same region and idle. Replaces
+     *          the join procedure, the device is joined on success.
+     *
+     * \param   [IN] snapshot - Snapshot to restore.
+     *
+     * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+     *          \ref LORAMAC_STATUS_OK,
+     *          \ref LORAMAC_STATUS_BUSY,
+     *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+     *          \ref LORAMAC_STATUS_REGION_NOT_SUPPORTED.
+     */
+    LoRaMacStatus_t LoRaMacSnapshotRestore(const LoRaMacSnapshot_t *snapshot);
+
+    /*!
+     * LoRaMac instance state. Opaque, allocate \ref LoRaMacGetContextSize bytes
+     * and prepare them with \ref LoRaMacContextInit.
+     */
+    typedef struct sLoRaMacCtx LoRaMacCtx_t;
+
+    /*!
+     * \brief   Returns the memory needed by a MAC context, including the
+     *          region state.
+     *
+     * \param   [IN] region - Region the context will be initialized for.
+     *
+     * \retval  Size in bytes, 0 if the region is not supported.
+     */
+    size_t LoRaMacGetContextSize(LoRaMacRegion_t region);
+
+    /*!
+     * \brief   Prepares a memory block as a fresh MAC context. The context
+     *          still has to be selected and initialized with
+     *          \ref LoRaMacInitialization or \ref LoRaMacCtxInitialization.
+     *
+     * \param   [IN] buffer - Memory of at least \ref LoRaMacGetContextSize
+     *                       bytes, word aligned.
+     * \param   [IN] region - Region the context will be initialized for.
+     *
+     * \retval  The context.
+     */
+    LoRaMacCtx_t *LoRaMacContextInit(void *buffer, LoRaMacRegion_t region);
+
+    /*!
+     * \brief   Selects the context used by the LoRaMac API, the radio event
+     *          handlers and the MAC timers.
+     *
+     * \details Every LoRaMac function without a context argument works on the
+     *          selected context, which is a built-in one unless changed. The
+     *          radio and the timer server are not virtualised: events must be
+     *          dispatched while the context that started the operation is
+     *          selected. On the device only one context should be active at a
+     *          time, host builds typically switch contexts around each
+     *          simulated event.
+     *
+     * \param   [IN] ctx - Context to select, NULL for the built-in one.
+     *
+     * \retval  The previously selected context.
+     */
+    LoRaMacCtx_t *LoRaMacSetContext(LoRaMacCtx_t *ctx);
+
+    /*!
+     * \brief   Returns the selected context.
+     */
+    LoRaMacCtx_t *LoRaMacGetContext(void);
+
+    /*!
+     * Variants of the LoRaMac API working on an explicit context. They select
+     * ctx for the duration of the call and restore the previous selection.
+     */
+    LoRaMacStatus_t LoRaMacCtxInitialization(LoRaMacCtx_t *ctx, LoRaMacPrimitives_t *primitives,
+                                             LoRaMacCallback_t *callbacks, LoRaMacRegion_t region);
+    LoRaMacStatus_t LoRaMacCtxQueryTxPossible(LoRaMacCtx_t *ctx, uint8_t size, LoRaMacTxInfo_t *txInfo);
+    LoRaMacStatus_t LoRaMacCtxChannelAdd(LoRaMacCtx_t *ctx, uint8_t id, ChannelParams_t params);
+    LoRaMacStatus_t LoRaMacCtxChannelRemove(LoRaMacCtx_t *ctx, uint8_t id);
+    LoRaMacStatus_t LoRaMacCtxMibGetRequestConfirm(LoRaMacCtx_t *ctx, MibRequestConfirm_t *mibGet);
+    LoRaMacStatus_t LoRaMacCtxMibSetRequestConfirm(LoRaMacCtx_t *ctx, MibRequestConfirm_t *mibSet);
+    LoRaMacStatus_t LoRaMacCtxMlmeRequest(LoRaMacCtx_t *ctx, MlmeReq_t *mlmeRequest);
+    LoRaMacStatus_t LoRaMacCtxMcpsRequest(LoRaMacCtx_t *ctx, McpsReq_t *mcpsRequest);
+
     extern void turnOnRGB(uint32_t color, uint32_t time);
     extern void turnOffRGB(void);
 
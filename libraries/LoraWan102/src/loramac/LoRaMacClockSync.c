@@ -0,0 +1,417 @@
+/*!
+ * \file      LoRaMacClockSync.c
+ *
+ * \brief     RTC drift estimation from network time
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "timer.h"
+#include "LoRaMacClockSync.h"
+
+/*!
+ * Shortest interval between two syncs of one temperature bin for its rate
+ * to be averaged, the sync resolution is 2 ppm over this time [ms]
+ */
+#define CLOCK_SYNC_MIN_BIN_SPAN 3600000
+
+/*!
+ * Consecutive outliers after which the network time is taken as having
+ * jumped and the fit restarts
+ */
+#define CLOCK_SYNC_MAX_OUTLIERS 2
+
+/*!
+ * Set where the timer server applies the rate between syncs. Elsewhere the
+ * clock keeps running at the fitted rate and its error grows with it.
+ */
+#ifdef __asr6601__
+#define CLOCK_SYNC_CORRECTED 1
+#else
+#define CLOCK_SYNC_CORRECTED 0
+#endif
+
+/*!
+ * Bisection steps of SyncInterval, enough to get below 1 ms over a week
+ */
+#define CLOCK_SYNC_INTERVAL_STEPS 32
+
+/*!
+ * State used until LoRaMacClockSyncSetContext selects another one
+ */
+static LoRaMacClockSyncCtx_t ClockSyncCtxDefault = {
+    .Params = {0, LORAMAC_CLOCK_SYNC_DEFAULT_MIN_INTERVAL, LORAMAC_CLOCK_SYNC_DEFAULT_MAX_INTERVAL},
+    .Stats = {.Temperature = LORAMAC_CLOCK_SYNC_NO_TEMPERATURE}};
+
+/*!
+ * Selected state
+ */
+static LoRaMacClockSyncCtx_t *ClockSyncCtx = &ClockSyncCtxDefault;
+
+void LoRaMacClockSyncInitContext(LoRaMacClockSyncCtx_t *ctx)
+{
+    memset(ctx, 0, sizeof(LoRaMacClockSyncCtx_t));
+    ctx->Params.MinInterval = LORAMAC_CLOCK_SYNC_DEFAULT_MIN_INTERVAL;
+    ctx->Params.MaxInterval = LORAMAC_CLOCK_SYNC_DEFAULT_MAX_INTERVAL;
+    ctx->Stats.Temperature = LORAMAC_CLOCK_SYNC_NO_TEMPERATURE;
+}
+
+void LoRaMacClockSyncSetContext(LoRaMacClockSyncCtx_t *ctx)
+{
+    ClockSyncCtx = (ctx != NULL) ? ctx : &ClockSyncCtxDefault;
+#ifdef __asr6601__
+    // One RTC, it runs at the rate of the context that keeps its time
+    TimerSetDriftCorrection(ClockSyncCtx->Stats.AppliedPpb);
+#endif
+}
+
+static int64_t ToMs(TimerSysTime_t sysTime)
+{
+    return (int64_t)sysTime.Seconds * 1000 + sysTime.SubSeconds;
+}
+
+static int64_t McuNow(void)
+{
+    return ToMs(SysTimeGetMcuTime());
+}
+
+static uint8_t Bin(int8_t temperature)
+{
+    int16_t bin = ((int16_t)temperature - LORAMAC_CLOCK_SYNC_TEMP_MIN) / LORAMAC_CLOCK_SYNC_TEMP_STEP;
+
+    if (temperature < LORAMAC_CLOCK_SYNC_TEMP_MIN)
+    {
+        bin = 0;
+    }
+    if (bin >= LORAMAC_CLOCK_SYNC_TEMP_BINS)
+    {
+        bin = LORAMAC_CLOCK_SYNC_TEMP_BINS - 1;
+    }
+    return (uint8_t)bin;
+}
+
+static void Fit(void)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    const LoRaMacClockSyncSample_t *newest = &ctx->Samples[ctx->Newest];
+    double xm = 0;
+    double ym = 0;
+    double sxx = 0;
+    double sxy = 0;
+    double s2 = 0;
+    double x;
+    double y;
+    double r;
+    uint8_t i;
+
+    ctx->FitValid = false;
+    if (ctx->NbSamples < 2)
+    {
+        return;
+    }
+    for (i = 0; i < ctx->NbSamples; i++)
+    {
+        xm += (double)(ctx->Samples[i].Local - newest->Local);
+        ym += (double)(ctx->Samples[i].Offset - newest->Offset);
+    }
+    xm /= ctx->NbSamples;
+    ym /= ctx->NbSamples;
+    for (i = 0; i < ctx->NbSamples; i++)
+    {
+        x = (double)(ctx->Samples[i].Local - newest->Local) - xm;
+        y = (double)(ctx->Samples[i].Offset - newest->Offset) - ym;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    if (sxx <= 0)
+    {
+        return;
+    }
+    ctx->FitSlope = sxy / sxx;
+    if (ctx->NbSamples > 2)
+    {
+        for (i = 0; i < ctx->NbSamples; i++)
+        {
+            x = (double)(ctx->Samples[i].Local - newest->Local) - xm;
+            r = (double)(ctx->Samples[i].Offset - newest->Offset) - ym - ctx->FitSlope * x;
+            s2 += r * r;
+        }
+        s2 /= ctx->NbSamples - 2;
+    }
+    // A sync is never better than its resolution
+    if (s2 < (LORAMAC_CLOCK_SYNC_RESOLUTION * LORAMAC_CLOCK_SYNC_RESOLUTION) / 4.0)
+    {
+        s2 = (LORAMAC_CLOCK_SYNC_RESOLUTION * LORAMAC_CLOCK_SYNC_RESOLUTION) / 4.0;
+    }
+    ctx->FitXm = xm;
+    ctx->FitSxx = sxx;
+    ctx->FitS2 = s2;
+
+    ctx->Stats.FitPpb = (int32_t)(ctx->FitSlope * 1e9);
+    ctx->Stats.Residual = (uint32_t)(sqrt(s2) * 1000);
+    ctx->FitValid = (ctx->NbSamples >= LORAMAC_CLOCK_SYNC_MIN_SAMPLES) &&
+                    (fabs(ctx->FitSlope) <= LORAMAC_CLOCK_SYNC_MAX_PPM * 1e-6);
+}
+
+/*!
+ * \brief   Predicted time error [ms] at a time after the newest sync, two
+ *          standard deviations of the fitted line, plus the drift itself
+ *          where the clock is not corrected
+ */
+static double PredictError(double elapsed)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    double x;
+    double error;
+
+    if (ctx->FitValid == false)
+    {
+        return LORAMAC_CLOCK_SYNC_RESOLUTION + elapsed * LORAMAC_CLOCK_SYNC_DEFAULT_PPM / 1e6;
+    }
+    x = elapsed - ctx->FitXm;
+    error = 2 * sqrt(ctx->FitS2 / ctx->NbSamples + ctx->FitS2 * x * x / ctx->FitSxx);
+#if (CLOCK_SYNC_CORRECTED == 0)
+    error += fabs(ctx->FitSlope) * elapsed;
+#endif
+    return error;
+}
+
+/*!
+ * \brief   Time after the newest sync at which the error reaches MaxError.
+ *          The error only grows after the newest sync, it is bisected.
+ */
+static int64_t SyncInterval(void)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    double budget = ctx->Params.MaxError;
+    double low = ctx->Params.MinInterval;
+    double high = ctx->Params.MaxInterval;
+    double mid;
+    uint8_t i;
+
+    if (PredictError(low) >= budget)
+    {
+        return (int64_t)low;
+    }
+    if (PredictError(high) <= budget)
+    {
+        return (int64_t)high;
+    }
+    for (i = 0; i < CLOCK_SYNC_INTERVAL_STEPS; i++)
+    {
+        mid = (low + high) / 2;
+        if (PredictError(mid) < budget)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return (int64_t)low;
+}
+
+static void Apply(int32_t ppb)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+
+    if (ppb == ctx->Stats.AppliedPpb)
+    {
+        return;
+    }
+    ctx->Stats.AppliedPpb = ppb;
+#ifdef __asr6601__
+    TimerSetDriftCorrection(ppb);
+#endif
+}
+
+void LoRaMacClockSyncUpdate(int8_t temperature)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    int32_t ppb = (ctx->FitValid == true) ? ctx->Stats.FitPpb : 0;
+    uint8_t bin = Bin(temperature);
+
+    if ((temperature != LORAMAC_CLOCK_SYNC_NO_TEMPERATURE) && (ctx->Bins[bin].Count >= 2))
+    {
+        ppb = ctx->Bins[bin].Ppb;
+    }
+    ctx->Stats.Temperature = temperature;
+    Apply(ppb);
+}
+
+void LoRaMacClockSyncAddSample(TimerSysTime_t networkTime, TimerSysTime_t mcuTime, int8_t temperature)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    LoRaMacClockSyncSample_t sample;
+    const LoRaMacClockSyncSample_t *last = &ctx->Samples[ctx->Newest];
+    int64_t span;
+    int64_t drift;
+    int32_t ppb;
+    uint8_t bin;
+
+    sample.Local = ToMs(mcuTime);
+    sample.Offset = ToMs(networkTime) - sample.Local;
+    sample.Temperature = temperature;
+    ctx->Stats.Syncs++;
+    ctx->Requested = false;
+
+    if (ctx->NbSamples > 0)
+    {
+        span = sample.Local - last->Local;
+        drift = sample.Offset - last->Offset;
+        if (span <= 0)
+        {
+            // The MCU restarted, the old samples are on another time base
+            ctx->NbSamples = 0;
+        }
+        else if (((drift < 0) ? -drift : drift) >
+                 2 * LORAMAC_CLOCK_SYNC_RESOLUTION + span * LORAMAC_CLOCK_SYNC_MAX_PPM / 1000000)
+        {
+            ctx->Stats.Rejected++;
+            if (++ctx->Outliers < CLOCK_SYNC_MAX_OUTLIERS)
+            {
+                return;
+            }
+            ctx->NbSamples = 0;
+        }
+        else
+        {
+            bin = Bin(temperature);
+            if ((temperature != LORAMAC_CLOCK_SYNC_NO_TEMPERATURE) && (span >= CLOCK_SYNC_MIN_BIN_SPAN) &&
+                (last->Temperature != LORAMAC_CLOCK_SYNC_NO_TEMPERATURE) && (Bin(last->Temperature) == bin))
+            {
+                ppb = (int32_t)(drift * 1000000000 / span);
+                if (ctx->Bins[bin].Count == 0)
+                {
+                    ctx->Bins[bin].Ppb = ppb;
+                }
+                else
+                {
+                    ctx->Bins[bin].Ppb += (ppb - ctx->Bins[bin].Ppb) / 4;
+                }
+                if (ctx->Bins[bin].Count < 0xFFFF)
+                {
+                    ctx->Bins[bin].Count++;
+                }
+            }
+        }
+    }
+    ctx->Outliers = 0;
+
+    if (ctx->NbSamples == 0)
+    {
+        ctx->Newest = 0;
+    }
+    else
+    {
+        ctx->Newest = (ctx->Newest + 1) % LORAMAC_CLOCK_SYNC_MAX_SAMPLES;
+    }
+    ctx->Samples[ctx->Newest] = sample;
+    if (ctx->NbSamples < LORAMAC_CLOCK_SYNC_MAX_SAMPLES)
+    {
+        ctx->NbSamples++;
+    }
+    ctx->Stats.Samples = ctx->NbSamples;
+
+    Fit();
+    ctx->NextSyncAt = sample.Local + SyncInterval();
+    LoRaMacClockSyncUpdate(temperature);
+}
+
+bool LoRaMacClockSyncRequestDue(void)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    int64_t now;
+
+    if (ctx->Params.MaxError == 0)
+    {
+        return false;
+    }
+    now = McuNow();
+    if (now < ctx->NextSyncAt)
+    {
+        return false;
+    }
+    if ((ctx->Requested == true) && (now - ctx->LastRequest < ctx->Params.MinInterval))
+    {
+        return false;
+    }
+    ctx->Requested = true;
+    ctx->LastRequest = now;
+    return true;
+}
+
+bool LoRaMacClockSyncGetDrift(int32_t *ppb)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+
+    if (ctx->FitValid == false)
+    {
+        return false;
+    }
+#if (CLOCK_SYNC_CORRECTED == 1)
+    *ppb = ctx->Stats.FitPpb - ctx->Stats.AppliedPpb;
+#else
+    *ppb = ctx->Stats.FitPpb;
+#endif
+    return true;
+}
+
+bool LoRaMacClockSyncGetSysTime(TimerSysTime_t *sysTime)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    const LoRaMacClockSyncSample_t *newest = &ctx->Samples[ctx->Newest];
+    int64_t now;
+    int64_t time;
+
+    if (ctx->NbSamples == 0)
+    {
+        return false;
+    }
+    now = McuNow();
+    time = now + newest->Offset + (now - newest->Local) * ctx->Stats.AppliedPpb / 1000000000;
+    sysTime->Seconds = (uint32_t)(time / 1000);
+    sysTime->SubSeconds = (int16_t)(time % 1000);
+    return true;
+}
+
+void LoRaMacClockSyncSetParams(const LoRaMacClockSyncParams_t *params)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+
+    ctx->Params = *params;
+    if (ctx->NbSamples > 0)
+    {
+        ctx->NextSyncAt = ctx->Samples[ctx->Newest].Local + SyncInterval();
+    }
+}
+
+void LoRaMacClockSyncGetStats(LoRaMacClockSyncStats_t *stats)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+    int64_t now = McuNow();
+    double elapsed = (ctx->NbSamples > 0) ? (double)(now - ctx->Samples[ctx->Newest].Local) : 0;
+
+    ctx->Stats.Error = (ctx->NbSamples > 0) ? (uint32_t)PredictError(elapsed) : 0;
+    ctx->Stats.NextSync = (ctx->NextSyncAt > now) ? (uint32_t)(ctx->NextSyncAt - now) : 0;
+    *stats = ctx->Stats;
+}
+
+void LoRaMacClockSyncReset(void)
+{
+    LoRaMacClockSyncCtx_t *ctx = ClockSyncCtx;
+
+    ctx->NbSamples = 0;
+    ctx->Newest = 0;
+    ctx->Outliers = 0;
+    ctx->FitValid = false;
+    ctx->NextSyncAt = 0;
+    ctx->Requested = false;
+    memset(ctx->Bins, 0, sizeof(ctx->Bins));
+    Apply(0);
+    memset(&ctx->Stats, 0, sizeof(ctx->Stats));
+    ctx->Stats.Temperature = LORAMAC_CLOCK_SYNC_NO_TEMPERATURE;
+}
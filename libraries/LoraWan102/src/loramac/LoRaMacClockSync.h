@@ -0,0 +1,271 @@
+/*!
+ * \file      LoRaMacClockSync.h
+ *
+ * \brief     RTC drift estimation from network time
+ *
+ * \details   Every DeviceTimeAns gives the network time of the end of an
+ *            uplink. Paired with the MCU time of the same TxDone it yields
+ *            the offset of the free running RTC against the network. The
+ *            offsets of the last syncs are fitted with a least squares line,
+ *            the slope being the RTC frequency error.
+ *
+ *            On ASR6601 the estimated rate is handed to the timer server
+ *            (TimerSetDriftCorrection), which then corrects TimerGetCurrentTime
+ *            and the RTC alarms between syncs. The ASR650x timer server is
+ *            part of the precompiled core library; there the corrected time
+ *            is available through \ref LoRaMacClockSyncGetSysTime only and
+ *            the predicted error includes the drift of the clock itself.
+ *
+ *            When the application reports the temperature through the
+ *            GetTemperatureLevel callback, the rate measured between two
+ *            syncs taken in the same temperature bin is also averaged per
+ *            bin and preferred over the overall fit at that temperature.
+ *
+ *            From the scatter of the fit the MAC predicts how fast the time
+ *            error grows and, when a maximum error is set, adds a
+ *            DeviceTimeReq to an uplink just before that error is reached.
+ *
+ *            The state belongs to the LoRaMac context, LoRaMacSetContext
+ *            selects it. There is one RTC, on ASR6601 it runs at the rate
+ *            of the selected context.
+ *
+ * \defgroup  LORAMACCLOCKSYNC LoRa MAC clock synchronisation
+ * \{
+ */
+#ifndef __LORAMAC_CLOCK_SYNC_H__
+#define __LORAMAC_CLOCK_SYNC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/*!
+ * Syncs kept for the fit
+ */
+#define LORAMAC_CLOCK_SYNC_MAX_SAMPLES 8
+
+/*!
+ * Syncs needed before a rate is applied
+ */
+#define LORAMAC_CLOCK_SYNC_MIN_SAMPLES 3
+
+/*!
+ * Rates beyond this are not a crystal error, e.g. the network time jumped [ppm]
+ */
+#define LORAMAC_CLOCK_SYNC_MAX_PPM 500
+
+/*!
+ * Frequency tolerance assumed until a rate is measured [ppm]
+ */
+#define LORAMAC_CLOCK_SYNC_DEFAULT_PPM 50
+
+/*!
+ * Resolution of a sync: DeviceTimeAns carries 1/256 s plus TxDone latency [ms]
+ */
+#define LORAMAC_CLOCK_SYNC_RESOLUTION 4
+
+/*!
+ * Temperature bins, LORAMAC_CLOCK_SYNC_TEMP_STEP wide from
+ * LORAMAC_CLOCK_SYNC_TEMP_MIN, the outer bins are open ended [degC]
+ */
+#define LORAMAC_CLOCK_SYNC_TEMP_BINS 8
+#define LORAMAC_CLOCK_SYNC_TEMP_MIN -20
+#define LORAMAC_CLOCK_SYNC_TEMP_STEP 10
+
+/*!
+ * Temperature value meaning "unknown"
+ */
+#define LORAMAC_CLOCK_SYNC_NO_TEMPERATURE -128
+
+/*!
+ * Default bounds of the sync interval [ms]
+ */
+#define LORAMAC_CLOCK_SYNC_DEFAULT_MIN_INTERVAL 600000
+#define LORAMAC_CLOCK_SYNC_DEFAULT_MAX_INTERVAL 604800000
+
+/*!
+ * Sync policy
+ */
+typedef struct sLoRaMacClockSyncParams
+{
+    /*!
+     * Time error at which a DeviceTimeReq is added to the next uplink [ms],
+     * 0 leaves the requests to the application
+     */
+    uint32_t MaxError;
+    /*!
+     * Bounds of the interval between requests, the lower one is also the
+     * retry time of an unanswered request [ms]
+     */
+    uint32_t MinInterval;
+    uint32_t MaxInterval;
+} LoRaMacClockSyncParams_t;
+
+/*!
+ * State of the estimator
+ */
+typedef struct sLoRaMacClockSyncStats
+{
+    /*!
+     * Syncs received and syncs rejected as outliers
+     */
+    uint16_t Syncs;
+    uint16_t Rejected;
+    /*!
+     * Syncs in the fit
+     */
+    uint8_t Samples;
+    /*!
+     * Rate of the fit and rate applied to the clock [ppb], positive when the
+     * RTC is slow
+     */
+    int32_t FitPpb;
+    int32_t AppliedPpb;
+    /*!
+     * Rms residual of the fit [us]
+     */
+    uint32_t Residual;
+    /*!
+     * Predicted time error of the MCU clock now [ms]
+     */
+    uint32_t Error;
+    /*!
+     * Time until the error reaches MaxError [ms]
+     */
+    uint32_t NextSync;
+    /*!
+     * Temperature the applied rate belongs to [degC]
+     */
+    int8_t Temperature;
+} LoRaMacClockSyncStats_t;
+
+/*!
+ * One DeviceTimeAns
+ */
+typedef struct sLoRaMacClockSyncSample
+{
+    /*!
+     * MCU time of the TxDone [ms]
+     */
+    int64_t Local;
+    /*!
+     * Network time minus MCU time [ms]
+     */
+    int64_t Offset;
+    int8_t Temperature;
+} LoRaMacClockSyncSample_t;
+
+/*!
+ * Rate measured in one temperature bin
+ */
+typedef struct sLoRaMacClockSyncBin
+{
+    int32_t Ppb;
+    uint16_t Count;
+} LoRaMacClockSyncBin_t;
+
+/*!
+ * State of one LoRaMac context
+ */
+typedef struct sLoRaMacClockSyncCtx
+{
+    /*!
+     * Syncs of the fit, a ring ending at Newest
+     */
+    LoRaMacClockSyncSample_t Samples[LORAMAC_CLOCK_SYNC_MAX_SAMPLES];
+    uint8_t NbSamples;
+    uint8_t Newest;
+    uint8_t Outliers;
+    LoRaMacClockSyncBin_t Bins[LORAMAC_CLOCK_SYNC_TEMP_BINS];
+    /*!
+     * Fit of the offsets against the MCU time, x relative to the newest sample
+     */
+    bool FitValid;
+    double FitSlope;
+    double FitXm;
+    double FitSxx;
+    double FitS2;
+    /*!
+     * MCU time the next request is due and the last one was sent [ms]
+     */
+    int64_t NextSyncAt;
+    int64_t LastRequest;
+    bool Requested;
+    LoRaMacClockSyncParams_t Params;
+    LoRaMacClockSyncStats_t Stats;
+} LoRaMacClockSyncCtx_t;
+
+/*!
+ * \brief   Prepares the state of a new context: no syncs, default policy
+ *
+ * \param   [IN] ctx - State to prepare
+ */
+void LoRaMacClockSyncInitContext(LoRaMacClockSyncCtx_t *ctx);
+
+/*!
+ * \brief   Selects the state the other calls work on
+ *
+ * \param   [IN] ctx - State of the context, NULL selects the built-in one
+ */
+void LoRaMacClockSyncSetContext(LoRaMacClockSyncCtx_t *ctx);
+
+/*!
+ * \brief   Records a DeviceTimeAns
+ *
+ * \param   [IN] networkTime - Network time of the end of the uplink
+ * \param   [IN] mcuTime     - MCU time of the same TxDone, SysTimeGetMcuTime
+ * \param   [IN] temperature - Temperature [degC] or LORAMAC_CLOCK_SYNC_NO_TEMPERATURE
+ */
+void LoRaMacClockSyncAddSample(TimerSysTime_t networkTime, TimerSysTime_t mcuTime, int8_t temperature);
+
+/*!
+ * \brief   Selects the rate for the current temperature and hands it to the
+ *          timer server. Called by the MAC for every uplink.
+ *
+ * \param   [IN] temperature - Temperature [degC] or LORAMAC_CLOCK_SYNC_NO_TEMPERATURE
+ */
+void LoRaMacClockSyncUpdate(int8_t temperature);
+
+/*!
+ * \brief   Tells whether the next uplink shall carry a DeviceTimeReq. Marks
+ *          the request as sent when it returns true.
+ */
+bool LoRaMacClockSyncRequestDue(void);
+
+/*!
+ * \brief   Rate error of the MCU clock left after the timer server's
+ *          correction, positive when the RTC is slow
+ *
+ * \param   [OUT] ppb - Rate error [ppb]
+ *
+ * \retval  false until a rate is measured
+ */
+bool LoRaMacClockSyncGetDrift(int32_t *ppb);
+
+/*!
+ * \brief   Network time estimated from the MCU time and the fit
+ *
+ * \param   [OUT] sysTime - Estimated network time, Unix epoch
+ *
+ * \retval  false before the first sync
+ */
+bool LoRaMacClockSyncGetSysTime(TimerSysTime_t *sysTime);
+
+/*!
+ * \brief   Sets the sync policy
+ */
+void LoRaMacClockSyncSetParams(const LoRaMacClockSyncParams_t *params);
+
+/*!
+ * \brief   Returns the state of the estimator
+ */
+void LoRaMacClockSyncGetStats(LoRaMacClockSyncStats_t *stats);
+
+/*!
+ * \brief   Forgets all syncs and removes the correction from the clock
+ */
+void LoRaMacClockSyncReset(void);
+
+/*! \} defgroup LORAMACCLOCKSYNC */
+
+#endif // __LORAMAC_CLOCK_SYNC_H__
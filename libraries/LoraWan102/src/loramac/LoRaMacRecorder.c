@@ -0,0 +1,514 @@
+/*!
+ * \file      LoRaMacRecorder.c
+ *
+ * \brief     Radio event recorder and replay for the LoRa MAC layer
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "ASR_Arduino.h"
+#include "timer.h"
+#include "LoRaMacRecorder.h"
+
+/*!
+ * Fixed part of a record: event, timestamp, duration
+ */
+#define RECORD_HEADER_SIZE 9
+
+/*!
+ * Offset of the duration in a record
+ */
+#define RECORD_DURATION 5
+
+/*!
+ * MAC handlers the recorder forwards to
+ */
+static RadioEvents_t MacEvents;
+
+/*!
+ * Capture buffer, NULL when not recording
+ */
+static uint8_t *RecordBuffer = NULL;
+static uint16_t RecordBufferSize;
+static uint16_t RecordLength;
+static uint16_t RecordDropped;
+
+/*!
+ * Payload copy handed to the MAC during replay, the MAC may decrypt in place
+ */
+static uint8_t ReplayPayload[255];
+
+static void PutU16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void PutU32(uint8_t *p, uint32_t v)
+{
+    PutU16(p, v & 0xFFFF);
+    PutU16(p + 2, v >> 16);
+}
+
+static uint16_t GetU16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t GetU32(const uint8_t *p)
+{
+    return (uint32_t)GetU16(p) | ((uint32_t)GetU16(p + 2) << 16);
+}
+
+/*!
+ * \brief   Reserves room for a record and writes its fixed part
+ *
+ * \retval  Start of the record, NULL if not recording or buffer full
+ */
+static uint8_t *RecordBegin(LoRaMacRecordEvent_t event, uint16_t dataSize)
+{
+    uint8_t *rec = NULL;
+    uint8_t state;
+
+    // thread and radio interrupt context record, the reservation is atomic
+    state = CyEnterCriticalSection();
+    if (RecordBuffer != NULL)
+    {
+        if ((uint32_t)RecordLength + RECORD_HEADER_SIZE + dataSize > RecordBufferSize)
+        {
+            RecordDropped++;
+        }
+        else
+        {
+            rec = RecordBuffer + RecordLength;
+            RecordLength += RECORD_HEADER_SIZE + dataSize;
+        }
+    }
+    CyExitCriticalSection(state);
+    if (rec == NULL)
+    {
+        return NULL;
+    }
+    rec[0] = event;
+    PutU32(rec + 1, TimerGetCurrentTime());
+    // the duration field holds the start time until the record is ended,
+    // a request made from within an event handler nests safely
+    PutU32(rec + RECORD_DURATION, micros());
+    return rec;
+}
+
+void LoRaMacRecorderEnd(void *record)
+{
+    uint8_t *rec = (uint8_t *)record;
+
+    if (rec != NULL)
+    {
+        PutU32(rec + RECORD_DURATION, micros() - GetU32(rec + RECORD_DURATION));
+    }
+}
+
+static void RecTxDone(void)
+{
+    uint8_t *rec = RecordBegin(LORAMAC_RECORD_TX_DONE, 0);
+    MacEvents.TxDone();
+    LoRaMacRecorderEnd(rec);
+}
+
+static void RecTxTimeout(void)
+{
+    uint8_t *rec = RecordBegin(LORAMAC_RECORD_TX_TIMEOUT, 0);
+    MacEvents.TxTimeout();
+    LoRaMacRecorderEnd(rec);
+}
+
+static void RecRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
+{
+    uint8_t *rec = RecordBegin(LORAMAC_RECORD_RX_DONE, 4 + size);
+
+    if (rec != NULL)
+    {
+        PutU16(rec + RECORD_HEADER_SIZE, (uint16_t)rssi);
+        rec[RECORD_HEADER_SIZE + 2] = (uint8_t)snr;
+        rec[RECORD_HEADER_SIZE + 3] = (uint8_t)size;
+        memcpy(rec + RECORD_HEADER_SIZE + 4, payload, size);
+        // the copy is not part of the MAC processing time
+        PutU32(rec + RECORD_DURATION, micros());
+    }
+    MacEvents.RxDone(payload, size, rssi, snr);
+    LoRaMacRecorderEnd(rec);
+}
+
+static void RecRxTimeout(void)
+{
+    uint8_t *rec = RecordBegin(LORAMAC_RECORD_RX_TIMEOUT, 0);
+    MacEvents.RxTimeout();
+    LoRaMacRecorderEnd(rec);
+}
+
+static void RecRxError(void)
+{
+    uint8_t *rec = RecordBegin(LORAMAC_RECORD_RX_ERROR, 0);
+    MacEvents.RxError();
+    LoRaMacRecorderEnd(rec);
+}
+
+static void RecCadDone(bool channelActivityDetected)
+{
+    uint8_t *rec = RecordBegin(LORAMAC_RECORD_CAD_DONE, 1);
+
+    if (rec != NULL)
+    {
+        rec[RECORD_HEADER_SIZE] = channelActivityDetected;
+    }
+    MacEvents.CadDone(channelActivityDetected);
+    LoRaMacRecorderEnd(rec);
+}
+
+void LoRaMacRecorderHook(RadioEvents_t *events)
+{
+    MacEvents = *events;
+    events->TxDone = (MacEvents.TxDone != NULL) ? RecTxDone : NULL;
+    events->TxTimeout = (MacEvents.TxTimeout != NULL) ? RecTxTimeout : NULL;
+    events->RxDone = (MacEvents.RxDone != NULL) ? RecRxDone : NULL;
+    events->RxTimeout = (MacEvents.RxTimeout != NULL) ? RecRxTimeout : NULL;
+    events->RxError = (MacEvents.RxError != NULL) ? RecRxError : NULL;
+    events->CadDone = (MacEvents.CadDone != NULL) ? RecCadDone : NULL;
+}
+
+void LoRaMacRecorderStart(uint8_t *buffer, uint16_t size)
+{
+    MibRequestConfirm_t mib;
+
+    RecordBuffer = NULL;
+    if ((buffer == NULL) || (size < LORAMAC_RECORDER_HEADER_SIZE))
+    {
+        return;
+    }
+    buffer[0] = 'L';
+    buffer[1] = 'R';
+    buffer[2] = LORAMAC_RECORDER_VERSION;
+    mib.Type = MIB_DEV_ADDR;
+    LoRaMacMibGetRequestConfirm(&mib);
+    PutU32(buffer + 3, mib.Param.DevAddr);
+    mib.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mib);
+    PutU32(buffer + 7, mib.Param.UpLinkCounter);
+    mib.Type = MIB_DOWNLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mib);
+    PutU32(buffer + 11, mib.Param.DownLinkCounter);
+    mib.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm(&mib);
+    buffer[15] = (uint8_t)mib.Param.ChannelsDatarate;
+    mib.Type = MIB_ADR;
+    LoRaMacMibGetRequestConfirm(&mib);
+    buffer[16] = mib.Param.AdrEnable;
+
+    RecordLength = LORAMAC_RECORDER_HEADER_SIZE;
+    RecordBufferSize = size;
+    RecordDropped = 0;
+    RecordBuffer = buffer;
+}
+
+uint16_t LoRaMacRecorderStop(void)
+{
+    RecordBuffer = NULL;
+    return RecordLength;
+}
+
+uint16_t LoRaMacRecorderDropped(void)
+{
+    return RecordDropped;
+}
+
+void *LoRaMacRecorderMcpsBegin(const McpsReq_t *mcpsRequest)
+{
+    uint8_t *rec;
+    const uint8_t *payload = NULL;
+    uint8_t port = 0;
+    uint8_t size = 0;
+    uint8_t trials = 0;
+    int8_t datarate = 0;
+
+    if ((RecordBuffer == NULL) || (mcpsRequest == NULL))
+    {
+        return NULL;
+    }
+    switch (mcpsRequest->Type)
+    {
+    case MCPS_UNCONFIRMED:
+        port = mcpsRequest->Req.Unconfirmed.fPort;
+        payload = mcpsRequest->Req.Unconfirmed.fBuffer;
+        size = mcpsRequest->Req.Unconfirmed.fBufferSize;
+        datarate = mcpsRequest->Req.Unconfirmed.Datarate;
+        break;
+    case MCPS_CONFIRMED:
+        port = mcpsRequest->Req.Confirmed.fPort;
+        payload = mcpsRequest->Req.Confirmed.fBuffer;
+        size = mcpsRequest->Req.Confirmed.fBufferSize;
+        datarate = mcpsRequest->Req.Confirmed.Datarate;
+        trials = mcpsRequest->Req.Confirmed.NbTrials;
+        break;
+    case MCPS_PROPRIETARY:
+        payload = mcpsRequest->Req.Proprietary.fBuffer;
+        size = mcpsRequest->Req.Proprietary.fBufferSize;
+        datarate = mcpsRequest->Req.Proprietary.Datarate;
+        break;
+    default:
+        break;
+    }
+    if (payload == NULL)
+    {
+        size = 0;
+    }
+
+    rec = RecordBegin(LORAMAC_RECORD_MCPS_REQUEST, 5 + size);
+    if (rec != NULL)
+    {
+        rec[RECORD_HEADER_SIZE] = mcpsRequest->Type;
+        rec[RECORD_HEADER_SIZE + 1] = port;
+        rec[RECORD_HEADER_SIZE + 2] = (uint8_t)datarate;
+        rec[RECORD_HEADER_SIZE + 3] = trials;
+        rec[RECORD_HEADER_SIZE + 4] = size;
+        if (size != 0)
+        {
+            memcpy(rec + RECORD_HEADER_SIZE + 5, payload, size);
+        }
+        PutU32(rec + RECORD_DURATION, micros());
+    }
+    return rec;
+}
+
+void *LoRaMacRecorderMlmeBegin(const MlmeReq_t *mlmeRequest)
+{
+    uint8_t *rec;
+
+    if ((RecordBuffer == NULL) || (mlmeRequest == NULL))
+    {
+        return NULL;
+    }
+    rec = RecordBegin(LORAMAC_RECORD_MLME_REQUEST, 2);
+    if (rec != NULL)
+    {
+        rec[RECORD_HEADER_SIZE] = mlmeRequest->Type;
+        rec[RECORD_HEADER_SIZE + 1] = (mlmeRequest->Type == MLME_JOIN) ? mlmeRequest->Req.Join.NbTrials : 0;
+    }
+    return rec;
+}
+
+bool LoRaMacRecorderSession(const uint8_t *log, uint16_t size, LoRaMacRecordSession_t *session)
+{
+    if ((size < LORAMAC_RECORDER_HEADER_SIZE) || (log[0] != 'L') || (log[1] != 'R') ||
+        (log[2] != LORAMAC_RECORDER_VERSION))
+    {
+        return false;
+    }
+    session->DevAddr = GetU32(log + 3);
+    session->UpLinkCounter = GetU32(log + 7);
+    session->DownLinkCounter = GetU32(log + 11);
+    session->Datarate = (int8_t)log[15];
+    session->AdrCtrlOn = log[16] != 0;
+    return true;
+}
+
+bool LoRaMacRecorderNext(const uint8_t *log, uint16_t size, uint16_t *offset, LoRaMacRecord_t *record)
+{
+    LoRaMacRecordSession_t session;
+    const uint8_t *rec;
+    uint16_t pos = *offset;
+
+    if (pos == 0)
+    {
+        if (LoRaMacRecorderSession(log, size, &session) == false)
+        {
+            return false;
+        }
+        pos = LORAMAC_RECORDER_HEADER_SIZE;
+    }
+    if ((uint32_t)pos + RECORD_HEADER_SIZE > size)
+    {
+        return false;
+    }
+    rec = log + pos;
+    memset(record, 0, sizeof(LoRaMacRecord_t));
+    record->Event = (LoRaMacRecordEvent_t)rec[0];
+    record->Timestamp = GetU32(rec + 1);
+    record->Duration = GetU32(rec + RECORD_DURATION);
+    pos += RECORD_HEADER_SIZE;
+
+    switch (record->Event)
+    {
+    case LORAMAC_RECORD_TX_DONE:
+    case LORAMAC_RECORD_TX_TIMEOUT:
+    case LORAMAC_RECORD_RX_TIMEOUT:
+    case LORAMAC_RECORD_RX_ERROR:
+        break;
+    case LORAMAC_RECORD_RX_DONE:
+        if ((uint32_t)pos + 4 > size)
+        {
+            return false;
+        }
+        record->Rssi = (int16_t)GetU16(log + pos);
+        record->Snr = (int8_t)log[pos + 2];
+        record->Size = log[pos + 3];
+        record->Payload = log + pos + 4;
+        pos += 4;
+        if ((uint32_t)pos + record->Size > size)
+        {
+            return false;
+        }
+        pos += record->Size;
+        break;
+    case LORAMAC_RECORD_CAD_DONE:
+        if ((uint32_t)pos + 1 > size)
+        {
+            return false;
+        }
+        record->ChannelActivityDetected = log[pos] != 0;
+        pos += 1;
+        break;
+    case LORAMAC_RECORD_MCPS_REQUEST:
+        if ((uint32_t)pos + 5 > size)
+        {
+            return false;
+        }
+        record->RequestType = log[pos];
+        record->Port = log[pos + 1];
+        record->Datarate = (int8_t)log[pos + 2];
+        record->NbTrials = log[pos + 3];
+        record->Size = log[pos + 4];
+        record->Payload = log + pos + 5;
+        pos += 5;
+        if ((uint32_t)pos + record->Size > size)
+        {
+            return false;
+        }
+        pos += record->Size;
+        break;
+    case LORAMAC_RECORD_MLME_REQUEST:
+        if ((uint32_t)pos + 2 > size)
+        {
+            return false;
+        }
+        record->RequestType = log[pos];
+        record->NbTrials = log[pos + 1];
+        pos += 2;
+        break;
+    default:
+        return false;
+    }
+    *offset = pos;
+    return true;
+}
+
+static void ReplayMcps(const LoRaMacRecord_t *record)
+{
+    McpsReq_t mcpsReq;
+
+    memcpy(ReplayPayload, record->Payload, record->Size);
+    mcpsReq.Type = (Mcps_t)record->RequestType;
+    switch (mcpsReq.Type)
+    {
+    case MCPS_UNCONFIRMED:
+        mcpsReq.Req.Unconfirmed.fPort = record->Port;
+        mcpsReq.Req.Unconfirmed.fBuffer = (record->Size != 0) ? ReplayPayload : NULL;
+        mcpsReq.Req.Unconfirmed.fBufferSize = record->Size;
+        mcpsReq.Req.Unconfirmed.Datarate = record->Datarate;
+        break;
+    case MCPS_CONFIRMED:
+        mcpsReq.Req.Confirmed.fPort = record->Port;
+        mcpsReq.Req.Confirmed.fBuffer = (record->Size != 0) ? ReplayPayload : NULL;
+        mcpsReq.Req.Confirmed.fBufferSize = record->Size;
+        mcpsReq.Req.Confirmed.Datarate = record->Datarate;
+        mcpsReq.Req.Confirmed.NbTrials = record->NbTrials;
+        break;
+    case MCPS_PROPRIETARY:
+        mcpsReq.Req.Proprietary.fBuffer = (record->Size != 0) ? ReplayPayload : NULL;
+        mcpsReq.Req.Proprietary.fBufferSize = record->Size;
+        mcpsReq.Req.Proprietary.Datarate = record->Datarate;
+        break;
+    default:
+        break;
+    }
+    LoRaMacMcpsRequest(&mcpsReq);
+}
+
+static void ReplayMlme(const LoRaMacRecord_t *record, LoRaMacReplayCallbacks_t *callbacks)
+{
+    MlmeReq_t mlmeReq;
+
+    mlmeReq.Type = (Mlme_t)record->RequestType;
+    switch (mlmeReq.Type)
+    {
+    case MLME_JOIN:
+        if ((callbacks != NULL) && (callbacks->Join != NULL))
+        {
+            callbacks->Join(record->NbTrials);
+        }
+        break;
+    case MLME_LINK_CHECK:
+    case MLME_DEVICE_TIME:
+        LoRaMacMlmeRequest(&mlmeReq);
+        break;
+    default:
+        // requests with parameters that are not recorded
+        break;
+    }
+}
+
+uint16_t LoRaMacRecorderReplay(const uint8_t *log, uint16_t size, LoRaMacReplayCallbacks_t *callbacks)
+{
+    LoRaMacRecord_t record;
+    uint16_t offset = 0;
+    uint16_t count = 0;
+    uint32_t start;
+
+    while (LoRaMacRecorderNext(log, size, &offset, &record) == true)
+    {
+        if ((callbacks != NULL) && (callbacks->SetTime != NULL))
+        {
+            callbacks->SetTime(record.Timestamp);
+        }
+        start = micros();
+        switch (record.Event)
+        {
+        case LORAMAC_RECORD_TX_DONE:
+            MacEvents.TxDone();
+            break;
+        case LORAMAC_RECORD_TX_TIMEOUT:
+            MacEvents.TxTimeout();
+            break;
+        case LORAMAC_RECORD_RX_DONE:
+            memcpy(ReplayPayload, record.Payload, record.Size);
+            MacEvents.RxDone(ReplayPayload, record.Size, record.Rssi, record.Snr);
+            break;
+        case LORAMAC_RECORD_RX_TIMEOUT:
+            MacEvents.RxTimeout();
+            break;
+        case LORAMAC_RECORD_RX_ERROR:
+            MacEvents.RxError();
+            break;
+        case LORAMAC_RECORD_CAD_DONE:
+            if (MacEvents.CadDone != NULL)
+            {
+                MacEvents.CadDone(record.ChannelActivityDetected);
+            }
+            break;
+        case LORAMAC_RECORD_MCPS_REQUEST:
+            ReplayMcps(&record);
+            break;
+        case LORAMAC_RECORD_MLME_REQUEST:
+            ReplayMlme(&record, callbacks);
+            break;
+        default:
+            break;
+        }
+        if ((callbacks != NULL) && (callbacks->EventDone != NULL))
+        {
+            callbacks->EventDone(&record, micros() - start);
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,218 @@
+/*!
+ * \file      LoRaMacRecorder.h
+ *
+ * \brief     Radio event recorder and replay for the LoRa MAC layer
+ *
+ * \details   The recorder sits between the radio driver and the MAC radio
+ *            event handlers. While a capture buffer is attached every event
+ *            (TxDone, RxDone with payload/RSSI/SNR, timeouts, errors, CAD)
+ *            is appended to it in a compact binary form together with the
+ *            time it was received and the time the MAC took to process it.
+ *            MCPS and MLME requests are recorded as well, they are what
+ *            makes the MAC transmit and open its receive windows.
+ *
+ *            A captured log can be fed back through the MAC with
+ *            \ref LoRaMacRecorderReplay. The caller provides the clock: on a
+ *            host build TimerGetCurrentTime is normally a virtual clock that
+ *            SetTime moves to the recorded timestamp before each record,
+ *            which reproduces the RX window and counter state transitions
+ *            exactly. tools/lorawan_replay.py is such a host build.
+ *
+ *            Log layout, little endian:
+ *            header  'L' 'R' version devaddr(4) uplink(4) downlink(4)
+ *                    datarate(1) adr(1)
+ *            record  event(1) timestamp(4) duration(4) [event data]
+ *            RxDone  rssi(2) snr(1) size(1) payload(size)
+ *            CadDone detected(1)
+ *            Mcps    type(1) port(1) datarate(1) trials(1) size(1) payload(size)
+ *            Mlme    type(1) trials(1)
+ *
+ *            The header holds the session the capture started from, the
+ *            session keys are not recorded.
+ *
+ * \defgroup  LORAMACRECORDER LoRa MAC radio event recorder
+ * \{
+ */
+#ifndef __LORAMAC_RECORDER_H__
+#define __LORAMAC_RECORDER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "LoRaMac.h"
+#include "../radio/radio.h"
+
+/*!
+ * Log format version, stored in the header
+ */
+#define LORAMAC_RECORDER_VERSION 2
+
+/*!
+ * Size of the log header
+ */
+#define LORAMAC_RECORDER_HEADER_SIZE 17
+
+/*!
+ * Recorded radio events and MAC requests
+ */
+typedef enum eLoRaMacRecordEvent
+{
+    LORAMAC_RECORD_TX_DONE = 1,
+    LORAMAC_RECORD_TX_TIMEOUT,
+    LORAMAC_RECORD_RX_DONE,
+    LORAMAC_RECORD_RX_TIMEOUT,
+    LORAMAC_RECORD_RX_ERROR,
+    LORAMAC_RECORD_CAD_DONE,
+    LORAMAC_RECORD_MCPS_REQUEST,
+    LORAMAC_RECORD_MLME_REQUEST,
+} LoRaMacRecordEvent_t;
+
+/*!
+ * Session the capture started from
+ */
+typedef struct sLoRaMacRecordSession
+{
+    uint32_t DevAddr;
+    uint32_t UpLinkCounter;
+    uint32_t DownLinkCounter;
+    int8_t Datarate;
+    bool AdrCtrlOn;
+} LoRaMacRecordSession_t;
+
+/*!
+ * Decoded log record
+ */
+typedef struct sLoRaMacRecord
+{
+    LoRaMacRecordEvent_t Event;
+    /*!
+     * TimerGetCurrentTime when the event reached the MAC
+     */
+    TimerTime_t Timestamp;
+    /*!
+     * Time spent in the MAC handler or request [us]
+     */
+    uint32_t Duration;
+    int16_t Rssi;
+    int8_t Snr;
+    bool ChannelActivityDetected;
+    /*!
+     * Mcps: Mcps_t, Mlme: Mlme_t
+     */
+    uint8_t RequestType;
+    uint8_t Port;
+    int8_t Datarate;
+    uint8_t NbTrials;
+    uint8_t Size;
+    /*!
+     * Points into the log
+     */
+    const uint8_t *Payload;
+} LoRaMacRecord_t;
+
+/*!
+ * Replay hooks, all optional
+ */
+typedef struct sLoRaMacReplayCallbacks
+{
+    /*!
+     * Called before a record is dispatched, moves the clock to the recorded
+     * time and fires the timers that expired in between
+     */
+    void (*SetTime)(TimerTime_t timestamp);
+    /*!
+     * Replays a join request, the log does not hold the keys. Without it
+     * join requests are skipped.
+     */
+    LoRaMacStatus_t (*Join)(uint8_t nbTrials);
+    /*!
+     * Called after a record has been processed with the time it took [us]
+     */
+    void (*EventDone)(const LoRaMacRecord_t *record, uint32_t latency);
+} LoRaMacReplayCallbacks_t;
+
+/*!
+ * \brief   Inserts the recorder between the radio driver and the MAC.
+ *          Called by LoRaMacInitialization before Radio.Init.
+ *
+ * \param   [IN/OUT] events - MAC radio events, replaced by the recorder ones
+ */
+void LoRaMacRecorderHook(RadioEvents_t *events);
+
+/*!
+ * \brief   Starts capturing into the given buffer. The current session is
+ *          written to the header. Capture stops silently when the buffer is
+ *          full.
+ *
+ * \param   [IN] buffer - Capture buffer, owned by the caller
+ * \param   [IN] size   - Buffer size in bytes
+ */
+void LoRaMacRecorderStart(uint8_t *buffer, uint16_t size);
+
+/*!
+ * \brief   Stops capturing
+ *
+ * \retval  Number of bytes of the buffer holding the log
+ */
+uint16_t LoRaMacRecorderStop(void);
+
+/*!
+ * \brief   Number of events not recorded because the buffer was full
+ */
+uint16_t LoRaMacRecorderDropped(void);
+
+/*!
+ * \brief   Records an MCPS request. Called by LoRaMacMcpsRequest.
+ *
+ * \retval  Record to pass to \ref LoRaMacRecorderEnd, NULL when not capturing
+ */
+void *LoRaMacRecorderMcpsBegin(const McpsReq_t *mcpsRequest);
+
+/*!
+ * \brief   Records an MLME request. Called by LoRaMacMlmeRequest.
+ *
+ * \retval  Record to pass to \ref LoRaMacRecorderEnd, NULL when not capturing
+ */
+void *LoRaMacRecorderMlmeBegin(const MlmeReq_t *mlmeRequest);
+
+/*!
+ * \brief   Stores the time the request took in its record
+ */
+void LoRaMacRecorderEnd(void *record);
+
+/*!
+ * \brief   Decodes the log header
+ *
+ * \retval  false if log is not a capture of this version
+ */
+bool LoRaMacRecorderSession(const uint8_t *log, uint16_t size, LoRaMacRecordSession_t *session);
+
+/*!
+ * \brief   Decodes the record at *offset and advances it
+ *
+ * \param   [IN] log          - Log start, including the header
+ * \param   [IN] size         - Log size
+ * \param   [IN/OUT] offset   - Read position, 0 to start
+ * \param   [OUT] record      - Decoded record
+ *
+ * \retval  false at the end of the log or on a malformed record
+ */
+bool LoRaMacRecorderNext(const uint8_t *log, uint16_t size, uint16_t *offset, LoRaMacRecord_t *record);
+
+/*!
+ * \brief   Feeds a captured log through the MAC. The MAC must be
+ *          initialized with the session of the header restored, and the
+ *          recorder must not be capturing. The radio driver must not raise
+ *          events of its own meanwhile.
+ *
+ * \param   [IN] log       - Captured log
+ * \param   [IN] size      - Log size
+ * \param   [IN] callbacks - Clock and measurement hooks, may be NULL
+ *
+ * \retval  Number of records replayed
+ */
+uint16_t LoRaMacRecorderReplay(const uint8_t *log, uint16_t size, LoRaMacReplayCallbacks_t *callbacks);
+
+/*! \} defgroup LORAMACRECORDER */
+
+#endif // __LORAMAC_RECORDER_H__
@@ -0,0 +1,135 @@
+/*!
+ * \file      LoRaMacRxTiming.c
+ *
+ * \brief     Receive window sizing from measured timing error
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "timer.h"
+#include "LoRaMacRxTiming.h"
+#include "LoRaMacClockSync.h"
+
+/*!
+ * Resolution of the MAC timestamps, each sample is quantised to it [us]
+ */
+#define RX_TIMING_RESOLUTION 1000
+
+/*!
+ * State used until LoRaMacRxTimingSetContext selects another one
+ */
+static LoRaMacRxTimingCtx_t RxTimingCtxDefault;
+
+/*!
+ * Selected state
+ */
+static LoRaMacRxTimingCtx_t *RxTimingCtx = &RxTimingCtxDefault;
+
+void LoRaMacRxTimingSetContext(LoRaMacRxTimingCtx_t *ctx)
+{
+    RxTimingCtx = (ctx != NULL) ? ctx : &RxTimingCtxDefault;
+}
+
+void LoRaMacRxTimingAddSample(int32_t error)
+{
+    LoRaMacRxTimingStats_t *stats = &RxTimingCtx->Stats;
+    int32_t diff;
+
+    if ((error > LORAMAC_RX_TIMING_MAX_ERROR) || (error < -LORAMAC_RX_TIMING_MAX_ERROR))
+    {
+        stats->Rejected++;
+        return;
+    }
+    if (stats->Samples == 0)
+    {
+        stats->Offset = error * 1000;
+        stats->Deviation = RX_TIMING_RESOLUTION / 2;
+        stats->MinError = error;
+        stats->MaxError = error;
+    }
+    else
+    {
+        diff = error * 1000 - stats->Offset;
+        stats->Offset += diff / 8;
+        stats->Deviation += ((int32_t)((diff < 0) ? -diff : diff) - (int32_t)stats->Deviation) / 4;
+        if (error < stats->MinError)
+        {
+            stats->MinError = error;
+        }
+        if (error > stats->MaxError)
+        {
+            stats->MaxError = error;
+        }
+    }
+    if (stats->Samples < 0xFFFF)
+    {
+        stats->Samples++;
+    }
+    RxTimingCtx->Widen = false;
+}
+
+void LoRaMacRxTimingMiss(void)
+{
+    RxTimingCtx->Stats.Misses++;
+    RxTimingCtx->Widen = true;
+}
+
+static bool Ready(void)
+{
+    return (RxTimingCtx->Stats.Samples >= LORAMAC_RX_TIMING_MIN_SAMPLES) && (RxTimingCtx->Widen == false);
+}
+
+uint32_t LoRaMacRxTimingRxError(uint32_t maxRxError, uint32_t rxDelay)
+{
+    LoRaMacRxTimingStats_t *stats = &RxTimingCtx->Stats;
+    int32_t ppb;
+    uint32_t drift;
+    uint32_t error;
+
+    if (Ready() == false)
+    {
+        stats->RxError = maxRxError;
+        return maxRxError;
+    }
+    if (LoRaMacClockSyncGetDrift(&ppb) == false)
+    {
+        ppb = 0;
+    }
+    stats->DriftPpm = ppb / 1000;
+    // ppb * ms / 1000000 = us
+    drift = (uint32_t)(((ppb < 0) ? -(int64_t)ppb : (int64_t)ppb) * rxDelay / 1000000);
+    error = 4 * stats->Deviation + RX_TIMING_RESOLUTION + drift + LORAMAC_RX_TIMING_MARGIN;
+    error = (error + 999) / 1000;
+    if (error < LORAMAC_RX_TIMING_MIN_RX_ERROR)
+    {
+        error = LORAMAC_RX_TIMING_MIN_RX_ERROR;
+    }
+    if (error > maxRxError)
+    {
+        error = maxRxError;
+    }
+    stats->RxError = error;
+    return error;
+}
+
+int32_t LoRaMacRxTimingOffset(void)
+{
+    int32_t offset = RxTimingCtx->Stats.Offset;
+
+    if (Ready() == false)
+    {
+        return 0;
+    }
+    return (offset >= 0) ? (offset + 500) / 1000 : -((-offset + 500) / 1000);
+}
+
+void LoRaMacRxTimingGetStats(LoRaMacRxTimingStats_t *stats)
+{
+    *stats = RxTimingCtx->Stats;
+}
+
+void LoRaMacRxTimingReset(void)
+{
+    memset(RxTimingCtx, 0, sizeof(LoRaMacRxTimingCtx_t));
+}
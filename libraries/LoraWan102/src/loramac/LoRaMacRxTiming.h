@@ -0,0 +1,156 @@
+/*!
+ * \file      LoRaMacRxTiming.h
+ *
+ * \brief     Receive window sizing from measured timing error
+ *
+ * \details   The gateway starts a class A downlink exactly ReceiveDelay1/2
+ *            after the end of the uplink. For every authenticated downlink
+ *            the MAC compares the local time the frame started (RxDone minus
+ *            its time on air) with that nominal time. The difference holds
+ *            the RTC drift over the receive delay, the radio wakeup and the
+ *            interrupt latencies on both ends.
+ *
+ *            The error is tracked as a running offset and mean deviation, in
+ *            the way TCP tracks round trip times. Once enough samples are in,
+ *            the RX windows are centred on the offset and sized for four
+ *            deviations plus the timer resolution, the clock drift over the
+ *            receive delay and a safety margin, instead of the static
+ *            SystemMaxRxError. A confirmed uplink or join request that gets
+ *            no answer falls back to the static windows until the next
+ *            downlink.
+ *
+ *            The clock drift is the rate error LoRaMacClockSync measured
+ *            from the DeviceTimeAns, less the part the timer server already
+ *            corrects.
+ *
+ *            The state belongs to the LoRaMac context, LoRaMacSetContext
+ *            selects it.
+ *
+ * \defgroup  LORAMACRXTIMING LoRa MAC receive window timing
+ * \{
+ */
+#ifndef __LORAMAC_RX_TIMING_H__
+#define __LORAMAC_RX_TIMING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/*!
+ * Downlinks needed before the windows are resized
+ */
+#define LORAMAC_RX_TIMING_MIN_SAMPLES 4
+
+/*!
+ * Samples further off than this are not ours or hit a stalled main loop [ms]
+ */
+#define LORAMAC_RX_TIMING_MAX_ERROR 50
+
+/*!
+ * Smallest window error applied [ms]
+ */
+#define LORAMAC_RX_TIMING_MIN_RX_ERROR 2
+
+/*!
+ * Margin added on top of the estimated error [us]
+ */
+#define LORAMAC_RX_TIMING_MARGIN 1000
+
+/*!
+ * Measured timing error
+ */
+typedef struct sLoRaMacRxTimingStats
+{
+    /*!
+     * Downlinks used and downlinks rejected as outliers
+     */
+    uint16_t Samples;
+    uint16_t Rejected;
+    /*!
+     * Expected downlinks that were not received
+     */
+    uint16_t Misses;
+    /*!
+     * Running mean of the error, positive when frames start late [us]
+     */
+    int32_t Offset;
+    /*!
+     * Running mean deviation of the error [us]
+     */
+    uint32_t Deviation;
+    /*!
+     * Extremes of the raw error [ms]
+     */
+    int16_t MinError;
+    int16_t MaxError;
+    /*!
+     * Clock drift used for the last window computation [ppm], positive
+     * when the local clock is slow
+     */
+    int32_t DriftPpm;
+    /*!
+     * Error used for the last window computation [ms]
+     */
+    uint32_t RxError;
+} LoRaMacRxTimingStats_t;
+
+/*!
+ * State of one LoRaMac context
+ */
+typedef struct sLoRaMacRxTimingCtx
+{
+    LoRaMacRxTimingStats_t Stats;
+    /*!
+     * Set on a missed downlink, cleared by the next sample
+     */
+    bool Widen;
+} LoRaMacRxTimingCtx_t;
+
+/*!
+ * \brief   Selects the state the other calls work on
+ *
+ * \param   [IN] ctx - State of the context, NULL selects the built-in one
+ */
+void LoRaMacRxTimingSetContext(LoRaMacRxTimingCtx_t *ctx);
+
+/*!
+ * \brief   Adds the timing error of an authenticated class A downlink
+ *
+ * \param   [IN] error - Local start of frame minus nominal start [ms]
+ */
+void LoRaMacRxTimingAddSample(int32_t error);
+
+/*!
+ * \brief   Reports an expected downlink that did not arrive. The windows go
+ *          back to SystemMaxRxError until the next sample.
+ */
+void LoRaMacRxTimingMiss(void);
+
+/*!
+ * \brief   Error to size a window with
+ *
+ * \param   [IN] maxRxError - Static SystemMaxRxError [ms]
+ * \param   [IN] rxDelay    - Delay between the end of the uplink and the window [ms]
+ *
+ * \retval  Error [ms], maxRxError until enough samples are in
+ */
+uint32_t LoRaMacRxTimingRxError(uint32_t maxRxError, uint32_t rxDelay);
+
+/*!
+ * \brief   Shift to apply to the window opening time [ms]
+ */
+int32_t LoRaMacRxTimingOffset(void);
+
+/*!
+ * \brief   Returns the measured timing error
+ */
+void LoRaMacRxTimingGetStats(LoRaMacRxTimingStats_t *stats);
+
+/*!
+ * \brief   Forgets all samples, e.g. after a hardware change
+ */
+void LoRaMacRxTimingReset(void);
+
+/*! \} defgroup LORAMACRXTIMING */
+
+#endif // __LORAMAC_RX_TIMING_H__
@@ -0,0 +1,142 @@
+/*!
+ * \file      LoRaMacScheduler.c
+ *
+ * \brief     Duty cycle aware uplink scheduling for the LoRa MAC layer
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "timer.h"
+#include "LoRaMacScheduler.h"
+
+/*!
+ * Demodulation floor step between two LoRa datarates [0.1 dB]
+ */
+#define DR_STEP_CENTI_DB 25
+
+static LoRaMacTxPolicy_t Policy = NULL;
+
+static bool UrgentMark = false;
+
+static int8_t LinkMargin = 0;
+static int8_t LinkMarginDatarate = LORAMAC_SCHEDULER_NO_MARGIN;
+
+static LoRaMacThroughputParams_t ThroughputParams = {
+    LORAMAC_SCHEDULER_DEFAULT_MARGIN, false, LORAMAC_SCHEDULER_DEFAULT_MAX_DELAY};
+
+void LoRaMacSchedulerSetPolicy(LoRaMacTxPolicy_t policy)
+{
+    Policy = policy;
+}
+
+bool LoRaMacSchedulerPlan(const LoRaMacTxRequest_t *request, LoRaMacTxPlan_t *plan)
+{
+    if (Policy == NULL)
+    {
+        return false;
+    }
+    Policy(request, plan);
+    return true;
+}
+
+void LoRaMacSchedulerMarkUrgent(void)
+{
+    UrgentMark = true;
+}
+
+bool LoRaMacSchedulerTakeUrgent(void)
+{
+    bool urgent = UrgentMark;
+
+    UrgentMark = false;
+    return urgent;
+}
+
+void LoRaMacSchedulerSetLinkMargin(int8_t margin, int8_t datarate)
+{
+    LinkMargin = margin;
+    LinkMarginDatarate = datarate;
+}
+
+void LoRaMacSchedulerGetLinkMargin(int8_t *margin, int8_t *datarate)
+{
+    *margin = LinkMargin;
+    *datarate = LinkMarginDatarate;
+}
+
+void LoRaMacSchedulerSetThroughputParams(const LoRaMacThroughputParams_t *params)
+{
+    ThroughputParams = *params;
+}
+
+/*!
+ * \brief   Highest datarate keeping the configured margin
+ */
+static int8_t ThroughputDatarate(const LoRaMacTxRequest_t *request)
+{
+    int16_t margin;
+    int8_t dr;
+
+    for (dr = request->MaxDatarate; dr > request->MinDatarate; dr--)
+    {
+        margin = (int16_t)request->LinkMargin * 10 - (int16_t)(dr - request->MarginDatarate) * DR_STEP_CENTI_DB;
+        if (margin >= (int16_t)ThroughputParams.Margin * 10)
+        {
+            break;
+        }
+    }
+    return dr;
+}
+
+/*!
+ * \brief   Time until a second usable band is available, 0 if the frame may
+ *          go now
+ */
+static TimerTime_t ReserveBandDelay(const LoRaMacTxRequest_t *request)
+{
+    TimerTime_t first = (TimerTime_t)(-1);
+    TimerTime_t second = (TimerTime_t)(-1);
+    uint8_t usable = 0;
+
+    for (uint8_t i = 0; i < request->NbBands; i++)
+    {
+        if (request->Bands[i].NbChannels == 0)
+        {
+            continue;
+        }
+        usable++;
+        if (request->Bands[i].TimeOff < first)
+        {
+            second = first;
+            first = request->Bands[i].TimeOff;
+        }
+        else if (request->Bands[i].TimeOff < second)
+        {
+            second = request->Bands[i].TimeOff;
+        }
+    }
+    return (usable < 2) ? 0 : second;
+}
+
+void LoRaMacSchedulerThroughputPolicy(const LoRaMacTxRequest_t *request, LoRaMacTxPlan_t *plan)
+{
+    TimerTime_t delay;
+
+    if ((request->AdrOn == false) && (request->MarginDatarate != LORAMAC_SCHEDULER_NO_MARGIN))
+    {
+        plan->Datarate = ThroughputDatarate(request);
+    }
+
+    if ((request->Urgent == true) || (ThroughputParams.ReserveBand == false) ||
+        (request->Deferred >= ThroughputParams.MaxDelay))
+    {
+        return;
+    }
+    delay = ReserveBandDelay(request);
+    if (delay > ThroughputParams.MaxDelay - request->Deferred)
+    {
+        delay = ThroughputParams.MaxDelay - request->Deferred;
+    }
+    plan->Delay = delay;
+}
@@ -0,0 +1,231 @@
+/*!
+ * \file      LoRaMacScheduler.h
+ *
+ * \brief     Duty cycle aware uplink scheduling for the LoRa MAC layer
+ *
+ * \details   Before ScheduleTx selects a channel for a data frame it hands
+ *            the frame to the installed policy. The policy sees when each
+ *            band leaves its duty cycle time-off, which datarates the enabled
+ *            channels support and the last measured link margin. It may move
+ *            the frame to another datarate or postpone it. Without a policy
+ *            ScheduleTx behaves exactly as before.
+ *
+ *            Channel selection itself stays in RegionNextChannel, which picks
+ *            randomly among the channels of all available bands, so a policy
+ *            spreads traffic by keeping bands free rather than by naming one.
+ *
+ *            The same forecast is available to the application through
+ *            \ref LoRaMacQueryTxForecast, e.g. to decide when to wake up.
+ *
+ * \defgroup  LORAMACSCHEDULER LoRa MAC uplink scheduler
+ * \{
+ */
+#ifndef __LORAMAC_SCHEDULER_H__
+#define __LORAMAC_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/*!
+ * Bands reported in a forecast, EU868 has the most
+ */
+#define LORAMAC_SCHEDULER_MAX_BANDS 5
+
+/*!
+ * Datarate value of \ref LoRaMacTxRequest_t::MarginDatarate while no link
+ * margin has been measured
+ */
+#define LORAMAC_SCHEDULER_NO_MARGIN -1
+
+/*!
+ * Default link margin kept by \ref LoRaMacSchedulerThroughputPolicy [dB]
+ */
+#define LORAMAC_SCHEDULER_DEFAULT_MARGIN 10
+
+/*!
+ * Default longest time \ref LoRaMacSchedulerThroughputPolicy postpones a
+ * frame [ms]
+ */
+#define LORAMAC_SCHEDULER_DEFAULT_MAX_DELAY 60000
+
+/*!
+ * Availability of one band
+ */
+typedef struct sLoRaMacBandForecast
+{
+    /*!
+     * Duty cycle of the band, 1 / DCycle
+     */
+    uint16_t DCycle;
+    /*!
+     * Time until the band may transmit again [ms], 0 when available
+     */
+    TimerTime_t TimeOff;
+    /*!
+     * Enabled channels of the band supporting the datarate of the request
+     */
+    uint8_t NbChannels;
+} LoRaMacBandForecast_t;
+
+/*!
+ * Uplink about to be scheduled, input of a policy
+ */
+typedef struct sLoRaMacTxRequest
+{
+    /*!
+     * FRMPayload plus pending MAC commands [bytes]
+     */
+    uint8_t PayloadSize;
+    /*!
+     * Confirmed frame, retransmission, pending MAC answers or marked with
+     * \ref LoRaMacSchedulerMarkUrgent. Urgent frames are never postponed.
+     */
+    bool Urgent;
+    /*!
+     * Set when the network controls the datarate. The MAC ignores a
+     * datarate change in that case.
+     */
+    bool AdrOn;
+    /*!
+     * Datarate the MAC would use
+     */
+    int8_t Datarate;
+    /*!
+     * Datarate range supported by at least one enabled channel
+     */
+    int8_t MinDatarate;
+    int8_t MaxDatarate;
+    /*!
+     * Last uplink margin reported by the network [dB], measured at
+     * MarginDatarate
+     */
+    int8_t LinkMargin;
+    int8_t MarginDatarate;
+    /*!
+     * Time the policy already postponed this frame [ms]
+     */
+    TimerTime_t Deferred;
+    /*!
+     * Remaining aggregated time-off [ms]
+     */
+    TimerTime_t AggregatedTimeOff;
+    /*!
+     * Band availability for Datarate
+     */
+    uint8_t NbBands;
+    LoRaMacBandForecast_t Bands[LORAMAC_SCHEDULER_MAX_BANDS];
+} LoRaMacTxRequest_t;
+
+/*!
+ * Policy decision, preset to "send now at the requested datarate"
+ */
+typedef struct sLoRaMacTxPlan
+{
+    /*!
+     * Datarate to send this uplink at, the MAC datarate is restored once it
+     * is done. Dropped by the MAC when outside the supported range or too
+     * small for the frame.
+     */
+    int8_t Datarate;
+    /*!
+     * Postpone the frame by this time [ms], 0 to send now
+     */
+    TimerTime_t Delay;
+} LoRaMacTxPlan_t;
+
+/*!
+ * Scheduling policy, called from ScheduleTx in thread or timer context
+ */
+typedef void (*LoRaMacTxPolicy_t)(const LoRaMacTxRequest_t *request, LoRaMacTxPlan_t *plan);
+
+/*!
+ * Parameters of \ref LoRaMacSchedulerThroughputPolicy
+ */
+typedef struct sLoRaMacThroughputParams
+{
+    /*!
+     * Link margin to keep when raising the datarate [dB]
+     */
+    int8_t Margin;
+    /*!
+     * Keep one band free for urgent frames when several bands are usable.
+     * Off by default: it lowers urgent latency but idles the free band, so
+     * a saturated node delivers less bulk data.
+     */
+    bool ReserveBand;
+    /*!
+     * Longest time a non urgent frame is postponed [ms]
+     */
+    TimerTime_t MaxDelay;
+} LoRaMacThroughputParams_t;
+
+/*!
+ * \brief   Installs the scheduling policy
+ *
+ * \param   [IN] policy - Policy, NULL to restore the default behaviour
+ */
+void LoRaMacSchedulerSetPolicy(LoRaMacTxPolicy_t policy);
+
+/*!
+ * \brief   Runs the installed policy
+ *
+ * \param   [IN] request - Uplink about to be scheduled
+ * \param   [OUT] plan   - Decision, preset by the caller
+ *
+ * \retval  false if no policy is installed
+ */
+bool LoRaMacSchedulerPlan(const LoRaMacTxRequest_t *request, LoRaMacTxPlan_t *plan);
+
+/*!
+ * \brief   Marks the next uplink passed to the MAC as urgent
+ */
+void LoRaMacSchedulerMarkUrgent(void);
+
+/*!
+ * \brief   Returns and clears the urgent mark. Called by the MAC for every
+ *          new uplink.
+ */
+bool LoRaMacSchedulerTakeUrgent(void);
+
+/*!
+ * \brief   Records the uplink margin reported by the network. Called by the
+ *          MAC on LinkCheckAns, may be called by the application with a
+ *          margin obtained otherwise.
+ *
+ * \param   [IN] margin   - Margin above the demodulation floor [dB]
+ * \param   [IN] datarate - Datarate of the uplink the margin was measured on
+ */
+void LoRaMacSchedulerSetLinkMargin(int8_t margin, int8_t datarate);
+
+/*!
+ * \brief   Returns the last recorded uplink margin
+ *
+ * \param   [OUT] margin   - Margin [dB]
+ * \param   [OUT] datarate - Datarate, \ref LORAMAC_SCHEDULER_NO_MARGIN if none
+ */
+void LoRaMacSchedulerGetLinkMargin(int8_t *margin, int8_t *datarate);
+
+/*!
+ * \brief   Sets the parameters of \ref LoRaMacSchedulerThroughputPolicy
+ */
+void LoRaMacSchedulerSetThroughputParams(const LoRaMacThroughputParams_t *params);
+
+/*!
+ * \brief   Built-in policy maximising delivered bytes per duty cycle budget.
+ *
+ * \details Without ADR the frame is sent at the highest datarate that keeps
+ *          the configured margin, assuming the demodulation floor rises by
+ *          2.5 dB per datarate step, which holds for the LoRa 125 kHz
+ *          datarates. Airtime per byte roughly halves with each step, so the
+ *          same duty cycle budget carries about twice the payload.
+ *
+ *          With ReserveBand set and at least two bands usable, a non urgent
+ *          frame is postponed until a second band is available, so an urgent
+ *          frame never waits for a band time-off caused by bulk traffic.
+ */
+void LoRaMacSchedulerThroughputPolicy(const LoRaMacTxRequest_t *request, LoRaMacTxPlan_t *plan);
+
+/*! \} defgroup LORAMACSCHEDULER */
+
+#endif // __LORAMAC_SCHEDULER_H__
@@ -52,6 +52,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AS923_COMPUTE_RX_WINDOW_PARAMETERS( )      AS923_CASE { RegionAS923ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define AS923_RX_CONFIG( )                         AS923_CASE { return RegionAS923RxConfig( rxConfig, datarate ); }
 #define AS923_TX_CONFIG( )                         AS923_CASE { return RegionAS923TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define AS923_TIME_ON_AIR( )                       AS923_CASE { return RegionAS923TimeOnAir( datarate, pktLen ); }
 #define AS923_LINK_ADR_REQ( )                      AS923_CASE { return RegionAS923LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define AS923_RX_PARAM_SETUP_REQ( )                AS923_CASE { return RegionAS923RxParamSetupReq( rxParamSetupReq ); }
 #define AS923_NEW_CHANNEL_REQ( )                   AS923_CASE { return RegionAS923NewChannelReq( newChannelReq ); }
@@ -65,6 +66,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AS923_SET_CONTINUOUS_WAVE( )               AS923_CASE { RegionAS923SetContinuousWave( continuousWave ); break; }
 #define AS923_APPLY_DR_OFFSET( )                   AS923_CASE { return RegionAS923ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define AS923_RX_BEACON_SETUP( )                   AS923_CASE { RegionAS923RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define AS923_GET_CONTEXT_SIZE( )                  AS923_CASE { return RegionAS923GetContextSize( ); }
+#define AS923_GET_BANDS( )                         AS923_CASE { return RegionAS923GetBands( bands ); }
+#define AS923_SET_CONTEXT( )                       AS923_CASE { RegionAS923SetContext( ctx ); break; }
 #else
 #define AS923_IS_ACTIVE( )
 #define AS923_GET_PHY_PARAM( )
@@ -77,6 +81,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AS923_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define AS923_RX_CONFIG( )
 #define AS923_TX_CONFIG( )
+#define AS923_TIME_ON_AIR( )
 #define AS923_LINK_ADR_REQ( )
 #define AS923_RX_PARAM_SETUP_REQ( )
 #define AS923_NEW_CHANNEL_REQ( )
@@ -90,6 +95,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AS923_SET_CONTINUOUS_WAVE( )
 #define AS923_APPLY_DR_OFFSET( )
 #define AS923_RX_BEACON_SETUP( )
+#define AS923_GET_CONTEXT_SIZE( )
+#define AS923_GET_BANDS( )
+#define AS923_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_AU915
@@ -106,6 +114,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AU915_COMPUTE_RX_WINDOW_PARAMETERS( )      AU915_CASE { RegionAU915ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define AU915_RX_CONFIG( )                         AU915_CASE { return RegionAU915RxConfig( rxConfig, datarate ); }
 #define AU915_TX_CONFIG( )                         AU915_CASE { return RegionAU915TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define AU915_TIME_ON_AIR( )                       AU915_CASE { return RegionAU915TimeOnAir( datarate, pktLen ); }
 #define AU915_LINK_ADR_REQ( )                      AU915_CASE { return RegionAU915LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define AU915_RX_PARAM_SETUP_REQ( )                AU915_CASE { return RegionAU915RxParamSetupReq( rxParamSetupReq ); }
 #define AU915_NEW_CHANNEL_REQ( )                   AU915_CASE { return RegionAU915NewChannelReq( newChannelReq ); }
@@ -119,6 +128,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AU915_SET_CONTINUOUS_WAVE( )               AU915_CASE { RegionAU915SetContinuousWave( continuousWave ); break; }
 #define AU915_APPLY_DR_OFFSET( )                   AU915_CASE { return RegionAU915ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define AU915_RX_BEACON_SETUP( )                   AU915_CASE { RegionAU915RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define AU915_GET_CONTEXT_SIZE( )                  AU915_CASE { return RegionAU915GetContextSize( ); }
+#define AU915_GET_BANDS( )                         AU915_CASE { return RegionAU915GetBands( bands ); }
+#define AU915_SET_CONTEXT( )                       AU915_CASE { RegionAU915SetContext( ctx ); break; }
 #else
 #define AU915_IS_ACTIVE( )
 #define AU915_GET_PHY_PARAM( )
@@ -131,6 +143,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AU915_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define AU915_RX_CONFIG( )
 #define AU915_TX_CONFIG( )
+#define AU915_TIME_ON_AIR( )
 #define AU915_LINK_ADR_REQ( )
 #define AU915_RX_PARAM_SETUP_REQ( )
 #define AU915_NEW_CHANNEL_REQ( )
@@ -144,6 +157,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define AU915_SET_CONTINUOUS_WAVE( )
 #define AU915_APPLY_DR_OFFSET( )
 #define AU915_RX_BEACON_SETUP( )
+#define AU915_GET_CONTEXT_SIZE( )
+#define AU915_GET_BANDS( )
+#define AU915_SET_CONTEXT( )
 #endif
 
 
@@ -161,6 +177,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN470_COMPUTE_RX_WINDOW_PARAMETERS( )      CN470_CASE { RegionCN470ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define CN470_RX_CONFIG( )                         CN470_CASE { return RegionCN470RxConfig( rxConfig, datarate ); }
 #define CN470_TX_CONFIG( )                         CN470_CASE { return RegionCN470TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define CN470_TIME_ON_AIR( )                       CN470_CASE { return RegionCN470TimeOnAir( datarate, pktLen ); }
 #define CN470_LINK_ADR_REQ( )                      CN470_CASE { return RegionCN470LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define CN470_RX_PARAM_SETUP_REQ( )                CN470_CASE { return RegionCN470RxParamSetupReq( rxParamSetupReq ); }
 #define CN470_NEW_CHANNEL_REQ( )                   CN470_CASE { return RegionCN470NewChannelReq( newChannelReq ); }
@@ -174,6 +191,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN470_SET_CONTINUOUS_WAVE( )               CN470_CASE { RegionCN470SetContinuousWave( continuousWave ); break; }
 #define CN470_APPLY_DR_OFFSET( )                   CN470_CASE { return RegionCN470ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define CN470_RX_BEACON_SETUP( )                   CN470_CASE { RegionCN470RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define CN470_GET_CONTEXT_SIZE( )                  CN470_CASE { return RegionCN470GetContextSize( ); }
+#define CN470_GET_BANDS( )                         CN470_CASE { return RegionCN470GetBands( bands ); }
+#define CN470_SET_CONTEXT( )                       CN470_CASE { RegionCN470SetContext( ctx ); break; }
 #else
 #define CN470_IS_ACTIVE( )
 #define CN470_GET_PHY_PARAM( )
@@ -186,6 +206,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN470_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define CN470_RX_CONFIG( )
 #define CN470_TX_CONFIG( )
+#define CN470_TIME_ON_AIR( )
 #define CN470_LINK_ADR_REQ( )
 #define CN470_RX_PARAM_SETUP_REQ( )
 #define CN470_NEW_CHANNEL_REQ( )
@@ -199,6 +220,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN470_SET_CONTINUOUS_WAVE( )
 #define CN470_APPLY_DR_OFFSET( )
 #define CN470_RX_BEACON_SETUP( )
+#define CN470_GET_CONTEXT_SIZE( )
+#define CN470_GET_BANDS( )
+#define CN470_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_CN779
@@ -215,6 +239,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN779_COMPUTE_RX_WINDOW_PARAMETERS( )      CN779_CASE { RegionCN779ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define CN779_RX_CONFIG( )                         CN779_CASE { return RegionCN779RxConfig( rxConfig, datarate ); }
 #define CN779_TX_CONFIG( )                         CN779_CASE { return RegionCN779TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define CN779_TIME_ON_AIR( )                       CN779_CASE { return RegionCN779TimeOnAir( datarate, pktLen ); }
 #define CN779_LINK_ADR_REQ( )                      CN779_CASE { return RegionCN779LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define CN779_RX_PARAM_SETUP_REQ( )                CN779_CASE { return RegionCN779RxParamSetupReq( rxParamSetupReq ); }
 #define CN779_NEW_CHANNEL_REQ( )                   CN779_CASE { return RegionCN779NewChannelReq( newChannelReq ); }
@@ -228,6 +253,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN779_SET_CONTINUOUS_WAVE( )               CN779_CASE { RegionCN779SetContinuousWave( continuousWave ); break; }
 #define CN779_APPLY_DR_OFFSET( )                   CN779_CASE { return RegionCN779ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define CN779_RX_BEACON_SETUP( )                   CN779_CASE { RegionCN779RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define CN779_GET_CONTEXT_SIZE( )                  CN779_CASE { return RegionCN779GetContextSize( ); }
+#define CN779_GET_BANDS( )                         CN779_CASE { return RegionCN779GetBands( bands ); }
+#define CN779_SET_CONTEXT( )                       CN779_CASE { RegionCN779SetContext( ctx ); break; }
 #else
 #define CN779_IS_ACTIVE( )
 #define CN779_GET_PHY_PARAM( )
@@ -240,6 +268,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN779_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define CN779_RX_CONFIG( )
 #define CN779_TX_CONFIG( )
+#define CN779_TIME_ON_AIR( )
 #define CN779_LINK_ADR_REQ( )
 #define CN779_RX_PARAM_SETUP_REQ( )
 #define CN779_NEW_CHANNEL_REQ( )
@@ -253,6 +282,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define CN779_SET_CONTINUOUS_WAVE( )
 #define CN779_APPLY_DR_OFFSET( )
 #define CN779_RX_BEACON_SETUP( )
+#define CN779_GET_CONTEXT_SIZE( )
+#define CN779_GET_BANDS( )
+#define CN779_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_EU433
@@ -269,6 +301,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU433_COMPUTE_RX_WINDOW_PARAMETERS( )      EU433_CASE { RegionEU433ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define EU433_RX_CONFIG( )                         EU433_CASE { return RegionEU433RxConfig( rxConfig, datarate ); }
 #define EU433_TX_CONFIG( )                         EU433_CASE { return RegionEU433TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define EU433_TIME_ON_AIR( )                       EU433_CASE { return RegionEU433TimeOnAir( datarate, pktLen ); }
 #define EU433_LINK_ADR_REQ( )                      EU433_CASE { return RegionEU433LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define EU433_RX_PARAM_SETUP_REQ( )                EU433_CASE { return RegionEU433RxParamSetupReq( rxParamSetupReq ); }
 #define EU433_NEW_CHANNEL_REQ( )                   EU433_CASE { return RegionEU433NewChannelReq( newChannelReq ); }
@@ -282,6 +315,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU433_SET_CONTINUOUS_WAVE( )               EU433_CASE { RegionEU433SetContinuousWave( continuousWave ); break; }
 #define EU433_APPLY_DR_OFFSET( )                   EU433_CASE { return RegionEU433ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define EU433_RX_BEACON_SETUP( )                   EU433_CASE { RegionEU433RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define EU433_GET_CONTEXT_SIZE( )                  EU433_CASE { return RegionEU433GetContextSize( ); }
+#define EU433_GET_BANDS( )                         EU433_CASE { return RegionEU433GetBands( bands ); }
+#define EU433_SET_CONTEXT( )                       EU433_CASE { RegionEU433SetContext( ctx ); break; }
 #else
 #define EU433_IS_ACTIVE( )
 #define EU433_GET_PHY_PARAM( )
@@ -294,6 +330,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU433_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define EU433_RX_CONFIG( )
 #define EU433_TX_CONFIG( )
+#define EU433_TIME_ON_AIR( )
 #define EU433_LINK_ADR_REQ( )
 #define EU433_RX_PARAM_SETUP_REQ( )
 #define EU433_NEW_CHANNEL_REQ( )
@@ -307,6 +344,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU433_SET_CONTINUOUS_WAVE( )
 #define EU433_APPLY_DR_OFFSET( )
 #define EU433_RX_BEACON_SETUP( )
+#define EU433_GET_CONTEXT_SIZE( )
+#define EU433_GET_BANDS( )
+#define EU433_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_EU868
@@ -323,6 +363,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU868_COMPUTE_RX_WINDOW_PARAMETERS( )      EU868_CASE { RegionEU868ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define EU868_RX_CONFIG( )                         EU868_CASE { return RegionEU868RxConfig( rxConfig, datarate ); }
 #define EU868_TX_CONFIG( )                         EU868_CASE { return RegionEU868TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define EU868_TIME_ON_AIR( )                       EU868_CASE { return RegionEU868TimeOnAir( datarate, pktLen ); }
 #define EU868_LINK_ADR_REQ( )                      EU868_CASE { return RegionEU868LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define EU868_RX_PARAM_SETUP_REQ( )                EU868_CASE { return RegionEU868RxParamSetupReq( rxParamSetupReq ); }
 #define EU868_NEW_CHANNEL_REQ( )                   EU868_CASE { return RegionEU868NewChannelReq( newChannelReq ); }
@@ -336,6 +377,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU868_SET_CONTINUOUS_WAVE( )               EU868_CASE { RegionEU868SetContinuousWave( continuousWave ); break; }
 #define EU868_APPLY_DR_OFFSET( )                   EU868_CASE { return RegionEU868ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define EU868_RX_BEACON_SETUP( )                   EU868_CASE { RegionEU868RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define EU868_GET_CONTEXT_SIZE( )                  EU868_CASE { return RegionEU868GetContextSize( ); }
+#define EU868_GET_BANDS( )                         EU868_CASE { return RegionEU868GetBands( bands ); }
+#define EU868_SET_CONTEXT( )                       EU868_CASE { RegionEU868SetContext( ctx ); break; }
 #else
 #define EU868_IS_ACTIVE( )
 #define EU868_GET_PHY_PARAM( )
@@ -348,6 +392,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU868_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define EU868_RX_CONFIG( )
 #define EU868_TX_CONFIG( )
+#define EU868_TIME_ON_AIR( )
 #define EU868_LINK_ADR_REQ( )
 #define EU868_RX_PARAM_SETUP_REQ( )
 #define EU868_NEW_CHANNEL_REQ( )
@@ -361,6 +406,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define EU868_SET_CONTINUOUS_WAVE( )
 #define EU868_APPLY_DR_OFFSET( )
 #define EU868_RX_BEACON_SETUP( )
+#define EU868_GET_CONTEXT_SIZE( )
+#define EU868_GET_BANDS( )
+#define EU868_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_KR920
@@ -377,6 +425,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define KR920_COMPUTE_RX_WINDOW_PARAMETERS( )      KR920_CASE { RegionKR920ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define KR920_RX_CONFIG( )                         KR920_CASE { return RegionKR920RxConfig( rxConfig, datarate ); }
 #define KR920_TX_CONFIG( )                         KR920_CASE { return RegionKR920TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define KR920_TIME_ON_AIR( )                       KR920_CASE { return RegionKR920TimeOnAir( datarate, pktLen ); }
 #define KR920_LINK_ADR_REQ( )                      KR920_CASE { return RegionKR920LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define KR920_RX_PARAM_SETUP_REQ( )                KR920_CASE { return RegionKR920RxParamSetupReq( rxParamSetupReq ); }
 #define KR920_NEW_CHANNEL_REQ( )                   KR920_CASE { return RegionKR920NewChannelReq( newChannelReq ); }
@@ -390,6 +439,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define KR920_SET_CONTINUOUS_WAVE( )               KR920_CASE { RegionKR920SetContinuousWave( continuousWave ); break; }
 #define KR920_APPLY_DR_OFFSET( )                   KR920_CASE { return RegionKR920ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define KR920_RX_BEACON_SETUP( )                   KR920_CASE { RegionKR920RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define KR920_GET_CONTEXT_SIZE( )                  KR920_CASE { return RegionKR920GetContextSize( ); }
+#define KR920_GET_BANDS( )                         KR920_CASE { return RegionKR920GetBands( bands ); }
+#define KR920_SET_CONTEXT( )                       KR920_CASE { RegionKR920SetContext( ctx ); break; }
 #else
 #define KR920_IS_ACTIVE( )
 #define KR920_GET_PHY_PARAM( )
@@ -402,6 +454,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define KR920_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define KR920_RX_CONFIG( )
 #define KR920_TX_CONFIG( )
+#define KR920_TIME_ON_AIR( )
 #define KR920_LINK_ADR_REQ( )
 #define KR920_RX_PARAM_SETUP_REQ( )
 #define KR920_NEW_CHANNEL_REQ( )
@@ -415,6 +468,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define KR920_SET_CONTINUOUS_WAVE( )
 #define KR920_APPLY_DR_OFFSET( )
 #define KR920_RX_BEACON_SETUP( )
+#define KR920_GET_CONTEXT_SIZE( )
+#define KR920_GET_BANDS( )
+#define KR920_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_IN865
@@ -431,6 +487,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define IN865_COMPUTE_RX_WINDOW_PARAMETERS( )      IN865_CASE { RegionIN865ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define IN865_RX_CONFIG( )                         IN865_CASE { return RegionIN865RxConfig( rxConfig, datarate ); }
 #define IN865_TX_CONFIG( )                         IN865_CASE { return RegionIN865TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define IN865_TIME_ON_AIR( )                       IN865_CASE { return RegionIN865TimeOnAir( datarate, pktLen ); }
 #define IN865_LINK_ADR_REQ( )                      IN865_CASE { return RegionIN865LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define IN865_RX_PARAM_SETUP_REQ( )                IN865_CASE { return RegionIN865RxParamSetupReq( rxParamSetupReq ); }
 #define IN865_NEW_CHANNEL_REQ( )                   IN865_CASE { return RegionIN865NewChannelReq( newChannelReq ); }
@@ -444,6 +501,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define IN865_SET_CONTINUOUS_WAVE( )               IN865_CASE { RegionIN865SetContinuousWave( continuousWave ); break; }
 #define IN865_APPLY_DR_OFFSET( )                   IN865_CASE { return RegionIN865ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define IN865_RX_BEACON_SETUP( )                   IN865_CASE { RegionIN865RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define IN865_GET_CONTEXT_SIZE( )                  IN865_CASE { return RegionIN865GetContextSize( ); }
+#define IN865_GET_BANDS( )                         IN865_CASE { return RegionIN865GetBands( bands ); }
+#define IN865_SET_CONTEXT( )                       IN865_CASE { RegionIN865SetContext( ctx ); break; }
 #else
 #define IN865_IS_ACTIVE( )
 #define IN865_GET_PHY_PARAM( )
@@ -456,6 +516,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define IN865_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define IN865_RX_CONFIG( )
 #define IN865_TX_CONFIG( )
+#define IN865_TIME_ON_AIR( )
 #define IN865_LINK_ADR_REQ( )
 #define IN865_RX_PARAM_SETUP_REQ( )
 #define IN865_NEW_CHANNEL_REQ( )
@@ -469,6 +530,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define IN865_SET_CONTINUOUS_WAVE( )
 #define IN865_APPLY_DR_OFFSET( )
 #define IN865_RX_BEACON_SETUP( )
+#define IN865_GET_CONTEXT_SIZE( )
+#define IN865_GET_BANDS( )
+#define IN865_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_US915
@@ -485,6 +549,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_COMPUTE_RX_WINDOW_PARAMETERS( )      US915_CASE { RegionUS915ComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define US915_RX_CONFIG( )                         US915_CASE { return RegionUS915RxConfig( rxConfig, datarate ); }
 #define US915_TX_CONFIG( )                         US915_CASE { return RegionUS915TxConfig( txConfig, txPower, txTimeOnAir ); }
+#define US915_TIME_ON_AIR( )                       US915_CASE { return RegionUS915TimeOnAir( datarate, pktLen ); }
 #define US915_LINK_ADR_REQ( )                      US915_CASE { return RegionUS915LinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define US915_RX_PARAM_SETUP_REQ( )                US915_CASE { return RegionUS915RxParamSetupReq( rxParamSetupReq ); }
 #define US915_NEW_CHANNEL_REQ( )                   US915_CASE { return RegionUS915NewChannelReq( newChannelReq ); }
@@ -498,6 +563,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_SET_CONTINUOUS_WAVE( )               US915_CASE { RegionUS915SetContinuousWave( continuousWave ); break; }
 #define US915_APPLY_DR_OFFSET( )                   US915_CASE { return RegionUS915ApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define US915_RX_BEACON_SETUP( )                   US915_CASE { RegionUS915RxBeaconSetup( rxBeaconSetup, outDr ); }
+#define US915_GET_CONTEXT_SIZE( )                  US915_CASE { return RegionUS915GetContextSize( ); }
+#define US915_GET_BANDS( )                         US915_CASE { return RegionUS915GetBands( bands ); }
+#define US915_SET_CONTEXT( )                       US915_CASE { RegionUS915SetContext( ctx ); break; }
 #else
 #define US915_IS_ACTIVE( )
 #define US915_GET_PHY_PARAM( )
@@ -510,6 +578,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define US915_RX_CONFIG( )
 #define US915_TX_CONFIG( )
+#define US915_TIME_ON_AIR( )
 #define US915_LINK_ADR_REQ( )
 #define US915_RX_PARAM_SETUP_REQ( )
 #define US915_NEW_CHANNEL_REQ( )
@@ -523,6 +592,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_SET_CONTINUOUS_WAVE( )
 #define US915_APPLY_DR_OFFSET( )
 #define US915_RX_BEACON_SETUP( )
+#define US915_GET_CONTEXT_SIZE( )
+#define US915_GET_BANDS( )
+#define US915_SET_CONTEXT( )
 #endif
 
 #ifdef REGION_US915_HYBRID
@@ -539,6 +611,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_HYBRID_COMPUTE_RX_WINDOW_PARAMETERS( )      US915_HYBRID_CASE { RegionUS915HybridComputeRxWindowParameters( datarate, minRxSymbols, rxError, rxConfigParams ); break; }
 #define US915_HYBRID_RX_CONFIG( )                         US915_HYBRID_CASE { return RegionUS915HybridRxConfig( rxConfig, datarate ); }
 #define US915_HYBRID_TX_CONFIG( )                         US915_HYBRID_CASE { return RegionUS915HybridTxConfig( txConfig, txPower, txTimeOnAir ); }
+#define US915_HYBRID_TIME_ON_AIR( )                       US915_HYBRID_CASE { return RegionUS915HybridTimeOnAir( datarate, pktLen ); }
 #define US915_HYBRID_LINK_ADR_REQ( )                      US915_HYBRID_CASE { return RegionUS915HybridLinkAdrReq( linkAdrReq, drOut, txPowOut, nbRepOut, nbBytesParsed ); }
 #define US915_HYBRID_RX_PARAM_SETUP_REQ( )                US915_HYBRID_CASE { return RegionUS915HybridRxParamSetupReq( rxParamSetupReq ); }
 #define US915_HYBRID_NEW_CHANNEL_REQ( )                   US915_HYBRID_CASE { return RegionUS915HybridNewChannelReq( newChannelReq ); }
@@ -552,6 +625,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_HYBRID_SET_CONTINUOUS_WAVE( )               US915_HYBRID_CASE { RegionUS915HybridSetContinuousWave( continuousWave ); break; }
 #define US915_HYBRID_APPLY_DR_OFFSET( )                   US915_HYBRID_CASE { return RegionUS915HybridApplyDrOffset( downlinkDwellTime, dr, drOffset ); }
 #define US915_HYBRID_RX_BEACON_SETUP( )                   US915_HYBRID_CASE { RegionUS915HybridRxBeaconSetup( rxBeaconSetup, outDr ); }
+#define US915_HYBRID_GET_CONTEXT_SIZE( )           US915_HYBRID_CASE { return RegionUS915HybridGetContextSize( ); }
+#define US915_HYBRID_GET_BANDS( )                  US915_HYBRID_CASE { return RegionUS915HybridGetBands( bands ); }
+#define US915_HYBRID_SET_CONTEXT( )                US915_HYBRID_CASE { RegionUS915HybridSetContext( ctx ); break; }
 #else
 #define US915_HYBRID_IS_ACTIVE( )
 #define US915_HYBRID_GET_PHY_PARAM( )
@@ -564,6 +640,7 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_HYBRID_COMPUTE_RX_WINDOW_PARAMETERS( )
 #define US915_HYBRID_RX_CONFIG( )
 #define US915_HYBRID_TX_CONFIG( )
+#define US915_HYBRID_TIME_ON_AIR( )
 #define US915_HYBRID_LINK_ADR_REQ( )
 #define US915_HYBRID_RX_PARAM_SETUP_REQ( )
 #define US915_HYBRID_NEW_CHANNEL_REQ( )
@@ -577,6 +654,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 #define US915_HYBRID_SET_CONTINUOUS_WAVE( )
 #define US915_HYBRID_APPLY_DR_OFFSET( )
 #define US915_HYBRID_RX_BEACON_SETUP( )
+#define US915_HYBRID_GET_CONTEXT_SIZE( )
+#define US915_HYBRID_GET_BANDS( )
+#define US915_HYBRID_SET_CONTEXT( )
 #endif
 
 bool RegionIsActive( LoRaMacRegion_t region )
@@ -811,6 +891,27 @@ bool RegionTxConfig( LoRaMacRegion_t region, TxConfigParams_t* txConfig, int8_t*
     }
 }
 
+TimerTime_t RegionTimeOnAir( LoRaMacRegion_t region, int8_t datarate, uint8_t pktLen )
+{
+    switch( region )
+    {
+        AS923_TIME_ON_AIR( );
+        AU915_TIME_ON_AIR( );
+        CN470_TIME_ON_AIR( );
+        CN779_TIME_ON_AIR( );
+        EU433_TIME_ON_AIR( );
+        EU868_TIME_ON_AIR( );
+        KR920_TIME_ON_AIR( );
+        IN865_TIME_ON_AIR( );
+        US915_TIME_ON_AIR( );
+        US915_HYBRID_TIME_ON_AIR( );
+        default:
+        {
+            return 0;
+        }
+    }
+}
+
 uint8_t RegionLinkAdrReq( LoRaMacRegion_t region, LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, int8_t* txPowOut, uint8_t* nbRepOut, uint8_t* nbBytesParsed )
 {
     switch( region )
@@ -1083,3 +1184,67 @@ void RegionRxBeaconSetup( LoRaMacRegion_t region, RxBeaconSetup_t* rxBeaconSetup
         }
     }
 }
+
+size_t RegionGetContextSize( LoRaMacRegion_t region )
+{
+    switch( region )
+    {
+        AS923_GET_CONTEXT_SIZE( );
+        AU915_GET_CONTEXT_SIZE( );
+        CN470_GET_CONTEXT_SIZE( );
+        CN779_GET_CONTEXT_SIZE( );
+        EU433_GET_CONTEXT_SIZE( );
+        EU868_GET_CONTEXT_SIZE( );
+        KR920_GET_CONTEXT_SIZE( );
+        IN865_GET_CONTEXT_SIZE( );
+        US915_GET_CONTEXT_SIZE( );
+        US915_HYBRID_GET_CONTEXT_SIZE( );
+        default:
+        {
+            return 0;
+        }
+    }
+}
+
+uint8_t RegionGetBands( LoRaMacRegion_t region, Band_t** bands )
+{
+    switch( region )
+    {
+        AS923_GET_BANDS( );
+        AU915_GET_BANDS( );
+        CN470_GET_BANDS( );
+        CN779_GET_BANDS( );
+        EU433_GET_BANDS( );
+        EU868_GET_BANDS( );
+        KR920_GET_BANDS( );
+        IN865_GET_BANDS( );
+        US915_GET_BANDS( );
+        US915_HYBRID_GET_BANDS( );
+        default:
+        {
+            *bands = NULL;
+            return 0;
+        }
+    }
+}
+
+void RegionSetContext( LoRaMacRegion_t region, void* ctx )
+{
+    switch( region )
+    {
+        AS923_SET_CONTEXT( );
+        AU915_SET_CONTEXT( );
+        CN470_SET_CONTEXT( );
+        CN779_SET_CONTEXT( );
+        EU433_SET_CONTEXT( );
+        EU868_SET_CONTEXT( );
+        KR920_SET_CONTEXT( );
+        IN865_SET_CONTEXT( );
+        US915_SET_CONTEXT( );
+        US915_HYBRID_SET_CONTEXT( );
+        default:
+        {
+            break;
+        }
+    }
+}
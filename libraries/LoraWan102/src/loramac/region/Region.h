@@ -1499,6 +1499,23 @@ void RegionComputeRxWindowParameters( LoRaMacRegion_t region, int8_t datarate, u
  */
 bool RegionTxConfig( LoRaMacRegion_t region, TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_t *txTimeOnAir );
 
+/*!
+ * \brief Computes the time-on-air of a frame at a datarate from the region
+ *        parameters. Unlike RegionTxConfig the radio is not touched, so it
+ *        can be used after the frame, when the radio is configured for
+ *        reception.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [IN] datarate Datarate of the frame.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Returns the time-on-air in milliseconds, 0 if the region is not
+ *         supported.
+ */
+TimerTime_t RegionTimeOnAir( LoRaMacRegion_t region, int8_t datarate, uint8_t pktLen );
+
 /*!
  * \brief The function processes a Link ADR Request.
  *
@@ -1647,6 +1664,39 @@ uint8_t RegionApplyDrOffset( LoRaMacRegion_t region, uint8_t downlinkDwellTime,
  */
 void RegionRxBeaconSetup( LoRaMacRegion_t region, RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr );
 
+/*!
+ * \brief Returns the size of the state kept by a region.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \retval Size in bytes, 0 if the region is not supported.
+ */
+size_t RegionGetContextSize( LoRaMacRegion_t region );
+
+/*!
+ * \brief Gives access to the duty cycle bands of the region state. Used by
+ *        the scheduler to predict when each band leaves its time-off.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [OUT] bands Set to the bands array, NULL if the region is not supported.
+ *
+ * \retval Number of bands.
+ */
+uint8_t RegionGetBands( LoRaMacRegion_t region, Band_t** bands );
+
+/*!
+ * \brief Selects the state the region functions work on. The state holds the
+ *        channels, the bands and the channel masks and is set up by
+ *        RegionInitDefaults( INIT_TYPE_INIT ).
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [IN] ctx Region state of RegionGetContextSize bytes, NULL for the
+ *                 built-in one.
+ */
+void RegionSetContext( LoRaMacRegion_t region, void* ctx );
+
 /*! \} defgroup REGION */
 
 #endif // __REGION_H__
@@ -300,6 +300,31 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy );
  */
 void RegionAU915SetBandTxDone( SetBandTxDoneParams_t* txDone );
 
+/*!
+ * \brief Returns the size of the region state.
+ *
+ * \retval Size in bytes.
+ */
+size_t RegionAU915GetContextSize( void );
+
+/*!
+ * \brief Gives access to the duty cycle bands of the region state.
+ *
+ * \param [OUT] bands Set to the bands array.
+ *
+ * \retval Number of bands.
+ */
+uint8_t RegionAU915GetBands( Band_t **bands );
+
+/*!
+ * \brief Selects the region state the functions work on. The state is
+ *        set up by RegionAU915InitDefaults( INIT_TYPE_INIT ).
+ *
+ * \param [IN] ctx Region state of RegionAU915GetContextSize bytes, NULL for the
+ *                 built-in one.
+ */
+void RegionAU915SetContext( void* ctx );
+
 /*!
  * \brief Initializes the channels masks and the channels.
  *
@@ -389,6 +414,17 @@ bool RegionAU915RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate );
  */
 bool RegionAU915TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir );
 
+/*!
+ * \brief Time-on-air of a frame at a datarate, without touching the radio.
+ *
+ * \param [IN] datarate Datarate of the frame.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Returns the time-on-air in milliseconds.
+ */
+TimerTime_t RegionAU915TimeOnAir( int8_t datarate, uint8_t pktLen );
+
 /*!
  * \brief The function processes a Link ADR Request.
  *
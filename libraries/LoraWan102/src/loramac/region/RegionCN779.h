@@ -295,6 +295,31 @@ PhyParam_t RegionCN779GetPhyParam( GetPhyParams_t* getPhy );
  */
 void RegionCN779SetBandTxDone( SetBandTxDoneParams_t* txDone );
 
+/*!
+ * \brief Returns the size of the region state.
+ *
+ * \retval Size in bytes.
+ */
+size_t RegionCN779GetContextSize( void );
+
+/*!
+ * \brief Gives access to the duty cycle bands of the region state.
+ *
+ * \param [OUT] bands Set to the bands array.
+ *
+ * \retval Number of bands.
+ */
+uint8_t RegionCN779GetBands( Band_t **bands );
+
+/*!
+ * \brief Selects the region state the functions work on. The state is
+ *        set up by RegionCN779InitDefaults( INIT_TYPE_INIT ).
+ *
+ * \param [IN] ctx Region state of RegionCN779GetContextSize bytes, NULL for the
+ *                 built-in one.
+ */
+void RegionCN779SetContext( void* ctx );
+
 /*!
  * \brief Initializes the channels masks and the channels.
  *
@@ -384,6 +409,17 @@ bool RegionCN779RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate );
  */
 bool RegionCN779TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir );
 
+/*!
+ * \brief Time-on-air of a frame at a datarate, without touching the radio.
+ *
+ * \param [IN] datarate Datarate of the frame.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Returns the time-on-air in milliseconds.
+ */
+TimerTime_t RegionCN779TimeOnAir( int8_t datarate, uint8_t pktLen );
+
 /*!
  * \brief The function processes a Link ADR Request.
  *
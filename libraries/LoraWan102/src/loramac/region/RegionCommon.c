@@ -176,6 +176,15 @@ void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMas
     }
 }
 
+void RegionCommonInitBands( Band_t* bands, const Band_t* bandsDefault, uint8_t nbBands )
+{
+    for( uint8_t i = 0; i < nbBands; i++ )
+    {
+        bands[i].DCycle = bandsDefault[i].DCycle;
+        bands[i].TxMaxPower = bandsDefault[i].TxMaxPower;
+    }
+}
+
 void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDone )
 {
     if (joined == true) {
@@ -231,6 +240,26 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t*
     return nextTxDelay;
 }
 
+TimerTime_t RegionCommonGetBandTimeOff( bool joined, bool dutyCycle, const Band_t* band )
+{
+    TimerTime_t elapsed;
+
+    if( joined == false )
+    {
+        elapsed = MAX( TimerGetElapsedTime( band->LastJoinTxDoneTime ),
+                       ( dutyCycle == true ) ? TimerGetElapsedTime( band->LastTxDoneTime ) : 0 );
+    }
+    else if( dutyCycle == true )
+    {
+        elapsed = TimerGetElapsedTime( band->LastTxDoneTime );
+    }
+    else
+    {
+        return 0;
+    }
+    return ( band->TimeOff > elapsed ) ? band->TimeOff - elapsed : 0;
+}
+
 uint8_t RegionCommonParseLinkAdrReq( uint8_t* payload, LinkAdrParams_t* linkAdrParams )
 {
     uint8_t retIndex = 0;
@@ -265,6 +294,21 @@ double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
     return ( 8.0 / ( double )phyDr ); // 1 symbol equals 1 byte
 }
 
+TimerTime_t RegionCommonComputeTimeOnAirLoRa( uint8_t phyDr, uint32_t bandwidth, uint16_t preambleLen, uint8_t pktLen )
+{
+    double tSymbol = RegionCommonComputeSymbolTimeLoRa( phyDr, bandwidth );
+    // Same rule as the radio driver for the low datarate optimization
+    uint8_t lowDrOptimize = ( tSymbol >= 16.38 ) ? 2 : 0;
+    double nPayload = ceil( ( 8.0 * pktLen - 4 * phyDr + 28 + 16 ) / ( 4 * ( phyDr - lowDrOptimize ) ) ) * 5;
+
+    return ( TimerTime_t )floor( ( preambleLen + 4.25 + 8 + MAX( nPayload, 0 ) ) * tSymbol + 0.999 );
+}
+
+TimerTime_t RegionCommonComputeTimeOnAirFsk( uint8_t phyDr, uint8_t pktLen )
+{
+    return ( TimerTime_t )rint( 8.0 * ( 5 + 3 + 1 + pktLen + 2 ) / phyDr );
+}
+
 void RegionCommonComputeRxWindowParameters( double tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset )
 {
     *windowTimeout = MAX( ( uint32_t )ceil( ( ( 2 * minRxSymbols - 8 ) * tSymbol + 2 * rxError ) / tSymbol ), minRxSymbols ); // Computed number of symbols
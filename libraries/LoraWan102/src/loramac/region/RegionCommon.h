@@ -179,6 +179,20 @@ uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uin
  */
 void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len );
 
+/*!
+ * \brief Loads the band defaults of a region, keeping the duty-cycle state
+ *        (last TX done times and time-off) of bands already in use, so a
+ *        re-initialization cannot shorten a pending time-off.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN/OUT] bands The bands to initialize.
+ *
+ * \param [IN] bandsDefault The region band table.
+ *
+ * \param [IN] nbBands Number of bands.
+ */
+void RegionCommonInitBands( Band_t* bands, const Band_t* bandsDefault, uint8_t nbBands );
+
 /*!
  * \brief Sets the last tx done property.
  *        This is a generic function and valid for all regions.
@@ -207,6 +221,20 @@ void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDon
  */
 TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t* bands, uint8_t nbBands );
 
+/*!
+ * \brief Computes the time left before a band may transmit again, without
+ *        updating the band. Same rules as RegionCommonUpdateBandTimeOff.
+ *
+ * \param [IN] joined Set to true, if the node has joined the network
+ *
+ * \param [IN] dutyCycle Set to true, if the duty cycle is enabled.
+ *
+ * \param [IN] band A pointer to the band.
+ *
+ * \retval Remaining time-off in ms, 0 if the band is available.
+ */
+TimerTime_t RegionCommonGetBandTimeOff( bool joined, bool dutyCycle, const Band_t* band );
+
 /*!
  * \brief Parses the parameter of an LinkAdrRequest.
  *        This is a generic function and valid for all regions.
@@ -243,6 +271,36 @@ double RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
  */
 double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
 
+/*!
+ * \brief Computes the time-on-air of a LoRa frame sent the way the regions
+ *        configure the radio: coding rate 4/5, explicit header, CRC on and
+ *        low datarate optimization from 16 ms symbols on.
+ *
+ * \param [IN] phyDr Spreading factor.
+ *
+ * \param [IN] bandwidth Bandwidth in Hz.
+ *
+ * \param [IN] preambleLen Preamble length in symbols.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Returns the time-on-air in milliseconds, rounded up.
+ */
+TimerTime_t RegionCommonComputeTimeOnAirLoRa( uint8_t phyDr, uint32_t bandwidth, uint16_t preambleLen, uint8_t pktLen );
+
+/*!
+ * \brief Computes the time-on-air of a FSK frame sent the way the regions
+ *        configure the radio: 5 byte preamble, 3 byte sync word, length
+ *        byte and 2 byte CRC.
+ *
+ * \param [IN] phyDr Bit rate in kbps.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Returns the time-on-air in milliseconds.
+ */
+TimerTime_t RegionCommonComputeTimeOnAirFsk( uint8_t phyDr, uint8_t pktLen );
+
 /*!
  * \brief Computes the RX window timeout and the RX window offset.
  *
@@ -39,26 +39,44 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 
 // Global attributes
 /*!
- * LoRaMAC channels
+ * LoRaMac default bands
  */
-static ChannelParams_t Channels[EU433_MAX_NB_CHANNELS];
+static const Band_t BandsDefault[EU433_MAX_NB_BANDS] =
+    {
+        EU433_BAND0};
 
 /*!
- * LoRaMac bands
+ * Region state
  */
-static Band_t Bands[EU433_MAX_NB_BANDS] =
-    {
-        EU433_BAND0};
+typedef struct sRegionEU433Ctx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[EU433_MAX_NB_CHANNELS];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[EU433_MAX_NB_BANDS];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
+} RegionEU433Ctx_t;
 
 /*!
- * LoRaMac channels mask
+ * Region state used until RegionEU433SetContext selects another one
  */
-static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
+static RegionEU433Ctx_t RegionCtxDefault;
 
 /*!
- * LoRaMac channels default mask
+ * Selected region state
  */
-static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
+static RegionEU433Ctx_t *RegionCtx = &RegionCtxDefault;
 
 // Static functions
 static int8_t GetNextLowerTxDr(int8_t dr, int8_t minDr)
@@ -259,12 +277,12 @@ PhyParam_t RegionEU433GetPhyParam(GetPhyParams_t *getPhy)
     }
     case PHY_CHANNELS_MASK:
     {
-        phyParam.ChannelsMask = ChannelsMask;
+        phyParam.ChannelsMask = RegionCtx->ChannelsMask;
         break;
     }
     case PHY_CHANNELS_DEFAULT_MASK:
     {
-        phyParam.ChannelsMask = ChannelsDefaultMask;
+        phyParam.ChannelsMask = RegionCtx->ChannelsDefaultMask;
         break;
     }
     case PHY_MAX_NB_CHANNELS:
@@ -274,7 +292,7 @@ PhyParam_t RegionEU433GetPhyParam(GetPhyParams_t *getPhy)
     }
     case PHY_CHANNELS:
     {
-        phyParam.Channels = Channels;
+        phyParam.Channels = RegionCtx->Channels;
         break;
     }
     case PHY_DEF_UPLINK_DWELL_TIME:
@@ -327,7 +345,23 @@ PhyParam_t RegionEU433GetPhyParam(GetPhyParams_t *getPhy)
 
 void RegionEU433SetBandTxDone(SetBandTxDoneParams_t *txDone)
 {
-    RegionCommonSetBandTxDone(txDone->Joined, &Bands[Channels[txDone->Channel].Band], txDone->LastTxDoneTime);
+    RegionCommonSetBandTxDone(txDone->Joined, &RegionCtx->Bands[RegionCtx->Channels[txDone->Channel].Band], txDone->LastTxDoneTime);
+}
+
+size_t RegionEU433GetContextSize(void)
+{
+    return sizeof(RegionEU433Ctx_t);
+}
+
+uint8_t RegionEU433GetBands(Band_t **bands)
+{
+    *bands = RegionCtx->Bands;
+    return EU433_MAX_NB_BANDS;
+}
+
+void RegionEU433SetContext(void *ctx)
+{
+    RegionCtx = (ctx != NULL) ? (RegionEU433Ctx_t *)ctx : &RegionCtxDefault;
 }
 
 void RegionEU433InitDefaults(InitType_t type)
@@ -336,21 +370,24 @@ void RegionEU433InitDefaults(InitType_t type)
     {
     case INIT_TYPE_INIT:
     {
+        // Bands
+        RegionCommonInitBands(RegionCtx->Bands, BandsDefault, EU433_MAX_NB_BANDS);
+
         // Channels
-        Channels[0] = (ChannelParams_t)EU433_LC1;
-        Channels[1] = (ChannelParams_t)EU433_LC2;
-        Channels[2] = (ChannelParams_t)EU433_LC3;
+        RegionCtx->Channels[0] = (ChannelParams_t)EU433_LC1;
+        RegionCtx->Channels[1] = (ChannelParams_t)EU433_LC2;
+        RegionCtx->Channels[2] = (ChannelParams_t)EU433_LC3;
 
         // Initialize the channels default mask
-        ChannelsDefaultMask[0] = LC(1) + LC(2) + LC(3);
+        RegionCtx->ChannelsDefaultMask[0] = LC(1) + LC(2) + LC(3);
         // Update the channels mask
-        RegionCommonChanMaskCopy(ChannelsMask, ChannelsDefaultMask, 1);
+        RegionCommonChanMaskCopy(RegionCtx->ChannelsMask, RegionCtx->ChannelsDefaultMask, 1);
         break;
     }
     case INIT_TYPE_RESTORE:
     {
         // Restore channels default mask
-        ChannelsMask[0] |= ChannelsDefaultMask[0];
+        RegionCtx->ChannelsMask[0] |= RegionCtx->ChannelsDefaultMask[0];
         break;
     }
     default:
@@ -459,12 +496,12 @@ bool RegionEU433ChanMaskSet(ChanMaskSetParams_t *chanMaskSet)
     {
     case CHANNELS_MASK:
     {
-        RegionCommonChanMaskCopy(ChannelsMask, chanMaskSet->ChannelsMaskIn, 1);
+        RegionCommonChanMaskCopy(RegionCtx->ChannelsMask, chanMaskSet->ChannelsMaskIn, 1);
         break;
     }
     case CHANNELS_DEFAULT_MASK:
     {
-        RegionCommonChanMaskCopy(ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 1);
+        RegionCommonChanMaskCopy(RegionCtx->ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 1);
         break;
     }
     default:
@@ -520,7 +557,7 @@ bool RegionEU433AdrNext(AdrNextParams_t *adrNext, int8_t *drOut, int8_t *txPowOu
                         if (adrNext->UpdateChanMask == true)
                         {
                             // Re-enable default channels
-                            ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
+                            RegionCtx->ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
                         }
                     }
                 }
@@ -570,11 +607,11 @@ bool RegionEU433RxConfig(RxConfigParams_t *rxConfig, int8_t *datarate)
     if (rxConfig->RxSlot == RX_SLOT_WIN_1)
     {
         // Apply window 1 frequency
-        frequency = Channels[rxConfig->Channel].Frequency;
+        frequency = RegionCtx->Channels[rxConfig->Channel].Frequency;
         // Apply the alternative RX 1 window frequency, if it is available
-        if (Channels[rxConfig->Channel].Rx1Frequency != 0)
+        if (RegionCtx->Channels[rxConfig->Channel].Rx1Frequency != 0)
         {
-            frequency = Channels[rxConfig->Channel].Rx1Frequency;
+            frequency = RegionCtx->Channels[rxConfig->Channel].Rx1Frequency;
         }
     }
 
@@ -605,6 +642,7 @@ bool RegionEU433RxConfig(RxConfigParams_t *rxConfig, int8_t *datarate)
     }
     Radio.SetMaxPayloadLength(modem, maxPayload + LORA_MAC_FRMPAYLOAD_OVERHEAD);
     FREQ_PRINTF("RX on freq %u Hz at DR %d\r\n", (unsigned int)frequency, dr);
+    TRACE_EVENT(TRACE_REGION_RX, frequency, dr);
 
     *datarate = (uint8_t)dr;
     return true;
@@ -614,7 +652,7 @@ bool RegionEU433TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
 {
     RadioModems_t modem;
     int8_t phyDr = DataratesEU433[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower(txConfig->TxPower, Bands[Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, ChannelsMask);
+    int8_t txPowerLimited = LimitTxPower(txConfig->TxPower, RegionCtx->Bands[RegionCtx->Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, RegionCtx->ChannelsMask);
     uint32_t bandwidth = GetBandwidth(txConfig->Datarate);
     int8_t phyTxPower = 0;
 
@@ -622,7 +660,7 @@ bool RegionEU433TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
     phyTxPower = RegionCommonComputeTxPower(txPowerLimited, txConfig->MaxEirp, txConfig->AntennaGain);
 
     // Setup the radio frequency
-    Radio.SetChannel(Channels[txConfig->Channel].Frequency);
+    Radio.SetChannel(RegionCtx->Channels[txConfig->Channel].Frequency);
 
     if (txConfig->Datarate == DR_7)
     { // High Speed FSK channel
@@ -634,7 +672,8 @@ bool RegionEU433TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
         modem = MODEM_LORA;
         Radio.SetTxConfig(modem, phyTxPower, 0, bandwidth, phyDr, 1, LORAWAN_PREAMBLE_LENGTH, false, true, 0, 0, false, 3e3);
     }
-    FREQ_PRINTF("TX on freq %u Hz at DR %d\r\n", (unsigned int)Channels[txConfig->Channel].Frequency, txConfig->Datarate);
+    FREQ_PRINTF("TX on freq %u Hz at DR %d\r\n", (unsigned int)RegionCtx->Channels[txConfig->Channel].Frequency, txConfig->Datarate);
+    TRACE_EVENT(TRACE_REGION_TX, RegionCtx->Channels[txConfig->Channel].Frequency, txConfig->Datarate);
     // Setup maximum payload lenght of the radio driver
     Radio.SetMaxPayloadLength(modem, txConfig->PktLen);
     // Get the time-on-air of the next tx frame
@@ -644,6 +683,15 @@ bool RegionEU433TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
     return true;
 }
 
+TimerTime_t RegionEU433TimeOnAir(int8_t datarate, uint8_t pktLen)
+{
+    if (datarate == DR_7)
+    { // High Speed FSK channel
+        return RegionCommonComputeTimeOnAirFsk(DataratesEU433[datarate], pktLen);
+    }
+    return RegionCommonComputeTimeOnAirLoRa(DataratesEU433[datarate], BandwidthsEU433[datarate], LORAWAN_PREAMBLE_LENGTH, pktLen);
+}
+
 uint8_t RegionEU433LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int8_t *txPowOut, uint8_t *nbRepOut, uint8_t *nbBytesParsed)
 {
     uint8_t status = 0x07;
@@ -686,7 +734,7 @@ uint8_t RegionEU433LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
             {
                 if (linkAdrParams.ChMaskCtrl == 6)
                 {
-                    if (Channels[i].Frequency != 0)
+                    if (RegionCtx->Channels[i].Frequency != 0)
                     {
                         chMask |= 1 << i;
                     }
@@ -694,7 +742,7 @@ uint8_t RegionEU433LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
                 else
                 {
                     if (((chMask & (1 << i)) != 0) &&
-                        (Channels[i].Frequency == 0))
+                        (RegionCtx->Channels[i].Frequency == 0))
                     {                   // Trying to enable an undefined channel
                         status &= 0xFE; // Channel mask KO
                     }
@@ -704,7 +752,7 @@ uint8_t RegionEU433LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
     }
 
     // Verify datarate
-    if (RegionCommonChanVerifyDr(EU433_MAX_NB_CHANNELS, &chMask, linkAdrParams.Datarate, EU433_TX_MIN_DATARATE, EU433_TX_MAX_DATARATE, Channels) == false)
+    if (RegionCommonChanVerifyDr(EU433_MAX_NB_CHANNELS, &chMask, linkAdrParams.Datarate, EU433_TX_MIN_DATARATE, EU433_TX_MAX_DATARATE, RegionCtx->Channels) == false)
     {
         status &= 0xFD; // Datarate KO
     }
@@ -732,9 +780,9 @@ uint8_t RegionEU433LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
         }
 
         // Set the channels mask to a default value
-        memset(ChannelsMask, 0, sizeof(ChannelsMask));
+        memset(RegionCtx->ChannelsMask, 0, sizeof(RegionCtx->ChannelsMask));
         // Update the channels mask
-        ChannelsMask[0] = chMask;
+        RegionCtx->ChannelsMask[0] = chMask;
     }
 
     // Update status variables
@@ -840,7 +888,7 @@ uint8_t RegionEU433DlChannelReq(DlChannelReqParams_t *dlChannelReq)
     }
 
     // Verify if an uplink frequency exists
-    if (Channels[dlChannelReq->ChannelId].Frequency == 0)
+    if (RegionCtx->Channels[dlChannelReq->ChannelId].Frequency == 0)
     {
         status &= 0xFD;
     }
@@ -848,7 +896,7 @@ uint8_t RegionEU433DlChannelReq(DlChannelReqParams_t *dlChannelReq)
     // Apply Rx1 frequency, if the status is OK
     if (status == 0x03)
     {
-        Channels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
+        RegionCtx->Channels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
     }
 
     return status;
@@ -888,11 +936,11 @@ int8_t RegionEU433AlternateDr(AlternateDrParams_t *alternateDr)
 void RegionEU433CalcBackOff(CalcBackOffParams_t *calcBackOff)
 {
     uint8_t channel = calcBackOff->Channel;
-    uint16_t dutyCycle = Bands[Channels[channel].Band].DCycle;
+    uint16_t dutyCycle = RegionCtx->Bands[RegionCtx->Channels[channel].Band].DCycle;
     uint16_t joinDutyCycle = 0;
 
     // Reset time-off to initial value.
-    Bands[Channels[channel].Band].TimeOff = 0;
+    RegionCtx->Bands[RegionCtx->Channels[channel].Band].TimeOff = 0;
 
     if (calcBackOff->Joined == false)
     {
@@ -901,13 +949,13 @@ void RegionEU433CalcBackOff(CalcBackOffParams_t *calcBackOff)
         // Apply the most restricting duty cycle
         dutyCycle = MAX(dutyCycle, joinDutyCycle);
         // Apply band time-off.
-        Bands[Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
+        RegionCtx->Bands[RegionCtx->Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
     }
     else
     {
         if (calcBackOff->DutyCycleEnabled == true)
         {
-            Bands[Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
+            RegionCtx->Bands[RegionCtx->Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
         }
     }
 }
@@ -919,9 +967,9 @@ bool RegionEU433NextChannel(NextChanParams_t *nextChanParams, uint8_t *channel,
     uint8_t enabledChannels[EU433_MAX_NB_CHANNELS] = {0};
     TimerTime_t nextTxDelay = 0;
 
-    if (RegionCommonCountChannels(ChannelsMask, 0, 1) == 0)
+    if (RegionCommonCountChannels(RegionCtx->ChannelsMask, 0, 1) == 0)
     { // Reactivate default channels
-        ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
+        RegionCtx->ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
     }
 
     if (nextChanParams->AggrTimeOff <= TimerGetElapsedTime(nextChanParams->LastAggrTx))
@@ -930,12 +978,12 @@ bool RegionEU433NextChannel(NextChanParams_t *nextChanParams, uint8_t *channel,
         *aggregatedTimeOff = 0;
 
         // Update bands Time OFF
-        nextTxDelay = RegionCommonUpdateBandTimeOff(nextChanParams->Joined, nextChanParams->DutyCycleEnabled, Bands, EU433_MAX_NB_BANDS);
+        nextTxDelay = RegionCommonUpdateBandTimeOff(nextChanParams->Joined, nextChanParams->DutyCycleEnabled, RegionCtx->Bands, EU433_MAX_NB_BANDS);
 
         // Search how many channels are enabled
         nbEnabledChannels = CountNbOfEnabledChannels(nextChanParams->Joined, nextChanParams->Datarate,
-                                                     ChannelsMask, Channels,
-                                                     Bands, enabledChannels, &delayTx);
+                                                     RegionCtx->ChannelsMask, RegionCtx->Channels,
+                                                     RegionCtx->Bands, enabledChannels, &delayTx);
     }
     else
     {
@@ -960,7 +1008,7 @@ bool RegionEU433NextChannel(NextChanParams_t *nextChanParams, uint8_t *channel,
             return true;
         }
         // Datarate not supported by any channel, restore defaults
-        ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
+        RegionCtx->ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
         *time = 0;
         return false;
     }
@@ -1006,7 +1054,7 @@ LoRaMacStatus_t RegionEU433ChannelAdd(ChannelAddParams_t *channelAdd)
             drInvalid = true;
         }
         // We are not allowed to change the frequency
-        if (channelAdd->NewChannel->Frequency != Channels[id].Frequency)
+        if (channelAdd->NewChannel->Frequency != RegionCtx->Channels[id].Frequency)
         {
             freqInvalid = true;
         }
@@ -1035,9 +1083,9 @@ LoRaMacStatus_t RegionEU433ChannelAdd(ChannelAddParams_t *channelAdd)
         return LORAMAC_STATUS_FREQUENCY_INVALID;
     }
 
-    memcpy(&(Channels[id]), channelAdd->NewChannel, sizeof(Channels[id]));
-    Channels[id].Band = band;
-    ChannelsMask[0] |= (1 << id);
+    memcpy(&(RegionCtx->Channels[id]), channelAdd->NewChannel, sizeof(RegionCtx->Channels[id]));
+    RegionCtx->Channels[id].Band = band;
+    RegionCtx->ChannelsMask[0] |= (1 << id);
     return LORAMAC_STATUS_OK;
 }
 
@@ -1051,16 +1099,16 @@ bool RegionEU433ChannelsRemove(ChannelRemoveParams_t *channelRemove)
     }
 
     // Remove the channel from the list of channels
-    Channels[id] = (ChannelParams_t){0, 0, {0}, 0};
+    RegionCtx->Channels[id] = (ChannelParams_t){0, 0, {0}, 0};
 
-    return RegionCommonChanDisable(ChannelsMask, id, EU433_MAX_NB_CHANNELS);
+    return RegionCommonChanDisable(RegionCtx->ChannelsMask, id, EU433_MAX_NB_CHANNELS);
 }
 
 void RegionEU433SetContinuousWave(ContinuousWaveParams_t *continuousWave)
 {
-    int8_t txPowerLimited = LimitTxPower(continuousWave->TxPower, Bands[Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, ChannelsMask);
+    int8_t txPowerLimited = LimitTxPower(continuousWave->TxPower, RegionCtx->Bands[RegionCtx->Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, RegionCtx->ChannelsMask);
     int8_t phyTxPower = 0;
-    uint32_t frequency = Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = RegionCtx->Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower(txPowerLimited, continuousWave->MaxEirp, continuousWave->AntennaGain);
@@ -39,14 +39,9 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 
 // Global attributes
 /*!
- * LoRaMAC channels
+ * LoRaMac default bands
  */
-static ChannelParams_t Channels[EU868_MAX_NB_CHANNELS];
-
-/*!
- * LoRaMac bands
- */
-static Band_t Bands[EU868_MAX_NB_BANDS] =
+static const Band_t BandsDefault[EU868_MAX_NB_BANDS] =
     {
         EU868_BAND0,
         EU868_BAND1,
@@ -56,14 +51,37 @@ static Band_t Bands[EU868_MAX_NB_BANDS] =
 };
 
 /*!
- * LoRaMac channels mask
+ * Region state
+ */
+typedef struct sRegionEU868Ctx
+{
+    /*!
+     * LoRaMAC channels
+     */
+    ChannelParams_t Channels[EU868_MAX_NB_CHANNELS];
+    /*!
+     * LoRaMac bands
+     */
+    Band_t Bands[EU868_MAX_NB_BANDS];
+    /*!
+     * LoRaMac channels mask
+     */
+    uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
+    /*!
+     * LoRaMac channels default mask
+     */
+    uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
+} RegionEU868Ctx_t;
+
+/*!
+ * Region state used until RegionEU868SetContext selects another one
  */
-static uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
+static RegionEU868Ctx_t RegionCtxDefault;
 
 /*!
- * LoRaMac channels default mask
+ * Selected region state
  */
-static uint16_t ChannelsDefaultMask[CHANNELS_MASK_SIZE];
+static RegionEU868Ctx_t *RegionCtx = &RegionCtxDefault;
 
 // Static functions
 static int8_t GetNextLowerTxDr(int8_t dr, int8_t minDr)
@@ -289,12 +307,12 @@ PhyParam_t RegionEU868GetPhyParam(GetPhyParams_t *getPhy)
     }
     case PHY_CHANNELS_MASK:
     {
-        phyParam.ChannelsMask = ChannelsMask;
+        phyParam.ChannelsMask = RegionCtx->ChannelsMask;
         break;
     }
     case PHY_CHANNELS_DEFAULT_MASK:
     {
-        phyParam.ChannelsMask = ChannelsDefaultMask;
+        phyParam.ChannelsMask = RegionCtx->ChannelsDefaultMask;
         break;
     }
     case PHY_MAX_NB_CHANNELS:
@@ -304,7 +322,7 @@ PhyParam_t RegionEU868GetPhyParam(GetPhyParams_t *getPhy)
     }
     case PHY_CHANNELS:
     {
-        phyParam.Channels = Channels;
+        phyParam.Channels = RegionCtx->Channels;
         break;
     }
     case PHY_DEF_UPLINK_DWELL_TIME:
@@ -357,7 +375,23 @@ PhyParam_t RegionEU868GetPhyParam(GetPhyParams_t *getPhy)
 
 void RegionEU868SetBandTxDone(SetBandTxDoneParams_t *txDone)
 {
-    RegionCommonSetBandTxDone(txDone->Joined, &Bands[Channels[txDone->Channel].Band], txDone->LastTxDoneTime);
+    RegionCommonSetBandTxDone(txDone->Joined, &RegionCtx->Bands[RegionCtx->Channels[txDone->Channel].Band], txDone->LastTxDoneTime);
+}
+
+size_t RegionEU868GetContextSize(void)
+{
+    return sizeof(RegionEU868Ctx_t);
+}
+
+uint8_t RegionEU868GetBands(Band_t **bands)
+{
+    *bands = RegionCtx->Bands;
+    return EU868_MAX_NB_BANDS;
+}
+
+void RegionEU868SetContext(void *ctx)
+{
+    RegionCtx = (ctx != NULL) ? (RegionEU868Ctx_t *)ctx : &RegionCtxDefault;
 }
 
 void RegionEU868InitDefaults(InitType_t type)
@@ -366,21 +400,24 @@ void RegionEU868InitDefaults(InitType_t type)
     {
     case INIT_TYPE_INIT:
     {
+        // Bands
+        RegionCommonInitBands(RegionCtx->Bands, BandsDefault, EU868_MAX_NB_BANDS);
+
         // Channels
-        Channels[0] = (ChannelParams_t)EU868_LC1;
-        Channels[1] = (ChannelParams_t)EU868_LC2;
-        Channels[2] = (ChannelParams_t)EU868_LC3;
+        RegionCtx->Channels[0] = (ChannelParams_t)EU868_LC1;
+        RegionCtx->Channels[1] = (ChannelParams_t)EU868_LC2;
+        RegionCtx->Channels[2] = (ChannelParams_t)EU868_LC3;
 
         // Initialize the channels default mask
-        ChannelsDefaultMask[0] = LC(1) + LC(2) + LC(3);
+        RegionCtx->ChannelsDefaultMask[0] = LC(1) + LC(2) + LC(3);
         // Update the channels mask
-        RegionCommonChanMaskCopy(ChannelsMask, ChannelsDefaultMask, 1);
+        RegionCommonChanMaskCopy(RegionCtx->ChannelsMask, RegionCtx->ChannelsDefaultMask, 1);
         break;
     }
     case INIT_TYPE_RESTORE:
     {
         // Restore channels default mask
-        ChannelsMask[0] |= ChannelsDefaultMask[0];
+        RegionCtx->ChannelsMask[0] |= RegionCtx->ChannelsDefaultMask[0];
         break;
     }
     default:
@@ -489,12 +526,12 @@ bool RegionEU868ChanMaskSet(ChanMaskSetParams_t *chanMaskSet)
     {
     case CHANNELS_MASK:
     {
-        RegionCommonChanMaskCopy(ChannelsMask, chanMaskSet->ChannelsMaskIn, 1);
+        RegionCommonChanMaskCopy(RegionCtx->ChannelsMask, chanMaskSet->ChannelsMaskIn, 1);
         break;
     }
     case CHANNELS_DEFAULT_MASK:
     {
-        RegionCommonChanMaskCopy(ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 1);
+        RegionCommonChanMaskCopy(RegionCtx->ChannelsDefaultMask, chanMaskSet->ChannelsMaskIn, 1);
         break;
     }
     default:
@@ -550,7 +587,7 @@ bool RegionEU868AdrNext(AdrNextParams_t *adrNext, int8_t *drOut, int8_t *txPowOu
                         if (adrNext->UpdateChanMask == true)
                         {
                             // Re-enable default channels
-                            ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
+                            RegionCtx->ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
                         }
                     }
                 }
@@ -600,11 +637,11 @@ bool RegionEU868RxConfig(RxConfigParams_t *rxConfig, int8_t *datarate)
     if (rxConfig->RxSlot == RX_SLOT_WIN_1)
     {
         // Apply window 1 frequency
-        frequency = Channels[rxConfig->Channel].Frequency;
+        frequency = RegionCtx->Channels[rxConfig->Channel].Frequency;
         // Apply the alternative RX 1 window frequency, if it is available
-        if (Channels[rxConfig->Channel].Rx1Frequency != 0)
+        if (RegionCtx->Channels[rxConfig->Channel].Rx1Frequency != 0)
         {
-            frequency = Channels[rxConfig->Channel].Rx1Frequency;
+            frequency = RegionCtx->Channels[rxConfig->Channel].Rx1Frequency;
         }
     }
 
@@ -636,6 +673,7 @@ bool RegionEU868RxConfig(RxConfigParams_t *rxConfig, int8_t *datarate)
 
     Radio.SetMaxPayloadLength(modem, maxPayload + LORA_MAC_FRMPAYLOAD_OVERHEAD);
     FREQ_PRINTF("RX on freq %u Hz at DR %d\r\n", (unsigned int)frequency, dr);
+    TRACE_EVENT(TRACE_REGION_RX, frequency, dr);
 
     *datarate = (uint8_t)dr;
     return true;
@@ -645,7 +683,7 @@ bool RegionEU868TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
 {
     RadioModems_t modem;
     int8_t phyDr = DataratesEU868[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower(txConfig->TxPower, Bands[Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, ChannelsMask);
+    int8_t txPowerLimited = LimitTxPower(txConfig->TxPower, RegionCtx->Bands[RegionCtx->Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, RegionCtx->ChannelsMask);
     uint32_t bandwidth = GetBandwidth(txConfig->Datarate);
     int8_t phyTxPower = 0;
 
@@ -653,7 +691,7 @@ bool RegionEU868TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
     phyTxPower = RegionCommonComputeTxPower(txPowerLimited, txConfig->MaxEirp, txConfig->AntennaGain);
 
     // Setup the radio frequency
-    Radio.SetChannel(Channels[txConfig->Channel].Frequency);
+    Radio.SetChannel(RegionCtx->Channels[txConfig->Channel].Frequency);
 
     if (txConfig->Datarate == DR_7)
     { // High Speed FSK channel
@@ -665,7 +703,8 @@ bool RegionEU868TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
         modem = MODEM_LORA;
         Radio.SetTxConfig(modem, phyTxPower, 0, bandwidth, phyDr, 1, LORAWAN_PREAMBLE_LENGTH, false, true, 0, 0, false, 3000);
     }
-    FREQ_PRINTF("TX on freq %u Hz at DR %d\r\n", (unsigned int)Channels[txConfig->Channel].Frequency, txConfig->Datarate);
+    FREQ_PRINTF("TX on freq %u Hz at DR %d\r\n", (unsigned int)RegionCtx->Channels[txConfig->Channel].Frequency, txConfig->Datarate);
+    TRACE_EVENT(TRACE_REGION_TX, RegionCtx->Channels[txConfig->Channel].Frequency, txConfig->Datarate);
     // Setup maximum payload lenght of the radio driver
     Radio.SetMaxPayloadLength(modem, txConfig->PktLen);
     // Get the time-on-air of the next tx frame
@@ -675,6 +714,15 @@ bool RegionEU868TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_
     return true;
 }
 
+TimerTime_t RegionEU868TimeOnAir(int8_t datarate, uint8_t pktLen)
+{
+    if (datarate == DR_7)
+    { // High Speed FSK channel
+        return RegionCommonComputeTimeOnAirFsk(DataratesEU868[datarate], pktLen);
+    }
+    return RegionCommonComputeTimeOnAirLoRa(DataratesEU868[datarate], BandwidthsEU868[datarate], LORAWAN_PREAMBLE_LENGTH, pktLen);
+}
+
 uint8_t RegionEU868LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int8_t *txPowOut, uint8_t *nbRepOut, uint8_t *nbBytesParsed)
 {
     uint8_t status = 0x07;
@@ -717,7 +765,7 @@ uint8_t RegionEU868LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
             {
                 if (linkAdrParams.ChMaskCtrl == 6)
                 {
-                    if (Channels[i].Frequency != 0)
+                    if (RegionCtx->Channels[i].Frequency != 0)
                     {
                         chMask |= 1 << i;
                     }
@@ -725,7 +773,7 @@ uint8_t RegionEU868LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
                 else
                 {
                     if (((chMask & (1 << i)) != 0) &&
-                        (Channels[i].Frequency == 0))
+                        (RegionCtx->Channels[i].Frequency == 0))
                     {                   // Trying to enable an undefined channel
                         status &= 0xFE; // Channel mask KO
                     }
@@ -735,7 +783,7 @@ uint8_t RegionEU868LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
     }
 
     // Verify datarate
-    if (RegionCommonChanVerifyDr(EU868_MAX_NB_CHANNELS, &chMask, linkAdrParams.Datarate, EU868_TX_MIN_DATARATE, EU868_TX_MAX_DATARATE, Channels) == false)
+    if (RegionCommonChanVerifyDr(EU868_MAX_NB_CHANNELS, &chMask, linkAdrParams.Datarate, EU868_TX_MIN_DATARATE, EU868_TX_MAX_DATARATE, RegionCtx->Channels) == false)
     {
         status &= 0xFD; // Datarate KO
     }
@@ -763,9 +811,9 @@ uint8_t RegionEU868LinkAdrReq(LinkAdrReqParams_t *linkAdrReq, int8_t *drOut, int
         }
 
         // Set the channels mask to a default value
-        memset(ChannelsMask, 0, sizeof(ChannelsMask));
+        memset(RegionCtx->ChannelsMask, 0, sizeof(RegionCtx->ChannelsMask));
         // Update the channels mask
-        ChannelsMask[0] = chMask;
+        RegionCtx->ChannelsMask[0] = chMask;
     }
 
     // Update status variables
@@ -872,7 +920,7 @@ uint8_t RegionEU868DlChannelReq(DlChannelReqParams_t *dlChannelReq)
     }
 
     // Verify if an uplink frequency exists
-    if (Channels[dlChannelReq->ChannelId].Frequency == 0)
+    if (RegionCtx->Channels[dlChannelReq->ChannelId].Frequency == 0)
     {
         status &= 0xFD;
     }
@@ -880,7 +928,7 @@ uint8_t RegionEU868DlChannelReq(DlChannelReqParams_t *dlChannelReq)
     // Apply Rx1 frequency, if the status is OK
     if (status == 0x03)
     {
-        Channels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
+        RegionCtx->Channels[dlChannelReq->ChannelId].Rx1Frequency = dlChannelReq->Rx1Frequency;
     }
 
     return status;
@@ -921,11 +969,11 @@ int8_t RegionEU868AlternateDr(AlternateDrParams_t *alternateDr)
 void RegionEU868CalcBackOff(CalcBackOffParams_t *calcBackOff)
 {
     uint8_t channel = calcBackOff->Channel;
-    uint16_t dutyCycle = Bands[Channels[channel].Band].DCycle;
+    uint16_t dutyCycle = RegionCtx->Bands[RegionCtx->Channels[channel].Band].DCycle;
     uint16_t joinDutyCycle = 0;
 
     // Reset time-off to initial value.
-    Bands[Channels[channel].Band].TimeOff = 0;
+    RegionCtx->Bands[RegionCtx->Channels[channel].Band].TimeOff = 0;
 
     if (calcBackOff->Joined == false)
     {
@@ -934,13 +982,13 @@ void RegionEU868CalcBackOff(CalcBackOffParams_t *calcBackOff)
         // Apply the most restricting duty cycle
         dutyCycle = MAX(dutyCycle, joinDutyCycle);
         // Apply band time-off.
-        Bands[Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
+        RegionCtx->Bands[RegionCtx->Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
     }
     else
     {
         if (calcBackOff->DutyCycleEnabled == true)
         {
-            Bands[Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
+            RegionCtx->Bands[RegionCtx->Channels[channel].Band].TimeOff = calcBackOff->TxTimeOnAir * dutyCycle - calcBackOff->TxTimeOnAir;
         }
     }
 }
@@ -952,9 +1000,9 @@ bool RegionEU868NextChannel(NextChanParams_t *nextChanParams, uint8_t *channel,
     uint8_t enabledChannels[EU868_MAX_NB_CHANNELS] = {0};
     TimerTime_t nextTxDelay = 0;
 
-    if (RegionCommonCountChannels(ChannelsMask, 0, 1) == 0)
+    if (RegionCommonCountChannels(RegionCtx->ChannelsMask, 0, 1) == 0)
     { // Reactivate default channels
-        ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
+        RegionCtx->ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
     }
 
     if (nextChanParams->AggrTimeOff <= TimerGetElapsedTime(nextChanParams->LastAggrTx))
@@ -963,12 +1011,12 @@ bool RegionEU868NextChannel(NextChanParams_t *nextChanParams, uint8_t *channel,
         *aggregatedTimeOff = 0;
 
         // Update bands Time OFF
-        nextTxDelay = RegionCommonUpdateBandTimeOff(nextChanParams->Joined, nextChanParams->DutyCycleEnabled, Bands, EU868_MAX_NB_BANDS);
+        nextTxDelay = RegionCommonUpdateBandTimeOff(nextChanParams->Joined, nextChanParams->DutyCycleEnabled, RegionCtx->Bands, EU868_MAX_NB_BANDS);
 
         // Search how many channels are enabled
         nbEnabledChannels = CountNbOfEnabledChannels(nextChanParams->Joined, nextChanParams->Datarate,
-                                                     ChannelsMask, Channels,
-                                                     Bands, enabledChannels, &delayTx);
+                                                     RegionCtx->ChannelsMask, RegionCtx->Channels,
+                                                     RegionCtx->Bands, enabledChannels, &delayTx);
     }
     else
     {
@@ -993,7 +1041,7 @@ bool RegionEU868NextChannel(NextChanParams_t *nextChanParams, uint8_t *channel,
             return true;
         }
         // Datarate not supported by any channel, restore defaults
-        ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
+        RegionCtx->ChannelsMask[0] |= LC(1) + LC(2) + LC(3);
         *time = 0;
         return false;
     }
@@ -1039,7 +1087,7 @@ LoRaMacStatus_t RegionEU868ChannelAdd(ChannelAddParams_t *channelAdd)
             drInvalid = true;
         }
         // We are not allowed to change the frequency
-        if (channelAdd->NewChannel->Frequency != Channels[id].Frequency)
+        if (channelAdd->NewChannel->Frequency != RegionCtx->Channels[id].Frequency)
         {
             freqInvalid = true;
         }
@@ -1068,9 +1116,9 @@ LoRaMacStatus_t RegionEU868ChannelAdd(ChannelAddParams_t *channelAdd)
         return LORAMAC_STATUS_FREQUENCY_INVALID;
     }
 
-    memcpy(&(Channels[id]), channelAdd->NewChannel, sizeof(Channels[id]));
-    Channels[id].Band = band;
-    ChannelsMask[0] |= (1 << id);
+    memcpy(&(RegionCtx->Channels[id]), channelAdd->NewChannel, sizeof(RegionCtx->Channels[id]));
+    RegionCtx->Channels[id].Band = band;
+    RegionCtx->ChannelsMask[0] |= (1 << id);
     return LORAMAC_STATUS_OK;
 }
 
@@ -1084,16 +1132,16 @@ bool RegionEU868ChannelsRemove(ChannelRemoveParams_t *channelRemove)
     }
 
     // Remove the channel from the list of channels
-    Channels[id] = (ChannelParams_t){0, 0, {0}, 0};
+    RegionCtx->Channels[id] = (ChannelParams_t){0, 0, {0}, 0};
 
-    return RegionCommonChanDisable(ChannelsMask, id, EU868_MAX_NB_CHANNELS);
+    return RegionCommonChanDisable(RegionCtx->ChannelsMask, id, EU868_MAX_NB_CHANNELS);
 }
 
 void RegionEU868SetContinuousWave(ContinuousWaveParams_t *continuousWave)
 {
-    int8_t txPowerLimited = LimitTxPower(continuousWave->TxPower, Bands[Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, ChannelsMask);
+    int8_t txPowerLimited = LimitTxPower(continuousWave->TxPower, RegionCtx->Bands[RegionCtx->Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, RegionCtx->ChannelsMask);
     int8_t phyTxPower = 0;
-    uint32_t frequency = Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = RegionCtx->Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower(txPowerLimited, continuousWave->MaxEirp, continuousWave->AntennaGain);
@@ -379,6 +379,31 @@ PhyParam_t RegionEU868GetPhyParam(GetPhyParams_t *getPhy);
  */
 void RegionEU868SetBandTxDone(SetBandTxDoneParams_t *txDone);
 
+/*!
+ * \brief Returns the size of the region state.
+ *
+ * \retval Size in bytes.
+ */
+size_t RegionEU868GetContextSize(void);
+
+/*!
+ * \brief Gives access to the duty cycle bands of the region state.
+ *
+ * \param [OUT] bands Set to the bands array.
+ *
+ * \retval Number of bands.
+ */
+uint8_t RegionEU868GetBands(Band_t **bands);
+
+/*!
+ * \brief Selects the region state the functions work on. The state is
+ *        set up by RegionEU868InitDefaults(INIT_TYPE_INIT).
+ *
+ * \param [IN] ctx Region state of RegionEU868GetContextSize bytes, NULL for the
+ *                 built-in one.
+ */
+void RegionEU868SetContext(void *ctx);
+
 /*!
  * \brief Initializes the channels masks and the channels.
  *
@@ -468,6 +493,17 @@ bool RegionEU868RxConfig(RxConfigParams_t *rxConfig, int8_t *datarate);
  */
 bool RegionEU868TxConfig(TxConfigParams_t *txConfig, int8_t *txPower, TimerTime_t *txTimeOnAir);
 
+/*!
+ * \brief Time-on-air of a frame at a datarate, without touching the radio.
+ *
+ * \param [IN] datarate Datarate of the frame.
+ *
+ * \param [IN] pktLen PHY payload length in bytes.
+ *
+ * \retval Returns the time-on-air in milliseconds.
+ */
+TimerTime_t RegionEU868TimeOnAir(int8_t datarate, uint8_t pktLen);
+
 /*!
  * \brief The function processes a Link ADR Request.
  *
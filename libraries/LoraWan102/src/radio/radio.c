@@ -398,7 +398,15 @@ bool RxContinuous = false;
 
 
 PacketStatus_t RadioPktStatus;
-uint8_t RadioRxPayload[255];
+
+/*!
+ * Received payloads are read straight into RadioRxBuffer and handed to
+ * RxDone in place, RadioRxPayload backs it unless the application
+ * provides its own with RadioSetRxBuffer
+ */
+static uint8_t RadioRxPayload[255];
+static uint8_t *RadioRxBuffer = RadioRxPayload;
+static uint8_t RadioRxBufferSize = sizeof( RadioRxPayload );
 
 bool IrqFired = false;
 
@@ -462,6 +470,210 @@ TimerEvent_t TxTimeoutTimer;
 TimerEvent_t RxTimeoutTimer;
 TimerEvent_t CadTimeoutTimer;
 
+#ifndef RADIO_CONFIG_SHADOW
+/*!
+ * Skip configuration commands that repeat the last programmed value. Build
+ * with 0 to get the SPI traffic of the unshadowed driver.
+ */
+#define RADIO_CONFIG_SHADOW 1
+#endif
+
+/*!
+ * Parts of the shadow that hold a programmed value
+ */
+#define RADIO_SHADOW_PACKET_TYPE    0x0001
+#define RADIO_SHADOW_MODULATION     0x0002
+#define RADIO_SHADOW_PACKET         0x0004
+#define RADIO_SHADOW_FREQUENCY      0x0008
+#define RADIO_SHADOW_TX_POWER       0x0010
+#define RADIO_SHADOW_SYMB_TIMEOUT   0x0020
+#define RADIO_SHADOW_STOP_RX_TIMER  0x0040
+#define RADIO_SHADOW_FSK_SYNC       0x0080
+#define RADIO_SHADOW_DIO_IRQ        0x0100
+
+/*!
+ * SPI bytes of a SetTxParams with its PA configuration and OCP write
+ */
+#define RADIO_TX_POWER_SPI_BYTES    12
+
+/*!
+ * Last configuration programmed into the radio. The radio keeps it through
+ * warm sleep, a reset or a change of packet type drops it.
+ */
+typedef struct
+{
+    uint16_t Valid;
+    RadioPacketTypes_t PacketType;
+    ModulationParams_t ModulationParams;
+    PacketParams_t PacketParams;
+    uint32_t Frequency;
+    int8_t Power;
+    uint8_t SymbTimeout;
+    bool StopRxTimer;
+    uint16_t IrqMask;
+}RadioShadow_t;
+
+static RadioShadow_t RadioShadow;
+
+/*!
+ * SPI counters
+ */
+static uint32_t RadioCycleStart = 0;
+static uint32_t RadioLastCycleBytes = 0;
+static uint32_t RadioSkippedCommands = 0;
+static uint32_t RadioSkippedBytes = 0;
+static uint32_t RadioCycleSkippedStart = 0;
+static uint32_t RadioLastCycleSkippedBytes = 0;
+
+/*!
+ * \brief Tells whether a command can be skipped and counts it if so
+ *
+ * \param [IN] part  Shadow part the command programs
+ * \param [IN] same  The command repeats the shadowed value
+ * \param [IN] bytes SPI bytes of the command
+ * \retval skip      The command can be skipped
+ */
+static bool RadioShadowHit( uint16_t part, bool same, uint16_t bytes )
+{
+#if ( RADIO_CONFIG_SHADOW == 1 )
+    if( ( ( RadioShadow.Valid & part ) != 0 ) && ( same == true ) )
+    {
+        RadioSkippedCommands++;
+        RadioSkippedBytes += bytes;
+        return true;
+    }
+#endif
+    RadioShadow.Valid |= part;
+    return false;
+}
+
+static void RadioShadowPacketType( RadioPacketTypes_t packetType )
+{
+    if( RadioShadowHit( RADIO_SHADOW_PACKET_TYPE, RadioShadow.PacketType == packetType, 2 ) == false )
+    {
+        SX126xSetPacketType( packetType );
+        // The radio drops the modulation and packet parameters on a new type
+        RadioShadow.Valid &= ~( RADIO_SHADOW_MODULATION | RADIO_SHADOW_PACKET | RADIO_SHADOW_FSK_SYNC );
+        RadioShadow.PacketType = packetType;
+    }
+}
+
+static void RadioShadowModulationParams( void )
+{
+    bool same = memcmp( &RadioShadow.ModulationParams, &SX126x.ModulationParams, sizeof( ModulationParams_t ) ) == 0;
+
+    RadioShadowPacketType( SX126x.ModulationParams.PacketType );
+    if( RadioShadowHit( RADIO_SHADOW_MODULATION, same,
+                        ( SX126x.ModulationParams.PacketType == PACKET_TYPE_LORA ) ? 5 : 9 ) == false )
+    {
+        SX126xSetModulationParams( &SX126x.ModulationParams );
+        RadioShadow.ModulationParams = SX126x.ModulationParams;
+    }
+}
+
+static void RadioShadowPacketParams( void )
+{
+    bool same = memcmp( &RadioShadow.PacketParams, &SX126x.PacketParams, sizeof( PacketParams_t ) ) == 0;
+
+    RadioShadowPacketType( SX126x.PacketParams.PacketType );
+    if( RadioShadowHit( RADIO_SHADOW_PACKET, same,
+                        ( SX126x.PacketParams.PacketType == PACKET_TYPE_LORA ) ? 7 : 10 ) == false )
+    {
+        SX126xSetPacketParams( &SX126x.PacketParams );
+        RadioShadow.PacketParams = SX126x.PacketParams;
+    }
+}
+
+static void RadioShadowSymbTimeout( uint8_t symbNum )
+{
+    if( RadioShadowHit( RADIO_SHADOW_SYMB_TIMEOUT, RadioShadow.SymbTimeout == symbNum, 2 ) == false )
+    {
+        SX126xSetLoRaSymbNumTimeout( symbNum );
+        RadioShadow.SymbTimeout = symbNum;
+    }
+}
+
+static void RadioShadowStopRxTimer( bool enable )
+{
+    if( RadioShadowHit( RADIO_SHADOW_STOP_RX_TIMER, RadioShadow.StopRxTimer == enable, 2 ) == false )
+    {
+        SX126xSetStopRxTimerOnPreambleDetect( enable );
+        RadioShadow.StopRxTimer = enable;
+    }
+}
+
+static void RadioShadowFskSync( void )
+{
+    if( RadioShadowHit( RADIO_SHADOW_FSK_SYNC, true, 11 + 5 ) == false )
+    {
+        SX126xSetSyncWord( ( uint8_t[] ){ 0xC1, 0x94, 0xC1, 0x00, 0x00, 0x00, 0x00, 0x00 } );
+        SX126xSetWhiteningSeed( 0x01FF );
+    }
+}
+
+static void RadioShadowTxPower( int8_t power )
+{
+    if( RadioShadowHit( RADIO_SHADOW_TX_POWER, RadioShadow.Power == power, RADIO_TX_POWER_SPI_BYTES ) == false )
+    {
+        SX126xSetRfTxPower( power );
+        RadioShadow.Power = power;
+    }
+}
+
+/*!
+ * \brief Routes DIO1 to the given IRQs, DIO2 and DIO3 stay unused
+ */
+static void RadioShadowDioIrq( uint16_t irqMask )
+{
+    if( RadioShadowHit( RADIO_SHADOW_DIO_IRQ, RadioShadow.IrqMask == irqMask, 9 ) == false )
+    {
+        SX126xSetDioIrqParams( irqMask, irqMask, IRQ_RADIO_NONE, IRQ_RADIO_NONE );
+        RadioShadow.IrqMask = irqMask;
+    }
+}
+
+/*!
+ * \brief Puts the radio in STDBY_RC unless it already is
+ */
+static void RadioShadowStandby( void )
+{
+#if ( RADIO_CONFIG_SHADOW == 1 )
+    if( SX126xGetOperatingMode( ) == MODE_STDBY_RC )
+    {
+        RadioSkippedCommands++;
+        RadioSkippedBytes += 2;
+        return;
+    }
+#endif
+    RadioStandby( );
+}
+
+void RadioSetRxBuffer( uint8_t *buffer, uint8_t size )
+{
+    if( buffer == NULL )
+    {
+        buffer = RadioRxPayload;
+        size = sizeof( RadioRxPayload );
+    }
+    RadioRxBuffer = buffer;
+    RadioRxBufferSize = size;
+}
+
+void RadioResetShadow( void )
+{
+    RadioShadow.Valid = 0;
+}
+
+void RadioGetSpiStats( RadioSpiStats_t *stats )
+{
+    stats->Bytes = SX126xSpiBytes;
+    stats->CycleBytes = SX126xSpiBytes - RadioCycleStart;
+    stats->LastCycleBytes = RadioLastCycleBytes;
+    stats->SkippedCommands = RadioSkippedCommands;
+    stats->SkippedBytes = RadioSkippedBytes;
+    stats->LastCycleSkippedBytes = RadioLastCycleSkippedBytes;
+}
+
 /*!
  * Returns the known FSK bandwidth registers value
  *
@@ -492,6 +704,7 @@ int RadioInit( RadioEvents_t *events )
 {
 
     RadioEvents = events;
+    RadioResetShadow( );
 #ifdef __asr6601__
 	SX126xInit( );
 #else
@@ -534,13 +747,13 @@ void RadioSetModem( RadioModems_t modem )
     {
     default:
     case MODEM_FSK:
-        SX126xSetPacketType( PACKET_TYPE_GFSK );
+        RadioShadowPacketType( PACKET_TYPE_GFSK );
         // When switching to GFSK mode the LoRa SyncWord register value is reset
         // Thus, we also reset the RadioPublicNetwork variable
         RadioPublicNetwork.Current = false;
         break;
     case MODEM_LORA:
-        SX126xSetPacketType( PACKET_TYPE_LORA );
+        RadioShadowPacketType( PACKET_TYPE_LORA );
         // Public/Private network register is reset when switching modems
         if( RadioPublicNetwork.Current != RadioPublicNetwork.Previous )
         {
@@ -553,7 +766,11 @@ void RadioSetModem( RadioModems_t modem )
 
 void RadioSetChannel( uint32_t freq )
 {
-    SX126xSetRfFrequency( freq );
+    if( RadioShadowHit( RADIO_SHADOW_FREQUENCY, RadioShadow.Frequency == freq, 5 ) == false )
+    {
+        SX126xSetRfFrequency( freq );
+        RadioShadow.Frequency = freq;
+    }
 }
 
 bool RadioIsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime )
@@ -636,7 +853,7 @@ void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
     switch( modem )
     {
         case MODEM_FSK:
-            SX126xSetStopRxTimerOnPreambleDetect( false );
+            RadioShadowStopRxTimer( false );
             SX126x.ModulationParams.PacketType = PACKET_TYPE_GFSK;
 
             SX126x.ModulationParams.Params.Gfsk.BitRate = datarate;
@@ -660,19 +877,18 @@ void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
             }
             SX126x.PacketParams.Params.Gfsk.DcFree = RADIO_DC_FREEWHITENING;
 
-            RadioStandby( );
+            RadioShadowStandby( );
             RadioSetModem( ( SX126x.ModulationParams.PacketType == PACKET_TYPE_GFSK ) ? MODEM_FSK : MODEM_LORA );
-            SX126xSetModulationParams( &SX126x.ModulationParams );
-            SX126xSetPacketParams( &SX126x.PacketParams );
-            SX126xSetSyncWord( ( uint8_t[] ){ 0xC1, 0x94, 0xC1, 0x00, 0x00, 0x00, 0x00, 0x00 } );
-            SX126xSetWhiteningSeed( 0x01FF );
+            RadioShadowModulationParams( );
+            RadioShadowPacketParams( );
+            RadioShadowFskSync( );
 
             RxTimeout = ( uint32_t )( symbTimeout * ( ( 1.0 / ( double )datarate ) * 8.0 ) * 1000 );
             break;
 
         case MODEM_LORA:
-            SX126xSetStopRxTimerOnPreambleDetect( false );
-            SX126xSetLoRaSymbNumTimeout( symbTimeout );
+            RadioShadowStopRxTimer( false );
+            RadioShadowSymbTimeout( symbTimeout );
             SX126x.ModulationParams.PacketType = PACKET_TYPE_LORA;
             SX126x.ModulationParams.Params.LoRa.SpreadingFactor = ( RadioLoRaSpreadingFactors_t )datarate;
             SX126x.ModulationParams.Params.LoRa.Bandwidth = Bandwidths[bandwidth];
@@ -713,8 +929,8 @@ void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
             SX126x.PacketParams.Params.LoRa.InvertIQ = ( RadioLoRaIQModes_t )iqInverted;
 
             RadioSetModem( ( SX126x.ModulationParams.PacketType == PACKET_TYPE_GFSK ) ? MODEM_FSK : MODEM_LORA );
-            SX126xSetModulationParams( &SX126x.ModulationParams );
-            SX126xSetPacketParams( &SX126x.PacketParams );
+            RadioShadowModulationParams( );
+            RadioShadowPacketParams( );
 
             // Timeout Max, Timeout handled directly in SetRx function
             RxTimeout = 0xFFFF;
@@ -729,6 +945,11 @@ void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
                         bool fixLen, bool crcOn, bool freqHopOn,
                         uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
 {
+    // An uplink cycle starts with its TX configuration
+    RadioLastCycleBytes = SX126xSpiBytes - RadioCycleStart;
+    RadioCycleStart = SX126xSpiBytes;
+    RadioLastCycleSkippedBytes = RadioSkippedBytes - RadioCycleSkippedStart;
+    RadioCycleSkippedStart = RadioSkippedBytes;
 
     switch( modem )
     {
@@ -757,12 +978,10 @@ void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
             }
             SX126x.PacketParams.Params.Gfsk.DcFree = RADIO_DC_FREEWHITENING;
 
-            RadioStandby( );
+            RadioShadowStandby( );
             RadioSetModem( ( SX126x.ModulationParams.PacketType == PACKET_TYPE_GFSK ) ? MODEM_FSK : MODEM_LORA );
-            SX126xSetModulationParams( &SX126x.ModulationParams );
-            SX126xSetPacketParams( &SX126x.PacketParams );
-            SX126xSetSyncWord( ( uint8_t[] ){ 0xC1, 0x94, 0xC1, 0x00, 0x00, 0x00, 0x00, 0x00 } );
-            SX126xSetWhiteningSeed( 0x01FF );
+            RadioShadowModulationParams( );
+            RadioShadowFskSync( );
             break;
 
         case MODEM_LORA:
@@ -804,13 +1023,13 @@ void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
             SX126x.PacketParams.Params.LoRa.CrcMode = ( RadioLoRaCrcModes_t )crcOn;
             SX126x.PacketParams.Params.LoRa.InvertIQ = ( RadioLoRaIQModes_t )iqInverted;
 
-            RadioStandby( );
+            RadioShadowStandby( );
             RadioSetModem( ( SX126x.ModulationParams.PacketType == PACKET_TYPE_GFSK ) ? MODEM_FSK : MODEM_LORA );
-            SX126xSetModulationParams( &SX126x.ModulationParams );
-            SX126xSetPacketParams( &SX126x.PacketParams );
+            RadioShadowModulationParams( );
             break;
     }
-    SX126xSetRfTxPower( power );
+    // The packet parameters go out with the payload length in RadioSend
+    RadioShadowTxPower( power );
     TxTimeout = timeout;
 }
 
@@ -882,10 +1101,7 @@ uint32_t RadioTimeOnAir( RadioModems_t modem, uint8_t pktLen )
 
 void RadioSend( uint8_t *buffer, uint8_t size )
 {
-    SX126xSetDioIrqParams( IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT,
-                           IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT,
-                           IRQ_RADIO_NONE,
-                           IRQ_RADIO_NONE );
+    RadioShadowDioIrq( IRQ_TX_DONE | IRQ_RX_TX_TIMEOUT );
 
     if( SX126xGetPacketType( ) == PACKET_TYPE_LORA )
     {
@@ -895,7 +1111,7 @@ void RadioSend( uint8_t *buffer, uint8_t size )
     {
         SX126x.PacketParams.Params.Gfsk.PayloadLength = size;
     }
-    SX126xSetPacketParams( &SX126x.PacketParams );
+    RadioShadowPacketParams( );
 
     SX126xSendPayload( buffer, size, 0 );
     TimerSetValue( &TxTimeoutTimer, TxTimeout );
@@ -919,10 +1135,7 @@ void RadioStandby( void )
 
 void RadioRx( uint32_t timeout )
 {
-    SX126xSetDioIrqParams( IRQ_RX_DONE | IRQ_CRC_ERROR| IRQ_RX_TX_TIMEOUT,
-                           IRQ_RX_DONE | IRQ_CRC_ERROR| IRQ_RX_TX_TIMEOUT,
-                           IRQ_RADIO_NONE,
-                           IRQ_RADIO_NONE );
+    RadioShadowDioIrq( IRQ_RX_DONE | IRQ_CRC_ERROR| IRQ_RX_TX_TIMEOUT );
 
     if( timeout != 0 )
     {
@@ -932,7 +1145,7 @@ void RadioRx( uint32_t timeout )
 
     if( RxContinuous == true )
     {
-        SX126xSetLoRaSymbNumTimeout( 0 );
+        RadioShadowSymbTimeout( 0 );
         SX126xSetRx( 0xFFFFFF ); // Rx Continuous
     }
     else
@@ -943,10 +1156,7 @@ void RadioRx( uint32_t timeout )
 
 void RadioRxBoosted( uint32_t timeout )
 {
-    SX126xSetDioIrqParams( IRQ_RX_DONE,
-                           IRQ_RX_DONE,
-                           IRQ_RADIO_NONE,
-                           IRQ_RADIO_NONE );
+    RadioShadowDioIrq( IRQ_RX_DONE );
 
     if( timeout != 0 )
     {
@@ -989,10 +1199,7 @@ void RadioStartCad( uint8_t symbols )
     else
         cadSymbolNum = LORA_CAD_01_SYMBOL;
     
-    SX126xSetDioIrqParams( IRQ_CAD_DONE | IRQ_CAD_ACTIVITY_DETECTED,
-                           IRQ_CAD_DONE | IRQ_CAD_ACTIVITY_DETECTED,
-                           IRQ_RADIO_NONE,
-                           IRQ_RADIO_NONE );
+    RadioShadowDioIrq( IRQ_CAD_DONE | IRQ_CAD_ACTIVITY_DETECTED );
     SX126xSetCadParams( cadSymbolNum, cadDetPeak, cadDetMin, LORA_CAD_ONLY, 0 );
     
     SX126xSetCad( );
@@ -1003,13 +1210,14 @@ void RadioStartCad( uint8_t symbols )
 
 void RadioTx( uint32_t timeout )
 {
+    RadioShadowPacketParams( );
     SX126xSetTx( timeout << 6 );
 }
 
 void RadioSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
 {
-    SX126xSetRfFrequency( freq );
-    SX126xSetRfTxPower( power );
+    RadioSetChannel( freq );
+    RadioShadowTxPower( power );
     SX126xSetTxContinuousWave( );
 
     TimerSetValue( &RxTimeoutTimer, time  * 1e3 );
@@ -1042,6 +1250,7 @@ void RadioReadBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
 }
 void RadioSyncWord( uint8_t data )
 {
+    RadioShadow.Valid &= ~RADIO_SHADOW_FSK_SYNC;
     SX126xSetSyncWord(&data);
 }
 
@@ -1060,14 +1269,14 @@ void RadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
     if( modem == MODEM_LORA )
     {
         SX126x.PacketParams.Params.LoRa.PayloadLength = MaxPayloadLength = max;
-        SX126xSetPacketParams( &SX126x.PacketParams );
+        RadioShadowPacketParams( );
     }
     else
     {
         if( SX126x.PacketParams.Params.Gfsk.HeaderType == RADIO_PACKET_VARIABLE_LENGTH )
         {
             SX126x.PacketParams.Params.Gfsk.PayloadLength = MaxPayloadLength = max;
-            SX126xSetPacketParams( &SX126x.PacketParams );
+            RadioShadowPacketParams( );
         }
     }
 }
@@ -1161,11 +1370,18 @@ void RadioIrqProcess( void )
         	//printf("rx done\r\n");
             uint8_t size;
             TimerStop( &RxTimeoutTimer );
-            SX126xGetPayload( RadioRxPayload, &size , 255 );
-            SX126xGetPacketStatus( &RadioPktStatus );
+            // A payload nobody takes is left in the radio FIFO
             if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) && ( irqRegs & IRQ_CRC_ERROR ) != IRQ_CRC_ERROR)
             {
-                RadioEvents->RxDone( RadioRxPayload, size, RadioPktStatus.Params.LoRa.RssiPkt, RadioPktStatus.Params.LoRa.SnrPkt );
+                if( SX126xGetPayload( RadioRxBuffer, &size, RadioRxBufferSize ) == 0 )
+                {
+                    SX126xGetPacketStatus( &RadioPktStatus );
+                    RadioEvents->RxDone( RadioRxBuffer, size, RadioPktStatus.Params.LoRa.RssiPkt, RadioPktStatus.Params.LoRa.SnrPkt );
+                }
+                else if( RadioEvents->RxError != NULL )
+                {
+                    RadioEvents->RxError( );
+                }
             }
         }
 
@@ -385,6 +385,54 @@ struct Radio_s
  */
 extern const struct Radio_s Radio;
 
+/*!
+ * Radio SPI traffic, an uplink cycle runs from one TX configuration to the
+ * next one
+ */
+typedef struct
+{
+    /*!
+     * \brief Bytes clocked since start up
+     */
+    uint32_t Bytes;
+    /*!
+     * \brief Bytes of the current and of the last complete cycle
+     */
+    uint32_t CycleBytes;
+    uint32_t LastCycleBytes;
+    /*!
+     * \brief Commands and bytes saved by the configuration shadow, since start
+     *        up and during the last complete cycle
+     */
+    uint32_t SkippedCommands;
+    uint32_t SkippedBytes;
+    uint32_t LastCycleSkippedBytes;
+}RadioSpiStats_t;
+
+/*!
+ * \brief Sets the buffer received payloads are read into. RxDone hands out
+ *        a pointer into it, the payload stays valid until the next reception.
+ *        Swapping buffers from RxDone keeps a payload without copying it.
+ *
+ * \param [IN] buffer Buffer, NULL restores the driver's own 255 bytes
+ * \param [IN] size   Buffer size, longer payloads are reported as RxError
+ */
+void RadioSetRxBuffer( uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Forgets the configuration programmed into the radio, the next
+ *        configuration is written in full. Needed after the radio has been
+ *        reset or put in cold sleep outside of this driver.
+ */
+void RadioResetShadow( void );
+
+/*!
+ * \brief Returns the radio SPI traffic
+ *
+ * \param [OUT] stats SPI counters
+ */
+void RadioGetSpiStats( RadioSpiStats_t *stats );
+
 #ifdef __cplusplus
 }
 #endif
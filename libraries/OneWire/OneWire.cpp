@@ -146,6 +146,7 @@ sample code bearing this copyright.
 
 void OneWire::begin(uint8_t pin)
 {
+	uart = NULL;
 	pinMode(pin, INPUT);
 	bitmask = PIN_TO_BITMASK(pin);
 	baseReg = PIN_TO_BASEREG(pin);
@@ -154,6 +155,44 @@ void OneWire::begin(uint8_t pin)
 #endif
 }
 
+// 1-Wire over a UART. Each slot is one character: the start bit is the
+// low pulse, the data bits shape the rest of the slot. What comes back on
+// RX is the level the bus really had, so the echo of 0xFF reads a bit. A
+// whole byte is eight characters queued at once; the UART clocks them out
+// back to back and its receive interrupt collects the echoes.
+void OneWire::begin(HardwareSerial &serial)
+{
+	bitmask = 0;
+	baseReg = NULL;
+	uart = &serial;
+	uart->begin(ONEWIRE_UART_SLOT_BAUD);
+#if ONEWIRE_SEARCH
+	reset_search();
+#endif
+}
+
+// Sends count slot characters and replaces each with its echo. Fails if an
+// echo does not arrive, when RX is not on the bus or the bus is held low.
+bool OneWire::uart_slots(uint8_t *slots, uint8_t count)
+{
+	uint8_t done = 0;
+	uint32_t start;
+	int c;
+
+	while (uart->available()) uart->read();
+	uart->write(slots, count);
+	start = millis();
+	while (done < count) {
+		c = uart->read();
+		if (c >= 0) {
+			slots[done++] = c;
+		} else if (millis() - start > 2 + count) {
+			return false;
+		}
+	}
+	return true;
+}
+
 
 // Perform the onewire reset function.  We will wait up to 250uS for
 // the bus to come high, if it doesn't then it is broken or shorted
@@ -168,6 +207,18 @@ uint8_t OneWire::reset(void)
 	uint8_t r;
 	uint8_t retries = 125;
 
+	if (uart) {
+		// 0xF0 at 9600 baud is a 520us reset pulse, a presence pulse
+		// pulls some of the high bits low
+		uint8_t slot = 0xF0;
+		bool echoed;
+
+		uart->updateBaudRate(ONEWIRE_UART_RESET_BAUD);
+		echoed = uart_slots(&slot, 1);
+		uart->updateBaudRate(ONEWIRE_UART_SLOT_BAUD);
+		return echoed && slot != 0xF0 && slot != 0x00;
+	}
+
 	noInterrupts();
 	DIRECT_MODE_INPUT(reg, mask);
 	interrupts();
@@ -200,6 +251,12 @@ void OneWire::write_bit(uint8_t v)
 	IO_REG_TYPE mask IO_REG_MASK_ATTR = bitmask;
 	volatile IO_REG_TYPE *reg IO_REG_BASE_ATTR = baseReg;
 
+	if (uart) {
+		uint8_t slot = (v & 1) ? 0xFF : 0x00;
+		uart_slots(&slot, 1);
+		return;
+	}
+
 	if (v & 1) {
 		noInterrupts();
 		DIRECT_WRITE_LOW(reg, mask);
@@ -229,6 +286,12 @@ uint8_t OneWire::read_bit(void)
 	volatile IO_REG_TYPE *reg IO_REG_BASE_ATTR = baseReg;
 	uint8_t r;
 
+	if (uart) {
+		uint8_t slot = 0xFF;
+		uart_slots(&slot, 1);
+		return slot == 0xFF;
+	}
+
 	noInterrupts();
 	DIRECT_MODE_OUTPUT(reg, mask);
 	DIRECT_WRITE_LOW(reg, mask);
@@ -251,6 +314,13 @@ uint8_t OneWire::read_bit(void)
 void OneWire::write(uint8_t v, uint8_t power /* = 0 */) {
     uint8_t bitMask;
 
+    if (uart) {
+	uint8_t slots[8];
+	for (uint8_t i = 0; i < 8; i++) slots[i] = (v & (1 << i)) ? 0xFF : 0x00;
+	uart_slots(slots, 8);
+	return;
+    }
+
     for (bitMask = 0x01; bitMask; bitMask <<= 1) {
 	OneWire::write_bit( (bitMask & v)?1:0);
     }
@@ -265,7 +335,7 @@ void OneWire::write(uint8_t v, uint8_t power /* = 0 */) {
 void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power /* = 0 */) {
   for (uint16_t i = 0 ; i < count ; i++)
     write(buf[i]);
-  if (!power) {
+  if (!power && !uart) {
     noInterrupts();
     DIRECT_MODE_INPUT(baseReg, bitmask);
     DIRECT_WRITE_LOW(baseReg, bitmask);
@@ -280,6 +350,14 @@ uint8_t OneWire::read() {
     uint8_t bitMask;
     uint8_t r = 0;
 
+    if (uart) {
+	uint8_t slots[8];
+	memset(slots, 0xFF, sizeof(slots));
+	uart_slots(slots, 8);
+	for (uint8_t i = 0; i < 8; i++) if (slots[i] == 0xFF) r |= 1 << i;
+	return r;
+    }
+
     for (bitMask = 0x01; bitMask; bitMask <<= 1) {
 	if ( OneWire::read_bit()) r |= bitMask;
     }
@@ -313,6 +391,7 @@ void OneWire::skip()
 
 void OneWire::depower()
 {
+	if (uart) return;
 	noInterrupts();
 	DIRECT_MODE_INPUT(baseReg, bitmask);
 	interrupts();
@@ -404,8 +483,15 @@ bool OneWire::search(uint8_t *newAddr, bool search_mode /* = true */)
       do
       {
          // read a bit and its complement
-         id_bit = read_bit();
-         cmp_id_bit = read_bit();
+         if (uart) {
+            uint8_t slots[2] = { 0xFF, 0xFF };
+            uart_slots(slots, 2);
+            id_bit = (slots[0] == 0xFF);
+            cmp_id_bit = (slots[1] == 0xFF);
+         } else {
+            id_bit = read_bit();
+            cmp_id_bit = read_bit();
+         }
 
          // check for no devices on 1-wire
          if ((id_bit == 1) && (cmp_id_bit == 1)) {
@@ -49,11 +49,23 @@
 // Board-specific macros for direct GPIO
 #include "util/OneWire_direct_regtype.h"
 
+// Baud rates for 1-Wire over a UART: the reset pulse is one character
+// at the first, every time slot one character at the second.
+#ifndef ONEWIRE_UART_RESET_BAUD
+#define ONEWIRE_UART_RESET_BAUD 9600
+#endif
+#ifndef ONEWIRE_UART_SLOT_BAUD
+#define ONEWIRE_UART_SLOT_BAUD 115200
+#endif
+
 class OneWire
 {
   private:
     IO_REG_TYPE bitmask;
     volatile IO_REG_TYPE *baseReg;
+    HardwareSerial *uart;
+
+    bool uart_slots(uint8_t *slots, uint8_t count);
 
 #if ONEWIRE_SEARCH
     // global search state
@@ -64,10 +76,19 @@ class OneWire
 #endif
 
   public:
-    OneWire() { }
-    OneWire(uint8_t pin) { begin(pin); }
+    OneWire() : uart(NULL) { }
+    OneWire(uint8_t pin) : uart(NULL) { begin(pin); }
     void begin(uint8_t pin);
 
+    // Run the bus from a hardware UART instead of a pin. The UART times
+    // every slot, so interrupts stay enabled throughout. RX goes to the
+    // bus, which has the usual pull-up. TX pulls the bus low through a
+    // Schottky diode (cathode at TX) or an open-drain buffer. The bus
+    // cannot be driven high, so the 'power' arguments and depower() do
+    // nothing in this mode.
+    OneWire(HardwareSerial &serial) : uart(NULL) { begin(serial); }
+    void begin(HardwareSerial &serial);
+
     // Perform a 1-Wire reset cycle. Returns 1 if a device responds
     // with a presence pulse.  Returns 0 if there is no device or the
     // bus is shorted or otherwise held low for more than 250uS
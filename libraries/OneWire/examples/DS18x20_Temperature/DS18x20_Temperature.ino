@@ -8,6 +8,7 @@
 // https://github.com/milesburton/Arduino-Temperature-Control-Library
 
 OneWire  ds(GPIO1);  // on pin GPIO1 PIN 6 (a 4.7K resistor is necessary)
+// OneWire  ds(Serial1);  // or timed by the Serial1 UART: RX on the bus, TX to it through a diode
 
 void setup(void) {
   //Vext ON
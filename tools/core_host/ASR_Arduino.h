@@ -0,0 +1,14 @@
+/*
+ * ASR_Arduino.h
+ *
+ * Host stand-in, Wire.cpp takes the pins of its default buses from it.
+ */
+#ifndef ASR_ARDUINO_H
+#define ASR_ARDUINO_H
+
+#define SDA 1
+#define SCL 2
+#define SDA1 3
+#define SCL1 4
+
+#endif
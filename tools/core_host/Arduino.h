@@ -0,0 +1,69 @@
+/*
+ * Arduino.h
+ *
+ * Host stand-in for the core header. Print.cpp and WString.cpp only need
+ * the standard headers and the conversions of stdlib_noniso.h from it,
+ * softSerial.cpp also the pin and interrupt calls and SysTick, which the
+ * harness (softserial_sim.cpp) provides on its simulated clock.
+ */
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "stdlib_noniso.h"
+
+typedef enum {
+    INPUT,
+    OUTPUT,
+} PINMODE;
+
+typedef enum {
+    LOW = 0,
+    HIGH,
+} PINLEVEL;
+
+typedef enum {
+    NONE = 0,
+    RISING = 1,
+    FALLING = 2,
+    BOTH = 3,
+    CHANGE = 3
+} IrqModes;
+
+typedef void (*GpioIrqHandler)(void);
+
+typedef bool boolean;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pinMode(uint8_t pin_name, PINMODE mode);
+void digitalWrite(uint8_t pin_name, uint8_t level);
+void attachInterrupt(uint8_t pin_name, GpioIrqHandler GpioIrqHandlerCallback, IrqModes interrupt_mode);
+void detachInterrupt(uint8_t pin_name);
+uint32_t millis(void);
+uint32_t micros(void);
+
+// SysTick of the 48 MHz core, counting down
+uint32_t HostSysTickValue(void);
+extern uint32_t HostSysTickReload;
+
+#ifdef __cplusplus
+}
+#endif
+
+#define CY_SYS_SYST_CVR_REG HostSysTickValue()
+#define CY_SYS_SYST_RVR_REG HostSysTickReload
+
+// one thread stands in for the interrupts and the main loop
+#define noInterrupts()
+#define interrupts()
+
+#ifdef __cplusplus
+#include "Stream.h"
+#endif
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * HardwareSerial.h
+ *
+ * Host stand-in, Wire.cpp includes it without using it.
+ */
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#endif
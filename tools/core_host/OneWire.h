@@ -0,0 +1,12 @@
+/*
+ * OneWire.h
+ *
+ * Host stand-in, softSerial.cpp includes it only for the direct GPIO
+ * macros of util/OneWire_direct_gpio.h.
+ */
+#ifndef OneWire_h
+#define OneWire_h
+
+#include "util/OneWire_direct_gpio.h"
+
+#endif
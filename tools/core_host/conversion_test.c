@@ -0,0 +1,335 @@
+/*
+ * conversion_test.c
+ *
+ * Host test of the number conversions of stdlib_noniso.c: the division
+ * free decimal path (divu10, divu10_64, the /100 step, u32toa_dec),
+ * ulltoa_r in every base, ltoa, ultoa, dtoa_fixed, dtostrf and dtostrnf.
+ *
+ * The source is included so its static helpers can be called. Integers are
+ * checked against plain division. dtoa_fixed is checked against the exact
+ * value of the double, printed by the C library with all its fraction
+ * digits and rounded half up at prec here, for every prec from 0 to
+ * DTOA_FIXED_MAX_PREC; -0.0 prints without a sign and "ovf" is expected
+ * when the digits do not fit DTOA_FIXED_BUF_SIZE.
+ *
+ * By default random values and a strided sweep over all float bit patterns
+ * run, a few seconds. With "exhaustive" all 2^32 inputs of the 32 bit
+ * paths and every float are checked, about two hours on one core.
+ *
+ * usage: conversion_test [random cases] [exhaustive]
+ */
+#include "stdlib_noniso.c"
+
+#include <float.h>
+#include <stdio.h>
+
+static long Failures = 0;
+
+#define FAIL(...) \
+    do { \
+        if (Failures++ < 20) { \
+            printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+static uint64_t RandomState = 88172645463325252ull;
+
+static uint64_t Random(void)
+{
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 7;
+    RandomState ^= RandomState << 17;
+    return RandomState;
+}
+
+static void CheckU32(uint32_t x)
+{
+    char buf[12], ref[12];
+    char *end = buf + sizeof(buf);
+    char *digits;
+
+    if (divu10(x) != x / 10) {
+        FAIL("divu10(%u) = %u\n", x, divu10(x));
+    }
+    if (x < 43699 && ((x * 5243) >> 19) != x / 100) {
+        FAIL("(%u * 5243) >> 19 = %u\n", x, (x * 5243) >> 19);
+    }
+    digits = u32toa_dec(x, end);
+    snprintf(ref, sizeof(ref), "%u", x);
+    if ((size_t)(end - digits) != strlen(ref) || memcmp(digits, ref, end - digits) != 0) {
+        FAIL("u32toa_dec(%u) = %.*s\n", x, (int)(end - digits), digits);
+    }
+}
+
+static void CheckU64(uint64_t v, int base, bool upper)
+{
+    const char *set = upper ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" : "0123456789abcdefghijklmnopqrstuvwxyz";
+    char buf[65], ref[65];
+    char *end = buf + sizeof(buf);
+    char *digits = ulltoa_r(v, end, base, upper);
+    int n = sizeof(ref);
+    uint64_t w = v;
+
+    if (divu10_64(v) != v / 10) {
+        FAIL("divu10_64(%llu)\n", (unsigned long long)v);
+    }
+    do {
+        ref[--n] = set[w % base];
+        w /= base;
+    } while (w);
+    if (end - digits != (int)sizeof(ref) - n || memcmp(digits, ref + n, end - digits) != 0) {
+        FAIL("ulltoa_r(%llu, %d) = %.*s\n", (unsigned long long)v, base, (int)(end - digits), digits);
+    }
+}
+
+static void CheckLong(long v, int base)
+{
+    char out[80], ref[80];
+    unsigned long u = (v < 0) ? 0ul - (unsigned long)v : (unsigned long)v;
+    char *r = ref + sizeof(ref);
+    bool neg = v < 0;
+
+    *--r = '\0';
+    do {
+        *--r = "0123456789abcdefghijklmnopqrstuvwxyz"[u % base];
+        u /= base;
+    } while (u);
+    if (neg) {
+        *--r = '-';
+    }
+    ltoa(v, out, base);
+    if (strcmp(out, r) != 0) {
+        FAIL("ltoa(%ld, %d) = %s, expected %s\n", v, base, out, r);
+    }
+
+    u = (unsigned long)v;
+    r = ref + sizeof(ref);
+    *--r = '\0';
+    do {
+        *--r = "0123456789abcdefghijklmnopqrstuvwxyz"[u % base];
+        u /= base;
+    } while (u);
+    ultoa((unsigned long)v, out, base);
+    if (strcmp(out, r) != 0) {
+        FAIL("ultoa(%lu, %d) = %s, expected %s\n", (unsigned long)v, base, out, r);
+    }
+}
+
+/*
+ * Exact value of d rounded half up to prec fraction digits. The C library
+ * prints every fraction digit of a double when asked for as many as it has
+ * fraction bits.
+ */
+static void Reference(double d, int prec, char *out, size_t size)
+{
+    static char exact[1500];
+    uint64_t bits;
+    int exponent, k, point, len;
+
+    memcpy(&bits, &d, sizeof(bits));
+    exponent = (int)((bits >> 52) & 0x7FF);
+    k = exponent ? 1075 - exponent : 1074;
+    if (k < 0) {
+        k = 0;
+    }
+    len = snprintf(exact, sizeof(exact), "%.*f", k > prec ? k : prec, d);
+    if (d == 0.0 && exact[0] == '-') {
+        memmove(exact, exact + 1, len--);
+    }
+    point = strchr(exact, '.') ? (int)(strchr(exact, '.') - exact) : len;
+    len = prec ? point + 1 + prec : point;
+    if (point + 1 + prec < (int)strlen(exact) && exact[point + 1 + prec] >= '5') {
+        int i;
+        for (i = len - 1;; i--) {
+            if (i < 0 || exact[i] == '-') {
+                // 9.99 -> 10.00, one more digit in front
+                memmove(exact + i + 2, exact + i + 1, len - i - 1);
+                exact[i + 1] = '1';
+                len++;
+                break;
+            }
+            if (exact[i] == '.') {
+                continue;
+            }
+            if (exact[i] != '9') {
+                exact[i]++;
+                break;
+            }
+            exact[i] = '0';
+        }
+    }
+    exact[len] = '\0';
+    if (len > DTOA_FIXED_BUF_SIZE - 1) {
+        snprintf(out, size, "%sovf", d < 0 ? "-" : "");
+    } else {
+        snprintf(out, size, "%s", exact);
+    }
+}
+
+static void CheckDouble(double d, int prec)
+{
+    char out[DTOA_FIXED_BUF_SIZE + 8], ref[DTOA_FIXED_BUF_SIZE + 8];
+    int len;
+
+    memset(out, '#', sizeof(out));
+    len = dtoa_fixed(d, prec, out);
+    if (isnan(d)) {
+        snprintf(ref, sizeof(ref), "nan");
+    } else if (isinf(d)) {
+        snprintf(ref, sizeof(ref), "%sinf", d < 0 ? "-" : "");
+    } else {
+        Reference(d, prec, ref, sizeof(ref));
+    }
+    if (strcmp(out, ref) != 0 || len != (int)strlen(out)) {
+        FAIL("dtoa_fixed(%.17g, %d) = %s %d, expected %s\n", d, prec, out, len, ref);
+    }
+}
+
+static double RandomDouble(void)
+{
+    uint64_t bits;
+    double d;
+
+    switch (Random() % 5) {
+    case 0:
+        return (double)(int32_t)Random() / (double)(1 + Random() % 100000);
+    case 1:
+        // decimals, ties of the decimal point are no ties in binary
+        return ((int64_t)(Random() % 2000001) - 1000000) / 1000.0;
+    case 2:
+        // binary fractions, every one a tie at some prec
+        return (double)(int64_t)(Random() >> 20) / (double)(1ull << (Random() % 40));
+    case 3:
+        return ldexp((double)(Random() >> 11), (int)(Random() % 140) - 120);
+    default:
+        do {
+            bits = Random();
+            memcpy(&d, &bits, sizeof(d));
+        } while (isnan(d));
+        return d;
+    }
+}
+
+static void TestStrings(void)
+{
+    char s[400], ref[400];
+
+    dtostrf(123.456, 10, 2, s);
+    if (strcmp(s, "    123.46") != 0) {
+        FAIL("dtostrf width: [%s]\n", s);
+    }
+    dtostrf(-1.5, 0, 22, s);
+    if (strcmp(s, "-1.5000000000000000000000") != 0) {
+        FAIL("dtostrf zeros past DTOA_FIXED_MAX_PREC: [%s]\n", s);
+    }
+    dtostrf(DBL_MAX, 0, 1, s);
+    snprintf(ref, sizeof(ref), "%.1f", DBL_MAX);
+    if (strcmp(s, ref) != 0) {
+        FAIL("dtostrf(DBL_MAX) = %s\n", s);
+    }
+    dtostrnf(-FLT_MAX, 0, 30, s, DTOA_FIXED_BUF_SIZE);
+    snprintf(ref, sizeof(ref), "%.19f", -FLT_MAX);
+    if (strcmp(s, ref) != 0) {
+        FAIL("dtostrnf(-FLT_MAX) = %s\n", s);
+    }
+    dtostrnf(1e300, 0, 2, s, DTOA_FIXED_BUF_SIZE);
+    if (strcmp(s, "ovf") != 0) {
+        FAIL("dtostrnf(1e300) = %s\n", s);
+    }
+    dtostrnf(3.25, 8, 1, s, 6);
+    if (strcmp(s, "  3.3") != 0) {
+        FAIL("dtostrnf(3.25) into 6 bytes = [%s]\n", s);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long cases = argc > 1 ? strtol(argv[1], NULL, 0) : 1000000;
+    bool exhaustive = argc > 2 && strcmp(argv[2], "exhaustive") == 0;
+    uint64_t stride = exhaustive ? 1 : 2039;
+    long i;
+
+    // 32 bit paths
+    if (exhaustive) {
+        uint64_t x;
+        for (x = 0; x <= 0xFFFFFFFFull; x++) {
+            CheckU32((uint32_t)x);
+        }
+    } else {
+        uint32_t p;
+        for (p = 1; p <= 1000000000u; p *= 10) {
+            CheckU32(p - 1);
+            CheckU32(p);
+            CheckU32(p + 1);
+        }
+        CheckU32(43698);
+        CheckU32(43699);
+        CheckU32(0xFFFFFFFFu);
+        for (i = 0; i < cases * 10; i++) {
+            CheckU32((uint32_t)Random());
+        }
+    }
+    printf("conversion: 32 bit decimal (%s) %s\n", exhaustive ? "all 2^32" : "random",
+           Failures ? "FAILED" : "ok");
+
+    // 64 bit, every base
+    {
+        uint64_t v;
+        int d;
+        for (v = 1; v && v < 0xFFFFFFFFFFFFFFFFull / 3; v *= 3) {
+            for (d = -2; d <= 2; d++) {
+                CheckU64(v + d, 10, false);
+            }
+        }
+        CheckU64(0, 10, false);
+        CheckU64(0xFFFFFFFFFFFFFFFFull, 10, false);
+        for (i = 0; i < cases; i++) {
+            v = Random() >> (Random() % 64);
+            CheckU64(v, 2 + Random() % 35, i & 1);
+            CheckLong((long)(int32_t)Random(), 2 + Random() % 35);
+            CheckLong((long)v, (i & 1) ? 10 : 16);
+        }
+        CheckLong(LONG_MIN, 10);
+        CheckLong(LONG_MIN, 2);
+        CheckLong(INT_MIN, 10);
+        CheckLong(0, 10);
+    }
+    printf("conversion: 64 bit, bases 2..36 %s\n", Failures ? "FAILED" : "ok");
+
+    // doubles, every precision
+    {
+        double special[] = { 0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.999999999, 9.5, 99.995, 1e-320, DBL_MIN,
+                             4294967295.5, 18446744073709549568.0, 18446744073709551616.0, 1e30, FLT_MAX,
+                             1e100, DBL_MAX, INFINITY, -INFINITY, NAN };
+        unsigned j;
+        int prec;
+        for (j = 0; j < sizeof(special) / sizeof(special[0]); j++) {
+            for (prec = 0; prec <= DTOA_FIXED_MAX_PREC; prec++) {
+                CheckDouble(special[j], prec);
+                CheckDouble(-special[j], prec);
+            }
+        }
+        for (i = 0; i < cases; i++) {
+            CheckDouble(RandomDouble(), Random() % (DTOA_FIXED_MAX_PREC + 1));
+        }
+    }
+    printf("conversion: %ld random doubles %s\n", cases, Failures ? "FAILED" : "ok");
+
+    // floats, what Print and String take
+    {
+        uint64_t b;
+        for (b = 0; b <= 0xFFFFFFFFull; b += stride) {
+            uint32_t u = (uint32_t)b;
+            float f;
+            memcpy(&f, &u, sizeof(f));
+            if (!isnan(f)) {
+                CheckDouble(f, b % (DTOA_FIXED_MAX_PREC + 1));
+            }
+        }
+    }
+    printf("conversion: floats (%s) %s\n", exhaustive ? "all 2^32" : "every 2039th", Failures ? "FAILED" : "ok");
+
+    TestStrings();
+    printf("conversion: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env python
+
+# Host builds of core code: every harness in this directory is compiled with
+# the system gcc/g++ against the core sources it exercises, unmodified, and
+# run as a program of its own. A harness prints its results and exits with a
+# nonzero status when a check failed. It is rebuilt when a source, or a
+# header next to it, is newer than the executable.
+#
+# This directory comes first on the include path, its headers stand in for
+# the hardware ones (project.h, uart_port.h, Arduino.h, ASR_Arduino.h,
+# HardwareSerial.h, OneWire.h).
+#
+# Used by core_test.py.
+
+from __future__ import print_function
+
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, '..', '..'))
+CORES = os.path.join(ROOT, 'cores', 'asr650x', 'cores')
+
+
+def build(name, sources, includes=(), defines=(), flags=(), depends=(), cc=None):
+    """Builds the harness if a source changed, returns the executable.
+    depends lists further files it is built from, e.g. an included .c."""
+    output = os.path.join(HERE, 'build', name)
+    cxx = any(s.endswith('.cpp') for s in sources)
+    cc = cc or ('g++' if cxx else 'gcc')
+    includes = [HERE] + list(includes)
+    headers = [os.path.join(d, f) for d in includes for f in os.listdir(d) if f.endswith('.h')]
+    if os.path.exists(output):
+        built = os.path.getmtime(output)
+        if all(os.path.getmtime(f) <= built for f in list(sources) + list(depends) + headers):
+            return output
+    if not os.path.isdir(os.path.dirname(output)):
+        os.makedirs(os.path.dirname(output))
+    cmd = [cc, '-O2', '-g', '-Wall', '-o', output] + list(flags)
+    cmd += ['-D' + d for d in defines] + ['-I' + i for i in includes]
+    for source in sources:
+        cmd += ['-x', 'c' if source.endswith('.c') else 'c++', source]
+    cmd += ['-x', 'none', '-lm', '-pthread']
+    try:
+        subprocess.check_call(cmd)
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('%s: %s' % (cc, e))
+    return output
+
+
+def run(executable, args=()):
+    """Runs a harness, its output goes to ours. Returns the exit status."""
+    sys.stdout.flush()
+    return subprocess.call([executable] + [str(a) for a in args])
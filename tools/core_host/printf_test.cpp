@@ -0,0 +1,325 @@
+/*
+ * printf_test.cpp
+ *
+ * Host test of the single pass formatter of port/printf.c (tiny_format and
+ * the __wrap_printf, __wrap_sprintf, __wrap_snprintf wrappers) and of
+ * Print::printf on top of it.
+ *
+ * Equivalence: output and return value are compared with the C library's
+ * snprintf over a table of flag, width, precision and length combinations,
+ * then over random integers and doubles. %f goes through dtoa_fixed, which
+ * rounds a half way value up as Print always did and prints -0.0 without a
+ * sign; those cases are checked against their own strings, the random
+ * doubles stay clear of half way points. Its digits are tested by the
+ * conversion test. Print::printf must write the same bytes through
+ * write(), in chunks.
+ *
+ * Stack: the peak stack of a call is measured by running it on a painted
+ * stack of its own. These are host (x86-64) figures, they compare the
+ * formatter with the C library's and catch growth, the Cortex-M0+ frames
+ * are smaller.
+ *
+ * Throughput: a telemetry style line formatted over and over, next to the
+ * C library's snprintf.
+ *
+ * usage: printf_test [random cases] [benchmark lines]
+ */
+#include "Print.h"
+#include "printf_port.h"
+#include "stdlib_noniso.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include <string>
+
+extern "C" {
+int __wrap_printf(const char *format, ...);
+int __wrap_sprintf(char *out, const char *format, ...);
+int __wrap_snprintf(char *buf, unsigned int count, const char *format, ...);
+}
+
+static int Failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            Failures++; \
+        } \
+    } while (0)
+
+// Same output and return value as snprintf, both into a painted buffer
+#define SAME(...) \
+    do { \
+        char ours[256], ref[256]; \
+        memset(ours, '#', sizeof(ours)); \
+        memset(ref, '#', sizeof(ref)); \
+        int r1 = __wrap_snprintf(ours, sizeof(ours), __VA_ARGS__); \
+        int r2 = snprintf(ref, sizeof(ref), __VA_ARGS__); \
+        if (r1 != r2 || strcmp(ours, ref) != 0) { \
+            if (Failures++ < 40) { \
+                printf("%s:%d: %s: \"%s\" %d, expected \"%s\" %d\n", __FILE__, __LINE__, #__VA_ARGS__, \
+                       ours, r1, ref, r2); \
+            } \
+        } \
+    } while (0)
+
+static std::string Console;
+
+extern "C" void UART_1_UartPutChar(char c)
+{
+    Console += c;
+}
+
+class StringPrint : public Print
+{
+public:
+    std::string Out;
+    size_t Writes = 0;
+
+    size_t write(uint8_t c) override
+    {
+        Out += (char)c;
+        Writes++;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        Out.append((const char *)buffer, size);
+        Writes++;
+        return size;
+    }
+};
+
+static void TestTable(void)
+{
+    SAME("hello");
+    SAME("%d|%d|%d|%d", 0, -1, 2147483647, (int)0x80000000);
+    SAME("%5d|%-5d|%05d", 42, 42, 42);
+    SAME("%+d % d %+d", 5, 5, -5);
+    SAME("%.3d|%8.3d|%-8.3d|%08.3d", 7, 7, -7, 7);
+    SAME("%.0d|%5.0d|", 0, 0);
+    SAME("%x %X %#x %#X %#o %o %#o", 255, 255, 255, 255, 8, 8, 0);
+    SAME("%lu %ld %lx", 4294967295ul, -5l, 0xdeadbeeful);
+    SAME("%llu %lld %llx", 18446744073709551615ull, -9223372036854775807ll - 1, 0x123456789abcdefull);
+    SAME("%hhd %hhu %hd %hu", 300, 300, 70000, 70000);
+    SAME("%zu %zd %jd %td", (size_t)123, (ptrdiff_t)-4, (intmax_t)-99, (ptrdiff_t)77);
+    SAME("%s|%10s|%-10s|%.2s|%10.2s|%*s|%-*s|%.*s", "abc", "abc", "abc", "abc", "abc", 6, "x", 6, "y", 1, "zz");
+    SAME("%c|%3c|%-3c|", 'a', 'b', 'c');
+    SAME("%%|%i", 12);
+    SAME("%*d|%*d", -4, 1, 4, 2);
+    SAME("%.*d", -1, 5);
+    SAME("%p", (void *)0x1234);
+    SAME("%20p|%-20p|", (void *)0xabcd, (void *)0xabcd);
+    SAME("%#.0o %#5x %#05x %#-8x|", 0, 1, 1, 1);
+    SAME("%#08x|%-08d|", 0x2a, 3);
+    SAME("%f|%.2f|%10.3f|%-10.1f|%010.2f|%+.1f|% .0f|%.0f", 3.14159, -2.005, 1.5, 2.75, -3.75, 1.0, 2.4, 0.4);
+    SAME("%F|%.12f|%.19f|%08.3f", 1e10, 1.0 / 3, 0.25, -1.5);
+    SAME("%5.1f|%-8f|%f|%f|%+.2f", INFINITY, -INFINITY, 1e18, 1e30, -0.001);
+    SAME("%5.1f|%05f|%-6f|", NAN, INFINITY, -INFINITY);
+}
+
+static void TestFloatRounding(void)
+{
+    char s[32];
+
+    // Half way up, the C library goes to even
+    __wrap_snprintf(s, sizeof(s), "%.1f|%.0f|%.0f|%.0f|%.2f", 2.25, 0.5, 1.5, 2.5, 1.125);
+    CHECK(strcmp(s, "2.3|1|2|3|1.13") == 0);
+    __wrap_snprintf(s, sizeof(s), "%f|%+.1f", -0.0, -0.0);
+    CHECK(strcmp(s, "0.000000|+0.0") == 0);
+}
+
+static void TestLimits(void)
+{
+    char s[32];
+    int n = 0;
+
+    // Truncated, the return value is the full length
+    CHECK(__wrap_snprintf(s, 4, "%d", 123456) == 6 && strcmp(s, "123") == 0);
+    // Count 0 writes nothing
+    s[0] = 'x';
+    CHECK(__wrap_snprintf(s, 0, "abc") == 3 && s[0] == 'x');
+    CHECK(__wrap_snprintf(s, 1, "abc") == 3 && s[0] == '\0');
+    __wrap_snprintf(s, sizeof(s), "ab%ncd", &n);
+    CHECK(n == 2);
+    CHECK(__wrap_sprintf(s, "%s-%u", "id", 42u) == 5 && strcmp(s, "id-42") == 0);
+
+    Console.clear();
+    CHECK(__wrap_printf("rssi %d dBm\n", -117) == 14);
+    CHECK(Console == "rssi -117 dBm\n");
+
+    // Beyond DTOA_FIXED_MAX_PREC the fraction goes on in zeros
+    CHECK(__wrap_snprintf(s, sizeof(s), "%.22f", 0.5) == 24 && strcmp(s, "0.5000000000000000000000") == 0);
+}
+
+static uint64_t Random64(void)
+{
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+static bool HalfWay(double d, int prec)
+{
+    double scaled = fabs(d) * pow(10, prec);
+
+    return fabs(scaled - floor(scaled) - 0.5) < 1e-6;
+}
+
+static void TestRandom(long cases)
+{
+    for (long i = 0; i < cases; i++) {
+        long long v = (long long)(Random64() >> (rand() % 64));
+        int width = rand() % 25, prec = rand() % 25;
+
+        if (rand() & 1) {
+            v = -v;
+        }
+        SAME("%*.*lld", width, prec, v);
+        SAME("%-*llx|%#*llo", width, (unsigned long long)v, width, (unsigned long long)v);
+        SAME("%0*d|%+hd|%hhx", width, (int)v, (short)v, (unsigned char)v);
+
+        double d = (rand() / (double)RAND_MAX - 0.5) * pow(10, rand() % 20 - 10);
+        prec = rand() % 8;
+        if (!HalfWay(d, prec)) {
+            SAME("%.*f|% *f|%+0*.*f", prec, d, width, d, width, prec, d);
+        }
+        d = (float)d;
+        if (!HalfWay(d, prec)) {
+            SAME("%-*.*f|", width, prec, d);
+        }
+    }
+}
+
+static void TestPrint(void)
+{
+    std::string big(300, 'x');
+    const char *formats[] = { "", "short", "%s|%d|%08lx|%-40s|" };
+    char ref[512];
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        StringPrint p;
+        size_t n = p.printf(formats[i], big.c_str(), -12345, 0xbeefUL, "left");
+        int len = snprintf(ref, sizeof(ref), formats[i], big.c_str(), -12345, 0xbeefUL, "left");
+
+        CHECK(p.Out == ref && n == (size_t)len);
+        // whole chunks of 32, no byte by byte write()
+        CHECK(p.Writes == (size_t)(len + 31) / 32);
+    }
+}
+
+static ucontext_t Caller, Callee;
+static uint8_t Stack[64 * 1024];
+static void (*Measured)(void);
+
+static void Trampoline(void)
+{
+    Measured();
+}
+
+// Deepest stack use of fn, with the context switch's own share
+static size_t StackPeak(void (*fn)(void))
+{
+    size_t unused = 0;
+
+    memset(Stack, 0xA5, sizeof(Stack));
+    Measured = fn;
+    getcontext(&Callee);
+    Callee.uc_stack.ss_sp = Stack;
+    Callee.uc_stack.ss_size = sizeof(Stack);
+    Callee.uc_link = &Caller;
+    makecontext(&Callee, Trampoline, 0);
+    swapcontext(&Caller, &Callee);
+    while (unused < sizeof(Stack) && Stack[unused] == 0xA5) {
+        unused++;
+    }
+    return sizeof(Stack) - unused;
+}
+
+static char Line[128];
+
+static void Empty(void)
+{
+}
+
+static void OursInt(void)
+{
+    __wrap_snprintf(Line, sizeof(Line), "%d %08lx %-10s %llu", -5, 0xbeefUL, "abc", 1ull << 63);
+}
+
+static void OursFloat(void)
+{
+    __wrap_snprintf(Line, sizeof(Line), "%.2f %12.6f", 3.14159, -1e30);
+}
+
+static void LibcInt(void)
+{
+    snprintf(Line, sizeof(Line), "%d %08lx %-10s %llu", -5, 0xbeefUL, "abc", 1ull << 63);
+}
+
+static void LibcFloat(void)
+{
+    snprintf(Line, sizeof(Line), "%.2f %12.6f", 3.14159, -1e30);
+}
+
+static void PrintInt(void)
+{
+    StringPrint p;
+    p.printf("%d %08lx %-10s %llu", -5, 0xbeefUL, "abc", 1ull << 63);
+}
+
+static void Stacks(void)
+{
+    size_t base = StackPeak(Empty);
+
+    printf("printf: peak stack [B] snprintf %%d %zu %%f %zu, Print::printf %%d %zu, C library %%d %zu %%f %zu\n",
+           StackPeak(OursInt) - base, StackPeak(OursFloat) - base, StackPeak(PrintInt) - base,
+           StackPeak(LibcInt) - base, StackPeak(LibcFloat) - base);
+}
+
+// Telemetry style line of the throughput benchmark
+#define BENCH_LINE(format, i) \
+    format(Line, sizeof(Line), "T=%ld.%02lu rssi=%ld snr=%ld id=%08lx %s", i, i % 100, -i % 120, i % 13, \
+           (unsigned long)i * 2654435761u, "ok")
+
+static double Throughput(long lines, bool ours)
+{
+    volatile int sink = 0;
+    long bytes = 0;
+    clock_t start = clock();
+
+    for (long i = 0; i < lines; i++) {
+        bytes += ours ? BENCH_LINE(__wrap_snprintf, i) : BENCH_LINE(snprintf, i);
+        sink += Line[3];
+    }
+    return bytes / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    long cases = argc > 1 ? strtol(argv[1], NULL, 0) : 200000;
+    long lines = argc > 2 ? strtol(argv[2], NULL, 0) : 1000000;
+
+    srand(1);
+    TestTable();
+    TestFloatRounding();
+    TestLimits();
+    TestRandom(cases);
+    TestPrint();
+    printf("printf: %ld random cases, equivalence %s\n", cases, Failures ? "FAILED" : "ok");
+
+    Stacks();
+    double ours = Throughput(lines, true);
+    double libc = Throughput(lines, false);
+    printf("printf: snprintf %.1f MB/s, C library snprintf %.1f MB/s\n", ours, libc);
+    printf("printf: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
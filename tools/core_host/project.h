@@ -0,0 +1,113 @@
+/*
+ * project.h
+ *
+ * Host stand-in for the PSoC Creator project header. Most core sources
+ * built here need nothing from it, Wire.cpp needs the SCB I2C master API of
+ * both I2C components and a few CyLib calls. Those are declared here with
+ * the component's values and implemented by the harness (wire_sim.cpp) on
+ * a simulated bus.
+ */
+#ifndef __PROJECT_H__
+#define __PROJECT_H__
+
+#include <stdint.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef void (*cyisraddress)(void);
+
+#define CYDEV_BCLK__HFCLK__HZ 48000000u
+
+#define I2C_ISR_NUMBER 9u
+#define I2C_1_ISR_NUMBER 10u
+
+// I2C_I2C.h, shared by I2C_1
+#define I2C_I2C_MODE_COMPLETE_XFER (0x00u)
+#define I2C_I2C_MODE_REPEAT_START (0x01u)
+#define I2C_I2C_MODE_NO_STOP (0x02u)
+
+#define I2C_I2C_MSTAT_RD_CMPLT ((uint16)0x01u)
+#define I2C_I2C_MSTAT_WR_CMPLT ((uint16)0x02u)
+#define I2C_I2C_MSTAT_XFER_INP ((uint16)0x04u)
+#define I2C_I2C_MSTAT_XFER_HALT ((uint16)0x08u)
+#define I2C_I2C_MSTAT_ERR_MASK ((uint16)0x3F0u)
+#define I2C_I2C_MSTAT_ERR_SHORT_XFER ((uint16)0x10u)
+#define I2C_I2C_MSTAT_ERR_ADDR_NAK ((uint16)0x20u)
+#define I2C_I2C_MSTAT_ERR_XFER ((uint16)0x200u)
+
+#define I2C_I2C_MSTR_NO_ERROR (0x00u)
+#define I2C_I2C_MSTR_NOT_READY (0x04u)
+#define I2C_I2C_MSTR_BUS_BUSY (0x08u)
+
+#define I2C_RX_FIFO_CTRL_CLEAR (0x10000u)
+#define I2C_TX_FIFO_CTRL_CLEAR (0x10000u)
+#define I2C_1_RX_FIFO_CTRL_CLEAR (0x10000u)
+#define I2C_1_TX_FIFO_CTRL_CLEAR (0x10000u)
+#define SPI_1_SPI_OVS_FACTOR (16u)
+#define SPI_2_SPI_OVS_FACTOR (16u)
+
+// registers Wire.cpp writes, the harness only keeps them
+enum {
+    HOST_I2C_SCBCLK_DIV,
+    HOST_I2C_1_SCBCLK_DIV,
+    HOST_SPI_1_SCBCLK_DIV,
+    HOST_SPI_2_SCBCLK_DIV,
+    HOST_I2C_RX_FIFO_CTRL,
+    HOST_I2C_TX_FIFO_CTRL,
+    HOST_I2C_1_RX_FIFO_CTRL,
+    HOST_I2C_1_TX_FIFO_CTRL,
+    HOST_SCB_REGS
+};
+
+#define I2C_SCBCLK_DIV_REG HostScbReg[HOST_I2C_SCBCLK_DIV]
+#define I2C_1_SCBCLK_DIV_REG HostScbReg[HOST_I2C_1_SCBCLK_DIV]
+#define SPI_1_SCBCLK_DIV_REG HostScbReg[HOST_SPI_1_SCBCLK_DIV]
+#define SPI_2_SCBCLK_DIV_REG HostScbReg[HOST_SPI_2_SCBCLK_DIV]
+#define I2C_RX_FIFO_CTRL_REG HostScbReg[HOST_I2C_RX_FIFO_CTRL]
+#define I2C_TX_FIFO_CTRL_REG HostScbReg[HOST_I2C_TX_FIFO_CTRL]
+#define I2C_1_RX_FIFO_CTRL_REG HostScbReg[HOST_I2C_1_RX_FIFO_CTRL]
+#define I2C_1_TX_FIFO_CTRL_REG HostScbReg[HOST_I2C_1_TX_FIFO_CTRL]
+
+// pending bits of the interrupt controller, on the simulated clock
+#define CY_INT_SET_PEND_REG HostIntPending()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint32 HostScbReg[HOST_SCB_REGS];
+uint32 HostIntPending(void);
+
+void I2C_Start(void);
+void I2C_Stop(void);
+void I2C_I2C_ISR(void);
+uint32 I2C_I2CMasterWriteBuf(uint32 slaveAddress, uint8 *wrData, uint32 cnt, uint32 mode);
+uint32 I2C_I2CMasterReadBuf(uint32 slaveAddress, uint8 *rdData, uint32 cnt, uint32 mode);
+uint32 I2C_I2CMasterStatus(void);
+uint32 I2C_I2CMasterClearStatus(void);
+void I2C_I2CMasterClearReadBuf(void);
+void I2C_I2CMasterClearWriteBuf(void);
+
+void I2C_1_Start(void);
+void I2C_1_Stop(void);
+void I2C_1_I2C_ISR(void);
+uint32 I2C_1_I2CMasterWriteBuf(uint32 slaveAddress, uint8 *wrData, uint32 cnt, uint32 mode);
+uint32 I2C_1_I2CMasterReadBuf(uint32 slaveAddress, uint8 *rdData, uint32 cnt, uint32 mode);
+uint32 I2C_1_I2CMasterStatus(void);
+uint32 I2C_1_I2CMasterClearStatus(void);
+void I2C_1_I2CMasterClearReadBuf(void);
+void I2C_1_I2CMasterClearWriteBuf(void);
+
+cyisraddress CyIntSetVector(uint8 number, cyisraddress address);
+void CyIntClearPending(uint8 number);
+uint8 CyEnterCriticalSection(void);
+void CyExitCriticalSection(uint8 savedIntrStatus);
+void CySysPmSleep(void);
+uint32_t __get_IPSR(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
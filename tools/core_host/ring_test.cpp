@@ -0,0 +1,207 @@
+/*
+ * ring_test.cpp
+ *
+ * Host test of RingBuffer.h, the SPSC ring behind HardwareSerial.
+ *
+ * The single threaded checks cover the element and span interfaces, the
+ * wrap of the spans at the end of the storage and a full ring dropping new
+ * elements. Then a producer and a consumer thread stream a counter through
+ * one ring, the consumer checks every element arrives once and in order,
+ * and the throughput is printed: element by element (write/read(), as
+ * Serial.read() takes them) and span to span (writeSpan/commit as the UART
+ * interrupt fills the ring, readSpan/consume under readBytes()).
+ *
+ * The host threads stand in for the interrupt and the main loop, on a
+ * multicore host they run truly in parallel so a missing barrier shows up
+ * as a lost or repeated element.
+ *
+ * usage: ring_test [bytes per stream]
+ */
+#include "RingBuffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+static int Failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            Failures++; \
+        } \
+    } while (0)
+
+typedef RingBuffer<uint8_t, 256> Ring;
+
+static void TestElements(void)
+{
+    Ring r;
+
+    CHECK(r.empty() && !r.full() && r.size() == 0 && r.capacity() == 256);
+    CHECK(r.read() == 0 && r.peek() == 0);
+    for (int i = 0; i < 256; i++) {
+        CHECK(r.write((uint8_t)i));
+    }
+    CHECK(r.full() && r.size() == 256);
+    CHECK(!r.write(0xAA));
+    CHECK(r.peek() == 0 && r[255] == 255);
+    for (int i = 0; i < 256; i++) {
+        CHECK(r.read() == (uint8_t)i);
+    }
+    CHECK(r.empty());
+
+    r.write(1);
+    r.write(2);
+    r.reset();
+    CHECK(r.empty() && r.size() == 0);
+}
+
+static void TestSpans(void)
+{
+    Ring r;
+    uint8_t in[300], out[300];
+    uint8_t *w;
+    const uint8_t *rd;
+
+    for (int i = 0; i < 300; i++) {
+        in[i] = (uint8_t)(i * 7);
+    }
+    // Every length at every start offset, so the copies wrap everywhere
+    for (int k = 0; k < 2000; k++) {
+        size_t want = k % 301;
+        size_t n = r.write(in, want);
+        CHECK(n == (want < 256 ? want : 256));
+        size_t m = r.read(out, sizeof(out));
+        CHECK(m == n);
+        for (size_t i = 0; i < m; i++) {
+            CHECK(out[i] == in[i]);
+        }
+        r.write(in, k % 13);
+        r.read(out, k % 13);
+    }
+
+    // A span stops at the end of the storage, the rest comes after commit()
+    Ring s;
+    s.write(in, 200);
+    s.read(out, 200);
+    CHECK(s.writeSpan(w) == 56);
+    s.commit(56);
+    CHECK(s.writeSpan(w) == 200);
+    s.commit(100);
+    CHECK(s.size() == 156);
+    CHECK(s.readSpan(rd) == 56);
+    s.consume(56);
+    CHECK(s.readSpan(rd) == 100);
+    s.consume(100);
+    CHECK(s.empty() && s.readSpan(rd) == 0);
+
+    // Full ring: no free span, partial bulk write
+    CHECK(s.write(in, 256) == 256 && s.writeSpan(w) == 0 && s.write(in, 10) == 0);
+
+    RingBuffer<uint16_t, 8> wide;
+    uint16_t words[8] = { 0, 1000, 2000, 3000, 4000, 5000, 6000, 65535 };
+    uint16_t back[8];
+    wide.write(words, 5);
+    wide.read(back, 3);
+    CHECK(wide.write(words, 8) == 6);
+    CHECK(wide.read(back, 8) == 8 && back[0] == 3000 && back[2] == 0 && back[7] == 5000);
+}
+
+static double Stream(size_t count, bool spans)
+{
+    Ring r;
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&] {
+        uint8_t value = 0;
+        size_t sent = 0;
+        while (sent < count) {
+            if (spans) {
+                uint8_t *region;
+                size_t n = r.writeSpan(region);
+                if (n > count - sent) {
+                    n = count - sent;
+                }
+                for (size_t i = 0; i < n; i++) {
+                    region[i] = value++;
+                }
+                if (n == 0) {
+                    std::this_thread::yield();
+                } else {
+                    r.commit(n);
+                }
+                sent += n;
+            } else if (r.write(value)) {
+                value++;
+                sent++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint8_t expected = 0;
+    size_t received = 0;
+    while (received < count && ok) {
+        if (spans) {
+            const uint8_t *region;
+            size_t n = r.readSpan(region);
+            if (n == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (region[i] != expected++) {
+                    printf("stream: wrong element at %zu\n", received + i);
+                    ok = false;
+                    break;
+                }
+            }
+            r.consume(n);
+            received += n;
+        } else if (!r.empty()) {
+            if (r.read() != expected++) {
+                printf("stream: wrong element at %zu\n", received);
+                ok = false;
+            }
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    if (!ok) {
+        // let the producer finish
+        while (received < count) {
+            const uint8_t *region;
+            size_t n = r.readSpan(region);
+            r.consume(n);
+            received += n;
+        }
+        Failures++;
+    }
+    producer.join();
+    CHECK(r.empty());
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count / seconds / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 0) : 50000000;
+
+    TestElements();
+    TestSpans();
+    printf("ring: unit checks %s\n", Failures ? "FAILED" : "ok");
+
+    double bytes = Stream(count, false);
+    double spans = Stream(count, true);
+    printf("ring: %zu bytes per stream, byte by byte %.1f MB/s, spans %.1f MB/s\n", count, bytes, spans);
+    printf("ring: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * softserial_sim.cpp
+ *
+ * Bit timing simulation of softSerial (libraries/Basics) on a simulated
+ * 48 MHz core.
+ *
+ * The harness owns the clock: SysTick counts down through a 1 ms period,
+ * micros() and millis() follow it, every SysTick or pin read takes a few
+ * cycles. The RX lines are 8N1 waveforms with a baud rate error, 5% edge
+ * jitter and random idle gaps between bytes. Each edge raises the pin
+ * interrupt, which is entered after a random latency once the CPU is free,
+ * latches intTime like the core does and calls the handler softSerial
+ * attached. Two ports at different rates receive at the same time and share
+ * the CPU with a main loop that drains them with available()/read() at
+ * random intervals of up to 4 ms. The bytes read must be the bytes sent,
+ * a run where they are not counts as failed.
+ *
+ * Every rate from 9600 to 57600 is run at -e, 0 and +e baud error. The
+ * transmitter is then timed on its own: the level written for every bit of
+ * 256 bytes against the ideal bit boundaries.
+ *
+ * Raise the latency or the error to find where the decoder gives up.
+ *
+ * usage: softserial_sim [seeds] [max latency us] [baud error %]
+ */
+#include "softSerial.h"
+#include "util/OneWire_direct_gpio.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#define TICKS_PER_US 48
+
+static int Failures = 0;
+
+/*
+ * Simulated core
+ */
+uint32_t HostSysTickReload = 1000 * TICKS_PER_US - 1;
+volatile uint32_t HostPinReg[HOST_PINS];
+uint32_t intTime;
+
+static uint64_t Now; // cycles since reset
+
+typedef struct {
+    std::vector<uint64_t> At;
+    std::vector<uint8_t> Level;
+} Wave_t;
+
+static Wave_t Waves[HOST_PINS];
+static GpioIrqHandler Handlers[HOST_PINS];
+static std::vector<uint64_t> TxWrites;
+static std::vector<uint8_t> TxLevels;
+
+extern "C" uint32_t HostSysTickValue(void)
+{
+    Now += 2;
+    return HostSysTickReload - (uint32_t)(Now % (HostSysTickReload + 1));
+}
+
+extern "C" uint32_t micros(void)
+{
+    return (uint32_t)(Now / TICKS_PER_US);
+}
+
+extern "C" uint32_t millis(void)
+{
+    return (uint32_t)(Now / (1000 * TICKS_PER_US));
+}
+
+extern "C" uint8_t HostPinRead(volatile uint32_t *base)
+{
+    const Wave_t &w = Waves[base - HostPinReg];
+
+    Now += 14;
+    size_t i = std::upper_bound(w.At.begin(), w.At.end(), Now) - w.At.begin();
+    return i == 0 ? 1 : w.Level[i - 1];
+}
+
+extern "C" void HostPinWrite(volatile uint32_t *base, uint8_t level)
+{
+    *base = level;
+    TxWrites.push_back(Now);
+    TxLevels.push_back(level);
+}
+
+extern "C" void pinMode(uint8_t pin_name, PINMODE mode)
+{
+}
+
+extern "C" void digitalWrite(uint8_t pin_name, uint8_t level)
+{
+}
+
+extern "C" void attachInterrupt(uint8_t pin_name, GpioIrqHandler GpioIrqHandlerCallback, IrqModes interrupt_mode)
+{
+    Handlers[pin_name] = GpioIrqHandlerCallback;
+}
+
+extern "C" void detachInterrupt(uint8_t pin_name)
+{
+    Handlers[pin_name] = NULL;
+}
+
+// Print.cpp pulls in the console printf
+extern "C" void UART_1_UartPutChar(char c)
+{
+}
+
+/*
+ * Receive
+ */
+#define RX_SECONDS 0.4
+
+typedef struct {
+    uint8_t Pin;
+    uint32_t Baud;
+    double Error;
+    softSerial *Port;
+    std::vector<uint8_t> Sent;
+    std::vector<uint8_t> Got;
+} Line_t;
+
+// 8N1 frames from start to end, a byte every 10 bits or after an idle gap
+static void MakeWave(Line_t &line, uint64_t start, uint64_t end, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> jitter(-0.05, 0.05);
+    std::uniform_int_distribution<int> gap(0, 6), value(0, 255);
+    Wave_t &w = Waves[line.Pin];
+    double bit = 1e6 * TICKS_PER_US / (line.Baud * (1 + line.Error));
+    double t = start;
+    uint8_t level = 1;
+
+    while (t < end) {
+        uint8_t data = value(rng);
+        uint16_t frame = (uint16_t)(data << 1) | 0x200;
+
+        line.Sent.push_back(data);
+        for (int i = 0; i < 10; i++) {
+            if (((frame >> i) & 1) != level) {
+                level ^= 1;
+                w.At.push_back((uint64_t)(t + (i + jitter(rng)) * bit));
+                w.Level.push_back(level);
+            }
+        }
+        int g = gap(rng);
+        t += 10 * bit + (g < 3 ? 0 : (g - 2) * bit * (g == 6 ? 40 : 1.3));
+    }
+}
+
+typedef struct {
+    uint8_t Pin;
+    uint64_t At;
+} Edge_t;
+
+static bool EdgeBefore(const Edge_t &a, const Edge_t &b)
+{
+    return a.At < b.At;
+}
+
+static void Receive(Line_t *lines, int seed, double latencyUs)
+{
+    std::mt19937 rng(seed * 7919 + lines[0].Baud);
+    std::uniform_int_distribution<uint64_t> latency(TICKS_PER_US * 8 / 10, (uint64_t)(latencyUs * TICKS_PER_US));
+    std::uniform_int_distribution<uint64_t> loop(0, 4000 * TICKS_PER_US);
+    std::vector<Edge_t> edges;
+    softSerial a(10, lines[0].Pin), b(11, lines[1].Pin);
+    uint64_t start = (12500 + seed * 377) * TICKS_PER_US;
+    uint64_t end = start + (uint64_t)(RX_SECONDS * 1e6 * TICKS_PER_US);
+
+    for (int i = 0; i < HOST_PINS; i++) {
+        Waves[i].At.clear();
+        Waves[i].Level.clear();
+    }
+    Now = 12300 * TICKS_PER_US;
+    lines[0].Port = &a;
+    lines[1].Port = &b;
+    a.begin(lines[0].Baud);
+    b.begin(lines[1].Baud);
+    for (int k = 0; k < 2; k++) {
+        lines[k].Sent.clear();
+        lines[k].Got.clear();
+        MakeWave(lines[k], start + k * 300 * TICKS_PER_US, end, rng);
+        for (uint64_t at : Waves[lines[k].Pin].At) {
+            edges.push_back({ lines[k].Pin, at });
+        }
+    }
+    std::sort(edges.begin(), edges.end(), EdgeBefore);
+
+    uint64_t cpuFree = 0, nextLoop = start + loop(rng);
+    // the main loop, interrupts wait for its noInterrupts() sections, 1 us a pass
+    auto runLoop = [&](uint64_t until) {
+        while (nextLoop < until) {
+            Now = std::max(nextLoop, cpuFree);
+            for (int k = 0; k < 2; k++) {
+                while (lines[k].Port->available()) {
+                    lines[k].Got.push_back((uint8_t)lines[k].Port->read());
+                }
+            }
+            cpuFree = Now + TICKS_PER_US;
+            nextLoop = Now + loop(rng);
+        }
+    };
+
+    for (size_t i = 0; i < edges.size();) {
+        bool pending[HOST_PINS] = { false };
+
+        // edges until the interrupt is entered only set the pending flag
+        uint64_t entry = std::max(edges[i].At + latency(rng), cpuFree);
+        for (; i < edges.size() && edges[i].At < entry; i++) {
+            pending[edges[i].Pin] = true;
+        }
+        runLoop(entry);
+        entry = std::max(entry, cpuFree);
+        for (int k = 0; k < 2; k++) {
+            if (pending[lines[k].Pin]) {
+                Now = entry;
+                intTime = HostSysTickValue();
+                Now += TICKS_PER_US / 2;
+                Handlers[lines[k].Pin]();
+                entry = Now + TICKS_PER_US * 3 / 2;
+            }
+        }
+        cpuFree = entry;
+    }
+    runLoop(end + 20000 * TICKS_PER_US);
+}
+
+/*
+ * Transmit
+ */
+static double Transmit(uint32_t baud)
+{
+    softSerial port(4, 5);
+    double bit = 1e6 * TICKS_PER_US / baud;
+    double worst = 0;
+
+    Now = 0;
+    port.begin(baud);
+    TxWrites.clear();
+    TxLevels.clear();
+    for (int c = 0; c < 256; c++) {
+        port.write((uint8_t)c);
+        Now += 5 * TICKS_PER_US;
+    }
+    port.end();
+
+    for (int c = 0; c < 256; c++) {
+        uint16_t frame = (uint16_t)(c << 1) | 0x200;
+        uint64_t first = TxWrites[c * 10];
+
+        for (int i = 0; i < 10; i++) {
+            double error = fabs((TxWrites[c * 10 + i] - first) - i * bit) / bit;
+            worst = std::max(worst, error);
+            if (TxLevels[c * 10 + i] != ((frame >> i) & 1)) {
+                printf("softserial: tx %u wrong level in bit %d of 0x%02x\n", baud, i, c);
+                Failures++;
+            }
+        }
+        if (c < 255 && (TxWrites[c * 10 + 10] - first) < 10 * bit) {
+            printf("softserial: tx %u stop bit of 0x%02x cut short\n", baud, c);
+            Failures++;
+        }
+    }
+    return worst;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t Bauds[] = { 9600, 14400, 19200, 38400, 57600 };
+    int seeds = argc > 1 ? atoi(argv[1]) : 4;
+    double latencyUs = argc > 2 ? atof(argv[2]) : 4;
+    double error = argc > 3 ? atof(argv[3]) / 100 : 0.02;
+
+    if (seeds < 1 || latencyUs < 1) {
+        printf("softserial: at least one seed and 1 us latency\n");
+        return 1;
+    }
+    printf("softserial: %d x %.1f s per rate and error, interrupt latency 0.8 to %.1f us\n", seeds, RX_SECONDS,
+           latencyUs);
+    printf("%6s %7s %9s %9s %6s %7s %9s %9s\n", "baud", "error", "bytes", "failed", "baud", "error", "bytes", "failed");
+    for (uint32_t baud : Bauds) {
+        for (int sign = -1; sign <= 1; sign++) {
+            // the second port runs at another rate and the opposite error
+            Line_t lines[2] = { { 2, baud, sign * error }, { 3, baud >= 38400 ? 9600u : 57600u, -sign * error } };
+            size_t bytes[2] = { 0, 0 };
+            int failed[2] = { 0, 0 };
+
+            for (int seed = 0; seed < seeds; seed++) {
+                Receive(lines, seed, latencyUs);
+                for (int k = 0; k < 2; k++) {
+                    bytes[k] += lines[k].Sent.size();
+                    failed[k] += lines[k].Got != lines[k].Sent;
+                }
+            }
+            printf("%6u %+6.1f%% %9zu %9d %6u %+6.1f%% %9zu %9d\n", lines[0].Baud, 100 * lines[0].Error, bytes[0],
+                   failed[0], lines[1].Baud, 100 * lines[1].Error, bytes[1], failed[1]);
+            if (failed[0] || failed[1]) {
+                Failures++;
+            }
+        }
+    }
+
+    for (uint32_t baud : Bauds) {
+        double worst = Transmit(baud);
+        printf("softserial: tx %5u worst bit edge %.2f%% of a bit off\n", baud, 100 * worst);
+        if (worst > 0.02) {
+            Failures++;
+        }
+    }
+    printf("softserial: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
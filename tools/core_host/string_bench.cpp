@@ -0,0 +1,294 @@
+/*
+ * string_bench.cpp
+ *
+ * Heap fragmentation benchmark of String (WString.cpp) on a simulated
+ * CubeCell heap.
+ *
+ * The harness is linked with --wrap=malloc,realloc,free like the firmware
+ * (see platform.txt), the wrappers hand out chunks of a CYDEV_HEAP_SIZE
+ * block the way newlib-nano does: first fit on an address ordered free
+ * list, 8 byte chunk headers, neighbours coalesced on free and realloc
+ * growing by malloc, copy and free. Only the core sources use the wrapped
+ * names, the C++ runtime keeps the host heap.
+ *
+ * The load is a GPS sketch: once a second six NMEA sentences are read
+ * char by char as readStringUntil() does, fields are cut out with
+ * indexOf()/substring() and a display line is put together. Meanwhile
+ * other code holds small blocks for up to ten minutes. It runs once with
+ * the heap only and once inside a StringArenaScope, and reports heap calls
+ * per second, failed allocations, the smallest largest free block and the
+ * fragmentation 1 - largest free / total free, sampled in the middle of
+ * every parse.
+ *
+ * It fails when a String ends up invalid, the display line is wrong or
+ * String memory is still in use at the end.
+ *
+ * usage: string_bench [seconds] [heap bytes] [arena bytes]
+ */
+#include "WString.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+void *__wrap_malloc(size_t size);
+void *__wrap_realloc(void *p, size_t size);
+void __wrap_free(void *p);
+}
+
+static int Failures = 0;
+
+/*
+ * Simulated heap
+ */
+typedef struct {
+    uint32_t Size; // chunk size, header included
+    uint32_t Used;
+} Chunk_t;
+
+#define HEAP_MAX 65536
+#define CHUNK_MIN 16
+
+static Chunk_t HeapBlock[HEAP_MAX / sizeof(Chunk_t)];
+static uint32_t HeapSize;
+static unsigned long HeapCalls, HeapFailures;
+
+#define HEAP_START HeapBlock
+#define HEAP_END ((Chunk_t *)((uint8_t *)HeapBlock + HeapSize))
+#define NEXT(c) ((Chunk_t *)((uint8_t *)(c) + (c)->Size))
+
+static void HeapReset(uint32_t size)
+{
+    HeapSize = size;
+    HEAP_START->Size = size;
+    HEAP_START->Used = 0;
+    HeapCalls = 0;
+    HeapFailures = 0;
+}
+
+void *__wrap_malloc(size_t size)
+{
+    uint32_t need = (uint32_t)((size + sizeof(Chunk_t) + 7) & ~(size_t)7);
+
+    HeapCalls++;
+    if (need < CHUNK_MIN) {
+        need = CHUNK_MIN;
+    }
+    for (Chunk_t *c = HEAP_START; c < HEAP_END; c = NEXT(c)) {
+        if (!c->Used && c->Size >= need) {
+            if (c->Size - need >= CHUNK_MIN) {
+                Chunk_t *rest = (Chunk_t *)((uint8_t *)c + need);
+                rest->Size = c->Size - need;
+                rest->Used = 0;
+                c->Size = need;
+            }
+            c->Used = 1;
+            return c + 1;
+        }
+    }
+    HeapFailures++;
+    return NULL;
+}
+
+void __wrap_free(void *p)
+{
+    if (p == NULL) {
+        return;
+    }
+    HeapCalls++;
+    ((Chunk_t *)p - 1)->Used = 0;
+    for (Chunk_t *c = HEAP_START; c < HEAP_END; c = NEXT(c)) {
+        while (!c->Used && NEXT(c) < HEAP_END && !NEXT(c)->Used) {
+            c->Size += NEXT(c)->Size;
+        }
+    }
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    Chunk_t *c = (Chunk_t *)p - 1;
+    void *q;
+
+    if (p == NULL) {
+        return __wrap_malloc(size);
+    }
+    if (c->Size - sizeof(Chunk_t) >= size) {
+        HeapCalls++;
+        return p;
+    }
+    q = __wrap_malloc(size);
+    if (q != NULL) {
+        memcpy(q, p, c->Size - sizeof(Chunk_t));
+        __wrap_free(p);
+    }
+    return q;
+}
+
+static uint32_t HeapUsed(void)
+{
+    uint32_t used = 0;
+
+    for (Chunk_t *c = HEAP_START; c < HEAP_END; c = NEXT(c)) {
+        used += c->Used ? c->Size : 0;
+    }
+    return used;
+}
+
+static uint32_t HeapLargestFree(void)
+{
+    uint32_t largest = 0;
+
+    for (Chunk_t *c = HEAP_START; c < HEAP_END; c = NEXT(c)) {
+        if (!c->Used && c->Size > largest) {
+            largest = c->Size;
+        }
+    }
+    return largest;
+}
+
+/*
+ * GPS sketch
+ */
+static const char *Nmea[] = {
+    "$GNGGA,123519.000,4807.0381,N,01131.0002,E,1,08,0.9,545.4,M,46.9,M,,*47",
+    "$GNRMC,123519.000,A,4807.0381,N,01131.0002,E,022.4,084.4,230394,003.1,W*6A",
+    "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74",
+    "$GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74",
+    "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D",
+    "$GNVTG,084.4,T,,M,022.4,N,041.5,K,A*2F",
+};
+
+static const char *DisplayLine = "lat:4807.0381 lon:01131.0002 alt:545.4m v:022.4 s11 s11 s11 s";
+
+static String Field(const String &s, int n)
+{
+    int start = 0;
+
+    for (int i = 0; i < n; i++) {
+        start = s.indexOf(',', start) + 1;
+        if (start == 0) {
+            return String();
+        }
+    }
+    int end = s.indexOf(',', start);
+    return s.substring(start, end < 0 ? s.length() : end);
+}
+
+#define KEEP_SLOTS 16
+
+typedef struct {
+    double Calls;
+    unsigned long Failures;
+    unsigned long Invalid;
+    uint32_t MinLargestFree;
+    double FragmentationAvg;
+    double FragmentationMax;
+} Result_t;
+
+static Result_t Run(long seconds, uint32_t heapSize, size_t arenaSize)
+{
+    static char arenaBlock[HEAP_MAX];
+    StringArena arena(arenaBlock, arenaSize);
+    void *keep[KEEP_SLOTS] = { 0 };
+    long keepUntil[KEEP_SLOTS] = { 0 };
+    uint32_t random = 1;
+    Result_t r = { 0, 0, 0, heapSize, 0, 0 };
+    double fragmentationSum = 0;
+
+    HeapReset(heapSize);
+    for (long t = 0; t < seconds; t++) {
+        String line;
+        StringArenaScope *scope = arenaSize ? new StringArenaScope(arena) : NULL;
+
+        for (unsigned k = 0; k < sizeof(Nmea) / sizeof(Nmea[0]); k++) {
+            String s;
+            for (const char *p = Nmea[k]; *p; p++) {
+                s += *p;
+            }
+            if (!s) {
+                r.Invalid++;
+            }
+            if (s.startsWith("$GNGGA")) {
+                String lat = Field(s, 2), lon = Field(s, 4), alt = Field(s, 9);
+                line = "lat:" + lat + " lon:" + lon + " alt:" + String(alt.toFloat(), 1) + "m";
+            } else if (s.startsWith("$GNRMC")) {
+                line += " v:" + Field(s, 7);
+            } else {
+                line += (String) " s" + Field(s, 3);
+            }
+
+            if (k == 2) {
+                // other code allocates while the parse is under way
+                random = random * 1103515245 + 12345;
+                int slot = (random >> 16) % KEEP_SLOTS;
+                if (keep[slot] && t >= keepUntil[slot]) {
+                    __wrap_free(keep[slot]);
+                    keep[slot] = NULL;
+                }
+                if (!keep[slot] && ((random >> 8) & 3) == 0) {
+                    keep[slot] = __wrap_malloc(16 + (random >> 20) % 112);
+                    keepUntil[slot] = t + (random >> 24) % 600;
+                }
+
+                uint32_t largest = HeapLargestFree();
+                double fragmentation = 1.0 - (double)largest / (heapSize - HeapUsed());
+                if (largest < r.MinLargestFree) {
+                    r.MinLargestFree = largest;
+                }
+                fragmentationSum += fragmentation;
+                if (fragmentation > r.FragmentationMax) {
+                    r.FragmentationMax = fragmentation;
+                }
+            }
+        }
+        if (!line || line != DisplayLine) {
+            r.Invalid++;
+        }
+        delete scope;
+    }
+
+    r.Calls = (double)HeapCalls / seconds;
+    r.Failures = HeapFailures;
+    r.FragmentationAvg = fragmentationSum / seconds;
+    for (int i = 0; i < KEEP_SLOTS; i++) {
+        __wrap_free(keep[i]);
+    }
+    if (HeapUsed() != 0 || arena.used() != 0) {
+        printf("string: %u heap and %zu arena bytes still in use\n", HeapUsed(), arena.used());
+        Failures++;
+    }
+    return r;
+}
+
+static void Report(const char *config, const Result_t &r)
+{
+    printf("%-12s %12.1f %9lu %9lu %17u %9.3f %9.3f\n", config, r.Calls, r.Failures, r.Invalid, r.MinLargestFree,
+           r.FragmentationAvg, r.FragmentationMax);
+    if (r.Invalid) {
+        Failures++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long seconds = argc > 1 ? strtol(argv[1], NULL, 0) : 604800;
+    uint32_t heapSize = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 4096;
+    size_t arenaSize = argc > 3 ? strtoul(argv[3], NULL, 0) : 512;
+    char config[32];
+
+    if (heapSize > HEAP_MAX || arenaSize > HEAP_MAX || heapSize < CHUNK_MIN || arenaSize == 0) {
+        printf("string: heap and arena size up to %d bytes\n", HEAP_MAX);
+        return 1;
+    }
+    heapSize &= ~7u;
+    printf("string: %ld s of GPS parsing, %u byte heap\n", seconds, heapSize);
+    printf("%-12s %12s %9s %9s %17s %9s %9s\n", "config", "heap calls/s", "failures", "invalid", "min largest free",
+           "frag avg", "frag max");
+    Report("heap", Run(seconds, heapSize, 0));
+    snprintf(config, sizeof(config), "arena %zu", arenaSize);
+    Report(config, Run(seconds, heapSize, arenaSize));
+    printf("string: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
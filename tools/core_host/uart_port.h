@@ -0,0 +1,20 @@
+/*
+ * uart_port.h
+ *
+ * Host stand-in for the console UART port: printf() ends in
+ * UART_1_UartPutChar, which the harness defines to capture the output.
+ */
+#ifndef __UART_PORT_H
+#define __UART_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void UART_1_UartPutChar(char c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
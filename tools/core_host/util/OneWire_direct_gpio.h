@@ -0,0 +1,38 @@
+/*
+ * OneWire_direct_gpio.h
+ *
+ * Host stand-in for the direct GPIO macros. A pin is one word of
+ * HostPinReg[], reads and writes go to the harness, which keeps the line
+ * levels on its simulated clock (see softserial_sim.cpp).
+ */
+#ifndef OneWire_Direct_GPIO_h
+#define OneWire_Direct_GPIO_h
+
+#include <stdint.h>
+
+#define HOST_PINS 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint32_t HostPinReg[HOST_PINS];
+uint8_t HostPinRead(volatile uint32_t *base);
+void HostPinWrite(volatile uint32_t *base, uint8_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define PIN_TO_BASEREG(pin)             (&HostPinReg[pin])
+#define PIN_TO_BITMASK(pin)             (1)
+#define IO_REG_TYPE                     uint32_t
+#define IO_REG_BASE_ATTR
+#define IO_REG_MASK_ATTR
+#define DIRECT_READ(base, mask)         HostPinRead(base)
+#define DIRECT_MODE_INPUT(base, mask)
+#define DIRECT_MODE_OUTPUT(base, mask)
+#define DIRECT_WRITE_LOW(base, mask)    HostPinWrite(base, 0)
+#define DIRECT_WRITE_HIGH(base, mask)   HostPinWrite(base, 1)
+
+#endif
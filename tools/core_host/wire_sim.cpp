@@ -0,0 +1,839 @@
+/*
+ * wire_sim.cpp
+ *
+ * Transaction queue of the asr650x Wire (cores/asr650x/Wire) on a simulated
+ * I2C bus.
+ *
+ * Both SCB I2C masters are modelled at the level of the component API that
+ * Wire.cpp calls: I2CMasterWriteBuf()/ReadBuf() start a transfer that takes
+ * the time of its bytes at the configured clock, then the component ISR sets
+ * the completion and error flags the way I2C_I2C_INT.c does: address NACK,
+ * data NACK (short transfer), halt after a transfer without stop. A start
+ * that does not match the bus state (a Start on a halted bus, a ReStart on
+ * an idle one) is refused like the component refuses it. The devices are
+ * register files that take the register with the first byte written; one
+ * kind NACKs data after some bytes, another stretches the clock until the
+ * block is reset.
+ *
+ * The harness owns the clock and the interrupt controller: critical
+ * sections mask the I2C interrupts, CySysPmSleep() waits for the next
+ * completion or the 1 ms SysTick, a pending vector runs once interrupts are
+ * unmasked. Every transfer goes to a log the checks compare with the bus
+ * traffic they expect.
+ *
+ * Checks: register write and read with a repeated start, queue order,
+ * address and data NACK, a transfer left halted, a bus that refuses to
+ * start, the timeout that resets the block, callbacks that queue again from
+ * the interrupt (also while the queue is aborted), waits from an interrupt
+ * handler, the Arduino API on top, and a random mix on both buses.
+ *
+ * usage: wire_sim [random transactions]
+ */
+#include "Wire.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+static int Failures = 0;
+
+static void Check(bool ok, const char *test, const char *what)
+{
+    if (!ok) {
+        printf("wire: %s: %s\n", test, what);
+        Failures++;
+    }
+}
+
+/*
+ * Simulated core
+ */
+volatile uint32 HostScbReg[HOST_SCB_REGS];
+
+static const uint64_t Never = UINT64_MAX;
+
+static uint64_t Now;           // us since reset
+static int Masked;             // critical section depth
+static uint32_t Handler;       // exception number of the running handler, 0 in thread mode
+static cyisraddress Vectors[32];
+static int Sleeps;
+
+typedef struct {
+    uint8_t Address;
+    uint8_t Mem[256];
+    uint8_t Ptr;
+    int NackAfter; // data bytes acknowledged before a NACK, -1 for none
+    int Hang;      // transfers that stretch SCL until the block is reset
+} Device_t;
+
+typedef struct {
+    uint8_t Address;
+    bool Read;
+    bool Restart;
+    bool Stop;
+    uint16_t Length;
+    uint16_t Done; // bytes acknowledged or received
+    uint32 Error;
+} Xfer_t;
+
+typedef struct {
+    bool Started;
+    bool Active;
+    bool Halted;
+    bool Refuse; // the next start finds the bus busy
+    uint64_t DoneAt;
+    uint32 Status;
+    uint32 Mode;
+    bool Read;
+    uint8_t Address;
+    uint8_t *Data;
+    uint32 Count;
+    uint8 Isr;
+    int Resets;
+    std::vector<Device_t> Devices;
+    std::vector<Xfer_t> Log;
+} Bus_t;
+
+static Bus_t Buses[2];
+
+static Device_t *FindDevice(int bus, uint32 address)
+{
+    for (Device_t &dev : Buses[bus].Devices) {
+        if (dev.Address == address) {
+            return &dev;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t BusClock(int bus)
+{
+    uint32_t div = HostScbReg[bus ? HOST_I2C_1_SCBCLK_DIV : HOST_I2C_SCBCLK_DIV] >> 8;
+
+    return CYDEV_BCLK__HFCLK__HZ / 8 / 3 / (div ? div : 1);
+}
+
+static uint32 MasterStart(int bus, uint32 address, uint8 *data, uint32 cnt, uint32 mode, bool read)
+{
+    Bus_t &b = Buses[bus];
+    Device_t *dev = FindDevice(bus, address);
+    uint32 bytes = 1 + cnt;
+
+    if (!b.Started || b.Active || b.Halted != ((mode & I2C_I2C_MODE_REPEAT_START) != 0)) {
+        return I2C_I2C_MSTR_NOT_READY;
+    }
+    if (b.Refuse) {
+        b.Refuse = false;
+        return I2C_I2C_MSTR_BUS_BUSY;
+    }
+    b.Active = true;
+    b.Read = read;
+    b.Address = (uint8_t)address;
+    b.Data = data;
+    b.Count = cnt;
+    b.Mode = mode;
+    if (dev == NULL) {
+        bytes = 1;
+    } else if (!read && dev->NackAfter >= 0 && cnt > (uint32)dev->NackAfter) {
+        bytes = 2 + dev->NackAfter;
+    }
+    if (dev != NULL && dev->Hang > 0) {
+        dev->Hang--;
+        b.DoneAt = Never;
+    } else {
+        // 9 clocks a byte, start and stop
+        b.DoneAt = Now + 1 + (bytes * 9 + 2) * 1000000ull / BusClock(bus);
+    }
+    return I2C_I2C_MSTR_NO_ERROR;
+}
+
+static void MasterIsr(int bus)
+{
+    Bus_t &b = Buses[bus];
+    Device_t *dev;
+    Xfer_t x;
+    uint32 i;
+
+    if (!b.Active || Now < b.DoneAt) {
+        return;
+    }
+    dev = FindDevice(bus, b.Address);
+    x.Address = b.Address;
+    x.Read = b.Read;
+    x.Restart = (b.Mode & I2C_I2C_MODE_REPEAT_START) != 0;
+    x.Stop = (b.Mode & I2C_I2C_MODE_NO_STOP) == 0;
+    x.Length = (uint16_t)b.Count;
+    x.Done = 0;
+    x.Error = 0;
+    if (dev == NULL) {
+        x.Error = I2C_I2C_MSTAT_ERR_XFER | I2C_I2C_MSTAT_ERR_ADDR_NAK;
+    } else if (b.Read) {
+        for (i = 0; i < b.Count; i++) {
+            b.Data[i] = dev->Mem[dev->Ptr++];
+        }
+        x.Done = (uint16_t)b.Count;
+    } else {
+        uint32 n = b.Count;
+
+        if (dev->NackAfter >= 0 && n > (uint32)dev->NackAfter) {
+            n = dev->NackAfter;
+            x.Error = I2C_I2C_MSTAT_ERR_XFER | I2C_I2C_MSTAT_ERR_SHORT_XFER;
+        }
+        for (i = 0; i < n; i++) {
+            if (i == 0) {
+                dev->Ptr = b.Data[0];
+            } else {
+                dev->Mem[dev->Ptr++] = b.Data[i];
+            }
+        }
+        x.Done = (uint16_t)n;
+    }
+    b.Log.push_back(x);
+    b.Active = false;
+    b.Halted = (b.Mode & I2C_I2C_MODE_NO_STOP) != 0;
+    b.Status |= (b.Read ? I2C_I2C_MSTAT_RD_CMPLT : I2C_I2C_MSTAT_WR_CMPLT) | x.Error |
+                (b.Halted ? I2C_I2C_MSTAT_XFER_HALT : 0);
+}
+
+static bool Pending(int bus)
+{
+    return Buses[bus].Active && Now >= Buses[bus].DoneAt;
+}
+
+// runs the pending I2C vectors unless masked or inside another handler
+static void Dispatch(void)
+{
+    bool again = true;
+
+    while (again && Masked == 0 && Handler == 0) {
+        again = false;
+        for (int bus = 0; bus < 2; bus++) {
+            if (Pending(bus) && Vectors[Buses[bus].Isr] != NULL) {
+                Handler = 16 + Buses[bus].Isr;
+                Vectors[Buses[bus].Isr]();
+                Handler = 0;
+                again = true;
+            }
+        }
+    }
+}
+
+// thread mode time passing, completions interrupt it
+static void Advance(uint64_t us)
+{
+    uint64_t end = Now + us;
+    uint64_t next;
+
+    Dispatch();
+    while (Now < end) {
+        next = end;
+        for (int bus = 0; bus < 2; bus++) {
+            if (Buses[bus].Active && Buses[bus].DoneAt > Now && Buses[bus].DoneAt < next) {
+                next = Buses[bus].DoneAt;
+            }
+        }
+        Now = next;
+        Dispatch();
+    }
+}
+
+extern "C" uint32 HostIntPending(void)
+{
+    return (Pending(0) ? 1u << I2C_ISR_NUMBER : 0) | (Pending(1) ? 1u << I2C_1_ISR_NUMBER : 0);
+}
+
+// the pending state follows the transfer, the component ISR ends it
+extern "C" void CyIntClearPending(uint8 number)
+{
+}
+
+extern "C" cyisraddress CyIntSetVector(uint8 number, cyisraddress address)
+{
+    cyisraddress old = Vectors[number];
+
+    Vectors[number] = address;
+    return old;
+}
+
+extern "C" uint8 CyEnterCriticalSection(void)
+{
+    return (uint8)(Masked++ > 0);
+}
+
+extern "C" void CyExitCriticalSection(uint8 savedIntrStatus)
+{
+    Masked--;
+    if (Masked == 0) {
+        Dispatch();
+    }
+}
+
+// WFI: wakes on a completion, pending even while masked, or on SysTick
+extern "C" void CySysPmSleep(void)
+{
+    uint64_t wake = Now + 1000 - Now % 1000;
+
+    for (int bus = 0; bus < 2; bus++) {
+        if (Buses[bus].Active && Buses[bus].DoneAt < wake) {
+            wake = Buses[bus].DoneAt > Now ? Buses[bus].DoneAt : Now;
+        }
+    }
+    Now = wake;
+    Sleeps++;
+}
+
+extern "C" uint32_t __get_IPSR(void)
+{
+    return Handler;
+}
+
+extern "C" uint32_t millis(void)
+{
+    Now++;
+    return (uint32_t)(Now / 1000);
+}
+
+extern "C" uint32_t micros(void)
+{
+    return (uint32_t)Now;
+}
+
+static void BusStart(int bus)
+{
+    Buses[bus].Started = true;
+    Buses[bus].Active = false;
+    Buses[bus].Halted = false;
+    Buses[bus].Status = 0;
+}
+
+static void BusStop(int bus)
+{
+    Buses[bus].Started = false;
+    Buses[bus].Active = false;
+    Buses[bus].Halted = false;
+    Buses[bus].Status = 0;
+    Buses[bus].Resets++;
+}
+
+extern "C" void I2C_Start(void) { BusStart(0); }
+extern "C" void I2C_Stop(void) { BusStop(0); }
+extern "C" void I2C_I2C_ISR(void) { MasterIsr(0); }
+extern "C" uint32 I2C_I2CMasterWriteBuf(uint32 slaveAddress, uint8 *wrData, uint32 cnt, uint32 mode)
+{
+    return MasterStart(0, slaveAddress, wrData, cnt, mode, false);
+}
+extern "C" uint32 I2C_I2CMasterReadBuf(uint32 slaveAddress, uint8 *rdData, uint32 cnt, uint32 mode)
+{
+    return MasterStart(0, slaveAddress, rdData, cnt, mode, true);
+}
+extern "C" uint32 I2C_I2CMasterStatus(void) { return Buses[0].Status; }
+extern "C" uint32 I2C_I2CMasterClearStatus(void)
+{
+    uint32 status = Buses[0].Status;
+
+    Buses[0].Status = 0;
+    return status;
+}
+extern "C" void I2C_I2CMasterClearReadBuf(void) {}
+extern "C" void I2C_I2CMasterClearWriteBuf(void) {}
+
+extern "C" void I2C_1_Start(void) { BusStart(1); }
+extern "C" void I2C_1_Stop(void) { BusStop(1); }
+extern "C" void I2C_1_I2C_ISR(void) { MasterIsr(1); }
+extern "C" uint32 I2C_1_I2CMasterWriteBuf(uint32 slaveAddress, uint8 *wrData, uint32 cnt, uint32 mode)
+{
+    return MasterStart(1, slaveAddress, wrData, cnt, mode, false);
+}
+extern "C" uint32 I2C_1_I2CMasterReadBuf(uint32 slaveAddress, uint8 *rdData, uint32 cnt, uint32 mode)
+{
+    return MasterStart(1, slaveAddress, rdData, cnt, mode, true);
+}
+extern "C" uint32 I2C_1_I2CMasterStatus(void) { return Buses[1].Status; }
+extern "C" uint32 I2C_1_I2CMasterClearStatus(void)
+{
+    uint32 status = Buses[1].Status;
+
+    Buses[1].Status = 0;
+    return status;
+}
+extern "C" void I2C_1_I2CMasterClearReadBuf(void) {}
+extern "C" void I2C_1_I2CMasterClearWriteBuf(void) {}
+
+// Print.cpp pulls in the console printf
+extern "C" void UART_1_UartPutChar(char c)
+{
+}
+
+/*
+ * Checks
+ */
+static uint8_t Rom(uint8_t address, uint8_t reg)
+{
+    return (uint8_t)(address * 7 + reg * 13 + 1);
+}
+
+static Device_t *AddDevice(int bus, uint8_t address, int nackAfter = -1)
+{
+    Device_t dev;
+
+    dev.Address = address;
+    for (int i = 0; i < 256; i++) {
+        dev.Mem[i] = Rom(address, (uint8_t)i);
+    }
+    dev.Ptr = 0;
+    dev.NackAfter = nackAfter;
+    dev.Hang = 0;
+    Buses[bus].Devices.push_back(dev);
+    return &Buses[bus].Devices.back();
+}
+
+// a fresh bus with the devices of a check, Wire begun on it
+static void Setup(void)
+{
+    for (int bus = 0; bus < 2; bus++) {
+        Buses[bus].Devices.clear();
+        Buses[bus].Devices.reserve(16);
+        Buses[bus].Log.clear();
+        Buses[bus].Refuse = false;
+        Buses[bus].Resets = 0;
+        Buses[bus].Isr = bus ? I2C_1_ISR_NUMBER : I2C_ISR_NUMBER;
+    }
+    Wire.begin();
+    Wire1.begin();
+    Wire.setTimeOut(50);
+    Wire1.setTimeOut(50);
+}
+
+static bool Finish(I2CTransaction &t, uint64_t limitUs = 100000)
+{
+    uint64_t end = Now + limitUs;
+
+    while (!t.done && Now < end) {
+        Advance(100);
+    }
+    return t.done;
+}
+
+static void Register(void)
+{
+    const char *test = "register";
+    uint8_t reg[1] = { 0x10 };
+    uint8_t write[4] = { 0x20, 0xA1, 0xA2, 0xA3 };
+    uint8_t rx[4];
+    I2CTransaction t(0x50, reg, 1, rx, 4);
+
+    Setup();
+    AddDevice(0, 0x50);
+    Check(Wire.queueTransaction(&t) == I2C_ERROR_OK, test, "queue refused");
+    Check(Finish(t) && t.error == I2C_ERROR_OK, test, "read failed");
+    for (int i = 0; i < 4; i++) {
+        Check(rx[i] == Rom(0x50, 0x10 + i), test, "read wrong data");
+    }
+    const std::vector<Xfer_t> &log = Buses[0].Log;
+    Check(log.size() == 2, test, "read is not two transfers");
+    if (log.size() == 2) {
+        Check(!log[0].Read && !log[0].Restart && !log[0].Stop && log[0].Length == 1, test, "register write");
+        Check(log[1].Read && log[1].Restart && log[1].Stop && log[1].Length == 4, test, "read after repeated start");
+    }
+
+    I2CTransaction w(0x50, write, 4);
+    I2CTransaction r(0x50, write, 1, rx, 3);
+    Check(Wire.queueTransaction(&w) == I2C_ERROR_OK, test, "queue refused");
+    Check(Wire.queueTransaction(&w) == I2C_ERROR_BUSY, test, "queued twice");
+    Check(Wire.queueTransaction(&r) == I2C_ERROR_OK, test, "queue refused");
+    Check(Finish(r) && w.done && w.error == I2C_ERROR_OK && r.error == I2C_ERROR_OK, test, "write back failed");
+    Check(memcmp(rx, write + 1, 3) == 0, test, "read back wrong data");
+    Check(!Wire.busy(), test, "queue not empty");
+}
+
+static std::vector<int> Order;
+
+static void Record(I2CTransaction *t)
+{
+    Order.push_back((int)(intptr_t)t->arg);
+}
+
+static void Queue(void)
+{
+    const char *test = "queue";
+    uint8_t tx[6][4];
+    uint8_t rx[6][8];
+    std::vector<I2CTransaction> t;
+
+    Setup();
+    for (int i = 0; i < 6; i++) {
+        AddDevice(0, 0x20 + i);
+    }
+    Order.clear();
+    t.reserve(6);
+    for (int i = 0; i < 6; i++) {
+        tx[i][0] = (uint8_t)(i * 3);
+        t.push_back(I2CTransaction(0x20 + i, tx[i], 1, rx[i], 1 + i, true, Record, (void *)(intptr_t)i));
+    }
+    for (int i = 0; i < 6; i++) {
+        Check(Wire.queueTransaction(&t[i]) == I2C_ERROR_OK, test, "queue refused");
+    }
+    Check(Wire.busy(), test, "queue empty while running");
+    Check(Finish(t[5]), test, "last transaction not done");
+    for (int i = 0; i < 6; i++) {
+        Check(t[i].done && t[i].error == I2C_ERROR_OK, test, "transaction failed");
+        for (int k = 0; k < 1 + i; k++) {
+            Check(rx[i][k] == Rom(0x20 + i, i * 3 + k), test, "wrong data");
+        }
+    }
+    Check(Order.size() == 6, test, "callbacks missing");
+    for (size_t i = 0; i < Order.size(); i++) {
+        Check(Order[i] == (int)i, test, "callbacks out of order");
+    }
+    for (size_t i = 0; i < Buses[0].Log.size(); i++) {
+        Check(Buses[0].Log[i].Address == 0x20 + i / 2, test, "transfers out of order");
+    }
+}
+
+static void Nack(void)
+{
+    const char *test = "nack";
+    uint8_t tx[5] = { 0x40, 1, 2, 3, 4 };
+    uint8_t rx[2];
+
+    Setup();
+    AddDevice(0, 0x50);
+    AddDevice(0, 0x51, 2);
+
+    I2CTransaction write(0x33, tx, 5);
+    I2CTransaction read(0x33, NULL, 0, rx, 2);
+    I2CTransaction reg(0x33, tx, 1, rx, 2);
+    I2CTransaction good(0x50, tx, 1, rx, 2);
+    Wire.queueTransaction(&write);
+    Wire.queueTransaction(&read);
+    Wire.queueTransaction(&reg);
+    Wire.queueTransaction(&good);
+    Check(Finish(good), test, "queue stalled after a NACK");
+    Check(write.error == I2C_ERROR_ACK, test, "address NACK on write not reported");
+    Check(read.error == I2C_ERROR_ACK, test, "address NACK on read not reported");
+    Check(reg.error == I2C_ERROR_ACK, test, "address NACK on register read not reported");
+    Check(good.error == I2C_ERROR_OK && rx[0] == Rom(0x50, 0x40), test, "transaction after a NACK failed");
+    // the register read stopped after its write, the next start is a ReStart on the halted bus
+    Check(Buses[0].Log.size() == 5, test, "register read went on after the NACK");
+
+    I2CTransaction data(0x51, tx, 5);
+    Wire.queueTransaction(&data);
+    Check(Finish(data) && data.error == I2C_ERROR_ACK, test, "data NACK not reported");
+    Check(Buses[0].Log.back().Done == 2, test, "data NACK after the wrong byte");
+
+    // no stop: the bus stays halted for the next one
+    I2CTransaction open(0x50, tx, 1, NULL, 0, false);
+    I2CTransaction next(0x50, NULL, 0, rx, 2);
+    Wire.queueTransaction(&open);
+    Wire.queueTransaction(&next);
+    Check(Finish(next) && open.error == I2C_ERROR_OK && next.error == I2C_ERROR_OK, test, "halted transfer");
+    Check(Buses[0].Log.back().Restart && Buses[0].Log.back().Stop, test, "no repeated start after a halt");
+}
+
+static void Refused(void)
+{
+    const char *test = "refused";
+    uint8_t rx[2];
+
+    Setup();
+    AddDevice(0, 0x50);
+    Order.clear();
+    I2CTransaction a(0x50, NULL, 0, rx, 2, true, Record, (void *)1);
+    I2CTransaction b(0x50, NULL, 0, rx, 2, true, Record, (void *)2);
+    Buses[0].Refuse = true;
+    Wire.queueTransaction(&a);
+    Check(a.done && a.error == I2C_ERROR_BUSY, test, "refused start not reported at once");
+    Wire.queueTransaction(&b);
+    Check(Finish(b) && b.error == I2C_ERROR_OK, test, "transaction after a refused one failed");
+    Check(Order.size() == 2 && Order[0] == 1 && Order[1] == 2, test, "callbacks");
+}
+
+static void Timeout(void)
+{
+    const char *test = "timeout";
+    uint8_t tx[2] = { 0x10, 0x55 };
+    uint8_t rx[2];
+    uint64_t start;
+    int resets;
+    int sleeps;
+
+    Setup();
+    AddDevice(0, 0x50);
+    AddDevice(0, 0x44)->Hang = 1;
+    Order.clear();
+    Wire.setTimeOut(20);
+
+    I2CTransaction queued(0x50, tx, 1, rx, 2, true, Record, (void *)7);
+    start = Now;
+    resets = Buses[0].Resets;
+    sleeps = Sleeps;
+    Wire.beginTransmission(0x44);
+    Wire.write(tx, 2);
+    Check(Wire.endTransmission() == I2C_ERROR_TIMEOUT, test, "hung bus not reported");
+    Check(Now - start >= 20000 && Now - start < 23000, test, "timeout not kept");
+    Check(Buses[0].Resets == resets + 1, test, "block not reset");
+    Check(Sleeps - sleeps >= 20, test, "wait spins instead of sleeping");
+
+    // a transaction queued behind the one that hangs fails with it
+    AddDevice(0, 0x44)->Hang = 0;
+    Buses[0].Devices.front().Hang = 1;
+    I2CTransaction hang(0x50, tx, 2);
+    Wire.queueTransaction(&hang);
+    Wire.queueTransaction(&queued);
+    Check(Wire.waitTransaction(&hang) == I2C_ERROR_TIMEOUT, test, "hung transaction");
+    Check(queued.done && queued.error == I2C_ERROR_TIMEOUT, test, "queued transaction not failed");
+    Check(Order.size() == 1 && Order[0] == 7, test, "callback of the failed transaction");
+
+    I2CTransaction after(0x44, tx, 2);
+    Wire.queueTransaction(&after);
+    Check(Finish(after) && after.error == I2C_ERROR_OK, test, "bus not usable after the reset");
+}
+
+static I2CTransaction *Chained;
+static int Runs;
+
+// queues itself again until it ran five times
+static void Again(I2CTransaction *t)
+{
+    if (++Runs < 5) {
+        Check(Wire.queueTransaction(t) == I2C_ERROR_OK, "requeue", "requeue from the callback refused");
+    }
+}
+
+static void Chain(I2CTransaction *t)
+{
+    Record(t);
+    if (Chained != NULL) {
+        I2CTransaction *next = Chained;
+
+        Chained = NULL;
+        Check(Wire.queueTransaction(next) == I2C_ERROR_OK, "requeue", "chained queue refused");
+    }
+}
+
+// retries on an error, at most three times
+static void Retry(I2CTransaction *t)
+{
+    if (t->error != I2C_ERROR_OK && ++Runs <= 3) {
+        Wire.queueTransaction(t);
+    }
+}
+
+static void Requeue(void)
+{
+    const char *test = "requeue";
+    uint8_t tx[1] = { 0x08 };
+    uint8_t rx[3];
+
+    Setup();
+    AddDevice(0, 0x50);
+    AddDevice(0, 0x60);
+    AddDevice(0, 0x70);
+
+    Runs = 0;
+    I2CTransaction a(0x50, tx, 1, rx, 3, true, Again);
+    I2CTransaction b(0x60, tx, 1);
+    Wire.queueTransaction(&a);
+    Wire.queueTransaction(&b);
+    Advance(100000);
+    Check(Runs == 5 && a.done && a.error == I2C_ERROR_OK && b.done, test, "requeued transaction");
+    {
+        static const uint8_t Expected[] = { 0x50, 0x60, 0x50, 0x50, 0x50, 0x50 };
+        std::vector<uint8_t> seen;
+
+        for (const Xfer_t &x : Buses[0].Log) {
+            if (!x.Read) {
+                seen.push_back(x.Address);
+            }
+        }
+        Check(seen == std::vector<uint8_t>(Expected, Expected + sizeof(Expected)), test,
+              "requeued transaction not behind the queue");
+    }
+
+    Order.clear();
+    I2CTransaction c(0x60, tx, 1, NULL, 0, true, Chain, (void *)1);
+    I2CTransaction d(0x70, tx, 1, NULL, 0, true, Chain, (void *)2);
+    Chained = &d;
+    Wire.queueTransaction(&c);
+    Advance(20000);
+    Check(d.done && d.error == I2C_ERROR_OK && Order.size() == 2 && Order[1] == 2, test, "chained transaction");
+
+    // the queue is aborted while the callback queues again
+    Buses[0].Devices[0].Hang = 1;
+    Runs = 0;
+    Wire.setTimeOut(10);
+    I2CTransaction r(0x50, tx, 1, rx, 3, true, Retry);
+    Wire.queueTransaction(&r);
+    Wire.waitTransaction(&r);
+    Check(Finish(r) && r.error == I2C_ERROR_OK && Runs == 1, test, "retry after the abort");
+}
+
+static void Handler_(void)
+{
+    const char *test = "handler";
+    uint8_t tx[3] = { 0x30, 0x77, 0x78 };
+    uint8_t rx[2];
+    int sleeps = Sleeps;
+
+    Setup();
+    AddDevice(0, 0x50);
+    AddDevice(1, 0x51)->Hang = 1;
+
+    // in another interrupt handler the I2C interrupt cannot run, the wait polls it
+    Handler = 16 + 3;
+    Check(Wire.writeTransmission(0x50, tx, 3) == I2C_ERROR_OK, test, "write from a handler");
+    Check(Wire.readTransmission(0x50, rx, 2) == I2C_ERROR_OK, test, "read from a handler");
+    Check(Wire1.writeTransmission(0x51, tx, 3) == I2C_ERROR_TIMEOUT, test, "timeout from a handler");
+    Handler = 0;
+    Check(Sleeps == sleeps, test, "slept in a handler");
+    Check(Buses[0].Devices[0].Mem[0x30] == 0x77, test, "write from a handler lost");
+}
+
+static void Api(void)
+{
+    const char *test = "api";
+
+    Setup();
+    AddDevice(0, 0x50);
+    Wire.beginTransmission(0x50);
+    Wire.write(0x30);
+    Wire.write(0x5A);
+    Wire.write(0x5B);
+    Check(Wire.endTransmission() == I2C_ERROR_OK, test, "endTransmission");
+    Wire.beginTransmission(0x50);
+    Wire.write(0x30);
+    Check(Wire.endTransmission(false) == I2C_ERROR_OK, test, "endTransmission without stop");
+    Check(Wire.requestFrom(0x50, 2) == 2, test, "requestFrom");
+    Check(Wire.available() == 2 && Wire.read() == 0x5A && Wire.read() == 0x5B, test, "data read");
+    Check(Buses[0].Log.back().Restart, test, "requestFrom after endTransmission(false) without repeated start");
+
+    Wire.beginTransmission(0x33);
+    Check(Wire.endTransmission() == I2C_ERROR_ACK, test, "NACK not returned");
+    Check(Wire.requestFrom(0x33, 2) == 0, test, "requestFrom of a missing device");
+}
+
+/*
+ * Random mix on both buses, queued from the main loop and from callbacks
+ */
+typedef struct {
+    I2CTransaction T;
+    int Bus;
+    uint8_t Tx[9];
+    uint8_t Rx[8];
+    int Completions;
+    i2c_err_t Expected;
+} Job_t;
+
+static std::vector<Job_t> Jobs;
+static std::vector<uint8_t> Expected[2]; // addresses of the write and read transfers in order
+static size_t Submitted;
+static std::mt19937 Rng(1);
+
+static void Completed(I2CTransaction *t);
+
+static void Submit(int bus)
+{
+    static const uint8_t Addresses[] = { 0x50, 0x51, 0x52, 0x33 }; // 0x52 NACKs after 2 bytes, 0x33 is missing
+    Job_t &job = Jobs[Submitted++];
+    uint8_t address = Addresses[Rng() % 4];
+    uint16_t txLength = Rng() % 4 == 0 ? 0 : 1 + Rng() % 8;
+    uint16_t rxLength = Rng() % 3 == 0 ? 0 : 1 + Rng() % 8;
+    TwoWire &wire = bus ? Wire1 : Wire;
+
+    job.Bus = bus;
+    job.Completions = 0;
+    for (int i = 0; i < 9; i++) {
+        job.Tx[i] = (uint8_t)Rng();
+    }
+    job.Tx[0] &= 0x7F; // registers of the read check stay clear of writes
+    job.T = I2CTransaction(address, job.Tx, txLength, job.Rx, rxLength, Rng() % 5 != 0, Completed, &job);
+    job.Expected = I2C_ERROR_OK;
+    if (address == 0x33 || (address == 0x52 && txLength > 2)) {
+        job.Expected = I2C_ERROR_ACK;
+    }
+    if (txLength > 0 || rxLength == 0) {
+        Expected[bus].push_back(address);
+    }
+    if (rxLength > 0 && (txLength == 0 || job.Expected == I2C_ERROR_OK)) {
+        Expected[bus].push_back(address | 0x80);
+    }
+    Check(wire.queueTransaction(&job.T) == I2C_ERROR_OK, "random", "queue refused");
+}
+
+static void Completed(I2CTransaction *t)
+{
+    Job_t &job = *(Job_t *)t->arg;
+
+    job.Completions++;
+    if (Submitted < Jobs.size() && Rng() % 3 == 0) {
+        Submit(Rng() % 2);
+    }
+}
+
+static void Random(int count)
+{
+    const char *test = "random";
+    size_t queued = 0;
+
+    Setup();
+    for (int bus = 0; bus < 2; bus++) {
+        AddDevice(bus, 0x50);
+        AddDevice(bus, 0x51);
+        AddDevice(bus, 0x52, 2);
+        Expected[bus].clear();
+    }
+    Jobs.clear();
+    Jobs.resize(count);
+    Submitted = 0;
+    while (Submitted < Jobs.size()) {
+        Submit(Rng() % 2);
+        Advance(Rng() % 3000);
+        queued++;
+    }
+    Advance(200000);
+
+    for (Job_t &job : Jobs) {
+        Check(job.T.done && job.Completions == 1, test, "transaction not completed exactly once");
+        Check(job.T.error == job.Expected, test, "unexpected error");
+    }
+    for (int bus = 0; bus < 2; bus++) {
+        std::vector<uint8_t> seen;
+
+        for (const Xfer_t &x : Buses[bus].Log) {
+            seen.push_back(x.Address | (x.Read ? 0x80 : 0));
+        }
+        Check(seen == Expected[bus], test, "transfers differ from the queue order");
+        Check(!Buses[bus].Active, test, "transfer left running");
+    }
+    Check(!Wire.busy() && !Wire1.busy(), test, "queue not empty");
+    printf("wire: random %zu transactions, %zu from callbacks, %zu + %zu transfers\n", Jobs.size(),
+           Jobs.size() - queued, Buses[0].Log.size(), Buses[1].Log.size());
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *Name;
+        void (*Run)(void);
+    } Checks[] = {
+        { "register", Register }, { "queue", Queue },     { "nack", Nack },       { "refused", Refused },
+        { "timeout", Timeout },   { "requeue", Requeue }, { "handler", Handler_ }, { "api", Api },
+    };
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+
+    I2CTransaction early(0x50);
+    Check(Wire.queueTransaction(&early) == I2C_ERROR_BUSY, "begin", "queued before begin()");
+    for (const auto &check : Checks) {
+        int failures = Failures;
+
+        check.Run();
+        printf("wire: %-9s %s\n", check.Name, Failures == failures ? "ok" : "FAILED");
+    }
+    Random(count);
+    printf("wire: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+
+# Host tests and benchmarks of the asr650x core.
+#
+# Each test is a harness in core_host/ built with the system compiler
+# against the unmodified core sources (see core_host.py) and run here:
+#   ring    RingBuffer.h, element and span interfaces, then a producer and
+#           a consumer thread streaming through one ring: ordering and
+#           throughput
+#   printf  port/printf.c and Print::printf against the C library's snprintf:
+#           output and return values, peak stack and throughput
+#   conversion  stdlib_noniso.c: the division free integer paths against plain
+#           division, dtoa_fixed against the exact value of the double
+#           (--exhaustive: every 32 bit input and every float, slow)
+#   string  heap calls and fragmentation of String on a simulated 4 KiB heap
+#           parsing GPS sentences, with and without a StringArena
+#   softserial  libraries/Basics softSerial on a simulated 48 MHz core: two
+#           ports receiving jittered frames with baud error and interrupt
+#           latency, and the transmitter's bit timing
+#   wire    the transaction queue of cores/asr650x/Wire on a simulated bus:
+#           repeated starts, address and data NACK, timeout and reset,
+#           callbacks queueing again, and a random mix on both buses
+#
+# usage: core_test.py [--ring-bytes n] [--printf-cases n] [--conversion-cases n]
+#                     [--exhaustive] [--string-seconds n] [--softserial-seeds n]
+#                     [--softserial-latency us] [--softserial-error %]
+#                     [--wire-transactions n] [test ...]
+#
+# Without a test name all of them run. The exit status is 1 when one of
+# them failed.
+
+from __future__ import print_function
+
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'core_host'))
+import core_host
+
+CORES = core_host.CORES
+PORT = os.path.join(core_host.ROOT, 'cores', 'asr650x', 'port')
+WIRE = os.path.join(core_host.ROOT, 'cores', 'asr650x', 'Wire')
+
+
+def ring(args):
+    exe = core_host.build('ring_test', [os.path.join(core_host.HERE, 'ring_test.cpp')], [CORES],
+                          flags=['-std=c++11'])
+    return core_host.run(exe, [args.ring_bytes])
+
+
+def printf(args):
+    sources = [os.path.join(core_host.HERE, 'printf_test.cpp'), os.path.join(PORT, 'printf.c')] + [
+        os.path.join(CORES, f) for f in ('stdlib_noniso.c', 'Print.cpp', 'WString.cpp')]
+    exe = core_host.build('printf_test', sources, [CORES, os.path.join(PORT, 'include')],
+                          flags=['-Wno-format'])
+    return core_host.run(exe, [args.printf_cases])
+
+
+def conversion(args):
+    exe = core_host.build('conversion_test', [os.path.join(core_host.HERE, 'conversion_test.c')], [CORES],
+                          depends=[os.path.join(CORES, 'stdlib_noniso.c')])
+    return core_host.run(exe, [args.conversion_cases] + (['exhaustive'] if args.exhaustive else []))
+
+
+def string(args):
+    sources = [os.path.join(core_host.HERE, 'string_bench.cpp')] + [
+        os.path.join(CORES, f) for f in ('WString.cpp', 'stdlib_noniso.c')]
+    exe = core_host.build('string_bench', sources, [CORES],
+                          flags=['-Wl,--wrap=malloc,--wrap=realloc,--wrap=free'])
+    return core_host.run(exe, [args.string_seconds])
+
+
+def softserial(args):
+    basics = os.path.join(core_host.ROOT, 'libraries', 'Basics', 'src')
+    sources = [os.path.join(core_host.HERE, 'softserial_sim.cpp'), os.path.join(basics, 'softSerial.cpp'),
+               os.path.join(PORT, 'printf.c')] + [
+        os.path.join(CORES, f) for f in ('Stream.cpp', 'Print.cpp', 'WString.cpp', 'stdlib_noniso.c')]
+    exe = core_host.build('softserial_sim', sources, [basics, CORES, os.path.join(PORT, 'include')],
+                          defines=['__asr650x__'], depends=[os.path.join(core_host.HERE, 'util', 'OneWire_direct_gpio.h')])
+    return core_host.run(exe, [args.softserial_seeds, args.softserial_latency, args.softserial_error])
+
+
+def wire(args):
+    sources = [os.path.join(core_host.HERE, 'wire_sim.cpp'), os.path.join(WIRE, 'Wire.cpp'),
+               os.path.join(PORT, 'printf.c')] + [
+        os.path.join(CORES, f) for f in ('Stream.cpp', 'Print.cpp', 'WString.cpp', 'stdlib_noniso.c')]
+    # Wire.cpp as it is: lastError() and the debug calls have no return
+    exe = core_host.build('wire_sim', sources, [WIRE, CORES, os.path.join(PORT, 'include')],
+                          defines=['__ASR6502__'], flags=['-Wno-return-type'])
+    return core_host.run(exe, [args.wire_transactions])
+
+
+TESTS = [('ring', ring), ('printf', printf), ('conversion', conversion), ('string', string),
+         ('softserial', softserial), ('wire', wire)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='host tests and benchmarks of the asr650x core')
+    parser.add_argument('tests', nargs='*', metavar='test', help=', '.join(name for name, _ in TESTS))
+    parser.add_argument('--printf-cases', type=int, default=200000, help='random printf comparisons')
+    parser.add_argument('--conversion-cases', type=int, default=1000000, help='random values per conversion check')
+    parser.add_argument('--exhaustive', action='store_true', help='every 32 bit input and every float')
+    parser.add_argument('--string-seconds', type=int, default=604800, help='simulated seconds of GPS parsing')
+    parser.add_argument('--softserial-seeds', type=int, default=4, help='softserial runs per rate and error')
+    parser.add_argument('--softserial-latency', type=float, default=4.0, help='max interrupt latency [us]')
+    parser.add_argument('--softserial-error', type=float, default=2.0, help='baud rate error of the sender [%%]')
+    parser.add_argument('--wire-transactions', type=int, default=2000, help='transactions of the random wire mix')
+    parser.add_argument('--ring-bytes', type=int, default=50000000, help='bytes streamed per ring benchmark')
+    args = parser.parse_args()
+
+    names = [name for name, _ in TESTS]
+    for name in args.tests:
+        if name not in names:
+            parser.error('unknown test %s' % name)
+    failed = [name for name, test in TESTS if (not args.tests or name in args.tests) and test(args) != 0]
+    if failed:
+        print('FAILED: %s' % ' '.join(failed))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,234 @@
+#!/usr/bin/env python
+
+# Delivered bytes per hour of one CubeCell node under regional duty cycle
+# rules, with and without the LoRaMacScheduler throughput policy.
+#
+# The node is a LoRaMacCtx_t of the real MAC, built for the host by
+# lorawan_host together with LoRaMacScheduler.c: channel selection, band
+# time-off, CAD, the class A receive windows and every policy decision are
+# the firmware's own. What stays in Python is the part outside the MAC:
+#   - the record queue of LoRaWanClass::enqueue: LORAWAN_QUEUE_SIZE bytes,
+#     bulk evicted first, each frame carries as many records as
+#     LoRaMacQueryTxPossible allows, urgent records first, and a frame with
+#     an urgent record is marked with LoRaMacSchedulerMarkUrgent
+#   - the link: the margin a LinkCheckAns reports at the configured
+#     datarate, and per frame fading deciding whether the gateway hears it
+# The "default" scheduler installs no policy. "throughput" installs
+# LoRaMacSchedulerThroughputPolicy, which sends at the highest datarate
+# keeping --policy-margin dB. "reserve" adds ReserveBand: non urgent frames
+# wait until a second band is available, at most --max-delay ms, trading
+# bulk throughput for urgent latency.
+#
+# AS923 runs the AS1 channel plan with the region defaults: uplink dwell
+# time off and no duty cycle management (AS923_DUTY_CYCLE_ENABLED 0). Most
+# AS923 countries impose about 1% or listen before talk, so the network
+# answers the first uplink with a DutyCycleReq of --as923-max-dcycle, which
+# limits the aggregated duty cycle to 1 / 2^MaxDCycle.
+#
+# usage: dutycycle_sim.py [--rate 20000] [--snr 0] [--dr 2] [--hours 24] ...
+
+from __future__ import print_function
+
+import argparse
+import os
+import random
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'lorawan_host'))
+import lorawan_host
+
+from lorawan_sim import DR_TO_SF, RECEIVE_DELAY1, SF_SNR_FLOOR
+
+LORAWAN_QUEUE_SIZE = 256
+QUEUE_RECORD_HEADER = 3
+APP_PORT = 2
+SRV_MAC_DUTY_CYCLE_REQ = 0x04
+
+KEY = bytes(bytearray(range(16)))
+
+REGIONS = [('EU868', lorawan_host.LORAMAC_REGION_EU868), ('AS923', lorawan_host.LORAMAC_REGION_AS923)]
+
+class Record(object):
+    __slots__ = ('arrival', 'size', 'urgent')
+
+    def __init__(self, arrival, size, urgent):
+        self.arrival = arrival
+        self.size = size
+        self.urgent = urgent
+
+class Node(object):
+    def __init__(self, host, args, region, policy, seed):
+        self.host = host
+        self.args = args
+        self.rng = random.Random(seed)
+        host.reset(seed)
+        self.id = host.create(region=region[1])
+        host.abp(self.id, 0x26000001, KEY, KEY, datarate=args.dr, adr=False)
+        host.channels(self.id, (1 << args.channels) - 1)
+        self.duty_cycle_req = args.as923_max_dcycle if region[0] == 'AS923' else None
+        if policy != 'default':
+            host.scheduler('throughput', args.policy_margin, policy == 'reserve', args.max_delay)
+        host.link_margin(args.snr - SF_SNR_FLOOR[DR_TO_SF[args.dr]], args.dr)
+        self.queue = []
+        self.queue_bytes = 0
+        self.in_flight = []
+        self.busy = False
+        self.confirms = 0
+        self.dropped = 0
+        self.frames = 0
+        self.dr_sum = 0
+        self.delivered = 0
+        self.lost = 0
+        self.urgent_latency = []
+
+    def enqueue(self, record):
+        # LoRaWanClass::enqueue evicts bulk before normal, never urgent
+        need = record.size + QUEUE_RECORD_HEADER
+        while self.queue_bytes + need > LORAWAN_QUEUE_SIZE:
+            victims = [r for r in self.queue if not r.urgent]
+            if not victims:
+                self.dropped += record.size
+                return
+            victim = victims[0]
+            self.queue.remove(victim)
+            self.queue_bytes -= victim.size + QUEUE_RECORD_HEADER
+            self.dropped += victim.size
+        self.queue.append(record)
+        self.queue_bytes += need
+
+    def build(self):
+        # queueBuild, or the first record alone when MAC commands leave no room
+        room = self.host.tx_possible(self.id)
+        frame = []
+        for urgent in (True, False):
+            for r in self.queue:
+                if r.urgent == urgent and r.size <= room:
+                    frame.append(r)
+                    room -= r.size
+        if not frame and self.host.tx_possible(self.id, self.queue[0].size) >= 0:
+            frame = [self.queue[0]]
+        return frame
+
+    def drain(self):
+        frame = self.build()
+        if not frame:
+            # Record that never fits, LoRaWanClass drops it
+            record = self.queue.pop(0)
+            self.queue_bytes -= record.size + QUEUE_RECORD_HEADER
+            self.dropped += record.size
+            return
+        urgent = any(r.urgent for r in frame)
+        if urgent:
+            self.host.mark_urgent()
+        payload = bytes(bytearray(sum(r.size for r in frame)))
+        status = self.host.send(self.id, APP_PORT, payload, datarate=self.args.dr)
+        if status != lorawan_host.LORAMAC_STATUS_OK:
+            if urgent:
+                self.host.lib.LoRaMacSchedulerTakeUrgent()
+            return
+        for r in frame:
+            self.queue.remove(r)
+            self.queue_bytes -= r.size + QUEUE_RECORD_HEADER
+        self.in_flight = frame
+        self.busy = True
+
+    def uplink(self, uplink):
+        size = sum(r.size for r in self.in_flight)
+        self.frames += 1
+        self.dr_sum += 12 - uplink.Sf
+        margin = self.args.snr - SF_SNR_FLOOR[uplink.Sf] + self.rng.gauss(0, self.args.fading)
+        if margin >= 0:
+            if self.duty_cycle_req is not None:
+                # in RX1, on the uplink channel and datarate
+                self.host.downlink_fopts(self.id, uplink.End + RECEIVE_DELAY1, uplink.Frequency, 12 - uplink.Sf, -100,
+                                         int(self.args.snr), 1, [SRV_MAC_DUTY_CYCLE_REQ, self.duty_cycle_req])
+                self.duty_cycle_req = None
+            self.delivered += size
+            for r in self.in_flight:
+                if r.urgent:
+                    self.urgent_latency.append(uplink.End - r.arrival)
+        else:
+            self.lost += size
+        self.in_flight = []
+
+    def run(self, arrivals):
+        host = self.host
+        end = int(self.args.hours * 3600 * 1000)
+        i = 0
+        while True:
+            # McpsConfirm comes after the receive windows, then the MAC is free
+            if self.busy and host.stats(self.id).McpsConfirms > self.confirms:
+                self.confirms += 1
+                self.busy = False
+            if not self.busy and self.queue:
+                self.drain()
+                if not self.busy and self.queue:
+                    continue
+            when = min(arrivals[i].arrival if i < len(arrivals) else end + 1, host.next_event())
+            if when > end:
+                break
+            host.run_until(when)
+            while i < len(arrivals) and arrivals[i].arrival <= when:
+                self.enqueue(arrivals[i])
+                i += 1
+            for uplink in host.uplinks():
+                self.uplink(uplink)
+        return self.report()
+
+    def report(self):
+        hours = float(self.args.hours)
+        lat = sorted(self.urgent_latency)
+        return {
+            'delivered': self.delivered / hours,
+            'lost': self.lost / hours,
+            'dropped': self.dropped / hours,
+            'frames': self.frames / hours,
+            'dr': self.dr_sum / float(self.frames) if self.frames else 0.0,
+            'urgent_p50': lat[len(lat) // 2] / 1000.0 if lat else 0.0,
+            'urgent_p95': lat[int(len(lat) * 0.95)] / 1000.0 if lat else 0.0,
+        }
+
+def make_arrivals(args, seed):
+    rng = random.Random(seed)
+    end = args.hours * 3600 * 1000
+    mean_gap = 3600 * 1000.0 * args.record / args.rate
+    arrivals = []
+    t = rng.expovariate(1.0 / mean_gap)
+    while t < end:
+        arrivals.append(Record(int(t), args.record, rng.random() < args.urgent))
+        t += rng.expovariate(1.0 / mean_gap)
+    return arrivals
+
+def main():
+    parser = argparse.ArgumentParser(description='Duty cycle limited throughput of one node, EU868 and AS923')
+    parser.add_argument('--hours', type=float, default=24)
+    parser.add_argument('--rate', type=float, default=20000, help='offered load [bytes/hour]')
+    parser.add_argument('--record', type=int, default=10, help='record size [bytes]')
+    parser.add_argument('--urgent', type=float, default=0.05, help='fraction of urgent records')
+    parser.add_argument('--dr', type=int, default=2, help='datarate configured by the application')
+    parser.add_argument('--snr', type=float, default=0.0, help='mean uplink SNR at the gateway [dB]')
+    parser.add_argument('--fading', type=float, default=3.0, help='per frame fading sigma [dB]')
+    parser.add_argument('--channels', type=int, default=8, help='enabled channels')
+    parser.add_argument('--as923-max-dcycle', type=int, default=7,
+                        help='MaxDCycle of the DutyCycleReq sent to AS923 nodes, aggregated duty cycle 1/2^n')
+    parser.add_argument('--policy-margin', type=int, default=10, help='throughput policy margin [dB]')
+    parser.add_argument('--max-delay', type=int, default=60000, help='throughput policy MaxDelay [ms]')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    host = lorawan_host.Host()
+    arrivals = make_arrivals(args, args.seed)
+    print('offered %.0f bytes/hour, %d byte records, %.0f%% urgent, SNR %.1f dB' % (
+        args.rate, args.record, 100.0 * args.urgent, args.snr))
+    print('%-6s %-10s %6s %9s %12s %10s %10s %10s %10s' % ('region', 'scheduler', 'DR', 'frames/h', 'delivered/h',
+                                                         'lost/h', 'dropped/h', 'urg p50 s', 'urg p95 s'))
+    for region in REGIONS:
+        for policy in ('default', 'throughput', 'reserve'):
+            node = Node(host, args, region, policy, args.seed)
+            r = node.run([Record(a.arrival, a.size, a.urgent) for a in arrivals])
+            print('%-6s %-10s %6.2f %9.1f %12.0f %10.0f %10.0f %10.1f %10.1f' % (
+                region[0], policy, r['dr'], r['frames'], r['delivered'], r['lost'], r['dropped'],
+                r['urgent_p50'], r['urgent_p95']))
+
+if __name__ == '__main__':
+    main()
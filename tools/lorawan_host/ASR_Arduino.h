@@ -0,0 +1,20 @@
+/*!
+ * \file      ASR_Arduino.h
+ *
+ * \brief     Host stand-in for the core header, the MAC sources only need
+ *            the standard types, micros() and the critical sections from it
+ */
+#ifndef __ASR_Arduino__
+#define __ASR_Arduino__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+uint32_t micros(void);
+
+// the host MAC runs in one thread
+#define CyEnterCriticalSection() 0
+#define CyExitCriticalSection(state) ((void)(state))
+
+#endif
@@ -0,0 +1,1253 @@
+/*!
+ * \file      host.c
+ *
+ * \brief     Host build of the LoRa MAC, see host.h
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "LoRaMac.h"
+#include "LoRaMacCrypto.h"
+#include "LoRaMacRecorder.h"
+#include "region/RegionEU868.h"
+#include "region/RegionAS923.h"
+#include "radio.h"
+#include "host.h"
+
+/*!
+ * Running timer and the node that started it
+ */
+typedef struct sHostTimer
+{
+    TimerEvent_t *Obj;
+    struct sHostNode *Node;
+    uint32_t Seq;
+} HostTimer_t;
+
+typedef enum eHostRadioDone
+{
+    HOST_DONE_NONE,
+    HOST_DONE_TX,
+    HOST_DONE_RX,
+    HOST_DONE_RX_TIMEOUT,
+    HOST_DONE_CAD,
+} HostRadioDone_t;
+
+typedef struct sHostRadio
+{
+    RadioState_t State;
+    uint32_t Frequency;
+    uint32_t TxSf;
+    uint32_t TxBandwidth;
+    int8_t TxPower;
+    uint16_t TxPreamble;
+    uint32_t RxSf;
+    uint32_t RxBandwidth;
+    uint16_t RxSymbTimeout;
+    bool RxContinuous;
+    /*!
+     * Completes the current TX, RX or CAD
+     */
+    TimerEvent_t Done;
+    HostRadioDone_t DoneEvent;
+    TimerTime_t StateSince;
+    uint32_t TxTime;
+    uint32_t RxTime;
+    uint32_t CadTime;
+} HostRadio_t;
+
+/*!
+ * Frame the network sends in a receive window
+ */
+typedef struct sHostDownlink
+{
+    bool Pending;
+    TimerTime_t Start;
+    uint32_t Frequency;
+    uint32_t Sf;
+    int16_t Rssi;
+    int8_t Snr;
+    uint8_t Size;
+    uint8_t Payload[32];
+} HostDownlink_t;
+
+typedef struct sHostNode
+{
+    LoRaMacCtx_t *Ctx;
+    LoRaMacRegion_t Region;
+    int Index;
+    bool Passive;
+    HostRadio_t Radio;
+    HostNodeStats_t Stats;
+    uint32_t DevAddr;
+    uint8_t NwkSKey[16];
+    uint8_t AppSKey[16];
+    uint8_t DevEui[8];
+    uint8_t AppEui[8];
+    uint8_t AppKey[16];
+    uint8_t TxBuffer[255];
+    HostDownlink_t Downlink;
+    /*!
+     * The MAC decrypts in place
+     */
+    uint8_t RxBuffer[32];
+    /*!
+     * Position for the CAD model [m]
+     */
+    double X;
+    double Y;
+} HostNode_t;
+
+#define HOST_MAX_NODES 4096
+
+/*!
+ * Preamble symbols the receiver needs to detect a frame
+ */
+#define LORA_MIN_PREAMBLE_SYMBOLS 4
+
+static HostNode_t *Nodes[HOST_MAX_NODES];
+static int NbNodes;
+
+static HostTimer_t *Timers;
+static int NbTimers;
+static int MaxTimers;
+static uint32_t TimerSeq;
+
+static TimerTime_t Now;
+
+/*!
+ * CAD model, see HostSetMedium. With MediumGamma 0 there is no floor.
+ */
+static double MediumPl0;
+static double MediumGamma;
+static double CadFloor;
+static double CadDetect = 1.0;
+
+/*!
+ * Every uplink of an active node, popped by HostNextUplink. Air keeps the
+ * ones that may still overlap a CAD.
+ */
+static HostUplink_t *Uplinks;
+static int NbUplinks;
+static int MaxUplinks;
+static int UplinkRead;
+
+static HostUplink_t *Air;
+static int NbAir;
+static int MaxAir;
+
+/*!
+ * Node whose context is selected
+ */
+static HostNode_t *Current;
+
+static RadioEvents_t *MacRadioEvents;
+
+static LoRaMacPrimitives_t Primitives;
+static LoRaMacCallback_t Callbacks;
+
+/*
+ * Symbols the MAC and the region take from the Arduino core and the
+ * LoRaWan_APP layer
+ */
+int8_t defaultDrForNoAdr = 5;
+int8_t currentDrForNoAdr;
+
+void DBG_PRINTF(const char *format, ...)
+{
+    (void)format;
+}
+
+void saveNetInfo(uint8_t *data, uint8_t size)
+{
+    (void)data;
+    (void)size;
+}
+
+void saveDownCnt(void)
+{
+}
+
+uint32_t micros(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+static HostNode_t *Select(HostNode_t *node)
+{
+    HostNode_t *prev = Current;
+
+    Current = node;
+    LoRaMacSetContext((node != NULL) ? node->Ctx : NULL);
+    return prev;
+}
+
+/*
+ * Timer server
+ */
+extern TimerSysTime_t TimerAddSysTime(TimerSysTime_t a, TimerSysTime_t b);
+extern TimerSysTime_t TimerSubSysTime(TimerSysTime_t a, TimerSysTime_t b);
+
+static TimerSysTime_t SysTimeOffset;
+
+static int TimerFind(TimerEvent_t *obj)
+{
+    int i;
+
+    for (i = 0; i < NbTimers; i++)
+    {
+        if (Timers[i].Obj == obj)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TimerInit(TimerEvent_t *obj, void (*callback)(void))
+{
+    TimerStop(obj);
+    obj->Timestamp = 0;
+    obj->ReloadValue = 0;
+    obj->IsRunning = false;
+    obj->Callback = callback;
+    obj->Next = NULL;
+}
+
+void TimerSetValue(TimerEvent_t *obj, uint32_t value)
+{
+    TimerStop(obj);
+    obj->ReloadValue = value;
+}
+
+void TimerStart(TimerEvent_t *obj)
+{
+    int i = TimerFind(obj);
+
+    if (i < 0)
+    {
+        if (NbTimers == MaxTimers)
+        {
+            MaxTimers = (MaxTimers == 0) ? 64 : MaxTimers * 2;
+            Timers = realloc(Timers, MaxTimers * sizeof(HostTimer_t));
+        }
+        i = NbTimers++;
+    }
+    Timers[i].Obj = obj;
+    Timers[i].Node = Current;
+    Timers[i].Seq = TimerSeq++;
+    obj->Timestamp = Now + obj->ReloadValue;
+    obj->IsRunning = true;
+}
+
+void TimerStop(TimerEvent_t *obj)
+{
+    int i = TimerFind(obj);
+
+    if (i >= 0)
+    {
+        Timers[i] = Timers[--NbTimers];
+    }
+    obj->IsRunning = false;
+}
+
+void TimerReset(TimerEvent_t *obj)
+{
+    TimerStop(obj);
+    TimerStart(obj);
+}
+
+TimerTime_t TimerGetCurrentTime(void)
+{
+    return Now;
+}
+
+TimerTime_t TimerGetElapsedTime(TimerTime_t savedTime)
+{
+    return Now - savedTime;
+}
+
+TimerSysTime_t SysTimeGetMcuTime(void)
+{
+    TimerSysTime_t t;
+
+    t.Seconds = Now / 1000;
+    t.SubSeconds = Now % 1000;
+    return t;
+}
+
+TimerSysTime_t TimerGetSysTime(void)
+{
+    return TimerAddSysTime(SysTimeGetMcuTime(), SysTimeOffset);
+}
+
+void TimerSetSysTime(TimerSysTime_t sysTime)
+{
+    SysTimeOffset = TimerSubSysTime(sysTime, SysTimeGetMcuTime());
+}
+
+TimerTime_t HostNow(void)
+{
+    return Now;
+}
+
+static int NextTimer(void)
+{
+    int next = -1;
+    int i;
+
+    for (i = 0; i < NbTimers; i++)
+    {
+        if ((next < 0) || (Timers[i].Obj->Timestamp < Timers[next].Obj->Timestamp) ||
+            ((Timers[i].Obj->Timestamp == Timers[next].Obj->Timestamp) && (Timers[i].Seq < Timers[next].Seq)))
+        {
+            next = i;
+        }
+    }
+    return next;
+}
+
+TimerTime_t HostNextEvent(void)
+{
+    int next = NextTimer();
+
+    return (next < 0) ? HOST_NO_EVENT : Timers[next].Obj->Timestamp;
+}
+
+void HostRunUntil(TimerTime_t time)
+{
+    int next;
+
+    while (((next = NextTimer()) >= 0) && (Timers[next].Obj->Timestamp <= time))
+    {
+        TimerEvent_t *obj = Timers[next].Obj;
+        HostNode_t *prev = Select(Timers[next].Node);
+
+        Now = obj->Timestamp;
+        TimerStop(obj);
+        if (obj->Callback != NULL)
+        {
+            obj->Callback();
+        }
+        Select(prev);
+    }
+    if (time > Now)
+    {
+        Now = time;
+    }
+}
+
+/*
+ * Radio
+ */
+static uint32_t SymbolTime(uint32_t sf, uint32_t bandwidth)
+{
+    static const uint32_t Hz[] = {125000, 250000, 500000};
+
+    // [us]
+    return (uint32_t)((1000000ull << sf) / Hz[(bandwidth < 3) ? bandwidth : 0]);
+}
+
+/*!
+ * Same expression as the SX126x driver for the LoRa modem, explicit header,
+ * CRC on, coding rate 4/5
+ */
+static uint32_t LoRaTimeOnAir(uint32_t sf, uint32_t bandwidth, uint16_t preamble, uint8_t pktLen)
+{
+    double ts = SymbolTime(sf, bandwidth) / 1000.0;
+    int lowDr = (((bandwidth == 0) && (sf >= 11)) || ((bandwidth == 1) && (sf == 12))) ? 1 : 0;
+    double tmp = ceil((8.0 * pktLen - 4.0 * sf + 28 + 16) / (4.0 * (sf - 2 * lowDr))) * 5;
+    double nPayload = 8 + ((tmp > 0) ? tmp : 0);
+
+    return (uint32_t)floor((preamble + 4.25) * ts + nPayload * ts + 0.999);
+}
+
+static void RadioAccount(HostRadio_t *radio)
+{
+    uint32_t elapsed = Now - radio->StateSince;
+
+    switch (radio->State)
+    {
+    case RF_TX_RUNNING:
+        radio->TxTime += elapsed;
+        break;
+    case RF_RX_RUNNING:
+        radio->RxTime += elapsed;
+        break;
+    case RF_CAD:
+        radio->CadTime += elapsed;
+        break;
+    default:
+        break;
+    }
+    radio->StateSince = Now;
+}
+
+static void RadioSetState(HostRadio_t *radio, RadioState_t state)
+{
+    RadioAccount(radio);
+    radio->State = state;
+}
+
+/*!
+ * CAD only sees frames of the same spreading factor on the same channel,
+ * arriving above its floor, and then misses some of them
+ */
+static bool ChannelBusy(TimerTime_t start, TimerTime_t end, uint32_t frequency, uint32_t sf)
+{
+    int i;
+
+    for (i = 0; i < NbAir; i++)
+    {
+        if ((Air[i].Node != Current->Index) && (Air[i].Frequency == frequency) && (Air[i].Sf == sf) &&
+            (Air[i].Start < end) && (start < Air[i].End))
+        {
+            if (MediumGamma > 0)
+            {
+                HostNode_t *other = Nodes[Air[i].Node];
+                double distance = hypot(other->X - Current->X, other->Y - Current->Y);
+                double loss = MediumPl0 + 10 * MediumGamma * log10(((distance > 1) ? distance : 1) / 40.0);
+
+                // the floor drops by 2.5 dB per spreading factor
+                if (Air[i].Power - loss < CadFloor - 2.5 * (sf - 7))
+                {
+                    continue;
+                }
+            }
+            if ((CadDetect < 1.0) && (rand() >= CadDetect * ((double)RAND_MAX + 1)))
+            {
+                continue;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void LogUplink(HostRadio_t *radio, const uint8_t *buffer, uint8_t size, uint32_t timeOnAir)
+{
+    HostUplink_t uplink;
+    int i;
+    int keep = 0;
+
+    memset(&uplink, 0, sizeof(uplink));
+    uplink.Node = Current->Index;
+    uplink.Frequency = radio->Frequency;
+    uplink.Sf = radio->TxSf;
+    uplink.Power = radio->TxPower;
+    uplink.Start = Now;
+    uplink.End = Now + timeOnAir;
+    uplink.Size = size;
+    memcpy(uplink.Payload, buffer, size);
+
+    if (NbUplinks == MaxUplinks)
+    {
+        MaxUplinks = (MaxUplinks == 0) ? 64 : MaxUplinks * 2;
+        Uplinks = realloc(Uplinks, MaxUplinks * sizeof(HostUplink_t));
+    }
+    Uplinks[NbUplinks++] = uplink;
+
+    // a CAD ends before the next frame can start, older frames are not needed
+    for (i = 0; i < NbAir; i++)
+    {
+        if (Air[i].End + 1000 > Now)
+        {
+            Air[keep++] = Air[i];
+        }
+    }
+    NbAir = keep;
+    if (NbAir == MaxAir)
+    {
+        MaxAir = (MaxAir == 0) ? 64 : MaxAir * 2;
+        Air = realloc(Air, MaxAir * sizeof(HostUplink_t));
+    }
+    Air[NbAir++] = uplink;
+}
+
+int HostNextUplink(HostUplink_t *uplink)
+{
+    if (UplinkRead == NbUplinks)
+    {
+        UplinkRead = 0;
+        NbUplinks = 0;
+        return 0;
+    }
+    *uplink = Uplinks[UplinkRead++];
+    return 1;
+}
+
+static void RadioOnDone(void)
+{
+    HostRadio_t *radio = &Current->Radio;
+    HostRadioDone_t event = radio->DoneEvent;
+
+    radio->DoneEvent = HOST_DONE_NONE;
+    switch (event)
+    {
+    case HOST_DONE_TX:
+        RadioSetState(radio, RF_IDLE);
+        if (MacRadioEvents->TxDone != NULL)
+        {
+            MacRadioEvents->TxDone();
+        }
+        break;
+    case HOST_DONE_RX:
+        RadioSetState(radio, RF_IDLE);
+        memcpy(Current->RxBuffer, Current->Downlink.Payload, Current->Downlink.Size);
+        Current->Downlink.Pending = false;
+        if (MacRadioEvents->RxDone != NULL)
+        {
+            MacRadioEvents->RxDone(Current->RxBuffer, Current->Downlink.Size, Current->Downlink.Rssi,
+                                   Current->Downlink.Snr);
+        }
+        break;
+    case HOST_DONE_RX_TIMEOUT:
+        RadioSetState(radio, RF_IDLE);
+        if (MacRadioEvents->RxTimeout != NULL)
+        {
+            MacRadioEvents->RxTimeout();
+        }
+        break;
+    case HOST_DONE_CAD:
+    {
+        bool busy = ChannelBusy(radio->StateSince, Now, radio->Frequency, radio->TxSf);
+
+        RadioSetState(radio, RF_IDLE);
+        if (busy)
+        {
+            Current->Stats.CadBusy++;
+        }
+        if (MacRadioEvents->CadDone != NULL)
+        {
+            MacRadioEvents->CadDone(busy);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void RadioComplete(HostRadio_t *radio, HostRadioDone_t event, uint32_t delay)
+{
+    TimerStop(&radio->Done);
+    radio->DoneEvent = HOST_DONE_NONE;
+    if (Current->Passive)
+    {
+        // the log provides the events
+        return;
+    }
+    radio->DoneEvent = event;
+    TimerSetValue(&radio->Done, delay);
+    TimerStart(&radio->Done);
+}
+
+static int HostRadioInit(RadioEvents_t *events)
+{
+    MacRadioEvents = events;
+    return 0;
+}
+
+static RadioState_t HostRadioGetStatus(void)
+{
+    return Current->Radio.State;
+}
+
+static void HostRadioSetModem(RadioModems_t modem)
+{
+    (void)modem;
+}
+
+static void HostRadioSetChannel(uint32_t freq)
+{
+    Current->Radio.Frequency = freq;
+}
+
+static bool HostRadioIsChannelFree(RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime)
+{
+    (void)modem;
+    (void)freq;
+    (void)rssiThresh;
+    (void)maxCarrierSenseTime;
+    return true;
+}
+
+static uint32_t HostRadioRandom(void)
+{
+    return (uint32_t)rand();
+}
+
+static void HostRadioSetRxConfig(RadioModems_t modem, uint32_t bandwidth, uint32_t datarate, uint8_t coderate,
+                                 uint32_t bandwidthAfc, uint16_t preambleLen, uint16_t symbTimeout, bool fixLen,
+                                 uint8_t payloadLen, bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted,
+                                 bool rxContinuous)
+{
+    HostRadio_t *radio = &Current->Radio;
+
+    radio->RxSf = datarate;
+    radio->RxBandwidth = bandwidth;
+    radio->RxSymbTimeout = symbTimeout;
+    radio->RxContinuous = rxContinuous;
+}
+
+static void HostRadioSetTxConfig(RadioModems_t modem, int8_t power, uint32_t fdev, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate, uint16_t preambleLen, bool fixLen,
+                                 bool crcOn, bool freqHopOn, uint8_t hopPeriod, bool iqInverted, uint32_t timeout)
+{
+    HostRadio_t *radio = &Current->Radio;
+
+    radio->TxPower = power;
+    radio->TxBandwidth = bandwidth;
+    radio->TxSf = datarate;
+    radio->TxPreamble = preambleLen;
+}
+
+static bool HostRadioCheckRfFrequency(uint32_t frequency)
+{
+    (void)frequency;
+    return true;
+}
+
+static uint32_t HostRadioTimeOnAir(RadioModems_t modem, uint8_t pktLen)
+{
+    HostRadio_t *radio = &Current->Radio;
+
+    return LoRaTimeOnAir(radio->TxSf, radio->TxBandwidth, radio->TxPreamble, pktLen);
+}
+
+static void HostRadioSend(uint8_t *buffer, uint8_t size)
+{
+    HostRadio_t *radio = &Current->Radio;
+    uint32_t timeOnAir = LoRaTimeOnAir(radio->TxSf, radio->TxBandwidth, radio->TxPreamble, size);
+
+    if (!Current->Passive)
+    {
+        LogUplink(radio, buffer, size, timeOnAir);
+    }
+    RadioSetState(radio, RF_TX_RUNNING);
+    RadioComplete(radio, HOST_DONE_TX, timeOnAir);
+}
+
+static void HostRadioSleep(void)
+{
+    HostRadio_t *radio = &Current->Radio;
+
+    TimerStop(&radio->Done);
+    radio->DoneEvent = HOST_DONE_NONE;
+    RadioSetState(radio, RF_IDLE);
+}
+
+static void HostRadioRx(uint32_t timeout)
+{
+    HostRadio_t *radio = &Current->Radio;
+    uint32_t window = timeout;
+    uint32_t symbol = SymbolTime(radio->RxSf, radio->RxBandwidth);
+
+    // single reception stops after the symbol timeout without a preamble
+    if (!radio->RxContinuous && (radio->RxSymbTimeout != 0))
+    {
+        window = (radio->RxSymbTimeout * symbol + 999) / 1000;
+    }
+    RadioSetState(radio, RF_RX_RUNNING);
+
+    if (Current->Downlink.Pending && (Current->Downlink.Start + 1000 < Now))
+    {
+        Current->Downlink.Pending = false;
+    }
+    // the window has to open before the downlink preamble starts or while
+    // enough of it is left to lock on, LORA_MIN_PREAMBLE_SYMBOLS
+    if (Current->Downlink.Pending && (Current->Downlink.Frequency == radio->Frequency) &&
+        (Current->Downlink.Sf == radio->RxSf) &&
+        (Now * 1000 <= Current->Downlink.Start * 1000 + (8 - LORA_MIN_PREAMBLE_SYMBOLS) * symbol) &&
+        ((window == 0) || (Current->Downlink.Start <= Now + window)))
+    {
+        RadioComplete(radio, HOST_DONE_RX,
+                      Current->Downlink.Start - Now +
+                          LoRaTimeOnAir(radio->RxSf, radio->RxBandwidth, 8, Current->Downlink.Size));
+    }
+    else if (window != 0)
+    {
+        RadioComplete(radio, HOST_DONE_RX_TIMEOUT, window);
+    }
+}
+
+static void HostRadioStartCad(uint8_t symbols)
+{
+    HostRadio_t *radio = &Current->Radio;
+
+    RadioSetState(radio, RF_CAD);
+    RadioComplete(radio, HOST_DONE_CAD, (symbols * SymbolTime(radio->TxSf, radio->TxBandwidth) + 999) / 1000);
+}
+
+static void HostRadioSetTxContinuousWave(uint32_t freq, int8_t power, uint16_t time)
+{
+}
+
+static int16_t HostRadioRssi(RadioModems_t modem)
+{
+    return -120;
+}
+
+static void HostRadioWrite(uint16_t addr, uint8_t data)
+{
+}
+
+static uint8_t HostRadioRead(uint16_t addr)
+{
+    return 0;
+}
+
+static void HostRadioWriteBuffer(uint16_t addr, uint8_t *buffer, uint8_t size)
+{
+}
+
+static void HostRadioReadBuffer(uint16_t addr, uint8_t *buffer, uint8_t size)
+{
+}
+
+static void HostRadioSetSyncWord(uint8_t data)
+{
+}
+
+static void HostRadioSetMaxPayloadLength(RadioModems_t modem, uint8_t max)
+{
+}
+
+static void HostRadioSetPublicNetwork(bool enable)
+{
+}
+
+static uint32_t HostRadioGetWakeupTime(void)
+{
+    return 2;
+}
+
+static void HostRadioIrqProcess(void)
+{
+}
+
+static void HostRadioSetRxDutyCycle(uint32_t rxTime, uint32_t sleepTime)
+{
+}
+
+const struct Radio_s Radio =
+{
+    HostRadioInit,
+    HostRadioGetStatus,
+    HostRadioSetModem,
+    HostRadioSetChannel,
+    HostRadioIsChannelFree,
+    HostRadioRandom,
+    HostRadioSetRxConfig,
+    HostRadioSetTxConfig,
+    HostRadioCheckRfFrequency,
+    HostRadioTimeOnAir,
+    HostRadioSend,
+    HostRadioSleep,
+    HostRadioSleep,
+    HostRadioRx,
+    HostRadioStartCad,
+    HostRadioSetTxContinuousWave,
+    HostRadioRssi,
+    HostRadioWrite,
+    HostRadioRead,
+    HostRadioWriteBuffer,
+    HostRadioReadBuffer,
+    HostRadioSetSyncWord,
+    HostRadioSetMaxPayloadLength,
+    HostRadioSetPublicNetwork,
+    HostRadioGetWakeupTime,
+    HostRadioIrqProcess,
+    HostRadioRx,
+    HostRadioSetRxDutyCycle,
+};
+
+/*
+ * MAC primitives
+ */
+static void McpsConfirm(McpsConfirm_t *confirm)
+{
+    HostNodeStats_t *stats = &Current->Stats;
+
+    stats->McpsConfirms++;
+    if (confirm->Status != LORAMAC_EVENT_INFO_STATUS_OK)
+    {
+        stats->McpsErrors++;
+    }
+    if (confirm->AckReceived)
+    {
+        stats->AcksReceived++;
+    }
+}
+
+static void McpsIndication(McpsIndication_t *indication)
+{
+    if (indication->Status == LORAMAC_EVENT_INFO_STATUS_OK)
+    {
+        Current->Stats.Downlinks++;
+    }
+}
+
+static void MlmeConfirm(MlmeConfirm_t *confirm)
+{
+    Current->Stats.MlmeConfirms++;
+    if ((confirm->MlmeRequest == MLME_JOIN) && (confirm->Status == LORAMAC_EVENT_INFO_STATUS_OK))
+    {
+        Current->Stats.Joined = true;
+    }
+}
+
+static void MlmeIndication(MlmeIndication_t *indication)
+{
+    (void)indication;
+}
+
+/*
+ * Nodes
+ */
+void HostReset(uint32_t seed)
+{
+    int i;
+
+    Select(NULL);
+    for (i = 0; i < NbNodes; i++)
+    {
+        free(Nodes[i]->Ctx);
+        free(Nodes[i]);
+    }
+    NbNodes = 0;
+    NbTimers = 0;
+    NbUplinks = 0;
+    UplinkRead = 0;
+    NbAir = 0;
+    MediumPl0 = 0;
+    MediumGamma = 0;
+    CadFloor = 0;
+    CadDetect = 1.0;
+    TimerSeq = 0;
+    Now = 0;
+    memset(&SysTimeOffset, 0, sizeof(SysTimeOffset));
+    srand(seed);
+}
+
+static HostNode_t *GetNode(int node)
+{
+    return ((node >= 0) && (node < NbNodes)) ? Nodes[node] : NULL;
+}
+
+int HostNodeCreate(bool passive, LoRaMacRegion_t region)
+{
+    size_t size = LoRaMacGetContextSize(region);
+    HostNode_t *node;
+    HostNode_t *prev;
+    int status;
+
+    if ((NbNodes == HOST_MAX_NODES) || (size == 0))
+    {
+        return -1;
+    }
+    node = calloc(1, sizeof(HostNode_t));
+    node->Ctx = LoRaMacContextInit(malloc(size), region);
+    node->Region = region;
+    node->Passive = passive;
+    TimerInit(&node->Radio.Done, RadioOnDone);
+
+    Primitives.MacMcpsConfirm = McpsConfirm;
+    Primitives.MacMcpsIndication = McpsIndication;
+    Primitives.MacMlmeConfirm = MlmeConfirm;
+    Primitives.MacMlmeIndication = MlmeIndication;
+
+    prev = Select(node);
+    status = LoRaMacInitialization(&Primitives, &Callbacks, region);
+    if (status == LORAMAC_STATUS_OK)
+    {
+        // the channel plan of lwan_dev_params_update
+        static uint16_t channelsMask[6] = {0x00FF, 0, 0, 0, 0, 0};
+        MibRequestConfirm_t mib;
+
+        if (region == LORAMAC_REGION_AS923)
+        {
+            LoRaMacChannelAdd(2, (ChannelParams_t)AS923_LC3);
+            LoRaMacChannelAdd(3, (ChannelParams_t)AS923_LC4);
+            LoRaMacChannelAdd(4, (ChannelParams_t)AS923_LC5);
+            LoRaMacChannelAdd(5, (ChannelParams_t)AS923_LC6);
+            LoRaMacChannelAdd(6, (ChannelParams_t)AS923_LC7);
+            LoRaMacChannelAdd(7, (ChannelParams_t)AS923_LC8);
+        }
+        else
+        {
+            LoRaMacChannelAdd(3, (ChannelParams_t)EU868_LC4);
+            LoRaMacChannelAdd(4, (ChannelParams_t)EU868_LC5);
+            LoRaMacChannelAdd(5, (ChannelParams_t)EU868_LC6);
+            LoRaMacChannelAdd(6, (ChannelParams_t)EU868_LC7);
+            LoRaMacChannelAdd(7, (ChannelParams_t)EU868_LC8);
+        }
+        mib.Type = MIB_CHANNELS_DEFAULT_MASK;
+        mib.Param.ChannelsMask = channelsMask;
+        LoRaMacMibSetRequestConfirm(&mib);
+        mib.Type = MIB_CHANNELS_MASK;
+        mib.Param.ChannelsMask = channelsMask;
+        LoRaMacMibSetRequestConfirm(&mib);
+    }
+    Select(prev);
+    if (status != LORAMAC_STATUS_OK)
+    {
+        free(node->Ctx);
+        free(node);
+        return -1;
+    }
+    node->Index = NbNodes;
+    Nodes[NbNodes] = node;
+    return NbNodes++;
+}
+
+int HostNodeChannels(int node, uint16_t mask)
+{
+    HostNode_t *n = GetNode(node);
+    HostNode_t *prev;
+    uint16_t channelsMask[6] = {0, 0, 0, 0, 0, 0};
+    MibRequestConfirm_t mib;
+    int status;
+
+    if (n == NULL)
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    channelsMask[0] = mask;
+    prev = Select(n);
+    mib.Type = MIB_CHANNELS_MASK;
+    mib.Param.ChannelsMask = channelsMask;
+    status = LoRaMacMibSetRequestConfirm(&mib);
+    Select(prev);
+    return status;
+}
+
+int HostNodeTxPossible(int node, uint8_t size)
+{
+    HostNode_t *n = GetNode(node);
+    HostNode_t *prev;
+    LoRaMacTxInfo_t txInfo;
+    int status;
+
+    if (n == NULL)
+    {
+        return -1;
+    }
+    prev = Select(n);
+    status = LoRaMacQueryTxPossible(size, &txInfo);
+    Select(prev);
+    return (status == LORAMAC_STATUS_OK) ? txInfo.MaxPossiblePayload : -1;
+}
+
+int HostNodeAbp(int node, uint32_t devAddr, const uint8_t *nwkSKey, const uint8_t *appSKey,
+                uint32_t upLinkCounter, uint32_t downLinkCounter, int8_t datarate, bool adr)
+{
+    HostNode_t *n = GetNode(node);
+    HostNode_t *prev;
+    MibRequestConfirm_t mib;
+
+    if (n == NULL)
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    n->DevAddr = devAddr;
+    memcpy(n->NwkSKey, nwkSKey, sizeof(n->NwkSKey));
+    memcpy(n->AppSKey, appSKey, sizeof(n->AppSKey));
+    prev = Select(n);
+    mib.Type = MIB_NET_ID;
+    mib.Param.NetID = 0;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_DEV_ADDR;
+    mib.Param.DevAddr = devAddr;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_NWK_SKEY;
+    mib.Param.NwkSKey = (uint8_t *)nwkSKey;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_APP_SKEY;
+    mib.Param.AppSKey = (uint8_t *)appSKey;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_UPLINK_COUNTER;
+    mib.Param.UpLinkCounter = upLinkCounter;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_DOWNLINK_COUNTER;
+    mib.Param.DownLinkCounter = downLinkCounter;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_ADR;
+    mib.Param.AdrEnable = adr;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_CHANNELS_DATARATE;
+    mib.Param.ChannelsDatarate = datarate;
+    LoRaMacMibSetRequestConfirm(&mib);
+    mib.Type = MIB_NETWORK_JOINED;
+    mib.Param.IsNetworkJoined = true;
+    LoRaMacMibSetRequestConfirm(&mib);
+    defaultDrForNoAdr = datarate;
+    Select(prev);
+    return LORAMAC_STATUS_OK;
+}
+
+void HostNodeJoinKeys(int node, const uint8_t *devEui, const uint8_t *appEui, const uint8_t *appKey)
+{
+    HostNode_t *n = GetNode(node);
+
+    if (n != NULL)
+    {
+        memcpy(n->DevEui, devEui, sizeof(n->DevEui));
+        memcpy(n->AppEui, appEui, sizeof(n->AppEui));
+        memcpy(n->AppKey, appKey, sizeof(n->AppKey));
+    }
+}
+
+static LoRaMacStatus_t Join(uint8_t nbTrials)
+{
+    MlmeReq_t mlmeReq;
+
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.DevEui = Current->DevEui;
+    mlmeReq.Req.Join.AppEui = Current->AppEui;
+    mlmeReq.Req.Join.AppKey = Current->AppKey;
+    mlmeReq.Req.Join.NbTrials = nbTrials;
+    return LoRaMacMlmeRequest(&mlmeReq);
+}
+
+int HostNodeSend(int node, uint8_t port, const uint8_t *data, uint8_t size, bool confirmed, int8_t datarate)
+{
+    HostNode_t *n = GetNode(node);
+    HostNode_t *prev;
+    McpsReq_t mcpsReq;
+    LoRaMacStatus_t status;
+
+    if (n == NULL)
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    memcpy(n->TxBuffer, data, size);
+    if (confirmed)
+    {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = port;
+        mcpsReq.Req.Confirmed.fBuffer = n->TxBuffer;
+        mcpsReq.Req.Confirmed.fBufferSize = size;
+        mcpsReq.Req.Confirmed.NbTrials = 8;
+        mcpsReq.Req.Confirmed.Datarate = datarate;
+    }
+    else
+    {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = port;
+        mcpsReq.Req.Unconfirmed.fBuffer = n->TxBuffer;
+        mcpsReq.Req.Unconfirmed.fBufferSize = size;
+        mcpsReq.Req.Unconfirmed.Datarate = datarate;
+    }
+    prev = Select(n);
+    status = LoRaMacMcpsRequest(&mcpsReq);
+    Select(prev);
+    return status;
+}
+
+int HostNodeDownlinkFOpts(int node, TimerTime_t start, uint32_t frequency, int8_t datarate, int16_t rssi,
+                          int8_t snr, uint32_t fCntDown, bool ack, const uint8_t *fOpts, uint8_t fOptsLen)
+{
+    HostNode_t *n = GetNode(node);
+    HostDownlink_t *downlink;
+    uint8_t *p;
+    uint8_t size = 0;
+    uint32_t mic;
+
+    if ((n == NULL) || (datarate < DR_0) || (datarate > DR_5) || (fOptsLen > 15))
+    {
+        return -1;
+    }
+    downlink = &n->Downlink;
+    p = downlink->Payload;
+
+    // unconfirmed data down, FHDR, MAC commands in FOpts, no FPort
+    p[size++] = FRAME_TYPE_DATA_UNCONFIRMED_DOWN << 5;
+    p[size++] = n->DevAddr & 0xFF;
+    p[size++] = (n->DevAddr >> 8) & 0xFF;
+    p[size++] = (n->DevAddr >> 16) & 0xFF;
+    p[size++] = (n->DevAddr >> 24) & 0xFF;
+    p[size++] = (ack ? 0x20 : 0) | fOptsLen;
+    p[size++] = fCntDown & 0xFF;
+    p[size++] = (fCntDown >> 8) & 0xFF;
+    memcpy(p + size, fOpts, fOptsLen);
+    size += fOptsLen;
+    LoRaMacComputeMic(p, size, n->NwkSKey, n->DevAddr, DOWN_LINK, fCntDown, &mic);
+    p[size++] = mic & 0xFF;
+    p[size++] = (mic >> 8) & 0xFF;
+    p[size++] = (mic >> 16) & 0xFF;
+    p[size++] = (mic >> 24) & 0xFF;
+
+    downlink->Size = size;
+    downlink->Start = start;
+    downlink->Frequency = frequency;
+    downlink->Sf = 12 - datarate;
+    downlink->Rssi = rssi;
+    downlink->Snr = snr;
+    downlink->Pending = true;
+    return 0;
+}
+
+int HostNodeDownlink(int node, TimerTime_t start, uint32_t frequency, int8_t datarate, int16_t rssi, int8_t snr,
+                     uint32_t fCntDown, bool ack, int8_t adrDatarate, int8_t adrTxPower)
+{
+    uint8_t fOpts[5];
+    uint8_t size = 0;
+
+    if (adrDatarate >= 0)
+    {
+        fOpts[size++] = SRV_MAC_LINK_ADR_REQ;
+        fOpts[size++] = (adrDatarate << 4) | (adrTxPower & 0x0F);
+        // channels 0..7 of lwan_dev_params_update, ChMaskCntl 0, NbRep 1
+        fOpts[size++] = 0xFF;
+        fOpts[size++] = 0x00;
+        fOpts[size++] = 0x01;
+    }
+    return HostNodeDownlinkFOpts(node, start, frequency, datarate, rssi, snr, fCntDown, ack, fOpts, size);
+}
+
+void HostNodeGetStats(int node, HostNodeStats_t *stats)
+{
+    HostNode_t *n = GetNode(node);
+    HostNode_t *prev;
+    MibRequestConfirm_t mib;
+
+    if (n == NULL)
+    {
+        memset(stats, 0, sizeof(HostNodeStats_t));
+        return;
+    }
+    prev = Select(n);
+    RadioAccount(&n->Radio);
+    n->Stats.TxTime = n->Radio.TxTime;
+    n->Stats.RxTime = n->Radio.RxTime;
+    n->Stats.CadTime = n->Radio.CadTime;
+    mib.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mib);
+    n->Stats.UpLinkCounter = mib.Param.UpLinkCounter;
+    mib.Type = MIB_DOWNLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mib);
+    n->Stats.DownLinkCounter = mib.Param.DownLinkCounter;
+    mib.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm(&mib);
+    n->Stats.Datarate = mib.Param.ChannelsDatarate;
+    n->Stats.MacState = LoRaMacState;
+    *stats = n->Stats;
+    Select(prev);
+}
+
+void HostSetMedium(double pl0, double gamma, double cadFloor, double cadDetect)
+{
+    MediumPl0 = pl0;
+    MediumGamma = gamma;
+    CadFloor = cadFloor;
+    CadDetect = cadDetect;
+}
+
+void HostNodePlace(int node, double x, double y)
+{
+    HostNode_t *n = GetNode(node);
+
+    if (n != NULL)
+    {
+        n->X = x;
+        n->Y = y;
+    }
+}
+
+void HostNodeCapture(int node, uint8_t *buffer, uint16_t size)
+{
+    HostNode_t *prev = Select(GetNode(node));
+
+    LoRaMacRecorderStart(buffer, size);
+    Select(prev);
+}
+
+/*
+ * Replay
+ */
+static HostReplayRecord_t *ReplayRecords;
+static int ReplayMax;
+static int ReplayCount;
+
+/*!
+ * Recorded time to virtual time
+ */
+static TimerTime_t ReplayOffset;
+
+static void ReplaySetTime(TimerTime_t timestamp)
+{
+    HostNode_t *node = Current;
+
+    HostRunUntil(timestamp + ReplayOffset);
+    Select(node);
+}
+
+static void ReplayEventDone(const LoRaMacRecord_t *record, uint32_t latency)
+{
+    HostReplayRecord_t *out;
+    MibRequestConfirm_t mib;
+
+    if (ReplayCount >= ReplayMax)
+    {
+        ReplayCount++;
+        return;
+    }
+    out = &ReplayRecords[ReplayCount++];
+    out->Event = record->Event;
+    out->RequestType = record->RequestType;
+    out->Timestamp = record->Timestamp;
+    out->RecordedUs = record->Duration;
+    out->ReplayUs = latency;
+    out->MacState = LoRaMacState;
+    mib.Type = MIB_UPLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mib);
+    out->UpLinkCounter = mib.Param.UpLinkCounter;
+    mib.Type = MIB_DOWNLINK_COUNTER;
+    LoRaMacMibGetRequestConfirm(&mib);
+    out->DownLinkCounter = mib.Param.DownLinkCounter;
+    out->McpsConfirms = Current->Stats.McpsConfirms;
+    out->Downlinks = Current->Stats.Downlinks;
+}
+
+int HostReplay(int node, const uint8_t *log, uint16_t size, const uint8_t *nwkSKey, const uint8_t *appSKey,
+               HostReplayRecord_t *records, int maxRecords)
+{
+    static LoRaMacReplayCallbacks_t callbacks = {ReplaySetTime, Join, ReplayEventDone};
+    LoRaMacRecordSession_t session;
+    HostNode_t *n = GetNode(node);
+    HostNode_t *prev;
+    LoRaMacRecord_t first;
+    uint16_t offset = 0;
+
+    if ((n == NULL) || (LoRaMacRecorderSession(log, size, &session) == false))
+    {
+        return -1;
+    }
+    HostNodeAbp(node, session.DevAddr, nwkSKey, appSKey, session.UpLinkCounter, session.DownLinkCounter,
+                session.Datarate, session.AdrCtrlOn);
+
+    // the first record happens now on the virtual clock
+    ReplayOffset = 0;
+    if (LoRaMacRecorderNext(log, size, &offset, &first))
+    {
+        ReplayOffset = Now - first.Timestamp;
+    }
+
+    ReplayRecords = records;
+    ReplayMax = maxRecords;
+    ReplayCount = 0;
+    prev = Select(n);
+    LoRaMacRecorderReplay(log, size, &callbacks);
+    // let the MAC finish what the last record started
+    HostRunUntil(Now + 10000);
+    Select(prev);
+    return ReplayCount;
+}
@@ -0,0 +1,219 @@
+/*!
+ * \file      host.h
+ *
+ * \brief     Host build of the LoRa MAC: virtual clock, timer server and
+ *            radio for any number of nodes in one process
+ *
+ * \details   Every node owns a LoRaMacCtx_t. The timer server and the radio
+ *            remember which node started a timer or drove the radio and
+ *            select that node's context before calling back into the MAC,
+ *            so LoRaMac.c and the region run unmodified.
+ *
+ *            Time only moves in HostRunUntil(). A passive node's radio never
+ *            raises events of its own, its events come from a recorder log
+ *            (HostReplay).
+ *
+ *            Active nodes share one medium: every frame they send is logged
+ *            for the caller (HostNextUplink) and may be seen by the CADs of
+ *            the others on the same frequency and spreading factor, see
+ *            HostSetMedium. What the network hears and answers is up to the
+ *            caller, which queues downlinks with HostNodeDownlink.
+ *
+ *            Built and loaded by lorawan_host.py.
+ */
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "LoRaMac.h"
+
+#define HOST_NO_EVENT 0xFFFFFFFFu
+
+typedef struct sHostNodeStats
+{
+    uint32_t McpsConfirms;
+    uint32_t McpsErrors;
+    uint32_t AcksReceived;
+    uint32_t Downlinks;
+    uint32_t MlmeConfirms;
+    /*!
+     * CADs that found the channel busy
+     */
+    uint32_t CadBusy;
+    bool Joined;
+    uint32_t UpLinkCounter;
+    uint32_t DownLinkCounter;
+    uint32_t MacState;
+    int8_t Datarate;
+    /*!
+     * Radio on time per mode [ms]
+     */
+    uint32_t TxTime;
+    uint32_t RxTime;
+    uint32_t CadTime;
+} HostNodeStats_t;
+
+/*!
+ * Frame sent by an active node
+ */
+typedef struct sHostUplink
+{
+    int Node;
+    uint32_t Frequency;
+    uint32_t Sf;
+    int8_t Power;
+    TimerTime_t Start;
+    TimerTime_t End;
+    uint8_t Size;
+    uint8_t Payload[255];
+} HostUplink_t;
+
+/*!
+ * One replayed record and what it did
+ */
+typedef struct sHostReplayRecord
+{
+    uint8_t Event;
+    uint8_t RequestType;
+    uint32_t Timestamp;
+    /*!
+     * Processing time on the device and on the host [us]
+     */
+    uint32_t RecordedUs;
+    uint32_t ReplayUs;
+    /*!
+     * MAC state right after the record
+     */
+    uint32_t MacState;
+    uint32_t UpLinkCounter;
+    uint32_t DownLinkCounter;
+    uint32_t McpsConfirms;
+    uint32_t Downlinks;
+} HostReplayRecord_t;
+
+/*!
+ * \brief   Drops all nodes and timers, the clock restarts at 0
+ */
+void HostReset(uint32_t seed);
+
+/*!
+ * \brief   Creates a node with the MAC initialized for the region, EU868 or
+ *          AS923, and the 8 channels of lwan_dev_params_update
+ *
+ * \retval  Node number, -1 on error
+ */
+int HostNodeCreate(bool passive, LoRaMacRegion_t region);
+
+/*!
+ * \brief   Enables the channels 0..15 set in mask
+ *
+ * \retval  LoRaMacStatus_t of the MIB request
+ */
+int HostNodeChannels(int node, uint16_t mask);
+
+/*!
+ * \brief   LoRaMacQueryTxPossible for a payload of size bytes
+ *
+ * \retval  Largest payload the next uplink can carry, -1 if size does not fit
+ */
+int HostNodeTxPossible(int node, uint8_t size);
+
+/*!
+ * \brief   Activates a node by personalization
+ */
+int HostNodeAbp(int node, uint32_t devAddr, const uint8_t *nwkSKey, const uint8_t *appSKey,
+                uint32_t upLinkCounter, uint32_t downLinkCounter, int8_t datarate, bool adr);
+
+/*!
+ * \brief   Keys used for join requests, including replayed ones
+ */
+void HostNodeJoinKeys(int node, const uint8_t *devEui, const uint8_t *appEui, const uint8_t *appKey);
+
+/*!
+ * \brief   Sends an uplink, the LoRaMacStatus_t of the request is returned
+ */
+int HostNodeSend(int node, uint8_t port, const uint8_t *data, uint8_t size, bool confirmed, int8_t datarate);
+
+/*!
+ * \brief   Queues the network's answer to an uplink: an unconfirmed downlink
+ *          without FPort, built and signed with the node's session keys.
+ *          The node receives it if it listens on frequency and datarate when
+ *          the preamble starts, otherwise it is dropped.
+ *
+ * \param   [IN] start       - Time the preamble starts
+ * \param   [IN] ack         - Acknowledges a confirmed uplink
+ * \param   [IN] adrDatarate - LinkADRReq datarate, -1 for no LinkADRReq
+ * \param   [IN] adrTxPower  - LinkADRReq TX power index
+ *
+ * \retval  0, -1 on invalid node or datarate
+ */
+int HostNodeDownlink(int node, TimerTime_t start, uint32_t frequency, int8_t datarate, int16_t rssi, int8_t snr,
+                     uint32_t fCntDown, bool ack, int8_t adrDatarate, int8_t adrTxPower);
+
+/*!
+ * \brief   Same as HostNodeDownlink with the MAC commands given in fOpts,
+ *          at most 15 bytes, e.g. a DutyCycleReq
+ */
+int HostNodeDownlinkFOpts(int node, TimerTime_t start, uint32_t frequency, int8_t datarate, int16_t rssi,
+                          int8_t snr, uint32_t fCntDown, bool ack, const uint8_t *fOpts, uint8_t fOptsLen);
+
+void HostNodeGetStats(int node, HostNodeStats_t *stats);
+
+/*!
+ * \brief   Sets the CAD model. A CAD sees a frame of another node only if it
+ *          arrives above the floor, with log-distance path loss between the
+ *          node positions, and then detects it with probability cadDetect.
+ *          Until called, and after HostReset, every overlap is detected.
+ *
+ * \param   [IN] pl0       - Path loss at 40 m [dB]
+ * \param   [IN] gamma     - Path loss exponent, 0 disables the floor
+ * \param   [IN] cadFloor  - Weakest frame a CAD sees at SF7 [dBm], 2.5 dB
+ *                           lower per spreading factor
+ * \param   [IN] cadDetect - Probability of detecting a frame above the floor
+ */
+void HostSetMedium(double pl0, double gamma, double cadFloor, double cadDetect);
+
+/*!
+ * \brief   Places a node for the CAD model [m]
+ */
+void HostNodePlace(int node, double x, double y);
+
+/*!
+ * \brief   Pops the oldest uplink not read yet
+ *
+ * \retval  1 if uplink was filled, 0 if there is none
+ */
+int HostNextUplink(HostUplink_t *uplink);
+
+/*!
+ * \brief   Starts a LoRaMacRecorder capture of the node's session, stopped
+ *          with LoRaMacRecorderStop
+ */
+void HostNodeCapture(int node, uint8_t *buffer, uint16_t size);
+
+TimerTime_t HostNow(void);
+
+/*!
+ * \brief   Expiry of the earliest running timer, HOST_NO_EVENT if none
+ */
+TimerTime_t HostNextEvent(void);
+
+/*!
+ * \brief   Fires every timer due up to time and leaves the clock there
+ */
+void HostRunUntil(TimerTime_t time);
+
+/*!
+ * \brief   Feeds a LoRaMacRecorder log through a passive node, activated
+ *          from the session in the log header with the given keys. The
+ *          first record is replayed at the current time, the others keep
+ *          their recorded spacing.
+ *
+ * \retval  Number of records replayed, -1 if the log is not valid
+ */
+int HostReplay(int node, const uint8_t *log, uint16_t size, const uint8_t *nwkSKey, const uint8_t *appSKey,
+               HostReplayRecord_t *records, int maxRecords);
+
+#endif // __HOST_H__
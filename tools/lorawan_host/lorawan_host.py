@@ -0,0 +1,251 @@
+#!/usr/bin/env python
+
+# Host build of the LoRa MAC: compiles LoRaMac.c, the EU868 and AS923
+# regions, the crypto and host.c into a shared library with the system gcc and loads it
+# with ctypes. The library is rebuilt when a source is newer than it.
+#
+# The MAC runs unmodified, one LoRaMacCtx_t per node, on the virtual clock
+# of host.c. See host.h for the API.
+
+from __future__ import print_function
+
+import ctypes
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, '..', '..'))
+LORAMAC = os.path.join(ROOT, 'libraries', 'LoraWan102', 'src', 'loramac')
+SYSTEM = os.path.join(ROOT, 'cores', 'asr650x', 'lora', 'system')
+
+SOURCES = [os.path.join(HERE, 'host.c')] + [os.path.join(LORAMAC, f) for f in (
+    'LoRaMac.c', 'LoRaMacConfirmQueue.c', 'LoRaMacClassB.c', 'LoRaMacCrypto.c',
+    'LoRaMacRecorder.c', 'LoRaMacClockSync.c', 'LoRaMacRxTiming.c', 'LoRaMacScheduler.c',
+    'region/Region.c', 'region/RegionCommon.c', 'region/RegionEU868.c', 'region/RegionAS923.c')] + [
+    os.path.join(SYSTEM, f) for f in ('utilities.c', 'crypto/aes.c', 'crypto/cmac.c')]
+
+INCLUDES = [HERE, LORAMAC, SYSTEM, os.path.join(SYSTEM, 'crypto'),
+            os.path.join(ROOT, 'cores', 'asr650x', 'board', 'inc'),
+            os.path.join(ROOT, 'libraries', 'LoraWan102', 'src', 'radio')]
+
+# AS923 with the AS1 channel plan (922.0 - 923.4 MHz)
+DEFINES = ['REGION_EU868', 'REGION_AS923', 'REGION_AS923_AS1', 'ACTIVE_REGION=LORAMAC_REGION_EU868',
+           'LORAWAN_PREAMBLE_LENGTH=8']
+
+HOST_NO_EVENT = 0xFFFFFFFF
+
+# TimerTime_t of utilities.h
+TimerTime = ctypes.c_uint64
+
+# LoRaMacRegion_t
+LORAMAC_REGION_AS923 = 0
+LORAMAC_REGION_EU868 = 5
+
+# LoRaMacStatus_t
+LORAMAC_STATUS_OK = 0
+LORAMAC_STATUS_BUSY = 1
+
+# LoRaMacRecordEvent_t
+RECORD_EVENTS = {1: 'TxDone', 2: 'TxTimeout', 3: 'RxDone', 4: 'RxTimeout',
+                 5: 'RxError', 6: 'CadDone', 7: 'Mcps', 8: 'Mlme'}
+
+
+class NodeStats(ctypes.Structure):
+    _fields_ = [('McpsConfirms', ctypes.c_uint32), ('McpsErrors', ctypes.c_uint32),
+                ('AcksReceived', ctypes.c_uint32), ('Downlinks', ctypes.c_uint32),
+                ('MlmeConfirms', ctypes.c_uint32), ('CadBusy', ctypes.c_uint32),
+                ('Joined', ctypes.c_bool),
+                ('UpLinkCounter', ctypes.c_uint32), ('DownLinkCounter', ctypes.c_uint32),
+                ('MacState', ctypes.c_uint32), ('Datarate', ctypes.c_int8),
+                ('TxTime', ctypes.c_uint32), ('RxTime', ctypes.c_uint32),
+                ('CadTime', ctypes.c_uint32)]
+
+
+class Uplink(ctypes.Structure):
+    _fields_ = [('Node', ctypes.c_int), ('Frequency', ctypes.c_uint32), ('Sf', ctypes.c_uint32),
+                ('Power', ctypes.c_int8), ('Start', TimerTime), ('End', TimerTime),
+                ('Size', ctypes.c_uint8), ('Payload', ctypes.c_uint8 * 255)]
+
+    def frame(self):
+        return bytes(bytearray(self.Payload[:self.Size]))
+
+
+class ThroughputParams(ctypes.Structure):
+    _fields_ = [('Margin', ctypes.c_int8), ('ReserveBand', ctypes.c_bool), ('MaxDelay', TimerTime)]
+
+
+class ReplayRecord(ctypes.Structure):
+    _fields_ = [('Event', ctypes.c_uint8), ('RequestType', ctypes.c_uint8),
+                ('Timestamp', ctypes.c_uint32), ('RecordedUs', ctypes.c_uint32),
+                ('ReplayUs', ctypes.c_uint32), ('MacState', ctypes.c_uint32),
+                ('UpLinkCounter', ctypes.c_uint32), ('DownLinkCounter', ctypes.c_uint32),
+                ('McpsConfirms', ctypes.c_uint32), ('Downlinks', ctypes.c_uint32)]
+
+
+def build(output=None, cc='gcc'):
+    """Builds the shared library if a source changed, returns its path."""
+    output = output or os.path.join(HERE, 'build', 'liblorawan_host.so')
+    headers = [os.path.join(d, f) for d in INCLUDES[:2] for f in os.listdir(d) if f.endswith('.h')]
+    if os.path.exists(output):
+        built = os.path.getmtime(output)
+        if all(os.path.getmtime(f) <= built for f in SOURCES + headers):
+            return output
+    if not os.path.isdir(os.path.dirname(output)):
+        os.makedirs(os.path.dirname(output))
+    cmd = [cc, '-shared', '-fPIC', '-O2', '-w', '-o', output]
+    cmd += ['-D' + d for d in DEFINES] + ['-I' + i for i in INCLUDES]
+    cmd += SOURCES + ['-lm']
+    try:
+        subprocess.check_call(cmd)
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('%s: %s' % (cc, e))
+    return output
+
+
+def _buffer(data):
+    data = bytes(bytearray(data))
+    return (ctypes.c_uint8 * max(len(data), 1)).from_buffer_copy(data or b'\0'), len(data)
+
+
+class Host(object):
+    def __init__(self, library=None):
+        self.lib = ctypes.CDLL(library or build())
+        lib = self.lib
+        lib.HostNodeCreate.argtypes = [ctypes.c_bool, ctypes.c_int]
+        lib.HostNodeChannels.argtypes = [ctypes.c_int, ctypes.c_uint16]
+        lib.HostNodeTxPossible.argtypes = [ctypes.c_int, ctypes.c_uint8]
+        lib.LoRaMacSchedulerSetPolicy.argtypes = [ctypes.c_void_p]
+        lib.LoRaMacSchedulerSetThroughputParams.argtypes = [ctypes.POINTER(ThroughputParams)]
+        lib.LoRaMacSchedulerSetLinkMargin.argtypes = [ctypes.c_int8, ctypes.c_int8]
+        lib.HostNodeAbp.argtypes = [ctypes.c_int, ctypes.c_uint32, ctypes.c_void_p, ctypes.c_void_p,
+                                    ctypes.c_uint32, ctypes.c_uint32, ctypes.c_int8, ctypes.c_bool]
+        lib.HostNodeJoinKeys.argtypes = [ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+        lib.HostNodeSend.argtypes = [ctypes.c_int, ctypes.c_uint8, ctypes.c_void_p, ctypes.c_uint8,
+                                     ctypes.c_bool, ctypes.c_int8]
+        lib.HostNodeDownlink.argtypes = [ctypes.c_int, TimerTime, ctypes.c_uint32, ctypes.c_int8,
+                                         ctypes.c_int16, ctypes.c_int8, ctypes.c_uint32, ctypes.c_bool,
+                                         ctypes.c_int8, ctypes.c_int8]
+        lib.HostNodeDownlinkFOpts.argtypes = [ctypes.c_int, TimerTime, ctypes.c_uint32, ctypes.c_int8,
+                                              ctypes.c_int16, ctypes.c_int8, ctypes.c_uint32, ctypes.c_bool,
+                                              ctypes.c_void_p, ctypes.c_uint8]
+        lib.HostNextUplink.argtypes = [ctypes.POINTER(Uplink)]
+        lib.HostNodeGetStats.argtypes = [ctypes.c_int, ctypes.POINTER(NodeStats)]
+        lib.HostSetMedium.argtypes = [ctypes.c_double] * 4
+        lib.HostNodePlace.argtypes = [ctypes.c_int, ctypes.c_double, ctypes.c_double]
+        lib.HostNow.restype = TimerTime
+        lib.HostNextEvent.restype = TimerTime
+        lib.HostRunUntil.argtypes = [TimerTime]
+        lib.HostReplay.argtypes = [ctypes.c_int, ctypes.c_void_p, ctypes.c_uint16, ctypes.c_void_p,
+                                   ctypes.c_void_p, ctypes.POINTER(ReplayRecord), ctypes.c_int]
+        lib.HostNodeCapture.argtypes = [ctypes.c_int, ctypes.c_void_p, ctypes.c_uint16]
+        lib.LoRaMacRecorderStop.restype = ctypes.c_uint16
+        self._capture = None
+        self.reset()
+
+    def reset(self, seed=1):
+        self.lib.HostReset(seed)
+        # the scheduler state is global, not per node
+        self.scheduler(None)
+        self.lib.LoRaMacSchedulerSetLinkMargin(0, -1)
+        self.lib.LoRaMacSchedulerTakeUrgent()
+
+    def create(self, passive=False, region=LORAMAC_REGION_EU868):
+        node = self.lib.HostNodeCreate(passive, region)
+        if node < 0:
+            raise RuntimeError('node creation failed')
+        return node
+
+    def channels(self, node, mask):
+        return self.lib.HostNodeChannels(node, mask)
+
+    def tx_possible(self, node, size=0):
+        """Largest payload of the next uplink, -1 if size does not fit."""
+        return self.lib.HostNodeTxPossible(node, size)
+
+    def scheduler(self, policy, margin=10, reserve_band=False, max_delay=60000):
+        """Installs LoRaMacSchedulerThroughputPolicy ('throughput') or none."""
+        if policy is None:
+            self.lib.LoRaMacSchedulerSetPolicy(None)
+            return
+        if policy != 'throughput':
+            raise ValueError('unknown policy %s' % policy)
+        params = ThroughputParams(margin, reserve_band, max_delay)
+        self.lib.LoRaMacSchedulerSetThroughputParams(ctypes.byref(params))
+        self.lib.LoRaMacSchedulerSetPolicy(ctypes.cast(self.lib.LoRaMacSchedulerThroughputPolicy, ctypes.c_void_p))
+
+    def link_margin(self, margin, datarate):
+        """What a LinkCheckAns would report, see LoRaMacSchedulerSetLinkMargin."""
+        self.lib.LoRaMacSchedulerSetLinkMargin(int(margin), datarate)
+
+    def mark_urgent(self):
+        self.lib.LoRaMacSchedulerMarkUrgent()
+
+    def abp(self, node, devaddr, nwkskey, appskey, up=0, down=0, datarate=5, adr=False):
+        nwk, _ = _buffer(nwkskey)
+        app, _ = _buffer(appskey)
+        return self.lib.HostNodeAbp(node, devaddr, nwk, app, up, down, datarate, adr)
+
+    def join_keys(self, node, deveui, appeui, appkey):
+        self.lib.HostNodeJoinKeys(node, _buffer(deveui)[0], _buffer(appeui)[0], _buffer(appkey)[0])
+
+    def send(self, node, port, data, confirmed=False, datarate=5):
+        buf, size = _buffer(data)
+        return self.lib.HostNodeSend(node, port, buf, size, confirmed, datarate)
+
+    def downlink(self, node, start, frequency, datarate, rssi, snr, fcnt, ack=False, adr_datarate=-1,
+                 adr_tx_power=0):
+        return self.lib.HostNodeDownlink(node, start, frequency, datarate, int(rssi), int(snr), fcnt, ack,
+                                         adr_datarate, adr_tx_power)
+
+    def medium(self, pl0, gamma, cad_floor, cad_detect=1.0):
+        """CAD model, see HostSetMedium."""
+        self.lib.HostSetMedium(pl0, gamma, cad_floor, cad_detect)
+
+    def place(self, node, x, y):
+        self.lib.HostNodePlace(node, x, y)
+
+    def downlink_fopts(self, node, start, frequency, datarate, rssi, snr, fcnt, fopts, ack=False):
+        buf, size = _buffer(fopts)
+        return self.lib.HostNodeDownlinkFOpts(node, start, frequency, datarate, int(rssi), int(snr), fcnt, ack,
+                                              buf, size)
+
+    def uplinks(self):
+        """Uplinks sent since the last call."""
+        out = []
+        while True:
+            uplink = Uplink()
+            if not self.lib.HostNextUplink(ctypes.byref(uplink)):
+                return out
+            out.append(uplink)
+
+    def stats(self, node):
+        stats = NodeStats()
+        self.lib.HostNodeGetStats(node, ctypes.byref(stats))
+        return stats
+
+    def now(self):
+        return self.lib.HostNow()
+
+    def next_event(self):
+        return self.lib.HostNextEvent()
+
+    def run_until(self, time):
+        self.lib.HostRunUntil(time)
+
+    def capture_start(self, node, size=4096):
+        self._capture = (ctypes.c_uint8 * size)()
+        self.lib.HostNodeCapture(node, self._capture, size)
+
+    def capture_stop(self):
+        size = self.lib.LoRaMacRecorderStop()
+        return bytes(bytearray(self._capture[:size]))
+
+    def replay(self, node, log, nwkskey, appskey, max_records=4096):
+        buf, size = _buffer(log)
+        records = (ReplayRecord * max_records)()
+        count = self.lib.HostReplay(node, buf, size, _buffer(nwkskey)[0], _buffer(appskey)[0],
+                                    records, max_records)
+        if count < 0:
+            raise ValueError('not a LoRaMacRecorder log')
+        return list(records[:min(count, max_records)])
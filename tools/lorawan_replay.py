@@ -0,0 +1,113 @@
+#!/usr/bin/env python
+
+# Replays a LoRaMacRecorder capture through LoRaMac.c on the host.
+#
+# The MAC sources are built for the host by lorawan_host (virtual clock,
+# timer server and a radio that raises no events of its own). A node is
+# activated from the session stored in the log header with the session keys
+# given here, then every recorded request and radio event is fed to it at
+# its recorded time; the MAC's own timers (RX windows, ACK timeout, delayed
+# TX) fire on the virtual clock in between. Per record the MAC state and
+# counters after it are printed, with the processing time measured on the
+# device next to the one on the host [us].
+#
+# usage: lorawan_replay.py --nwkskey hex --appskey hex [--deveui hex
+#                          --appeui hex --appkey hex] capture.bin
+#        lorawan_replay.py --self-test
+#
+# The capture is the buffer given to LoRaMacRecorderStart, the first
+# LoRaMacRecorderStop() bytes of it. --self-test records a few uplinks from
+# a host node and checks the replay ends in the same state.
+
+from __future__ import print_function
+
+import argparse
+import binascii
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'lorawan_host'))
+import lorawan_host
+
+MCPS_TYPES = {0: 'unconfirmed', 1: 'confirmed', 2: 'multicast', 3: 'proprietary'}
+
+
+def key(text, size):
+    data = binascii.unhexlify(text.replace(':', '').replace(' ', ''))
+    if len(data) != size:
+        raise argparse.ArgumentTypeError('%d bytes expected' % size)
+    return data
+
+
+def describe(record):
+    name = lorawan_host.RECORD_EVENTS.get(record.Event, '?')
+    if name == 'Mcps':
+        name += ' ' + MCPS_TYPES.get(record.RequestType, str(record.RequestType))
+    elif name == 'Mlme':
+        name += ' %d' % record.RequestType
+    return name
+
+
+def report(records):
+    print('    time  event             device us  host us  state  uplink  downlink  confirms  rx')
+    for r in records:
+        print('%8d  %-16s %10d %8d  %5d  %6d  %8d  %8d  %2d'
+              % (r.Timestamp, describe(r), r.RecordedUs, r.ReplayUs, r.MacState,
+                 r.UpLinkCounter, r.DownLinkCounter, r.McpsConfirms, r.Downlinks))
+
+
+def self_test(host):
+    keys = bytes(bytearray(range(16)))
+    node = host.create()
+    host.abp(node, 0x26011234, keys, keys, up=10)
+    host.capture_start(node)
+    for i in range(3):
+        if host.send(node, 2, b'replay', confirmed=(i == 1)) != lorawan_host.LORAMAC_STATUS_OK:
+            sys.exit('send %d rejected' % i)
+        host.run_until(host.now() + 200000)
+    log = host.capture_stop()
+    live = host.stats(node)
+
+    passive = host.create(passive=True)
+    records = host.replay(passive, log, keys, keys)
+    replayed = host.stats(passive)
+    report(records)
+    fields = ('McpsConfirms', 'McpsErrors', 'UpLinkCounter', 'DownLinkCounter', 'MacState')
+    failed = [f for f in fields if getattr(live, f) != getattr(replayed, f)]
+    for f in failed:
+        print('%s: live %d, replay %d' % (f, getattr(live, f), getattr(replayed, f)))
+    print('self-test %s, %d records' % ('FAILED' if failed else 'ok', len(records)))
+    return 1 if failed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='replay a LoRaMacRecorder capture through LoRaMac.c')
+    parser.add_argument('log', nargs='?')
+    parser.add_argument('--nwkskey', type=lambda t: key(t, 16))
+    parser.add_argument('--appskey', type=lambda t: key(t, 16))
+    parser.add_argument('--deveui', type=lambda t: key(t, 8), help='for recorded join requests')
+    parser.add_argument('--appeui', type=lambda t: key(t, 8))
+    parser.add_argument('--appkey', type=lambda t: key(t, 16))
+    parser.add_argument('--self-test', action='store_true')
+    args = parser.parse_args()
+
+    host = lorawan_host.Host()
+    if args.self_test:
+        sys.exit(self_test(host))
+    if args.log is None or args.nwkskey is None or args.appskey is None:
+        parser.error('log, --nwkskey and --appskey are required')
+
+    with open(args.log, 'rb') as f:
+        log = f.read()
+    node = host.create(passive=True)
+    if args.appkey is not None:
+        host.join_keys(node, args.deveui or b'\0' * 8, args.appeui or b'\0' * 8, args.appkey)
+    try:
+        records = host.replay(node, log, args.nwkskey, args.appskey)
+    except ValueError as e:
+        sys.exit('%s: %s' % (args.log, e))
+    report(records)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,280 @@
+#!/usr/bin/env python
+
+# Discrete-event simulator of many CubeCell class A nodes sharing one gateway.
+#
+# Every node is a LoRaMacCtx_t of the real MAC: LoRaMac.c and RegionEU868.c
+# are built for the host by lorawan_host and run on its virtual clock, so
+# channel selection, band time-off, CAD before TX (CONFIG_LORA_CAD), the
+# receive windows, confirmed retries and the node side ADR backoff are the
+# firmware's own. What stays in Python is the part outside the node:
+#   - path loss and shadowing per node, fixed for the run
+#   - what a CAD sees: a frame of another node arriving above the CAD floor,
+#     with path loss between the two nodes plus --node-loss, detected with
+#     probability --cad-detect. Nodes far apart are hidden from each other.
+#   - the gateway: a frame on the same channel and SF survives an overlapping
+#     one only if it is at least --capture dB stronger, and is not heard below
+#     the demodulation floor
+#   - the network server: acknowledges confirmed uplinks and answers ADR with
+#     a LinkADRReq for the highest DR keeping the installation margin, in RX1
+#   - the energy model, from the radio TX/RX/CAD time of each node
+# The nodes run the channel plan of LoRaWanClass::init (8 EU868 channels) and
+# are activated by personalization.
+#
+# usage: lorawan_sim.py [--nodes 10,50,100,200,500] [--hours 1] [--adr] ...
+
+from __future__ import print_function
+
+import argparse
+import heapq
+import math
+import os
+import random
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), 'lorawan_host'))
+import lorawan_host
+
+# EU868 channels as set up by LoRaWanClass::init + lwan_dev_params_update:
+# (frequency, band)
+EU868_CHANNELS = [(868100000, 1), (868300000, 1), (868500000, 1),
+                  (867100000, 0), (867300000, 0), (867500000, 0),
+                  (867700000, 0), (867900000, 0)]
+# Band DCycle (1/duty cycle) from EU868_BAND0..4
+EU868_BANDS = [100, 100, 1000, 10, 100]
+
+# DR -> SF at 125 kHz, EU868 DR_0..DR_5
+DR_TO_SF = [12, 11, 10, 9, 8, 7]
+# SX1262 demodulation SNR floor per SF [dB]
+SF_SNR_FLOOR = {7: -7.5, 8: -10.0, 9: -12.5, 10: -15.0, 11: -17.5, 12: -20.0}
+
+LORAWAN_OVERHEAD = 13       # MHDR + FHDR + FPort + MIC
+RECEIVE_DELAY1 = 1000       # ms
+NOISE_FLOOR = -117.0        # dBm at 125 kHz (-174 + 10log10(BW) + NF 6)
+EU868_TX_POWER_14DBM = 1    # LinkADRReq TXPower index, max EIRP - 2 dB
+
+# Uplink MHDR / FCtrl bits
+MTYPE_CONFIRMED_UP = 4
+FCTRL_ADR = 0x80
+FCTRL_ADR_ACK_REQ = 0x40
+
+# Energy model, 3.3 V supply
+VOLTAGE = 3.3
+I_TX_MA = 45.0              # 14 dBm
+I_RX_MA = 5.0
+I_CAD_MA = 5.0
+I_SLEEP_UA = 3.5
+
+KEY = bytes(bytearray(range(16)))
+
+def symbol_time(sf, bw=125000):
+    return (1 << sf) / float(bw) * 1000.0
+
+def time_on_air(sf, pkt_len, preamble=8, crc=1, cr=1, bw=125000):
+    # Same expression as RadioTimeOnAir for MODEM_LORA, explicit header
+    ts = symbol_time(sf, bw)
+    ldro = 1 if ts >= 16.38 else 0
+    t_preamble = (preamble + 4.25) * ts
+    tmp = math.ceil((8 * pkt_len - 4 * sf + 28 + 16 * crc) / float(4 * (sf - 2 * ldro))) * (cr + 4)
+    n_payload = 8 + max(tmp, 0)
+    return int(math.floor(t_preamble + n_payload * ts + 0.999))
+
+
+class Tx(object):
+    __slots__ = ('node', 'frequency', 'sf', 'start', 'end', 'rssi', 'frame', 'lost')
+
+    def __init__(self, node, uplink):
+        self.node = node
+        self.frequency = uplink.Frequency
+        self.sf = uplink.Sf
+        self.start = uplink.Start
+        self.end = uplink.End
+        self.rssi = node.rssi
+        self.frame = uplink.frame()
+        self.lost = False
+
+
+class Node(object):
+    def __init__(self, host, args, rng):
+        self.id = host.create()
+        self.args = args
+        self.rng = rng
+        distance = args.radius * math.sqrt(rng.random())
+        angle = rng.uniform(0, 2 * math.pi)
+        host.place(self.id, distance * math.cos(angle), distance * math.sin(angle))
+        path_loss = args.pl0 + 10 * args.gamma * math.log10(max(distance, 1.0) / 40.0) + rng.gauss(0, args.shadowing)
+        self.rssi = args.tx_power - path_loss
+        self.snr = self.rssi - NOISE_FLOOR
+        dr = self.network_adr() if args.adr else args.dr
+        host.abp(self.id, 0x26000000 + self.id, KEY, KEY, datarate=dr, adr=args.adr)
+        self.fcnt_down = 1
+        self.skipped = 0
+        self.sent = 0
+        self.delivered = 0
+        self.collided = 0
+        self.below_sensitivity = 0
+
+    def network_adr(self):
+        # Highest DR whose SNR floor keeps the installation margin
+        dr = 0
+        for d, sf in enumerate(DR_TO_SF):
+            if self.snr - SF_SNR_FLOOR[sf] >= self.args.margin:
+                dr = d
+        return dr
+
+
+class Simulator(object):
+    def __init__(self, args, nb_nodes, seed):
+        self.args = args
+        self.rng = random.Random(seed)
+        self.host = lorawan_host.Host()
+        self.host.reset(seed)
+        self.host.medium(args.pl0 + args.node_loss, args.gamma, NOISE_FLOOR + SF_SNR_FLOOR[7], args.cad_detect)
+        self.nodes = [Node(self.host, args, self.rng) for _ in range(nb_nodes)]
+        self.events = []
+        self.seq = 0
+        self.on_air = []
+
+    def push(self, when, kind, data):
+        heapq.heappush(self.events, (when, self.seq, kind, data))
+        self.seq += 1
+
+    def resolve(self, tx):
+        for other in self.on_air:
+            if other is tx or other.frequency != tx.frequency or other.sf != tx.sf:
+                continue
+            if other.start < tx.end and tx.start < other.end:
+                if tx.rssi - other.rssi < self.args.capture:
+                    tx.lost = True
+                if other.rssi - tx.rssi < self.args.capture:
+                    other.lost = True
+
+    def run(self):
+        args = self.args
+        host = self.host
+        end = int(args.hours * 3600 * 1000)
+        for node in self.nodes:
+            self.push(self.rng.randint(0, args.period), 'app', node)
+        while True:
+            when = min(self.events[0][0] if self.events else end + 1, host.next_event())
+            if when > end:
+                break
+            # MAC timers first, then what the application and gateway do then
+            host.run_until(when)
+            while self.events and self.events[0][0] <= when:
+                _, _, kind, data = heapq.heappop(self.events)
+                if kind == 'app':
+                    self.app(when, data)
+                elif kind == 'rxend':
+                    self.rx_end(data)
+            for uplink in host.uplinks():
+                self.start_tx(self.nodes[uplink.Node], uplink)
+        host.run_until(end)
+        return self.report()
+
+    def app(self, now, node):
+        args = self.args
+        self.push(now + args.period + self.rng.randint(0, args.period_rnd), 'app', node)
+        payload = bytes(bytearray(self.rng.getrandbits(8) for _ in range(args.payload)))
+        status = self.host.send(node.id, 2, payload, confirmed=args.confirmed, datarate=args.dr)
+        if status != lorawan_host.LORAMAC_STATUS_OK:
+            # LoRaWanClass::send while the MAC is still busy
+            node.skipped += 1
+
+    def start_tx(self, node, uplink):
+        now = uplink.Start
+        self.on_air = [t for t in self.on_air if t.end > now]
+        tx = Tx(node, uplink)
+        self.on_air.append(tx)
+        self.resolve(tx)
+        node.sent += 1
+        self.push(tx.end, 'rxend', tx)
+
+    def rx_end(self, tx):
+        node = tx.node
+        if node.snr < SF_SNR_FLOOR[tx.sf]:
+            node.below_sensitivity += 1
+            return
+        if tx.lost:
+            node.collided += 1
+            return
+        node.delivered += 1
+
+        # network server, answers in RX1 on the uplink channel and DR
+        confirmed = (ord(tx.frame[0:1]) >> 5) == MTYPE_CONFIRMED_UP
+        fctrl = ord(tx.frame[5:6])
+        adr_dr = -1
+        if fctrl & FCTRL_ADR:
+            target = node.network_adr()
+            if target != 12 - tx.sf or fctrl & FCTRL_ADR_ACK_REQ:
+                adr_dr = target
+        if confirmed or adr_dr >= 0 or fctrl & FCTRL_ADR_ACK_REQ:
+            self.host.downlink(node.id, tx.end + RECEIVE_DELAY1, tx.frequency, 12 - tx.sf, node.rssi,
+                               max(-128, min(127, node.snr)), node.fcnt_down, ack=confirmed,
+                               adr_datarate=adr_dr, adr_tx_power=EU868_TX_POWER_14DBM)
+            node.fcnt_down += 1
+
+    def report(self):
+        hours = self.args.hours
+        sent = sum(n.sent for n in self.nodes)
+        delivered = sum(n.delivered for n in self.nodes)
+        collided = sum(n.collided for n in self.nodes)
+        unheard = sum(n.below_sensitivity for n in self.nodes)
+        skipped = sum(n.skipped for n in self.nodes)
+        deferrals = 0
+        energy = []
+        for n in self.nodes:
+            stats = self.host.stats(n.id)
+            deferrals += stats.CadBusy
+            active_ms = stats.TxTime + stats.RxTime + stats.CadTime
+            sleep_ms = hours * 3600 * 1000 - active_ms
+            mj = VOLTAGE * (stats.TxTime * I_TX_MA + stats.RxTime * I_RX_MA + stats.CadTime * I_CAD_MA +
+                            sleep_ms * I_SLEEP_UA / 1000.0) / 1000.0
+            energy.append(mj)
+        return {
+            'nodes': len(self.nodes),
+            'sent': sent,
+            'delivered': delivered,
+            'throughput': delivered * self.args.payload / float(hours),
+            'collision_rate': collided / float(sent) if sent else 0.0,
+            'unheard': unheard,
+            'cad_deferrals': deferrals,
+            'skipped': skipped,
+            'energy_mj': sum(energy) / len(energy),
+            'energy_per_delivered_mj': sum(energy) / delivered if delivered else float('inf'),
+        }
+
+def main():
+    parser = argparse.ArgumentParser(description='LoRaWAN capacity simulator (EU868, class A)')
+    parser.add_argument('--nodes', default='10,50,100,200,500', help='comma separated node counts')
+    parser.add_argument('--hours', type=float, default=1)
+    parser.add_argument('--period', type=int, default=15000, help='appTxDutyCycle [ms]')
+    parser.add_argument('--period-rnd', type=int, default=1000, help='APP_TX_DUTYCYCLE_RND [ms]')
+    parser.add_argument('--payload', type=int, default=12, help='appDataSize [bytes]')
+    parser.add_argument('--dr', type=int, default=5, help='datarate when ADR is off')
+    parser.add_argument('--adr', action='store_true', help='enable ADR')
+    parser.add_argument('--confirmed', action='store_true', help='confirmed uplinks')
+    parser.add_argument('--margin', type=float, default=10.0, help='ADR installation margin [dB]')
+    parser.add_argument('--capture', type=float, default=6.0, help='capture threshold [dB]')
+    parser.add_argument('--tx-power', type=float, default=14.0, help='[dBm]')
+    parser.add_argument('--radius', type=float, default=3000.0, help='cell radius [m]')
+    parser.add_argument('--pl0', type=float, default=107.4, help='path loss at 40 m [dB]')
+    parser.add_argument('--gamma', type=float, default=2.08, help='path loss exponent')
+    parser.add_argument('--shadowing', type=float, default=3.0, help='shadowing sigma [dB]')
+    parser.add_argument('--node-loss', type=float, default=10.0,
+                        help='extra path loss between two nodes, antennas near the ground [dB]')
+    parser.add_argument('--cad-detect', type=float, default=0.9,
+                        help='probability that CAD detects a frame above its floor')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    print('%6s %9s %9s %9s %9s %12s %9s %9s %10s %12s' % ('nodes', 'sent', 'skipped', 'unheard', 'delivered',
+                                                          'bytes/hour', 'collided', 'cad busy', 'mJ/node',
+                                                          'mJ/delivered'))
+    for count in [int(c) for c in args.nodes.split(',')]:
+        r = Simulator(args, count, args.seed).run()
+        print('%6d %9d %9d %9d %9d %12.0f %8.2f%% %9d %10.1f %12.2f' % (
+            r['nodes'], r['sent'], r['skipped'], r['unheard'], r['delivered'], r['throughput'], 100.0 * r['collision_rate'],
+            r['cad_deferrals'], r['energy_mj'], r['energy_per_delivered_mj']))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+
+# Receive window timing model: radio on-time and receive charge per class A
+# uplink with the static SystemMaxRxError windows against the windows sized
+# by LoRaMacRxTiming from the measured error.
+#
+# Window size and opening follow RegionCommonComputeRxWindowParameters and
+# ScheduleTx; the adaptive error follows LoRaMacRxTimingRxError. Feed it the
+# Offset / Deviation / DriftPpm read with LoRaMacRxTimingGetStats on the
+# device. The miss rate is a Monte Carlo estimate assuming the timing error
+# is normal with sigma = 1.25 * mean deviation.
+#
+# usage: rxwindow_model.py [--offset-us 2900] [--deviation-us 470] [--ppm 20]
+
+from __future__ import print_function
+
+import argparse
+import math
+import random
+
+# EU868 DR_0..DR_5 spreading factors, RX2 default DR_0
+DR_TO_SF = [12, 11, 10, 9, 8, 7]
+RX_TIMING_RESOLUTION = 1000     # us
+LORAMAC_RX_TIMING_MARGIN = 1000 # us
+LORAMAC_RX_TIMING_MIN_RX_ERROR = 2
+I_RX_MA = 5.0
+RADIO_WAKEUP_TIME = 3           # ms, BOARD_TCXO_WAKEUP_TIME + RADIO_WAKEUP_TIME
+
+def symbol_time(sf, bw=125000):
+    return (1 << sf) / float(bw) * 1000.0
+
+def window(ts, min_rx_symbols, rx_error):
+    # RegionCommonComputeRxWindowParameters
+    timeout = max(int(math.ceil(((2 * min_rx_symbols - 8) * ts + 2 * rx_error) / ts)), min_rx_symbols)
+    offset = int(math.ceil(4.0 * ts - timeout * ts / 2.0 - RADIO_WAKEUP_TIME))
+    return timeout, offset
+
+def adaptive_error(args, rx_delay):
+    drift = abs(args.ppm) * rx_delay / 1000.0
+    error = 4 * args.deviation_us + RX_TIMING_RESOLUTION + drift + LORAMAC_RX_TIMING_MARGIN
+    error = int(math.ceil(error / 1000.0))
+    return min(max(error, LORAMAC_RX_TIMING_MIN_RX_ERROR), args.max_rx_error)
+
+def miss_rate(args, centre, rx_error, rng):
+    sigma = 1.25 * args.deviation_us / 1000.0
+    misses = 0
+    for _ in range(args.trials):
+        e = rng.gauss(args.offset_us / 1000.0, sigma)
+        if abs(e - centre) > rx_error:
+            misses += 1
+    return misses / float(args.trials)
+
+def main():
+    parser = argparse.ArgumentParser(description='Class A receive window on-time, static against measured error')
+    parser.add_argument('--offset-us', type=float, default=2900, help='LoRaMacRxTimingStats_t Offset')
+    parser.add_argument('--deviation-us', type=float, default=470, help='LoRaMacRxTimingStats_t Deviation')
+    parser.add_argument('--ppm', type=float, default=20, help='LoRaMacRxTimingStats_t DriftPpm')
+    parser.add_argument('--max-rx-error', type=int, default=10, help='SystemMaxRxError [ms]')
+    parser.add_argument('--min-rx-symbols', type=int, default=6, help='MinRxSymbols')
+    parser.add_argument('--rx-delay', type=int, default=1000, help='ReceiveDelay1 [ms]')
+    parser.add_argument('--uplinks', type=float, default=96, help='uplinks per day')
+    parser.add_argument('--trials', type=int, default=20000)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+    rng = random.Random(args.seed)
+
+    print('%-4s %-8s %8s %8s %10s %10s %10s' % ('DR', 'windows', 'error ms', 'symbols', 'RX1+RX2 ms',
+                                                'uAh/day', 'miss'))
+    rx2_ts = symbol_time(DR_TO_SF[0])
+    for dr, sf in enumerate(DR_TO_SF):
+        ts = symbol_time(sf)
+        for name in ('static', 'adaptive'):
+            if name == 'static':
+                err1 = err2 = args.max_rx_error
+                centre = 0
+            else:
+                err1 = adaptive_error(args, args.rx_delay)
+                err2 = adaptive_error(args, args.rx_delay + 1000)
+                centre = int(round(args.offset_us / 1000.0))
+            t1, _ = window(ts, args.min_rx_symbols, err1)
+            t2, _ = window(rx2_ts, args.min_rx_symbols, err2)
+            # Windows time out on unconfirmed traffic, both stay open in full
+            on_ms = t1 * ts + t2 * rx2_ts + 2 * RADIO_WAKEUP_TIME
+            uah = on_ms * I_RX_MA * args.uplinks / 3600.0
+            print('DR%-2d %-8s %8d %8d %10.1f %10.1f %9.3f%%' % (dr, name, err1, t1, on_ms, uah,
+                                                                100.0 * miss_rate(args, centre, err1, rng)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,247 @@
+#!/usr/bin/env python
+
+# Worst-case stack depth per entry point, computed from the linked firmware.
+#
+# The call graph and the frame sizes come from the disassembly of the .elf
+# (arm-none-eabi-objdump -d), so the prebuilt CubeCellLib.a is covered as
+# well. A frame is what the prologue reserves: push {...} plus sub sp, #n or
+# the ldr/add sp pair GCC uses for large frames. Files compiled with
+# -fstack-usage leave .su files next to the objects; pass their directory
+# with --su and those sizes are used instead.
+#
+# Calls through a pointer (blx rN) cannot be followed. They are flagged in
+# the output; --edge caller:callee adds the ones you know about, e.g. the
+# radio events into the LoRaMac OnRadio* handlers.
+#
+# By default the LoRaMac entry points are analysed: the request API called
+# from the application and the radio/timer handlers that run from interrupt
+# context. With --isr the deepest handler plus the 32 byte exception frame
+# is added to the deepest application path, which is the figure to hold
+# against CYDEV_STACK_SIZE (--budget, exit status 1 when exceeded).
+#
+# usage: stack_usage.py [--objdump cmd] [--su dir] [--entry name ...]
+#                       [--isr name ...] [--edge caller:callee ...]
+#                       [--budget bytes] firmware.elf
+#
+# The .elf is in the Arduino build folder (File > Preferences > "Show
+# verbose output during compilation" prints its path).
+
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+LORAMAC_API = [
+    'LoRaMacInitialization', 'LoRaMacQueryTxPossible', 'LoRaMacChannelAdd',
+    'LoRaMacMibGetRequestConfirm', 'LoRaMacMibSetRequestConfirm',
+    'LoRaMacMlmeRequest', 'LoRaMacMcpsRequest',
+]
+LORAMAC_HANDLERS = [
+    'OnRadioTxDone', 'OnRadioRxDone', 'OnRadioTxTimeout', 'OnRadioRxError',
+    'OnRadioRxTimeout', 'OnRadioCadDone', 'OnMacStateCheckTimerEvent',
+    'OnTxDelayedTimerEvent', 'OnRxWindow1TimerEvent', 'OnRxWindow2TimerEvent',
+    'OnAckTimeoutTimerEvent',
+]
+
+# Cortex-M0+ hardware stacking on exception entry, no FPU
+EXCEPTION_FRAME = 32
+
+FUNC_RE = re.compile(r'^([0-9a-f]+) <([^>]+)>:$')
+INSN_RE = re.compile(r'^\s*([0-9a-f]+):\s+(?:[0-9a-f]{4}\s?)+\s+(\S+)\s*(.*)$')
+WORD_RE = re.compile(r'^\s*([0-9a-f]+):\s+([0-9a-f]{8})\s+\.word\s')
+CALL_RE = re.compile(r'^[0-9a-f]+ <([^>+]+)>')
+
+
+class Function(object):
+    def __init__(self, name):
+        self.name = name
+        self.frame = 0
+        self.frame_from = 'prologue'
+        self.calls = set()
+        self.indirect = False
+        self.dynamic = False
+
+
+def parse_disassembly(lines):
+    funcs = {}
+    words = {}
+    pending = []        # (function, literal address) of ldr rX, [pc] ; add sp, rX
+    func = None
+    for line in lines:
+        m = FUNC_RE.match(line)
+        if m:
+            func = funcs.setdefault(m.group(2), Function(m.group(2)))
+            pushed = reserved = False
+            literals = {}
+            continue
+        m = WORD_RE.match(line)
+        if m:
+            words[int(m.group(1), 16)] = int(m.group(2), 16)
+            continue
+        m = INSN_RE.match(line)
+        if not m or func is None:
+            continue
+        op = m.group(2)
+        args, _, comment = m.group(3).partition(';')
+        args, comment = args.strip(), comment.strip()
+
+        # The prologue is the first push and the first stack adjustment,
+        # epilogues only pop and add.
+        if op == 'push' and not pushed:
+            func.frame += 4 * count_registers(args)
+            pushed = True
+        elif op in ('sub', 'subs') and args.startswith('sp, #') and not reserved:
+            func.frame += int(args.split('#')[1], 0)
+            reserved = True
+        elif op == 'ldr' and '[pc' in args:
+            lit = re.match(r'\(([0-9a-f]+)', comment)
+            if lit:
+                literals[args.split(',')[0]] = int(lit.group(1), 16)
+        elif op == 'add' and args.startswith('sp, r') and not reserved:
+            reg = args.split(',')[1].strip()
+            if reg in literals:
+                pending.append((func, literals[reg]))
+                reserved = True
+        elif op == 'mov' and args.startswith('sp, r'):
+            func.dynamic = True
+        elif op == 'bl':
+            target = CALL_RE.match(args)
+            if target:
+                func.calls.add(target.group(1))
+        elif op in ('b', 'b.n', 'b.w'):
+            # a branch to the start of another function is a tail call
+            target = re.match(r'^[0-9a-f]+ <([^>+]+)>$', args)
+            if target and target.group(1) != func.name:
+                func.calls.add(target.group(1))
+        elif op == 'blx':
+            func.indirect = True
+
+    # large frames add a negative literal to sp
+    for func, addr in pending:
+        delta = words.get(addr, 0)
+        if delta & 0x80000000:
+            func.frame += (1 << 32) - delta
+    return funcs
+
+
+def count_registers(args):
+    count = 0
+    for part in args.strip('{}').split(','):
+        part = part.strip()
+        if '-' in part:
+            lo, hi = part.split('-')
+            count += int(hi.strip()[1:]) - int(lo.strip()[1:]) + 1
+        elif part:
+            count += 1
+    return count
+
+
+def load_su(funcs, directory):
+    for root, _, files in os.walk(directory):
+        for name in files:
+            if not name.endswith('.su'):
+                continue
+            with open(os.path.join(root, name)) as f:
+                for line in f:
+                    fields = line.rstrip('\n').split('\t')
+                    if len(fields) < 2:
+                        continue
+                    func = fields[0].split(':')[-1]
+                    if func in funcs:
+                        funcs[func].frame = int(fields[1])
+                        funcs[func].frame_from = fields[2] if len(fields) > 2 else 'su'
+
+
+def worst_case(funcs, name, memo, stack):
+    """Returns (bytes, path, flags) for the deepest chain starting at name."""
+    if name in memo:
+        return memo[name]
+    func = funcs.get(name)
+    if func is None:
+        return 0, [name + '?'], {'unknown'}
+    if name in stack:
+        return 0, [name + ' (recursion)'], {'recursion'}
+
+    stack.add(name)
+    best, best_path, flags = 0, [], set()
+    for callee in sorted(func.calls):
+        depth, path, sub_flags = worst_case(funcs, callee, memo, stack)
+        flags |= sub_flags
+        if depth > best:
+            best, best_path = depth, path
+    stack.discard(name)
+
+    if func.indirect:
+        flags.add('indirect')
+    if func.dynamic:
+        flags.add('dynamic')
+    if func.frame_from not in ('prologue', 'static', 'su'):
+        flags.add(func.frame_from)
+    result = (func.frame + best, [name] + best_path, flags)
+    if 'recursion' not in flags:
+        memo[name] = result
+    return result
+
+
+def report(funcs, names, memo):
+    worst = (0, None)
+    for name in names:
+        if name not in funcs:
+            print('%-28s  not in this image' % name)
+            continue
+        depth, path, flags = worst_case(funcs, name, memo, set())
+        note = (' [%s]' % ','.join(sorted(flags))) if flags else ''
+        print('%-28s %6d%s' % (name, depth, note))
+        print('    ' + ' > '.join(path))
+        if depth > worst[0]:
+            worst = (depth, name)
+    return worst
+
+
+def main():
+    parser = argparse.ArgumentParser(description='worst-case stack per entry point')
+    parser.add_argument('elf')
+    parser.add_argument('--objdump', default='arm-none-eabi-objdump')
+    parser.add_argument('--su', action='append', default=[], help='directory with -fstack-usage output')
+    parser.add_argument('--entry', action='append', default=[], help='entry point, default: LoRaMac')
+    parser.add_argument('--isr', action='append', default=[], help='interrupt handler to add on top')
+    parser.add_argument('--edge', action='append', default=[], help='caller:callee for a call through a pointer')
+    parser.add_argument('--budget', type=int, default=0, help='stack size to check against, e.g. 2048')
+    args = parser.parse_args()
+
+    try:
+        out = subprocess.check_output([args.objdump, '-d', args.elf])
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('%s: %s' % (args.objdump, e))
+    funcs = parse_disassembly(out.decode('ascii', 'replace').splitlines())
+    for path in args.su:
+        load_su(funcs, path)
+    for edge in args.edge:
+        caller, callee = edge.split(':', 1)
+        if caller in funcs:
+            funcs[caller].calls.add(callee)
+
+    memo = {}
+    print('entry point                   bytes  deepest path')
+    entries = args.entry or (LORAMAC_API + LORAMAC_HANDLERS)
+    worst = report(funcs, entries, memo)
+    total = worst[0]
+
+    if args.isr:
+        print('\ninterrupt handlers')
+        isr = report(funcs, args.isr, memo)
+        total += isr[0] + EXCEPTION_FRAME
+        print('\n%s + %s + %d byte exception frame = %d bytes'
+              % (worst[1], isr[1], EXCEPTION_FRAME, total))
+
+    if args.budget:
+        print('budget %d bytes: %s' % (args.budget, 'ok' if total <= args.budget else 'EXCEEDED'))
+        if total > args.budget:
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
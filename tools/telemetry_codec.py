@@ -0,0 +1,164 @@
+#!/usr/bin/env python
+
+# Host side of the telemetry codec in libraries/LoRa/src/LoRaWan_Telemetry.cpp.
+#
+# A schema is a comma separated list of fields, each min:max:resolution:deltabits
+# with an optional :lpp suffix giving the Cayenne LPP data size of the field
+# (default 2), e.g. for temperature, humidity and battery voltage
+#
+#   -40:85:0.1:5:2,0:100:0.5:4:1,2.5:4.2:0.01:3:2
+#
+# usage: telemetry_codec.py decode <schema> <hex frame>
+#        telemetry_codec.py bench <schema> [samples per frame]
+#
+# bench encodes a random walk with both the packed codec and Cayenne LPP and
+# prints the frame sizes and airtimes. The encode time is measured on the
+# device by the LoRaWan_PackedTelemetry example.
+
+from __future__ import print_function
+
+import math
+import random
+import sys
+
+COUNT_BITS = 4
+MAX_SAMPLES = 15
+# levels are int32_t on the device, wider ranges and deltas are cut to this
+MAX_BITS = 31
+# MHDR, FHDR without options, FPort and MIC
+LORAWAN_OVERHEAD = 13
+LPP_HEADER = 2
+
+class Field(object):
+    def __init__(self, spec):
+        parts = spec.split(':')
+        self.min = float(parts[0])
+        self.max = float(parts[1])
+        self.res = float(parts[2])
+        self.delta_bits = min(int(parts[3]), MAX_BITS)
+        self.lpp_size = int(parts[4]) if len(parts) > 4 else 2
+        levels = int((self.max - self.min) / self.res + 0.5)
+        self.bits = min(max(levels, 0).bit_length(), MAX_BITS)
+
+def parse_schema(text):
+    return [Field(spec) for spec in text.split(',')]
+
+class BitWriter(object):
+    def __init__(self):
+        self.bits = []
+
+    def write(self, value, nbits):
+        for i in range(nbits - 1, -1, -1):
+            self.bits.append((value >> i) & 1)
+
+    def data(self):
+        bits = self.bits + [0] * (-len(self.bits) % 8)
+        return bytearray(int(''.join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+class BitReader(object):
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def read(self, nbits):
+        if self.pos + nbits > len(self.data) * 8:
+            raise ValueError('frame too short')
+        value = 0
+        for _ in range(nbits):
+            value = (value << 1) | ((self.data[self.pos >> 3] >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return value
+
+def quantize(field, value):
+    level = int(math.floor((value - field.min) / field.res + 0.5))
+    return min(max(level, 0), (1 << field.bits) - 1)
+
+def encode(schema, samples):
+    w = BitWriter()
+    w.write(len(samples), COUNT_BITS)
+    previous = [0] * len(schema)
+    for n, sample in enumerate(samples):
+        for i, field in enumerate(schema):
+            level = quantize(field, sample[i])
+            if n > 0 and field.delta_bits > 0:
+                delta = level - previous[i]
+                limit = 1 << (field.delta_bits - 1)
+                if -limit <= delta < limit:
+                    w.write(0, 1)
+                    w.write(delta & ((1 << field.delta_bits) - 1), field.delta_bits)
+                    previous[i] = level
+                    continue
+                w.write(1, 1)
+            w.write(level, field.bits)
+            previous[i] = level
+    return w.data()
+
+def decode(schema, data):
+    r = BitReader(data)
+    count = r.read(COUNT_BITS)
+    previous = [0] * len(schema)
+    samples = []
+    for n in range(count):
+        sample = []
+        for i, field in enumerate(schema):
+            if n > 0 and field.delta_bits > 0 and r.read(1) == 0:
+                raw = r.read(field.delta_bits)
+                if raw & (1 << (field.delta_bits - 1)):
+                    raw -= 1 << field.delta_bits
+                level = previous[i] + raw
+            else:
+                level = r.read(field.bits)
+            previous[i] = level
+            sample.append(field.min + level * field.res)
+        samples.append(sample)
+    return samples
+
+def lpp_size(schema, nb_samples):
+    return nb_samples * sum(LPP_HEADER + f.lpp_size for f in schema)
+
+def time_on_air(size, sf, bw=125000.0, preamble=8):
+    # explicit header, CRC on, coding rate 4/5
+    ts = (1 << sf) / bw
+    ldro = 1 if ts > 0.016 else 0
+    payload = 8 + max(math.ceil((8.0 * size - 4 * sf + 28 + 16) / (4 * (sf - 2 * ldro))) * 5, 0)
+    return ((preamble + 4.25) + payload) * ts * 1000.0
+
+def random_walk(schema, count, seed=1):
+    rnd = random.Random(seed)
+    value = [(f.min + f.max) / 2.0 for f in schema]
+    samples = []
+    for _ in range(count):
+        samples.append(list(value))
+        for i, f in enumerate(schema):
+            step = f.res * rnd.choice([-2, -1, 0, 0, 1, 2])
+            value[i] = min(max(value[i] + step, f.min), f.max)
+    return samples
+
+def bench(schema, per_frame):
+    print('field bits: %s' % ' '.join(str(f.bits) for f in schema))
+    print('%7s %7s %7s %12s %12s %12s %12s' % ('samples', 'packed', 'lpp', 'packed SF7', 'lpp SF7',
+                                              'packed SF12', 'lpp SF12'))
+    for n in range(1, per_frame + 1):
+        samples = random_walk(schema, n)
+        packed = encode(schema, samples)
+        assert len(decode(schema, packed)) == n
+        lpp = lpp_size(schema, n)
+        print('%7d %7d %7d %10.1fms %10.1fms %10.1fms %10.1fms' % (
+            n, len(packed), lpp,
+            time_on_air(LORAWAN_OVERHEAD + len(packed), 7), time_on_air(LORAWAN_OVERHEAD + lpp, 7),
+            time_on_air(LORAWAN_OVERHEAD + len(packed), 12), time_on_air(LORAWAN_OVERHEAD + lpp, 12)))
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ('decode', 'bench'):
+        print('usage: %s decode <schema> <hex frame>' % sys.argv[0])
+        print('       %s bench <schema> [samples per frame]' % sys.argv[0])
+        sys.exit(1)
+    schema = parse_schema(sys.argv[2])
+    if sys.argv[1] == 'decode':
+        for sample in decode(schema, bytearray.fromhex(sys.argv[3])):
+            print(' '.join('%g' % v for v in sample))
+    else:
+        bench(schema, min(int(sys.argv[3]) if len(sys.argv) > 3 else 8, MAX_SAMPLES))
+
+if __name__ == '__main__':
+    main()
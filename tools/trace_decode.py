@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+
+# Decodes the binary trace stream written by TraceFlush() when the core is
+# built with "LoRaWan Debug Level" = 3 and TRACE_OUTPUT_BINARY defined.
+#
+# The string table is generated from TRACE_EVENT_LIST in
+# cores/asr650x/board/inc/trace.h, so the decoder always matches the firmware
+# built from the same tree.
+#
+# usage: trace_decode.py <capture file>   (use - for stdin)
+
+from __future__ import print_function
+
+import os
+import re
+import struct
+import sys
+
+current_dir = os.path.dirname(os.path.realpath(__file__))
+trace_header = os.path.join(current_dir, '..', 'cores', 'asr650x', 'board', 'inc', 'trace.h')
+
+TRACE_SYNC_BYTE = 0xA5
+# uint16 Id, uint8 NbArgs, uint8 Lost, uint32 Timestamp, uint32 Args[4]
+RECORD = struct.Struct('<HBBI4I')
+
+def load_formats(path):
+    formats = []
+    with open(path) as f:
+        for line in f:
+            m = re.match(r'\s*X\((\w+),\s*"(.*)"\)', line)
+            if m:
+                fmt = m.group(2).replace('\\r', '').replace('\\n', '').replace('\\t', '\t')
+                formats.append((m.group(1), fmt))
+    return formats
+
+def render(fmt, args):
+    values = []
+    for i, conv in enumerate(re.findall(r'%[-0-9]*([dux])', fmt)):
+        v = args[i]
+        if conv == 'd' and v & 0x80000000:
+            v -= 1 << 32
+        values.append(v)
+    return fmt % tuple(values)
+
+def decode(data, formats):
+    i = 0
+    while i + 1 + RECORD.size <= len(data):
+        if data[i] != TRACE_SYNC_BYTE:
+            i += 1
+            continue
+        ev, nargs, lost, ts, a0, a1, a2, a3 = RECORD.unpack_from(data, i + 1)
+        if ev >= len(formats) or nargs > 4:
+            # false sync, resynchronise on the next byte
+            i += 1
+            continue
+        i += 1 + RECORD.size
+        if lost:
+            print('%10u  (%u records lost)' % (ts, lost))
+        name, fmt = formats[ev]
+        print('%10u  %-24s %s' % (ts, name, render(fmt, (a0, a1, a2, a3))))
+
+def main():
+    if len(sys.argv) != 2:
+        print('usage: %s <capture file | ->' % sys.argv[0])
+        sys.exit(1)
+    formats = load_formats(trace_header)
+    if sys.argv[1] == '-':
+        data = sys.stdin.buffer.read() if hasattr(sys.stdin, 'buffer') else sys.stdin.read()
+    else:
+        with open(sys.argv[1], 'rb') as f:
+            data = f.read()
+    decode(bytearray(data), formats)
+
+if __name__ == '__main__':
+    main()